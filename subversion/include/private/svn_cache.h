@@ -281,6 +281,17 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
                                   svn_boolean_t thread_safe,
                                   apr_pool_t *result_pool);
 
+/**
+ * Set @a *reads and @a *hits to the number of lookups in @a membuffer
+ * since its creation and the number of those lookups that found the
+ * data in the cache.  The counters of all caches sharing @a membuffer
+ * are combined.
+ */
+svn_error_t *
+svn_cache__membuffer_get_access_counts(apr_uint64_t *reads,
+                                       apr_uint64_t *hits,
+                                       svn_membuffer_t *membuffer);
+
 /**
  * Creates a new cache in @a *cache_p, storing the data in a potentially
  * shared @a membuffer object.  The elements in the cache will be indexed
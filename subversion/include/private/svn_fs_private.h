@@ -67,6 +67,20 @@ svn_fs__access_get_lock_tokens(svn_fs_access_t *access_ctx);
 svn_error_t *
 svn_fs__path_valid(const char *path, apr_pool_t *pool);
 
+/* Hint to the filesystem that the node-revisions and property lists of
+ * the entries NAMES (const char *) of directory PATH in ROOT are about to
+ * be read, so that the backend may load them in bulk and in storage order
+ * rather than one at a time.  If NAMES is NULL, do so for all entries.
+ * Names that are not entries of PATH are ignored.  This is purely an
+ * optimization; back-ends that cannot do better than on-demand reads may
+ * ignore it.  Use POOL for temporary allocations.
+ */
+svn_error_t *
+svn_fs__prefetch_dir(svn_fs_root_t *root,
+                     const char *path,
+                     const apr_array_header_t *names,
+                     apr_pool_t *pool);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
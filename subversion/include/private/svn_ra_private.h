@@ -34,6 +34,7 @@
 #include "svn_delta.h"
 #include "svn_editor.h"
 #include "svn_io.h"
+#include "svn_diff.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -281,6 +282,47 @@ svn_ra__replay_ev2(svn_ra_session_t *session,
                    apr_pool_t *scratch_pool);
 
 
+
+/*** Server-side blame ***/
+
+/* Callback type for svn_ra__get_file_blame().  The lines starting at the
+   zero-based line number START_LINE up to the START_LINE of the next
+   invocation, or to the end of the file for the last one, have last been
+   changed in REVISION.  REV_PROPS are the properties of REVISION; they
+   may be shared between invocations for the same REVISION.  REVISION is
+   SVN_INVALID_REVNUM and REV_PROPS NULL for lines that predate the start
+   of the blamed revision range.
+
+   POOL is cleared between invocations.  */
+typedef svn_error_t *(*svn_ra__blame_receiver_t)(void *baton,
+                                                 apr_int64_t start_line,
+                                                 svn_revnum_t revision,
+                                                 apr_hash_t *rev_props,
+                                                 apr_pool_t *pool);
+
+/* Have the server compute the blame information for the file PATH,
+   relative to SESSION's URL, at revision END, attributing changes made
+   between START and END.  Send it to RECEIVER with RECEIVER_BATON in line
+   order.  Only the line attributions are transferred; fetch the file's
+   contents at END separately.
+
+   DIFF_OPTIONS and IGNORE_MIME_TYPE are as for svn_client_blame5();
+   merged revisions are not taken into account.
+
+   Return SVN_ERR_RA_NOT_IMPLEMENTED if the server cannot do this, in
+   which case the caller should fall back to svn_ra_get_file_revs2().
+   Use POOL for temporary allocations.  */
+svn_error_t *
+svn_ra__get_file_blame(svn_ra_session_t *session,
+                       const char *path,
+                       svn_revnum_t start,
+                       svn_revnum_t end,
+                       const svn_diff_file_options_t *diff_options,
+                       svn_boolean_t ignore_mime_type,
+                       svn_ra__blame_receiver_t receiver,
+                       void *receiver_baton,
+                       apr_pool_t *pool);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
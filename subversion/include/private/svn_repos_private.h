@@ -32,6 +32,7 @@
 #include "svn_types.h"
 #include "svn_repos.h"
 #include "svn_editor.h"
+#include "svn_diff.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -82,6 +83,59 @@ const char *
 svn_repos__post_commit_error_str(svn_error_t *err,
                                  apr_pool_t *pool);
 
+/**
+ * Like svn_repos_authz_read() but share the result with all other callers
+ * in this process that read the same @a file, and only read it again once
+ * its modification time or size changed.  Files modified within the last
+ * few seconds are read every time, as their modification time may not
+ * change with the next edit.  @a *authz_p remains valid until
+ * @a result_pool gets cleared or destroyed.
+ *
+ * Files that cannot be stat()ed, such as missing files or registry paths,
+ * are read into @a result_pool without being shared.  Use @a scratch_pool
+ * for temporary allocations.
+ *
+ * @since New in 1.8.
+ */
+svn_error_t *
+svn_repos__authz_read_shared(svn_authz_t **authz_p,
+                             const char *file,
+                             svn_boolean_t must_exist,
+                             apr_pool_t *result_pool,
+                             apr_pool_t *scratch_pool);
+
+/**
+ * Counters for the access checks done by svn_repos__authz_check_access().
+ *
+ * @since New in 1.8.
+ */
+typedef struct svn_repos__authz_counters_t
+{
+  /** The number of access checks. */
+  apr_uint64_t checks;
+
+  /** The number of checks whose result was not cached and that therefore
+   * had to evaluate the authz rules. */
+  apr_uint64_t evaluations;
+} svn_repos__authz_counters_t;
+
+/**
+ * Like svn_repos_authz_check_access() but also count the check and,
+ * if its result was not cached in @a authz, the evaluation in
+ * @a *counters unless that is @c NULL.
+ *
+ * @since New in 1.8.
+ */
+svn_error_t *
+svn_repos__authz_check_access(svn_authz_t *authz,
+                              const char *repos_name,
+                              const char *path,
+                              const char *user,
+                              svn_repos_authz_access_t required_access,
+                              svn_boolean_t *access_granted,
+                              svn_repos__authz_counters_t *counters,
+                              apr_pool_t *pool);
+
 /* A repos version of svn_fs_type */
 svn_error_t *
 svn_repos__fs_type(const char **fs_type,
@@ -114,6 +168,240 @@ svn_repos__replay_ev2(svn_fs_root_t *root,
                       apr_pool_t *scratch_pool);
 
 
+/* Callback type for svn_repos__get_file_blame().  The lines starting
+ * at the zero-based line number START_LINE up to the START_LINE of the
+ * next invocation, or to the end of the file for the last one, have last
+ * been changed in REVISION.  REV_PROPS are the revision properties of
+ * REVISION.  REVISION is SVN_INVALID_REVNUM and REV_PROPS NULL for lines
+ * that predate the start of the blamed revision range.
+ *
+ * POOL is cleared between invocations.
+ */
+typedef svn_error_t *(*svn_repos__blame_receiver_t)(void *baton,
+                                                    apr_int64_t start_line,
+                                                    svn_revnum_t revision,
+                                                    apr_hash_t *rev_props,
+                                                    apr_pool_t *pool);
+
+/* Compute the blame information for the file PATH in REPOS at revision
+ * END, attributing changes made between START and END, and send it
+ * to RECEIVER with RECEIVER_BATON in line order.
+ *
+ * This performs the same calculations as svn_client_blame5() does with
+ * the output of svn_repos_get_file_revs2() but without merged revisions.
+ * DIFF_OPTIONS control how lines are compared.  Unless IGNORE_MIME_TYPE
+ * is set, return SVN_ERR_CLIENT_IS_BINARY_FILE if the file has a binary
+ * mime-type in any of the revisions.
+ *
+ * AUTHZ_READ_FUNC and AUTHZ_READ_BATON are used as in
+ * svn_repos_get_file_revs2().  Use POOL for all allocations.
+ */
+svn_error_t *
+svn_repos__get_file_blame(svn_repos_t *repos,
+                          const char *path,
+                          svn_revnum_t start,
+                          svn_revnum_t end,
+                          const svn_diff_file_options_t *diff_options,
+                          svn_boolean_t ignore_mime_type,
+                          svn_repos_authz_func_t authz_read_func,
+                          void *authz_read_baton,
+                          svn_repos__blame_receiver_t receiver,
+                          void *receiver_baton,
+                          apr_pool_t *pool);
+
+/* Create the log index of REPOS, or rebuild it from scratch if it
+ * exists, and set *YOUNGEST to the youngest revision it covers.
+ *
+ * The log index lists for every path the revisions in which it changed,
+ * which allows svn_repos_get_logs4() to skip the revisions in between.
+ * Once created, it gets updated by svn_repos_fs_commit_txn() and by
+ * loading dump streams.  Revisions committed otherwise get added by the
+ * next such commit; until then, log requests walk their history without
+ * the index.
+ *
+ * CANCEL_FUNC and CANCEL_BATON may be used to interrupt the operation;
+ * revisions indexed up to that point remain in the index.  Use
+ * SCRATCH_POOL for temporary allocations.
+ */
+svn_error_t *
+svn_repos__build_log_index(svn_revnum_t *youngest,
+                           svn_repos_t *repos,
+                           svn_cancel_func_t cancel_func,
+                           void *cancel_baton,
+                           apr_pool_t *scratch_pool);
+
+/* Create the mergeinfo index of REPOS, or rebuild it from scratch if it
+ * exists, and set *YOUNGEST to the youngest revision it covers.
+ *
+ * The mergeinfo index records the mergeinfo changes of every revision
+ * and the nodes that carry explicit mergeinfo, which allows
+ * svn_repos_get_logs4() with merged revisions and
+ * svn_repos_fs_get_mergeinfo() with descendants to avoid scanning the
+ * revisions and trees themselves.  It is maintained like the log index,
+ * see svn_repos__build_log_index().
+ *
+ * CANCEL_FUNC and CANCEL_BATON may be used to interrupt the operation.
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+svn_error_t *
+svn_repos__build_mergeinfo_index(svn_revnum_t *youngest,
+                                 svn_repos_t *repos,
+                                 svn_cancel_func_t cancel_func,
+                                 void *cancel_baton,
+                                 apr_pool_t *scratch_pool);
+
+/* Like svn_repos_begin_report2() but, while the editor is busy with one
+ * file, reconstruct the text deltas of the next files in the same
+ * directory in up to MAX_THREADS worker threads.  The editor is still
+ * driven from the thread calling svn_repos_finish_report() and receives
+ * exactly the same calls as without read-ahead.
+ *
+ * The worker threads read the repository through separate filesystem
+ * instances that will be opened with FS_CONFIG.
+ *
+ * File contents are sent synchronously if MAX_THREADS is less than 2,
+ * if TEXT_DELTAS is not set or if the cache configuration declares the
+ * application to be single-threaded.
+ */
+svn_error_t *
+svn_repos__begin_report_pipelined(void **report_baton,
+                                  svn_revnum_t revnum,
+                                  svn_repos_t *repos,
+                                  const char *fs_base,
+                                  const char *s_operand,
+                                  const char *switch_path,
+                                  svn_boolean_t text_deltas,
+                                  svn_depth_t depth,
+                                  svn_boolean_t ignore_ancestry,
+                                  svn_boolean_t send_copyfrom_args,
+                                  const svn_delta_editor_t *editor,
+                                  void *edit_baton,
+                                  svn_repos_authz_func_t authz_read_func,
+                                  void *authz_read_baton,
+                                  int max_threads,
+                                  apr_hash_t *fs_config,
+                                  apr_pool_t *pool);
+
+/* Like svn_repos_get_logs4() but determine the changed paths of the
+ * revisions to send, including the authz checks on them, in up to
+ * MAX_THREADS worker threads while earlier log entries are being sent.
+ * RECEIVER is still invoked from the calling thread and in exactly the
+ * same order as svn_repos_get_logs4() would.
+ *
+ * The worker threads read the repository through separate filesystem
+ * instances that will be opened with FS_CONFIG.  Unless AUTHZ_THREAD_SAFE
+ * is set, calls to AUTHZ_READ_FUNC will be serialized.
+ *
+ * Revisions are processed sequentially if MAX_THREADS is less than 2,
+ * if INCLUDE_MERGED_REVISIONS is set, if there are no changed paths to
+ * determine or if the cache configuration declares the application to be
+ * single-threaded.
+ */
+svn_error_t *
+svn_repos__get_logs_pipelined(svn_repos_t *repos,
+                              const apr_array_header_t *paths,
+                              svn_revnum_t start,
+                              svn_revnum_t end,
+                              int limit,
+                              svn_boolean_t discover_changed_paths,
+                              svn_boolean_t strict_node_history,
+                              svn_boolean_t include_merged_revisions,
+                              const apr_array_header_t *revprops,
+                              svn_repos_authz_func_t authz_read_func,
+                              void *authz_read_baton,
+                              svn_boolean_t authz_thread_safe,
+                              int max_threads,
+                              apr_hash_t *fs_config,
+                              svn_log_entry_receiver_t receiver,
+                              void *receiver_baton,
+                              apr_pool_t *pool);
+
+/* Like svn_repos_load_fs4() but parse DUMPSTREAM, reconstruct the texts
+ * that it contains as deltas and commit the revisions concurrently in up
+ * to MAX_THREADS threads.  The revisions are committed in the calling
+ * thread and exactly as svn_repos_load_fs4() would commit them, which is
+ * also where NOTIFY_FUNC and CANCEL_FUNC get invoked.
+ *
+ * The worker threads read the repository through separate filesystem
+ * instances that will be opened with FS_CONFIG.
+ *
+ * The dump stream is loaded sequentially if MAX_THREADS is less than 2
+ * or if the cache configuration declares the application to be
+ * single-threaded.
+ */
+svn_error_t *
+svn_repos__load_fs_pipelined(svn_repos_t *repos,
+                             svn_stream_t *dumpstream,
+                             svn_revnum_t start_rev,
+                             svn_revnum_t end_rev,
+                             enum svn_repos_load_uuid uuid_action,
+                             const char *parent_dir,
+                             svn_boolean_t use_pre_commit_hook,
+                             svn_boolean_t use_post_commit_hook,
+                             svn_boolean_t validate_props,
+                             int max_threads,
+                             apr_hash_t *fs_config,
+                             svn_repos_notify_func_t notify_func,
+                             void *notify_baton,
+                             svn_cancel_func_t cancel_func,
+                             void *cancel_baton,
+                             apr_pool_t *pool);
+
+/* The dumpfile format version of dumps that may contain chunked text
+ * content, see svn_repos__dump_fs_parallel().
+ */
+#define SVN_REPOS__DUMPFILE_FORMAT_VERSION_CHUNKED 4
+
+/* A node record header that replaces Text-content-length if its value is
+ * "true".  The text content then consists of chunks, each of which is a
+ * line with the length of the chunk in decimal followed by that many
+ * bytes of data, and ends with a chunk of length 0.  Such records have
+ * no Content-length header.
+ */
+#define SVN_REPOS__DUMPFILE_TEXT_CONTENT_CHUNKED "Text-content-chunked"
+
+/* Like svn_repos_dump_fs3() but split the revisions START_REV through
+ * END_REV into STREAMS->NELTS contiguous ranges, in ascending order, and
+ * dump them concurrently in up to MAX_THREADS worker threads.  The N-th
+ * range will be written to the N-th svn_stream_t * in STREAMS.
+ *
+ * Every stream receives a complete dump with its own dumpfile header.
+ * All but the first one are incremental, so the contents of all streams
+ * concatenated in order load exactly like the output of
+ * svn_repos_dump_fs3() for the whole range.  The same stream may be
+ * given several times, in which case it receives that concatenation.
+ *
+ * The worker threads read the repository through separate filesystem
+ * instances that will be opened with FS_CONFIG, and buffer their output
+ * in memory or temporary files until it gets written to STREAMS in the
+ * calling thread.  NOTIFY_FUNC will be invoked from the calling thread
+ * and in the same order as for svn_repos_dump_fs3().  CANCEL_FUNC will
+ * also be invoked from the worker threads.
+ *
+ * Deltas are buffered in memory, or in temporary files if they are large.
+ * If USE_DELTAS and CHUNKED_TEXTS are set, the deltas of large files will
+ * instead be written directly as chunked text content, which requires
+ * dumpfile format version #SVN_REPOS__DUMPFILE_FORMAT_VERSION_CHUNKED.
+ *
+ * The ranges are dumped sequentially if MAX_THREADS is less than 2 or if
+ * the cache configuration declares the application to be single-threaded.
+ */
+svn_error_t *
+svn_repos__dump_fs_parallel(svn_repos_t *repos,
+                            const apr_array_header_t *streams,
+                            svn_revnum_t start_rev,
+                            svn_revnum_t end_rev,
+                            svn_boolean_t incremental,
+                            svn_boolean_t use_deltas,
+                            svn_boolean_t chunked_texts,
+                            int max_threads,
+                            apr_hash_t *fs_config,
+                            svn_repos_notify_func_t notify_func,
+                            void *notify_baton,
+                            svn_cancel_func_t cancel_func,
+                            void *cancel_baton,
+                            apr_pool_t *pool);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -0,0 +1,115 @@
+/**
+ * @copyright
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ * @endcopyright
+ *
+ * @file svn_thread_pool.h
+ * @brief A bounded pool of worker threads for background tasks
+ */
+
+#ifndef SVN_THREAD_POOL_H
+#define SVN_THREAD_POOL_H
+
+#include <apr_pools.h>
+
+#include "svn_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * A set of at most N worker threads that execute tasks submitted by a
+ * single controlling thread.  Tasks are started in the order they were
+ * submitted.  The controlling thread collects the results by waiting
+ * for individual jobs, typically in submission order, which keeps any
+ * output that depends on them deterministic.
+ *
+ * If APR has no thread support or the pool has been created with a
+ * limit of less than two threads, every task will be executed
+ * synchronously from within @ref svn_thread_pool__submit.  Callers
+ * therefore need no special code path for the single-threaded case.
+ *
+ * Tasks must not access any state that is used by the controlling
+ * thread (e.g. working copy or RA session objects) while they run.
+ */
+typedef struct svn_thread_pool__t svn_thread_pool__t;
+
+/** A task submitted to a @ref svn_thread_pool__t. */
+typedef struct svn_thread_pool__job_t svn_thread_pool__job_t;
+
+/** The function to execute for a job.  @a baton is the value passed to
+ * @ref svn_thread_pool__submit.  Any data to be handed back to the
+ * controlling thread must be allocated in @a result_pool, which is owned
+ * by the job and remains valid until the job gets destroyed.  Use
+ * @a scratch_pool for temporary allocations.
+ */
+typedef svn_error_t *(*svn_thread_pool__task_t)(void *baton,
+                                                apr_pool_t *result_pool,
+                                                apr_pool_t *scratch_pool);
+
+/** Create a new thread pool in @a *thread_pool that will use at most
+ * @a max_threads worker threads.  Threads will be started on demand.
+ * All threads will be joined when @a result_pool gets cleaned up; tasks
+ * that are still queued at that time will be run to completion first.
+ */
+svn_error_t *
+svn_thread_pool__create(svn_thread_pool__t **thread_pool,
+                        int max_threads,
+                        apr_pool_t *result_pool);
+
+/** Return TRUE if tasks submitted to @a thread_pool may actually be run
+ * concurrently to the controlling thread.
+ */
+svn_boolean_t
+svn_thread_pool__is_parallel(svn_thread_pool__t *thread_pool);
+
+/** Queue @a task with @a baton for execution in @a thread_pool and return
+ * the job handle in @a *job.  The job will be destroyed, waiting for the
+ * task to finish if necessary, when @a result_pool gets cleaned up or when
+ * @ref svn_thread_pool__job_destroy is called.
+ *
+ * This function must only be called from the controlling thread.
+ */
+svn_error_t *
+svn_thread_pool__submit(svn_thread_pool__job_t **job,
+                        svn_thread_pool__t *thread_pool,
+                        svn_thread_pool__task_t task,
+                        void *baton,
+                        apr_pool_t *result_pool);
+
+/** Block until @a job has been executed and return the error returned by
+ * its task.  The error will be returned only once; subsequent calls will
+ * return @c SVN_NO_ERROR.
+ */
+svn_error_t *
+svn_thread_pool__wait(svn_thread_pool__job_t *job);
+
+/** Wait for @a job to finish, clear any error it may have returned and
+ * release all resources associated with it.
+ */
+void
+svn_thread_pool__job_destroy(svn_thread_pool__job_t *job);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* SVN_THREAD_POOL_H */
@@ -1691,6 +1691,109 @@ svn_wc__resolve_conflicts(svn_wc_context_t *wc_ctx,
                           void *notify_baton,
                           apr_pool_t *scratch_pool);
 
+/**
+ * A three-way text merge that is performed outside of the working copy
+ * database, so that it may be run on a different thread than the one
+ * that uses the working copy context.
+ *
+ * The typical sequence is svn_wc__premerge_prepare(), then
+ * svn_wc__premerge_run() on some worker thread and finally
+ * svn_wc__merge_premerged() from the thread that owns the working copy
+ * context again.
+ *
+ * @since New in 1.8.
+ */
+typedef struct svn_wc__premerge_t svn_wc__premerge_t;
+
+/**
+ * Check whether the text merge that svn_wc_merge5() would perform for
+ * @a target_abspath can be done without accessing the working copy
+ * database.  This is the case for versioned text files that need no
+ * translation and whose translation is not being changed by @a prop_diff.
+ *
+ * If so, set @a *premerge to a new premerge object allocated in
+ * @a result_pool.  Otherwise, set @a *premerge to @c NULL.
+ *
+ * @a left_label, @a right_label, @a target_label and @a merge_options
+ * have the same meaning as for svn_wc_merge5().  The internal diff3
+ * implementation will always be used.  @a target_abspath and
+ * @a merge_options must remain unchanged until svn_wc__merge_premerged()
+ * has returned.
+ *
+ * Use @a scratch_pool for temporary allocations.
+ *
+ * @since New in 1.8.
+ */
+svn_error_t *
+svn_wc__premerge_prepare(svn_wc__premerge_t **premerge,
+                         svn_wc_context_t *wc_ctx,
+                         const char *target_abspath,
+                         const char *left_label,
+                         const char *right_label,
+                         const char *target_label,
+                         const apr_array_header_t *merge_options,
+                         const apr_array_header_t *prop_diff,
+                         apr_pool_t *result_pool,
+                         apr_pool_t *scratch_pool);
+
+/**
+ * Merge the differences between @a left_abspath and @a right_abspath
+ * into the target of @a premerge and store the result in a temporary
+ * file in the working copy's administrative area.  The working file
+ * itself remains unchanged.
+ *
+ * This function does not access the working copy database and may be
+ * called from any thread.  Any data that @a premerge will refer to
+ * afterwards gets allocated in @a result_pool.  Use @a scratch_pool for
+ * temporary allocations.
+ *
+ * @since New in 1.8.
+ */
+svn_error_t *
+svn_wc__premerge_run(svn_wc__premerge_t *premerge,
+                     const char *left_abspath,
+                     const char *right_abspath,
+                     svn_cancel_func_t cancel_func,
+                     void *cancel_baton,
+                     apr_pool_t *result_pool,
+                     apr_pool_t *scratch_pool);
+
+/**
+ * Same as svn_wc_merge5() but if @a premerge is not @c NULL, take the
+ * merged text from it instead of merging the files again.  @a premerge
+ * must have been created for the same target and labels and
+ * svn_wc__premerge_run() must have completed successfully on it for
+ * @a left_abspath and @a right_abspath.
+ *
+ * The temporary file created by svn_wc__premerge_run() will be removed
+ * by this function in any case.
+ *
+ * @since New in 1.8.
+ */
+svn_error_t *
+svn_wc__merge_premerged(enum svn_wc_merge_outcome_t *merge_content_outcome,
+                        enum svn_wc_notify_state_t *merge_props_outcome,
+                        svn_wc_context_t *wc_ctx,
+                        svn_wc__premerge_t *premerge,
+                        const char *left_abspath,
+                        const char *right_abspath,
+                        const char *target_abspath,
+                        const char *left_label,
+                        const char *right_label,
+                        const char *target_label,
+                        const svn_wc_conflict_version_t *left_version,
+                        const svn_wc_conflict_version_t *right_version,
+                        svn_boolean_t dry_run,
+                        const char *diff3_cmd,
+                        const apr_array_header_t *merge_options,
+                        apr_hash_t *original_props,
+                        const apr_array_header_t *prop_diff,
+                        svn_wc_conflict_resolver_func2_t conflict_func,
+                        void *conflict_baton,
+                        svn_cancel_func_t cancel_func,
+                        void *cancel_baton,
+                        apr_pool_t *scratch_pool);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -985,6 +985,75 @@ svn_ra_get_file(svn_ra_session_t *session,
                 apr_hash_t **props,
                 apr_pool_t *pool);
 
+/**
+ * A file to be fetched by svn_ra_get_files().
+ *
+ * @since New in 1.8.
+ */
+typedef struct svn_ra_file_request_t
+{
+  /** The path of the file, relative to the session URL. */
+  const char *path;
+
+  /** The revision to fetch the file from, or #SVN_INVALID_REVNUM for
+   * the HEAD revision. */
+  svn_revnum_t revision;
+} svn_ra_file_request_t;
+
+/**
+ * The callback invoked by svn_ra_get_files() for each file before its
+ * contents get transferred.
+ *
+ * @a request is the element of the request array that the file was asked
+ * for with, and @a fetched_rev the revision that it has been fetched
+ * from.  If properties were requested, @a props contains the file's
+ * properties in the same form as for svn_ra_get_file(); otherwise it is
+ * @c NULL.
+ *
+ * If contents were requested, set @a *stream to the stream to push them
+ * to, or to @c NULL to discard them.  The stream will not be closed.
+ *
+ * @a pool will be cleared once the file has been processed.  Like the
+ * stream handlers of svn_ra_get_file(), this function may not perform any
+ * RA operations using the session.
+ *
+ * @since New in 1.8.
+ */
+typedef svn_error_t *(*svn_ra_file_handler_t)(
+  void *baton,
+  svn_stream_t **stream,
+  const svn_ra_file_request_t *request,
+  svn_revnum_t fetched_rev,
+  apr_hash_t *props,
+  apr_pool_t *pool);
+
+/**
+ * Fetch several files in one operation.  @a requests is an array of
+ * <tt>const svn_ra_file_request_t *</tt> describing the files.
+ *
+ * For each file, in the order of @a requests, invoke @a handler with
+ * @a handler_baton and then push the file's contents to the stream that
+ * it returned.  Send the properties of the files to @a handler if
+ * @a want_props is TRUE, and their contents if @a want_contents is TRUE.
+ *
+ * If a file cannot be fetched, return an error without processing the
+ * remaining ones.
+ *
+ * Servers that support it send all files in a single response.  With
+ * other servers, this is equivalent to calling svn_ra_get_file() for
+ * every file.  Use @a pool for temporary allocations.
+ *
+ * @since New in 1.8.
+ */
+svn_error_t *
+svn_ra_get_files(svn_ra_session_t *session,
+                 const apr_array_header_t *requests,
+                 svn_boolean_t want_props,
+                 svn_boolean_t want_contents,
+                 svn_ra_file_handler_t handler,
+                 void *handler_baton,
+                 apr_pool_t *pool);
+
 /**
  * If @a dirents is non @c NULL, set @a *dirents to contain all the entries
  * of directory @a path at @a revision.  The keys of @a dirents will be
@@ -62,6 +62,14 @@ extern "C" {
 #define SVN_RA_SVN_CAP_PARTIAL_REPLAY "partial-replay"
 /* maps to SVN_RA_CAPABILITY_ATOMIC_REVPROPS */
 #define SVN_RA_SVN_CAP_ATOMIC_REVPROPS "atomic-revprops"
+/* server computes blame information (get-file-blame command) */
+#define SVN_RA_SVN_CAP_FILE_BLAME "file-blame"
+/* all data after the handshake is sent through a zlib stream */
+#define SVN_RA_SVN_CAP_ZLIB_STREAM "zlib-stream"
+/* update may be asked to leave out file contents */
+#define SVN_RA_SVN_CAP_TEXTLESS_UPDATE "textless-update"
+/* server sends several files in one response (get-files command) */
+#define SVN_RA_SVN_CAP_GET_FILES "get-files"
 
 /** ra_svn passes @c svn_dirent_t fields over the wire as a list of
  * words, these are the values used to represent each field.
@@ -166,6 +174,103 @@ svn_error_t *
 svn_ra_svn__set_shim_callbacks(svn_ra_svn_conn_t *conn,
                                svn_delta_shim_callbacks_t *shim_callbacks);
 
+/**
+ * Return TRUE if @a conn has already received input that has not been
+ * consumed yet, i.e. if reading the next command may not require
+ * waiting for the underlying socket to become readable.
+ *
+ * @note This is a private API, external consumers should not use it.
+ */
+svn_boolean_t
+svn_ra_svn__data_available(svn_ra_svn_conn_t *conn);
+
+/**
+ * Set @a *bytes_read and @a *bytes_written to the number of bytes that
+ * have been read from and written to @a conn so far.  Data that has
+ * been received but not parsed yet is not included, while data that has
+ * been written but not flushed yet is.
+ *
+ * @note This is a private API, external consumers should not use it.
+ */
+void
+svn_ra_svn__get_transfer_counts(apr_uint64_t *bytes_read,
+                                apr_uint64_t *bytes_written,
+                                svn_ra_svn_conn_t *conn);
+
+/**
+ * Read a string item from @a conn and write its contents to @a stream,
+ * unless that is @c NULL, and set @a *len to its length.  Unlike
+ * svn_ra_svn_read_item(), this passes the data on in pieces straight
+ * from @a conn's read buffer instead of copying the whole string into
+ * pool memory first.  Use @a pool for temporary allocations.
+ *
+ * The data may be delivered in any number of pieces.  If writing to
+ * @a stream fails, @a conn is left in the middle of the string.
+ *
+ * @note This is a private API, external consumers should not use it.
+ */
+svn_error_t *
+svn_ra_svn__read_string_to_stream(svn_ra_svn_conn_t *conn,
+                                  apr_pool_t *pool,
+                                  svn_stream_t *stream,
+                                  apr_uint64_t *len);
+
+/**
+ * Read the opening parenthesis of a list from @a conn, so that its items
+ * can be read one by one.  Use @a pool for temporary allocations.
+ *
+ * @note This is a private API, external consumers should not use it.
+ */
+svn_error_t *
+svn_ra_svn__read_list_start(svn_ra_svn_conn_t *conn,
+                            apr_pool_t *pool);
+
+/**
+ * Skip the remaining items of a list that has been started with
+ * svn_ra_svn__read_list_start() and read its closing parenthesis from
+ * @a conn.  Use @a pool for temporary allocations.
+ *
+ * @note This is a private API, external consumers should not use it.
+ */
+svn_error_t *
+svn_ra_svn__read_list_end(svn_ra_svn_conn_t *conn,
+                          apr_pool_t *pool);
+
+/**
+ * Compress all further data sent and expect all further data received
+ * on @a conn to be compressed, as negotiated through the
+ * #SVN_RA_SVN_CAP_ZLIB_STREAM capability.  Outgoing data gets compressed
+ * with @a conn's compression level.  Use @a pool for temporary
+ * allocations.
+ *
+ * Both peers must call this at the same point of the protocol exchange:
+ * any data that has been sent or received up to here is uncompressed.
+ *
+ * @note This is a private API, external consumers should not use it.
+ */
+svn_error_t *
+svn_ra_svn__enable_stream_compression(svn_ra_svn_conn_t *conn,
+                                      apr_pool_t *pool);
+
+/**
+ * Return TRUE if svn_ra_svn__enable_stream_compression() has been called
+ * for @a conn.  Such connections don't need to compress the data they
+ * send any further.
+ *
+ * @note This is a private API, external consumers should not use it.
+ */
+svn_boolean_t
+svn_ra_svn__stream_compression_enabled(svn_ra_svn_conn_t *conn);
+
+/**
+ * Return TRUE if a SASL security layer encrypts the data sent and
+ * received on @a conn.
+ *
+ * @note This is a private API, external consumers should not use it.
+ */
+svn_boolean_t
+svn_ra_svn__is_encrypted(svn_ra_svn_conn_t *conn);
+
 /** Initialize a connection structure for the given socket or
  * input/output files.
  *
@@ -434,6 +539,52 @@ svn_ra_svn_handle_commands2(svn_ra_svn_conn_t *conn,
                             void *baton,
                             svn_boolean_t error_on_disconnect);
 
+/**
+ * Information about a command processed by svn_ra_svn__handle_command().
+ *
+ * @note This is a private API, external consumers should not use it.
+ */
+typedef struct svn_ra_svn__command_info_t
+{
+  /** If not @c NULL, to be called with @a start_baton and the command
+   * name once the command has been read, right before its handler gets
+   * invoked.  Set by the caller. */
+  svn_error_t *(*start_func)(void *start_baton, const char *cmdname);
+
+  /** Baton for @a start_func.  Set by the caller. */
+  void *start_baton;
+
+  /** The name of the command as sent by the peer. */
+  const char *cmdname;
+
+  /** Whether a command failure has been sent back to the peer. */
+  svn_boolean_t failed;
+} svn_ra_svn__command_info_t;
+
+/**
+ * Read a single command from @a conn and handle it like
+ * svn_ra_svn_handle_commands2() would, looking up its handler in
+ * @a cmd_hash, which maps command names to <tt>const
+ * svn_ra_svn_cmd_entry_t *</tt>.  Set @a *terminate if the command was
+ * a terminating one or, unless @a error_on_disconnect is set, if the
+ * connection has been closed.  Use @a pool for the command handler.
+ *
+ * If @a info is not @c NULL, call its @a start_func and fill in the
+ * remaining members once the command has been read.  The command name
+ * will be allocated in @a pool.  If the connection ended before a
+ * command could be read, @a info remains untouched.
+ *
+ * @note This is a private API, external consumers should not use it.
+ */
+svn_error_t *
+svn_ra_svn__handle_command(svn_boolean_t *terminate,
+                           svn_ra_svn__command_info_t *info,
+                           apr_hash_t *cmd_hash,
+                           void *baton,
+                           svn_ra_svn_conn_t *conn,
+                           svn_boolean_t error_on_disconnect,
+                           apr_pool_t *pool);
+
 /** Similar to svn_ra_svn_handle_commands2 but @a error_on_disconnect
  * is always @c FALSE.
  *
@@ -37,6 +37,9 @@
 #include "svn_sorts.h"
 
 #include "private/svn_wc_private.h"
+#include "private/svn_ra_private.h"
+#include "private/svn_cache.h"
+#include "private/svn_skel.h"
 
 #include "svn_private_config.h"
 
@@ -69,7 +72,7 @@ struct blame_chain
 
 /* The baton use for the diff output routine. */
 struct diff_baton {
-  struct blame_chain *chain;
+  struct blame_cursor *cursor;
   struct rev *rev;
 };
 
@@ -99,6 +102,18 @@ struct file_rev_baton {
   /* pools for files which may need to persist for more than one rev. */
   apr_pool_t *filepool;
   apr_pool_t *prevfilepool;
+
+  /* Set if CHAIN has been taken from the blame cache.  The next revision
+     received will then be the base revision for the cached blame. */
+  svn_boolean_t resume_pending;
+  /* The revision that the base revision for the cached blame must be. */
+  svn_revnum_t cache_base_rev;
+  /* Set if the base revision received was not CACHE_BASE_REV.  All
+     further revisions will be ignored. */
+  svn_boolean_t cache_mismatch;
+  /* The last revision of the file, not counting merged revisions, that
+     has been received. */
+  svn_revnum_t last_revnum;
 };
 
 /* The baton used by the txdelta window handler. */
@@ -109,6 +124,8 @@ struct delta_baton {
   struct file_rev_baton *file_rev_baton;
   svn_stream_t *source_stream;  /* the delta source */
   const char *filename;
+  /* Set if FILENAME has the contents that the cached blame applies to. */
+  svn_boolean_t is_cache_base;
 };
 
 
@@ -144,42 +161,104 @@ blame_destroy(struct blame_chain *chain,
   chain->avail = blame;
 }
 
-/* Return the blame chunk that contains token OFF, starting the search at
-   BLAME. */
+/* A position in a blame chain, used while applying the hunks of a single
+   diff.  svn_diff_output() reports the hunks in ascending order, so every
+   search can start where the previous one ended.  Likewise, shifting the
+   start offsets of all chunks behind a hunk is deferred until the cursor
+   passes them.  Together, this keeps the cost of a diff linear in the
+   number of chunks rather than proportional to chunks times hunks.
+
+   All chunks before UNADJUSTED have their final start offset.  The start
+   offsets of UNADJUSTED and all chunks behind it still need to be shifted
+   by ADJUST tokens. */
+struct blame_cursor
+{
+  struct blame_chain *chain;
+  struct blame *pos;          /* search start; NULL for the chain head */
+  struct blame *unadjusted;   /* first chunk with a pending shift */
+  apr_off_t adjust;           /* the pending shift */
+};
+
+/* Initialize CURSOR to the beginning of CHAIN. */
+static void
+blame_cursor_init(struct blame_cursor *cursor,
+                  struct blame_chain *chain)
+{
+  cursor->chain = chain;
+  cursor->pos = NULL;
+  cursor->unadjusted = chain->blame;
+  cursor->adjust = 0;
+}
+
+/* Apply the pending shift of CURSOR to BLAME if BLAME is the first chunk
+   that still has it, and return BLAME. */
+static struct blame *
+blame_cursor_visit(struct blame_cursor *cursor,
+                   struct blame *blame)
+{
+  if (blame && blame == cursor->unadjusted)
+    {
+      blame->start += cursor->adjust;
+      cursor->unadjusted = blame->next;
+    }
+  return blame;
+}
+
+/* Return the blame chunk that contains token OFF.  OFF must not be smaller
+   than the offset of any previous search using CURSOR. */
 static struct blame *
-blame_find(struct blame *blame, apr_off_t off)
+blame_find(struct blame_cursor *cursor, apr_off_t off)
 {
-  struct blame *prev = NULL;
+  struct blame *prev = cursor->pos;
+  struct blame *blame;
+
+  blame = blame_cursor_visit(cursor, prev ? prev->next
+                                          : cursor->chain->blame);
   while (blame)
     {
       if (blame->start > off) break;
       prev = blame;
-      blame = blame->next;
+      blame = blame_cursor_visit(cursor, blame->next);
     }
   return prev;
 }
 
 /* Shift the start-point of BLAME and all subsequence blame-chunks
-   by ADJUST tokens */
+   by ADJUST tokens.  All chunks up to BLAME must have been visited
+   by CURSOR. */
 static void
-blame_adjust(struct blame *blame, apr_off_t adjust)
+blame_adjust(struct blame_cursor *cursor,
+             struct blame *blame,
+             apr_off_t adjust)
 {
-  while (blame)
+  /* Only the few chunks that the cursor has already looked ahead at need
+     to be updated right away. */
+  while (blame && blame != cursor->unadjusted)
     {
       blame->start += adjust;
       blame = blame->next;
     }
+  cursor->adjust += adjust;
+}
+
+/* Apply all pending shifts of CURSOR to the chain. */
+static void
+blame_cursor_finish(struct blame_cursor *cursor)
+{
+  while (cursor->unadjusted)
+    blame_cursor_visit(cursor, cursor->unadjusted);
 }
 
 /* Delete the blame associated with the region from token START to
    START + LENGTH */
 static svn_error_t *
-blame_delete_range(struct blame_chain *chain,
+blame_delete_range(struct blame_cursor *cursor,
                    apr_off_t start,
                    apr_off_t length)
 {
-  struct blame *first = blame_find(chain->blame, start);
-  struct blame *last = blame_find(chain->blame, start + length);
+  struct blame_chain *chain = cursor->chain;
+  struct blame *first = blame_find(cursor, start);
+  struct blame *last = blame_find(cursor, start + length);
   struct blame *tail = last->next;
 
   if (first != last)
@@ -208,7 +287,9 @@ blame_delete_range(struct blame_chain *chain,
       tail = last->next;
     }
 
-  blame_adjust(tail, -length);
+  /* FIRST survives all of the above and precedes any later hunk. */
+  cursor->pos = first;
+  blame_adjust(cursor, tail, -length);
 
   return SVN_NO_ERROR;
 }
@@ -216,13 +297,13 @@ blame_delete_range(struct blame_chain *chain,
 /* Insert a chunk of blame associated with REV starting
    at token START and continuing for LENGTH tokens */
 static svn_error_t *
-blame_insert_range(struct blame_chain *chain,
+blame_insert_range(struct blame_cursor *cursor,
                    struct rev *rev,
                    apr_off_t start,
                    apr_off_t length)
 {
-  struct blame *head = chain->blame;
-  struct blame *point = blame_find(head, start);
+  struct blame_chain *chain = cursor->chain;
+  struct blame *point = blame_find(cursor, start);
   struct blame *insert;
 
   if (point->start == start)
@@ -241,7 +322,9 @@ blame_insert_range(struct blame_chain *chain,
       insert->next = point->next;
       point->next = middle;
     }
-  blame_adjust(insert->next, length);
+
+  cursor->pos = insert;
+  blame_adjust(cursor, insert->next, length);
 
   return SVN_NO_ERROR;
 }
@@ -259,10 +342,10 @@ output_diff_modified(void *baton,
   struct diff_baton *db = baton;
 
   if (original_length)
-    SVN_ERR(blame_delete_range(db->chain, modified_start, original_length));
+    SVN_ERR(blame_delete_range(db->cursor, modified_start, original_length));
 
   if (modified_length)
-    SVN_ERR(blame_insert_range(db->chain, db->rev, modified_start,
+    SVN_ERR(blame_insert_range(db->cursor, db->rev, modified_start,
                                modified_length));
 
   return SVN_NO_ERROR;
@@ -293,14 +376,17 @@ add_file_blame(const char *last_file,
     {
       svn_diff_t *diff;
       struct diff_baton diff_baton;
+      struct blame_cursor cursor;
 
-      diff_baton.chain = chain;
+      blame_cursor_init(&cursor, chain);
+      diff_baton.cursor = &cursor;
       diff_baton.rev = rev;
 
       /* We have a previous file.  Get the diff and adjust blame info. */
       SVN_ERR(svn_diff_file_diff_2(&diff, last_file, cur_file,
                                    diff_options, pool));
       SVN_ERR(svn_diff_output(diff, &diff_baton, &output_fns));
+      blame_cursor_finish(&cursor);
     }
 
   return SVN_NO_ERROR;
@@ -334,10 +420,12 @@ window_handler(svn_txdelta_window_t *window, void *baton)
   else
     chain = frb->chain;
 
-  /* Process this file. */
-  SVN_ERR(add_file_blame(frb->last_filename,
-                         dbaton->filename, chain, frb->rev,
-                         frb->diff_options, frb->currpool));
+  /* Process this file.  The cached blame already covers the contents
+     of the base revision. */
+  if (! dbaton->is_cache_base)
+    SVN_ERR(add_file_blame(frb->last_filename,
+                           dbaton->filename, chain, frb->rev,
+                           frb->diff_options, frb->currpool));
 
   /* If we are including merged revisions, and the current revision is not a
      merged one, we need to add its blame info to the chain for the original
@@ -398,6 +486,31 @@ check_mimetype(const apr_array_header_t *prop_diffs, const char *target,
   return SVN_NO_ERROR;
 }
 
+/* Tell FRB's notification function that REVNUM of the file at the
+   repository path PATH, with the revision properties REV_PROPS, is being
+   blamed.  Use POOL for temporary allocations. */
+static void
+notify_blame_revision(struct file_rev_baton *frb,
+                      const char *path,
+                      svn_revnum_t revnum,
+                      apr_hash_t *rev_props,
+                      apr_pool_t *pool)
+{
+  svn_wc_notify_t *notify
+        = svn_wc_create_notify_url(
+                        svn_path_url_add_component2(frb->repos_root_url,
+                                                    path+1, pool),
+                        svn_wc_notify_blame_revision, pool);
+
+  notify->path = path;
+  notify->kind = svn_node_none;
+  notify->content_state = notify->prop_state
+    = svn_wc_notify_state_inapplicable;
+  notify->lock_state = svn_wc_notify_lock_state_inapplicable;
+  notify->revision = revnum;
+  notify->rev_props = rev_props;
+  frb->ctx->notify_func2(frb->ctx->notify_baton2, notify, pool);
+}
 
 static svn_error_t *
 file_rev_handler(void *baton, const char *path, svn_revnum_t revnum,
@@ -413,30 +526,33 @@ file_rev_handler(void *baton, const char *path, svn_revnum_t revnum,
   svn_stream_t *cur_stream;
   struct delta_baton *delta_baton;
   apr_pool_t *filepool;
+  svn_boolean_t is_cache_base = frb->resume_pending;
+
+  if (frb->cache_mismatch)
+    return SVN_NO_ERROR;
+
+  /* If the node that we blame has been replaced by a copy of an older
+     revision of itself, for instance, the cached blame does not belong
+     to its line of history.  Throw it away. */
+  if (is_cache_base && revnum != frb->cache_base_rev)
+    {
+      frb->resume_pending = FALSE;
+      frb->cache_mismatch = TRUE;
+      return SVN_NO_ERROR;
+    }
 
   /* Clear the current pool. */
   svn_pool_clear(frb->currpool);
+  frb->resume_pending = FALSE;
+  if (! merged_revision)
+    frb->last_revnum = revnum;
 
   /* If this file has a non-textual mime-type, bail out. */
   if (! frb->ignore_mime_type)
     SVN_ERR(check_mimetype(prop_diffs, frb->target, frb->currpool));
 
   if (frb->ctx->notify_func2)
-    {
-      svn_wc_notify_t *notify
-            = svn_wc_create_notify_url(
-                            svn_path_url_add_component2(frb->repos_root_url,
-                                                        path+1, pool),
-                            svn_wc_notify_blame_revision, pool);
-      notify->path = path;
-      notify->kind = svn_node_none;
-      notify->content_state = notify->prop_state
-        = svn_wc_notify_state_inapplicable;
-      notify->lock_state = svn_wc_notify_lock_state_inapplicable;
-      notify->revision = revnum;
-      notify->rev_props = rev_props;
-      frb->ctx->notify_func2(frb->ctx->notify_baton2, notify, pool);
-    }
+    notify_blame_revision(frb, path, revnum, rev_props, pool);
 
   if (frb->ctx->cancel_func)
     SVN_ERR(frb->ctx->cancel_func(frb->ctx->cancel_baton));
@@ -454,9 +570,11 @@ file_rev_handler(void *baton, const char *path, svn_revnum_t revnum,
 
   /* Create delta baton. */
   delta_baton = apr_palloc(frb->currpool, sizeof(*delta_baton));
+  delta_baton->is_cache_base = is_cache_base;
 
-  /* Prepare the text delta window handler. */
-  if (frb->last_filename)
+  /* Prepare the text delta window handler.  The first revision we
+     receive is always sent as a delta against the empty file. */
+  if (frb->last_filename && ! is_cache_base)
     SVN_ERR(svn_stream_open_readonly(&delta_baton->source_stream, frb->last_filename,
                                      frb->currpool, pool));
   else
@@ -484,6 +602,10 @@ file_rev_handler(void *baton, const char *path, svn_revnum_t revnum,
   *content_delta_handler = window_handler;
   *content_delta_baton = delta_baton;
 
+  /* No blame will be assigned to the cache base revision. */
+  if (is_cache_base)
+    return SVN_NO_ERROR;
+
   /* Create the rev structure. */
   frb->rev = apr_pcalloc(frb->mainpool, sizeof(struct rev));
 
@@ -577,6 +699,417 @@ normalize_blames(struct blame_chain *chain,
     }
 }
 
+/*** The blame cache ***/
+
+/* Blaming the same file at ever newer revisions is a common pattern,
+   e.g. for IDEs that show blame information for the files being edited.
+   Therefore, we keep the blame chain of recent blame runs in the
+   process-wide membuffer cache.  A later blame of the same file with
+   the same options only needs to process the revisions that have been
+   committed since the cached run.
+
+   Revision properties are cached together with the blame chunks and
+   will not reflect later changes to them. */
+
+/* A blame chain as stored in the blame cache. */
+typedef struct blame_cache_entry_t
+{
+  /* The repository revision that BLAME applies to. */
+  svn_revnum_t end_rev;
+
+  /* The revision in which the file was last changed as of END_REV.
+     Resuming the blame at END_REV must start with that revision. */
+  svn_revnum_t created_rev;
+
+  /* The blame chunks. */
+  struct blame *blame;
+} blame_cache_entry_t;
+
+/* Implements svn_cache__serialize_func_t for blame_cache_entry_t. */
+static svn_error_t *
+serialize_blame_entry(void **data,
+                      apr_size_t *data_len,
+                      void *in,
+                      apr_pool_t *pool)
+{
+  blame_cache_entry_t *entry = in;
+  apr_array_header_t *chunks = apr_array_make(pool, 16,
+                                              sizeof(struct blame *));
+  apr_array_header_t *revs = apr_array_make(pool, 16, sizeof(struct rev *));
+  apr_hash_t *rev_indexes = apr_hash_make(pool);
+  svn_skel_t *skel = svn_skel__make_empty_list(pool);
+  svn_skel_t *revs_skel = svn_skel__make_empty_list(pool);
+  svn_skel_t *chunks_skel = svn_skel__make_empty_list(pool);
+  svn_stringbuf_t *buf;
+  struct blame *walk;
+  int i;
+
+  /* Number the revisions in the order of their first appearance. */
+  for (walk = entry->blame; walk; walk = walk->next)
+    {
+      APR_ARRAY_PUSH(chunks, struct blame *) = walk;
+      if (! apr_hash_get(rev_indexes, &walk->rev, sizeof(walk->rev)))
+        {
+          int *index = apr_palloc(pool, sizeof(*index));
+
+          *index = revs->nelts;
+          apr_hash_set(rev_indexes, &walk->rev, sizeof(walk->rev), index);
+          APR_ARRAY_PUSH(revs, struct rev *) = walk->rev;
+        }
+    }
+
+  /* Skels are built back to front. */
+  for (i = revs->nelts - 1; i >= 0; i--)
+    {
+      struct rev *rev = APR_ARRAY_IDX(revs, i, struct rev *);
+      svn_skel_t *props_skel;
+
+      SVN_ERR(svn_skel__unparse_proplist(&props_skel, rev->rev_props, pool));
+      svn_skel__prepend(props_skel, revs_skel);
+      svn_skel__prepend_int(rev->revision, revs_skel, pool);
+    }
+
+  for (i = chunks->nelts - 1; i >= 0; i--)
+    {
+      struct blame *chunk = APR_ARRAY_IDX(chunks, i, struct blame *);
+      int *index = apr_hash_get(rev_indexes, &chunk->rev, sizeof(chunk->rev));
+
+      svn_skel__prepend_int(chunk->start, chunks_skel, pool);
+      svn_skel__prepend_int(*index, chunks_skel, pool);
+    }
+
+  svn_skel__prepend(chunks_skel, skel);
+  svn_skel__prepend(revs_skel, skel);
+  svn_skel__prepend_int(entry->created_rev, skel, pool);
+  svn_skel__prepend_int(entry->end_rev, skel, pool);
+
+  buf = svn_skel__unparse(skel, pool);
+  *data = buf->data;
+  *data_len = buf->len;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_cache__deserialize_func_t for blame_cache_entry_t. */
+static svn_error_t *
+deserialize_blame_entry(void **out,
+                        void *data,
+                        apr_size_t data_len,
+                        apr_pool_t *pool)
+{
+  blame_cache_entry_t *entry = apr_pcalloc(pool, sizeof(*entry));
+  svn_skel_t *skel = svn_skel__parse(data, data_len, pool);
+  apr_array_header_t *revs;
+  svn_skel_t *revs_skel, *chunks_skel;
+  svn_skel_t *elt;
+  struct blame **last = &entry->blame;
+  apr_int64_t value;
+
+  if (! skel || svn_skel__list_length(skel) != 4)
+    return svn_error_create(SVN_ERR_FS_MALFORMED_SKEL, NULL,
+                            _("Malformed blame cache entry"));
+
+  revs_skel = skel->children->next->next;
+  chunks_skel = revs_skel->next;
+  if (svn_skel__list_length(revs_skel) % 2
+      || svn_skel__list_length(chunks_skel) % 2)
+    return svn_error_create(SVN_ERR_FS_MALFORMED_SKEL, NULL,
+                            _("Malformed blame cache entry"));
+
+  SVN_ERR(svn_skel__parse_int(&value, skel->children, pool));
+  entry->end_rev = (svn_revnum_t)value;
+  SVN_ERR(svn_skel__parse_int(&value, skel->children->next, pool));
+  entry->created_rev = (svn_revnum_t)value;
+
+  revs = apr_array_make(pool, 16, sizeof(struct rev *));
+  for (elt = revs_skel->children; elt; elt = elt->next->next)
+    {
+      struct rev *rev = apr_pcalloc(pool, sizeof(*rev));
+
+      SVN_ERR(svn_skel__parse_int(&value, elt, pool));
+      rev->revision = (svn_revnum_t)value;
+      if (SVN_IS_VALID_REVNUM(rev->revision))
+        SVN_ERR(svn_skel__parse_proplist(&rev->rev_props, elt->next, pool));
+
+      APR_ARRAY_PUSH(revs, struct rev *) = rev;
+    }
+
+  for (elt = chunks_skel->children; elt; elt = elt->next->next)
+    {
+      struct blame *chunk = apr_pcalloc(pool, sizeof(*chunk));
+
+      SVN_ERR(svn_skel__parse_int(&value, elt, pool));
+      if (value < 0 || value >= revs->nelts)
+        return svn_error_create(SVN_ERR_FS_MALFORMED_SKEL, NULL,
+                                _("Malformed blame cache entry"));
+      chunk->rev = APR_ARRAY_IDX(revs, (int)value, struct rev *);
+
+      SVN_ERR(svn_skel__parse_int(&value, elt->next, pool));
+      chunk->start = (apr_off_t)value;
+
+      *last = chunk;
+      last = &chunk->next;
+    }
+
+  *out = entry;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_cache__error_handler_t.  A failing cache lookup or
+   update must never let the blame operation fail. */
+static svn_error_t *
+ignore_cache_errors(svn_error_t *err,
+                    void *baton,
+                    apr_pool_t *pool)
+{
+  svn_error_clear(err);
+  return SVN_NO_ERROR;
+}
+
+/* Set *CACHE to the blame cache and *KEY to the key under which the blame
+   of END_LOC starting at START_REV, using DIFF_OPTIONS and
+   IGNORE_MIME_TYPE, is to be stored.  Set *CACHE to NULL if there is no
+   cache to use.  Allocate the results in RESULT_POOL. */
+static svn_error_t *
+open_blame_cache(svn_cache__t **cache,
+                 const char **key,
+                 const svn_client__pathrev_t *end_loc,
+                 svn_revnum_t start_rev,
+                 const svn_diff_file_options_t *diff_options,
+                 svn_boolean_t ignore_mime_type,
+                 apr_pool_t *result_pool)
+{
+  svn_membuffer_t *membuffer = svn_cache__get_global_membuffer_cache();
+
+  *cache = NULL;
+  *key = NULL;
+
+  if (! membuffer || ! end_loc->repos_uuid)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_cache__create_membuffer_cache(cache, membuffer,
+                                            serialize_blame_entry,
+                                            deserialize_blame_entry,
+                                            APR_HASH_KEY_STRING,
+                                            "blame:", FALSE, result_pool));
+  SVN_ERR(svn_cache__set_error_handler(*cache, ignore_cache_errors, NULL,
+                                       result_pool));
+
+  /* Everything that influences the resulting blame chain but the end
+     revision becomes part of the key.  The path goes last as it is the
+     only part that may contain our separator. */
+  *key = apr_psprintf(result_pool, "%s:%ld:%d:%d:%d:%s",
+                      end_loc->repos_uuid, start_rev,
+                      diff_options ? (int)diff_options->ignore_space : 0,
+                      diff_options ? diff_options->ignore_eol_style : FALSE,
+                      ignore_mime_type,
+                      svn_client__pathrev_relpath(end_loc, result_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Look up the blame for KEY in CACHE and return it in *ENTRY.  Set *ENTRY
+   to NULL if there is none or if it cannot be used to blame END_LOC
+   through RA_SESSION, which must be parented at END_LOC's URL.
+   Allocate the result in RESULT_POOL. */
+static svn_error_t *
+get_cached_blame(blame_cache_entry_t **entry,
+                 svn_cache__t *cache,
+                 const char *key,
+                 svn_ra_session_t *ra_session,
+                 const svn_client__pathrev_t *end_loc,
+                 apr_pool_t *result_pool,
+                 apr_pool_t *scratch_pool)
+{
+  svn_boolean_t found;
+  void *value;
+  apr_array_header_t *location_revs;
+  apr_hash_t *locations;
+  const char *fspath;
+
+  *entry = NULL;
+
+  SVN_ERR(svn_cache__get(&value, &found, cache, key, result_pool));
+  if (! found)
+    return SVN_NO_ERROR;
+
+  /* We can only build on top of older revisions. */
+  if (((blame_cache_entry_t *)value)->end_rev > end_loc->rev)
+    return SVN_NO_ERROR;
+
+  /* Make sure that the cached blame describes the history of the same
+     node and has not been made for an earlier occupant of that path.
+     file_rev_handler() will verify that it has been made for the same
+     node revision as well. */
+  location_revs = apr_array_make(scratch_pool, 1, sizeof(svn_revnum_t));
+  APR_ARRAY_PUSH(location_revs, svn_revnum_t)
+    = ((blame_cache_entry_t *)value)->end_rev;
+  SVN_ERR(svn_ra_get_locations(ra_session, &locations, "", end_loc->rev,
+                               location_revs, scratch_pool));
+
+  fspath = apr_hash_get(locations, location_revs->elts, sizeof(svn_revnum_t));
+  if (fspath && *fspath == '/'
+      && strcmp(fspath + 1,
+                svn_client__pathrev_relpath(end_loc, scratch_pool)) == 0)
+    *entry = value;
+
+  return SVN_NO_ERROR;
+}
+
+/*** Server-side blame ***/
+
+/* Baton for server_blame_receiver(). */
+typedef struct server_blame_baton_t
+{
+  /* The chain to append to. */
+  struct blame_chain *chain;
+
+  /* The last chunk in CHAIN, NULL if there is none yet. */
+  struct blame *last;
+
+  /* Maps svn_revnum_t to the struct rev used for it so far. */
+  apr_hash_t *revs;
+} server_blame_baton_t;
+
+/* Implements svn_ra__blame_receiver_t, appending a chunk to the blame
+   chain in the server_blame_baton_t BATON. */
+static svn_error_t *
+server_blame_receiver(void *baton,
+                      apr_int64_t start_line,
+                      svn_revnum_t revision,
+                      apr_hash_t *rev_props,
+                      apr_pool_t *pool)
+{
+  server_blame_baton_t *sbb = baton;
+  apr_pool_t *chain_pool = sbb->chain->pool;
+  struct rev *rev;
+  struct blame *chunk;
+
+  rev = apr_hash_get(sbb->revs, &revision, sizeof(revision));
+  if (! rev)
+    {
+      rev = apr_pcalloc(chain_pool, sizeof(*rev));
+      rev->revision = revision;
+      if (rev_props)
+        rev->rev_props = svn_prop_hash_dup(rev_props, chain_pool);
+      apr_hash_set(sbb->revs, &rev->revision, sizeof(rev->revision), rev);
+    }
+
+  chunk = blame_create(sbb->chain, rev, (apr_off_t)start_line);
+  if (sbb->last)
+    sbb->last->next = chunk;
+  else
+    sbb->chain->blame = chunk;
+  sbb->last = chunk;
+
+  return SVN_NO_ERROR;
+}
+
+/* Compare the revisions of the struct rev ** A and B, for qsort(). */
+static int
+compare_revs(const void *a, const void *b)
+{
+  svn_revnum_t rev_a = (*(struct rev *const *)a)->revision;
+  svn_revnum_t rev_b = (*(struct rev *const *)b)->revision;
+
+  return rev_a < rev_b ? -1 : (rev_a > rev_b ? 1 : 0);
+}
+
+/* Try to let the server behind RA_SESSION, which must be parented at
+   END_LOC, compute the blame of the file between START_REV and
+   END_LOC->rev.  On success, fill FRB->chain with the result, store the
+   text of the file at END_LOC->rev in FRB->last_filename and the
+   revision in which it was last changed in FRB->last_revnum, send a
+   notification for every revision that the result refers to and set
+   *DONE to TRUE.  If the server cannot compute the blame, set *DONE to
+   FALSE and leave FRB untouched.  Use POOL for all allocations. */
+static svn_error_t *
+get_server_blame(svn_boolean_t *done,
+                 struct file_rev_baton *frb,
+                 svn_ra_session_t *ra_session,
+                 const svn_client__pathrev_t *end_loc,
+                 svn_revnum_t start_rev,
+                 apr_pool_t *pool)
+{
+  server_blame_baton_t sbb;
+  svn_diff_file_options_t *default_options = NULL;
+  svn_stream_t *stream;
+  const char *filename;
+  apr_hash_t *props;
+  svn_string_t *committed_rev;
+  svn_revnum_t end_rev = end_loc->rev;
+  svn_error_t *err;
+
+  *done = FALSE;
+
+  if (! frb->diff_options)
+    default_options = svn_diff_file_options_create(pool);
+
+  sbb.chain = frb->chain;
+  sbb.last = NULL;
+  sbb.revs = apr_hash_make(pool);
+
+  err = svn_ra__get_file_blame(ra_session, "", start_rev, end_rev,
+                               frb->diff_options ? frb->diff_options
+                                                 : default_options,
+                               frb->ignore_mime_type,
+                               server_blame_receiver, &sbb, pool);
+  if (err && err->apr_err == SVN_ERR_RA_NOT_IMPLEMENTED)
+    {
+      /* Nothing has been received, so the chain is still empty. */
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  /* The lines are not part of the server's answer. */
+  SVN_ERR(svn_stream_open_unique(&stream, &filename, NULL,
+                                 svn_io_file_del_on_pool_cleanup,
+                                 pool, pool));
+  SVN_ERR(svn_ra_get_file(ra_session, "", end_rev, stream, NULL, &props,
+                          pool));
+  SVN_ERR(svn_stream_close(stream));
+
+  committed_rev = apr_hash_get(props, SVN_PROP_ENTRY_COMMITTED_REV,
+                               APR_HASH_KEY_STRING);
+  frb->last_revnum = committed_rev ? SVN_STR_TO_REV(committed_rev->data)
+                                   : SVN_INVALID_REVNUM;
+
+  /* The server only tells us about the revisions that lines come from,
+     and not under which path.  Report them in ascending order, like the
+     file revisions that we would otherwise have received. */
+  if (frb->ctx->notify_func2)
+    {
+      const char *path = apr_pstrcat(pool, "/",
+                                     svn_client__pathrev_relpath(end_loc,
+                                                                 pool),
+                                     (char *)NULL);
+      apr_array_header_t *revs
+        = apr_array_make(pool, apr_hash_count(sbb.revs),
+                         sizeof(struct rev *));
+      apr_hash_index_t *hi;
+      int i;
+
+      for (hi = apr_hash_first(pool, sbb.revs); hi; hi = apr_hash_next(hi))
+        APR_ARRAY_PUSH(revs, struct rev *) = svn__apr_hash_index_val(hi);
+      qsort(revs->elts, revs->nelts, revs->elt_size, compare_revs);
+
+      for (i = 0; i < revs->nelts; i++)
+        {
+          struct rev *rev = APR_ARRAY_IDX(revs, i, struct rev *);
+
+          notify_blame_revision(frb, path, rev->revision, rev->rev_props,
+                                pool);
+        }
+    }
+
+  frb->last_filename = filename;
+  *done = TRUE;
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_client_blame5(const char *target,
                   const svn_opt_revision_t *peg_revision,
@@ -599,6 +1132,9 @@ svn_client_blame5(const char *target,
   svn_stream_t *last_stream;
   svn_stream_t *stream;
   const char *target_abspath_or_url;
+  svn_cache__t *blame_cache = NULL;
+  const char *cache_key = NULL;
+  blame_cache_entry_t *cached_blame = NULL;
 
   if (start->kind == svn_opt_revision_unspecified
       || end->kind == svn_opt_revision_unspecified)
@@ -634,6 +1170,10 @@ svn_client_blame5(const char *target,
   frb.include_merged_revisions = include_merged_revisions;
   frb.last_filename = NULL;
   frb.last_original_filename = NULL;
+  frb.resume_pending = FALSE;
+  frb.cache_base_rev = SVN_INVALID_REVNUM;
+  frb.cache_mismatch = FALSE;
+  frb.last_revnum = SVN_INVALID_REVNUM;
   frb.chain = apr_palloc(pool, sizeof(*frb.chain));
   frb.chain->blame = NULL;
   frb.chain->avail = NULL;
@@ -660,14 +1200,70 @@ svn_client_blame5(const char *target,
       frb.prevfilepool = svn_pool_create(pool);
     }
 
-  /* Collect all blame information.
-     We need to ensure that we get one revision before the start_rev,
-     if available so that we can know what was actually changed in the start
-     revision. */
-  SVN_ERR(svn_ra_get_file_revs2(ra_session, "",
-                                start_revnum - (start_revnum > 0 ? 1 : 0),
-                                end_revnum, include_merged_revisions,
-                                file_rev_handler, &frb, pool));
+  /* Continue from a previous blame of this file, if possible.  We don't
+     cache the separate chain of merged revisions. */
+  if (! include_merged_revisions)
+    {
+      SVN_ERR(open_blame_cache(&blame_cache, &cache_key, end_loc,
+                               start_revnum, diff_options, ignore_mime_type,
+                               pool));
+      if (blame_cache)
+        SVN_ERR(get_cached_blame(&cached_blame, blame_cache, cache_key,
+                                 ra_session, end_loc, pool, pool));
+    }
+
+  if (cached_blame)
+    {
+      /* The first revision reported below will provide the contents
+         that the cached blame chain applies to. */
+      frb.chain->blame = cached_blame->blame;
+      frb.resume_pending = TRUE;
+      frb.cache_base_rev = cached_blame->created_rev;
+
+      SVN_ERR(svn_ra_get_file_revs2(ra_session, "",
+                                    cached_blame->end_rev, end_revnum,
+                                    FALSE, file_rev_handler, &frb, pool));
+
+      /* Nothing has been blamed on top of a cached blame that turned
+         out not to apply, so we can simply start over. */
+      if (frb.cache_mismatch)
+        {
+          frb.chain->blame = NULL;
+          cached_blame = NULL;
+        }
+    }
+
+  if (! cached_blame)
+    {
+      svn_boolean_t server_blamed = FALSE;
+
+      /* Let the server do the work if it can, saving the transfer of
+         every revision of the file.  Merged revisions are not supported
+         by the server-side blame. */
+      if (! include_merged_revisions)
+        SVN_ERR(get_server_blame(&server_blamed, &frb, ra_session, end_loc,
+                                 start_revnum, pool));
+
+      /* Collect all blame information.
+         We need to ensure that we get one revision before the start_rev,
+         if available so that we can know what was actually changed in the
+         start revision. */
+      if (! server_blamed)
+        SVN_ERR(svn_ra_get_file_revs2(ra_session, "",
+                                      start_revnum - (start_revnum > 0 ? 1 : 0),
+                                      end_revnum, include_merged_revisions,
+                                      file_rev_handler, &frb, pool));
+    }
+
+  if (blame_cache && frb.chain->blame)
+    {
+      blame_cache_entry_t entry;
+
+      entry.end_rev = end_revnum;
+      entry.created_rev = frb.last_revnum;
+      entry.blame = frb.chain->blame;
+      SVN_ERR(svn_cache__set(blame_cache, cache_key, &entry, pool));
+    }
 
   if (end->kind == svn_opt_revision_working)
     {
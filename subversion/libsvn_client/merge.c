@@ -61,6 +61,7 @@
 #include "private/svn_ra_private.h"
 #include "private/svn_client_private.h"
 #include "private/svn_subr_private.h"
+#include "private/svn_thread_pool.h"
 
 #include "svn_private_config.h"
 
@@ -338,6 +339,35 @@ typedef struct merge_cmd_baton_t {
      merge source, i.e. it is cleared on every call to do_directory_merge()
      or do_file_merge() in do_merge(). */
   apr_pool_t *pool;
+
+  /* The maximum number of file texts to merge in parallel, as set by
+     SVN_CONFIG_OPTION_MERGE_THREADS.  Always at least 1. */
+  int merge_threads;
+
+  /* Worker threads merging file texts while the merge editor drive
+     continues, see queue_text_merge().  NULL if text merges are to be
+     performed synchronously, which is always the case outside of
+     drive_merge_report_editor(). */
+  svn_thread_pool__t *text_merge_pool;
+
+  /* Queue of the struct pending_text_merge_t * that have been handed to
+     TEXT_MERGE_POOL, in editor drive order, and their number. */
+  struct pending_text_merge_t *first_text_merge;
+  struct pending_text_merge_t *last_text_merge;
+  int nbr_text_merges;
+
+  /* Maps the relpaths of the queued text merges to their
+     struct pending_text_merge_t *. */
+  apr_hash_t *text_merge_paths;
+
+  /* Queue of the struct held_notification_t * that have been held back
+     until the text merges queued before them have been completed, in
+     the order in which they have been received. */
+  struct held_notification_t *first_held_notification;
+  struct held_notification_t *last_held_notification;
+
+  /* Parent pool for the pending text merges. */
+  apr_pool_t *text_merge_pool_parent;
 } merge_cmd_baton_t;
 
 
@@ -1547,6 +1577,361 @@ check_moved_here(svn_boolean_t *moved_here,
   return SVN_NO_ERROR;
 }
 
+/* Return the notification state that corresponds to a text merge
+   with outcome CONTENT_OUTCOME into a file that HAS_LOCAL_MODS. */
+static svn_wc_notify_state_t
+text_merge_notify_state(enum svn_wc_merge_outcome_t content_outcome,
+                        svn_boolean_t has_local_mods)
+{
+  if (content_outcome == svn_wc_merge_conflict)
+    return svn_wc_notify_state_conflicted;
+  else if (has_local_mods
+           && content_outcome != svn_wc_merge_unchanged)
+    return svn_wc_notify_state_merged;
+  else if (content_outcome == svn_wc_merge_merged)
+    return svn_wc_notify_state_changed;
+  else if (content_outcome == svn_wc_merge_no_merge)
+    return svn_wc_notify_state_missing;
+  else /* merge_outcome == svn_wc_merge_unchanged */
+    return svn_wc_notify_state_unchanged;
+}
+
+/* A notification that must not be delivered before the text merges
+   queued before it have been completed. */
+typedef struct held_notification_t
+{
+  /* The notification and the baton to deliver it to. */
+  svn_wc_notify_t *notify;
+  struct notification_receiver_baton_t *notify_b;
+
+  /* Set while NOTIFY still waits for the result of its text merge. */
+  svn_boolean_t waiting;
+
+  /* Next notification in the queue. */
+  struct held_notification_t *next;
+} held_notification_t;
+
+/* A text merge that is being performed by MERGE_B->TEXT_MERGE_POOL. */
+typedef struct pending_text_merge_t
+{
+  /* The file to merge into, relative to the merge target and absolute. */
+  const char *mine_relpath;
+  const char *local_abspath;
+
+  /* Our own copies of the left and right side of the merge. */
+  const char *left_abspath;
+  const char *right_abspath;
+
+  /* The remaining parameters for svn_wc__merge_premerged(). */
+  svn_wc__premerge_t *premerge;
+  const char *left_label;
+  const char *right_label;
+  const char *target_label;
+  const svn_wc_conflict_version_t *left;
+  const svn_wc_conflict_version_t *right;
+  apr_hash_t *original_props;
+  const apr_array_header_t *prop_changes;
+  svn_boolean_t has_local_mods;
+
+  /* The background job running svn_wc__premerge_run(). */
+  svn_thread_pool__job_t *job;
+  svn_cancel_func_t cancel_func;
+  void *cancel_baton;
+
+  /* The notification for this file that has been held back until the
+     merge result is known.  NULL if none has been received, yet. */
+  held_notification_t *held;
+
+  /* Next text merge in the queue. */
+  struct pending_text_merge_t *next;
+
+  /* Everything above lives in this pool. */
+  apr_pool_t *pool;
+} pending_text_merge_t;
+
+static void
+deliver_notification(struct notification_receiver_baton_t *notify_b,
+                     const svn_wc_notify_t *notify,
+                     apr_pool_t *pool);
+
+/* Hold back NOTIFY for NOTIFY_B if it has to wait for a text merge that
+   is pending in MERGE_B, i.e. if it is the notification for a file that
+   is being merged or if notifications received before it are still
+   being held back.  Return TRUE if NOTIFY has been held back. */
+static svn_boolean_t
+hold_notification(merge_cmd_baton_t *merge_b,
+                  struct notification_receiver_baton_t *notify_b,
+                  const svn_wc_notify_t *notify)
+{
+  pending_text_merge_t *ptm = NULL;
+  held_notification_t *held;
+  apr_pool_t *pool;
+
+  if (notify->kind == svn_node_file
+      && notify->action == svn_wc_notify_update_update)
+    {
+      ptm = apr_hash_get(merge_b->text_merge_paths, notify->path,
+                         APR_HASH_KEY_STRING);
+      if (ptm && ptm->held)
+        ptm = NULL;
+    }
+
+  if (! ptm && ! merge_b->first_held_notification)
+    return FALSE;
+
+  /* Whenever notifications are being held back, there is a text merge
+     pending that they wait for.  A notification will be delivered by
+     the time the last text merge queued before it completes. */
+  pool = ptm ? ptm->pool : merge_b->last_text_merge->pool;
+  held = apr_pcalloc(pool, sizeof(*held));
+  held->notify = svn_wc_dup_notify(notify, pool);
+  held->notify_b = notify_b;
+  held->waiting = (ptm != NULL);
+  if (ptm)
+    ptm->held = held;
+
+  if (merge_b->last_held_notification)
+    merge_b->last_held_notification->next = held;
+  else
+    merge_b->first_held_notification = held;
+  merge_b->last_held_notification = held;
+
+  return TRUE;
+}
+
+/* Deliver the notifications held back in MERGE_B up to the first one
+   that still waits for its text merge. */
+static void
+flush_held_notifications(merge_cmd_baton_t *merge_b,
+                         apr_pool_t *scratch_pool)
+{
+  while (merge_b->first_held_notification
+         && ! merge_b->first_held_notification->waiting)
+    {
+      held_notification_t *held = merge_b->first_held_notification;
+
+      merge_b->first_held_notification = held->next;
+      if (merge_b->first_held_notification == NULL)
+        merge_b->last_held_notification = NULL;
+
+      deliver_notification(held->notify_b, held->notify, scratch_pool);
+    }
+}
+
+/* Implements svn_thread_pool__task_t.  Run the svn_wc__premerge_run() part
+   of the pending_text_merge_t in BATON. */
+static svn_error_t *
+run_text_merge(void *baton,
+               apr_pool_t *result_pool,
+               apr_pool_t *scratch_pool)
+{
+  pending_text_merge_t *ptm = baton;
+
+  return svn_error_trace(svn_wc__premerge_run(ptm->premerge,
+                                              ptm->left_abspath,
+                                              ptm->right_abspath,
+                                              ptm->cancel_func,
+                                              ptm->cancel_baton,
+                                              result_pool, scratch_pool));
+}
+
+/* Give up ownership of the temporary file FILE_ABSPATH, which the merge
+   editor will delete as soon as the current callback returns, by
+   renaming it.  Set *NEW_ABSPATH to the new name, which will be deleted
+   upon cleanup of RESULT_POOL. */
+static svn_error_t *
+take_over_tmp_file(const char **new_abspath,
+                   const char *file_abspath,
+                   apr_pool_t *result_pool,
+                   apr_pool_t *scratch_pool)
+{
+  SVN_ERR(svn_io_open_unique_file3(NULL, new_abspath,
+                                   svn_dirent_dirname(file_abspath,
+                                                      scratch_pool),
+                                   svn_io_file_del_on_pool_cleanup,
+                                   result_pool, scratch_pool));
+
+  return svn_error_trace(svn_io_file_rename(file_abspath, *new_abspath,
+                                            scratch_pool));
+}
+
+/* Wait for the oldest text merge in MERGE_B's queue to be computed,
+   install the result in the working copy and send the notification
+   that has been held back for it, along with any notifications that
+   were held back behind it. */
+static svn_error_t *
+complete_text_merge(merge_cmd_baton_t *merge_b,
+                    apr_pool_t *scratch_pool)
+{
+  pending_text_merge_t *ptm = merge_b->first_text_merge;
+  svn_client_ctx_t *ctx = merge_b->ctx;
+  enum svn_wc_merge_outcome_t content_outcome;
+  svn_wc_notify_state_t prop_state = svn_wc_notify_state_unchanged;
+  conflict_resolver_baton_t conflict_baton = { 0 };
+  svn_error_t *err;
+
+  merge_b->first_text_merge = ptm->next;
+  if (merge_b->first_text_merge == NULL)
+    merge_b->last_text_merge = NULL;
+  merge_b->nbr_text_merges--;
+  apr_hash_set(merge_b->text_merge_paths, ptm->mine_relpath,
+               APR_HASH_KEY_STRING, NULL);
+
+  /* Postpone all conflicts. */
+  conflict_baton.wrapped_func = ctx->conflict_func2;
+  conflict_baton.wrapped_baton = ctx->conflict_baton2;
+  conflict_baton.conflicted_paths = &merge_b->conflicted_paths;
+  conflict_baton.pool = merge_b->pool;
+
+  err = svn_thread_pool__wait(ptm->job);
+  if (! err)
+    err = svn_wc__merge_premerged(&content_outcome, &prop_state,
+                                  ctx->wc_ctx, ptm->premerge,
+                                  ptm->left_abspath, ptm->right_abspath,
+                                  ptm->local_abspath,
+                                  ptm->left_label, ptm->right_label,
+                                  ptm->target_label,
+                                  ptm->left, ptm->right,
+                                  FALSE /* dry_run */,
+                                  NULL /* diff3_cmd */,
+                                  merge_b->merge_options,
+                                  ptm->original_props, ptm->prop_changes,
+                                  conflict_resolver, &conflict_baton,
+                                  ctx->cancel_func, ctx->cancel_baton,
+                                  scratch_pool);
+
+  if (! err && ptm->held)
+    {
+      ptm->held->notify->content_state
+        = text_merge_notify_state(content_outcome, ptm->has_local_mods);
+      ptm->held->notify->prop_state = prop_state;
+      ptm->held->waiting = FALSE;
+    }
+
+  /* The held back notifications live in the pools of the text merges,
+     so don't leave any of them behind. */
+  if (err)
+    {
+      merge_b->first_held_notification = NULL;
+      merge_b->last_held_notification = NULL;
+    }
+  else
+    flush_held_notifications(merge_b, scratch_pool);
+
+  svn_pool_destroy(ptm->pool);
+
+  return svn_error_trace(err);
+}
+
+/* Complete all text merges in MERGE_B's queue, in order. */
+static svn_error_t *
+complete_text_merges(merge_cmd_baton_t *merge_b,
+                     apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+
+  while (merge_b->first_text_merge)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(complete_text_merge(merge_b, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Try to perform the text merge of OLDER_ABSPATH and YOURS_ABSPATH into
+   LOCAL_ABSPATH (MINE_RELPATH relative to the merge target) in the
+   background.  The remaining parameters are as for svn_wc_merge5().
+
+   If the merge could be queued, set *QUEUED to TRUE and take over the
+   two temporary files.  The merge will be completed by a later call to
+   complete_text_merge().  Otherwise, set *QUEUED to FALSE and leave it
+   to the caller to merge the texts.
+
+   To bound the amount of outstanding work, this may complete earlier
+   text merges. */
+static svn_error_t *
+queue_text_merge(svn_boolean_t *queued,
+                 merge_cmd_baton_t *merge_b,
+                 const char *mine_relpath,
+                 const char *local_abspath,
+                 const char *older_abspath,
+                 const char *yours_abspath,
+                 const char *left_label,
+                 const char *right_label,
+                 const char *target_label,
+                 const svn_wc_conflict_version_t *left,
+                 const svn_wc_conflict_version_t *right,
+                 apr_hash_t *original_props,
+                 const apr_array_header_t *prop_changes,
+                 svn_boolean_t has_local_mods,
+                 apr_pool_t *scratch_pool)
+{
+  apr_pool_t *pool = svn_pool_create(merge_b->text_merge_pool_parent);
+  svn_wc__premerge_t *premerge;
+  pending_text_merge_t *ptm;
+
+  *queued = FALSE;
+
+  SVN_ERR(svn_wc__premerge_prepare(&premerge, merge_b->ctx->wc_ctx,
+                                   local_abspath,
+                                   left_label, right_label, target_label,
+                                   merge_b->merge_options, prop_changes,
+                                   pool, scratch_pool));
+  if (! premerge)
+    {
+      svn_pool_destroy(pool);
+      return SVN_NO_ERROR;
+    }
+
+  ptm = apr_pcalloc(pool, sizeof(*ptm));
+  ptm->pool = pool;
+  ptm->premerge = premerge;
+  ptm->mine_relpath = apr_pstrdup(pool, mine_relpath);
+  ptm->local_abspath = apr_pstrdup(pool, local_abspath);
+  ptm->left_label = apr_pstrdup(pool, left_label);
+  ptm->right_label = apr_pstrdup(pool, right_label);
+  ptm->target_label = apr_pstrdup(pool, target_label);
+  ptm->left = left;
+  ptm->right = right;
+  ptm->original_props = original_props
+                          ? svn_prop_hash_dup(original_props, pool)
+                          : NULL;
+  ptm->prop_changes = svn_prop_array_dup(prop_changes, pool);
+  ptm->has_local_mods = has_local_mods;
+  ptm->cancel_func = merge_b->ctx->cancel_func;
+  ptm->cancel_baton = merge_b->ctx->cancel_baton;
+
+  /* The merge editor creates separate temporary files for both sides
+     of every changed file, so nobody else refers to them. */
+  SVN_ERR(take_over_tmp_file(&ptm->left_abspath, older_abspath,
+                             pool, scratch_pool));
+  SVN_ERR(take_over_tmp_file(&ptm->right_abspath, yours_abspath,
+                             pool, scratch_pool));
+
+  SVN_ERR(svn_thread_pool__submit(&ptm->job, merge_b->text_merge_pool,
+                                  run_text_merge, ptm, pool));
+
+  if (merge_b->last_text_merge)
+    merge_b->last_text_merge->next = ptm;
+  else
+    merge_b->first_text_merge = ptm;
+  merge_b->last_text_merge = ptm;
+  merge_b->nbr_text_merges++;
+  apr_hash_set(merge_b->text_merge_paths, ptm->mine_relpath,
+               APR_HASH_KEY_STRING, ptm);
+
+  *queued = TRUE;
+
+  /* Keep every worker busy but don't let the queue grow unboundedly. */
+  while (merge_b->nbr_text_merges > 2 * merge_b->merge_threads)
+    SVN_ERR(complete_text_merge(merge_b, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
 /* An svn_wc_diff_callbacks4_t function. */
 static svn_error_t *
 merge_file_changed(svn_wc_notify_state_t *content_state,
@@ -1751,6 +2136,31 @@ merge_file_changed(svn_wc_notify_state_t *content_state,
       SVN_ERR(svn_wc_text_modified_p2(&has_local_mods, ctx->wc_ctx,
                                       local_abspath, FALSE, scratch_pool));
 
+      /* Let the worker threads do the actual text merge, if possible. */
+      if (merge_b->text_merge_pool && ! merge_b->dry_run
+          && ! merge_b->diff3_cmd)
+        {
+          svn_boolean_t queued;
+
+          SVN_ERR(queue_text_merge(&queued, merge_b,
+                                   mine_relpath, local_abspath,
+                                   older_abspath, yours_abspath,
+                                   left_label, right_label, target_label,
+                                   left, right,
+                                   original_props, prop_changes,
+                                   has_local_mods, scratch_pool));
+          if (queued)
+            {
+              /* complete_text_merge() will provide the final states. */
+              if (content_state)
+                *content_state = svn_wc_notify_state_unknown;
+              if (prop_state)
+                *prop_state = svn_wc_notify_state_unknown;
+
+              return SVN_NO_ERROR;
+            }
+        }
+
       /* Postpone all conflicts. */
       conflict_baton.wrapped_func = ctx->conflict_func2;
       conflict_baton.wrapped_baton = ctx->conflict_baton2;
@@ -1773,19 +2183,8 @@ merge_file_changed(svn_wc_notify_state_t *content_state,
                             scratch_pool));
 
       if (content_state)
-        {
-          if (content_outcome == svn_wc_merge_conflict)
-            *content_state = svn_wc_notify_state_conflicted;
-          else if (has_local_mods
-                   && content_outcome != svn_wc_merge_unchanged)
-            *content_state = svn_wc_notify_state_merged;
-          else if (content_outcome == svn_wc_merge_merged)
-            *content_state = svn_wc_notify_state_changed;
-          else if (content_outcome == svn_wc_merge_no_merge)
-            *content_state = svn_wc_notify_state_missing;
-          else /* merge_outcome == svn_wc_merge_unchanged */
-            *content_state = svn_wc_notify_state_unchanged;
-        }
+        *content_state = text_merge_notify_state(content_outcome,
+                                                 has_local_mods);
     }
 
   return SVN_NO_ERROR;
@@ -3022,8 +3421,6 @@ notification_receiver(void *baton, const svn_wc_notify_t *notify,
                       apr_pool_t *pool)
 {
   notification_receiver_baton_t *notify_b = baton;
-  svn_boolean_t is_operative_notification = IS_OPERATIVE_NOTIFICATION(notify);
-  const char *notify_abspath;
 
   /* Skip notifications if this is a --record-only merge that is adding
      or deleting NOTIFY->PATH, allow only mergeinfo changes and headers.
@@ -3033,6 +3430,26 @@ notification_receiver(void *baton, const svn_wc_notify_t *notify,
       && notify->action != svn_wc_notify_update_update)
     return;
 
+  /* Hold back the notification for a file whose text is still being
+     merged in the background, and all notifications behind it, so that
+     they keep their order.  complete_text_merge() will deliver them. */
+  if (notify_b->merge_b->text_merge_paths
+      && hold_notification(notify_b->merge_b, notify_b, notify))
+    return;
+
+  deliver_notification(notify_b, notify, pool);
+}
+
+/* Call NOTIFY_B's wrapped notification function for NOTIFY and record
+   which paths changed, as described for notification_receiver(). */
+static void
+deliver_notification(notification_receiver_baton_t *notify_b,
+                     const svn_wc_notify_t *notify,
+                     apr_pool_t *pool)
+{
+  svn_boolean_t is_operative_notification = IS_OPERATIVE_NOTIFICATION(notify);
+  const char *notify_abspath;
+
   if (is_operative_notification)
     {
       notify_b->nbr_operative_notifications++;
@@ -5072,6 +5489,7 @@ drive_merge_report_editor(const char *target_abspath,
   svn_boolean_t honor_mergeinfo = HONOR_MERGEINFO(merge_b);
   const char *old_sess1_url, *old_sess2_url;
   svn_boolean_t is_rollback = source->loc1->rev > source->loc2->rev;
+  svn_error_t *err;
 
   /* Start with a safe default starting revision for the editor and the
      merge target. */
@@ -5255,7 +5673,36 @@ drive_merge_report_editor(const char *target_abspath,
         }
       svn_pool_destroy(iterpool);
     }
-  SVN_ERR(reporter->finish_report(report_baton, scratch_pool));
+  /* Merge file texts in the background while the editor drive continues,
+     if we are allowed to. */
+  if (merge_b->merge_threads > 1 && ! merge_b->dry_run
+      && ! merge_b->record_only)
+    {
+      SVN_ERR(svn_thread_pool__create(&merge_b->text_merge_pool,
+                                      merge_b->merge_threads, scratch_pool));
+      if (svn_thread_pool__is_parallel(merge_b->text_merge_pool))
+        {
+          merge_b->text_merge_paths = apr_hash_make(scratch_pool);
+          merge_b->text_merge_pool_parent = scratch_pool;
+        }
+      else
+        merge_b->text_merge_pool = NULL;
+    }
+
+  err = reporter->finish_report(report_baton, scratch_pool);
+  if (! err && merge_b->text_merge_pool)
+    err = complete_text_merges(merge_b, scratch_pool);
+
+  /* Any text merges still queued get discarded along with SCRATCH_POOL. */
+  merge_b->text_merge_pool = NULL;
+  merge_b->first_text_merge = NULL;
+  merge_b->last_text_merge = NULL;
+  merge_b->nbr_text_merges = 0;
+  merge_b->text_merge_paths = NULL;
+  merge_b->first_held_notification = NULL;
+  merge_b->last_held_notification = NULL;
+  merge_b->text_merge_pool_parent = NULL;
+  SVN_ERR(err);
 
   /* Point the merge baton's RA sessions back where they were. */
   SVN_ERR(svn_ra_reparent(merge_b->ra_session1, old_sess1_url, scratch_pool));
@@ -9045,6 +9492,7 @@ do_merge(apr_hash_t **modified_subtrees,
   notification_receiver_baton_t notify_baton;
   svn_config_t *cfg;
   const char *diff3_cmd;
+  apr_int64_t merge_threads;
   int i;
   svn_boolean_t checked_mergeinfo_capability = FALSE;
   svn_ra_session_t *ra_session1 = NULL, *ra_session2 = NULL;
@@ -9105,6 +9553,10 @@ do_merge(apr_hash_t **modified_subtrees,
   if (diff3_cmd != NULL)
     SVN_ERR(svn_path_cstring_to_utf8(&diff3_cmd, diff3_cmd, scratch_pool));
 
+  SVN_ERR(svn_config_get_int64(cfg, &merge_threads,
+                               SVN_CONFIG_SECTION_MISCELLANY,
+                               SVN_CONFIG_OPTION_MERGE_THREADS, 1));
+
   /* Build the merge context baton (or at least the parts of it that
      don't need to be reset for each merge source).  */
   merge_cmd_baton.force = force;
@@ -9120,6 +9572,15 @@ do_merge(apr_hash_t **modified_subtrees,
   merge_cmd_baton.merge_options = merge_options;
   merge_cmd_baton.diff3_cmd = diff3_cmd;
   merge_cmd_baton.use_sleep = use_sleep;
+  merge_cmd_baton.merge_threads = (int)MAX(1, MIN(merge_threads, 64));
+  merge_cmd_baton.text_merge_pool = NULL;
+  merge_cmd_baton.first_text_merge = NULL;
+  merge_cmd_baton.last_text_merge = NULL;
+  merge_cmd_baton.nbr_text_merges = 0;
+  merge_cmd_baton.text_merge_paths = NULL;
+  merge_cmd_baton.first_held_notification = NULL;
+  merge_cmd_baton.last_held_notification = NULL;
+  merge_cmd_baton.text_merge_pool_parent = NULL;
 
   /* Build the notification receiver baton. */
   notify_baton.wrapped_func = ctx->notify_func2;
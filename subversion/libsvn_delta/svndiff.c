@@ -515,7 +515,7 @@ zlib_decode(const unsigned char *in, apr_size_t inLen, svn_stringbuf_t *out,
 /* Decode an instruction into OP, returning a pointer to the text
    after the instruction.  Note that if the action code is
    svn_txdelta_new, the offset field of *OP will not be set.  */
-static const unsigned char *
+static APR_INLINE const unsigned char *
 decode_instruction(svn_txdelta_op_t *op,
                    const unsigned char *p,
                    const unsigned char *end)
@@ -538,85 +538,125 @@ decode_instruction(svn_txdelta_op_t *op,
      redefined. */
   op->action_code = (enum svn_delta_action)(action);
 
-  /* Decode the length and offset.  */
+  /* Decode the length and offset.  Most of them fit into a single byte,
+     so handle that case inline. */
   op->length = c & 0x3f;
   if (op->length == 0)
     {
-      p = decode_size(&op->length, p, end);
-      if (p == NULL)
-        return NULL;
+      if (p < end && *p < 0x80)
+        op->length = *p++;
+      else
+        {
+          p = decode_size(&op->length, p, end);
+          if (p == NULL)
+            return NULL;
+        }
     }
   if (action != svn_txdelta_new)
     {
-      p = decode_size(&op->offset, p, end);
-      if (p == NULL)
-        return NULL;
+      if (p < end && *p < 0x80)
+        op->offset = *p++;
+      else
+        {
+          p = decode_size(&op->offset, p, end);
+          if (p == NULL)
+            return NULL;
+        }
     }
 
   return p;
 }
 
-/* Count the instructions in the range [P..END-1] and make sure they
-   are valid for the given window lengths.  Return an error if the
-   instructions are invalid; otherwise set *NINST to the number of
-   instructions.  */
+/* Decode all instructions in the range [P..END-1] in a single pass and
+   make sure they are valid for the given window lengths.  Return an
+   error if the instructions are invalid; otherwise set *OPS to the
+   decoded instructions, allocated in POOL, *NINST to their number and
+   *SRC_OPS to the number of source copy instructions among them.  The
+   offsets of svn_txdelta_new instructions get set as well.  */
 static svn_error_t *
-count_and_verify_instructions(int *ninst,
-                              const unsigned char *p,
-                              const unsigned char *end,
-                              apr_size_t sview_len,
-                              apr_size_t tview_len,
-                              apr_size_t new_len)
+decode_instructions(svn_txdelta_op_t **ops,
+                    int *ninst,
+                    int *src_ops,
+                    const unsigned char *p,
+                    const unsigned char *end,
+                    apr_size_t sview_len,
+                    apr_size_t tview_len,
+                    apr_size_t new_len,
+                    apr_pool_t *pool)
 {
   int n = 0;
-  svn_txdelta_op_t op;
+  int sources = 0;
   apr_size_t tpos = 0, npos = 0;
+  apr_size_t capacity;
+  svn_txdelta_op_t *buffer;
+
+  /* Every instruction takes at least one byte and produces at least one
+     byte of target data.  Typical windows have instructions of 2 to 3
+     bytes, so start with that estimate and grow if necessary. */
+  capacity = (end - p) / 2 + 1;
+  if (capacity > tview_len)
+    capacity = tview_len + 1;
+  buffer = apr_palloc(pool, capacity * sizeof(*buffer));
 
   while (p < end)
     {
-      p = decode_instruction(&op, p, end);
+      svn_txdelta_op_t *op;
+
+      if ((apr_size_t)n == capacity)
+        {
+          svn_txdelta_op_t *old_buffer = buffer;
+
+          capacity *= 2;
+          buffer = apr_palloc(pool, capacity * sizeof(*buffer));
+          memcpy(buffer, old_buffer, n * sizeof(*buffer));
+        }
+
+      op = &buffer[n];
+      p = decode_instruction(op, p, end);
 
       /* Detect any malformed operations from the instruction stream. */
       if (p == NULL)
         return svn_error_createf
           (SVN_ERR_SVNDIFF_INVALID_OPS, NULL,
            _("Invalid diff stream: insn %d cannot be decoded"), n);
-      else if (op.length == 0)
+      else if (op->length == 0)
         return svn_error_createf
           (SVN_ERR_SVNDIFF_INVALID_OPS, NULL,
            _("Invalid diff stream: insn %d has length zero"), n);
-      else if (op.length > tview_len - tpos)
+      else if (op->length > tview_len - tpos)
         return svn_error_createf
           (SVN_ERR_SVNDIFF_INVALID_OPS, NULL,
            _("Invalid diff stream: insn %d overflows the target view"), n);
 
-      switch (op.action_code)
+      switch (op->action_code)
         {
         case svn_txdelta_source:
-          if (op.length > sview_len - op.offset ||
-              op.offset > sview_len)
+          if (op->length > sview_len - op->offset ||
+              op->offset > sview_len)
             return svn_error_createf
               (SVN_ERR_SVNDIFF_INVALID_OPS, NULL,
                _("Invalid diff stream: "
                  "[src] insn %d overflows the source view"), n);
+          ++sources;
           break;
         case svn_txdelta_target:
-          if (op.offset >= tpos)
+          if (op->offset >= tpos)
             return svn_error_createf
               (SVN_ERR_SVNDIFF_INVALID_OPS, NULL,
                _("Invalid diff stream: "
                  "[tgt] insn %d starts beyond the target view position"), n);
           break;
         case svn_txdelta_new:
-          if (op.length > new_len - npos)
+          if (op->length > new_len - npos)
             return svn_error_createf
               (SVN_ERR_SVNDIFF_INVALID_OPS, NULL,
                _("Invalid diff stream: "
                  "[new] insn %d overflows the new data section"), n);
-          npos += op.length;
+          op->offset = npos;
+          npos += op->length;
           break;
         }
-      tpos += op.length;
+      tpos += op->length;
       n++;
     }
   if (tpos != tview_len)
@@ -626,7 +666,9 @@ count_and_verify_instructions(int *ninst,
     return svn_error_create(SVN_ERR_SVNDIFF_INVALID_OPS, NULL,
                             _("Delta does not contain enough new data"));
 
+  *ops = buffer;
   *ninst = n;
+  *src_ops = sources;
   return SVN_NO_ERROR;
 }
 
@@ -643,8 +685,7 @@ decode_window(svn_txdelta_window_t *window, svn_filesize_t sview_offset,
 {
   const unsigned char *insend;
   int ninst;
-  apr_size_t npos;
-  svn_txdelta_op_t *ops, *op;
+  svn_txdelta_op_t *ops;
   svn_string_t *new_data = apr_palloc(pool, sizeof(*new_data));
 
   window->sview_offset = sview_offset;
@@ -678,26 +719,9 @@ decode_window(svn_txdelta_window_t *window, svn_filesize_t sview_offset,
       new_data->len = newlen;
     }
 
-  /* Count the instructions and make sure they are all valid.  */
-  SVN_ERR(count_and_verify_instructions(&ninst, data, insend,
-                                        sview_len, tview_len, newlen));
-
-  /* Allocate a buffer for the instructions and decode them. */
-  ops = apr_palloc(pool, ninst * sizeof(*ops));
-  npos = 0;
-  window->src_ops = 0;
-  for (op = ops; op < ops + ninst; op++)
-    {
-      data = decode_instruction(op, data, insend);
-      if (op->action_code == svn_txdelta_source)
-        ++window->src_ops;
-      else if (op->action_code == svn_txdelta_new)
-        {
-          op->offset = npos;
-          npos += op->length;
-        }
-    }
-  SVN_ERR_ASSERT(data == insend);
+  /* Decode the instructions and make sure they are all valid.  */
+  SVN_ERR(decode_instructions(&ops, &ninst, &window->src_ops, data, insend,
+                              sview_len, tview_len, newlen, pool));
 
   window->ops = ops;
   window->num_ops = ninst;
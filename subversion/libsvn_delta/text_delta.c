@@ -665,14 +665,28 @@ patterning_copy(char *target, const char *source, apr_size_t len)
 {
   const char *end = source + len;
 
+  /* Most target copies come from self-compressed data and don't overlap
+   * at all.  Runs of a single repeated byte are the most common case
+   * of overlapping copies. */
+  if (end <= target)
+    return fast_memcpy(target, source, len);
+
+  if (source + 1 == target)
+    {
+      memset(target, *source, len);
+      return target + len;
+    }
+
   /* On many machines, we can do "chunky" copies. */
 
 #if SVN_UNALIGNED_ACCESS_IS_OK
 
-  if (end + sizeof(apr_uint32_t) <= target)
+  if (source + sizeof(apr_uint32_t) <= target)
     {
-      /* Source and target are at least 4 bytes apart, so we can copy in
-       * 4-byte chunks.  */
+      /* The ranges overlap but their starts are at least 4 bytes apart.
+       * Then, no chunk reads bytes that it or any later chunk is going
+       * to write, so copying in 4-byte chunks creates the same pattern
+       * as the byte-wise copy.  */
       for (; source + sizeof(apr_uint32_t) <= end;
            source += sizeof(apr_uint32_t),
            target += sizeof(apr_uint32_t))
@@ -697,6 +711,50 @@ svn_txdelta_apply_instructions(svn_txdelta_window_t *window,
   const svn_txdelta_op_t *op;
   apr_size_t tpos = 0;
 
+  /* Usually, the target buffer takes the whole window.  Then, we don't
+     need to clip any of the copies and can write them back to back. */
+  if (*tlen >= window->tview_len)
+    {
+      const svn_txdelta_op_t *end = window->ops + window->num_ops;
+      const char *new_data = window->new_data ? window->new_data->data
+                                              : NULL;
+      char *target = tbuf;
+
+      for (op = window->ops; op < end; op++)
+        {
+          /* Check some invariants common to all instructions.  */
+          assert(target - tbuf + op->length <= window->tview_len);
+
+          switch (op->action_code)
+            {
+            case svn_txdelta_source:
+              assert(op->offset + op->length <= window->sview_len);
+              target = fast_memcpy(target, sbuf + op->offset, op->length);
+              break;
+
+            case svn_txdelta_target:
+              assert(op->offset < (apr_size_t)(target - tbuf));
+              target = patterning_copy(target, tbuf + op->offset,
+                                       op->length);
+              break;
+
+            case svn_txdelta_new:
+              assert(op->offset + op->length <= window->new_data->len);
+              target = fast_memcpy(target, new_data + op->offset,
+                                   op->length);
+              break;
+
+            default:
+              assert(!"Invalid delta instruction code");
+            }
+        }
+
+      /* Check that we produced the right amount of data.  */
+      assert((apr_size_t)(target - tbuf) == window->tview_len);
+      *tlen = target - tbuf;
+      return;
+    }
+
   for (op = window->ops; op < window->ops + window->num_ops; op++)
     {
       const apr_size_t buf_len = (op->length < *tlen - tpos
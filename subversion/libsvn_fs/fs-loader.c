@@ -1095,6 +1095,16 @@ svn_fs_get_mergeinfo(svn_mergeinfo_catalog_t *catalog,
                                                      TRUE, pool, pool));
 }
 
+svn_error_t *
+svn_fs__prefetch_dir(svn_fs_root_t *root,
+                     const char *path,
+                     const apr_array_header_t *names,
+                     apr_pool_t *pool)
+{
+  return svn_error_trace(root->vtable->prefetch_dir(root, path, names,
+                                                    pool));
+}
+
 svn_error_t *
 svn_fs_merge(const char **conflict_p, svn_fs_root_t *source_root,
              const char *source_path, svn_fs_root_t *target_root,
@@ -345,6 +345,11 @@ typedef struct root_vtable_t
                                 svn_boolean_t adjust_inherited_mergeinfo,
                                 apr_pool_t *result_pool,
                                 apr_pool_t *scratch_pool);
+  /* Read-ahead. */
+  svn_error_t *(*prefetch_dir)(svn_fs_root_t *root,
+                               const char *path,
+                               const apr_array_header_t *names,
+                               apr_pool_t *pool);
 } root_vtable_t;
 
 
@@ -5361,6 +5361,18 @@ base_get_mergeinfo(svn_mergeinfo_catalog_t *catalog,
 }
 
 
+/* Implements root_vtable_t.prefetch_dir.  Berkeley DB keeps its own
+   page cache, so there is nothing to gain from reading ahead here. */
+static svn_error_t *
+base_prefetch_dir(svn_fs_root_t *root,
+                  const char *path,
+                  const apr_array_header_t *names,
+                  apr_pool_t *pool)
+{
+  return SVN_NO_ERROR;
+}
+
+
 
 /* Creating root objects.  */
 
@@ -5394,6 +5406,7 @@ static root_vtable_t root_vtable = {
   base_get_file_delta_stream,
   base_merge,
   base_get_mergeinfo,
+  base_prefetch_dir,
 };
 
 
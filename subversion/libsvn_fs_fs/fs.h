@@ -285,6 +285,10 @@ typedef struct fs_fs_data_t
   /* Cache for node_revision_t objects; the key is (revision, id offset) */
   svn_cache__t *node_revision_cache;
 
+  /* Cache for node property lists as apr_hash_t * mapping property names
+     to svn_string_t *; the key is (revision, prop rep offset) */
+  svn_cache__t *properties_cache;
+
   /* Cache for change lists as APR arrays of change_t * objects; the key
      is the revision */
   svn_cache__t *changes_cache;
@@ -2464,6 +2464,203 @@ svn_fs_fs__get_node_revision(node_revision_t **noderev_p,
 }
 
 
+/* Implements svn_cache__partial_getter_func_t.  Return nothing; this is
+   used to check for the presence of an item without deserializing it. */
+static svn_error_t *
+get_nothing(void **out,
+            const void *data,
+            apr_size_t data_len,
+            void *baton,
+            apr_pool_t *result_pool)
+{
+  *out = NULL;
+  return SVN_NO_ERROR;
+}
+
+/* Set *FOUND to TRUE if there is an item for KEY in CACHE.  Use POOL for
+   temporary allocations. */
+static svn_error_t *
+cache_has_key(svn_boolean_t *found,
+              svn_cache__t *cache,
+              const void *key,
+              apr_pool_t *pool)
+{
+  void *dummy;
+
+  return svn_cache__get_partial(&dummy, found, cache, key, get_nothing,
+                                NULL, pool);
+}
+
+/* qsort()-compatible comparison function ordering svn_fs_id_t * of
+   node-revisions by their location in the repository. */
+static int
+compare_id_location(const void *a,
+                    const void *b)
+{
+  const svn_fs_id_t *lhs = *(const svn_fs_id_t * const *)a;
+  const svn_fs_id_t *rhs = *(const svn_fs_id_t * const *)b;
+
+  if (svn_fs_fs__id_rev(lhs) != svn_fs_fs__id_rev(rhs))
+    return svn_fs_fs__id_rev(lhs) < svn_fs_fs__id_rev(rhs) ? -1 : 1;
+  if (svn_fs_fs__id_offset(lhs) != svn_fs_fs__id_offset(rhs))
+    return svn_fs_fs__id_offset(lhs) < svn_fs_fs__id_offset(rhs) ? -1 : 1;
+
+  return 0;
+}
+
+/* qsort()-compatible comparison function ordering representation_t *
+   by their location in the repository. */
+static int
+compare_rep_location(const void *a,
+                     const void *b)
+{
+  const representation_t *lhs = *(const representation_t * const *)a;
+  const representation_t *rhs = *(const representation_t * const *)b;
+
+  if (lhs->revision != rhs->revision)
+    return lhs->revision < rhs->revision ? -1 : 1;
+  if (lhs->offset != rhs->offset)
+    return lhs->offset < rhs->offset ? -1 : 1;
+
+  return 0;
+}
+
+/* Return the key under which the property list of the committed property
+   representation REP gets cached, allocated in POOL. */
+static const char *
+get_properties_cache_key(const representation_t *rep,
+                         apr_pool_t *pool)
+{
+  return apr_psprintf(pool, "%ld/%" APR_OFF_T_FMT, rep->revision,
+                      rep->offset);
+}
+
+/* Forward declaration. */
+static svn_error_t *
+get_rep_proplist(apr_hash_t **proplist_p,
+                 svn_fs_t *fs,
+                 representation_t *rep,
+                 apr_pool_t *pool);
+
+svn_error_t *
+svn_fs_fs__prefetch_node_revisions(svn_fs_t *fs,
+                                   const apr_array_header_t *ids,
+                                   svn_boolean_t include_props,
+                                   apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  apr_array_header_t *to_read;
+  apr_array_header_t *prop_reps;
+  apr_pool_t *iterpool;
+  apr_file_t *rev_file = NULL;
+  svn_revnum_t file_rev = SVN_INVALID_REVNUM;
+  apr_off_t rev_offset = 0;
+  int i;
+
+  /* Without a cache, there is nowhere to keep the data. */
+  if (! ffd->node_revision_cache)
+    return SVN_NO_ERROR;
+
+  if (! ffd->properties_cache)
+    include_props = FALSE;
+
+  /* Find the node-revisions that we still need to read. */
+  to_read = apr_array_make(pool, ids->nelts, sizeof(const svn_fs_id_t *));
+  prop_reps = apr_array_make(pool, ids->nelts, sizeof(representation_t *));
+  iterpool = svn_pool_create(pool);
+  for (i = 0; i < ids->nelts; i++)
+    {
+      const svn_fs_id_t *id = APR_ARRAY_IDX(ids, i, const svn_fs_id_t *);
+      node_revision_t *noderev;
+      svn_boolean_t found;
+
+      if (svn_fs_fs__id_txn_id(id))
+        continue;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(cache_has_key(&found, ffd->node_revision_cache,
+                            get_noderev_cache_key(id, iterpool), iterpool));
+      if (! found)
+        {
+          APR_ARRAY_PUSH(to_read, const svn_fs_id_t *) = id;
+        }
+      else if (include_props)
+        {
+          SVN_ERR(svn_fs_fs__get_node_revision(&noderev, fs, id, pool));
+          if (noderev->prop_rep && ! noderev->prop_rep->txn_id)
+            APR_ARRAY_PUSH(prop_reps, representation_t *) = noderev->prop_rep;
+        }
+    }
+
+  /* Read them in a single pass over each revision file. */
+  qsort(to_read->elts, to_read->nelts, to_read->elt_size,
+        compare_id_location);
+  for (i = 0; i < to_read->nelts; i++)
+    {
+      const svn_fs_id_t *id = APR_ARRAY_IDX(to_read, i, const svn_fs_id_t *);
+      svn_revnum_t rev = svn_fs_fs__id_rev(id);
+      node_revision_t *noderev;
+      apr_off_t offset;
+
+      svn_pool_clear(iterpool);
+      if (rev != file_rev)
+        {
+          if (rev_file)
+            SVN_ERR(svn_io_file_close(rev_file, pool));
+
+          SVN_ERR(ensure_revision_exists(fs, rev, pool));
+          SVN_ERR(open_pack_or_rev_file(&rev_file, fs, rev, pool));
+          rev_offset = 0;
+          if (is_packed_rev(fs, rev))
+            SVN_ERR(get_packed_offset(&rev_offset, fs, rev, pool));
+
+          file_rev = rev;
+        }
+
+      offset = rev_offset + svn_fs_fs__id_offset(id);
+      SVN_ERR(svn_io_file_seek(rev_file, APR_SET, &offset, iterpool));
+      SVN_ERR(svn_fs_fs__read_noderev(&noderev,
+                                      svn_stream_from_aprfile2(rev_file,
+                                                               TRUE,
+                                                               iterpool),
+                                      pool));
+
+      /* Workaround issue #4031: is-fresh-txn-root in revision files. */
+      noderev->is_fresh_txn_root = FALSE;
+      SVN_ERR(set_cached_node_revision_body(noderev, fs, id, iterpool));
+
+      if (include_props && noderev->prop_rep && ! noderev->prop_rep->txn_id)
+        APR_ARRAY_PUSH(prop_reps, representation_t *) = noderev->prop_rep;
+    }
+
+  if (rev_file)
+    SVN_ERR(svn_io_file_close(rev_file, pool));
+
+  /* Then read the property lists that are not cached yet, again ordered
+     by location. */
+  qsort(prop_reps->elts, prop_reps->nelts, prop_reps->elt_size,
+        compare_rep_location);
+  for (i = 0; i < prop_reps->nelts; i++)
+    {
+      representation_t *rep = APR_ARRAY_IDX(prop_reps, i,
+                                            representation_t *);
+      apr_hash_t *proplist;
+      svn_boolean_t found;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(cache_has_key(&found, ffd->properties_cache,
+                            get_properties_cache_key(rep, iterpool),
+                            iterpool));
+      if (! found)
+        SVN_ERR(get_rep_proplist(&proplist, fs, rep, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+
 /* Return a formatted string, compatible with filesystem format FORMAT,
    that represents the location of representation REP.  If
    MUTABLE_REP_TRUNCATED is given, the rep is for props or dir contents,
@@ -5356,6 +5553,41 @@ svn_fs_fs__rep_contents_dir_entry(svn_fs_dirent_t **dirent,
   return SVN_NO_ERROR;
 }
 
+/* Set *PROPLIST_P to the property list stored in the committed
+   representation REP in FS, using and populating the property cache.
+   Allocate *PROPLIST_P in POOL. */
+static svn_error_t *
+get_rep_proplist(apr_hash_t **proplist_p,
+                 svn_fs_t *fs,
+                 representation_t *rep,
+                 apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  const char *key = NULL;
+  svn_stream_t *stream;
+
+  if (ffd->properties_cache)
+    {
+      svn_boolean_t is_cached;
+
+      key = get_properties_cache_key(rep, pool);
+      SVN_ERR(svn_cache__get((void **) proplist_p, &is_cached,
+                             ffd->properties_cache, key, pool));
+      if (is_cached)
+        return SVN_NO_ERROR;
+    }
+
+  *proplist_p = apr_hash_make(pool);
+  SVN_ERR(read_representation(&stream, fs, rep, pool));
+  SVN_ERR(svn_hash_read2(*proplist_p, stream, SVN_HASH_TERMINATOR, pool));
+  SVN_ERR(svn_stream_close(stream));
+
+  if (key)
+    SVN_ERR(svn_cache__set(ffd->properties_cache, key, *proplist_p, pool));
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_fs_fs__get_proplist(apr_hash_t **proplist_p,
                         svn_fs_t *fs,
@@ -5377,9 +5609,7 @@ svn_fs_fs__get_proplist(apr_hash_t **proplist_p,
     }
   else if (noderev->prop_rep)
     {
-      SVN_ERR(read_representation(&stream, fs, noderev->prop_rep, pool));
-      SVN_ERR(svn_hash_read2(proplist, stream, SVN_HASH_TERMINATOR, pool));
-      SVN_ERR(svn_stream_close(stream));
+      SVN_ERR(get_rep_proplist(&proplist, fs, noderev->prop_rep, pool));
     }
 
   *proplist_p = proplist;
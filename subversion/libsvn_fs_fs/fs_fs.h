@@ -73,6 +73,17 @@ svn_error_t *svn_fs_fs__get_node_revision(node_revision_t **noderev_p,
                                           const svn_fs_id_t *id,
                                           apr_pool_t *pool);
 
+/* Read the node-revisions for the node IDs (const svn_fs_id_t *) in FS
+   that are not in the node-revision cache yet into that cache, in the
+   order of their location in the revision files.  If INCLUDE_PROPS is set,
+   do the same for their property lists.  Do nothing if caching has been
+   disabled.  Mutable nodes will be skipped.  Use POOL for temporary
+   allocations. */
+svn_error_t *svn_fs_fs__prefetch_node_revisions(svn_fs_t *fs,
+                                               const apr_array_header_t *ids,
+                                               svn_boolean_t include_props,
+                                               apr_pool_t *pool);
+
 /* Store NODEREV as the node-revision for the node whose id is ID in
    FS, after setting its is_fresh_txn_root to FRESH_TXN_ROOT.  Do any
    necessary temporary allocation in POOL. */
@@ -1809,6 +1809,52 @@ fs_dir_entries(apr_hash_t **table_p,
   return svn_fs_fs__dag_dir_entries(table_p, node, pool);
 }
 
+/* Implements root_vtable_t.prefetch_dir.  Load the node-revisions and
+   property lists of the entries NAMES (all if NULL) of directory PATH in
+   ROOT into the caches in a single sorted pass over the revision files. */
+static svn_error_t *
+fs_prefetch_dir(svn_fs_root_t *root,
+                const char *path,
+                const apr_array_header_t *names,
+                apr_pool_t *pool)
+{
+  dag_node_t *node;
+  apr_hash_t *entries;
+  apr_hash_index_t *hi;
+  apr_array_header_t *ids;
+  int i;
+
+  /* Transaction contents are not cached anyway. */
+  if (root->is_txn_root)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(get_dag(&node, root, path, pool));
+  SVN_ERR(svn_fs_fs__dag_dir_entries(&entries, node, pool));
+
+  ids = apr_array_make(pool, apr_hash_count(entries),
+                       sizeof(const svn_fs_id_t *));
+  if (names)
+    {
+      for (i = 0; i < names->nelts; i++)
+        {
+          svn_fs_dirent_t *dirent
+            = apr_hash_get(entries, APR_ARRAY_IDX(names, i, const char *),
+                           APR_HASH_KEY_STRING);
+          if (dirent)
+            APR_ARRAY_PUSH(ids, const svn_fs_id_t *) = dirent->id;
+        }
+    }
+  else
+    {
+      for (hi = apr_hash_first(pool, entries); hi; hi = apr_hash_next(hi))
+        {
+          svn_fs_dirent_t *dirent = svn__apr_hash_index_val(hi);
+          APR_ARRAY_PUSH(ids, const svn_fs_id_t *) = dirent->id;
+        }
+    }
+
+  return svn_fs_fs__prefetch_node_revisions(root->fs, ids, TRUE, pool);
+}
 
 /* Create a new directory named PATH in ROOT.  The new directory has
    no entries, and no properties.  ROOT must be the root of a
@@ -3656,6 +3702,7 @@ static root_vtable_t root_vtable = {
   fs_get_file_delta_stream,
   fs_merge,
   fs_get_mergeinfo,
+  fs_prefetch_dir,
 };
 
 /* Construct a new root object in FS, allocated from POOL.  */
@@ -47,6 +47,7 @@
 #include "ra_loader.h"
 
 #include "private/svn_ra_private.h"
+#include "private/svn_subr_private.h"
 #include "svn_private_config.h"
 
 
@@ -748,6 +749,95 @@ svn_error_t *svn_ra_get_file(svn_ra_session_t *session,
                                    fetched_rev, props, pool);
 }
 
+/* Parameters of the spill buffers that get_files_one_by_one() keeps file
+   contents in until the handler has provided a stream for them. */
+#define GET_FILES_SPILL_BLOCK_SIZE (16 * 1024)
+#define GET_FILES_SPILL_MAX_MEMORY (1024 * 1024)
+
+/* Implement svn_ra_get_files() on top of svn_ra_get_file(). */
+static svn_error_t *
+get_files_one_by_one(svn_ra_session_t *session,
+                     const apr_array_header_t *requests,
+                     svn_boolean_t want_props,
+                     svn_boolean_t want_contents,
+                     svn_ra_file_handler_t handler,
+                     void *handler_baton,
+                     apr_pool_t *pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i;
+
+  for (i = 0; i < requests->nelts; i++)
+    {
+      const svn_ra_file_request_t *request
+        = APR_ARRAY_IDX(requests, i, const svn_ra_file_request_t *);
+      svn_revnum_t fetched_rev;
+      apr_hash_t *props = NULL;
+      svn_stream_t *contents = NULL;
+      svn_stream_t *stream = NULL;
+
+      svn_pool_clear(iterpool);
+
+      /* The handler only provides its stream once it has seen the
+         revision and properties, which svn_ra_get_file() returns along
+         with the contents.  Buffer the contents rather than fetching
+         the file twice. */
+      if (want_contents)
+        contents = svn_stream__from_spillbuf(GET_FILES_SPILL_BLOCK_SIZE,
+                                             GET_FILES_SPILL_MAX_MEMORY,
+                                             iterpool);
+      SVN_ERR(session->vtable->get_file(session, request->path,
+                                        request->revision, contents,
+                                        &fetched_rev,
+                                        want_props ? &props : NULL,
+                                        iterpool));
+      SVN_ERR(handler(handler_baton, &stream, request, fetched_rev, props,
+                      iterpool));
+      if (contents && stream)
+        SVN_ERR(svn_stream_copy3(contents, svn_stream_disown(stream,
+                                                             iterpool),
+                                 NULL, NULL, iterpool));
+    }
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *svn_ra_get_files(svn_ra_session_t *session,
+                              const apr_array_header_t *requests,
+                              svn_boolean_t want_props,
+                              svn_boolean_t want_contents,
+                              svn_ra_file_handler_t handler,
+                              void *handler_baton,
+                              apr_pool_t *pool)
+{
+  int i;
+
+  for (i = 0; i < requests->nelts; i++)
+    {
+      const svn_ra_file_request_t *request
+        = APR_ARRAY_IDX(requests, i, const svn_ra_file_request_t *);
+
+      SVN_ERR_ASSERT(*request->path != '/');
+    }
+
+  if (session->vtable->get_files)
+    {
+      svn_error_t *err = session->vtable->get_files(session, requests,
+                                                    want_props,
+                                                    want_contents, handler,
+                                                    handler_baton, pool);
+
+      if (! err || err->apr_err != SVN_ERR_RA_NOT_IMPLEMENTED)
+        return svn_error_trace(err);
+      svn_error_clear(err);
+    }
+
+  return svn_error_trace(get_files_one_by_one(session, requests, want_props,
+                                              want_contents, handler,
+                                              handler_baton, pool));
+}
+
 svn_error_t *svn_ra_get_dir(svn_ra_session_t *session,
                             const char *path,
                             svn_revnum_t revision,
@@ -1330,6 +1420,33 @@ svn_ra__get_commit_ev2(svn_editor_t **editor,
                            result_pool, scratch_pool));
 }
 
+svn_error_t *
+svn_ra__get_file_blame(svn_ra_session_t *session,
+                       const char *path,
+                       svn_revnum_t start,
+                       svn_revnum_t end,
+                       const svn_diff_file_options_t *diff_options,
+                       svn_boolean_t ignore_mime_type,
+                       svn_ra__blame_receiver_t receiver,
+                       void *receiver_baton,
+                       apr_pool_t *pool)
+{
+  SVN_ERR_ASSERT(*path != '/');
+
+  if (session->vtable->get_file_blame == NULL)
+    return svn_error_create(SVN_ERR_RA_NOT_IMPLEMENTED, NULL,
+                            _("Server-side blame is not supported by this "
+                              "repository access method"));
+
+  return svn_error_trace(session->vtable->get_file_blame(session, path,
+                                                         start, end,
+                                                         diff_options,
+                                                         ignore_mime_type,
+                                                         receiver,
+                                                         receiver_baton,
+                                                         pool));
+}
+
 
 
 svn_error_t *
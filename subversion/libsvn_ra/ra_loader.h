@@ -318,6 +318,28 @@ typedef struct svn_ra__vtable_t {
     apr_pool_t *result_pool,
     apr_pool_t *scratch_pool);
 
+  /* See svn_ra__get_file_blame(). */
+  svn_error_t *(*get_file_blame)(svn_ra_session_t *session,
+                                 const char *path,
+                                 svn_revnum_t start,
+                                 svn_revnum_t end,
+                                 const svn_diff_file_options_t *diff_options,
+                                 svn_boolean_t ignore_mime_type,
+                                 svn_ra__blame_receiver_t receiver,
+                                 void *receiver_baton,
+                                 apr_pool_t *pool);
+
+  /* See svn_ra_get_files().  May be NULL or return
+     SVN_ERR_RA_NOT_IMPLEMENTED without having invoked HANDLER, in which
+     case the files get fetched one by one. */
+  svn_error_t *(*get_files)(svn_ra_session_t *session,
+                            const apr_array_header_t *requests,
+                            svn_boolean_t want_props,
+                            svn_boolean_t want_contents,
+                            svn_ra_file_handler_t handler,
+                            void *handler_baton,
+                            apr_pool_t *pool);
+
 } svn_ra__vtable_t;
 
 /* The RA session object. */
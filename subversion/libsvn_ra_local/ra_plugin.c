@@ -1597,6 +1597,28 @@ svn_ra_local__get_commit_ev2(svn_editor_t **editor,
                            result_pool, scratch_pool));
 }
 
+static svn_error_t *
+svn_ra_local__get_file_blame(svn_ra_session_t *session,
+                             const char *path,
+                             svn_revnum_t start,
+                             svn_revnum_t end,
+                             const svn_diff_file_options_t *diff_options,
+                             svn_boolean_t ignore_mime_type,
+                             svn_ra__blame_receiver_t receiver,
+                             void *receiver_baton,
+                             apr_pool_t *pool)
+{
+  svn_ra_local__session_baton_t *sess = session->priv;
+  const char *abs_path = svn_fspath__join(sess->fs_path->data, path, pool);
+
+  return svn_error_trace(svn_repos__get_file_blame(sess->repos, abs_path,
+                                                   start, end, diff_options,
+                                                   ignore_mime_type,
+                                                   NULL, NULL,
+                                                   receiver, receiver_baton,
+                                                   pool));
+}
+
 /*----------------------------------------------------------------*/
 
 static const svn_version_t *
@@ -1645,7 +1667,8 @@ static const svn_ra__vtable_t ra_local_vtable =
   svn_ra_local__replay_range,
   svn_ra_local__get_deleted_rev,
   svn_ra_local__register_editor_shim_callbacks,
-  svn_ra_local__get_commit_ev2
+  svn_ra_local__get_commit_ev2,
+  svn_ra_local__get_file_blame
 };
 
 
@@ -31,6 +31,8 @@
 #include <apr_strings.h>
 #include <apr_network_io.h>
 #include <apr_uri.h>
+#include <apr_thread_mutex.h>
+#include <apr_thread_cond.h>
 
 #include "svn_types.h"
 #include "svn_string.h"
@@ -49,6 +51,8 @@
 #include "svn_private_config.h"
 
 #include "private/svn_fspath.h"
+#include "private/svn_subr_private.h"
+#include "private/svn_thread_pool.h"
 
 #include "../libsvn_ra/ra_loader.h"
 
@@ -69,6 +73,18 @@
 #define DEPTH_TO_RECURSE(d)    \
         ((d) == svn_depth_unknown || (d) > svn_depth_files)
 
+/* Upper limit for the svn-max-connections setting. */
+#define MAX_CONNECTIONS 16
+
+/* Upper limit for the svn-read-ahead setting. */
+#define MAX_READ_AHEAD 1024
+
+/* File texts fetched over auxiliary connections are buffered in memory
+   in blocks of this size, up to the given limit per file.  Larger texts
+   spill to a temporary file. */
+#define FETCH_SPILL_BLOCK_SIZE (16 * 1024)
+#define FETCH_SPILL_MAX_MEMORY (1024 * 1024)
+
 typedef struct ra_svn_commit_callback_baton_t {
   svn_ra_svn__session_baton_t *sess_baton;
   apr_pool_t *pool;
@@ -586,6 +602,8 @@ static svn_error_t *open_session(svn_ra_svn__session_baton_t **sess_p,
   sess->callbacks = callbacks;
   sess->callbacks_baton = callbacks_baton;
   sess->bytes_read = sess->bytes_written = 0;
+  sess->max_connections = 1;
+  sess->read_ahead = 0;
 
   if (tunnel_argv)
     SVN_ERR(make_tunnel(tunnel_argv, &conn, pool));
@@ -631,7 +649,7 @@ static svn_error_t *open_session(svn_ra_svn__session_baton_t **sess_p,
    * capability list, and the URL, and subsequently there is an auth
    * request. */
   /* Client-side capabilities list: */
-  SVN_ERR(svn_ra_svn_write_tuple(conn, pool, "n(wwwwww)cc(?c)",
+  SVN_ERR(svn_ra_svn_write_tuple(conn, pool, "n(wwwwwww)cc(?c)",
                                  (apr_uint64_t) 2,
                                  SVN_RA_SVN_CAP_EDIT_PIPELINE,
                                  SVN_RA_SVN_CAP_SVNDIFF1,
@@ -639,11 +657,18 @@ static svn_error_t *open_session(svn_ra_svn__session_baton_t **sess_p,
                                  SVN_RA_SVN_CAP_DEPTH,
                                  SVN_RA_SVN_CAP_MERGEINFO,
                                  SVN_RA_SVN_CAP_LOG_REVPROPS,
+                                 SVN_RA_SVN_CAP_ZLIB_STREAM,
                                  url, "SVN/" SVN_VER_NUMBER, client_string));
+
   SVN_ERR(handle_auth_request(sess, pool));
 
-  /* This is where the security layer would go into effect if we
-   * supported security layers, which is a ways off. */
+  /* Everything after authentication is compressed if the server offered
+     that; it will also have seen that we support it.  Compressing on top
+     of a SASL security layer would only waste cycles on data that does
+     not compress, so neither side does. */
+  if (svn_ra_svn_has_capability(conn, SVN_RA_SVN_CAP_ZLIB_STREAM)
+      && ! svn_ra_svn__is_encrypted(conn))
+    SVN_ERR(svn_ra_svn__enable_stream_compression(conn, pool));
 
   /* Read the repository's uuid and root URL, and perhaps learn more
      capabilities that weren't available before now. */
@@ -707,6 +732,8 @@ static svn_error_t *ra_svn_open(svn_ra_session_t *session,
   const char *tunnel, **tunnel_argv;
   apr_uri_t uri;
   svn_config_t *cfg, *cfg_client;
+  apr_int64_t max_connections = 1;
+  apr_int64_t read_ahead = 0;
 
   /* We don't support server-prescribed redirections in ra-svn. */
   if (corrected_url)
@@ -733,10 +760,30 @@ static svn_error_t *ra_svn_open(svn_ra_session_t *session,
   svn_auth_set_parameter(callbacks->auth_baton,
                          SVN_AUTH_PARAM_CONFIG_CATEGORY_SERVERS, cfg);
 
+  if (cfg)
+    {
+      const char *server_group;
+
+      server_group = svn_config_find_group(cfg, uri.hostname,
+                                           SVN_CONFIG_SECTION_GROUPS, pool);
+      SVN_ERR(svn_config_get_server_setting_int(
+                cfg, server_group, SVN_CONFIG_OPTION_SVN_MAX_CONNECTIONS,
+                1, &max_connections, pool));
+      SVN_ERR(svn_config_get_server_setting_int(
+                cfg, server_group, SVN_CONFIG_OPTION_SVN_READ_AHEAD,
+                0, &read_ahead, pool));
+    }
+
   /* We open the session in a subpool so we can get rid of it if we
      reparent with a server that doesn't support reparenting. */
   SVN_ERR(open_session(&sess, url, &uri, tunnel_argv,
                        callbacks, callback_baton, sess_pool));
+  if (max_connections > MAX_CONNECTIONS)
+    max_connections = MAX_CONNECTIONS;
+  sess->max_connections = max_connections > 1 ? (int)max_connections : 1;
+  if (read_ahead > MAX_READ_AHEAD)
+    read_ahead = MAX_READ_AHEAD;
+  sess->read_ahead = read_ahead > 0 ? (int)read_ahead : 0;
   session->priv = sess;
 
   return SVN_NO_ERROR;
@@ -782,6 +829,8 @@ static svn_error_t *ra_svn_reparent(svn_ra_session_t *ra_session,
     }
 
   /* We have a new connection, assign it and destroy the old. */
+  new_sess->max_connections = sess->max_connections;
+  new_sess->read_ahead = sess->read_ahead;
   ra_session->priv = new_sess;
   svn_pool_destroy(sess->pool);
 
@@ -1009,23 +1058,107 @@ static svn_error_t *ra_svn_commit(svn_ra_session_t *session,
   return SVN_NO_ERROR;
 }
 
-static svn_error_t *ra_svn_get_file(svn_ra_session_t *session, const char *path,
-                                    svn_revnum_t rev, svn_stream_t *stream,
-                                    svn_revnum_t *fetched_rev,
-                                    apr_hash_t **props,
-                                    apr_pool_t *pool)
+/* Baton for file_contents_write(). */
+typedef struct file_contents_baton_t
 {
-  svn_ra_svn__session_baton_t *sess_baton = session->priv;
-  svn_ra_svn_conn_t *conn = sess_baton->conn;
-  apr_array_header_t *proplist;
-  const char *expected_digest;
-  svn_checksum_t *expected_checksum = NULL;
   svn_checksum_ctx_t *checksum_ctx;
+  svn_stream_t *stream;
+} file_contents_baton_t;
+
+/* Implements svn_write_fn_t.  Add DATA to the checksum in the
+   file_contents_baton_t BATON and pass it on to its stream. */
+static svn_error_t *file_contents_write(void *baton,
+                                        const char *data,
+                                        apr_size_t *len)
+{
+  file_contents_baton_t *b = baton;
+
+  if (b->checksum_ctx)
+    SVN_ERR(svn_checksum_update(b->checksum_ctx, data, *len));
+  if (b->stream)
+    SVN_ERR(svn_stream_write(b->stream, data, len));
+
+  return SVN_NO_ERROR;
+}
+
+/* Read the strings that make up a file's contents from CONN, up to the
+   empty string that terminates them, and push them to STREAM unless it
+   is NULL.  If EXPECTED_DIGEST is not NULL, set *CHECKSUM to the MD5
+   checksum of the contents, otherwise to NULL. */
+static svn_error_t *read_file_contents(svn_checksum_t **checksum,
+                                       svn_stream_t *stream,
+                                       svn_ra_svn_conn_t *conn,
+                                       const char *expected_digest,
+                                       apr_pool_t *pool)
+{
+  file_contents_baton_t baton;
+  svn_stream_t *contents;
   apr_pool_t *iterpool;
+  apr_uint64_t len;
+
+  baton.checksum_ctx = expected_digest
+                     ? svn_checksum_ctx_create(svn_checksum_md5, pool)
+                     : NULL;
+  baton.stream = stream;
+  contents = svn_stream_create(&baton, pool);
+  svn_stream_set_write(contents, file_contents_write);
+
+  /* The data goes from the read buffer straight to the stream. */
+  iterpool = svn_pool_create(pool);
+  do
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_ra_svn__read_string_to_stream(conn, iterpool, contents,
+                                                &len));
+    }
+  while (len > 0);
+  svn_pool_destroy(iterpool);
+
+  *checksum = NULL;
+  if (baton.checksum_ctx)
+    SVN_ERR(svn_checksum_final(checksum, baton.checksum_ctx, pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Return an error if CHECKSUM, as returned by read_file_contents() for
+   the file at PATH, does not match EXPECTED_DIGEST. */
+static svn_error_t *check_file_checksum(const svn_checksum_t *checksum,
+                                        const char *expected_digest,
+                                        const char *path,
+                                        apr_pool_t *pool)
+{
+  svn_checksum_t *expected_checksum;
+
+  if (! expected_digest)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_checksum_parse_hex(&expected_checksum, svn_checksum_md5,
+                                 expected_digest, pool));
+  if (!svn_checksum_match(checksum, expected_checksum))
+    return svn_checksum_mismatch_err(expected_checksum, checksum, pool,
+                                     _("Checksum mismatch for '%s'"),
+                                     path);
+
+  return SVN_NO_ERROR;
+}
+
+/* Read the response to a get-file command for PATH from CONN, following
+   the auth exchange.  Set *FETCHED_REV and *PROPS unless they are NULL.
+   Write the file's contents to STREAM, which must be NULL if and only if
+   the contents were not requested. */
+static svn_error_t *read_get_file_response(svn_revnum_t *fetched_rev,
+                                           apr_hash_t **props,
+                                           svn_stream_t *stream,
+                                           svn_ra_svn_conn_t *conn,
+                                           const char *path,
+                                           apr_pool_t *pool)
+{
+  apr_array_header_t *proplist;
+  const char *expected_digest;
+  svn_revnum_t rev;
+  svn_checksum_t *checksum;
 
-  SVN_ERR(svn_ra_svn_write_cmd(conn, pool, "get-file", "c(?r)bb", path,
-                               rev, (props != NULL), (stream != NULL)));
-  SVN_ERR(handle_auth_request(sess_baton, pool));
   SVN_ERR(svn_ra_svn_read_cmd_response(conn, pool, "(?c)rl",
                                        &expected_digest,
                                        &rev, &proplist));
@@ -1039,50 +1172,105 @@ static svn_error_t *ra_svn_get_file(svn_ra_session_t *session, const char *path,
   if (!stream)
     return SVN_NO_ERROR;
 
-  if (expected_digest)
+  SVN_ERR(read_file_contents(&checksum, stream, conn, expected_digest,
+                             pool));
+  SVN_ERR(svn_ra_svn_read_cmd_response(conn, pool, ""));
+
+  return svn_error_trace(check_file_checksum(checksum, expected_digest,
+                                             path, pool));
+}
+
+static svn_error_t *ra_svn_get_file(svn_ra_session_t *session, const char *path,
+                                    svn_revnum_t rev, svn_stream_t *stream,
+                                    svn_revnum_t *fetched_rev,
+                                    apr_hash_t **props,
+                                    apr_pool_t *pool)
+{
+  svn_ra_svn__session_baton_t *sess_baton = session->priv;
+  svn_ra_svn_conn_t *conn = sess_baton->conn;
+
+  SVN_ERR(svn_ra_svn_write_cmd(conn, pool, "get-file", "c(?r)bb", path,
+                               rev, (props != NULL), (stream != NULL)));
+  SVN_ERR(handle_auth_request(sess_baton, pool));
+
+  return svn_error_trace(read_get_file_response(fetched_rev, props, stream,
+                                                conn, path, pool));
+}
+
+static svn_error_t *ra_svn_get_files(svn_ra_session_t *session,
+                                     const apr_array_header_t *requests,
+                                     svn_boolean_t want_props,
+                                     svn_boolean_t want_contents,
+                                     svn_ra_file_handler_t handler,
+                                     void *handler_baton,
+                                     apr_pool_t *pool)
+{
+  svn_ra_svn__session_baton_t *sess_baton = session->priv;
+  svn_ra_svn_conn_t *conn = sess_baton->conn;
+  apr_pool_t *iterpool;
+  int i;
+
+  if (! svn_ra_svn_has_capability(conn, SVN_RA_SVN_CAP_GET_FILES))
+    return svn_error_create(SVN_ERR_RA_NOT_IMPLEMENTED, NULL,
+                            _("Server does not support fetching several "
+                              "files at once"));
+
+  iterpool = svn_pool_create(pool);
+  SVN_ERR(svn_ra_svn_write_tuple(conn, pool, "w((!", "get-files"));
+  for (i = 0; i < requests->nelts; i++)
     {
-      SVN_ERR(svn_checksum_parse_hex(&expected_checksum, svn_checksum_md5,
-                                     expected_digest, pool));
-      checksum_ctx = svn_checksum_ctx_create(svn_checksum_md5, pool);
+      const svn_ra_file_request_t *request
+        = APR_ARRAY_IDX(requests, i, const svn_ra_file_request_t *);
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_ra_svn_write_tuple(conn, iterpool, "c(?r)", request->path,
+                                     request->revision));
     }
+  SVN_ERR(svn_ra_svn_write_tuple(conn, pool, "!)bb)", want_props,
+                                 want_contents));
+  SVN_ERR(handle_auth_request(sess_baton, pool));
 
-  /* Read the file's contents. */
-  iterpool = svn_pool_create(pool);
-  while (1)
+  /* Read the files until the server says "done", which it may do early
+     if it fails to send one of them. */
+  for (i = 0; ; i++)
     {
+      const svn_ra_file_request_t *request;
       svn_ra_svn_item_t *item;
+      const char *expected_digest;
+      svn_revnum_t rev;
+      apr_array_header_t *proplist;
+      apr_hash_t *props = NULL;
+      svn_stream_t *stream = NULL;
+      svn_checksum_t *checksum;
 
       svn_pool_clear(iterpool);
       SVN_ERR(svn_ra_svn_read_item(conn, iterpool, &item));
-      if (item->kind != SVN_RA_SVN_STRING)
-        return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
-                                _("Non-string as part of file contents"));
-      if (item->u.string->len == 0)
+      if (item->kind == SVN_RA_SVN_WORD && strcmp(item->u.word, "done") == 0)
         break;
+      if (item->kind != SVN_RA_SVN_LIST || i >= requests->nelts)
+        return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                                _("Unexpected data in get-files response"));
 
-      if (expected_checksum)
-        SVN_ERR(svn_checksum_update(checksum_ctx, item->u.string->data,
-                                    item->u.string->len));
-
-      SVN_ERR(svn_stream_write(stream, item->u.string->data,
-                               &item->u.string->len));
-    }
-  svn_pool_destroy(iterpool);
-
-  SVN_ERR(svn_ra_svn_read_cmd_response(conn, pool, ""));
+      request = APR_ARRAY_IDX(requests, i, const svn_ra_file_request_t *);
+      SVN_ERR(svn_ra_svn_parse_tuple(item->u.list, iterpool, "(?c)rl",
+                                     &expected_digest, &rev, &proplist));
+      if (want_props)
+        SVN_ERR(svn_ra_svn_parse_proplist(proplist, iterpool, &props));
 
-  if (expected_checksum)
-    {
-      svn_checksum_t *checksum;
+      SVN_ERR(handler(handler_baton, &stream, request, rev, props,
+                      iterpool));
 
-      SVN_ERR(svn_checksum_final(&checksum, checksum_ctx, pool));
-      if (!svn_checksum_match(checksum, expected_checksum))
-        return svn_checksum_mismatch_err(expected_checksum, checksum, pool,
-                                         _("Checksum mismatch for '%s'"),
-                                         path);
+      if (want_contents)
+        {
+          SVN_ERR(read_file_contents(&checksum, stream, conn,
+                                     expected_digest, iterpool));
+          SVN_ERR(check_file_checksum(checksum, expected_digest,
+                                      request->path, iterpool));
+        }
     }
+  svn_pool_destroy(iterpool);
 
-  return SVN_NO_ERROR;
+  return svn_ra_svn_read_cmd_response(conn, pool, "");
 }
 
 static svn_error_t *ra_svn_get_dir(svn_ra_session_t *session,
@@ -1241,170 +1429,990 @@ static svn_error_t *ra_svn_get_mergeinfo(svn_ra_session_t *session,
   return SVN_NO_ERROR;
 }
 
-static svn_error_t *ra_svn_update(svn_ra_session_t *session,
-                                  const svn_ra_reporter3_t **reporter,
-                                  void **report_baton, svn_revnum_t rev,
-                                  const char *target, svn_depth_t depth,
-                                  svn_boolean_t send_copyfrom_args,
-                                  const svn_delta_editor_t *update_editor,
-                                  void *update_baton, apr_pool_t *pool)
+/* --- FETCHING FILE TEXTS OVER AUXILIARY CONNECTIONS --- */
+
+/* An update with more than one connection asks the server to leave out
+   the file texts and drives the update editor through the editor below.
+   It fetches the text of every changed file with get-file over one of
+   the auxiliary sessions, on a worker thread per session, while the main
+   connection keeps delivering the tree changes.
+
+   Files are closed in the wrapped editor in the order in which the edit
+   drive closed them, once their text has arrived.  Directories stay open
+   in the wrapped editor until all files within them have been closed. */
+
+typedef struct fetch_file_baton_t fetch_file_baton_t;
+
+typedef struct fetch_edit_baton_t
 {
-  svn_ra_svn__session_baton_t *sess_baton = session->priv;
-  svn_ra_svn_conn_t *conn = sess_baton->conn;
-  svn_boolean_t recurse = DEPTH_TO_RECURSE(depth);
+  const svn_delta_editor_t *wrapped_editor;
+  void *wrapped_baton;
 
-  /* Tell the server we want to start an update. */
-  SVN_ERR(svn_ra_svn_write_cmd(conn, pool, "update", "(?r)cbwb", rev, target,
-                               recurse, svn_depth_to_word(depth),
-                               send_copyfrom_args));
-  SVN_ERR(handle_auth_request(sess_baton, pool));
+  /* The revision to fetch the texts from. */
+  svn_revnum_t revision;
 
-  /* Fetch a reporter for the caller to drive.  The reporter will drive
-   * update_editor upon finish_report(). */
-  SVN_ERR(ra_svn_get_reporter(sess_baton, pool, update_editor, update_baton,
-                              target, depth, reporter, report_baton));
-  return SVN_NO_ERROR;
-}
+  svn_thread_pool__t *thread_pool;
 
-static svn_error_t *ra_svn_switch(svn_ra_session_t *session,
-                                  const svn_ra_reporter3_t **reporter,
-                                  void **report_baton, svn_revnum_t rev,
-                                  const char *target, svn_depth_t depth,
-                                  const char *switch_url,
-                                  const svn_delta_editor_t *update_editor,
-                                  void *update_baton, apr_pool_t *pool)
+  /* Auxiliary sessions (svn_ra_svn__session_baton_t *) without a pending
+     fetch. */
+  apr_array_header_t *idle_sessions;
+
+  /* Root pools of all auxiliary sessions. */
+  apr_array_header_t *session_pools;
+
+  /* Files whose texts are being fetched, oldest first. */
+  fetch_file_baton_t *first_pending;
+  fetch_file_baton_t *last_pending;
+
+  apr_pool_t *pool;
+} fetch_edit_baton_t;
+
+typedef struct fetch_dir_baton_t
 {
-  svn_ra_svn__session_baton_t *sess_baton = session->priv;
-  svn_ra_svn_conn_t *conn = sess_baton->conn;
-  svn_boolean_t recurse = DEPTH_TO_RECURSE(depth);
+  fetch_edit_baton_t *eb;
+  struct fetch_dir_baton_t *parent;
+  void *wrapped_baton;
 
-  /* Tell the server we want to start a switch. */
-  SVN_ERR(svn_ra_svn_write_cmd(conn, pool, "switch", "(?r)cbcw", rev,
-                               target, recurse, switch_url,
-                               svn_depth_to_word(depth)));
-  SVN_ERR(handle_auth_request(sess_baton, pool));
+  /* One for the edit drive until it closes the directory, plus one for
+     every subdirectory and file that is still open. */
+  int ref_count;
 
-  /* Fetch a reporter for the caller to drive.  The reporter will drive
-   * update_editor upon finish_report(). */
-  SVN_ERR(ra_svn_get_reporter(sess_baton, pool, update_editor, update_baton,
-                              target, depth, reporter, report_baton));
-  return SVN_NO_ERROR;
+  apr_pool_t *pool;
+} fetch_dir_baton_t;
+
+struct fetch_file_baton_t
+{
+  fetch_edit_baton_t *eb;
+  fetch_dir_baton_t *parent;
+  void *wrapped_baton;
+
+  /* Path of the file relative to the edit root. */
+  const char *path;
+
+  /* Whether the server announced a new text, and the checksums it sent
+     along with apply_textdelta and close_file, respectively. */
+  svn_boolean_t text_changed;
+  const char *base_checksum;
+  const char *text_checksum;
+
+  /* The auxiliary session fetching the text and the job doing that. */
+  svn_ra_svn__session_baton_t *session;
+  svn_thread_pool__job_t *job;
+
+  /* Set by the job: the text, or if the server asked for authentication
+     first, the mechanisms and realm of that request. */
+  svn_stream_t *contents;
+  apr_array_header_t *mechlist;
+  const char *realm;
+
+  fetch_file_baton_t *next;
+
+  apr_pool_t *pool;
+};
+
+/* Pool cleanup function for fetch_edit_baton_t.  Close the auxiliary
+   sessions.  All jobs are gone by now because their pools are sub-pools
+   of the edit pool. */
+static apr_status_t
+close_aux_sessions(void *baton)
+{
+  fetch_edit_baton_t *eb = baton;
+  int i;
+
+  for (i = 0; i < eb->session_pools->nelts; i++)
+    svn_pool_destroy(APR_ARRAY_IDX(eb->session_pools, i, apr_pool_t *));
+
+  return APR_SUCCESS;
 }
 
-static svn_error_t *ra_svn_status(svn_ra_session_t *session,
-                                  const svn_ra_reporter3_t **reporter,
-                                  void **report_baton,
-                                  const char *target, svn_revnum_t rev,
-                                  svn_depth_t depth,
-                                  const svn_delta_editor_t *status_editor,
-                                  void *status_baton, apr_pool_t *pool)
+/* Implements svn_thread_pool__task_t.  Fetch the text of the file
+   BATON over its auxiliary session. */
+static svn_error_t *
+fetch_text(void *baton,
+           apr_pool_t *result_pool,
+           apr_pool_t *scratch_pool)
 {
-  svn_ra_svn__session_baton_t *sess_baton = session->priv;
-  svn_ra_svn_conn_t *conn = sess_baton->conn;
-  svn_boolean_t recurse = DEPTH_TO_RECURSE(depth);
+  fetch_file_baton_t *fb = baton;
+  svn_ra_svn_conn_t *conn = fb->session->conn;
 
-  /* Tell the server we want to start a status operation. */
-  SVN_ERR(svn_ra_svn_write_cmd(conn, pool, "status", "cb(?r)w",
-                               target, recurse, rev,
-                               svn_depth_to_word(depth)));
-  SVN_ERR(handle_auth_request(sess_baton, pool));
+  SVN_ERR(svn_ra_svn_write_cmd(conn, scratch_pool, "get-file", "c(?r)bb",
+                               fb->path, fb->eb->revision, FALSE, TRUE));
 
-  /* Fetch a reporter for the caller to drive.  The reporter will drive
-   * status_editor upon finish_report(). */
-  SVN_ERR(ra_svn_get_reporter(sess_baton, pool, status_editor, status_baton,
-                              target, depth, reporter, report_baton));
-  return SVN_NO_ERROR;
+  /* Authenticating may involve prompting the user, so leave that to the
+     main thread. */
+  SVN_ERR(svn_ra_svn_read_cmd_response(conn, result_pool, "lc",
+                                       &fb->mechlist, &fb->realm));
+  if (fb->mechlist->nelts > 0)
+    return SVN_NO_ERROR;
+
+  fb->contents = svn_stream__from_spillbuf(FETCH_SPILL_BLOCK_SIZE,
+                                           FETCH_SPILL_MAX_MEMORY,
+                                           result_pool);
+  return svn_error_trace(read_get_file_response(NULL, NULL, fb->contents,
+                                                conn, fb->path,
+                                                scratch_pool));
 }
 
-static svn_error_t *ra_svn_diff(svn_ra_session_t *session,
-                                const svn_ra_reporter3_t **reporter,
-                                void **report_baton,
-                                svn_revnum_t rev, const char *target,
-                                svn_depth_t depth,
-                                svn_boolean_t ignore_ancestry,
-                                svn_boolean_t text_deltas,
-                                const char *versus_url,
-                                const svn_delta_editor_t *diff_editor,
-                                void *diff_baton, apr_pool_t *pool)
+/* Drop one reference to DB.  Once there are none left, close DB in the
+   wrapped editor and drop the reference it holds to its parent. */
+static svn_error_t *
+release_dir(fetch_dir_baton_t *db,
+            apr_pool_t *scratch_pool)
 {
-  svn_ra_svn__session_baton_t *sess_baton = session->priv;
-  svn_ra_svn_conn_t *conn = sess_baton->conn;
-  svn_boolean_t recurse = DEPTH_TO_RECURSE(depth);
+  while (db && --db->ref_count == 0)
+    {
+      fetch_dir_baton_t *parent = db->parent;
 
-  /* Tell the server we want to start a diff. */
-  SVN_ERR(svn_ra_svn_write_cmd(conn, pool, "diff", "(?r)cbbcbw", rev,
-                               target, recurse, ignore_ancestry,
-                               versus_url, text_deltas,
-                               svn_depth_to_word(depth)));
-  SVN_ERR(handle_auth_request(sess_baton, pool));
+      SVN_ERR(db->eb->wrapped_editor->close_directory(db->wrapped_baton,
+                                                      scratch_pool));
+      svn_pool_destroy(db->pool);
+      db = parent;
+    }
 
-  /* Fetch a reporter for the caller to drive.  The reporter will drive
-   * diff_editor upon finish_report(). */
-  SVN_ERR(ra_svn_get_reporter(sess_baton, pool, diff_editor, diff_baton,
-                              target, depth, reporter, report_baton));
   return SVN_NO_ERROR;
 }
 
-
-static svn_error_t *ra_svn_log(svn_ra_session_t *session,
-                               const apr_array_header_t *paths,
-                               svn_revnum_t start, svn_revnum_t end,
-                               int limit,
-                               svn_boolean_t discover_changed_paths,
-                               svn_boolean_t strict_node_history,
-                               svn_boolean_t include_merged_revisions,
-                               const apr_array_header_t *revprops,
-                               svn_log_entry_receiver_t receiver,
-                               void *receiver_baton, apr_pool_t *pool)
+/* Wait for the text of the oldest pending file in EB, hand it to the
+   wrapped editor and close that file. */
+static svn_error_t *
+finish_oldest_fetch(fetch_edit_baton_t *eb,
+                    apr_pool_t *scratch_pool)
 {
-  svn_ra_svn__session_baton_t *sess_baton = session->priv;
-  svn_ra_svn_conn_t *conn = sess_baton->conn;
-  apr_pool_t *iterpool;
-  int i;
-  int nest_level = 0;
-  const char *path;
-  char *name;
-  svn_boolean_t want_custom_revprops;
+  fetch_file_baton_t *fb = eb->first_pending;
+  fetch_dir_baton_t *parent = fb->parent;
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
 
-  SVN_ERR(svn_ra_svn_write_tuple(conn, pool, "w((!", "log"));
-  if (paths)
+  eb->first_pending = fb->next;
+  if (eb->first_pending == NULL)
+    eb->last_pending = NULL;
+
+  SVN_ERR(svn_thread_pool__wait(fb->job));
+  if (fb->contents == NULL)
     {
-      for (i = 0; i < paths->nelts; i++)
-        {
-          path = APR_ARRAY_IDX(paths, i, const char *);
-          SVN_ERR(svn_ra_svn_write_cstring(conn, pool, path));
-        }
+      SVN_ERR(DO_AUTH(fb->session, fb->mechlist, fb->realm, scratch_pool));
+      fb->contents = svn_stream__from_spillbuf(FETCH_SPILL_BLOCK_SIZE,
+                                               FETCH_SPILL_MAX_MEMORY,
+                                               fb->pool);
+      SVN_ERR(read_get_file_response(NULL, NULL, fb->contents,
+                                     fb->session->conn, fb->path,
+                                     scratch_pool));
     }
-  SVN_ERR(svn_ra_svn_write_tuple(conn, pool, "!)(?r)(?r)bbnb!", start, end,
-                                 discover_changed_paths, strict_node_history,
-                                 (apr_uint64_t) limit,
-                                 include_merged_revisions));
-  if (revprops)
-    {
-      want_custom_revprops = FALSE;
-      SVN_ERR(svn_ra_svn_write_tuple(conn, pool, "!w(!", "revprops"));
-      for (i = 0; i < revprops->nelts; i++)
-        {
-          name = APR_ARRAY_IDX(revprops, i, char *);
-          SVN_ERR(svn_ra_svn_write_cstring(conn, pool, name));
-          if (!want_custom_revprops
-              && strcmp(name, SVN_PROP_REVISION_AUTHOR) != 0
-              && strcmp(name, SVN_PROP_REVISION_DATE) != 0
-              && strcmp(name, SVN_PROP_REVISION_LOG) != 0)
-            want_custom_revprops = TRUE;
-        }
-      SVN_ERR(svn_ra_svn_write_tuple(conn, pool, "!))"));
+  APR_ARRAY_PUSH(eb->idle_sessions, svn_ra_svn__session_baton_t *)
+    = fb->session;
+
+  /* A delta without source references applies to any base text. */
+  SVN_ERR(eb->wrapped_editor->apply_textdelta(fb->wrapped_baton,
+                                              fb->base_checksum, fb->pool,
+                                              &handler, &handler_baton));
+  SVN_ERR(svn_txdelta_send_stream(fb->contents, handler, handler_baton,
+                                  NULL, scratch_pool));
+  SVN_ERR(eb->wrapped_editor->close_file(fb->wrapped_baton,
+                                         fb->text_checksum, scratch_pool));
+
+  svn_pool_destroy(fb->pool);
+  return svn_error_trace(release_dir(parent, scratch_pool));
+}
+
+/* Return a new directory baton for EB below PARENT, which may be NULL
+   for the edit root. */
+static fetch_dir_baton_t *
+make_fetch_dir_baton(fetch_edit_baton_t *eb,
+                     fetch_dir_baton_t *parent)
+{
+  apr_pool_t *pool = svn_pool_create(parent ? parent->pool : eb->pool);
+  fetch_dir_baton_t *db = apr_pcalloc(pool, sizeof(*db));
+
+  db->eb = eb;
+  db->parent = parent;
+  db->ref_count = 1;
+  db->pool = pool;
+  if (parent)
+    parent->ref_count++;
+
+  return db;
+}
+
+/* Return a new baton for the file at PATH in PARENT. */
+static fetch_file_baton_t *
+make_fetch_file_baton(fetch_dir_baton_t *parent,
+                      const char *path)
+{
+  apr_pool_t *pool = svn_pool_create(parent->pool);
+  fetch_file_baton_t *fb = apr_pcalloc(pool, sizeof(*fb));
+
+  fb->eb = parent->eb;
+  fb->parent = parent;
+  fb->path = apr_pstrdup(pool, path);
+  fb->pool = pool;
+  parent->ref_count++;
+
+  return fb;
+}
+
+static svn_error_t *
+fetch_set_target_revision(void *edit_baton,
+                          svn_revnum_t target_revision,
+                          apr_pool_t *pool)
+{
+  fetch_edit_baton_t *eb = edit_baton;
+
+  eb->revision = target_revision;
+  return eb->wrapped_editor->set_target_revision(eb->wrapped_baton,
+                                                 target_revision, pool);
+}
+
+static svn_error_t *
+fetch_open_root(void *edit_baton,
+                svn_revnum_t base_revision,
+                apr_pool_t *dir_pool,
+                void **root_baton)
+{
+  fetch_edit_baton_t *eb = edit_baton;
+  fetch_dir_baton_t *db = make_fetch_dir_baton(eb, NULL);
+
+  SVN_ERR(eb->wrapped_editor->open_root(eb->wrapped_baton, base_revision,
+                                        db->pool, &db->wrapped_baton));
+  *root_baton = db;
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+fetch_delete_entry(const char *path,
+                   svn_revnum_t base_revision,
+                   void *parent_baton,
+                   apr_pool_t *pool)
+{
+  fetch_dir_baton_t *pb = parent_baton;
+
+  return pb->eb->wrapped_editor->delete_entry(path, base_revision,
+                                              pb->wrapped_baton, pool);
+}
+
+static svn_error_t *
+fetch_add_directory(const char *path,
+                    void *parent_baton,
+                    const char *copyfrom_path,
+                    svn_revnum_t copyfrom_revision,
+                    apr_pool_t *dir_pool,
+                    void **child_baton)
+{
+  fetch_dir_baton_t *pb = parent_baton;
+  fetch_dir_baton_t *db = make_fetch_dir_baton(pb->eb, pb);
+
+  SVN_ERR(pb->eb->wrapped_editor->add_directory(path, pb->wrapped_baton,
+                                                copyfrom_path,
+                                                copyfrom_revision, db->pool,
+                                                &db->wrapped_baton));
+  *child_baton = db;
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+fetch_open_directory(const char *path,
+                     void *parent_baton,
+                     svn_revnum_t base_revision,
+                     apr_pool_t *dir_pool,
+                     void **child_baton)
+{
+  fetch_dir_baton_t *pb = parent_baton;
+  fetch_dir_baton_t *db = make_fetch_dir_baton(pb->eb, pb);
+
+  SVN_ERR(pb->eb->wrapped_editor->open_directory(path, pb->wrapped_baton,
+                                                 base_revision, db->pool,
+                                                 &db->wrapped_baton));
+  *child_baton = db;
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+fetch_change_dir_prop(void *dir_baton,
+                      const char *name,
+                      const svn_string_t *value,
+                      apr_pool_t *pool)
+{
+  fetch_dir_baton_t *db = dir_baton;
+
+  return db->eb->wrapped_editor->change_dir_prop(db->wrapped_baton, name,
+                                                 value, pool);
+}
+
+static svn_error_t *
+fetch_close_directory(void *dir_baton,
+                      apr_pool_t *pool)
+{
+  return svn_error_trace(release_dir(dir_baton, pool));
+}
+
+static svn_error_t *
+fetch_absent_directory(const char *path,
+                       void *parent_baton,
+                       apr_pool_t *pool)
+{
+  fetch_dir_baton_t *pb = parent_baton;
+
+  return pb->eb->wrapped_editor->absent_directory(path, pb->wrapped_baton,
+                                                  pool);
+}
+
+static svn_error_t *
+fetch_add_file(const char *path,
+               void *parent_baton,
+               const char *copyfrom_path,
+               svn_revnum_t copyfrom_revision,
+               apr_pool_t *file_pool,
+               void **file_baton)
+{
+  fetch_dir_baton_t *pb = parent_baton;
+  fetch_file_baton_t *fb = make_fetch_file_baton(pb, path);
+
+  SVN_ERR(pb->eb->wrapped_editor->add_file(path, pb->wrapped_baton,
+                                           copyfrom_path, copyfrom_revision,
+                                           fb->pool, &fb->wrapped_baton));
+  *file_baton = fb;
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+fetch_open_file(const char *path,
+                void *parent_baton,
+                svn_revnum_t base_revision,
+                apr_pool_t *file_pool,
+                void **file_baton)
+{
+  fetch_dir_baton_t *pb = parent_baton;
+  fetch_file_baton_t *fb = make_fetch_file_baton(pb, path);
+
+  SVN_ERR(pb->eb->wrapped_editor->open_file(path, pb->wrapped_baton,
+                                            base_revision, fb->pool,
+                                            &fb->wrapped_baton));
+  *file_baton = fb;
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+fetch_apply_textdelta(void *file_baton,
+                      const char *base_checksum,
+                      apr_pool_t *pool,
+                      svn_txdelta_window_handler_t *handler,
+                      void **handler_baton)
+{
+  fetch_file_baton_t *fb = file_baton;
+
+  /* The server sends no windows; we fetch the text in close_file. */
+  fb->text_changed = TRUE;
+  fb->base_checksum = apr_pstrdup(fb->pool, base_checksum);
+  *handler = svn_delta_noop_window_handler;
+  *handler_baton = NULL;
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+fetch_change_file_prop(void *file_baton,
+                       const char *name,
+                       const svn_string_t *value,
+                       apr_pool_t *pool)
+{
+  fetch_file_baton_t *fb = file_baton;
+
+  return fb->eb->wrapped_editor->change_file_prop(fb->wrapped_baton, name,
+                                                  value, pool);
+}
+
+static svn_error_t *
+fetch_close_file(void *file_baton,
+                 const char *text_checksum,
+                 apr_pool_t *pool)
+{
+  fetch_file_baton_t *fb = file_baton;
+  fetch_edit_baton_t *eb = fb->eb;
+
+  if (! fb->text_changed)
+    {
+      fetch_dir_baton_t *parent = fb->parent;
+
+      SVN_ERR(eb->wrapped_editor->close_file(fb->wrapped_baton,
+                                             text_checksum, pool));
+      svn_pool_destroy(fb->pool);
+      return svn_error_trace(release_dir(parent, pool));
     }
+
+  fb->text_checksum = apr_pstrdup(fb->pool, text_checksum);
+
+  /* Every session has at most one request in flight. */
+  if (eb->idle_sessions->nelts == 0)
+    SVN_ERR(finish_oldest_fetch(eb, pool));
+  fb->session = *(svn_ra_svn__session_baton_t **)
+                  apr_array_pop(eb->idle_sessions);
+
+  SVN_ERR(svn_thread_pool__submit(&fb->job, eb->thread_pool, fetch_text,
+                                  fb, fb->pool));
+  if (eb->last_pending)
+    eb->last_pending->next = fb;
   else
+    eb->first_pending = fb;
+  eb->last_pending = fb;
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+fetch_absent_file(const char *path,
+                  void *parent_baton,
+                  apr_pool_t *pool)
+{
+  fetch_dir_baton_t *pb = parent_baton;
+
+  return pb->eb->wrapped_editor->absent_file(path, pb->wrapped_baton, pool);
+}
+
+static svn_error_t *
+fetch_close_edit(void *edit_baton,
+                 apr_pool_t *pool)
+{
+  fetch_edit_baton_t *eb = edit_baton;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+
+  while (eb->first_pending)
     {
-      SVN_ERR(svn_ra_svn_write_tuple(conn, pool, "!w())", "all-revprops"));
-      want_custom_revprops = TRUE;
+      svn_pool_clear(iterpool);
+      SVN_ERR(finish_oldest_fetch(eb, iterpool));
     }
+  svn_pool_destroy(iterpool);
+
+  return eb->wrapped_editor->close_edit(eb->wrapped_baton, pool);
+}
+
+static svn_error_t *
+fetch_abort_edit(void *edit_baton,
+                 apr_pool_t *pool)
+{
+  fetch_edit_baton_t *eb = edit_baton;
+
+  return eb->wrapped_editor->abort_edit(eb->wrapped_baton, pool);
+}
+
+/* Set *EDITOR and *EDIT_BATON to an editor that forwards to the update
+   editor WRAPPED_EDITOR / WRAPPED_BATON and supplies the texts that a
+   textless update drive of SESS leaves out.  Open the auxiliary sessions
+   for it.  Set *EDITOR to NULL if the texts cannot be fetched in parallel
+   after all.
 
+   Allocate the editor in RESULT_POOL.  The auxiliary sessions will be
+   closed when RESULT_POOL gets cleaned up. */
+static svn_error_t *
+get_fetch_editor(const svn_delta_editor_t **editor,
+                 void **edit_baton,
+                 svn_ra_svn__session_baton_t *sess,
+                 const svn_delta_editor_t *wrapped_editor,
+                 void *wrapped_baton,
+                 apr_pool_t *result_pool)
+{
+  int aux_count = sess->max_connections - 1;
+  fetch_edit_baton_t *eb = apr_pcalloc(result_pool, sizeof(*eb));
+  svn_delta_editor_t *fetch_editor;
+  svn_ra_callbacks2_t *callbacks;
+  apr_uri_t uri;
+  int i;
+
+  SVN_ERR(svn_thread_pool__create(&eb->thread_pool, aux_count,
+                                  result_pool));
+  if (! svn_thread_pool__is_parallel(eb->thread_pool))
+    {
+      *editor = NULL;
+      return SVN_NO_ERROR;
+    }
+
+  eb->wrapped_editor = wrapped_editor;
+  eb->wrapped_baton = wrapped_baton;
+  eb->revision = SVN_INVALID_REVNUM;
+  eb->idle_sessions = apr_array_make(result_pool, aux_count,
+                                     sizeof(svn_ra_svn__session_baton_t *));
+  eb->session_pools = apr_array_make(result_pool, aux_count,
+                                     sizeof(apr_pool_t *));
+  eb->pool = result_pool;
+  apr_pool_cleanup_register(result_pool, eb, close_aux_sessions,
+                            apr_pool_cleanup_null);
+
+  /* The workers must not call back into the client. */
+  callbacks = apr_pmemdup(result_pool, sess->callbacks, sizeof(*callbacks));
+  callbacks->progress_func = NULL;
+  callbacks->cancel_func = NULL;
+
+  SVN_ERR(parse_url(sess->url, &uri, result_pool));
+  for (i = 0; i < aux_count; i++)
+    {
+      apr_pool_t *session_pool
+        = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+      svn_ra_svn__session_baton_t *aux_sess;
+
+      APR_ARRAY_PUSH(eb->session_pools, apr_pool_t *) = session_pool;
+      SVN_ERR(open_session(&aux_sess, sess->url, &uri, sess->tunnel_argv,
+                           callbacks, sess->callbacks_baton, session_pool));
+      APR_ARRAY_PUSH(eb->idle_sessions, svn_ra_svn__session_baton_t *)
+        = aux_sess;
+    }
+
+  fetch_editor = svn_delta_default_editor(result_pool);
+  fetch_editor->set_target_revision = fetch_set_target_revision;
+  fetch_editor->open_root = fetch_open_root;
+  fetch_editor->delete_entry = fetch_delete_entry;
+  fetch_editor->add_directory = fetch_add_directory;
+  fetch_editor->open_directory = fetch_open_directory;
+  fetch_editor->change_dir_prop = fetch_change_dir_prop;
+  fetch_editor->close_directory = fetch_close_directory;
+  fetch_editor->absent_directory = fetch_absent_directory;
+  fetch_editor->add_file = fetch_add_file;
+  fetch_editor->open_file = fetch_open_file;
+  fetch_editor->apply_textdelta = fetch_apply_textdelta;
+  fetch_editor->change_file_prop = fetch_change_file_prop;
+  fetch_editor->close_file = fetch_close_file;
+  fetch_editor->absent_file = fetch_absent_file;
+  fetch_editor->close_edit = fetch_close_edit;
+  fetch_editor->abort_edit = fetch_abort_edit;
+
+  *editor = fetch_editor;
+  *edit_baton = eb;
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *ra_svn_update(svn_ra_session_t *session,
+                                  const svn_ra_reporter3_t **reporter,
+                                  void **report_baton, svn_revnum_t rev,
+                                  const char *target, svn_depth_t depth,
+                                  svn_boolean_t send_copyfrom_args,
+                                  const svn_delta_editor_t *update_editor,
+                                  void *update_baton, apr_pool_t *pool)
+{
+  svn_ra_svn__session_baton_t *sess_baton = session->priv;
+  svn_ra_svn_conn_t *conn = sess_baton->conn;
+  svn_boolean_t recurse = DEPTH_TO_RECURSE(depth);
+  svn_boolean_t send_texts = TRUE;
+
+  /* Fetch the file texts over additional connections if configured. */
+  if (sess_baton->max_connections > 1
+      && svn_ra_svn_has_capability(conn, SVN_RA_SVN_CAP_TEXTLESS_UPDATE))
+    {
+      const svn_delta_editor_t *fetch_editor;
+      void *fetch_baton;
+
+      SVN_ERR(get_fetch_editor(&fetch_editor, &fetch_baton, sess_baton,
+                               update_editor, update_baton, pool));
+      if (fetch_editor)
+        {
+          update_editor = fetch_editor;
+          update_baton = fetch_baton;
+          send_texts = FALSE;
+        }
+    }
+
+  /* Tell the server we want to start an update. */
+  SVN_ERR(svn_ra_svn_write_cmd(conn, pool, "update", "(?r)cbwbb", rev,
+                               target, recurse, svn_depth_to_word(depth),
+                               send_copyfrom_args, send_texts));
   SVN_ERR(handle_auth_request(sess_baton, pool));
 
-  /* Read the log messages. */
-  iterpool = svn_pool_create(pool);
+  /* Fetch a reporter for the caller to drive.  The reporter will drive
+   * update_editor upon finish_report(). */
+  SVN_ERR(ra_svn_get_reporter(sess_baton, pool, update_editor, update_baton,
+                              target, depth, reporter, report_baton));
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *ra_svn_switch(svn_ra_session_t *session,
+                                  const svn_ra_reporter3_t **reporter,
+                                  void **report_baton, svn_revnum_t rev,
+                                  const char *target, svn_depth_t depth,
+                                  const char *switch_url,
+                                  const svn_delta_editor_t *update_editor,
+                                  void *update_baton, apr_pool_t *pool)
+{
+  svn_ra_svn__session_baton_t *sess_baton = session->priv;
+  svn_ra_svn_conn_t *conn = sess_baton->conn;
+  svn_boolean_t recurse = DEPTH_TO_RECURSE(depth);
+
+  /* Tell the server we want to start a switch. */
+  SVN_ERR(svn_ra_svn_write_cmd(conn, pool, "switch", "(?r)cbcw", rev,
+                               target, recurse, switch_url,
+                               svn_depth_to_word(depth)));
+  SVN_ERR(handle_auth_request(sess_baton, pool));
+
+  /* Fetch a reporter for the caller to drive.  The reporter will drive
+   * update_editor upon finish_report(). */
+  SVN_ERR(ra_svn_get_reporter(sess_baton, pool, update_editor, update_baton,
+                              target, depth, reporter, report_baton));
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *ra_svn_status(svn_ra_session_t *session,
+                                  const svn_ra_reporter3_t **reporter,
+                                  void **report_baton,
+                                  const char *target, svn_revnum_t rev,
+                                  svn_depth_t depth,
+                                  const svn_delta_editor_t *status_editor,
+                                  void *status_baton, apr_pool_t *pool)
+{
+  svn_ra_svn__session_baton_t *sess_baton = session->priv;
+  svn_ra_svn_conn_t *conn = sess_baton->conn;
+  svn_boolean_t recurse = DEPTH_TO_RECURSE(depth);
+
+  /* Tell the server we want to start a status operation. */
+  SVN_ERR(svn_ra_svn_write_cmd(conn, pool, "status", "cb(?r)w",
+                               target, recurse, rev,
+                               svn_depth_to_word(depth)));
+  SVN_ERR(handle_auth_request(sess_baton, pool));
+
+  /* Fetch a reporter for the caller to drive.  The reporter will drive
+   * status_editor upon finish_report(). */
+  SVN_ERR(ra_svn_get_reporter(sess_baton, pool, status_editor, status_baton,
+                              target, depth, reporter, report_baton));
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *ra_svn_diff(svn_ra_session_t *session,
+                                const svn_ra_reporter3_t **reporter,
+                                void **report_baton,
+                                svn_revnum_t rev, const char *target,
+                                svn_depth_t depth,
+                                svn_boolean_t ignore_ancestry,
+                                svn_boolean_t text_deltas,
+                                const char *versus_url,
+                                const svn_delta_editor_t *diff_editor,
+                                void *diff_baton, apr_pool_t *pool)
+{
+  svn_ra_svn__session_baton_t *sess_baton = session->priv;
+  svn_ra_svn_conn_t *conn = sess_baton->conn;
+  svn_boolean_t recurse = DEPTH_TO_RECURSE(depth);
+
+  /* Tell the server we want to start a diff. */
+  SVN_ERR(svn_ra_svn_write_cmd(conn, pool, "diff", "(?r)cbbcbw", rev,
+                               target, recurse, ignore_ancestry,
+                               versus_url, text_deltas,
+                               svn_depth_to_word(depth)));
+  SVN_ERR(handle_auth_request(sess_baton, pool));
+
+  /* Fetch a reporter for the caller to drive.  The reporter will drive
+   * diff_editor upon finish_report(). */
+  SVN_ERR(ra_svn_get_reporter(sess_baton, pool, diff_editor, diff_baton,
+                              target, depth, reporter, report_baton));
+  return SVN_NO_ERROR;
+}
+
+
+/*** Reading responses ahead. ***/
+
+/* A response item read ahead of its consumer. */
+typedef struct read_ahead_item_t
+{
+  svn_ra_svn_item_t *item;
+
+  /* The connection's byte count after reading ITEM. */
+  apr_uint64_t bytes_read;
+
+  /* Root pool holding ITEM and this structure. */
+  apr_pool_t *pool;
+
+  struct read_ahead_item_t *next;
+} read_ahead_item_t;
+
+/* Delivers the items of a command response up to and including the
+   terminating "done" word.  With read-ahead enabled, a separate thread
+   reads and parses the items from the connection while the calling
+   thread runs the receivers.  Otherwise, the items are read directly. */
+typedef struct item_reader_t
+{
+  svn_ra_svn__session_baton_t *sess;
+
+  /* Runs the reader thread.  JOB is NULL when reading directly. */
+  svn_thread_pool__t *thread_pool;
+  svn_thread_pool__job_t *job;
+
+#if APR_HAS_THREADS
+  /* FIFO of items read ahead and its length, guarded by MUTEX.  CHANGED
+     gets signaled whenever items have been added or removed.  FINISHED
+     gets set once the reader thread won't queue further items and
+     ABORTED once the calling thread won't take any more. */
+  apr_thread_mutex_t *mutex;
+  apr_thread_cond_t *changed;
+  read_ahead_item_t *first;
+  read_ahead_item_t *last;
+  int queued;
+  svn_boolean_t finished;
+  svn_boolean_t aborted;
+#endif
+
+  /* The connection's byte count already added to the session's. */
+  apr_uint64_t bytes_read;
+} item_reader_t;
+
+#if APR_HAS_THREADS
+/* Pool cleanup function destroying the root pool in BATON. */
+static apr_status_t
+destroy_root_pool(void *baton)
+{
+  svn_pool_destroy(baton);
+
+  return APR_SUCCESS;
+}
+
+/* Implements svn_thread_pool__task_t.  Read the items of the response
+   from the connection of the item_reader_t BATON and queue them, waiting
+   for the calling thread to make room when necessary, until the "done"
+   word has been queued. */
+static svn_error_t *
+read_items(void *baton,
+           apr_pool_t *result_pool,
+           apr_pool_t *scratch_pool)
+{
+  item_reader_t *reader = baton;
+  svn_ra_svn_conn_t *conn = reader->sess->conn;
+  svn_boolean_t done = FALSE;
+  svn_error_t *err = SVN_NO_ERROR;
+
+  while (! done && ! err)
+    {
+      apr_pool_t *pool
+        = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+      read_ahead_item_t *entry = apr_pcalloc(pool, sizeof(*entry));
+      svn_boolean_t aborted;
+
+      entry->pool = pool;
+      err = svn_ra_svn_read_item(conn, pool, &entry->item);
+      if (err)
+        {
+          svn_pool_destroy(pool);
+          break;
+        }
+
+      entry->bytes_read = conn->bytes_read;
+      done = (entry->item->kind == SVN_RA_SVN_WORD
+              && strcmp(entry->item->u.word, "done") == 0);
+
+      apr_thread_mutex_lock(reader->mutex);
+      while (reader->queued >= reader->sess->read_ahead && ! reader->aborted)
+        apr_thread_cond_wait(reader->changed, reader->mutex);
+
+      aborted = reader->aborted;
+      if (! aborted)
+        {
+          if (reader->last)
+            reader->last->next = entry;
+          else
+            reader->first = entry;
+          reader->last = entry;
+          reader->queued++;
+          apr_thread_cond_broadcast(reader->changed);
+        }
+      apr_thread_mutex_unlock(reader->mutex);
+
+      if (aborted)
+        {
+          svn_pool_destroy(pool);
+          err = svn_error_create(SVN_ERR_CANCELLED, NULL, NULL);
+        }
+    }
+
+  apr_thread_mutex_lock(reader->mutex);
+  reader->finished = TRUE;
+  apr_thread_cond_broadcast(reader->changed);
+  apr_thread_mutex_unlock(reader->mutex);
+
+  return svn_error_trace(err);
+}
+#endif
+
+/* Prepare to read the items of a response to the last command sent over
+   SESS in *READER.  If read-ahead is enabled for SESS, start reading them
+   on a separate thread right away.
+
+   The caller must call stop_item_reader() before using SESS again, even
+   if reading the response failed.  Allocate *READER in POOL. */
+static svn_error_t *
+start_item_reader(item_reader_t **reader,
+                  svn_ra_svn__session_baton_t *sess,
+                  apr_pool_t *pool)
+{
+  item_reader_t *new_reader = apr_pcalloc(pool, sizeof(*new_reader));
+
+  new_reader->sess = sess;
+  *reader = new_reader;
+
+#if APR_HAS_THREADS
+  if (sess->read_ahead > 0)
+    {
+      apr_status_t status;
+
+      SVN_ERR(svn_thread_pool__create(&new_reader->thread_pool, 2, pool));
+      if (! svn_thread_pool__is_parallel(new_reader->thread_pool))
+        return SVN_NO_ERROR;
+
+      status = apr_thread_mutex_create(&new_reader->mutex,
+                                       APR_THREAD_MUTEX_DEFAULT, pool);
+      if (status)
+        return svn_error_wrap_apr(status, _("Can't create mutex"));
+
+      status = apr_thread_cond_create(&new_reader->changed, pool);
+      if (status)
+        return svn_error_wrap_apr(status,
+                                  _("Can't create condition variable"));
+
+      /* Cancellation and progress callbacks stay with this thread. */
+      new_reader->bytes_read = sess->conn->bytes_read;
+      sess->conn->session = NULL;
+
+      SVN_ERR(svn_thread_pool__submit(&new_reader->job,
+                                      new_reader->thread_pool, read_items,
+                                      new_reader, pool));
+    }
+#endif
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *ITEM to the next item of the response delivered by READER.  *ITEM
+   remains valid until POOL gets cleaned up. */
+static svn_error_t *
+read_response_item(svn_ra_svn_item_t **item,
+                   item_reader_t *reader,
+                   apr_pool_t *pool)
+{
+#if APR_HAS_THREADS
+  svn_ra_svn__session_baton_t *sess = reader->sess;
+  const svn_ra_callbacks2_t *cb = sess->callbacks;
+  read_ahead_item_t *entry;
+
+  if (! reader->job)
+    return svn_error_trace(svn_ra_svn_read_item(sess->conn, pool, item));
+
+  if (cb && cb->cancel_func)
+    SVN_ERR(cb->cancel_func(sess->callbacks_baton));
+
+  apr_thread_mutex_lock(reader->mutex);
+  while (reader->first == NULL && ! reader->finished)
+    apr_thread_cond_wait(reader->changed, reader->mutex);
+
+  entry = reader->first;
+  if (entry)
+    {
+      reader->first = entry->next;
+      if (reader->first == NULL)
+        reader->last = NULL;
+      reader->queued--;
+      apr_thread_cond_broadcast(reader->changed);
+    }
+  apr_thread_mutex_unlock(reader->mutex);
+
+  /* The reader thread failed or the caller read past the "done" word. */
+  if (entry == NULL)
+    {
+      SVN_ERR(svn_thread_pool__wait(reader->job));
+      return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                              _("Unexpected end of response"));
+    }
+
+  apr_pool_cleanup_register(pool, entry->pool, destroy_root_pool,
+                            apr_pool_cleanup_null);
+  *item = entry->item;
+
+  sess->bytes_read += (apr_off_t)(entry->bytes_read - reader->bytes_read);
+  reader->bytes_read = entry->bytes_read;
+  if (cb && cb->progress_func)
+    cb->progress_func(sess->bytes_read + sess->bytes_written, -1,
+                      cb->progress_baton, pool);
+
+  return SVN_NO_ERROR;
+#else
+  return svn_error_trace(svn_ra_svn_read_item(reader->sess->conn, pool,
+                                              item));
+#endif
+}
+
+/* Read the next item of the response delivered by READER, which must be
+   a string, write its contents to STREAM unless that is NULL and set
+   *LEN to its length.  When reading directly from the connection, the
+   data will not be copied on its way to STREAM.  Use POOL for temporary
+   allocations. */
+static svn_error_t *
+read_response_string(apr_uint64_t *len,
+                     svn_stream_t *stream,
+                     item_reader_t *reader,
+                     apr_pool_t *pool)
+{
+  svn_ra_svn_conn_t *conn = reader->sess->conn;
+  svn_ra_svn_item_t *item;
+  apr_size_t size;
+
+  if (! reader->job)
+    return svn_error_trace(svn_ra_svn__read_string_to_stream(conn, pool,
+                                                             stream, len));
+
+  SVN_ERR(read_response_item(&item, reader, pool));
+  if (item->kind != SVN_RA_SVN_STRING)
+    return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                            _("Expected a string"));
+
+  *len = item->u.string->len;
+  size = item->u.string->len;
+  if (stream)
+    SVN_ERR(svn_stream_write(stream, item->u.string->data, &size));
+
+  return SVN_NO_ERROR;
+}
+
+/* Make sure that the reader thread of READER, if any, has finished and
+   give the connection back to the calling thread.  Items not taken yet
+   will be discarded. */
+static svn_error_t *
+stop_item_reader(item_reader_t *reader)
+{
+#if APR_HAS_THREADS
+  read_ahead_item_t *entry;
+
+  if (! reader->job)
+    return SVN_NO_ERROR;
+
+  apr_thread_mutex_lock(reader->mutex);
+  reader->aborted = TRUE;
+  apr_thread_cond_broadcast(reader->changed);
+  apr_thread_mutex_unlock(reader->mutex);
+
+  svn_thread_pool__job_destroy(reader->job);
+  reader->job = NULL;
+  reader->sess->conn->session = reader->sess;
+
+  for (entry = reader->first; entry; entry = reader->first)
+    {
+      reader->first = entry->next;
+      svn_pool_destroy(entry->pool);
+    }
+  reader->last = NULL;
+  reader->queued = 0;
+#endif
+
+  return SVN_NO_ERROR;
+}
+
+
+/* Read the log entries of a response to the log command from READER
+   and pass them to RECEIVER with RECEIVER_BATON.  LIMIT and REVPROPS are
+   the arguments of the command and WANT_CUSTOM_REVPROPS tells whether
+   REVPROPS requests revprops other than author, date and log.  Use POOL
+   for temporary allocations. */
+static svn_error_t *
+read_log_entries(item_reader_t *reader,
+                 int limit,
+                 const apr_array_header_t *revprops,
+                 svn_boolean_t want_custom_revprops,
+                 svn_log_entry_receiver_t receiver,
+                 void *receiver_baton,
+                 apr_pool_t *pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i;
+  int nest_level = 0;
+  char *name;
+
   while (1)
     {
       apr_uint64_t has_children_param, invalid_revnum_param;
@@ -1421,7 +2429,7 @@ static svn_error_t *ra_svn_log(svn_ra_session_t *session,
       int nreceived;
 
       svn_pool_clear(iterpool);
-      SVN_ERR(svn_ra_svn_read_item(conn, iterpool, &item));
+      SVN_ERR(read_response_item(&item, reader, iterpool));
       if (item->kind == SVN_RA_SVN_WORD && strcmp(item->u.word, "done") == 0)
         break;
       if (item->kind != SVN_RA_SVN_LIST)
@@ -1554,6 +2562,72 @@ static svn_error_t *ra_svn_log(svn_ra_session_t *session,
     }
   svn_pool_destroy(iterpool);
 
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *ra_svn_log(svn_ra_session_t *session,
+                               const apr_array_header_t *paths,
+                               svn_revnum_t start, svn_revnum_t end,
+                               int limit,
+                               svn_boolean_t discover_changed_paths,
+                               svn_boolean_t strict_node_history,
+                               svn_boolean_t include_merged_revisions,
+                               const apr_array_header_t *revprops,
+                               svn_log_entry_receiver_t receiver,
+                               void *receiver_baton, apr_pool_t *pool)
+{
+  svn_ra_svn__session_baton_t *sess_baton = session->priv;
+  svn_ra_svn_conn_t *conn = sess_baton->conn;
+  item_reader_t *reader;
+  int i;
+  const char *path;
+  char *name;
+  svn_boolean_t want_custom_revprops;
+  svn_error_t *err;
+
+  SVN_ERR(svn_ra_svn_write_tuple(conn, pool, "w((!", "log"));
+  if (paths)
+    {
+      for (i = 0; i < paths->nelts; i++)
+        {
+          path = APR_ARRAY_IDX(paths, i, const char *);
+          SVN_ERR(svn_ra_svn_write_cstring(conn, pool, path));
+        }
+    }
+  SVN_ERR(svn_ra_svn_write_tuple(conn, pool, "!)(?r)(?r)bbnb!", start, end,
+                                 discover_changed_paths, strict_node_history,
+                                 (apr_uint64_t) limit,
+                                 include_merged_revisions));
+  if (revprops)
+    {
+      want_custom_revprops = FALSE;
+      SVN_ERR(svn_ra_svn_write_tuple(conn, pool, "!w(!", "revprops"));
+      for (i = 0; i < revprops->nelts; i++)
+        {
+          name = APR_ARRAY_IDX(revprops, i, char *);
+          SVN_ERR(svn_ra_svn_write_cstring(conn, pool, name));
+          if (!want_custom_revprops
+              && strcmp(name, SVN_PROP_REVISION_AUTHOR) != 0
+              && strcmp(name, SVN_PROP_REVISION_DATE) != 0
+              && strcmp(name, SVN_PROP_REVISION_LOG) != 0)
+            want_custom_revprops = TRUE;
+        }
+      SVN_ERR(svn_ra_svn_write_tuple(conn, pool, "!))"));
+    }
+  else
+    {
+      SVN_ERR(svn_ra_svn_write_tuple(conn, pool, "!w())", "all-revprops"));
+      want_custom_revprops = TRUE;
+    }
+
+  SVN_ERR(handle_auth_request(sess_baton, pool));
+
+  /* Read the log messages. */
+  SVN_ERR(start_item_reader(&reader, sess_baton, pool));
+  err = read_log_entries(reader, limit, revprops, want_custom_revprops,
+                         receiver, receiver_baton, pool);
+  SVN_ERR(svn_error_compose_create(err, stop_item_reader(reader)));
+
   /* Read the response. */
   return svn_ra_svn_read_cmd_response(conn, pool, "");
 }
@@ -1757,30 +2831,25 @@ ra_svn_get_location_segments(svn_ra_session_t *session,
   return SVN_NO_ERROR;
 }
 
-static svn_error_t *ra_svn_get_file_revs(svn_ra_session_t *session,
-                                         const char *path,
-                                         svn_revnum_t start, svn_revnum_t end,
-                                         svn_boolean_t include_merged_revisions,
-                                         svn_file_rev_handler_t handler,
-                                         void *handler_baton, apr_pool_t *pool)
+/* Read the revisions of a response to the get-file-revs command from
+   READER and pass them to HANDLER with HANDLER_BATON.  Set *HAD_REVISION
+   to whether there was at least one revision.  Use POOL for temporary
+   allocations. */
+static svn_error_t *
+read_file_revs(item_reader_t *reader,
+               svn_file_rev_handler_t handler,
+               void *handler_baton,
+               svn_boolean_t *had_revision,
+               apr_pool_t *pool)
 {
-  svn_ra_svn__session_baton_t *sess_baton = session->priv;
   apr_pool_t *rev_pool, *chunk_pool;
   svn_boolean_t has_txdelta;
-  svn_boolean_t had_revision = FALSE;
 
   /* One sub-pool for each revision and one for each txdelta chunk.
      Note that the rev_pool must live during the following txdelta. */
   rev_pool = svn_pool_create(pool);
   chunk_pool = svn_pool_create(pool);
-
-  SVN_ERR(svn_ra_svn_write_cmd(sess_baton->conn, pool, "get-file-revs",
-                               "c(?r)(?r)b", path, start, end,
-                               include_merged_revisions));
-
-  /* Servers before 1.1 don't support this command.  Check for this here. */
-  SVN_ERR(handle_unsupported_cmd(handle_auth_request(sess_baton, pool),
-                                 N_("'get-file-revs' not implemented")));
+  *had_revision = FALSE;
 
   while (1)
     {
@@ -1797,11 +2866,11 @@ static svn_error_t *ra_svn_get_file_revs(svn_ra_session_t *session,
 
       svn_pool_clear(rev_pool);
       svn_pool_clear(chunk_pool);
-      SVN_ERR(svn_ra_svn_read_item(sess_baton->conn, rev_pool, &item));
+      SVN_ERR(read_response_item(&item, reader, rev_pool));
       if (item->kind == SVN_RA_SVN_WORD && strcmp(item->u.word, "done") == 0)
         break;
       /* Either we've got a correct revision or we will error out below. */
-      had_revision = TRUE;
+      *had_revision = TRUE;
       if (item->kind != SVN_RA_SVN_LIST)
         return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
                                 _("Revision entry not a list"));
@@ -1818,7 +2887,7 @@ static svn_error_t *ra_svn_get_file_revs(svn_ra_session_t *session,
         merged_rev = (svn_boolean_t) merged_rev_param;
 
       /* Get the first delta chunk so we know if there is a delta. */
-      SVN_ERR(svn_ra_svn_read_item(sess_baton->conn, chunk_pool, &item));
+      SVN_ERR(read_response_item(&item, reader, chunk_pool));
       if (item->kind != SVN_RA_SVN_STRING)
         return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
                                 _("Text delta chunk not a string"));
@@ -1832,32 +2901,61 @@ static svn_error_t *ra_svn_get_file_revs(svn_ra_session_t *session,
       if (has_txdelta)
         {
           svn_stream_t *stream;
+          apr_size_t size = item->u.string->len;
+          apr_uint64_t len;
 
           if (d_handler)
             stream = svn_txdelta_parse_svndiff(d_handler, d_baton, TRUE,
                                                rev_pool);
           else
             stream = NULL;
-          while (item->u.string->len > 0)
-            {
-              apr_size_t size;
+          if (stream)
+            SVN_ERR(svn_stream_write(stream, item->u.string->data, &size));
 
-              size = item->u.string->len;
-              if (stream)
-                SVN_ERR(svn_stream_write(stream, item->u.string->data, &size));
+          /* Pass the remaining chunks on as they arrive. */
+          do
+            {
               svn_pool_clear(chunk_pool);
-
-              SVN_ERR(svn_ra_svn_read_item(sess_baton->conn, chunk_pool,
-                                           &item));
-              if (item->kind != SVN_RA_SVN_STRING)
-                return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
-                                        _("Text delta chunk not a string"));
+              SVN_ERR(read_response_string(&len, stream, reader, chunk_pool));
             }
+          while (len > 0);
+
           if (stream)
             SVN_ERR(svn_stream_close(stream));
         }
     }
 
+  svn_pool_destroy(chunk_pool);
+  svn_pool_destroy(rev_pool);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *ra_svn_get_file_revs(svn_ra_session_t *session,
+                                         const char *path,
+                                         svn_revnum_t start, svn_revnum_t end,
+                                         svn_boolean_t include_merged_revisions,
+                                         svn_file_rev_handler_t handler,
+                                         void *handler_baton, apr_pool_t *pool)
+{
+  svn_ra_svn__session_baton_t *sess_baton = session->priv;
+  item_reader_t *reader;
+  svn_boolean_t had_revision;
+  svn_error_t *err;
+
+  SVN_ERR(svn_ra_svn_write_cmd(sess_baton->conn, pool, "get-file-revs",
+                               "c(?r)(?r)b", path, start, end,
+                               include_merged_revisions));
+
+  /* Servers before 1.1 don't support this command.  Check for this here. */
+  SVN_ERR(handle_unsupported_cmd(handle_auth_request(sess_baton, pool),
+                                 N_("'get-file-revs' not implemented")));
+
+  /* Parse the response. */
+  SVN_ERR(start_item_reader(&reader, sess_baton, pool));
+  err = read_file_revs(reader, handler, handler_baton, &had_revision, pool);
+  SVN_ERR(svn_error_compose_create(err, stop_item_reader(reader)));
+
   SVN_ERR(svn_ra_svn_read_cmd_response(sess_baton->conn, pool, ""));
 
   /* Return error if we didn't get any revisions. */
@@ -1866,9 +2964,6 @@ static svn_error_t *ra_svn_get_file_revs(svn_ra_session_t *session,
                             _("The get-file-revs command didn't return "
                               "any revisions"));
 
-  svn_pool_destroy(chunk_pool);
-  svn_pool_destroy(rev_pool);
-
   return SVN_NO_ERROR;
 }
 
@@ -2519,6 +3614,92 @@ ra_svn_register_editor_shim_callbacks(svn_ra_session_t *session,
   return SVN_NO_ERROR;
 }
 
+static svn_error_t *
+ra_svn_get_file_blame(svn_ra_session_t *session,
+                      const char *path,
+                      svn_revnum_t start,
+                      svn_revnum_t end,
+                      const svn_diff_file_options_t *diff_options,
+                      svn_boolean_t ignore_mime_type,
+                      svn_ra__blame_receiver_t receiver,
+                      void *receiver_baton,
+                      apr_pool_t *pool)
+{
+  svn_ra_svn__session_baton_t *sess_baton = session->priv;
+  svn_ra_svn_conn_t *conn = sess_baton->conn;
+  const char *ignore_space;
+  apr_hash_t *rev_props_by_rev = apr_hash_make(pool);
+  apr_uint64_t next_line = 0;
+  apr_pool_t *iterpool;
+
+  if (! svn_ra_svn_has_capability(conn, SVN_RA_SVN_CAP_FILE_BLAME))
+    return svn_error_create(SVN_ERR_RA_NOT_IMPLEMENTED, NULL,
+                            _("Server does not support server-side blame"));
+
+  if (diff_options->ignore_space == svn_diff_file_ignore_space_change)
+    ignore_space = "change";
+  else if (diff_options->ignore_space == svn_diff_file_ignore_space_all)
+    ignore_space = "all";
+  else
+    ignore_space = "none";
+
+  SVN_ERR(svn_ra_svn_write_cmd(conn, pool, "get-file-blame", "c(?r)(?r)wbb",
+                               path, start, end, ignore_space,
+                               diff_options->ignore_eol_style,
+                               ignore_mime_type));
+  SVN_ERR(handle_auth_request(sess_baton, pool));
+
+  iterpool = svn_pool_create(pool);
+  while (1)
+    {
+      svn_ra_svn_item_t *item;
+      apr_uint64_t start_line;
+      svn_revnum_t rev;
+      apr_array_header_t *rev_proplist;
+      apr_hash_t *rev_props = NULL;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_ra_svn_read_item(conn, iterpool, &item));
+      if (item->kind == SVN_RA_SVN_WORD && strcmp(item->u.word, "done") == 0)
+        break;
+      if (item->kind != SVN_RA_SVN_LIST)
+        return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                                _("Blame entry not a list"));
+
+      SVN_ERR(svn_ra_svn_parse_tuple(item->u.list, iterpool, "n(?r)?l",
+                                     &start_line, &rev, &rev_proplist));
+      if (start_line < next_line)
+        return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                                _("Blame entries out of order"));
+      next_line = start_line + 1;
+
+      /* The server sends the revision properties only once per
+         revision, so remember them for later chunks. */
+      if (rev_proplist)
+        {
+          svn_revnum_t *key = apr_palloc(pool, sizeof(*key));
+
+          *key = rev;
+          SVN_ERR(svn_ra_svn_parse_proplist(rev_proplist, pool, &rev_props));
+          apr_hash_set(rev_props_by_rev, key, sizeof(*key), rev_props);
+        }
+      else if (SVN_IS_VALID_REVNUM(rev))
+        {
+          rev_props = apr_hash_get(rev_props_by_rev, &rev, sizeof(rev));
+          if (! rev_props)
+            return svn_error_createf(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                                     _("Missing properties of revision %ld "
+                                       "in blame information"), rev);
+        }
+
+      SVN_ERR(receiver(receiver_baton, (apr_int64_t) start_line, rev,
+                       rev_props, iterpool));
+    }
+  svn_pool_destroy(iterpool);
+
+  return svn_error_trace(svn_ra_svn_read_cmd_response(conn, pool, ""));
+}
+
 
 static const svn_ra__vtable_t ra_svn_vtable = {
   svn_ra_svn_version,
@@ -2556,7 +3737,10 @@ static const svn_ra__vtable_t ra_svn_vtable = {
   ra_svn_has_capability,
   ra_svn_replay_range,
   ra_svn_get_deleted_rev,
-  ra_svn_register_editor_shim_callbacks
+  ra_svn_register_editor_shim_callbacks,
+  NULL /* get_commit_ev2 */,
+  ra_svn_get_file_blame,
+  ra_svn_get_files
 };
 
 svn_error_t *
@@ -318,9 +318,11 @@ static svn_error_t *ra_svn_apply_textdelta(void *file_baton,
   svn_stream_set_close(diff_stream, ra_svn_svndiff_close_handler);
 
   /* If the connection does not support SVNDIFF1 or if we don't want to use
-   * compression, use the non-compressing "version 0" implementation */
+   * compression, use the non-compressing "version 0" implementation.
+   * The same applies if the whole stream gets compressed anyway. */
   if (   svn_ra_svn_compression_level(b->conn) > 0
-      && svn_ra_svn_has_capability(b->conn, SVN_RA_SVN_CAP_SVNDIFF1))
+      && svn_ra_svn_has_capability(b->conn, SVN_RA_SVN_CAP_SVNDIFF1)
+      && ! svn_ra_svn__stream_compression_enabled(b->conn))
     svn_txdelta_to_svndiff3(wh, wh_baton, diff_stream, 1,
                             b->conn->compression_level, pool);
   else
@@ -704,22 +706,61 @@ static svn_error_t *ra_svn_handle_apply_textdelta(svn_ra_svn_conn_t *conn,
   return SVN_NO_ERROR;
 }
 
-static svn_error_t *ra_svn_handle_textdelta_chunk(svn_ra_svn_conn_t *conn,
-                                                  apr_pool_t *pool,
-                                                  const apr_array_header_t *params,
-                                                  ra_svn_driver_state_t *ds)
+/* Baton for chunk_write(). */
+typedef struct chunk_baton_t
 {
-  const char *token;
-  ra_svn_token_entry_t *entry;
-  svn_string_t *str;
+  svn_stream_t *dstream;
+  svn_error_t *err;
+} chunk_baton_t;
 
-  /* Parse arguments and look up the token. */
-  SVN_ERR(svn_ra_svn_parse_tuple(params, pool, "cs", &token, &str));
-  SVN_ERR(lookup_token(ds, token, TRUE, &entry));
+/* Implements svn_write_fn_t.  Pass DATA on to the delta stream in the
+   chunk_baton_t BATON.  Remember the first error instead of returning
+   it, so that the rest of the chunk still gets read. */
+static svn_error_t *chunk_write(void *baton, const char *data,
+                                apr_size_t *len)
+{
+  chunk_baton_t *b = baton;
+
+  if (!b->err)
+    b->err = svn_stream_write(b->dstream, data, len);
+  return SVN_NO_ERROR;
+}
+
+/* Unlike the other commands, textdelta-chunk is read by the handler
+   itself, starting with its parameter list.  The svndiff data goes to
+   the delta stream straight from the read buffer of CONN. */
+static svn_error_t *ra_svn_read_textdelta_chunk(svn_ra_svn_conn_t *conn,
+                                                apr_pool_t *pool,
+                                                ra_svn_driver_state_t *ds)
+{
+  svn_ra_svn_item_t *item;
+  ra_svn_token_entry_t *entry;
+  chunk_baton_t baton;
+  svn_stream_t *stream;
+  apr_uint64_t len;
+
+  /* Read the token and look it up. */
+  SVN_ERR(svn_ra_svn__read_list_start(conn, pool));
+  SVN_ERR(svn_ra_svn_read_item(conn, pool, &item));
+  if (item->kind != SVN_RA_SVN_STRING)
+    return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                            _("Malformed network data"));
+  SVN_ERR(lookup_token(ds, item->u.string->data, TRUE, &entry));
   if (!entry->dstream)
     return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
                             _("Apply-textdelta not active"));
-  SVN_CMD_ERR(svn_stream_write(entry->dstream, str->data, &str->len));
+
+  baton.dstream = entry->dstream;
+  baton.err = SVN_NO_ERROR;
+  stream = svn_stream_create(&baton, pool);
+  svn_stream_set_write(stream, chunk_write);
+  SVN_ERR(svn_ra_svn__read_string_to_stream(conn, pool, stream, &len));
+
+  /* Finish both the parameter list and the command. */
+  SVN_ERR(svn_ra_svn__read_list_end(conn, pool));
+  SVN_ERR(svn_ra_svn__read_list_end(conn, pool));
+
+  SVN_CMD_ERR(baton.err);
   return SVN_NO_ERROR;
 }
 
@@ -847,7 +888,6 @@ static const struct {
   { "change-file-prop", ra_svn_handle_change_file_prop },
   { "open-file",        ra_svn_handle_open_file },
   { "apply-textdelta",  ra_svn_handle_apply_textdelta },
-  { "textdelta-chunk",  ra_svn_handle_textdelta_chunk },
   { "close-file",       ra_svn_handle_close_file },
   { "add-dir",          ra_svn_handle_add_dir },
   { "open-dir",         ra_svn_handle_open_dir },
@@ -866,6 +906,41 @@ static const struct {
   { NULL }
 };
 
+/* Read the opening of an editing command from CONN, up to and including
+   its name, and return the name in *CMD. */
+static svn_error_t *read_command_name(const char **cmd,
+                                      svn_ra_svn_conn_t *conn,
+                                      apr_pool_t *pool)
+{
+  svn_ra_svn_item_t *item;
+
+  SVN_ERR(svn_ra_svn__read_list_start(conn, pool));
+  SVN_ERR(svn_ra_svn_read_item(conn, pool, &item));
+  if (item->kind != SVN_RA_SVN_WORD)
+    return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                            _("Malformed network data"));
+
+  *cmd = item->u.word;
+  return SVN_NO_ERROR;
+}
+
+/* Read the rest of an editing command whose name has been read by
+   read_command_name() from CONN and return its parameters in *PARAMS. */
+static svn_error_t *read_command_params(apr_array_header_t **params,
+                                        svn_ra_svn_conn_t *conn,
+                                        apr_pool_t *pool)
+{
+  svn_ra_svn_item_t *item;
+
+  SVN_ERR(svn_ra_svn_read_item(conn, pool, &item));
+  if (item->kind != SVN_RA_SVN_LIST)
+    return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                            _("Malformed network data"));
+
+  *params = item->u.list;
+  return svn_error_trace(svn_ra_svn__read_list_end(conn, pool));
+}
+
 static svn_error_t *blocked_write(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
                                   void *baton)
 {
@@ -910,14 +985,25 @@ svn_error_t *svn_ra_svn_drive_editor2(svn_ra_svn_conn_t *conn,
 
   while (!state.done)
     {
+      svn_boolean_t is_chunk;
+
       svn_pool_clear(subpool);
-      SVN_ERR(svn_ra_svn_read_tuple(conn, subpool, "wl", &cmd, &params));
+
+      /* Read the command name first, so that textdelta-chunk can pass
+         its data on without copying it. */
+      SVN_ERR(read_command_name(&cmd, conn, subpool));
+      is_chunk = (strcmp(cmd, "textdelta-chunk") == 0);
+      if (!is_chunk)
+        SVN_ERR(read_command_params(&params, conn, subpool));
+
       for (i = 0; ra_svn_edit_cmds[i].cmd; i++)
         {
           if (strcmp(cmd, ra_svn_edit_cmds[i].cmd) == 0)
             break;
         }
-      if (ra_svn_edit_cmds[i].cmd)
+      if (is_chunk)
+        err = ra_svn_read_textdelta_chunk(conn, subpool, &state);
+      else if (ra_svn_edit_cmds[i].cmd)
         err = (*ra_svn_edit_cmds[i].handler)(conn, subpool, params, &state);
       else if (strcmp(cmd, "failure") == 0)
         {
@@ -73,10 +73,14 @@ svn_ra_svn_conn_t *svn_ra_svn_create_conn2(apr_socket_t *sock,
   conn->read_ptr = conn->read_buf;
   conn->read_end = conn->read_buf;
   conn->write_pos = 0;
+  conn->write_ref_count = 0;
   conn->block_handler = NULL;
   conn->block_baton = NULL;
   conn->capabilities = apr_hash_make(pool);
   conn->compression_level = compression_level;
+  conn->compressed = FALSE;
+  conn->bytes_read = 0;
+  conn->bytes_written = 0;
   conn->pool = pool;
 
   if (sock != NULL)
@@ -146,6 +150,51 @@ svn_ra_svn_compression_level(svn_ra_svn_conn_t *conn)
   return conn->compression_level;
 }
 
+svn_error_t *
+svn_ra_svn__enable_stream_compression(svn_ra_svn_conn_t *conn,
+                                      apr_pool_t *pool)
+{
+  int level = conn->compression_level;
+
+  if (conn->compressed)
+    return SVN_NO_ERROR;
+
+  /* Send what the peer expects to be uncompressed. */
+  SVN_ERR(svn_ra_svn_flush(conn, pool));
+
+  /* zlib accepts the same range of levels as svndiff. */
+  if (level < SVN_DELTA_COMPRESSION_LEVEL_NONE)
+    level = SVN_DELTA_COMPRESSION_LEVEL_NONE;
+  if (level > SVN_DELTA_COMPRESSION_LEVEL_MAX)
+    level = SVN_DELTA_COMPRESSION_LEVEL_MAX;
+
+  /* Any data left in the read buffer has already been compressed. */
+  SVN_ERR(svn_ra_svn__stream_compressed(&conn->stream, conn->stream, level,
+                                        conn->read_ptr,
+                                        conn->read_end - conn->read_ptr,
+                                        conn->pool));
+  conn->read_end = conn->read_ptr;
+  conn->compressed = TRUE;
+
+  return SVN_NO_ERROR;
+}
+
+svn_boolean_t
+svn_ra_svn__stream_compression_enabled(svn_ra_svn_conn_t *conn)
+{
+  return conn->compressed;
+}
+
+svn_boolean_t
+svn_ra_svn__is_encrypted(svn_ra_svn_conn_t *conn)
+{
+#ifdef SVN_HAVE_SASL
+  return conn->encrypted;
+#else
+  return FALSE;
+#endif
+}
+
 const char *svn_ra_svn_conn_remote_host(svn_ra_svn_conn_t *conn)
 {
   return conn->remote_ip;
@@ -169,6 +218,35 @@ svn_boolean_t svn_ra_svn__input_waiting(svn_ra_svn_conn_t *conn,
   return svn_ra_svn__stream_pending(conn->stream);
 }
 
+svn_boolean_t
+svn_ra_svn__data_available(svn_ra_svn_conn_t *conn)
+{
+  if (conn->read_ptr < conn->read_end)
+    return TRUE;
+
+  /* The SASL layer and the decompressor may hold data that we cannot
+     see here, so ask them. */
+  if (svn_ra_svn__is_encrypted(conn) || conn->compressed)
+    return svn_ra_svn__stream_pending(conn->stream);
+
+  return FALSE;
+}
+
+void
+svn_ra_svn__get_transfer_counts(apr_uint64_t *bytes_read,
+                                apr_uint64_t *bytes_written,
+                                svn_ra_svn_conn_t *conn)
+{
+  int i;
+
+  /* Report what the protocol layer has consumed and produced so far,
+     independent of what is still sitting in the buffers. */
+  *bytes_read = conn->bytes_read - (conn->read_end - conn->read_ptr);
+  *bytes_written = conn->bytes_written + conn->write_pos;
+  for (i = 0; i < conn->write_ref_count; ++i)
+    *bytes_written += conn->write_refs[i].len;
+}
+
 /* --- WRITE BUFFER MANAGEMENT --- */
 
 /* Write bytes into the write buffer until either the write buffer is
@@ -185,23 +263,28 @@ static const char *writebuf_push(svn_ra_svn_conn_t *conn, const char *data,
   return data + copylen;
 }
 
-/* Write data to socket or output file as appropriate. */
-static svn_error_t *writebuf_output(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
-                                    const char *data, apr_size_t len)
+/* Write the NVEC buffers in VEC to socket or output file as appropriate,
+ * using as few system calls as possible.  VEC will be modified. */
+static svn_error_t *writebuf_output_vec(svn_ra_svn_conn_t *conn,
+                                        apr_pool_t *pool,
+                                        struct iovec *vec, int nvec)
 {
-  const char *end = data + len;
   apr_size_t count;
   apr_pool_t *subpool = NULL;
   svn_ra_svn__session_baton_t *session = conn->session;
 
-  while (data < end)
+  while (nvec > 0 && vec->iov_len == 0)
     {
-      count = end - data;
+      ++vec;
+      --nvec;
+    }
 
+  while (nvec > 0)
+    {
       if (session && session->callbacks && session->callbacks->cancel_func)
         SVN_ERR((session->callbacks->cancel_func)(session->callbacks_baton));
 
-      SVN_ERR(svn_ra_svn__stream_write(conn->stream, data, &count));
+      SVN_ERR(svn_ra_svn__stream_writev(conn->stream, vec, nvec, &count));
       if (count == 0)
         {
           if (!subpool)
@@ -210,7 +293,7 @@ static svn_error_t *writebuf_output(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
             svn_pool_clear(subpool);
           SVN_ERR(conn->block_handler(conn, subpool, conn->block_baton));
         }
-      data += count;
+      conn->bytes_written += count;
 
       if (session)
         {
@@ -221,6 +304,19 @@ static svn_error_t *writebuf_output(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
             (cb->progress_func)(session->bytes_written + session->bytes_read,
                                 -1, cb->progress_baton, subpool);
         }
+
+      /* Skip what has been written. */
+      while (nvec > 0 && count >= vec->iov_len)
+        {
+          count -= vec->iov_len;
+          ++vec;
+          --nvec;
+        }
+      if (nvec > 0)
+        {
+          vec->iov_base = (char *)vec->iov_base + count;
+          vec->iov_len -= count;
+        }
     }
 
   if (subpool)
@@ -228,14 +324,53 @@ static svn_error_t *writebuf_output(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
   return SVN_NO_ERROR;
 }
 
-/* Write data from the write buffer out to the socket. */
+/* Write data from the write buffer, interleaved with the strings it
+ * references, out to the socket. */
 static svn_error_t *writebuf_flush(svn_ra_svn_conn_t *conn, apr_pool_t *pool)
 {
-  apr_size_t write_pos = conn->write_pos;
+  struct iovec vec[2 * SVN_RA_SVN__WRITE_REFS + 1];
+  apr_size_t offset = 0;
+  int i, nvec = 0;
+
+  for (i = 0; i < conn->write_ref_count; ++i)
+    {
+      const svn_ra_svn__write_ref_t *ref = &conn->write_refs[i];
+
+      vec[nvec].iov_base = conn->write_buf + offset;
+      vec[nvec].iov_len = ref->offset - offset;
+      vec[nvec + 1].iov_base = (void *)ref->data;
+      vec[nvec + 1].iov_len = ref->len;
+      nvec += 2;
+      offset = ref->offset;
+    }
 
-  /* Clear conn->write_pos first in case the block handler does a read. */
+  vec[nvec].iov_base = conn->write_buf + offset;
+  vec[nvec].iov_len = conn->write_pos - offset;
+  nvec++;
+
+  /* Clear the buffer first in case the block handler does a read. */
   conn->write_pos = 0;
-  SVN_ERR(writebuf_output(conn, pool, conn->write_buf, write_pos));
+  conn->write_ref_count = 0;
+  SVN_ERR(writebuf_output_vec(conn, pool, vec, nvec));
+  return SVN_NO_ERROR;
+}
+
+/* Queue a reference to LEN bytes at DATA for output on CONN.  DATA must
+ * remain valid until the next writebuf_flush(). */
+static svn_error_t *writebuf_add_ref(svn_ra_svn_conn_t *conn,
+                                     apr_pool_t *pool,
+                                     const char *data, apr_size_t len)
+{
+  svn_ra_svn__write_ref_t *ref;
+
+  if (conn->write_ref_count == SVN_RA_SVN__WRITE_REFS)
+    SVN_ERR(writebuf_flush(conn, pool));
+
+  ref = &conn->write_refs[conn->write_ref_count++];
+  ref->data = data;
+  ref->len = len;
+  ref->offset = conn->write_pos;
+
   return SVN_NO_ERROR;
 }
 
@@ -244,20 +379,61 @@ static svn_error_t *writebuf_write(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
 {
   const char *end = data + len;
 
-  if (conn->write_pos > 0 && conn->write_pos + len > sizeof(conn->write_buf))
+  if (conn->write_pos + len > sizeof(conn->write_buf))
     {
+      /* Send large chunks along with the buffer contents in a single
+         write but without copying them. */
+      if (len >= SVN_RA_SVN__WRITE_REF_THRESHOLD)
+        {
+          SVN_ERR(writebuf_add_ref(conn, pool, data, len));
+          return writebuf_flush(conn, pool);
+        }
+
       /* Fill and then empty the write buffer. */
       data = writebuf_push(conn, data, end);
       SVN_ERR(writebuf_flush(conn, pool));
     }
 
-  if (end - data > (apr_ssize_t)sizeof(conn->write_buf))
-    SVN_ERR(writebuf_output(conn, pool, data, end - data));
-  else
-    writebuf_push(conn, data, end);
+  writebuf_push(conn, data, end);
   return SVN_NO_ERROR;
 }
 
+/* Like writebuf_write but large chunks may not get sent before the next
+ * writebuf_flush() or writebuf_release(), so DATA must remain valid until
+ * then.  Chunks that fit into the write buffer get copied, though, such
+ * that a series of them still goes out in buffer-sized writes. */
+static svn_error_t *writebuf_write_ref(svn_ra_svn_conn_t *conn,
+                                       apr_pool_t *pool,
+                                       const char *data, apr_size_t len)
+{
+  if (len < SVN_RA_SVN__WRITE_REF_THRESHOLD
+      || conn->write_pos + len <= sizeof(conn->write_buf))
+    return writebuf_write(conn, pool, data, len);
+
+  return writebuf_add_ref(conn, pool, data, len);
+}
+
+/* Send any data on CONN that references memory owned by the caller,
+ * together with what has been buffered so far.  Every public function
+ * that uses writebuf_write_ref() must call this before returning and
+ * pass its own result in ERR. */
+static svn_error_t *
+writebuf_release(svn_ra_svn_conn_t *conn, apr_pool_t *pool, svn_error_t *err)
+{
+  if (conn->write_ref_count == 0)
+    return err;
+
+  /* The output is incomplete anyway.  Just make sure that we don't keep
+     references to memory that we don't own. */
+  if (err)
+    {
+      conn->write_ref_count = 0;
+      return err;
+    }
+
+  return writebuf_flush(conn, pool);
+}
+
 static svn_error_t *
 writebuf_write_short_string(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
                             const char *data, apr_size_t len)
@@ -318,6 +494,7 @@ static svn_error_t *readbuf_input(svn_ra_svn_conn_t *conn, char *data,
   if (*len == 0)
     return svn_error_create(SVN_ERR_RA_SVN_CONNECTION_CLOSED, NULL, NULL);
 
+  conn->bytes_read += *len;
   if (session)
     {
       const svn_ra_callbacks2_t *cb = session->callbacks;
@@ -457,39 +634,35 @@ svn_error_t *svn_ra_svn_write_number(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
   return write_number(conn, pool, number, ' ');
 }
 
-svn_error_t *svn_ra_svn_write_string(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
-                                     const svn_string_t *str)
+/* Write LEN bytes at DATA as a protocol string to CONN.  Large strings
+ * are not copied; see writebuf_write_ref(). */
+static svn_error_t *write_string(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
+                                 const char *data, apr_size_t len)
 {
-  if (str->len < 10)
+  if (len < 10)
     {
-      SVN_ERR(writebuf_writechar(conn, pool, (char)(str->len + '0')));
+      SVN_ERR(writebuf_writechar(conn, pool, (char)(len + '0')));
       SVN_ERR(writebuf_writechar(conn, pool, ':'));
     }
   else
-    SVN_ERR(write_number(conn, pool, str->len, ':'));
+    SVN_ERR(write_number(conn, pool, len, ':'));
 
-  SVN_ERR(writebuf_write(conn, pool, str->data, str->len));
+  SVN_ERR(writebuf_write_ref(conn, pool, data, len));
   SVN_ERR(writebuf_writechar(conn, pool, ' '));
   return SVN_NO_ERROR;
 }
 
+svn_error_t *svn_ra_svn_write_string(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
+                                     const svn_string_t *str)
+{
+  return writebuf_release(conn, pool,
+                          write_string(conn, pool, str->data, str->len));
+}
+
 svn_error_t *svn_ra_svn_write_cstring(svn_ra_svn_conn_t *conn,
                                       apr_pool_t *pool, const char *s)
 {
-  apr_size_t len = strlen(s);
-
-  if (len < 10)
-    {
-      SVN_ERR(writebuf_writechar(conn, pool, (char)(len + '0')));
-      SVN_ERR(writebuf_writechar(conn, pool, ':'));
-    }
-  else
-    SVN_ERR(write_number(conn, pool, len, ':'));
-
-  SVN_ERR(writebuf_write(conn, pool, s, len));
-  SVN_ERR(writebuf_writechar(conn, pool, ' '));
-
-  return SVN_NO_ERROR;
+  return writebuf_release(conn, pool, write_string(conn, pool, s, strlen(s)));
 }
 
 svn_error_t *svn_ra_svn_write_word(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
@@ -580,7 +753,7 @@ static svn_error_t *vwrite_tuple(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
         {
           cstr = va_arg(ap, const char *);
           if (cstr)
-            SVN_ERR(svn_ra_svn_write_cstring(conn, pool, cstr));
+            SVN_ERR(write_string(conn, pool, cstr, strlen(cstr)));
           else
             SVN_ERR_ASSERT(opt);
         }
@@ -588,7 +761,7 @@ static svn_error_t *vwrite_tuple(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
         {
           str = va_arg(ap, const svn_string_t *);
           if (str)
-            SVN_ERR(svn_ra_svn_write_string(conn, pool, str));
+            SVN_ERR(write_string(conn, pool, str->data, str->len));
           else
             SVN_ERR_ASSERT(opt);
         }
@@ -642,7 +815,7 @@ svn_error_t *svn_ra_svn_write_tuple(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
   va_start(ap, fmt);
   err = vwrite_tuple(conn, pool, fmt, ap);
   va_end(ap);
-  return err;
+  return svn_error_trace(writebuf_release(conn, pool, err));
 }
 
 /* --- READING DATA ITEMS --- */
@@ -713,6 +886,64 @@ static svn_error_t *read_string(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
   return SVN_NO_ERROR;
 }
 
+/* Read LEN bytes of string data from CONN and write them to STREAM,
+ * unless that is NULL, in pieces taken straight from the read buffer. */
+static svn_error_t *read_string_to_stream(svn_ra_svn_conn_t *conn,
+                                          apr_pool_t *pool,
+                                          svn_stream_t *stream,
+                                          apr_uint64_t len)
+{
+  while (len > 0)
+    {
+      apr_size_t count;
+
+      if (conn->read_ptr == conn->read_end)
+        SVN_ERR(readbuf_fill(conn, pool));
+
+      count = conn->read_end - conn->read_ptr;
+      if (count > len)
+        count = (apr_size_t)len;
+
+      if (stream)
+        {
+          apr_size_t written = count;
+          SVN_ERR(svn_stream_write(stream, conn->read_ptr, &written));
+        }
+
+      conn->read_ptr += count;
+      len -= count;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Given the first digit FIRST_CHAR of a number, read the remaining
+ * digits from CONN.  Return the number in *VAL and the first character
+ * after it in *NEXT_CHAR. */
+static svn_error_t *read_number(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
+                                char first_char, apr_uint64_t *val,
+                                char *next_char)
+{
+  char c;
+
+  *val = first_char - '0';
+  while (1)
+    {
+      apr_uint64_t prev_val = *val;
+      SVN_ERR(readbuf_getchar(conn, pool, &c));
+      if (!svn_ctype_isdigit(c))
+        break;
+      *val = *val * 10 + (c - '0');
+      /* val wrapped past maximum value? */
+      if (prev_val >= (APR_UINT64_MAX / 10) && (*val / 10) != prev_val)
+        return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                                _("Number is larger than maximum"));
+    }
+
+  *next_char = c;
+  return SVN_NO_ERROR;
+}
+
 /* Given the first non-whitespace character FIRST_CHAR, read an item
  * into the already allocated structure ITEM.  LEVEL should be set
  * to 0 for the first call and is used to enforce a recurssion limit
@@ -737,19 +968,7 @@ static svn_error_t *read_item(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
   if (svn_ctype_isdigit(c))
     {
       /* It's a number or a string.  Read the number part, either way. */
-      val = c - '0';
-      while (1)
-        {
-          apr_uint64_t prev_val = val;
-          SVN_ERR(readbuf_getchar(conn, pool, &c));
-          if (!svn_ctype_isdigit(c))
-            break;
-          val = val * 10 + (c - '0');
-          /* val wrapped past maximum value? */
-          if (prev_val >= (APR_UINT64_MAX / 10) && (val / 10) != prev_val)
-            return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
-                                    _("Number is larger than maximum"));
-        }
+      SVN_ERR(read_number(conn, pool, c, &val, &c));
       if (c == ':')
         {
           /* It's a string. */
@@ -818,6 +1037,79 @@ svn_error_t *svn_ra_svn_skip_leading_garbage(svn_ra_svn_conn_t *conn,
   return readbuf_skip_leading_garbage(conn, pool);
 }
 
+svn_error_t *
+svn_ra_svn__read_string_to_stream(svn_ra_svn_conn_t *conn,
+                                  apr_pool_t *pool,
+                                  svn_stream_t *stream,
+                                  apr_uint64_t *len)
+{
+  char c;
+
+  SVN_ERR(readbuf_getchar_skip_whitespace(conn, pool, &c));
+  if (!svn_ctype_isdigit(c))
+    return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                            _("Expected a string"));
+
+  SVN_ERR(read_number(conn, pool, c, len, &c));
+  if (c != ':')
+    return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                            _("Expected a string"));
+
+  SVN_ERR(read_string_to_stream(conn, pool, stream, *len));
+  SVN_ERR(readbuf_getchar(conn, pool, &c));
+  if (!svn_iswhitespace(c))
+    return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                            _("Malformed network data"));
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_ra_svn__read_list_start(svn_ra_svn_conn_t *conn,
+                            apr_pool_t *pool)
+{
+  char c;
+
+  SVN_ERR(readbuf_getchar_skip_whitespace(conn, pool, &c));
+  if (c != '(')
+    return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                            _("Expected a list"));
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_ra_svn__read_list_end(svn_ra_svn_conn_t *conn,
+                          apr_pool_t *pool)
+{
+  apr_pool_t *iterpool = NULL;
+  svn_ra_svn_item_t item;
+  char c;
+
+  /* Like svn_ra_svn_parse_tuple(), ignore items we don't know about. */
+  while (1)
+    {
+      SVN_ERR(readbuf_getchar_skip_whitespace(conn, pool, &c));
+      if (c == ')')
+        break;
+
+      if (iterpool)
+        svn_pool_clear(iterpool);
+      else
+        iterpool = svn_pool_create(pool);
+      SVN_ERR(read_item(conn, iterpool, &item, c, 0));
+    }
+  if (iterpool)
+    svn_pool_destroy(iterpool);
+
+  SVN_ERR(readbuf_getchar(conn, pool, &c));
+  if (!svn_iswhitespace(c))
+    return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                            _("Malformed network data"));
+
+  return SVN_NO_ERROR;
+}
+
 /* --- READING AND PARSING TUPLES --- */
 
 /* Parse a tuple of svn_ra_svn_item_t *'s.  Advance *FMT to the end of the
@@ -1068,6 +1360,71 @@ svn_error_t *svn_ra_svn_read_cmd_response(svn_ra_svn_conn_t *conn,
                            status);
 }
 
+svn_error_t *
+svn_ra_svn__handle_command(svn_boolean_t *terminate,
+                           svn_ra_svn__command_info_t *info,
+                           apr_hash_t *cmd_hash,
+                           void *baton,
+                           svn_ra_svn_conn_t *conn,
+                           svn_boolean_t error_on_disconnect,
+                           apr_pool_t *pool)
+{
+  const char *cmdname;
+  const svn_ra_svn_cmd_entry_t *command;
+  svn_error_t *err, *write_err;
+  apr_array_header_t *params;
+
+  *terminate = FALSE;
+  err = svn_ra_svn_read_tuple(conn, pool, "wl", &cmdname, &params);
+  if (err)
+    {
+      if (!error_on_disconnect
+          && err->apr_err == SVN_ERR_RA_SVN_CONNECTION_CLOSED)
+        {
+          svn_error_clear(err);
+          *terminate = TRUE;
+          return SVN_NO_ERROR;
+        }
+      return err;
+    }
+  command = apr_hash_get(cmd_hash, cmdname, APR_HASH_KEY_STRING);
+
+  if (info)
+    {
+      info->cmdname = cmdname;
+      info->failed = FALSE;
+      if (info->start_func)
+        SVN_ERR(info->start_func(info->start_baton, cmdname));
+    }
+
+  if (command)
+    err = (*command->handler)(conn, pool, params, baton);
+  else
+    {
+      err = svn_error_createf(SVN_ERR_RA_SVN_UNKNOWN_CMD, NULL,
+                              _("Unknown command '%s'"), cmdname);
+      err = svn_error_create(SVN_ERR_RA_SVN_CMD_ERR, err, NULL);
+    }
+
+  if (err && err->apr_err == SVN_ERR_RA_SVN_CMD_ERR)
+    {
+      if (info)
+        info->failed = TRUE;
+
+      write_err = svn_ra_svn_write_cmd_failure(
+                      conn, pool,
+                      svn_ra_svn__locate_real_error_child(err));
+      svn_error_clear(err);
+      if (write_err)
+        return write_err;
+    }
+  else if (err)
+    return err;
+
+  *terminate = (command && command->terminate);
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *svn_ra_svn_handle_commands2(svn_ra_svn_conn_t *conn,
                                          apr_pool_t *pool,
                                          const svn_ra_svn_cmd_entry_t *commands,
@@ -1076,55 +1433,19 @@ svn_error_t *svn_ra_svn_handle_commands2(svn_ra_svn_conn_t *conn,
 {
   apr_pool_t *subpool = svn_pool_create(pool);
   apr_pool_t *iterpool = svn_pool_create(subpool);
-  const char *cmdname;
   const svn_ra_svn_cmd_entry_t *command;
-  svn_error_t *err, *write_err;
-  apr_array_header_t *params;
+  svn_boolean_t terminate = FALSE;
   apr_hash_t *cmd_hash = apr_hash_make(subpool);
 
   for (command = commands; command->cmdname; command++)
     apr_hash_set(cmd_hash, command->cmdname, APR_HASH_KEY_STRING, command);
 
-  while (1)
+  while (! terminate)
     {
       svn_pool_clear(iterpool);
-      err = svn_ra_svn_read_tuple(conn, iterpool, "wl", &cmdname, &params);
-      if (err)
-        {
-          if (!error_on_disconnect
-              && err->apr_err == SVN_ERR_RA_SVN_CONNECTION_CLOSED)
-            {
-              svn_error_clear(err);
-              svn_pool_destroy(subpool);
-              return SVN_NO_ERROR;
-            }
-          return err;
-        }
-      command = apr_hash_get(cmd_hash, cmdname, APR_HASH_KEY_STRING);
-
-      if (command)
-        err = (*command->handler)(conn, iterpool, params, baton);
-      else
-        {
-          err = svn_error_createf(SVN_ERR_RA_SVN_UNKNOWN_CMD, NULL,
-                                  _("Unknown command '%s'"), cmdname);
-          err = svn_error_create(SVN_ERR_RA_SVN_CMD_ERR, err, NULL);
-        }
-
-      if (err && err->apr_err == SVN_ERR_RA_SVN_CMD_ERR)
-        {
-          write_err = svn_ra_svn_write_cmd_failure(
-                          conn, iterpool,
-                          svn_ra_svn__locate_real_error_child(err));
-          svn_error_clear(err);
-          if (write_err)
-            return write_err;
-        }
-      else if (err)
-        return err;
-
-      if (command && command->terminate)
-        break;
+      SVN_ERR(svn_ra_svn__handle_command(&terminate, NULL, cmd_hash, baton,
+                                         conn, error_on_disconnect,
+                                         iterpool));
     }
   svn_pool_destroy(iterpool);
   svn_pool_destroy(subpool);
@@ -1150,7 +1471,10 @@ svn_error_t *svn_ra_svn_write_cmd(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
   va_start(ap, fmt);
   err = vwrite_tuple(conn, pool, fmt, ap);
   va_end(ap);
-  return err ? svn_error_trace(err) : svn_ra_svn_end_list(conn, pool);
+  if (! err)
+    err = svn_ra_svn_end_list(conn, pool);
+
+  return svn_error_trace(writebuf_release(conn, pool, err));
 }
 
 svn_error_t *svn_ra_svn_write_cmd_response(svn_ra_svn_conn_t *conn,
@@ -1164,7 +1488,10 @@ svn_error_t *svn_ra_svn_write_cmd_response(svn_ra_svn_conn_t *conn,
   va_start(ap, fmt);
   err = vwrite_tuple(conn, pool, fmt, ap);
   va_end(ap);
-  return err ? svn_error_trace(err) : svn_ra_svn_end_list(conn, pool);
+  if (! err)
+    err = svn_ra_svn_end_list(conn, pool);
+
+  return svn_error_trace(writebuf_release(conn, pool, err));
 }
 
 svn_error_t *svn_ra_svn_write_cmd_failure(svn_ra_svn_conn_t *conn,
@@ -30,6 +30,8 @@
 extern "C" {
 #endif /* __cplusplus */
 
+#define APR_WANT_IOVEC
+#include <apr_want.h>
 #include <apr_network_io.h>
 #include <apr_file_io.h>
 #include <apr_thread_proc.h>
@@ -41,6 +43,15 @@ extern "C" {
  */
 typedef svn_boolean_t (*ra_svn_pending_fn_t)(void *baton);
 
+/* Callback function that writes the contents of the NVEC buffers in VEC,
+ * in that order, to a svn_ra_svn__stream_t.  Like svn_write_fn_t, it
+ * returns the number of bytes actually written in *LEN.
+ */
+typedef svn_error_t *(*ra_svn_writev_fn_t)(void *baton,
+                                           const struct iovec *vec,
+                                           int nvec,
+                                           apr_size_t *len);
+
 /* Callback function that sets the timeout value for a svn_ra_svn__stream_t. */
 typedef void (*ra_svn_timeout_fn_t)(void *baton, apr_interval_time_t timeout);
 
@@ -60,6 +71,22 @@ typedef svn_error_t *(*ra_svn_block_handler_t)(svn_ra_svn_conn_t *conn,
 #define SVN_RA_SVN__READBUF_SIZE (4*4096)
 #define SVN_RA_SVN__WRITEBUF_SIZE (4*4096)
 
+/* Strings of at least this size that don't fit into the space left in the
+ * write buffer don't get copied into it.  Instead, they are sent directly
+ * from the caller's memory, gathered with the surrounding buffer contents
+ * in a single write. */
+#define SVN_RA_SVN__WRITE_REF_THRESHOLD 4096
+
+/* Maximum number of such strings pending at any time. */
+#define SVN_RA_SVN__WRITE_REFS 8
+
+/* A string to be sent after the first OFFSET bytes of the write buffer. */
+typedef struct svn_ra_svn__write_ref_t {
+  const char *data;
+  apr_size_t len;
+  apr_size_t offset;
+} svn_ra_svn__write_ref_t;
+
 /* Create forward reference */
 typedef struct svn_ra_svn__session_baton_t svn_ra_svn__session_baton_t;
 
@@ -80,14 +107,22 @@ struct svn_ra_svn_conn_st {
   char *read_end;
   char write_buf[SVN_RA_SVN__WRITEBUF_SIZE];
   apr_size_t write_pos;
+  svn_ra_svn__write_ref_t write_refs[SVN_RA_SVN__WRITE_REFS];
+  int write_ref_count;
   const char *uuid;
   const char *repos_root;
   ra_svn_block_handler_t block_handler;
   void *block_baton;
   apr_hash_t *capabilities;
   int compression_level;
+  svn_boolean_t compressed;
   char *remote_ip;
   svn_delta_shim_callbacks_t *shim_callbacks;
+
+  /* Bytes received and sent through STREAM so far. */
+  apr_uint64_t bytes_read;
+  apr_uint64_t bytes_written;
+
   apr_pool_t *pool;
 };
 
@@ -104,6 +139,8 @@ struct svn_ra_svn__session_baton_t {
   void *callbacks_baton;
   apr_off_t bytes_read, bytes_written; /* apr_off_t's because that's what
                                           the callback interface uses */
+  int max_connections; /* Connections per update, including this one. */
+  int read_ahead; /* Response items to read ahead for log and blame. */
 };
 
 /* Set a callback for blocked writes on conn.  This handler may
@@ -155,12 +192,41 @@ svn_ra_svn__stream_t *svn_ra_svn__stream_create(void *baton,
                                                 ra_svn_pending_fn_t pending_cb,
                                                 apr_pool_t *pool);
 
+/* Set *COMPRESSED to a stream that compresses the data written to it
+ * with zlib at LEVEL before passing it on to STREAM and that decompresses
+ * the data read from STREAM.  The first PENDING_LEN bytes of compressed
+ * input are taken from PENDING_DATA rather than STREAM.  PENDING_LEN must
+ * not exceed #SVN_RA_SVN__READBUF_SIZE.  Allocate the new stream in POOL.
+ */
+svn_error_t *
+svn_ra_svn__stream_compressed(svn_ra_svn__stream_t **compressed,
+                              svn_ra_svn__stream_t *stream,
+                              int level,
+                              const char *pending_data,
+                              apr_size_t pending_len,
+                              apr_pool_t *pool);
+
+/* Let STREAM use WRITEV_CB for gathered writes.  Without it,
+ * svn_ra_svn__stream_writev() falls back to the WRITE_CB given to
+ * svn_ra_svn__stream_create().
+ */
+void svn_ra_svn__stream_set_writev(svn_ra_svn__stream_t *stream,
+                                   ra_svn_writev_fn_t writev_cb);
+
 /* Write *LEN bytes from DATA to STREAM, returning the number of bytes
  * written in *LEN.
  */
 svn_error_t *svn_ra_svn__stream_write(svn_ra_svn__stream_t *stream,
                                       const char *data, apr_size_t *len);
 
+/* Write the contents of the NVEC buffers in VEC, in that order, to
+ * STREAM, returning the number of bytes written in *LEN.  Like
+ * svn_ra_svn__stream_write(), this may write less than all of the data.
+ */
+svn_error_t *svn_ra_svn__stream_writev(svn_ra_svn__stream_t *stream,
+                                       const struct iovec *vec, int nvec,
+                                       apr_size_t *len);
+
 /* Read *LEN bytes from STREAM into DATA, returning the number of bytes
  * read in *LEN.
  */
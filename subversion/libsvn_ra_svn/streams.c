@@ -27,19 +27,36 @@
 #include <apr_network_io.h>
 #include <apr_poll.h>
 
+#include <zlib.h>
+
 #include "svn_types.h"
 #include "svn_error.h"
 #include "svn_pools.h"
 #include "svn_io.h"
 #include "svn_private_config.h"
 
+#include "private/svn_error_private.h"
+
 #include "ra_svn.h"
 
+/* Maximum amount of data that a compressed stream compresses and sends
+   in one go. */
+#define COMPRESS_CHUNK_SIZE (64 * 1024)
+
+/* By how much to extend the output buffer of a compressed stream while
+   compressing. */
+#define COMPRESS_BUFFER_STEP (16 * 1024)
+
+/* Size of the data that a compressed stream may decompress ahead of
+   being read, in order to find out whether it has data pending. */
+#define DECOMPRESS_LOOKAHEAD_SIZE 4096
+
 struct svn_ra_svn__stream_st {
   svn_stream_t *stream;
   void *baton;
   ra_svn_pending_fn_t pending_fn;
   ra_svn_timeout_fn_t timeout_fn;
+  ra_svn_writev_fn_t writev_fn;
 };
 
 typedef struct sock_baton_t {
@@ -92,6 +109,18 @@ file_write_cb(void *baton, const char *buffer, apr_size_t *len)
   return SVN_NO_ERROR;
 }
 
+/* Implements ra_svn_writev_fn_t */
+static svn_error_t *
+file_writev_cb(void *baton, const struct iovec *vec, int nvec,
+               apr_size_t *len)
+{
+  file_baton_t *b = baton;
+  apr_status_t status = apr_file_writev(b->out_file, vec, nvec, len);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't write to connection"));
+  return SVN_NO_ERROR;
+}
+
 /* Implements ra_svn_timeout_fn_t */
 static void
 file_timeout_cb(void *baton, apr_interval_time_t interval)
@@ -119,14 +148,17 @@ svn_ra_svn__stream_from_files(apr_file_t *in_file,
                               apr_pool_t *pool)
 {
   file_baton_t *b = apr_palloc(pool, sizeof(*b));
+  svn_ra_svn__stream_t *s;
 
   b->in_file = in_file;
   b->out_file = out_file;
   b->pool = pool;
 
-  return svn_ra_svn__stream_create(b, file_read_cb, file_write_cb,
-                                   file_timeout_cb, file_pending_cb,
-                                   pool);
+  s = svn_ra_svn__stream_create(b, file_read_cb, file_write_cb,
+                                file_timeout_cb, file_pending_cb, pool);
+  svn_ra_svn__stream_set_writev(s, file_writev_cb);
+
+  return s;
 }
 
 /* Functions to implement a socket backed svn_ra_svn__stream_t. */
@@ -171,6 +203,18 @@ sock_write_cb(void *baton, const char *buffer, apr_size_t *len)
   return SVN_NO_ERROR;
 }
 
+/* Implements ra_svn_writev_fn_t */
+static svn_error_t *
+sock_writev_cb(void *baton, const struct iovec *vec, int nvec,
+               apr_size_t *len)
+{
+  sock_baton_t *b = baton;
+  apr_status_t status = apr_socket_sendv(b->sock, vec, nvec, len);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't write to connection"));
+  return SVN_NO_ERROR;
+}
+
 /* Implements ra_svn_timeout_fn_t */
 static void
 sock_timeout_cb(void *baton, apr_interval_time_t interval)
@@ -197,13 +241,303 @@ svn_ra_svn__stream_from_sock(apr_socket_t *sock,
                              apr_pool_t *pool)
 {
   sock_baton_t *b = apr_palloc(pool, sizeof(*b));
+  svn_ra_svn__stream_t *s;
 
   b->sock = sock;
   b->pool = pool;
 
-  return svn_ra_svn__stream_create(b, sock_read_cb, sock_write_cb,
-                                   sock_timeout_cb, sock_pending_cb,
-                                   pool);
+  s = svn_ra_svn__stream_create(b, sock_read_cb, sock_write_cb,
+                                sock_timeout_cb, sock_pending_cb, pool);
+  svn_ra_svn__stream_set_writev(s, sock_writev_cb);
+
+  return s;
+}
+
+/* Functions to implement a zlib compressed svn_ra_svn__stream_t. */
+
+typedef struct zlib_baton_t {
+  svn_ra_svn__stream_t *stream;   /* Inherited stream. */
+
+  /* Decompression state and the compressed data read from STREAM. */
+  z_stream in;
+  char *in_buf;
+
+  /* Data decompressed while checking for pending data but not yet read. */
+  char lookahead[DECOMPRESS_LOOKAHEAD_SIZE];
+  apr_size_t lookahead_pos;
+  apr_size_t lookahead_len;
+
+  /* Compression state and the compressed data from OUT_POS onwards that
+     still needs to be written to STREAM.  It represents OUT_CONSUMED
+     bytes of uncompressed data. */
+  z_stream out;
+  svn_stringbuf_t *out_buf;
+  apr_size_t out_pos;
+  apr_size_t out_consumed;
+} zlib_baton_t;
+
+/* zlib alloc function.  OPAQUE is the pool we need. */
+static voidpf
+zlib_alloc(voidpf opaque, uInt items, uInt size)
+{
+  apr_pool_t *pool = opaque;
+
+  return apr_palloc(pool, items * size);
+}
+
+/* zlib free function */
+static void
+zlib_free(voidpf opaque, voidpf address)
+{
+  /* Empty, since we allocate on the pool */
+}
+
+/* Compress LEN bytes at DATA with B's compression state, using zlib's
+   flush mode FLUSH, and append the result to B->OUT_BUF. */
+static svn_error_t *
+deflate_data(zlib_baton_t *b, const char *data, apr_size_t len, int flush)
+{
+  b->out.next_in = (Bytef *)data;  /* Casting away const! */
+  b->out.avail_in = (uInt)len;
+
+  do
+    {
+      int zerr;
+
+      svn_stringbuf_ensure(b->out_buf,
+                           b->out_buf->len + COMPRESS_BUFFER_STEP);
+      b->out.next_out = (Bytef *)b->out_buf->data + b->out_buf->len;
+      b->out.avail_out = COMPRESS_BUFFER_STEP;
+
+      /* Z_BUF_ERROR only means that there was nothing left to do. */
+      zerr = deflate(&b->out, flush);
+      if (zerr != Z_BUF_ERROR)
+        SVN_ERR(svn_error__wrap_zlib(zerr, "deflate", b->out.msg));
+
+      b->out_buf->len += COMPRESS_BUFFER_STEP - b->out.avail_out;
+      b->out_buf->data[b->out_buf->len] = '\0';
+    }
+  while (b->out.avail_in > 0 || b->out.avail_out == 0);
+
+  return SVN_NO_ERROR;
+}
+
+/* Decompress as much of B's pending input as fits into the SIZE bytes
+   at BUFFER and return the number of bytes produced in *PRODUCED. */
+static svn_error_t *
+inflate_data(zlib_baton_t *b, char *buffer, apr_size_t size,
+             apr_size_t *produced)
+{
+  int zerr;
+
+  /* There's no reason for SIZE to exceed the range of uInt but
+     Subversion's API uses apr_size_t. */
+  if (size > COMPRESS_CHUNK_SIZE)
+    size = COMPRESS_CHUNK_SIZE;
+
+  b->in.next_out = (Bytef *)buffer;
+  b->in.avail_out = (uInt)size;
+
+  /* We never finish the stream, so its end means corrupt data. */
+  zerr = inflate(&b->in, Z_SYNC_FLUSH);
+  if (zerr == Z_STREAM_END)
+    return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                            _("Unexpected end of compressed data"));
+  if (zerr != Z_BUF_ERROR)
+    SVN_ERR(svn_error__wrap_zlib(zerr, "inflate", b->in.msg));
+
+  *produced = size - b->in.avail_out;
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_read_fn_t */
+static svn_error_t *
+zlib_read_cb(void *baton, char *buffer, apr_size_t *len)
+{
+  zlib_baton_t *b = baton;
+  apr_size_t produced;
+
+  /* Hand out what we have decompressed already first. */
+  if (b->lookahead_pos < b->lookahead_len)
+    {
+      apr_size_t available = b->lookahead_len - b->lookahead_pos;
+
+      if (*len > available)
+        *len = available;
+      memcpy(buffer, b->lookahead + b->lookahead_pos, *len);
+      b->lookahead_pos += *len;
+
+      return SVN_NO_ERROR;
+    }
+
+  /* Compressed data may not produce any output, e.g. for flush markers,
+     so keep reading until we have something to return. */
+  do
+    {
+      if (b->in.avail_in == 0)
+        {
+          apr_size_t count = SVN_RA_SVN__READBUF_SIZE;
+
+          SVN_ERR(svn_ra_svn__stream_read(b->stream, b->in_buf, &count));
+          b->in.next_in = (Bytef *)b->in_buf;
+          b->in.avail_in = (uInt)count;
+        }
+
+      SVN_ERR(inflate_data(b, buffer, *len, &produced));
+    }
+  while (produced == 0);
+
+  *len = produced;
+  return SVN_NO_ERROR;
+}
+
+/* Implements ra_svn_writev_fn_t */
+static svn_error_t *
+zlib_writev_cb(void *baton, const struct iovec *vec, int nvec,
+               apr_size_t *len)
+{
+  zlib_baton_t *b = baton;
+
+  /* Unless a previous call got blocked while sending its compressed data,
+     compress the next chunk of input.  In the blocked case, our caller
+     retries with the same arguments, so we just continue sending. */
+  if (b->out_pos == b->out_buf->len)
+    {
+      int i;
+
+      svn_stringbuf_setempty(b->out_buf);
+      b->out_pos = 0;
+      b->out_consumed = 0;
+
+      for (i = 0; i < nvec && b->out_consumed < COMPRESS_CHUNK_SIZE; ++i)
+        {
+          apr_size_t chunk = vec[i].iov_len;
+
+          if (chunk > COMPRESS_CHUNK_SIZE - b->out_consumed)
+            chunk = COMPRESS_CHUNK_SIZE - b->out_consumed;
+
+          SVN_ERR(deflate_data(b, vec[i].iov_base, chunk, Z_NO_FLUSH));
+          b->out_consumed += chunk;
+        }
+
+      /* Make sure that the receiver can decompress everything we got. */
+      SVN_ERR(deflate_data(b, NULL, 0, Z_SYNC_FLUSH));
+    }
+
+  while (b->out_pos < b->out_buf->len)
+    {
+      apr_size_t count = b->out_buf->len - b->out_pos;
+
+      SVN_ERR(svn_ra_svn__stream_write(b->stream,
+                                       b->out_buf->data + b->out_pos,
+                                       &count));
+      if (count == 0)
+        {
+          *len = 0;
+          return SVN_NO_ERROR;
+        }
+
+      b->out_pos += count;
+    }
+
+  *len = b->out_consumed;
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_write_fn_t */
+static svn_error_t *
+zlib_write_cb(void *baton, const char *buffer, apr_size_t *len)
+{
+  struct iovec vec;
+
+  vec.iov_base = (void *)buffer;
+  vec.iov_len = *len;
+
+  return zlib_writev_cb(baton, &vec, 1, len);
+}
+
+/* Implements ra_svn_timeout_fn_t */
+static void
+zlib_timeout_cb(void *baton, apr_interval_time_t interval)
+{
+  zlib_baton_t *b = baton;
+  svn_ra_svn__stream_timeout(b->stream, interval);
+}
+
+/* Implements ra_svn_pending_fn_t */
+static svn_boolean_t
+zlib_pending_cb(void *baton)
+{
+  zlib_baton_t *b = baton;
+
+  if (b->lookahead_pos < b->lookahead_len)
+    return TRUE;
+
+  /* Compressed input that we already have may or may not decompress to
+     something.  Find out without blocking. */
+  if (b->in.avail_in > 0)
+    {
+      apr_size_t produced;
+      svn_error_t *err = inflate_data(b, b->lookahead, sizeof(b->lookahead),
+                                      &produced);
+
+      /* Let the next read report corrupted data. */
+      if (err)
+        {
+          svn_error_clear(err);
+          return TRUE;
+        }
+
+      b->lookahead_pos = 0;
+      b->lookahead_len = produced;
+      if (produced > 0)
+        return TRUE;
+    }
+
+  return svn_ra_svn__stream_pending(b->stream);
+}
+
+svn_error_t *
+svn_ra_svn__stream_compressed(svn_ra_svn__stream_t **compressed,
+                              svn_ra_svn__stream_t *stream,
+                              int level,
+                              const char *pending_data,
+                              apr_size_t pending_len,
+                              apr_pool_t *pool)
+{
+  zlib_baton_t *b = apr_pcalloc(pool, sizeof(*b));
+  int zerr;
+
+  SVN_ERR_ASSERT(pending_len <= SVN_RA_SVN__READBUF_SIZE);
+
+  b->stream = stream;
+
+  b->in.zalloc = zlib_alloc;
+  b->in.zfree = zlib_free;
+  b->in.opaque = pool;
+  zerr = inflateInit(&b->in);
+  SVN_ERR(svn_error__wrap_zlib(zerr, "inflateInit", b->in.msg));
+
+  b->in_buf = apr_palloc(pool, SVN_RA_SVN__READBUF_SIZE);
+  if (pending_len > 0)
+    memcpy(b->in_buf, pending_data, pending_len);
+  b->in.next_in = (Bytef *)b->in_buf;
+  b->in.avail_in = (uInt)pending_len;
+
+  b->out.zalloc = zlib_alloc;
+  b->out.zfree = zlib_free;
+  b->out.opaque = pool;
+  zerr = deflateInit(&b->out, level);
+  SVN_ERR(svn_error__wrap_zlib(zerr, "deflateInit", b->out.msg));
+
+  b->out_buf = svn_stringbuf_create_ensure(COMPRESS_BUFFER_STEP, pool);
+
+  *compressed = svn_ra_svn__stream_create(b, zlib_read_cb, zlib_write_cb,
+                                          zlib_timeout_cb, zlib_pending_cb,
+                                          pool);
+  svn_ra_svn__stream_set_writev(*compressed, zlib_writev_cb);
+
+  return SVN_NO_ERROR;
 }
 
 svn_ra_svn__stream_t *
@@ -224,9 +558,17 @@ svn_ra_svn__stream_create(void *baton,
   s->baton = baton;
   s->timeout_fn = timeout_cb;
   s->pending_fn = pending_cb;
+  s->writev_fn = NULL;
   return s;
 }
 
+void
+svn_ra_svn__stream_set_writev(svn_ra_svn__stream_t *stream,
+                              ra_svn_writev_fn_t writev_cb)
+{
+  stream->writev_fn = writev_cb;
+}
+
 svn_error_t *
 svn_ra_svn__stream_write(svn_ra_svn__stream_t *stream,
                          const char *data, apr_size_t *len)
@@ -234,6 +576,31 @@ svn_ra_svn__stream_write(svn_ra_svn__stream_t *stream,
   return svn_stream_write(stream->stream, data, len);
 }
 
+svn_error_t *
+svn_ra_svn__stream_writev(svn_ra_svn__stream_t *stream,
+                          const struct iovec *vec, int nvec,
+                          apr_size_t *len)
+{
+  if (stream->writev_fn)
+    return stream->writev_fn(stream->baton, vec, nvec, len);
+
+  /* Partial writes are fine, so just write the first non-empty buffer. */
+  while (nvec > 0 && vec->iov_len == 0)
+    {
+      ++vec;
+      --nvec;
+    }
+
+  if (nvec == 0)
+    {
+      *len = 0;
+      return SVN_NO_ERROR;
+    }
+
+  *len = vec->iov_len;
+  return svn_stream_write(stream->stream, (const char *)vec->iov_base, len);
+}
+
 svn_error_t *
 svn_ra_svn__stream_read(svn_ra_svn__stream_t *stream, char *data,
                         apr_size_t *len)
@@ -33,53 +33,448 @@
 #include "svn_repos.h"
 #include "svn_config.h"
 #include "svn_ctype.h"
+#include "svn_io.h"
+#include "private/svn_atomic.h"
+#include "private/svn_cache.h"
 #include "private/svn_fspath.h"
+#include "private/svn_mutex.h"
+#include "private/svn_repos_private.h"
 
 
 /*** Structures. ***/
 
-/* Information for the config enumerators called during authz
-   lookup. */
-struct authz_lookup_baton {
-  /* The authz configuration. */
-  svn_config_t *config;
+/* Information for the config enumeration functions called during the
+   validation process. */
+struct authz_validate_baton {
+  svn_config_t *config; /* The configuration file being validated. */
+  svn_error_t *err;     /* The error being thrown out of the
+                           enumerator, if any. */
+};
+
+/* The kinds of match strings that authz rules may use. */
+typedef enum authz_rule_kind_t
+{
+  /* "*" */
+  authz_rule_everyone,
+
+  /* "$anonymous" */
+  authz_rule_anonymous,
 
-  /* The user to authorize. */
+  /* "$authenticated" */
+  authz_rule_authenticated,
+
+  /* A user name. */
+  authz_rule_user,
+
+  /* "&alias" */
+  authz_rule_alias,
+
+  /* "@group" */
+  authz_rule_group
+} authz_rule_kind_t;
+
+/* One line of an authz section in compiled form. */
+typedef struct authz_rule_t
+{
+  /* Whom the rule applies to, and whether that is inverted by "~". */
+  authz_rule_kind_t kind;
+  svn_boolean_t inverted;
+
+  /* For user rules, the user name.  For alias rules, the name of the
+     user that the alias stands for. */
   const char *user;
 
-  /* Explicitly granted rights. */
+  /* For group rules, the users in the group, including those of its
+     subgroups and aliases.  Maps user names to themselves. */
+  apr_hash_t *members;
+
+  /* The access that the rule explicitly grants and denies. */
   svn_repos_authz_access_t allow;
-  /* Explicitly denied rights. */
   svn_repos_authz_access_t deny;
+} authz_rule_t;
 
-  /* The rights required by the caller of the lookup. */
-  svn_repos_authz_access_t required_access;
+/* A node in the tree of paths that the authz file defines rules for. */
+typedef struct authz_node_t
+{
+  /* The rules of the pan-repository section for this path, as an array
+     of authz_rule_t, or NULL if there is no such section. */
+  apr_array_header_t *rules;
+
+  /* Maps repository names to the rules of the repository-specific
+     sections for this path.  NULL if there are none. */
+  apr_hash_t *repos_rules;
+
+  /* Maps the names of the children of this path to their authz_node_t.
+     NULL if there are no rules for any path below this one. */
+  apr_hash_t *children;
+} authz_node_t;
+
+/* Dimensions of the cache of access check results in svn_authz_t. */
+#define AUTHZ_CACHE_PAGES 16
+#define AUTHZ_CACHE_ITEMS_PER_PAGE 256
+
+/* An authz file compiled into a tree of path rules with precomputed
+   group memberships.  Once created, the tree is never modified, so it
+   may be used by several threads at once. */
+struct svn_authz_t
+{
+  /* The node for the repository root. */
+  authz_node_t *root;
 
-  /* The following are used exclusively in recursive lookups. */
+  /* Thread-safe cache mapping the keys constructed by authz_cache_key()
+     to the svn_boolean_t results of the respective access checks. */
+  svn_cache__t *cache;
+};
 
-  /* The path in the repository (an fspath) to authorize. */
-  const char *repos_path;
-  /* repos_path prefixed by the repository name and a colon. */
-  const char *qualified_repos_path;
+/* Information for the config enumerators called while compiling an
+   authz file. */
+struct authz_compile_baton {
+  /* The configuration file being compiled. */
+  svn_config_t *config;
 
-  /* Whether, at the end of a recursive lookup, access is granted. */
-  svn_boolean_t access;
-};
+  /* Map group and alias names, folded to lower case, to their
+     definitions. */
+  apr_hash_t *group_defs;
+  apr_hash_t *alias_defs;
 
-/* Information for the config enumeration functions called during the
-   validation process. */
-struct authz_validate_baton {
-  svn_config_t *config; /* The configuration file being validated. */
-  svn_error_t *err;     /* The error being thrown out of the
-                           enumerator, if any. */
+  /* Maps folded group names to the member sets of the groups that have
+     been expanded so far, see authz_rule_t. */
+  apr_hash_t *group_members;
+
+  /* The rules of the section being compiled. */
+  apr_array_header_t *rules;
+
+  /* The result and the pool it is being allocated in. */
+  svn_authz_t *authz;
+  apr_pool_t *pool;
+
+  /* Pool for temporary allocations. */
+  apr_pool_t *scratch_pool;
 };
 
-/* Currently this structure is just a wrapper around a
-   svn_config_t. */
-struct svn_authz_t
+
+
+/*** Compiling the authz file. ***/
+
+/* Return a copy of NAME, allocated in POOL, that has been folded to
+   lower case the same way svn_config_t folds option names. */
+static const char *
+authz_fold_name(const char *name,
+                apr_pool_t *pool)
 {
-  svn_config_t *cfg;
-};
+  char *folded = apr_pstrdup(pool, name);
+  char *p;
+
+  for (p = folded; *p; ++p)
+    *p = (char)apr_tolower(*p);
+
+  return folded;
+}
+
+/* Callback to add the option NAME with VALUE to the hash in BATON,
+   using the folded NAME as the key.  Implements the
+   svn_config_enumerator2_t interface. */
+static svn_boolean_t
+authz_collect_definition(const char *name, const char *value,
+                         void *baton, apr_pool_t *pool)
+{
+  apr_hash_t *defs = baton;
+  apr_pool_t *defs_pool = apr_hash_pool_get(defs);
+
+  apr_hash_set(defs, authz_fold_name(name, defs_pool), APR_HASH_KEY_STRING,
+               apr_pstrdup(defs_pool, value));
+
+  return TRUE;
+}
+
+/* Return the name of the user that ALIAS stands for, allocated in the
+   result pool of CB, or NULL if ALIAS is undefined. */
+static const char *
+authz_resolve_alias(struct authz_compile_baton *cb,
+                    const char *alias)
+{
+  const char *user = apr_hash_get(cb->alias_defs,
+                                  authz_fold_name(alias, cb->scratch_pool),
+                                  APR_HASH_KEY_STRING);
+
+  return user ? apr_pstrdup(cb->pool, user) : NULL;
+}
+
+/* Return the set of all users in GROUP, including those in its
+   subgroups, as described for authz_rule_t.  The definitions of the
+   groups must have been validated, i.e. be free of cycles. */
+static apr_hash_t *
+authz_get_group_members(struct authz_compile_baton *cb,
+                        const char *group)
+{
+  const char *key = authz_fold_name(group, cb->pool);
+  apr_hash_t *members = apr_hash_get(cb->group_members, key,
+                                     APR_HASH_KEY_STRING);
+  const char *value;
+
+  if (members)
+    return members;
+
+  members = apr_hash_make(cb->pool);
+  value = apr_hash_get(cb->group_defs, key, APR_HASH_KEY_STRING);
+  if (value)
+    {
+      apr_array_header_t *list = svn_cstring_split(value, ",", TRUE,
+                                                   cb->scratch_pool);
+      int i;
+
+      for (i = 0; i < list->nelts; i++)
+        {
+          const char *group_user = APR_ARRAY_IDX(list, i, char *);
+
+          /* Merge the members of subgroups. */
+          if (*group_user == '@')
+            {
+              apr_hash_t *subgroup
+                = authz_get_group_members(cb, &group_user[1]);
+              apr_hash_index_t *hi;
+
+              for (hi = apr_hash_first(cb->scratch_pool, subgroup);
+                   hi;
+                   hi = apr_hash_next(hi))
+                {
+                  const char *user = svn__apr_hash_index_key(hi);
+                  apr_hash_set(members, user, APR_HASH_KEY_STRING, user);
+                }
+            }
+
+          /* Resolve aliases. */
+          else if (*group_user == '&')
+            {
+              const char *user = authz_resolve_alias(cb, &group_user[1]);
+              if (user)
+                apr_hash_set(members, user, APR_HASH_KEY_STRING, user);
+            }
+
+          else
+            {
+              const char *user = apr_pstrdup(cb->pool, group_user);
+              apr_hash_set(members, user, APR_HASH_KEY_STRING, user);
+            }
+        }
+    }
+
+  apr_hash_set(cb->group_members, key, APR_HASH_KEY_STRING, members);
+  return members;
+}
+
+/* Callback to compile one line of an authz section and append it to
+   the rules in the authz_compile_baton BATON.  Implements the
+   svn_config_enumerator2_t interface. */
+static svn_boolean_t
+authz_compile_rule(const char *rule_match_string, const char *value,
+                   void *baton, apr_pool_t *pool)
+{
+  struct authz_compile_baton *cb = baton;
+  authz_rule_t *rule = apr_array_push(cb->rules);
+  const char *match = rule_match_string;
+
+  rule->inverted = (match[0] == '~');
+  if (rule->inverted)
+    match++;
+
+  rule->user = NULL;
+  rule->members = NULL;
+  if (strcmp(match, "$anonymous") == 0)
+    rule->kind = authz_rule_anonymous;
+  else if (strcmp(match, "$authenticated") == 0)
+    rule->kind = authz_rule_authenticated;
+  else if (strcmp(match, "*") == 0)
+    rule->kind = authz_rule_everyone;
+  else if (match[0] == '@')
+    {
+      rule->kind = authz_rule_group;
+      rule->members = authz_get_group_members(cb, &match[1]);
+    }
+  else if (match[0] == '&')
+    {
+      rule->kind = authz_rule_alias;
+      rule->user = authz_resolve_alias(cb, &match[1]);
+    }
+  else
+    {
+      rule->kind = authz_rule_user;
+      rule->user = apr_pstrdup(cb->pool, match);
+    }
+
+  /* Set the access grants for the rule. */
+  rule->allow = svn_authz_none;
+  rule->deny = svn_authz_none;
+
+  if (strchr(value, 'r'))
+    rule->allow |= svn_authz_read;
+  else
+    rule->deny |= svn_authz_read;
+
+  if (strchr(value, 'w'))
+    rule->allow |= svn_authz_write;
+  else
+    rule->deny |= svn_authz_write;
+
+  return TRUE;
+}
+
+/* Return the node for the canonical FSPATH in the tree starting at
+   ROOT, creating it and its parents in POOL as necessary. */
+static authz_node_t *
+authz_ensure_node(authz_node_t *root,
+                  const char *fspath,
+                  apr_pool_t *pool)
+{
+  authz_node_t *node = root;
+  const char *segment = fspath + 1;
+
+  while (*segment)
+    {
+      apr_size_t len = strcspn(segment, "/");
+      authz_node_t *child = NULL;
+
+      if (node->children)
+        child = apr_hash_get(node->children, segment, len);
+      else
+        node->children = apr_hash_make(pool);
+
+      if (!child)
+        {
+          child = apr_pcalloc(pool, sizeof(*child));
+          apr_hash_set(node->children, apr_pstrmemdup(pool, segment, len),
+                       len, child);
+        }
+
+      node = child;
+      segment += len;
+      if (*segment == '/')
+        segment++;
+    }
+
+  return node;
+}
+
+/* Callback to compile the rules of the section SECTION_NAME into the
+   tree of the authz_compile_baton BATON.  Sections that don't describe
+   a path, such as "groups", are skipped.  Implements the
+   svn_config_section_enumerator2_t interface. */
+static svn_boolean_t
+authz_compile_section(const char *section_name, void *baton,
+                      apr_pool_t *pool)
+{
+  struct authz_compile_baton *cb = baton;
+  const char *repos_name = NULL;
+  const char *fspath = section_name;
+  authz_node_t *node;
+
+  if (fspath[0] != '/')
+    {
+      const char *colon = strchr(section_name, ':');
+
+      if (!colon || colon[1] != '/')
+        return TRUE;
+
+      repos_name = apr_pstrmemdup(cb->pool, section_name,
+                                  colon - section_name);
+      fspath = colon + 1;
+    }
+
+  node = authz_ensure_node(cb->authz->root, fspath, cb->pool);
+  cb->rules = apr_array_make(cb->pool, 4, sizeof(authz_rule_t));
+  if (repos_name)
+    {
+      if (!node->repos_rules)
+        node->repos_rules = apr_hash_make(cb->pool);
+      apr_hash_set(node->repos_rules, repos_name, APR_HASH_KEY_STRING,
+                   cb->rules);
+    }
+  else
+    node->rules = cb->rules;
+
+  svn_config_enumerate2(cb->config, section_name, authz_compile_rule,
+                        cb, pool);
+
+  return TRUE;
+}
+
+/* Pool cleanup handler destroying the pool DATA. */
+static apr_status_t
+authz_destroy_pool(void *data)
+{
+  svn_pool_destroy(data);
+  return APR_SUCCESS;
+}
+
+/* Implements svn_cache__serialize_func_t for svn_boolean_t. */
+static svn_error_t *
+authz_serialize_boolean(void **data,
+                        apr_size_t *data_len,
+                        void *in,
+                        apr_pool_t *pool)
+{
+  *data = apr_pmemdup(pool, in, sizeof(svn_boolean_t));
+  *data_len = sizeof(svn_boolean_t);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_cache__deserialize_func_t for svn_boolean_t. */
+static svn_error_t *
+authz_deserialize_boolean(void **out,
+                          void *data,
+                          apr_size_t data_len,
+                          apr_pool_t *pool)
+{
+  *out = apr_pmemdup(pool, data, sizeof(svn_boolean_t));
+
+  return SVN_NO_ERROR;
+}
+
+/* Compile the validated authz configuration CFG into *AUTHZ_P,
+   allocated in RESULT_POOL.  Use SCRATCH_POOL for temporary
+   allocations. */
+static svn_error_t *
+authz_compile(svn_authz_t **authz_p,
+              svn_config_t *cfg,
+              apr_pool_t *result_pool,
+              apr_pool_t *scratch_pool)
+{
+  struct authz_compile_baton cb = { 0 };
+  apr_pool_t *cache_pool;
+
+  cb.config = cfg;
+  cb.group_defs = apr_hash_make(scratch_pool);
+  cb.alias_defs = apr_hash_make(scratch_pool);
+  cb.group_members = apr_hash_make(scratch_pool);
+  cb.authz = apr_palloc(result_pool, sizeof(*cb.authz));
+  cb.authz->root = apr_pcalloc(result_pool, sizeof(*cb.authz->root));
+  cb.pool = result_pool;
+  cb.scratch_pool = scratch_pool;
+
+  svn_config_enumerate2(cfg, "groups", authz_collect_definition,
+                        cb.group_defs, scratch_pool);
+  svn_config_enumerate2(cfg, "aliases", authz_collect_definition,
+                        cb.alias_defs, scratch_pool);
+  svn_config_enumerate_sections2(cfg, authz_compile_section, &cb,
+                                 scratch_pool);
+
+  /* The cache gets populated concurrently by all users of the authz
+     file, so give it a root pool of its own. */
+  cache_pool = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+  apr_pool_cleanup_register(result_pool, cache_pool, authz_destroy_pool,
+                            apr_pool_cleanup_null);
+  SVN_ERR(svn_cache__create_inprocess(&cb.authz->cache,
+                                      authz_serialize_boolean,
+                                      authz_deserialize_boolean,
+                                      APR_HASH_KEY_STRING,
+                                      AUTHZ_CACHE_PAGES,
+                                      AUTHZ_CACHE_ITEMS_PER_PAGE,
+                                      TRUE, "authz", cache_pool));
+
+  *authz_p = cb.authz;
+  return SVN_NO_ERROR;
+}
 
 
 
@@ -128,347 +523,304 @@ authz_access_is_determined(svn_repos_authz_access_t allow,
     return FALSE;
 }
 
-/* Return TRUE is USER equals ALIAS. The alias definitions are in the
-   "aliases" sections of CFG. Use POOL for temporary allocations during
-   the lookup. */
+/* Determines whether the authz RULE applies to USER, which is NULL for
+ * anonymous access.
+ */
 static svn_boolean_t
-authz_alias_is_user(svn_config_t *cfg,
-                    const char *alias,
-                    const char *user,
-                    apr_pool_t *pool)
+authz_rule_applies_to_user(const authz_rule_t *rule,
+                           const char *user)
 {
-  const char *value;
-
-  svn_config_get(cfg, &value, "aliases", alias, NULL);
-  if (!value)
-    return FALSE;
+  svn_boolean_t applies;
 
-  if (strcmp(value, user) == 0)
-    return TRUE;
+  switch (rule->kind)
+    {
+      case authz_rule_everyone:
+        applies = TRUE;
+        break;
+
+      case authz_rule_anonymous:
+        applies = (user == NULL);
+        break;
+
+      case authz_rule_authenticated:
+        applies = (user != NULL);
+        break;
+
+      case authz_rule_group:
+        applies = (user != NULL
+                   && apr_hash_get(rule->members, user,
+                                   APR_HASH_KEY_STRING) != NULL);
+        break;
+
+      default:
+        applies = (user != NULL && rule->user != NULL
+                   && strcmp(user, rule->user) == 0);
+        break;
+    }
 
-  return FALSE;
+  return rule->inverted ? !applies : applies;
 }
 
-
-/* Return TRUE if USER is in GROUP.  The group definitions are in the
-   "groups" section of CFG.  Use POOL for temporary allocations during
-   the lookup. */
-static svn_boolean_t
-authz_group_contains_user(svn_config_t *cfg,
-                          const char *group,
-                          const char *user,
-                          apr_pool_t *pool)
+/* Add the access that the RULES of a section explicitly grant to USER
+ * to *ALLOW and the access that they deny to *DENY.  RULES may be NULL.
+ */
+static void
+authz_rules_get_access(svn_repos_authz_access_t *allow,
+                       svn_repos_authz_access_t *deny,
+                       const apr_array_header_t *rules,
+                       const char *user)
 {
-  const char *value;
-  apr_array_header_t *list;
   int i;
 
-  svn_config_get(cfg, &value, "groups", group, NULL);
+  if (!rules)
+    return;
 
-  list = svn_cstring_split(value, ",", TRUE, pool);
-
-  for (i = 0; i < list->nelts; i++)
+  for (i = 0; i < rules->nelts; i++)
     {
-      const char *group_user = APR_ARRAY_IDX(list, i, char *);
+      const authz_rule_t *rule = &APR_ARRAY_IDX(rules, i, authz_rule_t);
 
-      /* If the 'user' is a subgroup, recurse into it. */
-      if (*group_user == '@')
-        {
-          if (authz_group_contains_user(cfg, &group_user[1],
-                                        user, pool))
-            return TRUE;
-        }
-
-      /* If the 'user' is an alias, verify it. */
-      else if (*group_user == '&')
+      if (authz_rule_applies_to_user(rule, user))
         {
-          if (authz_alias_is_user(cfg, &group_user[1],
-                                  user, pool))
-            return TRUE;
+          *allow |= rule->allow;
+          *deny |= rule->deny;
         }
-
-      /* If the user matches, stop. */
-      else if (strcmp(user, group_user) == 0)
-        return TRUE;
     }
-
-  return FALSE;
 }
 
-
-/* Determines whether an authz rule applies to the current
- * user, given the name part of the rule's name-value pair
- * in RULE_MATCH_STRING and the authz_lookup_baton object
- * B with the username in question.
+/* Return the rules of the section for REPOS_NAME and the path of NODE,
+ * or NULL if there is no such section.
  */
-static svn_boolean_t
-authz_line_applies_to_user(const char *rule_match_string,
-                           struct authz_lookup_baton *b,
-                           apr_pool_t *pool)
-{
-  /* If the rule has an inversion, recurse and invert the result. */
-  if (rule_match_string[0] == '~')
-    return !authz_line_applies_to_user(&rule_match_string[1], b, pool);
-
-  /* Check for special tokens. */
-  if (strcmp(rule_match_string, "$anonymous") == 0)
-    return (b->user == NULL);
-  if (strcmp(rule_match_string, "$authenticated") == 0)
-    return (b->user != NULL);
-
-  /* Check for a wildcard rule. */
-  if (strcmp(rule_match_string, "*") == 0)
-    return TRUE;
-
-  /* If we get here, then the rule is:
-   *  - Not an inversion rule.
-   *  - Not an authz token rule.
-   *  - Not a wildcard rule.
-   *
-   * All that's left over is regular user or group specifications.
-   */
-
-  /* If the session is anonymous, then a user/group
-   * rule definitely won't match.
-   */
-  if (b->user == NULL)
-    return FALSE;
+static const apr_array_header_t *
+authz_get_repos_rules(const authz_node_t *node,
+                      const char *repos_name)
+{
+  if (!node->repos_rules)
+    return NULL;
 
-  /* Process the rule depending on whether it is
-   * a user, alias or group rule.
-   */
-  if (rule_match_string[0] == '@')
-    return authz_group_contains_user(
-      b->config, &rule_match_string[1], b->user, pool);
-  else if (rule_match_string[0] == '&')
-    return authz_alias_is_user(
-      b->config, &rule_match_string[1], b->user, pool);
-  else
-    return (strcmp(b->user, rule_match_string) == 0);
+  return apr_hash_get(node->repos_rules, repos_name, APR_HASH_KEY_STRING);
 }
 
 
-/* Callback to parse one line of an authz file and update the
- * authz_baton accordingly.
+/* Validate access to the given user for the path of NODE.  This
+ * function checks rules for exactly that path, and first tries
+ * the section specific to the given repository before falling
+ * back to pan-repository rules.
+ *
+ * Update *access_granted to inform the caller of the outcome of the
+ * lookup.  Return a boolean indicating whether the access rights were
+ * successfully determined.
  */
 static svn_boolean_t
-authz_parse_line(const char *name, const char *value,
-                 void *baton, apr_pool_t *pool)
+authz_get_path_access(const authz_node_t *node, const char *repos_name,
+                      const char *user,
+                      svn_repos_authz_access_t required_access,
+                      svn_boolean_t *access_granted)
 {
-  struct authz_lookup_baton *b = baton;
+  svn_repos_authz_access_t allow = svn_authz_none;
+  svn_repos_authz_access_t deny = svn_authz_none;
 
-  /* Stop if the rule doesn't apply to this user. */
-  if (!authz_line_applies_to_user(name, b, pool))
-    return TRUE;
+  /* Try the repository-specific section first. */
+  authz_rules_get_access(&allow, &deny,
+                         authz_get_repos_rules(node, repos_name), user);
 
-  /* Set the access grants for the rule. */
-  if (strchr(value, 'r'))
-    b->allow |= svn_authz_read;
-  else
-    b->deny |= svn_authz_read;
+  *access_granted = authz_access_is_granted(allow, deny, required_access);
 
-  if (strchr(value, 'w'))
-    b->allow |= svn_authz_write;
-  else
-    b->deny |= svn_authz_write;
+  /* If the first test has determined access, stop now. */
+  if (authz_access_is_determined(allow, deny, required_access))
+    return TRUE;
 
-  return TRUE;
+  /* No repository specific rule, try pan-repository rules. */
+  authz_rules_get_access(&allow, &deny, node->rules, user);
+
+  *access_granted = authz_access_is_granted(allow, deny, required_access);
+  return authz_access_is_determined(allow, deny, required_access);
 }
 
 
-/* Return TRUE iff the access rules in SECTION_NAME apply to PATH_SPEC
- * (which is a repository name, colon, and repository fspath, such as
- * "myrepos:/trunk/foo").
+/* Return TRUE unless the section RULES conclusively deny USER the
+ * REQUIRED_ACCESS.
  */
 static svn_boolean_t
-is_applicable_section(const char *path_spec,
-                      const char *section_name)
+authz_section_permits(const apr_array_header_t *rules,
+                      const char *user,
+                      svn_repos_authz_access_t required_access)
 {
-  apr_size_t path_spec_len = strlen(path_spec);
+  svn_repos_authz_access_t allow = svn_authz_none;
+  svn_repos_authz_access_t deny = svn_authz_none;
+
+  authz_rules_get_access(&allow, &deny, rules, user);
 
-  return ((strncmp(path_spec, section_name, path_spec_len) == 0)
-          && (path_spec[path_spec_len - 1] == '/'
-              || section_name[path_spec_len] == '/'
-              || section_name[path_spec_len] == '\0'));
+  return authz_access_is_granted(allow, deny, required_access)
+      || !authz_access_is_determined(allow, deny, required_access);
 }
 
 
-/* Callback to parse a section and update the authz_baton if the
- * section denies access to the subtree the baton describes.
+/* Validate access to the given user for the subtree starting at the
+ * path of NODE.  This function walks the subtree in search of rules
+ * which deny the requested access.
+ *
+ * As soon as one is found, or else when the whole subtree has been
+ * searched, return the updated authorization status.  Use POOL for
+ * temporary allocations.
  */
 static svn_boolean_t
-authz_parse_section(const char *section_name, void *baton, apr_pool_t *pool)
+authz_get_tree_access(const authz_node_t *node, const char *repos_name,
+                      const char *user,
+                      svn_repos_authz_access_t required_access,
+                      apr_pool_t *pool)
 {
-  struct authz_lookup_baton *b = baton;
-  svn_boolean_t conclusive;
+  apr_hash_index_t *hi;
 
-  /* Does the section apply to us? */
-  if (is_applicable_section(b->qualified_repos_path,
-                            section_name) == FALSE
-      && is_applicable_section(b->repos_path,
-                               section_name) == FALSE)
-    return TRUE;
-
-  /* Work out what this section grants. */
-  b->allow = b->deny = 0;
-  svn_config_enumerate2(b->config, section_name,
-                        authz_parse_line, b, pool);
+  if (!authz_section_permits(authz_get_repos_rules(node, repos_name),
+                             user, required_access)
+      || !authz_section_permits(node->rules, user, required_access))
+    return FALSE;
 
-  /* Has the section explicitly determined an access? */
-  conclusive = authz_access_is_determined(b->allow, b->deny,
-                                          b->required_access);
+  if (!node->children)
+    return TRUE;
 
-  /* Is access granted OR inconclusive? */
-  b->access = authz_access_is_granted(b->allow, b->deny,
-                                      b->required_access)
-    || !conclusive;
+  for (hi = apr_hash_first(pool, node->children); hi; hi = apr_hash_next(hi))
+    if (!authz_get_tree_access(svn__apr_hash_index_val(hi), repos_name,
+                               user, required_access, pool))
+      return FALSE;
 
-  /* As long as access isn't conclusively denied, carry on. */
-  return b->access;
+  return TRUE;
 }
 
 
-/* Validate access to the given user for the given path.  This
- * function checks rules for exactly the given path, and first tries
- * to access a section specific to the given repository before falling
- * back to pan-repository rules.
- *
- * Update *access_granted to inform the caller of the outcome of the
- * lookup.  Return a boolean indicating whether the access rights were
- * successfully determined.
+/* Return TRUE if the section RULES conclusively grant USER the
+ * REQUIRED_ACCESS.
  */
 static svn_boolean_t
-authz_get_path_access(svn_config_t *cfg, const char *repos_name,
-                      const char *path, const char *user,
-                      svn_repos_authz_access_t required_access,
-                      svn_boolean_t *access_granted,
-                      apr_pool_t *pool)
+authz_section_grants(const apr_array_header_t *rules,
+                     const char *user,
+                     svn_repos_authz_access_t required_access)
 {
-  const char *qualified_path;
-  struct authz_lookup_baton baton = { 0 };
-
-  baton.config = cfg;
-  baton.user = user;
+  svn_repos_authz_access_t allow = svn_authz_none;
+  svn_repos_authz_access_t deny = svn_authz_none;
 
-  /* Try to locate a repository-specific block first. */
-  qualified_path = apr_pstrcat(pool, repos_name, ":", path, (char *)NULL);
-  svn_config_enumerate2(cfg, qualified_path,
-                        authz_parse_line, &baton, pool);
+  authz_rules_get_access(&allow, &deny, rules, user);
 
-  *access_granted = authz_access_is_granted(baton.allow, baton.deny,
-                                            required_access);
-
-  /* If the first test has determined access, stop now. */
-  if (authz_access_is_determined(baton.allow, baton.deny,
-                                 required_access))
-    return TRUE;
-
-  /* No repository specific rule, try pan-repository rules. */
-  svn_config_enumerate2(cfg, path, authz_parse_line, &baton, pool);
-
-  *access_granted = authz_access_is_granted(baton.allow, baton.deny,
-                                            required_access);
-  return authz_access_is_determined(baton.allow, baton.deny,
-                                    required_access);
+  return authz_access_is_granted(allow, deny, required_access)
+      && authz_access_is_determined(allow, deny, required_access);
 }
 
 
-/* Validate access to the given user for the subtree starting at the
- * given path.  This function walks the whole authz file in search of
- * rules applying to paths in the requested subtree which deny the
- * requested access.
+/* Walk through the authz tree below NODE to check if USER has the
+ * REQUIRED_ACCESS to any path within the repository REPOS_NAME.
+ * Return TRUE if so.  Use POOL for temporary allocations.
  *
- * As soon as one is found, or else when the whole ACL file has been
- * searched, return the updated authorization status.
+ * We could have checked the section for the root path only.  However,
+ * this requires access for root explicitly (which the user may not
+ * always have).  So we end up looking at all sections and stop on the
+ * first one granting some access to this user.
  */
 static svn_boolean_t
-authz_get_tree_access(svn_config_t *cfg, const char *repos_name,
-                      const char *path, const char *user,
-                      svn_repos_authz_access_t required_access,
-                      apr_pool_t *pool)
+authz_get_any_access(const authz_node_t *node, const char *repos_name,
+                     const char *user,
+                     svn_repos_authz_access_t required_access,
+                     apr_pool_t *pool)
 {
-  struct authz_lookup_baton baton = { 0 };
+  apr_hash_index_t *hi;
 
-  baton.config = cfg;
-  baton.user = user;
-  baton.required_access = required_access;
-  baton.repos_path = path;
-  baton.qualified_repos_path = apr_pstrcat(pool, repos_name,
-                                           ":", path, (char *)NULL);
-  /* Default to access granted if no rules say otherwise. */
-  baton.access = TRUE;
+  if (authz_section_grants(authz_get_repos_rules(node, repos_name),
+                           user, required_access)
+      || authz_section_grants(node->rules, user, required_access))
+    return TRUE;
 
-  svn_config_enumerate_sections2(cfg, authz_parse_section,
-                                 &baton, pool);
+  if (!node->children)
+    return FALSE;
+
+  for (hi = apr_hash_first(pool, node->children); hi; hi = apr_hash_next(hi))
+    if (authz_get_any_access(svn__apr_hash_index_val(hi), repos_name,
+                             user, required_access, pool))
+      return TRUE;
 
-  return baton.access;
+  return FALSE;
 }
 
 
-/* Callback to parse sections of the configuration file, looking for
-   any kind of granted access.  Implements the
-   svn_config_section_enumerator2_t interface. */
+/* Return whether USER has the REQUIRED_ACCESS to the path whose node,
+ * if there is one, is PATH_NODE.  NODES are the nodes of that path and
+ * its parents, as far as they exist, starting at the root.  Use POOL for
+ * temporary allocations.
+ */
 static svn_boolean_t
-authz_get_any_access_parser_cb(const char *section_name, void *baton,
-                               apr_pool_t *pool)
+authz_get_access(const apr_array_header_t *nodes,
+                 const authz_node_t *path_node,
+                 const char *repos_name,
+                 const char *user,
+                 svn_repos_authz_access_t required_access,
+                 apr_pool_t *pool)
 {
-  struct authz_lookup_baton *b = baton;
+  svn_boolean_t access_granted = FALSE;
+  int i;
 
-  /* Does the section apply to the query? */
-  if (section_name[0] == '/'
-      || strncmp(section_name, b->qualified_repos_path,
-                 strlen(b->qualified_repos_path)) == 0)
-    {
-      b->allow = b->deny = svn_authz_none;
+  /* Determine the granted access for the requested path, working back
+     towards the repository root. */
+  for (i = nodes->nelts - 1; i >= 0; i--)
+    if (authz_get_path_access(APR_ARRAY_IDX(nodes, i, const authz_node_t *),
+                              repos_name, user, required_access,
+                              &access_granted))
+      break;
 
-      svn_config_enumerate2(b->config, section_name,
-                            authz_parse_line, baton, pool);
-      b->access = authz_access_is_granted(b->allow, b->deny,
-                                          b->required_access);
+  /* Deny access by default. */
+  if (i < 0)
+    return FALSE;
 
-      /* Continue as long as we don't find a determined, granted access. */
-      return !(b->access
-               && authz_access_is_determined(b->allow, b->deny,
-                                             b->required_access));
-    }
+  /* If the caller requested recursive access, we need to walk through
+     the subtree of the path to see whether any child paths are denied
+     to the requested user. */
+  if (access_granted && (required_access & svn_authz_recursive)
+      && path_node)
+    access_granted = authz_get_tree_access(path_node, repos_name, user,
+                                           required_access, pool);
 
-  return TRUE;
+  return access_granted;
 }
 
 
-/* Walk through the authz CFG to check if USER has the REQUIRED_ACCESS
- * to any path within the REPOSITORY.  Return TRUE if so.  Use POOL
- * for temporary allocations. */
-static svn_boolean_t
-authz_get_any_access(svn_config_t *cfg, const char *repos_name,
-                     const char *user,
-                     svn_repos_authz_access_t required_access,
-                     apr_pool_t *pool)
+/* Return the key under which the result of checking whether USER has
+ * the REQUIRED_ACCESS to PATH in REPOS_NAME gets cached.  KIND tells
+ * 'p'ath lookups from lookups of any path 'b'elow PATH and lookups of
+ * 'a'ny path in the repository.  Allocate the key in POOL.
+ */
+static const char *
+authz_cache_key(svn_repos_authz_access_t required_access,
+                const char *user,
+                const char *repos_name,
+                const char *path,
+                char kind,
+                apr_pool_t *pool)
 {
-  struct authz_lookup_baton baton = { 0 };
+  /* Prefix the names with their lengths to keep the key unambiguous. */
+  return apr_psprintf(pool, "%c%d %c%" APR_SIZE_T_FMT ":%s%"
+                      APR_SIZE_T_FMT ":%s%s",
+                      kind, (int)required_access,
+                      user ? 'u' : 'a', user ? strlen(user) : 0,
+                      user ? user : "", strlen(repos_name), repos_name,
+                      path);
+}
 
-  baton.config = cfg;
-  baton.user = user;
-  baton.required_access = required_access;
-  baton.access = FALSE; /* Deny access by default. */
-  baton.repos_path = "/";
-  baton.qualified_repos_path = apr_pstrcat(pool, repos_name,
-                                           ":/", (char *)NULL);
-
-  /* We could have used svn_config_enumerate2 for "repos_name:/".
-   * However, this requires access for root explicitly (which the user
-   * may not always have). So we end up enumerating the sections in
-   * the authz CFG and stop on the first match with some access for
-   * this user. */
-  svn_config_enumerate_sections2(cfg, authz_get_any_access_parser_cb,
-                                 &baton, pool);
-
-  /* If walking the configuration was inconclusive, deny access. */
-  if (!authz_access_is_determined(baton.allow,
-                                  baton.deny, baton.required_access))
-    return FALSE;
 
-  return baton.access;
+/* Set *FOUND to whether the result of the access check identified by
+ * KEY is in the cache of AUTHZ and if so, set *ACCESS_GRANTED to it.
+ * Use POOL for temporary allocations.
+ */
+static svn_error_t *
+authz_cache_get(svn_boolean_t *found,
+                svn_boolean_t *access_granted,
+                svn_authz_t *authz,
+                const char *key,
+                apr_pool_t *pool)
+{
+  svn_boolean_t *cached;
+
+  SVN_ERR(svn_cache__get((void **)&cached, found, authz->cache, key, pool));
+  if (*found)
+    *access_granted = *cached;
+
+  return SVN_NO_ERROR;
 }
 
 
@@ -750,6 +1102,128 @@ static svn_boolean_t authz_validate_section(const char *name,
 }
 
 
+
+/*** Sharing compiled authz files. ***/
+
+/* A compiled authz file in the registry of shared authz files. */
+typedef struct shared_authz_t
+{
+  /* The compiled authz file and the root pool that it lives in. */
+  svn_authz_t *authz;
+  apr_pool_t *pool;
+
+  /* Modification time and size of the file when it was read. */
+  apr_time_t mtime;
+  apr_off_t size;
+
+  /* Whether the file had been modified less than MTIME_GRANULARITY
+     before it was read.  Further modifications may then leave MTIME and
+     SIZE unchanged, so such entries don't get handed out again. */
+  svn_boolean_t racy;
+
+  /* The number of pools that AUTHZ has been handed out to and that have
+     not been cleared yet. */
+  int refcount;
+
+  /* Whether a newer version of the file has replaced this entry in the
+     registry.  POOL gets destroyed once that is the case and the last
+     reference is gone. */
+  svn_boolean_t stale;
+} shared_authz_t;
+
+/* The coarsest resolution of file modification times that we expect
+   from the filesystems that authz files live on. */
+#define MTIME_GRANULARITY apr_time_from_sec(2)
+
+/* The registry of shared authz files, mapping absolute file names to
+   shared_authz_t.  It lives in REGISTRY_POOL and all access to it and
+   its entries is serialized by REGISTRY_MUTEX. */
+static volatile svn_atomic_t registry_init_state = 0;
+static apr_pool_t *registry_pool = NULL;
+static svn_mutex__t *registry_mutex = NULL;
+static apr_hash_t *registry = NULL;
+
+/* Create the registry of shared authz files.  Implements the init_func
+   interface of svn_atomic__init_once(). */
+static svn_error_t *
+init_registry(void *baton, apr_pool_t *pool)
+{
+  registry_pool = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+  SVN_ERR(svn_mutex__init(&registry_mutex, TRUE, registry_pool));
+  registry = apr_hash_make(registry_pool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *ENTRY_P to the registry entry for FILE if that is still up to
+   date according to FINFO, and take a reference to it.  Otherwise, set
+   *ENTRY_P to NULL.  The caller must hold REGISTRY_MUTEX. */
+static svn_error_t *
+find_shared_authz(shared_authz_t **entry_p,
+                  const char *file,
+                  const apr_finfo_t *finfo)
+{
+  shared_authz_t *entry = apr_hash_get(registry, file, APR_HASH_KEY_STRING);
+
+  if (   entry && !entry->racy
+      && entry->mtime == finfo->mtime && entry->size == finfo->size)
+    entry->refcount++;
+  else
+    entry = NULL;
+
+  *entry_p = entry;
+  return SVN_NO_ERROR;
+}
+
+/* Make ENTRY the registry entry for FILE and take a reference to it.
+   The caller must hold REGISTRY_MUTEX. */
+static svn_error_t *
+add_shared_authz(const char *file,
+                 shared_authz_t *entry)
+{
+  shared_authz_t *old_entry = apr_hash_get(registry, file,
+                                           APR_HASH_KEY_STRING);
+
+  if (old_entry)
+    {
+      old_entry->stale = TRUE;
+      if (old_entry->refcount == 0)
+        svn_pool_destroy(old_entry->pool);
+    }
+  else
+    file = apr_pstrdup(registry_pool, file);
+
+  entry->refcount++;
+  apr_hash_set(registry, file, APR_HASH_KEY_STRING, entry);
+
+  return SVN_NO_ERROR;
+}
+
+/* Release a reference to ENTRY.  The caller must hold REGISTRY_MUTEX. */
+static svn_error_t *
+release_shared_authz(shared_authz_t *entry)
+{
+  if (--entry->refcount == 0 && entry->stale)
+    svn_pool_destroy(entry->pool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Pool cleanup handler releasing the shared_authz_t DATA. */
+static apr_status_t
+shared_authz_cleanup(void *data)
+{
+  svn_error_t *err;
+
+  err = svn_mutex__lock(registry_mutex);
+  if (!err)
+    err = svn_mutex__unlock(registry_mutex, release_shared_authz(data));
+
+  svn_error_clear(err);
+  return APR_SUCCESS;
+}
+
+
 
 /*** Public functions. ***/
 
@@ -757,77 +1231,182 @@ svn_error_t *
 svn_repos_authz_read(svn_authz_t **authz_p, const char *file,
                      svn_boolean_t must_exist, apr_pool_t *pool)
 {
-  svn_authz_t *authz = apr_palloc(pool, sizeof(*authz));
+  apr_pool_t *scratch_pool = svn_pool_create(pool);
+  svn_config_t *cfg;
   struct authz_validate_baton baton = { 0 };
 
   baton.err = SVN_NO_ERROR;
 
   /* Load the rule file. */
-  SVN_ERR(svn_config_read2(&authz->cfg, file, must_exist, TRUE, pool));
-  baton.config = authz->cfg;
+  SVN_ERR(svn_config_read2(&cfg, file, must_exist, TRUE, scratch_pool));
+  baton.config = cfg;
 
   /* Step through the entire rule file, stopping on error. */
-  svn_config_enumerate_sections2(authz->cfg, authz_validate_section,
-                                 &baton, pool);
+  svn_config_enumerate_sections2(cfg, authz_validate_section,
+                                 &baton, scratch_pool);
   SVN_ERR(baton.err);
 
-  *authz_p = authz;
+  /* Turn it into a form that is fast to evaluate.  We don't need the
+     configuration itself anymore after that. */
+  SVN_ERR(authz_compile(authz_p, cfg, pool, scratch_pool));
+  svn_pool_destroy(scratch_pool);
+
   return SVN_NO_ERROR;
 }
 
 
 svn_error_t *
-svn_repos_authz_check_access(svn_authz_t *authz, const char *repos_name,
-                             const char *path, const char *user,
-                             svn_repos_authz_access_t required_access,
-                             svn_boolean_t *access_granted,
-                             apr_pool_t *pool)
+svn_repos__authz_read_shared(svn_authz_t **authz_p,
+                             const char *file,
+                             svn_boolean_t must_exist,
+                             apr_pool_t *result_pool,
+                             apr_pool_t *scratch_pool)
+{
+  apr_finfo_t finfo;
+  apr_time_t now = apr_time_now();
+  shared_authz_t *entry;
+  svn_error_t *err;
+
+  SVN_ERR(svn_atomic__init_once(&registry_init_state, init_registry,
+                                NULL, scratch_pool));
+
+  /* Leave missing files and registry paths to svn_repos_authz_read(). */
+  err = svn_io_stat(&finfo, file, APR_FINFO_MTIME | APR_FINFO_SIZE,
+                    scratch_pool);
+  if (err)
+    {
+      svn_error_clear(err);
+      return svn_error_trace(svn_repos_authz_read(authz_p, file, must_exist,
+                                                  result_pool));
+    }
+
+  SVN_ERR(svn_dirent_get_absolute(&file, file, scratch_pool));
+  SVN_MUTEX__WITH_LOCK(registry_mutex,
+                       find_shared_authz(&entry, file, &finfo));
+
+  if (!entry)
+    {
+      /* Compile the file outside the lock.  Should another thread do the
+         same concurrently, the entry added last wins. */
+      apr_pool_t *pool
+        = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+
+      entry = apr_pcalloc(pool, sizeof(*entry));
+      entry->pool = pool;
+      entry->mtime = finfo.mtime;
+      entry->size = finfo.size;
+      entry->racy = (now - finfo.mtime < MTIME_GRANULARITY);
+
+      err = svn_repos_authz_read(&entry->authz, file, must_exist, pool);
+      if (err)
+        {
+          svn_pool_destroy(pool);
+          return svn_error_trace(err);
+        }
+
+      SVN_MUTEX__WITH_LOCK(registry_mutex, add_shared_authz(file, entry));
+    }
+
+  apr_pool_cleanup_register(result_pool, entry, shared_authz_cleanup,
+                            apr_pool_cleanup_null);
+
+  *authz_p = entry->authz;
+  return SVN_NO_ERROR;
+}
+
+
+svn_error_t *
+svn_repos__authz_check_access(svn_authz_t *authz, const char *repos_name,
+                              const char *path, const char *user,
+                              svn_repos_authz_access_t required_access,
+                              svn_boolean_t *access_granted,
+                              svn_repos__authz_counters_t *counters,
+                              apr_pool_t *pool)
 {
-  const char *current_path;
+  const authz_node_t *node;
+  const authz_node_t *path_node;
+  apr_array_header_t *nodes = NULL;
+  const char *segment;
+  const char *key;
+  svn_boolean_t found;
 
   if (!repos_name)
     repos_name = "";
 
+  if (counters)
+    counters->checks++;
+
   /* If PATH is NULL, check if the user has *any* access. */
   if (!path)
     {
-      *access_granted = authz_get_any_access(authz->cfg, repos_name,
+      key = authz_cache_key(required_access, user, repos_name, "", 'a',
+                            pool);
+      SVN_ERR(authz_cache_get(&found, access_granted, authz, key, pool));
+      if (found)
+        return SVN_NO_ERROR;
+
+      *access_granted = authz_get_any_access(authz->root, repos_name,
                                              user, required_access, pool);
-      return SVN_NO_ERROR;
     }
+  else
+    {
+      /* Sanity check. */
+      SVN_ERR_ASSERT(path[0] == '/');
 
-  /* Sanity check. */
-  SVN_ERR_ASSERT(path[0] == '/');
-
-  /* Determine the granted access for the requested path. */
-  path = svn_fspath__canonicalize(path, pool);
-  current_path = path;
+      /* Find the nodes for PATH and those of its parents that have
+         rules. */
+      path = svn_fspath__canonicalize(path, pool);
+      nodes = apr_array_make(pool, 8, sizeof(const authz_node_t *));
+      node = authz->root;
+      segment = path + 1;
 
-  while (!authz_get_path_access(authz->cfg, repos_name,
-                                current_path, user,
-                                required_access,
-                                access_granted,
-                                pool))
-    {
-      /* Stop if the loop hits the repository root with no
-         results. */
-      if (current_path[0] == '/' && current_path[1] == '\0')
+      APR_ARRAY_PUSH(nodes, const authz_node_t *) = node;
+      while (*segment && node->children)
         {
-          /* Deny access by default. */
-          *access_granted = FALSE;
-          return SVN_NO_ERROR;
-        }
+          apr_size_t len = strcspn(segment, "/");
 
-      /* Work back to the parent path. */
-      current_path = svn_fspath__dirname(current_path, pool);
+          node = apr_hash_get(node->children, segment, len);
+          if (!node)
+            break;
+
+          APR_ARRAY_PUSH(nodes, const authz_node_t *) = node;
+          segment += len;
+          if (*segment == '/')
+            segment++;
+        }
+      path_node = *segment ? NULL : node;
+
+      /* All paths below the last node found share the same result, so
+         they share the cache entry, too. */
+      key = authz_cache_key(required_access, user, repos_name,
+                            apr_pstrmemdup(pool, path, segment - path),
+                            path_node ? 'p' : 'b', pool);
+      SVN_ERR(authz_cache_get(&found, access_granted, authz, key, pool));
+      if (found)
+        return SVN_NO_ERROR;
+
+      *access_granted = authz_get_access(nodes, path_node, repos_name,
+                                         user, required_access, pool);
     }
 
-  /* If the caller requested recursive access, we need to walk through
-     the entire authz config to see whether any child paths are denied
-     to the requested user. */
-  if (*access_granted && (required_access & svn_authz_recursive))
-    *access_granted = authz_get_tree_access(authz->cfg, repos_name, path,
-                                            user, required_access, pool);
+  if (counters)
+    counters->evaluations++;
 
-  return SVN_NO_ERROR;
+  return svn_error_trace(svn_cache__set(authz->cache, key, access_granted,
+                                        pool));
+}
+
+
+svn_error_t *
+svn_repos_authz_check_access(svn_authz_t *authz, const char *repos_name,
+                             const char *path, const char *user,
+                             svn_repos_authz_access_t required_access,
+                             svn_boolean_t *access_granted,
+                             apr_pool_t *pool)
+{
+  return svn_error_trace(svn_repos__authz_check_access(authz, repos_name,
+                                                      path, user,
+                                                      required_access,
+                                                      access_granted,
+                                                      NULL, pool));
 }
@@ -0,0 +1,288 @@
+/* blame.c --- compute line-based blame information in the repository
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+
+#include <string.h>
+#include "svn_private_config.h"
+#include "svn_pools.h"
+#include "svn_error.h"
+#include "svn_fs.h"
+#include "svn_repos.h"
+#include "svn_diff.h"
+#include "svn_io.h"
+#include "svn_props.h"
+#include "repos.h"
+#include "private/svn_repos_private.h"
+
+
+/* A revision that lines can be attributed to. */
+typedef struct blame_rev_t
+{
+  svn_revnum_t revision;  /* SVN_INVALID_REVNUM if before the range */
+  apr_hash_t *rev_props;  /* NULL if REVISION is invalid */
+} blame_rev_t;
+
+/* The baton used while walking the file's history. */
+typedef struct blame_baton_t
+{
+  svn_repos_t *repos;
+  const char *path;
+  svn_revnum_t start;
+  const svn_diff_file_options_t *diff_options;
+  svn_boolean_t ignore_mime_type;
+
+  /* For every line of the file at the latest revision seen so far,
+     the const blame_rev_t * that it was last changed in. */
+  apr_array_header_t *lines;
+
+  /* While diffing, the attribution of the current revision being built
+     and the number of lines of LINES that have been processed so far.
+     NEW_LINES and LINES get swapped after every revision. */
+  apr_array_header_t *new_lines;
+  int copied_lines;
+
+  /* The revision that modified lines get attributed to during a diff. */
+  const blame_rev_t *rev;
+
+  /* The file containing the latest revision seen so far.  Before the
+     first revision, this is an empty file. */
+  const char *last_filename;
+
+  /* Lives during the whole operation. */
+  apr_pool_t *pool;
+
+  /* Flipped for every revision with text changes, as the file of the
+     previous revision must outlive the one of the current revision. */
+  apr_pool_t *lastpool;
+  apr_pool_t *currpool;
+} blame_baton_t;
+
+
+/* Append the lines START up to END of the previous revision to the
+   attribution of the current revision. */
+static void
+copy_lines(blame_baton_t *bb,
+           int start,
+           int end)
+{
+  int i;
+
+  for (i = start; i < end; i++)
+    APR_ARRAY_PUSH(bb->new_lines, const blame_rev_t *)
+      = APR_ARRAY_IDX(bb->lines, i, const blame_rev_t *);
+}
+
+/* Implements svn_diff_output_fns_t.output_diff_modified.  Hunks are
+   reported in ascending order, so a single pass over the attribution of
+   the previous revision suffices to build the one of the current
+   revision, no matter how many hunks there are. */
+static svn_error_t *
+output_diff_modified(void *baton,
+                     apr_off_t original_start,
+                     apr_off_t original_length,
+                     apr_off_t modified_start,
+                     apr_off_t modified_length,
+                     apr_off_t latest_start,
+                     apr_off_t latest_length)
+{
+  blame_baton_t *bb = baton;
+  apr_off_t i;
+
+  /* Unchanged lines in front of this hunk. */
+  copy_lines(bb, bb->copied_lines, (int)original_start);
+
+  for (i = 0; i < modified_length; i++)
+    APR_ARRAY_PUSH(bb->new_lines, const blame_rev_t *) = bb->rev;
+
+  bb->copied_lines = (int)(original_start + original_length);
+
+  return SVN_NO_ERROR;
+}
+
+static const svn_diff_output_fns_t output_fns = {
+        NULL,
+        output_diff_modified
+};
+
+/* Return SVN_ERR_CLIENT_IS_BINARY_FILE if PROP_DIFFS set a binary
+   mime-type on PATH. */
+static svn_error_t *
+check_mimetype(const apr_array_header_t *prop_diffs,
+               const char *path)
+{
+  int i;
+
+  for (i = 0; i < prop_diffs->nelts; ++i)
+    {
+      const svn_prop_t *prop = &APR_ARRAY_IDX(prop_diffs, i, svn_prop_t);
+      if (strcmp(prop->name, SVN_PROP_MIME_TYPE) == 0
+          && prop->value
+          && svn_mime_type_is_binary(prop->value->data))
+        return svn_error_createf
+          (SVN_ERR_CLIENT_IS_BINARY_FILE, 0,
+           _("Cannot calculate blame information for binary file '%s'"),
+           path);
+    }
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_file_rev_handler_t.  Rather than having the deltas
+   computed, this reads the fulltexts straight from the filesystem and
+   updates the line attribution in the blame_baton_t BATON. */
+static svn_error_t *
+file_rev_handler(void *baton,
+                 const char *path,
+                 svn_revnum_t revnum,
+                 apr_hash_t *rev_props,
+                 svn_boolean_t merged_revision,
+                 svn_txdelta_window_handler_t *content_delta_handler,
+                 void **content_delta_baton,
+                 apr_array_header_t *prop_diffs,
+                 apr_pool_t *pool)
+{
+  blame_baton_t *bb = baton;
+  svn_fs_root_t *root;
+  svn_stream_t *contents;
+  svn_stream_t *file;
+  const char *filename;
+  blame_rev_t *rev;
+  svn_diff_t *diff;
+
+  if (! bb->ignore_mime_type)
+    SVN_ERR(check_mimetype(prop_diffs, bb->path));
+
+  /* Nothing to attribute if the text did not change.  Note that we
+     don't switch pools in that case, so the last file stays around. */
+  if (! content_delta_handler)
+    return SVN_NO_ERROR;
+
+  svn_pool_clear(bb->currpool);
+
+  SVN_ERR(svn_fs_revision_root(&root, svn_repos_fs(bb->repos), revnum,
+                               pool));
+  SVN_ERR(svn_fs_file_contents(&contents, root, path, pool));
+  SVN_ERR(svn_stream_open_unique(&file, &filename, NULL,
+                                 svn_io_file_del_on_pool_cleanup,
+                                 bb->currpool, pool));
+  SVN_ERR(svn_stream_copy3(contents, file, NULL, NULL, pool));
+
+  rev = apr_pcalloc(bb->pool, sizeof(*rev));
+  if (revnum < bb->start)
+    {
+      /* The file existed before START; lines from this revision (or
+         before) don't get any blame. */
+      rev->revision = SVN_INVALID_REVNUM;
+    }
+  else
+    {
+      rev->revision = revnum;
+      rev->rev_props = svn_prop_hash_dup(rev_props, bb->pool);
+    }
+  bb->rev = rev;
+
+  SVN_ERR(svn_diff_file_diff_2(&diff, bb->last_filename, filename,
+                               bb->diff_options, pool));
+  bb->new_lines->nelts = 0;
+  bb->copied_lines = 0;
+  SVN_ERR(svn_diff_output(diff, bb, &output_fns));
+  copy_lines(bb, bb->copied_lines, bb->lines->nelts);
+
+  /* Prepare for the next revision. */
+  {
+    apr_array_header_t *tmp_lines = bb->lines;
+    bb->lines = bb->new_lines;
+    bb->new_lines = tmp_lines;
+  }
+  bb->last_filename = filename;
+  {
+    apr_pool_t *tmp_pool = bb->lastpool;
+    bb->lastpool = bb->currpool;
+    bb->currpool = tmp_pool;
+  }
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_repos__get_file_blame(svn_repos_t *repos,
+                          const char *path,
+                          svn_revnum_t start,
+                          svn_revnum_t end,
+                          const svn_diff_file_options_t *diff_options,
+                          svn_boolean_t ignore_mime_type,
+                          svn_repos_authz_func_t authz_read_func,
+                          void *authz_read_baton,
+                          svn_repos__blame_receiver_t receiver,
+                          void *receiver_baton,
+                          apr_pool_t *pool)
+{
+  blame_baton_t bb;
+  const blame_rev_t *last_rev = NULL;
+  apr_pool_t *iterpool;
+  int i;
+
+  bb.repos = repos;
+  bb.path = path;
+  bb.start = start;
+  bb.diff_options = diff_options;
+  bb.ignore_mime_type = ignore_mime_type;
+  bb.lines = apr_array_make(pool, 256, sizeof(const blame_rev_t *));
+  bb.new_lines = apr_array_make(pool, 256, sizeof(const blame_rev_t *));
+  bb.copied_lines = 0;
+  bb.rev = NULL;
+  bb.pool = pool;
+  bb.lastpool = svn_pool_create(pool);
+  bb.currpool = svn_pool_create(pool);
+
+  SVN_ERR(svn_io_open_unique_file3(NULL, &bb.last_filename, NULL,
+                                   svn_io_file_del_on_pool_cleanup,
+                                   pool, pool));
+
+  /* We need one revision before START, if available, so that we know
+     what was actually changed in START. */
+  SVN_ERR(svn_repos_get_file_revs2(repos, path,
+                                   start - (start > 0 ? 1 : 0), end,
+                                   FALSE, authz_read_func, authz_read_baton,
+                                   file_rev_handler, &bb, pool));
+
+  svn_pool_destroy(bb.lastpool);
+  svn_pool_destroy(bb.currpool);
+
+  /* Report runs of lines last changed in the same revision. */
+  iterpool = svn_pool_create(pool);
+  for (i = 0; i < bb.lines->nelts; i++)
+    {
+      const blame_rev_t *rev = APR_ARRAY_IDX(bb.lines, i,
+                                             const blame_rev_t *);
+
+      if (rev == last_rev)
+        continue;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(receiver(receiver_baton, i, rev->revision, rev->rev_props,
+                       iterpool));
+      last_rev = rev;
+    }
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
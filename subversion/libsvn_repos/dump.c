@@ -35,9 +35,14 @@
 #include "svn_checksum.h"
 #include "svn_props.h"
 #include "svn_sorts.h"
+#include "svn_cache_config.h"
 
 #include "private/svn_mergeinfo_private.h"
 #include "private/svn_fs_private.h"
+#include "private/svn_repos_private.h"
+#include "private/svn_string_private.h"
+#include "private/svn_subr_private.h"
+#include "private/svn_thread_pool.h"
 
 #define ARE_VALID_COPY_ARGS(p,r) ((p) && SVN_IS_VALID_REVNUM(r))
 
@@ -45,42 +50,180 @@
 
 
 
+/* Deltas up to this size are kept in memory by store_delta().  With
+   chunked texts, the deltas of larger files get streamed instead. */
+#define DELTA_SPILL_SIZE (1024 * 1024)
+
+/* Baton for write_to_spillbuf(). */
+struct spillbuf_write_baton
+{
+  svn_spillbuf_t *buf;
+  apr_pool_t *scratch_pool;
+};
+
+/* Implements svn_write_fn_t.  Append DATA to the spill buffer of the
+   spillbuf_write_baton in BATON. */
+static svn_error_t *
+write_to_spillbuf(void *baton,
+                  const char *data,
+                  apr_size_t *len)
+{
+  struct spillbuf_write_baton *swb = baton;
+
+  SVN_ERR(svn_spillbuf__write(swb->buf, data, *len, swb->scratch_pool));
+  svn_pool_clear(swb->scratch_pool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_spillbuf_read_t.  Write DATA to the stream in BATON. */
+static svn_error_t *
+write_from_spillbuf(svn_boolean_t *stop,
+                    void *baton,
+                    const char *data,
+                    apr_size_t len,
+                    apr_pool_t *scratch_pool)
+{
+  *stop = FALSE;
+  return svn_stream_write(baton, data, &len);
+}
+
 /* Compute the delta between OLDROOT/OLDPATH and NEWROOT/NEWPATH and
-   store it into a new temporary file *TEMPFILE.  OLDROOT may be NULL,
-   in which case the delta will be computed against an empty file, as
-   per the svn_fs_get_file_delta_stream docstring.  Record the length
-   of the temporary file in *LEN, and rewind the file before
-   returning. */
+   store it in a new spill buffer *DELTA, which keeps it in memory unless
+   it is larger than DELTA_SPILL_SIZE.  OLDROOT may be NULL, in which
+   case the delta will be computed against an empty file, as per the
+   svn_fs_get_file_delta_stream docstring.  Record the length of the
+   delta in *LEN.  Allocate *DELTA in POOL. */
 static svn_error_t *
-store_delta(apr_file_t **tempfile, svn_filesize_t *len,
+store_delta(svn_spillbuf_t **delta, svn_filesize_t *len,
             svn_fs_root_t *oldroot, const char *oldpath,
             svn_fs_root_t *newroot, const char *newpath, apr_pool_t *pool)
 {
-  svn_stream_t *temp_stream;
-  apr_off_t offset = 0;
+  struct spillbuf_write_baton *swb = apr_palloc(pool, sizeof(*swb));
+  svn_stream_t *spill_stream;
   svn_txdelta_stream_t *delta_stream;
   svn_txdelta_window_handler_t wh;
   void *whb;
 
-  /* Create a temporary file and open a stream to it. Note that we need
-     the file handle in order to rewind it. */
-  SVN_ERR(svn_io_open_unique_file3(tempfile, NULL, NULL,
-                                   svn_io_file_del_on_pool_cleanup,
-                                   pool, pool));
-  temp_stream = svn_stream_from_aprfile2(*tempfile, TRUE, pool);
+  *delta = svn_spillbuf__create(SVN__STREAM_CHUNK_SIZE, DELTA_SPILL_SIZE,
+                                pool);
+  swb->buf = *delta;
+  swb->scratch_pool = svn_pool_create(pool);
+  spill_stream = svn_stream_create(swb, pool);
+  svn_stream_set_write(spill_stream, write_to_spillbuf);
 
-  /* Compute the delta and send it to the temporary file. */
+  /* Compute the delta and send it to the spill buffer. */
   SVN_ERR(svn_fs_get_file_delta_stream(&delta_stream, oldroot, oldpath,
                                        newroot, newpath, pool));
-  svn_txdelta_to_svndiff3(&wh, &whb, temp_stream, 0,
+  svn_txdelta_to_svndiff3(&wh, &whb, spill_stream, 0,
                           SVN_DELTA_COMPRESSION_LEVEL_DEFAULT, pool);
   SVN_ERR(svn_txdelta_send_txstream(delta_stream, wh, whb, pool));
 
-  /* Get the length of the temporary file and rewind it. */
-  SVN_ERR(svn_io_file_seek(*tempfile, APR_CUR, &offset, pool));
-  *len = offset;
-  offset = 0;
-  return svn_io_file_seek(*tempfile, APR_SET, &offset, pool);
+  *len = svn_spillbuf__get_size(*delta);
+  return SVN_NO_ERROR;
+}
+
+/* Baton for the stream created by write_chunked_delta(). */
+struct chunked_baton
+{
+  /* The stream to write the chunks to. */
+  svn_stream_t *stream;
+
+  /* The data of the current chunk. */
+  char *buffer;
+  apr_size_t size;
+  apr_size_t used;
+};
+
+/* Write the current chunk of CB, if it is not empty, to its stream. */
+static svn_error_t *
+flush_chunk(struct chunked_baton *cb)
+{
+  char line[SVN_INT64_BUFFER_SIZE + 1];
+  apr_size_t len;
+
+  if (cb->used == 0)
+    return SVN_NO_ERROR;
+
+  len = svn__ui64toa(line, cb->used);
+  line[len++] = '\n';
+  SVN_ERR(svn_stream_write(cb->stream, line, &len));
+
+  len = cb->used;
+  cb->used = 0;
+  return svn_stream_write(cb->stream, cb->buffer, &len);
+}
+
+/* Implements svn_write_fn_t.  Add DATA to the chunks of the
+   chunked_baton in BATON. */
+static svn_error_t *
+write_chunked(void *baton,
+              const char *data,
+              apr_size_t *len)
+{
+  struct chunked_baton *cb = baton;
+  apr_size_t remaining = *len;
+
+  while (remaining)
+    {
+      apr_size_t to_copy = MIN(remaining, cb->size - cb->used);
+
+      memcpy(cb->buffer + cb->used, data, to_copy);
+      cb->used += to_copy;
+      data += to_copy;
+      remaining -= to_copy;
+
+      if (cb->used == cb->size)
+        SVN_ERR(flush_chunk(cb));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_close_fn_t.  Write the last chunk of the chunked_baton
+   in BATON followed by the empty chunk that terminates the content. */
+static svn_error_t *
+close_chunked(void *baton)
+{
+  struct chunked_baton *cb = baton;
+  apr_size_t len = 2;
+
+  SVN_ERR(flush_chunk(cb));
+  return svn_stream_write(cb->stream, "0\n", &len);
+}
+
+/* Compute the delta between OLDROOT/OLDPATH and NEWROOT/NEWPATH like
+   store_delta() does, but write it directly to STREAM as chunked text
+   content, using BUFFER of size BUFSIZE for the chunks.  Use POOL for
+   temporary allocations. */
+static svn_error_t *
+write_chunked_delta(svn_stream_t *stream,
+                    char *buffer,
+                    apr_size_t bufsize,
+                    svn_fs_root_t *oldroot, const char *oldpath,
+                    svn_fs_root_t *newroot, const char *newpath,
+                    apr_pool_t *pool)
+{
+  struct chunked_baton *cb = apr_palloc(pool, sizeof(*cb));
+  svn_stream_t *chunked_stream;
+  svn_txdelta_stream_t *delta_stream;
+  svn_txdelta_window_handler_t wh;
+  void *whb;
+
+  cb->stream = stream;
+  cb->buffer = buffer;
+  cb->size = bufsize;
+  cb->used = 0;
+  chunked_stream = svn_stream_create(cb, pool);
+  svn_stream_set_write(chunked_stream, write_chunked);
+  svn_stream_set_close(chunked_stream, close_chunked);
+
+  /* The svndiff writer closes CHUNKED_STREAM after the last window. */
+  SVN_ERR(svn_fs_get_file_delta_stream(&delta_stream, oldroot, oldpath,
+                                       newroot, newpath, pool));
+  svn_txdelta_to_svndiff3(&wh, &whb, chunked_stream, 0,
+                          SVN_DELTA_COMPRESSION_LEVEL_DEFAULT, pool);
+  return svn_txdelta_send_txstream(delta_stream, wh, whb, pool);
 }
 
 
@@ -113,6 +256,10 @@ struct edit_baton
   /* True if dumped nodes should output deltas instead of full text. */
   svn_boolean_t use_deltas;
 
+  /* True if the deltas of large files may be written as chunked text
+     content. */
+  svn_boolean_t chunked_texts;
+
   /* True if this "dump" is in fact a verify. */
   svn_boolean_t verify;
 
@@ -246,7 +393,8 @@ dump_node(struct edit_baton *eb,
   const char *compare_path = path;
   svn_revnum_t compare_rev = eb->current_rev - 1;
   svn_fs_root_t *compare_root = NULL;
-  apr_file_t *delta_file = NULL;
+  svn_spillbuf_t *delta = NULL;
+  svn_boolean_t chunked_text = FALSE;
 
   /* Maybe validate the path. */
   if (eb->verify || eb->notify_func)
@@ -538,11 +686,18 @@ dump_node(struct edit_baton *eb,
 
       if (eb->use_deltas)
         {
-          /* Compute the text delta now and write it into a temporary
-             file, so that we can find its length.  Output a header
-             saying our text contents are a delta. */
-          SVN_ERR(store_delta(&delta_file, &textlen, compare_root,
-                              compare_path, eb->fs_root, path, pool));
+          /* Compute the text delta now and buffer it, so that we can
+             find its length, unless the file is large enough to rather
+             stream its delta in chunks.  Output a header saying our text
+             contents are a delta. */
+          if (eb->chunked_texts)
+            {
+              SVN_ERR(svn_fs_file_length(&textlen, eb->fs_root, path, pool));
+              chunked_text = (textlen > DELTA_SPILL_SIZE);
+            }
+          if (! chunked_text)
+            SVN_ERR(store_delta(&delta, &textlen, compare_root,
+                                compare_path, eb->fs_root, path, pool));
           SVN_ERR(svn_stream_puts(eb->stream,
                                   SVN_REPOS_DUMPFILE_TEXT_DELTA ": true\n"));
 
@@ -573,10 +728,19 @@ dump_node(struct edit_baton *eb,
           SVN_ERR(svn_fs_file_length(&textlen, eb->fs_root, path, pool));
         }
 
-      content_length += textlen;
-      SVN_ERR(svn_stream_printf(eb->stream, pool,
-                                SVN_REPOS_DUMPFILE_TEXT_CONTENT_LENGTH
-                                ": %" SVN_FILESIZE_T_FMT "\n", textlen));
+      if (chunked_text)
+        {
+          SVN_ERR(svn_stream_puts(eb->stream,
+                                  SVN_REPOS__DUMPFILE_TEXT_CONTENT_CHUNKED
+                                  ": true\n"));
+        }
+      else
+        {
+          content_length += textlen;
+          SVN_ERR(svn_stream_printf(eb->stream, pool,
+                                    SVN_REPOS_DUMPFILE_TEXT_CONTENT_LENGTH
+                                    ": %" SVN_FILESIZE_T_FMT "\n", textlen));
+        }
 
       SVN_ERR(svn_fs_file_checksum(&checksum, svn_checksum_md5,
                                    eb->fs_root, path, FALSE, pool));
@@ -597,11 +761,15 @@ dump_node(struct edit_baton *eb,
 
   /* 'Content-length:' is the last header before we dump the content,
      and is the sum of the text and prop contents lengths.  We write
-     this only for the benefit of non-Subversion RFC-822 parsers. */
-  SVN_ERR(svn_stream_printf(eb->stream, pool,
-                            SVN_REPOS_DUMPFILE_CONTENT_LENGTH
-                            ": %" SVN_FILESIZE_T_FMT "\n\n",
-                            content_length));
+     this only for the benefit of non-Subversion RFC-822 parsers, which
+     cannot read chunked text content anyway. */
+  if (chunked_text)
+    SVN_ERR(svn_stream_puts(eb->stream, "\n"));
+  else
+    SVN_ERR(svn_stream_printf(eb->stream, pool,
+                              SVN_REPOS_DUMPFILE_CONTENT_LENGTH
+                              ": %" SVN_FILESIZE_T_FMT "\n\n",
+                              content_length));
 
   /* Dump property content if we're supposed to do so. */
   if (must_dump_props)
@@ -614,18 +782,22 @@ dump_node(struct edit_baton *eb,
   if (must_dump_text && (kind == svn_node_file))
     {
       svn_stream_t *contents;
-
-      if (delta_file)
+      svn_boolean_t exhausted;
+
+      if (chunked_text)
+        SVN_ERR(write_chunked_delta(eb->stream, eb->buffer, eb->bufsize,
+                                    compare_root, compare_path,
+                                    eb->fs_root, path, pool));
+      else if (delta)
+        SVN_ERR(svn_spillbuf__process(&exhausted, delta, write_from_spillbuf,
+                                      eb->stream, pool));
+      else
         {
-          /* Make sure to close the underlying file when the stream is
-             closed. */
-          contents = svn_stream_from_aprfile2(delta_file, FALSE, pool);
+          SVN_ERR(svn_fs_file_contents(&contents, eb->fs_root, path, pool));
+          SVN_ERR(svn_stream_copy3(contents,
+                                   svn_stream_disown(eb->stream, pool),
+                                   NULL, NULL, pool));
         }
-      else
-        SVN_ERR(svn_fs_file_contents(&contents, eb->fs_root, path, pool));
-
-      SVN_ERR(svn_stream_copy3(contents, svn_stream_disown(eb->stream, pool),
-                               NULL, NULL, pool));
     }
 
   len = 2;
@@ -962,6 +1134,7 @@ get_dump_editor(const svn_delta_editor_t **editor,
                 void *notify_baton,
                 svn_revnum_t oldest_dumped_rev,
                 svn_boolean_t use_deltas,
+                svn_boolean_t chunked_texts,
                 svn_boolean_t verify,
                 apr_pool_t *pool)
 {
@@ -984,6 +1157,7 @@ get_dump_editor(const svn_delta_editor_t **editor,
   eb->fs = fs;
   eb->current_rev = to_rev;
   eb->use_deltas = use_deltas;
+  eb->chunked_texts = chunked_texts;
   eb->verify = verify;
   eb->found_old_reference = found_old_reference;
   eb->found_old_mergeinfo = found_old_mergeinfo;
@@ -1086,58 +1260,57 @@ write_revision_record(svn_stream_t *stream,
 
 
 
-/* The main dumper. */
-svn_error_t *
-svn_repos_dump_fs3(svn_repos_t *repos,
-                   svn_stream_t *stream,
-                   svn_revnum_t start_rev,
-                   svn_revnum_t end_rev,
-                   svn_boolean_t incremental,
-                   svn_boolean_t use_deltas,
-                   svn_repos_notify_func_t notify_func,
-                   void *notify_baton,
-                   svn_cancel_func_t cancel_func,
-                   void *cancel_baton,
-                   apr_pool_t *pool)
+/* Helper for the dump functions.
+
+   Default START_REV and END_REV as svn_repos_dump_fs3() does and make sure
+   that they describe a valid revision range of FS.  Use POOL for temporary
+   allocations. */
+static svn_error_t *
+check_dump_range(svn_revnum_t *start_rev,
+                 svn_revnum_t *end_rev,
+                 svn_fs_t *fs,
+                 apr_pool_t *pool)
 {
-  const svn_delta_editor_t *dump_editor;
-  void *dump_edit_baton = NULL;
-  svn_revnum_t i;
-  svn_fs_t *fs = svn_repos_fs(repos);
-  apr_pool_t *subpool = svn_pool_create(pool);
   svn_revnum_t youngest;
-  const char *uuid;
-  int version;
-  svn_boolean_t found_old_reference = FALSE;
-  svn_boolean_t found_old_mergeinfo = FALSE;
-  svn_repos_notify_t *notify;
 
   /* Determine the current youngest revision of the filesystem. */
   SVN_ERR(svn_fs_youngest_rev(&youngest, fs, pool));
 
   /* Use default vals if necessary. */
-  if (! SVN_IS_VALID_REVNUM(start_rev))
-    start_rev = 0;
-  if (! SVN_IS_VALID_REVNUM(end_rev))
-    end_rev = youngest;
-  if (! stream)
-    stream = svn_stream_empty(pool);
+  if (! SVN_IS_VALID_REVNUM(*start_rev))
+    *start_rev = 0;
+  if (! SVN_IS_VALID_REVNUM(*end_rev))
+    *end_rev = youngest;
 
   /* Validate the revisions. */
-  if (start_rev > end_rev)
+  if (*start_rev > *end_rev)
     return svn_error_createf(SVN_ERR_REPOS_BAD_ARGS, NULL,
                              _("Start revision %ld"
                                " is greater than end revision %ld"),
-                             start_rev, end_rev);
-  if (end_rev > youngest)
+                             *start_rev, *end_rev);
+  if (*end_rev > youngest)
     return svn_error_createf(SVN_ERR_REPOS_BAD_ARGS, NULL,
                              _("End revision %ld is invalid "
                                "(youngest revision is %ld)"),
-                             end_rev, youngest);
-  if ((start_rev == 0) && incremental)
-    incremental = FALSE; /* revision 0 looks the same regardless of
-                            whether or not this is an incremental
-                            dump, so just simplify things. */
+                             *end_rev, youngest);
+
+  return SVN_NO_ERROR;
+}
+
+/* Helper for the dump functions.
+
+   Write the dumpfile format version and the UUID of FS to STREAM, using
+   POOL.  The format version depends on whether USE_DELTAS and, with
+   deltas, CHUNKED_TEXTS are set. */
+static svn_error_t *
+write_dump_header(svn_stream_t *stream,
+                  svn_fs_t *fs,
+                  svn_boolean_t use_deltas,
+                  svn_boolean_t chunked_texts,
+                  apr_pool_t *pool)
+{
+  const char *uuid;
+  int version;
 
   /* Write out the UUID. */
   SVN_ERR(svn_fs_get_uuid(fs, &uuid, pool));
@@ -1147,14 +1320,50 @@ svn_repos_dump_fs3(svn_repos_t *repos,
   version = SVN_REPOS_DUMPFILE_FORMAT_VERSION;
   if (!use_deltas)
     version--;
+  else if (chunked_texts)
+    version = SVN_REPOS__DUMPFILE_FORMAT_VERSION_CHUNKED;
 
   /* Write out "general" metadata for the dumpfile.  In this case, a
      magic header followed by a dumpfile format version. */
   SVN_ERR(svn_stream_printf(stream, pool,
                             SVN_REPOS_DUMPFILE_MAGIC_HEADER ": %d\n\n",
                             version));
-  SVN_ERR(svn_stream_printf(stream, pool, SVN_REPOS_DUMPFILE_UUID
-                            ": %s\n\n", uuid));
+  return svn_stream_printf(stream, pool, SVN_REPOS_DUMPFILE_UUID
+                           ": %s\n\n", uuid);
+}
+
+/* Helper for the dump functions.
+
+   Dump the revisions START_REV through END_REV of FS to STREAM, without
+   any dumpfile header.  Unless INCREMENTAL is set, START_REV will be
+   dumped as a full tree.  OLDEST_DUMPED_REV is the first revision of the
+   whole dump, which may be older than START_REV.  Set *FOUND_OLD_REFERENCE
+   and *FOUND_OLD_MERGEINFO if references to revisions older than that
+   have been found.  CHUNKED_TEXTS is as for svn_repos__dump_fs_parallel(),
+   the other parameters are as for svn_repos_dump_fs3().  Use POOL for
+   temporary allocations. */
+static svn_error_t *
+dump_revisions(svn_fs_t *fs,
+               svn_stream_t *stream,
+               svn_revnum_t start_rev,
+               svn_revnum_t end_rev,
+               svn_revnum_t oldest_dumped_rev,
+               svn_boolean_t incremental,
+               svn_boolean_t use_deltas,
+               svn_boolean_t chunked_texts,
+               svn_boolean_t *found_old_reference,
+               svn_boolean_t *found_old_mergeinfo,
+               svn_repos_notify_func_t notify_func,
+               void *notify_baton,
+               svn_cancel_func_t cancel_func,
+               void *cancel_baton,
+               apr_pool_t *pool)
+{
+  const svn_delta_editor_t *dump_editor;
+  void *dump_edit_baton = NULL;
+  svn_revnum_t i;
+  apr_pool_t *subpool = svn_pool_create(pool);
+  svn_repos_notify_t *notify;
 
   /* Create a notify object that we can reuse in the loop. */
   if (notify_func)
@@ -1209,10 +1418,11 @@ svn_repos_dump_fs3(svn_repos_t *repos,
          non-incremental dump. */
       use_deltas_for_rev = use_deltas && (incremental || i != start_rev);
       SVN_ERR(get_dump_editor(&dump_editor, &dump_edit_baton, fs, to_rev,
-                              "", stream, &found_old_reference,
-                              &found_old_mergeinfo, NULL,
+                              "", stream, found_old_reference,
+                              found_old_mergeinfo, NULL,
                               notify_func, notify_baton,
-                              start_rev, use_deltas_for_rev, FALSE, subpool));
+                              oldest_dumped_rev, use_deltas_for_rev,
+                              chunked_texts, FALSE, subpool));
 
       /* Drive the editor in one way or another. */
       SVN_ERR(svn_fs_revision_root(&to_root, fs, to_rev, subpool));
@@ -1254,44 +1464,361 @@ svn_repos_dump_fs3(svn_repos_t *repos,
         }
     }
 
+  svn_pool_destroy(subpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Helper for the dump functions.
+
+   Send the final notifications of a dump to NOTIFY_FUNC with NOTIFY_BATON,
+   including warnings about references to revisions older than the oldest
+   dumped revision if FOUND_OLD_REFERENCE or FOUND_OLD_MERGEINFO is set.
+   Use POOL for temporary allocations. */
+static void
+notify_dump_end(svn_boolean_t found_old_reference,
+                svn_boolean_t found_old_mergeinfo,
+                svn_repos_notify_func_t notify_func,
+                void *notify_baton,
+                apr_pool_t *pool)
+{
+  svn_repos_notify_t *notify;
+
+  /* Did we issue any warnings about references to revisions older than
+     the oldest dumped revision?  If so, then issue a final generic
+     warning, since the inline warnings already issued might easily be
+     missed. */
+
+  notify = svn_repos_notify_create(svn_repos_notify_dump_end, pool);
+  notify_func(notify_baton, notify, pool);
+
+  if (found_old_reference)
+    {
+      notify = svn_repos_notify_create(svn_repos_notify_warning, pool);
+
+      notify->warning = svn_repos_notify_warning_found_old_reference;
+      notify->warning_str = _("The range of revisions dumped "
+                              "contained references to "
+                              "copy sources outside that "
+                              "range.");
+      notify_func(notify_baton, notify, pool);
+    }
+
+  /* Ditto if we issued any warnings about old revisions referenced
+     in dumped mergeinfo. */
+  if (found_old_mergeinfo)
+    {
+      notify = svn_repos_notify_create(svn_repos_notify_warning, pool);
+
+      notify->warning = svn_repos_notify_warning_found_old_mergeinfo;
+      notify->warning_str = _("The range of revisions dumped "
+                              "contained mergeinfo "
+                              "which reference revisions outside "
+                              "that range.");
+      notify_func(notify_baton, notify, pool);
+    }
+}
+
+
+/* The main dumper. */
+svn_error_t *
+svn_repos_dump_fs3(svn_repos_t *repos,
+                   svn_stream_t *stream,
+                   svn_revnum_t start_rev,
+                   svn_revnum_t end_rev,
+                   svn_boolean_t incremental,
+                   svn_boolean_t use_deltas,
+                   svn_repos_notify_func_t notify_func,
+                   void *notify_baton,
+                   svn_cancel_func_t cancel_func,
+                   void *cancel_baton,
+                   apr_pool_t *pool)
+{
+  svn_fs_t *fs = svn_repos_fs(repos);
+  svn_boolean_t found_old_reference = FALSE;
+  svn_boolean_t found_old_mergeinfo = FALSE;
+
+  SVN_ERR(check_dump_range(&start_rev, &end_rev, fs, pool));
+  if (! stream)
+    stream = svn_stream_empty(pool);
+
+  if ((start_rev == 0) && incremental)
+    incremental = FALSE; /* revision 0 looks the same regardless of
+                            whether or not this is an incremental
+                            dump, so just simplify things. */
+
+  SVN_ERR(write_dump_header(stream, fs, use_deltas, FALSE, pool));
+  SVN_ERR(dump_revisions(fs, stream, start_rev, end_rev, start_rev,
+                         incremental, use_deltas, FALSE,
+                         &found_old_reference, &found_old_mergeinfo,
+                         notify_func, notify_baton,
+                         cancel_func, cancel_baton, pool));
+
   if (notify_func)
+    notify_dump_end(found_old_reference, found_old_mergeinfo,
+                    notify_func, notify_baton, pool);
+
+  return SVN_NO_ERROR;
+}
+
+
+/*----------------------------------------------------------------------*/
+
+/** Parallel dumping **/
+
+/* Spill buffer size of the chunks dumped by worker threads. */
+#define DUMP_SPILL_SIZE (1024 * 1024)
+
+/* One revision range dumped by svn_repos__dump_fs_parallel(). */
+typedef struct dump_chunk_t
+{
+  /* The revisions to dump and whether START_REV shall be dumped as a
+     difference to its predecessor. */
+  svn_revnum_t start_rev;
+  svn_revnum_t end_rev;
+  svn_boolean_t incremental;
+
+  /* The filesystem to open, the first revision of the whole dump and
+     the remaining svn_repos_dump_fs3() parameters. */
+  const char *fs_path;
+  apr_hash_t *fs_config;
+  svn_revnum_t oldest_dumped_rev;
+  svn_boolean_t use_deltas;
+  svn_boolean_t chunked_texts;
+  svn_cancel_func_t cancel_func;
+  void *cancel_baton;
+
+  /* Whether to record the notifications. */
+  svn_boolean_t record_notifications;
+
+  /* Set by dump_chunk(), in the result pool of JOB: the dump data, the
+     recorded notifications (svn_repos_notify_t *) and whether there were
+     references to revisions older than OLDEST_DUMPED_REV. */
+  svn_stream_t *data;
+  apr_array_header_t *notifications;
+  svn_boolean_t found_old_reference;
+  svn_boolean_t found_old_mergeinfo;
+
+  svn_thread_pool__job_t *job;
+} dump_chunk_t;
+
+/* Baton for record_notification(). */
+typedef struct record_baton_t
+{
+  apr_array_header_t *notifications;
+  apr_pool_t *pool;
+} record_baton_t;
+
+/* Implements svn_repos_notify_func_t.  Append a copy of NOTIFY to the
+   notifications of the record_baton_t in BATON. */
+static void
+record_notification(void *baton,
+                    const svn_repos_notify_t *notify,
+                    apr_pool_t *scratch_pool)
+{
+  record_baton_t *rb = baton;
+  svn_repos_notify_t *copy = apr_pmemdup(rb->pool, notify, sizeof(*notify));
+
+  if (notify->warning_str)
+    copy->warning_str = apr_pstrdup(rb->pool, notify->warning_str);
+  if (notify->path)
+    copy->path = apr_pstrdup(rb->pool, notify->path);
+
+  APR_ARRAY_PUSH(rb->notifications, svn_repos_notify_t *) = copy;
+}
+
+/* Implements svn_thread_pool__task_t.  Dump the dump_chunk_t in BATON,
+   preceded by a dumpfile header, into a spill buffer using a private
+   instance of the filesystem. */
+static svn_error_t *
+dump_chunk(void *baton,
+           apr_pool_t *result_pool,
+           apr_pool_t *scratch_pool)
+{
+  dump_chunk_t *chunk = baton;
+  svn_repos_notify_func_t notify_func = NULL;
+  record_baton_t rb;
+  svn_fs_t *fs;
+
+  chunk->data = svn_stream__from_spillbuf(SVN__STREAM_CHUNK_SIZE,
+                                          DUMP_SPILL_SIZE, result_pool);
+  if (chunk->record_notifications)
     {
-      /* Did we issue any warnings about references to revisions older than
-         the oldest dumped revision?  If so, then issue a final generic
-         warning, since the inline warnings already issued might easily be
-         missed. */
+      rb.notifications = apr_array_make(result_pool, 16,
+                                        sizeof(svn_repos_notify_t *));
+      rb.pool = result_pool;
+      chunk->notifications = rb.notifications;
+      notify_func = record_notification;
+    }
 
-      notify = svn_repos_notify_create(svn_repos_notify_dump_end, subpool);
-      notify_func(notify_baton, notify, subpool);
+  SVN_ERR(svn_fs_open(&fs, chunk->fs_path, chunk->fs_config, scratch_pool));
+  SVN_ERR(write_dump_header(chunk->data, fs, chunk->use_deltas,
+                            chunk->chunked_texts, scratch_pool));
+
+  return svn_error_trace(dump_revisions(fs, chunk->data,
+                                        chunk->start_rev, chunk->end_rev,
+                                        chunk->oldest_dumped_rev,
+                                        chunk->incremental,
+                                        chunk->use_deltas,
+                                        chunk->chunked_texts,
+                                        &chunk->found_old_reference,
+                                        &chunk->found_old_mergeinfo,
+                                        notify_func, &rb,
+                                        chunk->cancel_func,
+                                        chunk->cancel_baton,
+                                        scratch_pool));
+}
 
-      if (found_old_reference)
-        {
-          notify = svn_repos_notify_create(svn_repos_notify_warning, subpool);
+svn_error_t *
+svn_repos__dump_fs_parallel(svn_repos_t *repos,
+                            const apr_array_header_t *streams,
+                            svn_revnum_t start_rev,
+                            svn_revnum_t end_rev,
+                            svn_boolean_t incremental,
+                            svn_boolean_t use_deltas,
+                            svn_boolean_t chunked_texts,
+                            int max_threads,
+                            apr_hash_t *fs_config,
+                            svn_repos_notify_func_t notify_func,
+                            void *notify_baton,
+                            svn_cancel_func_t cancel_func,
+                            void *cancel_baton,
+                            apr_pool_t *pool)
+{
+  svn_fs_t *fs = svn_repos_fs(repos);
+  svn_thread_pool__t *thread_pool;
+  apr_pool_t *jobs_pool;
+  apr_pool_t *iterpool;
+  dump_chunk_t *chunks;
+  const char *fs_path = svn_fs_path(fs, pool);
+  svn_revnum_t revs, first_rev;
+  svn_boolean_t found_old_reference = FALSE;
+  svn_boolean_t found_old_mergeinfo = FALSE;
+  svn_error_t *err = SVN_NO_ERROR;
+  int count = streams->nelts;
+  int submitted;
+  int i, k;
 
-          notify->warning = svn_repos_notify_warning_found_old_reference;
-          notify->warning_str = _("The range of revisions dumped "
-                                  "contained references to "
-                                  "copy sources outside that "
-                                  "range.");
-          notify_func(notify_baton, notify, subpool);
-        }
+  SVN_ERR_ASSERT(count > 0);
+  SVN_ERR(check_dump_range(&start_rev, &end_rev, fs, pool));
 
-      /* Ditto if we issued any warnings about old revisions referenced
-         in dumped mergeinfo. */
-      if (found_old_mergeinfo)
+  if ((start_rev == 0) && incremental)
+    incremental = FALSE;
+
+  /* Give every stream a contiguous range of revisions, the first ones
+     one revision more than the others.  Surplus streams only receive
+     the dumpfile header. */
+  revs = end_rev - start_rev + 1;
+  chunks = apr_pcalloc(pool, count * sizeof(*chunks));
+  first_rev = start_rev;
+  for (i = 0; i < count; i++)
+    {
+      svn_revnum_t len = revs / count + (i < revs % count ? 1 : 0);
+
+      chunks[i].start_rev = first_rev;
+      chunks[i].end_rev = first_rev + len - 1;
+      chunks[i].incremental = incremental || i > 0;
+      chunks[i].fs_path = fs_path;
+      chunks[i].fs_config = fs_config;
+      chunks[i].oldest_dumped_rev = start_rev;
+      chunks[i].use_deltas = use_deltas;
+      chunks[i].chunked_texts = chunked_texts;
+      chunks[i].cancel_func = cancel_func;
+      chunks[i].cancel_baton = cancel_baton;
+      chunks[i].record_notifications = (notify_func != NULL);
+
+      first_rev += len;
+    }
+
+  /* Without concurrency, this is just a sequence of incremental dumps. */
+  if (max_threads < 2 || svn_cache_config_get()->single_threaded)
+    {
+      iterpool = svn_pool_create(pool);
+      for (i = 0; i < count; i++)
         {
-          notify = svn_repos_notify_create(svn_repos_notify_warning, subpool);
+          svn_pool_clear(iterpool);
+          SVN_ERR(write_dump_header(APR_ARRAY_IDX(streams, i,
+                                                  svn_stream_t *),
+                                    fs, use_deltas, chunked_texts,
+                                    iterpool));
+          SVN_ERR(dump_revisions(fs, APR_ARRAY_IDX(streams, i,
+                                                   svn_stream_t *),
+                                 chunks[i].start_rev, chunks[i].end_rev,
+                                 start_rev, chunks[i].incremental,
+                                 use_deltas, chunked_texts,
+                                 &found_old_reference, &found_old_mergeinfo,
+                                 notify_func, notify_baton,
+                                 cancel_func, cancel_baton, iterpool));
+        }
+      svn_pool_destroy(iterpool);
 
-          notify->warning = svn_repos_notify_warning_found_old_mergeinfo;
-          notify->warning_str = _("The range of revisions dumped "
-                                  "contained mergeinfo "
-                                  "which reference revisions outside "
-                                  "that range.");
-          notify_func(notify_baton, notify, subpool);
+      if (notify_func)
+        notify_dump_end(found_old_reference, found_old_mergeinfo,
+                        notify_func, notify_baton, pool);
+
+      return SVN_NO_ERROR;
+    }
+
+  /* The thread pool and the jobs get cleaned up with JOBS_POOL, which
+     will wait for any chunks still being dumped.  Chunks that have been
+     dumped but not yet copied out keep their data in spill buffers, i.e.
+     in temporary files.  Therefore, only keep one chunk more in flight
+     than there are threads and submit the next one whenever a chunk has
+     been copied out. */
+  jobs_pool = svn_pool_create(pool);
+  SVN_ERR(svn_thread_pool__create(&thread_pool, max_threads, jobs_pool));
+  for (submitted = 0;
+       submitted < count && submitted <= max_threads && ! err;
+       submitted++)
+    err = svn_thread_pool__submit(&chunks[submitted].job, thread_pool,
+                                  dump_chunk, &chunks[submitted], jobs_pool);
+
+  /* Copy the chunks to their streams in revision order, as they become
+     available, so that the notifications are in the same order as for
+     a sequential dump. */
+  iterpool = svn_pool_create(pool);
+  for (i = 0; i < count && ! err; i++)
+    {
+      svn_stream_t *stream = APR_ARRAY_IDX(streams, i, svn_stream_t *);
+
+      svn_pool_clear(iterpool);
+      err = svn_thread_pool__wait(chunks[i].job);
+
+      if (chunks[i].notifications)
+        for (k = 0; k < chunks[i].notifications->nelts; k++)
+          notify_func(notify_baton,
+                      APR_ARRAY_IDX(chunks[i].notifications, k,
+                                    svn_repos_notify_t *),
+                      iterpool);
+
+      if (! err)
+        err = svn_stream_copy3(chunks[i].data,
+                               svn_stream_disown(stream, iterpool),
+                               cancel_func, cancel_baton, iterpool);
+
+      found_old_reference |= chunks[i].found_old_reference;
+      found_old_mergeinfo |= chunks[i].found_old_mergeinfo;
+
+      /* Release the dumped data early. */
+      svn_thread_pool__job_destroy(chunks[i].job);
+
+      if (submitted < count && ! err)
+        {
+          err = svn_thread_pool__submit(&chunks[submitted].job, thread_pool,
+                                        dump_chunk, &chunks[submitted],
+                                        jobs_pool);
+          submitted++;
         }
     }
+  svn_pool_destroy(iterpool);
 
-  svn_pool_destroy(subpool);
+  /* Wait for the remaining chunks before returning any error. */
+  svn_pool_destroy(jobs_pool);
+  SVN_ERR(err);
+
+  if (notify_func)
+    notify_dump_end(found_old_reference, found_old_mergeinfo,
+                    notify_func, notify_baton, pool);
 
   return SVN_NO_ERROR;
 }
@@ -1424,7 +1951,8 @@ svn_repos_verify_fs2(svn_repos_t *repos,
                               verify_close_directory,
                               notify_func, notify_baton,
                               start_rev,
-                              FALSE, TRUE, /* use_deltas, verify */
+                              FALSE, FALSE, TRUE, /* use_deltas,
+                                                     chunked_texts, verify */
                               iterpool));
       SVN_ERR(svn_delta_get_cancellation_editor(cancel_func, cancel_baton,
                                                 dump_editor, dump_edit_baton,
@@ -60,6 +60,12 @@ svn_repos_fs_commit_txn(const char **conflict_p,
   if (! SVN_IS_VALID_REVNUM(*new_rev))
     return err;
 
+  /* Keep the log index current.  Should this fail, the revision gets
+     added by the next commit, and readers walk the history of any
+     revisions not in the index, so don't fail the commit. */
+  svn_error_clear(svn_repos__log_index_update(repos, pool));
+  svn_error_clear(svn_repos__mergeinfo_index_update(repos, pool));
+
   /* Run post-commit hooks. */
   if ((err2 = svn_repos__hooks_post_commit(repos, *new_rev, txn_name, pool)))
     {
@@ -608,6 +614,81 @@ svn_repos_fs_get_locks2(apr_hash_t **locks,
 }
 
 
+/* Add the explicit mergeinfo of all nodes below PATHS in ROOT to
+   CATALOG, looking them up in INDEX.  Like svn_fs_get_mergeinfo2(),
+   silently skip invalid mergeinfo.  Set *CONSISTENT to FALSE if INDEX
+   turns out to disagree with ROOT, i.e. lists nodes that don't exist or
+   don't have mergeinfo, else to TRUE.  Allocate the new catalog entries
+   in RESULT_POOL.
+
+   Nodes with mergeinfo that INDEX does not list cannot be detected
+   without the very crawl that INDEX is meant to save.  They don't
+   happen as long as the index gets built from the same changed paths
+   that the filesystem reports. */
+static svn_error_t *
+add_indexed_descendant_mergeinfo(svn_boolean_t *consistent,
+                                 svn_mergeinfo_catalog_t catalog,
+                                 svn_repos__mergeinfo_index_t *index,
+                                 svn_fs_root_t *root,
+                                 const apr_array_header_t *paths,
+                                 apr_pool_t *result_pool,
+                                 apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  svn_revnum_t rev = svn_fs_revision_root_revision(root);
+  int i, j;
+
+  *consistent = TRUE;
+  for (i = 0; i < paths->nelts; i++)
+    {
+      const char *path = APR_ARRAY_IDX(paths, i, const char *);
+      apr_array_header_t *descendants;
+
+      SVN_ERR(svn_repos__mergeinfo_index_descendants(&descendants, index,
+                                                     path, rev, scratch_pool,
+                                                     scratch_pool));
+      for (j = 0; j < descendants->nelts; j++)
+        {
+          const char *kid_path = APR_ARRAY_IDX(descendants, j, const char *);
+          svn_string_t *mergeinfo_string;
+          svn_mergeinfo_t kid_mergeinfo;
+          svn_error_t *err;
+
+          svn_pool_clear(iterpool);
+          err = svn_fs_node_prop(&mergeinfo_string, root, kid_path,
+                                 SVN_PROP_MERGEINFO, iterpool);
+          if (err && (err->apr_err == SVN_ERR_FS_NOT_FOUND
+                      || err->apr_err == SVN_ERR_FS_NOT_DIRECTORY))
+            {
+              svn_error_clear(err);
+              mergeinfo_string = NULL;
+            }
+          else if (err)
+            return svn_error_trace(err);
+
+          if (!mergeinfo_string)
+            {
+              *consistent = FALSE;
+              svn_pool_destroy(iterpool);
+              return SVN_NO_ERROR;
+            }
+
+          err = svn_mergeinfo_parse(&kid_mergeinfo, mergeinfo_string->data,
+                                    result_pool);
+          if (err && err->apr_err == SVN_ERR_MERGEINFO_PARSE_ERROR)
+            svn_error_clear(err);
+          else if (err)
+            return svn_error_trace(err);
+          else
+            apr_hash_set(catalog, apr_pstrdup(result_pool, kid_path),
+                         APR_HASH_KEY_STRING, kid_mergeinfo);
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_repos_fs_get_mergeinfo(svn_mergeinfo_catalog_t *mergeinfo,
                            svn_repos_t *repos,
@@ -664,9 +745,43 @@ svn_repos_fs_get_mergeinfo(svn_mergeinfo_catalog_t *mergeinfo,
      us to protect the name of where a change was merged from, but not
      the change itself. */
   /* ### TODO(reint): ... but how about descendant merged-to paths? */
-  if (readable_paths->nelts > 0)
+  if (readable_paths->nelts > 0 && include_descendants)
+    {
+      svn_repos__mergeinfo_index_t *index;
+      svn_boolean_t consistent = FALSE;
+      svn_error_t *err;
+
+      /* The mergeinfo index knows which nodes below READABLE_PATHS carry
+         mergeinfo, so we don't have to crawl the trees to find them.
+         Unless it doesn't cover REV yet, that is. */
+      err = svn_repos__mergeinfo_index_open(&index, repos, pool, pool);
+      if (err)
+        {
+          svn_error_clear(err);
+          index = NULL;
+        }
+      else if (index && rev > svn_repos__mergeinfo_index_indexed_rev(index))
+        {
+          index = NULL;
+        }
+
+      if (index)
+        {
+          SVN_ERR(svn_fs_get_mergeinfo2(mergeinfo, root, readable_paths,
+                                        inherit, FALSE, TRUE, pool, pool));
+          SVN_ERR(add_indexed_descendant_mergeinfo(&consistent, *mergeinfo,
+                                                   index, root,
+                                                   readable_paths,
+                                                   pool, iterpool));
+        }
+
+      if (!consistent)
+        SVN_ERR(svn_fs_get_mergeinfo2(mergeinfo, root, readable_paths,
+                                      inherit, TRUE, TRUE, pool, pool));
+    }
+  else if (readable_paths->nelts > 0)
     SVN_ERR(svn_fs_get_mergeinfo2(mergeinfo, root, readable_paths, inherit,
-                                  include_descendants, TRUE, pool, pool));
+                                  FALSE, TRUE, pool, pool));
   else
     *mergeinfo = apr_hash_make(pool);
 
@@ -36,12 +36,19 @@
 #include "svn_subst.h"
 #include "svn_ctype.h"
 #include "svn_dirent_uri.h"
+#include "svn_cache_config.h"
 
 #include <apr_lib.h>
+#include <apr_thread_mutex.h>
+#include <apr_thread_cond.h>
 
 #include "private/svn_fspath.h"
 #include "private/svn_dep_compat.h"
 #include "private/svn_mergeinfo_private.h"
+#include "private/svn_mutex.h"
+#include "private/svn_repos_private.h"
+#include "private/svn_subr_private.h"
+#include "private/svn_thread_pool.h"
 
 /*----------------------------------------------------------------------*/
 
@@ -114,6 +121,10 @@ struct node_baton
   svn_revnum_t copyfrom_rev;
   const char *copyfrom_path;
 
+  /* The revision in this fs that COPYFROM_PATH has actually been copied
+     from, once that happened. */
+  svn_revnum_t copy_source_rev;
+
   struct revision_baton *rb;
   apr_pool_t *pool;
 };
@@ -400,6 +411,7 @@ make_node_baton(struct node_baton **node_baton_p,
     }
 
   nb->copyfrom_rev = SVN_INVALID_REVNUM;
+  nb->copy_source_rev = SVN_INVALID_REVNUM;
   if ((val = apr_hash_get(headers, SVN_REPOS_DUMPFILE_NODE_COPYFROM_REV,
                           APR_HASH_KEY_STRING)))
     {
@@ -578,6 +590,7 @@ maybe_add_with_history(struct node_baton *nb,
 
       SVN_ERR(svn_fs_copy(copy_root, nb->copyfrom_path,
                           rb->txn_root, nb->path, pool));
+      nb->copy_source_rev = copyfrom_rev;
 
       if (pb->notify_func)
         {
@@ -957,6 +970,10 @@ close_revision(void *baton)
         return svn_error_trace(err);
     }
 
+  /* Keep the indexes current, as svn_repos_fs_commit_txn() does. */
+  svn_error_clear(svn_repos__log_index_update(pb->repos, rb->pool));
+  svn_error_clear(svn_repos__mergeinfo_index_update(pb->repos, rb->pool));
+
   /* Run post-commit hook, if so commanded.  */
   if (pb->use_post_commit_hook)
     {
@@ -1017,6 +1034,1041 @@ close_revision(void *baton)
 }
 
 
+/*----------------------------------------------------------------------*/
+
+/** Pipelined loading **/
+
+/* svn_repos__load_fs_pipelined() distributes the work of the loader
+   between three kinds of threads:
+
+   - A parser thread reads the dump stream, computes the checksums of
+     fulltexts and queues the records it finds, with their texts spooled
+     into spill buffers.
+
+   - Worker threads reconstruct the fulltexts of nodes that have been
+     dumped as deltas against committed revisions and verify their base
+     and result checksums.  They read from private FS instances.
+
+   - The calling thread takes the records from the queue and applies
+     them to the transactions in dump stream order using the functions
+     of the sequential loader above.  It writes the reconstructed texts
+     in node order and commits the revisions.
+
+   Deltas against nodes that have been changed earlier in the same
+   revision are applied in the calling thread, just like without
+   pipelining. */
+
+#if APR_HAS_THREADS
+
+/* Maximum number of parsed records waiting for the calling thread. */
+#define LOAD_QUEUE_DEPTH 64
+
+/* Maximum number of pending text reconstructions per worker thread. */
+#define LOAD_PENDING_PER_THREAD 4
+
+/* Texts larger than this get spooled to temporary files. */
+#define LOAD_SPILL_SIZE (1024 * 1024)
+
+/* The kinds of records queued by the parser thread.  They correspond to
+   the callbacks in svn_repos_parse_fns3_t. */
+typedef enum load_record_kind_t
+{
+  load_record_magic_header,
+  load_record_uuid,
+  load_record_revision,
+  load_record_node,
+  load_record_close_revision
+} load_record_kind_t;
+
+/* A property change read from the dump stream. */
+typedef struct load_prop_t
+{
+  const char *name;
+
+  /* NULL if the property gets deleted. */
+  const svn_string_t *value;
+} load_prop_t;
+
+/* A record read from the dump stream by the parser thread. */
+typedef struct load_record_t
+{
+  load_record_kind_t kind;
+
+  /* The dump format version of a magic header record. */
+  int version;
+
+  /* The UUID of a UUID record. */
+  const char *uuid;
+
+  /* The headers of revision and node records. */
+  apr_hash_t *headers;
+
+  /* Whether all node properties shall be removed before applying PROPS
+     and the property changes (load_prop_t) themselves. */
+  svn_boolean_t remove_props;
+  apr_array_header_t *props;
+
+  /* The spooled text of a node or NULL if there is none.  TEXT_IS_DELTA
+     tells whether it is in svndiff format.  The MD5 checksum of fulltexts
+     gets set once the parser closes the text. */
+  svn_stream_t *text;
+  svn_boolean_t text_is_delta;
+  svn_checksum_t *text_md5;
+
+  /* Next record in the queue. */
+  struct load_record_t *next;
+
+  /* Root pool that contains everything above.  It gets created by the
+     parser thread and destroyed by the calling thread. */
+  apr_pool_t *pool;
+} load_record_t;
+
+/* A text that is being reconstructed by a worker thread. */
+typedef struct load_text_t
+{
+  /* The node in the transaction to write the text to. */
+  svn_fs_root_t *txn_root;
+  const char *path;
+
+  /* The committed node that DELTA is based upon.  BASE_PATH is NULL
+     for the empty base. */
+  svn_revnum_t base_rev;
+  const char *base_path;
+
+  /* The expected checksums as given in the dump stream, if any. */
+  svn_checksum_t *base_checksum;
+  svn_checksum_t *result_checksum;
+
+  /* The spooled svndiff data, living in the pool of its record. */
+  svn_stream_t *delta;
+
+  /* The reconstructed fulltext, allocated in the result pool of JOB. */
+  svn_stream_t *fulltext;
+
+  /* The background job and the pipeline that it belongs to. */
+  svn_thread_pool__job_t *job;
+  struct load_pipeline_t *pipeline;
+
+  /* Next text in node order. */
+  struct load_text_t *next;
+
+  /* Everything above as well as JOB live in this pool. */
+  apr_pool_t *pool;
+} load_text_t;
+
+/* Connects the parser thread, the worker threads and the calling thread
+   of a pipelined load. */
+typedef struct load_pipeline_t
+{
+  /* The sequential loader whose functions apply the records. */
+  struct parse_baton *pb;
+
+  /* The stream being parsed by the parser thread. */
+  svn_stream_t *dumpstream;
+
+  /* Runs the parser and the text reconstructions. */
+  svn_thread_pool__t *thread_pool;
+  svn_thread_pool__job_t *parser_job;
+
+  /* The record currently being built by the parser thread. */
+  load_record_t *current;
+
+  /* FIFO of parsed records and its length, guarded by MUTEX.  CHANGED
+     gets signaled whenever records have been added or removed.  PARSED
+     gets set once the parser thread won't queue further records and
+     ABORTED once the calling thread won't take any more. */
+  apr_thread_mutex_t *mutex;
+  apr_thread_cond_t *changed;
+  load_record_t *first;
+  load_record_t *last;
+  int queued;
+  svn_boolean_t parsed;
+  svn_boolean_t aborted;
+
+  /* The record most recently taken from the queue.  It gets destroyed
+     when the next one is being taken. */
+  load_record_t *taken;
+
+  /* Idle worker FS instances (svn_fs_t *), guarded by FS_MUTEX, and the
+     root pools of all worker FS instances. */
+  apr_array_header_t *idle_fs;
+  svn_mutex__t *fs_mutex;
+  apr_array_header_t *fs_pools;
+
+  /* Texts being reconstructed, in node order, their number and its upper
+     limit.  PENDING_PATHS maps their paths to the load_text_t. */
+  load_text_t *first_text;
+  load_text_t *last_text;
+  int pending;
+  int max_pending;
+  apr_hash_t *pending_paths;
+
+  apr_pool_t *pool;
+} load_pipeline_t;
+
+/* Pool cleanup function destroying the root pool in BATON. */
+static apr_status_t
+destroy_root_pool(void *baton)
+{
+  svn_pool_destroy(baton);
+
+  return APR_SUCCESS;
+}
+
+
+/*** The parser thread. ***/
+
+/* Append the record that the parser thread of PIPELINE is building to
+   the queue, waiting for the calling thread to make room if necessary.
+   Return SVN_ERR_CANCELLED if the calling thread gave up. */
+static svn_error_t *
+queue_current_record(load_pipeline_t *pipeline)
+{
+  load_record_t *record = pipeline->current;
+  svn_boolean_t aborted;
+
+  if (record == NULL)
+    return SVN_NO_ERROR;
+
+  pipeline->current = NULL;
+
+  apr_thread_mutex_lock(pipeline->mutex);
+  while (pipeline->queued >= LOAD_QUEUE_DEPTH && ! pipeline->aborted)
+    apr_thread_cond_wait(pipeline->changed, pipeline->mutex);
+
+  aborted = pipeline->aborted;
+  if (! aborted)
+    {
+      if (pipeline->last)
+        pipeline->last->next = record;
+      else
+        pipeline->first = record;
+      pipeline->last = record;
+      pipeline->queued++;
+      apr_thread_cond_broadcast(pipeline->changed);
+    }
+  apr_thread_mutex_unlock(pipeline->mutex);
+
+  if (aborted)
+    {
+      svn_pool_destroy(record->pool);
+      return svn_error_create(SVN_ERR_CANCELLED, NULL, NULL);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Queue the previous record of PIPELINE, if any, and start building a
+   new record of KIND in *RECORD. */
+static svn_error_t *
+begin_record(load_record_t **record,
+             load_pipeline_t *pipeline,
+             load_record_kind_t kind)
+{
+  apr_pool_t *pool;
+  load_record_t *new_record;
+
+  SVN_ERR(queue_current_record(pipeline));
+
+  /* The record will be destroyed by another thread. */
+  pool = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+  new_record = apr_pcalloc(pool, sizeof(*new_record));
+  new_record->kind = kind;
+  new_record->props = apr_array_make(pool, 4, sizeof(load_prop_t));
+  new_record->pool = pool;
+
+  pipeline->current = new_record;
+  *record = new_record;
+
+  return SVN_NO_ERROR;
+}
+
+/* Return a deep copy of the dump stream HEADERS allocated in POOL. */
+static apr_hash_t *
+copy_headers(apr_hash_t *headers,
+             apr_pool_t *pool)
+{
+  apr_hash_t *copy = apr_hash_make(pool);
+  apr_hash_index_t *hi;
+
+  for (hi = apr_hash_first(pool, headers); hi; hi = apr_hash_next(hi))
+    apr_hash_set(copy, apr_pstrdup(pool, svn__apr_hash_index_key(hi)),
+                 APR_HASH_KEY_STRING,
+                 apr_pstrdup(pool, svn__apr_hash_index_val(hi)));
+
+  return copy;
+}
+
+/* Add the change of property NAME to VALUE, NULL for deletions, to the
+   record that the parser thread of PIPELINE is building. */
+static svn_error_t *
+record_prop(load_pipeline_t *pipeline,
+            const char *name,
+            const svn_string_t *value)
+{
+  load_record_t *record = pipeline->current;
+  load_prop_t *prop = apr_array_push(record->props);
+
+  prop->name = apr_pstrdup(record->pool, name);
+  prop->value = value ? svn_string_dup(value, record->pool) : NULL;
+
+  return SVN_NO_ERROR;
+}
+
+/* The svn_repos_parse_fns3_t implementation of the parser thread.  All
+   batons are the load_pipeline_t. */
+
+static svn_error_t *
+record_magic_header(int version,
+                    void *parse_baton,
+                    apr_pool_t *pool)
+{
+  load_record_t *record;
+
+  SVN_ERR(begin_record(&record, parse_baton, load_record_magic_header));
+  record->version = version;
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+record_uuid(const char *uuid,
+            void *parse_baton,
+            apr_pool_t *pool)
+{
+  load_record_t *record;
+
+  SVN_ERR(begin_record(&record, parse_baton, load_record_uuid));
+  record->uuid = apr_pstrdup(record->pool, uuid);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+record_new_revision(void **revision_baton,
+                    apr_hash_t *headers,
+                    void *parse_baton,
+                    apr_pool_t *pool)
+{
+  load_record_t *record;
+
+  SVN_ERR(begin_record(&record, parse_baton, load_record_revision));
+  record->headers = copy_headers(headers, record->pool);
+
+  *revision_baton = parse_baton;
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+record_new_node(void **node_baton,
+                apr_hash_t *headers,
+                void *revision_baton,
+                apr_pool_t *pool)
+{
+  load_record_t *record;
+
+  SVN_ERR(begin_record(&record, revision_baton, load_record_node));
+  record->headers = copy_headers(headers, record->pool);
+
+  *node_baton = revision_baton;
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+record_set_revision_property(void *baton,
+                             const char *name,
+                             const svn_string_t *value)
+{
+  return svn_error_trace(record_prop(baton, name, value));
+}
+
+static svn_error_t *
+record_set_node_property(void *baton,
+                         const char *name,
+                         const svn_string_t *value)
+{
+  return svn_error_trace(record_prop(baton, name, value));
+}
+
+static svn_error_t *
+record_delete_node_property(void *baton,
+                            const char *name)
+{
+  return svn_error_trace(record_prop(baton, name, NULL));
+}
+
+static svn_error_t *
+record_remove_node_props(void *baton)
+{
+  load_pipeline_t *pipeline = baton;
+
+  pipeline->current->remove_props = TRUE;
+
+  return SVN_NO_ERROR;
+}
+
+/* The dump stream gets parsed with DELTAS_ARE_TEXT set, so this receives
+   the svndiff data of deltas, too. */
+static svn_error_t *
+record_set_fulltext(svn_stream_t **stream,
+                    void *node_baton)
+{
+  load_pipeline_t *pipeline = node_baton;
+  load_record_t *record = pipeline->current;
+  const char *delta = apr_hash_get(record->headers,
+                                   SVN_REPOS_DUMPFILE_TEXT_DELTA,
+                                   APR_HASH_KEY_STRING);
+
+  record->text_is_delta = (delta && strcmp(delta, "true") == 0);
+  record->text = svn_stream__from_spillbuf(SVN__STREAM_CHUNK_SIZE,
+                                           LOAD_SPILL_SIZE, record->pool);
+
+  if (record->text_is_delta)
+    *stream = record->text;
+  else
+    *stream = svn_stream_checksummed2(record->text, NULL, &record->text_md5,
+                                      svn_checksum_md5, FALSE,
+                                      record->pool);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+record_close_node(void *baton)
+{
+  return svn_error_trace(queue_current_record(baton));
+}
+
+static svn_error_t *
+record_close_revision(void *baton)
+{
+  load_record_t *record;
+
+  SVN_ERR(begin_record(&record, baton, load_record_close_revision));
+
+  return svn_error_trace(queue_current_record(baton));
+}
+
+static const svn_repos_parse_fns3_t record_fns =
+{
+  record_magic_header,
+  record_uuid,
+  record_new_revision,
+  record_new_node,
+  record_set_revision_property,
+  record_set_node_property,
+  record_delete_node_property,
+  record_remove_node_props,
+  record_set_fulltext,
+  NULL, /* never called with DELTAS_ARE_TEXT */
+  record_close_node,
+  record_close_revision
+};
+
+/* Implements svn_cancel_func_t.  Stop parsing once the calling thread of
+   the load_pipeline_t in BATON gave up. */
+static svn_error_t *
+check_aborted(void *baton)
+{
+  load_pipeline_t *pipeline = baton;
+  svn_boolean_t aborted;
+
+  apr_thread_mutex_lock(pipeline->mutex);
+  aborted = pipeline->aborted;
+  apr_thread_mutex_unlock(pipeline->mutex);
+
+  return aborted ? svn_error_create(SVN_ERR_CANCELLED, NULL, NULL)
+                 : SVN_NO_ERROR;
+}
+
+/* Implements svn_thread_pool__task_t.  Parse the dump stream of the
+   load_pipeline_t in BATON and queue its records. */
+static svn_error_t *
+parse_records(void *baton,
+              apr_pool_t *result_pool,
+              apr_pool_t *scratch_pool)
+{
+  load_pipeline_t *pipeline = baton;
+  svn_error_t *err;
+
+  err = svn_repos_parse_dumpstream3(pipeline->dumpstream, &record_fns,
+                                    pipeline, TRUE, check_aborted, pipeline,
+                                    scratch_pool);
+  if (! err)
+    err = queue_current_record(pipeline);
+
+  /* Drop any incomplete record. */
+  if (pipeline->current)
+    {
+      svn_pool_destroy(pipeline->current->pool);
+      pipeline->current = NULL;
+    }
+
+  apr_thread_mutex_lock(pipeline->mutex);
+  pipeline->parsed = TRUE;
+  apr_thread_cond_broadcast(pipeline->changed);
+  apr_thread_mutex_unlock(pipeline->mutex);
+
+  return svn_error_trace(err);
+}
+
+
+/*** The worker threads. ***/
+
+/* Remove an idle worker FS from PIPELINE and return it in *FS.
+   To be called with the FS mutex held. */
+static svn_error_t *
+acquire_worker_fs(svn_fs_t **fs,
+                  load_pipeline_t *pipeline)
+{
+  /* There are as many FS instances as worker threads. */
+  SVN_ERR_ASSERT(pipeline->idle_fs->nelts > 0);
+  *fs = *(svn_fs_t **)apr_array_pop(pipeline->idle_fs);
+
+  return SVN_NO_ERROR;
+}
+
+/* Return FS to the idle worker FS instances of PIPELINE.
+   To be called with the FS mutex held. */
+static svn_error_t *
+release_worker_fs(load_pipeline_t *pipeline,
+                  svn_fs_t *fs)
+{
+  APR_ARRAY_PUSH(pipeline->idle_fs, svn_fs_t *) = fs;
+
+  return SVN_NO_ERROR;
+}
+
+/* Apply the delta of TEXT to its base as found in FS and store the result
+   in a new stream in TEXT, allocated in RESULT_POOL.  Verify the checksums
+   given for the base and the result.  Use SCRATCH_POOL for temporary
+   allocations. */
+static svn_error_t *
+reconstruct_fulltext(load_text_t *text,
+                     svn_fs_t *fs,
+                     apr_pool_t *result_pool,
+                     apr_pool_t *scratch_pool)
+{
+  svn_stream_t *source;
+  svn_checksum_t *checksum;
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+  unsigned char digest[APR_MD5_DIGESTSIZE];
+
+  if (text->base_path)
+    {
+      svn_fs_root_t *root;
+
+      SVN_ERR(svn_fs_revision_root(&root, fs, text->base_rev, scratch_pool));
+      SVN_ERR(svn_fs_file_checksum(&checksum, svn_checksum_md5, root,
+                                   text->base_path, TRUE, scratch_pool));
+      SVN_ERR(svn_fs_file_contents(&source, root, text->base_path,
+                                   scratch_pool));
+    }
+  else
+    {
+      checksum = svn_checksum_empty_checksum(svn_checksum_md5, scratch_pool);
+      source = svn_stream_empty(scratch_pool);
+    }
+
+  if (! svn_checksum_match(text->base_checksum, checksum))
+    return svn_checksum_mismatch_err(text->base_checksum, checksum,
+                                     scratch_pool,
+                                     _("Base checksum mismatch on '%s'"),
+                                     text->path);
+
+  text->fulltext = svn_stream__from_spillbuf(SVN__STREAM_CHUNK_SIZE,
+                                             LOAD_SPILL_SIZE, result_pool);
+  svn_txdelta_apply(source, text->fulltext, digest, text->path,
+                    scratch_pool, &handler, &handler_baton);
+  SVN_ERR(svn_stream_copy3(text->delta,
+                           svn_txdelta_parse_svndiff(handler, handler_baton,
+                                                     TRUE, scratch_pool),
+                           NULL, NULL, scratch_pool));
+
+  checksum = svn_checksum__from_digest_md5(digest, scratch_pool);
+  if (! svn_checksum_match(text->result_checksum, checksum))
+    return svn_checksum_mismatch_err(text->result_checksum, checksum,
+                                     scratch_pool,
+                                     _("Checksum mismatch for '%s'"),
+                                     text->path);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_thread_pool__task_t.  Reconstruct the fulltext of the
+   load_text_t in BATON using one of the worker FS instances. */
+static svn_error_t *
+reconstruct_text(void *baton,
+                 apr_pool_t *result_pool,
+                 apr_pool_t *scratch_pool)
+{
+  load_text_t *text = baton;
+  load_pipeline_t *pipeline = text->pipeline;
+  apr_pool_t *fs_scratch_pool = svn_pool_create(scratch_pool);
+  svn_fs_t *fs;
+  svn_error_t *err;
+
+  SVN_MUTEX__WITH_LOCK(pipeline->fs_mutex,
+                       acquire_worker_fs(&fs, pipeline));
+
+  err = reconstruct_fulltext(text, fs, result_pool, fs_scratch_pool);
+
+  /* Don't keep anything referring to FS once it may be used by others. */
+  svn_pool_destroy(fs_scratch_pool);
+
+  SVN_MUTEX__WITH_LOCK(pipeline->fs_mutex,
+                       release_worker_fs(pipeline, fs));
+
+  return svn_error_trace(err);
+}
+
+
+/*** The calling thread. ***/
+
+/* Remove the oldest record from the queue of PIPELINE, waiting for the
+   parser thread if necessary, and return it in *RECORD.  Set *RECORD to
+   NULL and return the parser's error, if any, at the end of the stream.
+   *RECORD remains valid until the next call to this function. */
+static svn_error_t *
+take_record(load_record_t **record,
+            load_pipeline_t *pipeline)
+{
+  if (pipeline->taken)
+    {
+      svn_pool_destroy(pipeline->taken->pool);
+      pipeline->taken = NULL;
+    }
+
+  apr_thread_mutex_lock(pipeline->mutex);
+  while (pipeline->first == NULL && ! pipeline->parsed)
+    apr_thread_cond_wait(pipeline->changed, pipeline->mutex);
+
+  *record = pipeline->first;
+  if (*record)
+    {
+      pipeline->first = (*record)->next;
+      if (pipeline->first == NULL)
+        pipeline->last = NULL;
+      pipeline->queued--;
+      apr_thread_cond_broadcast(pipeline->changed);
+    }
+  apr_thread_mutex_unlock(pipeline->mutex);
+
+  if (*record == NULL)
+    return svn_error_trace(svn_thread_pool__wait(pipeline->parser_job));
+
+  pipeline->taken = *record;
+  return SVN_NO_ERROR;
+}
+
+/* Wait for the oldest pending text of PIPELINE to be reconstructed and
+   write it to its transaction. */
+static svn_error_t *
+write_oldest_text(load_pipeline_t *pipeline)
+{
+  load_text_t *text = pipeline->first_text;
+  svn_stream_t *stream;
+  svn_error_t *err;
+
+  pipeline->first_text = text->next;
+  if (pipeline->first_text == NULL)
+    pipeline->last_text = NULL;
+  pipeline->pending--;
+  apr_hash_set(pipeline->pending_paths, text->path, APR_HASH_KEY_STRING,
+               NULL);
+
+  /* The checksum has already been verified. */
+  err = svn_thread_pool__wait(text->job);
+  if (! err)
+    err = svn_fs_apply_text(&stream, text->txn_root, text->path, NULL,
+                            text->pool);
+  if (! err)
+    err = svn_stream_copy3(text->fulltext, stream, NULL, NULL, text->pool);
+
+  svn_pool_destroy(text->pool);
+
+  return svn_error_trace(err);
+}
+
+/* Write pending texts of PIPELINE in node order until no more than
+   MAX_PENDING remain. */
+static svn_error_t *
+write_pending_texts(load_pipeline_t *pipeline,
+                    int max_pending)
+{
+  while (pipeline->pending > max_pending)
+    SVN_ERR(write_oldest_text(pipeline));
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *BASE_REV and *BASE_PATH to the committed node that a delta for the
+   text of the node in NB is based upon, with *BASE_PATH set to NULL for
+   the empty base.  Set *FOUND to FALSE if there is no such node because
+   the node has already been changed within the current transaction.
+
+   To be called after new_node_record() but before changing the node. */
+static svn_error_t *
+find_delta_base(svn_boolean_t *found,
+                svn_revnum_t *base_rev,
+                const char **base_path,
+                struct node_baton *nb,
+                apr_pool_t *pool)
+{
+  struct revision_baton *rb = nb->rb;
+
+  *found = TRUE;
+  *base_rev = SVN_INVALID_REVNUM;
+  *base_path = NULL;
+
+  if (nb->action == svn_node_action_add
+      || nb->action == svn_node_action_replace)
+    {
+      /* Either a copy or an empty file, see maybe_add_with_history(). */
+      if (SVN_IS_VALID_REVNUM(nb->copy_source_rev))
+        {
+          *base_rev = nb->copy_source_rev;
+          *base_path = nb->copyfrom_path;
+        }
+
+      return SVN_NO_ERROR;
+    }
+
+  /* Nodes that haven't been touched in this transaction yet are
+     identical to those that they were committed as. */
+  SVN_ERR(svn_fs_node_created_rev(base_rev, rb->txn_root, nb->path, pool));
+  if (SVN_IS_VALID_REVNUM(*base_rev))
+    SVN_ERR(svn_fs_node_created_path(base_path, rb->txn_root, nb->path,
+                                     pool));
+  else
+    *found = FALSE;
+
+  return SVN_NO_ERROR;
+}
+
+/* Queue the delta text of RECORD for the node in NB for reconstruction
+   against the base found by find_delta_base() in PIPELINE.  Take over the
+   ownership of RECORD. */
+static svn_error_t *
+queue_text(load_pipeline_t *pipeline,
+           load_record_t *record,
+           struct node_baton *nb,
+           svn_revnum_t base_rev,
+           const char *base_path)
+{
+  apr_pool_t *pool;
+  load_text_t *text;
+
+  SVN_ERR(write_pending_texts(pipeline, pipeline->max_pending - 1));
+
+  pool = svn_pool_create(pipeline->pool);
+  text = apr_pcalloc(pool, sizeof(*text));
+  text->txn_root = nb->rb->txn_root;
+  text->path = apr_pstrdup(pool, nb->path);
+  text->base_rev = base_rev;
+  text->base_path = base_path ? apr_pstrdup(pool, base_path) : NULL;
+  text->base_checksum = svn_checksum_dup(nb->base_checksum, pool);
+  text->result_checksum = svn_checksum_dup(nb->result_checksum, pool);
+  text->delta = record->text;
+  text->pipeline = pipeline;
+  text->pool = pool;
+
+  /* Registered before the job, so this runs after the job has finished. */
+  SVN_ERR_ASSERT(pipeline->taken == record);
+  pipeline->taken = NULL;
+  apr_pool_cleanup_register(pool, record->pool, destroy_root_pool,
+                            apr_pool_cleanup_null);
+
+  SVN_ERR(svn_thread_pool__submit(&text->job, pipeline->thread_pool,
+                                  reconstruct_text, text, pool));
+
+  if (pipeline->last_text)
+    pipeline->last_text->next = text;
+  else
+    pipeline->first_text = text;
+  pipeline->last_text = text;
+  pipeline->pending++;
+  apr_hash_set(pipeline->pending_paths, text->path, APR_HASH_KEY_STRING,
+               text);
+
+  return SVN_NO_ERROR;
+}
+
+/* Apply the node RECORD to the revision in RB using the sequential loader
+   of PIPELINE.  Use POOL for the node baton. */
+static svn_error_t *
+apply_node_record(load_pipeline_t *pipeline,
+                  load_record_t *record,
+                  struct revision_baton *rb,
+                  apr_pool_t *pool)
+{
+  const char *action = apr_hash_get(record->headers,
+                                    SVN_REPOS_DUMPFILE_NODE_ACTION,
+                                    APR_HASH_KEY_STRING);
+  svn_boolean_t has_text = record->text && ! rb->skipped;
+  svn_boolean_t base_found = FALSE;
+  svn_revnum_t base_rev = SVN_INVALID_REVNUM;
+  const char *base_path = NULL;
+  struct node_baton *nb;
+  void *node_baton;
+  int i;
+
+  /* Deletions must not affect paths with pending texts. */
+  if (action && (! strcmp(action, "delete") || ! strcmp(action, "replace")))
+    SVN_ERR(write_pending_texts(pipeline, 0));
+
+  SVN_ERR(new_node_record(&node_baton, record->headers, rb, pool));
+  nb = node_baton;
+
+  if (has_text
+      && apr_hash_get(pipeline->pending_paths, nb->path, APR_HASH_KEY_STRING))
+    SVN_ERR(write_pending_texts(pipeline, 0));
+
+  if (has_text && record->text_is_delta)
+    SVN_ERR(find_delta_base(&base_found, &base_rev, &base_path, nb, pool));
+
+  if (record->remove_props)
+    SVN_ERR(remove_node_props(nb));
+
+  for (i = 0; i < record->props->nelts; i++)
+    {
+      const load_prop_t *prop = &APR_ARRAY_IDX(record->props, i,
+                                               load_prop_t);
+
+      if (prop->value)
+        SVN_ERR(set_node_property(nb, prop->name, prop->value));
+      else
+        SVN_ERR(delete_node_property(nb, prop->name));
+    }
+
+  if (has_text && base_found)
+    {
+      SVN_ERR(queue_text(pipeline, record, nb, base_rev, base_path));
+    }
+  else if (has_text && record->text_is_delta)
+    {
+      svn_txdelta_window_handler_t handler;
+      void *handler_baton;
+
+      SVN_ERR(apply_textdelta(&handler, &handler_baton, nb));
+      SVN_ERR(svn_stream_copy3(record->text,
+                               svn_txdelta_parse_svndiff(handler,
+                                                         handler_baton,
+                                                         TRUE, pool),
+                               NULL, NULL, pool));
+    }
+  else if (has_text)
+    {
+      svn_stream_t *stream;
+
+      /* The parser thread has calculated the checksum. */
+      if (! svn_checksum_match(nb->result_checksum, record->text_md5))
+        return svn_checksum_mismatch_err(nb->result_checksum,
+                                         record->text_md5, pool,
+                                         _("Checksum mismatch for '%s'"),
+                                         nb->path);
+
+      SVN_ERR(svn_fs_apply_text(&stream, rb->txn_root, nb->path, NULL,
+                                pool));
+      SVN_ERR(svn_stream_copy3(record->text, stream, NULL, NULL, pool));
+    }
+
+  return svn_error_trace(close_node(nb));
+}
+
+/* Take the records from the queue of PIPELINE and apply them using its
+   sequential loader.  CANCEL_FUNC and CANCEL_BATON are as for
+   svn_repos_parse_dumpstream3().  Use POOL for temporary allocations. */
+static svn_error_t *
+apply_records(load_pipeline_t *pipeline,
+              svn_cancel_func_t cancel_func,
+              void *cancel_baton,
+              apr_pool_t *pool)
+{
+  struct parse_baton *pb = pipeline->pb;
+  struct revision_baton *rb = NULL;
+  apr_pool_t *revpool = svn_pool_create(pool);
+  apr_pool_t *nodepool = svn_pool_create(pool);
+  load_record_t *record;
+  int i;
+
+  while (TRUE)
+    {
+      if (cancel_func)
+        SVN_ERR(cancel_func(cancel_baton));
+
+      SVN_ERR(take_record(&record, pipeline));
+      if (record == NULL)
+        break;
+
+      switch (record->kind)
+        {
+        case load_record_magic_header:
+          SVN_ERR(magic_header_record(record->version, pb, pool));
+          break;
+
+        case load_record_uuid:
+          SVN_ERR(uuid_record(record->uuid, pb, pool));
+          break;
+
+        case load_record_revision:
+          {
+            void *revision_baton;
+
+            SVN_ERR(new_revision_record(&revision_baton, record->headers,
+                                        pb, revpool));
+            rb = revision_baton;
+            for (i = 0; i < record->props->nelts; i++)
+              {
+                const load_prop_t *prop = &APR_ARRAY_IDX(record->props, i,
+                                                         load_prop_t);
+
+                SVN_ERR(set_revision_property(rb, prop->name,
+                                              prop->value));
+              }
+          }
+          break;
+
+        case load_record_node:
+          if (rb == NULL)
+            return svn_error_create(SVN_ERR_STREAM_MALFORMED_DATA, NULL,
+                                    _("Dumpstream data appears to be "
+                                      "malformed"));
+
+          SVN_ERR(apply_node_record(pipeline, record, rb, nodepool));
+          svn_pool_clear(nodepool);
+          break;
+
+        case load_record_close_revision:
+          SVN_ERR(write_pending_texts(pipeline, 0));
+          SVN_ERR(close_revision(rb));
+          svn_pool_clear(revpool);
+          rb = NULL;
+          break;
+        }
+    }
+
+  svn_pool_destroy(nodepool);
+  svn_pool_destroy(revpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Pool cleanup function telling the parser thread of the load_pipeline_t
+   in BATON that no further records will be taken. */
+static apr_status_t
+abort_parser(void *baton)
+{
+  load_pipeline_t *pipeline = baton;
+
+  apr_thread_mutex_lock(pipeline->mutex);
+  pipeline->aborted = TRUE;
+  apr_thread_cond_broadcast(pipeline->changed);
+  apr_thread_mutex_unlock(pipeline->mutex);
+
+  return APR_SUCCESS;
+}
+
+/* Pool cleanup function destroying the records left in the load_pipeline_t
+   in BATON after the parser thread has finished, and its worker FS
+   instances. */
+static apr_status_t
+destroy_pipeline(void *baton)
+{
+  load_pipeline_t *pipeline = baton;
+  int i;
+
+  while (pipeline->first)
+    {
+      load_record_t *record = pipeline->first;
+
+      pipeline->first = record->next;
+      svn_pool_destroy(record->pool);
+    }
+
+  if (pipeline->taken)
+    svn_pool_destroy(pipeline->taken->pool);
+
+  for (i = 0; i < pipeline->fs_pools->nelts; i++)
+    svn_pool_destroy(APR_ARRAY_IDX(pipeline->fs_pools, i, apr_pool_t *));
+
+  return APR_SUCCESS;
+}
+
+/* Load DUMPSTREAM using the sequential loader PB and MAX_THREADS threads,
+   one of which parses the stream.  The worker FS instances will be opened
+   from FS_PATH with FS_CONFIG.  CANCEL_FUNC and CANCEL_BATON are as for
+   svn_repos_parse_dumpstream3().
+
+   All threads will be finished when POOL gets cleaned up. */
+static svn_error_t *
+load_pipelined(struct parse_baton *pb,
+               svn_stream_t *dumpstream,
+               const char *fs_path,
+               apr_hash_t *fs_config,
+               int max_threads,
+               svn_cancel_func_t cancel_func,
+               void *cancel_baton,
+               apr_pool_t *pool)
+{
+  load_pipeline_t *pipeline = apr_pcalloc(pool, sizeof(*pipeline));
+  apr_status_t status;
+  int i;
+
+  pipeline->pb = pb;
+  pipeline->dumpstream = dumpstream;
+  pipeline->max_pending = (max_threads - 1) * LOAD_PENDING_PER_THREAD;
+  pipeline->pending_paths = apr_hash_make(pool);
+  pipeline->idle_fs = apr_array_make(pool, max_threads, sizeof(svn_fs_t *));
+  pipeline->fs_pools = apr_array_make(pool, max_threads,
+                                      sizeof(apr_pool_t *));
+  pipeline->pool = pool;
+
+  status = apr_thread_mutex_create(&pipeline->mutex,
+                                   APR_THREAD_MUTEX_DEFAULT, pool);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't create mutex"));
+
+  status = apr_thread_cond_create(&pipeline->changed, pool);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't create condition variable"));
+
+  SVN_ERR(svn_mutex__init(&pipeline->fs_mutex, TRUE, pool));
+  SVN_ERR(svn_thread_pool__create(&pipeline->thread_pool, max_threads,
+                                  pool));
+
+  /* Runs after the parser job has finished. */
+  apr_pool_cleanup_register(pool, pipeline, destroy_pipeline,
+                            apr_pool_cleanup_null);
+
+  /* The parser thread does not need an FS instance. */
+  for (i = 1; i < max_threads; i++)
+    {
+      apr_pool_t *fs_pool
+        = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+      svn_fs_t *fs;
+
+      APR_ARRAY_PUSH(pipeline->fs_pools, apr_pool_t *) = fs_pool;
+      SVN_ERR(svn_fs_open(&fs, fs_path, fs_config, fs_pool));
+      APR_ARRAY_PUSH(pipeline->idle_fs, svn_fs_t *) = fs;
+    }
+
+  SVN_ERR(svn_thread_pool__submit(&pipeline->parser_job,
+                                  pipeline->thread_pool, parse_records,
+                                  pipeline, pool));
+
+  /* Runs before we wait for the parser job. */
+  apr_pool_cleanup_register(pool, pipeline, abort_parser,
+                            apr_pool_cleanup_null);
+
+  return svn_error_trace(apply_records(pipeline, cancel_func, cancel_baton,
+                                       pool));
+}
+
+#endif /* APR_HAS_THREADS */
+
+
 /*----------------------------------------------------------------------*/
 
 /** The public routines **/
@@ -1086,27 +2138,27 @@ svn_repos_get_fs_build_parser4(const svn_repos_parse_fns3_t **callbacks,
 
 
 svn_error_t *
-svn_repos_load_fs4(svn_repos_t *repos,
-                   svn_stream_t *dumpstream,
-                   svn_revnum_t start_rev,
-                   svn_revnum_t end_rev,
-                   enum svn_repos_load_uuid uuid_action,
-                   const char *parent_dir,
-                   svn_boolean_t use_pre_commit_hook,
-                   svn_boolean_t use_post_commit_hook,
-                   svn_boolean_t validate_props,
-                   svn_repos_notify_func_t notify_func,
-                   void *notify_baton,
-                   svn_cancel_func_t cancel_func,
-                   void *cancel_baton,
-                   apr_pool_t *pool)
+svn_repos__load_fs_pipelined(svn_repos_t *repos,
+                             svn_stream_t *dumpstream,
+                             svn_revnum_t start_rev,
+                             svn_revnum_t end_rev,
+                             enum svn_repos_load_uuid uuid_action,
+                             const char *parent_dir,
+                             svn_boolean_t use_pre_commit_hook,
+                             svn_boolean_t use_post_commit_hook,
+                             svn_boolean_t validate_props,
+                             int max_threads,
+                             apr_hash_t *fs_config,
+                             svn_repos_notify_func_t notify_func,
+                             void *notify_baton,
+                             svn_cancel_func_t cancel_func,
+                             void *cancel_baton,
+                             apr_pool_t *pool)
 {
   const svn_repos_parse_fns3_t *parser;
   void *parse_baton;
   struct parse_baton *pb;
 
-  /* This is really simple. */
-
   SVN_ERR(svn_repos_get_fs_build_parser4(&parser, &parse_baton,
                                          repos,
                                          start_rev, end_rev,
@@ -1124,6 +2176,57 @@ svn_repos_load_fs4(svn_repos_t *repos,
   pb->use_pre_commit_hook = use_pre_commit_hook;
   pb->use_post_commit_hook = use_post_commit_hook;
 
+#if APR_HAS_THREADS
+  /* The parser needs a thread of its own and the FS layer must be
+     prepared for concurrent access. */
+  if (max_threads > 1 && ! svn_cache_config_get()->single_threaded)
+    {
+      apr_pool_t *pipeline_pool = svn_pool_create(pool);
+      svn_error_t *err;
+
+      err = load_pipelined(pb, dumpstream, repos->db_path, fs_config,
+                           max_threads, cancel_func, cancel_baton,
+                           pipeline_pool);
+
+      /* Stop the parser and wait for all threads. */
+      svn_pool_destroy(pipeline_pool);
+
+      return svn_error_trace(err);
+    }
+#endif
+
   return svn_repos_parse_dumpstream3(dumpstream, parser, parse_baton, FALSE,
                                      cancel_func, cancel_baton, pool);
 }
+
+
+svn_error_t *
+svn_repos_load_fs4(svn_repos_t *repos,
+                   svn_stream_t *dumpstream,
+                   svn_revnum_t start_rev,
+                   svn_revnum_t end_rev,
+                   enum svn_repos_load_uuid uuid_action,
+                   const char *parent_dir,
+                   svn_boolean_t use_pre_commit_hook,
+                   svn_boolean_t use_post_commit_hook,
+                   svn_boolean_t validate_props,
+                   svn_repos_notify_func_t notify_func,
+                   void *notify_baton,
+                   svn_cancel_func_t cancel_func,
+                   void *cancel_baton,
+                   apr_pool_t *pool)
+{
+  return svn_error_trace(svn_repos__load_fs_pipelined(repos, dumpstream,
+                                                      start_rev, end_rev,
+                                                      uuid_action,
+                                                      parent_dir,
+                                                      use_pre_commit_hook,
+                                                      use_post_commit_hook,
+                                                      validate_props,
+                                                      1, NULL,
+                                                      notify_func,
+                                                      notify_baton,
+                                                      cancel_func,
+                                                      cancel_baton,
+                                                      pool));
+}
@@ -40,6 +40,7 @@
 
 #include "private/svn_dep_compat.h"
 #include "private/svn_mergeinfo_private.h"
+#include "private/svn_repos_private.h"
 
 /*----------------------------------------------------------------------*/
 
@@ -290,14 +291,62 @@ parse_property_block(svn_stream_t *stream,
 }
 
 
+/* Read CONTENT_LENGTH bytes from STREAM and write them to TEXT_STREAM,
+   unless that is NULL.  Use BUFFER/BUFLEN to copy the data in "chunks". */
+static svn_error_t *
+copy_text_data(svn_stream_t *stream,
+               svn_stream_t *text_stream,
+               svn_filesize_t content_length,
+               char *buffer,
+               apr_size_t buflen)
+{
+  apr_size_t num_to_read, rlen, wlen;
+
+  /* Regardless of whether or not we have a sink for our data, we
+     need to read it. */
+  while (content_length)
+    {
+      if (content_length >= buflen)
+        rlen = buflen;
+      else
+        rlen = (apr_size_t) content_length;
+
+      num_to_read = rlen;
+      SVN_ERR(svn_stream_read(stream, buffer, &rlen));
+      content_length -= rlen;
+      if (rlen != num_to_read)
+        return stream_ran_dry();
+
+      if (text_stream)
+        {
+          /* write however many bytes you read. */
+          wlen = rlen;
+          SVN_ERR(svn_stream_write(text_stream, buffer, &wlen));
+          if (wlen != rlen)
+            {
+              /* Uh oh, didn't write as many bytes as we read. */
+              return svn_error_create(SVN_ERR_STREAM_UNEXPECTED_EOF, NULL,
+                                      _("Unexpected EOF writing contents"));
+            }
+        }
+    }
+
+  return SVN_NO_ERROR;
+}
+
+
 /* Read CONTENT_LENGTH bytes from STREAM, and use
    PARSE_FNS->set_fulltext to push those bytes as replace fulltext for
    a node.  Use BUFFER/BUFLEN to push the fulltext in "chunks".
 
+   If CHUNKED is set, ignore CONTENT_LENGTH and read chunked text content
+   as described for SVN_REPOS__DUMPFILE_TEXT_CONTENT_CHUNKED instead.
+
    Use POOL for all allocations.  */
 static svn_error_t *
 parse_text_block(svn_stream_t *stream,
                  svn_filesize_t content_length,
+                 svn_boolean_t chunked,
                  svn_boolean_t is_delta,
                  const svn_repos_parse_fns3_t *parse_fns,
                  void *record_baton,
@@ -306,7 +355,7 @@ parse_text_block(svn_stream_t *stream,
                  apr_pool_t *pool)
 {
   svn_stream_t *text_stream = NULL;
-  apr_size_t num_to_read, rlen, wlen;
+  apr_size_t wlen;
 
   if (is_delta)
     {
@@ -325,41 +374,42 @@ parse_text_block(svn_stream_t *stream,
 
   /* If there are no contents to read, just write an empty buffer
      through our callback. */
-  if (content_length == 0)
+  if (content_length == 0 || chunked)
     {
       wlen = 0;
       if (text_stream)
         SVN_ERR(svn_stream_write(text_stream, "", &wlen));
     }
 
-  /* Regardless of whether or not we have a sink for our data, we
-     need to read it. */
-  while (content_length)
+  if (chunked)
     {
-      if (content_length >= buflen)
-        rlen = buflen;
-      else
-        rlen = (apr_size_t) content_length;
-
-      num_to_read = rlen;
-      SVN_ERR(svn_stream_read(stream, buffer, &rlen));
-      content_length -= rlen;
-      if (rlen != num_to_read)
-        return stream_ran_dry();
+      apr_pool_t *linepool = svn_pool_create(pool);
 
-      if (text_stream)
+      /* Copy chunks until we find the empty one. */
+      do
         {
-          /* write however many bytes you read. */
-          wlen = rlen;
-          SVN_ERR(svn_stream_write(text_stream, buffer, &wlen));
-          if (wlen != rlen)
-            {
-              /* Uh oh, didn't write as many bytes as we read. */
-              return svn_error_create(SVN_ERR_STREAM_UNEXPECTED_EOF, NULL,
-                                      _("Unexpected EOF writing contents"));
-            }
+          svn_stringbuf_t *line;
+          svn_boolean_t eof;
+          apr_uint64_t chunk_length;
+
+          svn_pool_clear(linepool);
+          SVN_ERR(svn_stream_readline(stream, &line, "\n", &eof, linepool));
+          if (eof)
+            return stream_ran_dry();
+          SVN_ERR(svn_cstring_strtoui64(&chunk_length, line->data, 0,
+                                        APR_INT64_MAX, 10));
+
+          content_length = (svn_filesize_t)chunk_length;
+          SVN_ERR(copy_text_data(stream, text_stream, content_length,
+                                 buffer, buflen));
         }
+      while (content_length);
+
+      svn_pool_destroy(linepool);
     }
+  else
+    SVN_ERR(copy_text_data(stream, text_stream, content_length,
+                           buffer, buflen));
 
   /* If we opened a stream, we must close it. */
   if (text_stream)
@@ -391,7 +441,7 @@ parse_format_version(int *version,
 
   SVN_ERR(svn_cstring_atoi(&value, p + 1));
 
-  if (value > SVN_REPOS_DUMPFILE_FORMAT_VERSION)
+  if (value > SVN_REPOS__DUMPFILE_FORMAT_VERSION_CHUNKED)
     return svn_error_createf(SVN_ERR_STREAM_MALFORMED_DATA, NULL,
                              _("Unsupported dumpfile version: %d"),
                              value);
@@ -459,6 +509,7 @@ svn_repos_parse_dumpstream3(svn_stream_t *stream,
       const char *content_length;
       const char *prop_cl;
       const char *text_cl;
+      svn_boolean_t text_chunked;
       const char *value;
       svn_filesize_t actual_prop_length;
 
@@ -556,6 +607,9 @@ svn_repos_parse_dumpstream3(svn_stream_t *stream,
       text_cl = apr_hash_get(headers,
                              SVN_REPOS_DUMPFILE_TEXT_CONTENT_LENGTH,
                              APR_HASH_KEY_STRING);
+      value = apr_hash_get(headers, SVN_REPOS__DUMPFILE_TEXT_CONTENT_CHUNKED,
+                           APR_HASH_KEY_STRING);
+      text_chunked = (value && strcmp(value, "true") == 0);
       old_v1_with_cl =
         version == 1 && content_length && ! prop_cl && ! text_cl;
 
@@ -584,7 +638,7 @@ svn_repos_parse_dumpstream3(svn_stream_t *stream,
         }
 
       /* Is there a text content-block to parse? */
-      if (text_cl)
+      if (text_cl || text_chunked)
         {
           const char *delta = apr_hash_get(headers,
                                            SVN_REPOS_DUMPFILE_TEXT_DELTA,
@@ -594,7 +648,8 @@ svn_repos_parse_dumpstream3(svn_stream_t *stream,
             is_delta = (delta && strcmp(delta, "true") == 0);
 
           SVN_ERR(parse_text_block(stream,
-                                   svn__atoui64(text_cl),
+                                   text_cl ? svn__atoui64(text_cl) : 0,
+                                   text_chunked,
                                    is_delta,
                                    parse_fns,
                                    found_node ? node_baton : rev_baton,
@@ -631,6 +686,7 @@ svn_repos_parse_dumpstream3(svn_stream_t *stream,
             SVN_ERR(parse_text_block(stream,
                                      cl_value,
                                      FALSE,
+                                     FALSE,
                                      parse_fns,
                                      found_node ? node_baton : rev_baton,
                                      buffer,
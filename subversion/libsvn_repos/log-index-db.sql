@@ -0,0 +1,68 @@
+/* log-index-db.sql -- schema of the per-path log index
+ *   This is intended for use with SQLite 3
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+-- STMT_CREATE_SCHEMA
+PRAGMA AUTO_VACUUM = 1;
+
+/* A table listing for every path the revisions in which it has been
+   changed.  A change to a path also changes all of its parent
+   directories, so they get listed as well. */
+CREATE TABLE changes (
+  path TEXT NOT NULL,
+  revision INTEGER NOT NULL,
+  PRIMARY KEY (path, revision)
+  );
+
+/* The youngest revision whose changes have been added to the index.
+   There is only ever one row. */
+CREATE TABLE indexed_revision (
+  revision INTEGER NOT NULL
+  );
+
+INSERT INTO indexed_revision (revision) VALUES (0);
+
+PRAGMA USER_VERSION = 1;
+
+
+-- STMT_ADD_CHANGE
+INSERT OR IGNORE INTO changes (path, revision)
+VALUES (?1, ?2)
+
+-- STMT_GET_YOUNGEST_CHANGE
+SELECT revision
+FROM changes
+WHERE path = ?1 AND revision >= ?2 AND revision <= ?3
+ORDER BY revision DESC
+LIMIT 1
+
+-- STMT_GET_INDEXED_REVISION
+SELECT revision
+FROM indexed_revision
+
+-- STMT_SET_INDEXED_REVISION
+UPDATE indexed_revision
+SET revision = ?1
+
+-- STMT_CLEAR
+DELETE FROM changes;
+UPDATE indexed_revision SET revision = 0;
@@ -36,9 +36,13 @@
 #include "svn_sorts.h"
 #include "svn_props.h"
 #include "svn_mergeinfo.h"
+#include "svn_cache_config.h"
 #include "repos.h"
 #include "private/svn_fspath.h"
 #include "private/svn_mergeinfo_private.h"
+#include "private/svn_mutex.h"
+#include "private/svn_repos_private.h"
+#include "private/svn_thread_pool.h"
 
 
 
@@ -353,6 +357,296 @@ detect_changed(apr_hash_t **changed,
   return SVN_NO_ERROR;
 }
 
+/* Revisions to prefetch per worker thread in pipelined log mode. */
+#define LOG_PREFETCH_PER_THREAD 4
+
+/* Baton for serialized_authz_read_func(). */
+typedef struct serialized_authz_baton_t
+{
+  svn_repos_authz_func_t authz_read_func;
+  void *authz_read_baton;
+  svn_mutex__t *mutex;
+} serialized_authz_baton_t;
+
+/* Implements svn_repos_authz_func_t.  Call the authz callback wrapped
+   by the serialized_authz_baton_t BATON while holding its mutex. */
+static svn_error_t *
+serialized_authz_read_func(svn_boolean_t *allowed,
+                           svn_fs_root_t *root,
+                           const char *path,
+                           void *baton,
+                           apr_pool_t *pool)
+{
+  serialized_authz_baton_t *sab = baton;
+
+  SVN_MUTEX__WITH_LOCK(sab->mutex,
+                       sab->authz_read_func(allowed, root, path,
+                                            sab->authz_read_baton, pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* A revision whose changed paths are being determined in the background
+   by a log_prefetcher_t. */
+typedef struct prefetch_t
+{
+  /* The revision and the prefetcher it is queued in. */
+  svn_revnum_t rev;
+  struct log_prefetcher_t *prefetcher;
+
+  /* The background job and, once it has finished, its result as
+     returned by detect_changed().  CHANGED_PATHS is allocated in the
+     result pool of JOB. */
+  svn_thread_pool__job_t *job;
+  apr_hash_t *changed_paths;
+
+  /* Next revision in the queue. */
+  struct prefetch_t *next;
+
+  /* Everything above as well as JOB live in this pool. */
+  apr_pool_t *pool;
+} prefetch_t;
+
+/* Runs detect_changed() for upcoming log revisions on worker threads.
+
+   svn_fs_t objects must not be shared between threads, so the workers
+   use private FS instances of the same repository that are borrowed
+   from svn_repos__worker_fs_acquire() for the duration of the request.
+   Revisions are handed back strictly in the order they have been
+   queued, which keeps the output of the log deterministic. */
+typedef struct log_prefetcher_t
+{
+  svn_thread_pool__t *thread_pool;
+
+  /* Idle worker FS instances (svn_fs_t *), guarded by FS_MUTEX. */
+  apr_array_header_t *idle_fs;
+  svn_mutex__t *fs_mutex;
+
+  /* Handles of all worker FS instances (svn_repos__worker_fs_t *). */
+  apr_array_header_t *worker_fs;
+
+  /* Authz callback to use in detect_changed(). */
+  svn_repos_authz_func_t authz_read_func;
+  void *authz_read_baton;
+
+  /* FIFO of queued revisions, its length and the maximum length. */
+  prefetch_t *first;
+  prefetch_t *last;
+  int queued;
+  int depth;
+
+  /* The revision most recently taken from the queue; its result must
+     remain valid until the next one gets taken. */
+  prefetch_t *taken;
+
+  apr_pool_t *pool;
+} log_prefetcher_t;
+
+/* Pool cleanup function for log_prefetcher_t.  Release the worker FS
+   instances.  All jobs are gone by now because their pools are sub-pools
+   of the prefetcher pool. */
+static apr_status_t
+return_worker_fs(void *baton)
+{
+  log_prefetcher_t *prefetcher = baton;
+  int i;
+
+  for (i = 0; i < prefetcher->worker_fs->nelts; i++)
+    svn_error_clear(svn_repos__worker_fs_release(
+                      APR_ARRAY_IDX(prefetcher->worker_fs, i,
+                                    svn_repos__worker_fs_t *)));
+
+  return APR_SUCCESS;
+}
+
+/* Create a prefetcher for FS in *PREFETCHER that uses up to MAX_THREADS
+   worker threads.  FS_CONFIG is passed to svn_repos__worker_fs_acquire()
+   for the worker FS instances.  Set *PREFETCHER to NULL if the revisions
+   cannot be processed in parallel after all.
+
+   AUTHZ_READ_FUNC and AUTHZ_READ_BATON will be passed to
+   detect_changed().  They must be safe to use from multiple threads.
+
+   Allocate the prefetcher in RESULT_POOL.  All background jobs will be
+   finished when RESULT_POOL gets cleaned up. */
+static svn_error_t *
+log_prefetcher_create(log_prefetcher_t **prefetcher,
+                      svn_fs_t *fs,
+                      apr_hash_t *fs_config,
+                      int max_threads,
+                      svn_repos_authz_func_t authz_read_func,
+                      void *authz_read_baton,
+                      apr_pool_t *result_pool)
+{
+  log_prefetcher_t *p = apr_pcalloc(result_pool, sizeof(*p));
+  const char *fs_path = svn_fs_path(fs, result_pool);
+  const char *uuid;
+  int i;
+
+  SVN_ERR(svn_thread_pool__create(&p->thread_pool, max_threads,
+                                  result_pool));
+  if (! svn_thread_pool__is_parallel(p->thread_pool))
+    {
+      *prefetcher = NULL;
+      return SVN_NO_ERROR;
+    }
+
+  SVN_ERR(svn_mutex__init(&p->fs_mutex, TRUE, result_pool));
+  p->idle_fs = apr_array_make(result_pool, max_threads, sizeof(svn_fs_t *));
+  p->worker_fs = apr_array_make(result_pool, max_threads,
+                                sizeof(svn_repos__worker_fs_t *));
+  p->authz_read_func = authz_read_func;
+  p->authz_read_baton = authz_read_baton;
+  p->depth = max_threads * LOG_PREFETCH_PER_THREAD;
+  p->pool = result_pool;
+  apr_pool_cleanup_register(result_pool, p, return_worker_fs,
+                            apr_pool_cleanup_null);
+
+  SVN_ERR(svn_fs_get_uuid(fs, &uuid, result_pool));
+  for (i = 0; i < max_threads; i++)
+    {
+      svn_repos__worker_fs_t *worker_fs;
+      svn_fs_t *worker;
+
+      SVN_ERR(svn_repos__worker_fs_acquire(&worker_fs, &worker, fs_path, uuid,
+                                           fs_config, result_pool));
+      APR_ARRAY_PUSH(p->worker_fs, svn_repos__worker_fs_t *) = worker_fs;
+      APR_ARRAY_PUSH(p->idle_fs, svn_fs_t *) = worker;
+    }
+
+  *prefetcher = p;
+  return SVN_NO_ERROR;
+}
+
+/* Remove an idle worker FS from PREFETCHER and return it in *FS.
+   To be called with the FS mutex held. */
+static svn_error_t *
+acquire_worker_fs(svn_fs_t **fs,
+                  log_prefetcher_t *prefetcher)
+{
+  /* There are as many FS instances as threads. */
+  SVN_ERR_ASSERT(prefetcher->idle_fs->nelts > 0);
+  *fs = *(svn_fs_t **)apr_array_pop(prefetcher->idle_fs);
+
+  return SVN_NO_ERROR;
+}
+
+/* Return FS to the idle worker FS instances of PREFETCHER.
+   To be called with the FS mutex held. */
+static svn_error_t *
+release_worker_fs(log_prefetcher_t *prefetcher,
+                  svn_fs_t *fs)
+{
+  APR_ARRAY_PUSH(prefetcher->idle_fs, svn_fs_t *) = fs;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_thread_pool__task_t.  Run detect_changed() for the
+   prefetch_t in BATON using one of the worker FS instances. */
+static svn_error_t *
+prefetch_changed_paths(void *baton,
+                       apr_pool_t *result_pool,
+                       apr_pool_t *scratch_pool)
+{
+  prefetch_t *prefetch = baton;
+  log_prefetcher_t *prefetcher = prefetch->prefetcher;
+  apr_pool_t *root_pool = svn_pool_create(scratch_pool);
+  svn_fs_root_t *root;
+  svn_fs_t *fs;
+  svn_error_t *err;
+
+  SVN_MUTEX__WITH_LOCK(prefetcher->fs_mutex,
+                       acquire_worker_fs(&fs, prefetcher));
+
+  err = svn_fs_revision_root(&root, fs, prefetch->rev, root_pool);
+  if (! err)
+    err = detect_changed(&prefetch->changed_paths, root, fs,
+                         prefetcher->authz_read_func,
+                         prefetcher->authz_read_baton, result_pool);
+
+  /* Don't keep anything referring to FS once it may be used by others. */
+  svn_pool_destroy(root_pool);
+
+  SVN_MUTEX__WITH_LOCK(prefetcher->fs_mutex,
+                       release_worker_fs(prefetcher, fs));
+
+  return svn_error_trace(err);
+}
+
+/* Queue REV for changed-path detection in PREFETCHER. */
+static svn_error_t *
+log_prefetcher_push(log_prefetcher_t *prefetcher,
+                    svn_revnum_t rev)
+{
+  apr_pool_t *pool = svn_pool_create(prefetcher->pool);
+  prefetch_t *prefetch = apr_pcalloc(pool, sizeof(*prefetch));
+
+  prefetch->rev = rev;
+  prefetch->prefetcher = prefetcher;
+  prefetch->pool = pool;
+
+  /* Revision 0 never has changed paths; fill_log_entry() won't ask. */
+  if (rev > 0)
+    SVN_ERR(svn_thread_pool__submit(&prefetch->job, prefetcher->thread_pool,
+                                    prefetch_changed_paths, prefetch,
+                                    pool));
+
+  if (prefetcher->last)
+    prefetcher->last->next = prefetch;
+  else
+    prefetcher->first = prefetch;
+  prefetcher->last = prefetch;
+  prefetcher->queued++;
+
+  return SVN_NO_ERROR;
+}
+
+/* Return TRUE if PREFETCHER has no room for further revisions. */
+static svn_boolean_t
+log_prefetcher_full(const log_prefetcher_t *prefetcher)
+{
+  return prefetcher->queued >= prefetcher->depth;
+}
+
+/* Return the oldest revision queued in PREFETCHER or SVN_INVALID_REVNUM
+   if there is none. */
+static svn_revnum_t
+log_prefetcher_next_rev(const log_prefetcher_t *prefetcher)
+{
+  return prefetcher->first ? prefetcher->first->rev : SVN_INVALID_REVNUM;
+}
+
+/* Remove the oldest revision from the queue of PREFETCHER and wait for
+   its changed paths.  Set *CHANGED_PATHS and return the error exactly as
+   detect_changed() would.  *CHANGED_PATHS remains valid until the next
+   call to this function. */
+static svn_error_t *
+log_prefetcher_take(apr_hash_t **changed_paths,
+                    log_prefetcher_t *prefetcher)
+{
+  prefetch_t *prefetch = prefetcher->first;
+  svn_error_t *err;
+
+  SVN_ERR_ASSERT(prefetch != NULL);
+
+  if (prefetcher->taken)
+    svn_pool_destroy(prefetcher->taken->pool);
+  prefetcher->taken = prefetch;
+
+  prefetcher->first = prefetch->next;
+  if (prefetcher->first == NULL)
+    prefetcher->last = NULL;
+  prefetcher->queued--;
+
+  err = prefetch->job ? svn_thread_pool__wait(prefetch->job) : SVN_NO_ERROR;
+  *changed_paths = prefetch->changed_paths
+                 ? prefetch->changed_paths
+                 : apr_hash_make(prefetch->pool);
+
+  return err;
+}
+
 /* This is used by svn_repos_get_logs to keep track of multiple
  * path history information while working through history.
  *
@@ -374,9 +668,148 @@ struct path_info
   svn_fs_history_t *hist;
   apr_pool_t *newpool;
   apr_pool_t *oldpool;
+
+  /* If not NULL, the history gets walked using this index rather than
+     history objects as far as the index reaches.  SEGMENT_START is then
+     the oldest revision of the current segment of history, i.e. the
+     revision in which the node at PATH was copied or created, or
+     SVN_INVALID_REVNUM if not known yet.
+     If the segment starts with a copy, COPYFROM_PATH and COPYFROM_REV
+     are the location that PATH had in the copy source; otherwise
+     COPYFROM_REV is SVN_INVALID_REVNUM. */
+  svn_repos__log_index_t *log_index;
+  svn_revnum_t segment_start;
+  svn_stringbuf_t *copyfrom_path;
+  svn_revnum_t copyfrom_rev;
 };
 
+/* Set INFO->SEGMENT_START, INFO->COPYFROM_PATH and INFO->COPYFROM_REV
+ * for the segment of history that INFO->PATH in REV belongs to.  Use
+ * SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+find_history_segment(struct path_info *info,
+                     svn_fs_t *fs,
+                     svn_revnum_t rev,
+                     apr_pool_t *scratch_pool)
+{
+  const char *copyfrom_path;
+
+  SVN_ERR(svn_repos__prev_location(&info->segment_start, &copyfrom_path,
+                                   &info->copyfrom_rev, fs, rev,
+                                   info->path->data, scratch_pool));
+  if (copyfrom_path)
+    {
+      svn_stringbuf_set(info->copyfrom_path, copyfrom_path);
+    }
+  else
+    {
+      svn_fs_root_t *root;
+
+      SVN_ERR(svn_fs_revision_root(&root, fs, rev, scratch_pool));
+      SVN_ERR(svn_fs_node_origin_rev(&info->segment_start, root,
+                                     info->path->data, scratch_pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Like get_history() below, but for an INFO with a LOG_INDEX that covers
+ * INFO->HISTORY_REV.
+ *
+ * Between copies, the node history of a path consists of exactly those
+ * revisions in which the path or anything below it has been changed,
+ * and these are what the log index lists.  So the filesystem only needs
+ * to be asked where each such segment of history starts.
+ */
+static svn_error_t *
+get_indexed_history(struct path_info *info,
+                    svn_fs_t *fs,
+                    svn_boolean_t strict,
+                    svn_repos_authz_func_t authz_read_func,
+                    void *authz_read_baton,
+                    svn_revnum_t start,
+                    apr_pool_t *pool)
+{
+  apr_pool_t *subpool = svn_pool_create(pool);
+  svn_revnum_t upper, rev;
+
+  /* Coming from the revisions younger than the index, we don't know
+     the segment that the current history item belongs to yet. */
+  if (! info->first_time && ! SVN_IS_VALID_REVNUM(info->segment_start))
+    SVN_ERR(find_history_segment(info, fs, info->history_rev, subpool));
+
+  if (info->first_time)
+    {
+      info->first_time = FALSE;
+      upper = info->history_rev;
+    }
+  else if (info->history_rev == info->segment_start)
+    {
+      /* We reached the start of the segment.  Continue in the copy
+         source, if there is one and we are to cross copies. */
+      if (strict || ! SVN_IS_VALID_REVNUM(info->copyfrom_rev))
+        {
+          svn_pool_destroy(subpool);
+          info->done = TRUE;
+          return SVN_NO_ERROR;
+        }
+
+      svn_stringbuf_set(info->path, info->copyfrom_path->data);
+      upper = info->copyfrom_rev;
+      info->segment_start = SVN_INVALID_REVNUM;
+    }
+  else
+    {
+      upper = info->history_rev - 1;
+    }
+
+  if (! SVN_IS_VALID_REVNUM(info->segment_start))
+    SVN_ERR(find_history_segment(info, fs, upper, subpool));
+
+  /* The copy or creation at SEGMENT_START is part of the history even
+     if the index doesn't list the path itself for that revision. */
+  SVN_ERR(svn_repos__log_index_youngest_change(&rev, info->log_index,
+                                               info->path->data,
+                                               info->segment_start + 1,
+                                               upper, subpool));
+  info->history_rev = SVN_IS_VALID_REVNUM(rev) ? rev : info->segment_start;
+
+  /* If this history item predates our START revision then
+     don't fetch any more for this path. */
+  if (info->history_rev < start)
+    {
+      svn_pool_destroy(subpool);
+      info->done = TRUE;
+      return SVN_NO_ERROR;
+    }
+
+  /* Is the history item readable?  If not, done with path. */
+  if (authz_read_func)
+    {
+      svn_boolean_t readable;
+      svn_fs_root_t *history_root;
+
+      SVN_ERR(svn_fs_revision_root(&history_root, fs,
+                                   info->history_rev,
+                                   subpool));
+      SVN_ERR(authz_read_func(&readable, history_root,
+                              info->path->data,
+                              authz_read_baton,
+                              subpool));
+      if (! readable)
+        info->done = TRUE;
+    }
+
+  svn_pool_destroy(subpool);
+
+  return SVN_NO_ERROR;
+}
+
 /* Advance to the next history for the path.
+ *
+ * If INFO->LOG_INDEX is not NULL and covers INFO->HISTORY_REV, see
+ * get_indexed_history().
  *
  * If INFO->HIST is not NULL we do this using that existing history object,
  * otherwise we open a new one.
@@ -406,6 +839,14 @@ get_history(struct path_info *info,
   apr_pool_t *subpool;
   const char *path;
 
+  if (info->log_index
+      && info->history_rev
+           <= svn_repos__log_index_indexed_rev(info->log_index))
+    return svn_error_trace(get_indexed_history(info, fs, strict,
+                                               authz_read_func,
+                                               authz_read_baton,
+                                               start, pool));
+
   if (info->hist)
     {
       subpool = info->newpool;
@@ -549,18 +990,16 @@ next_history_rev(const apr_array_header_t *histories)
   return next_rev;
 }
 
-/* Set *DELETED_MERGEINFO_CATALOG and *ADDED_MERGEINFO_CATALOG to
-   catalogs describing how mergeinfo values on paths (which are the
-   keys of those catalogs) were changed in REV. */
 /* ### TODO: This would make a *great*, useful public function,
    ### svn_repos_fs_mergeinfo_changed()!  -- cmpilato  */
-static svn_error_t *
-fs_mergeinfo_changed(svn_mergeinfo_catalog_t *deleted_mergeinfo_catalog,
-                     svn_mergeinfo_catalog_t *added_mergeinfo_catalog,
-                     svn_fs_t *fs,
-                     svn_revnum_t rev,
-                     apr_pool_t *result_pool,
-                     apr_pool_t *scratch_pool)
+svn_error_t *
+svn_repos__mergeinfo_changed(
+  svn_mergeinfo_catalog_t *deleted_mergeinfo_catalog,
+  svn_mergeinfo_catalog_t *added_mergeinfo_catalog,
+  svn_fs_t *fs,
+  svn_revnum_t rev,
+  apr_pool_t *result_pool,
+  apr_pool_t *scratch_pool)
 
 {
   apr_hash_t *changes;
@@ -766,20 +1205,47 @@ fs_mergeinfo_changed(svn_mergeinfo_catalog_t *deleted_mergeinfo_catalog,
 }
 
 
+/* Return TRUE if PATH is one of the paths in ADDED_NODES, or the key
+   of an entry in CATALOG, or a descendant of one of them. */
+static svn_boolean_t
+is_at_or_below(const char *path,
+               const apr_array_header_t *added_nodes,
+               svn_mergeinfo_catalog_t catalog,
+               apr_pool_t *scratch_pool)
+{
+  apr_hash_index_t *hi;
+  int i;
+
+  for (i = 0; i < added_nodes->nelts; i++)
+    if (svn_fspath__skip_ancestor(APR_ARRAY_IDX(added_nodes, i,
+                                                const char *),
+                                  path))
+      return TRUE;
+
+  for (hi = apr_hash_first(scratch_pool, catalog); hi; hi = apr_hash_next(hi))
+    if (svn_fspath__skip_ancestor(svn__apr_hash_index_key(hi), path))
+      return TRUE;
+
+  return FALSE;
+}
+
 /* Determine what (if any) mergeinfo for PATHS was modified in
    revision REV, returning the differences for added mergeinfo in
    *ADDED_MERGEINFO and deleted mergeinfo in *DELETED_MERGEINFO.
-   Use POOL for all allocations. */
+   If MERGEINFO_INDEX is not NULL and covers REV, take the mergeinfo
+   changes of REV from there.  Use POOL for all allocations. */
 static svn_error_t *
 get_combined_mergeinfo_changes(svn_mergeinfo_t *added_mergeinfo,
                                svn_mergeinfo_t *deleted_mergeinfo,
                                svn_fs_t *fs,
+                               svn_repos__mergeinfo_index_t *mergeinfo_index,
                                const apr_array_header_t *paths,
                                svn_revnum_t rev,
                                apr_pool_t *result_pool,
                                apr_pool_t *scratch_pool)
 {
   svn_mergeinfo_catalog_t added_mergeinfo_catalog, deleted_mergeinfo_catalog;
+  apr_array_header_t *added_nodes = NULL;
   apr_hash_index_t *hi;
   svn_fs_root_t *root;
   apr_pool_t *iterpool;
@@ -802,9 +1268,17 @@ get_combined_mergeinfo_changes(svn_mergeinfo_t *added_mergeinfo,
   SVN_ERR(svn_fs_revision_root(&root, fs, rev, scratch_pool));
 
   /* Fetch the mergeinfo changes for REV. */
-  err = fs_mergeinfo_changed(&deleted_mergeinfo_catalog,
-                             &added_mergeinfo_catalog,
-                             fs, rev, scratch_pool, scratch_pool);
+  if (mergeinfo_index
+      && rev <= svn_repos__mergeinfo_index_indexed_rev(mergeinfo_index))
+    err = svn_repos__mergeinfo_index_changes(&deleted_mergeinfo_catalog,
+                                             &added_mergeinfo_catalog,
+                                             &added_nodes, mergeinfo_index,
+                                             rev, scratch_pool,
+                                             scratch_pool);
+  else
+    err = svn_repos__mergeinfo_changed(&deleted_mergeinfo_catalog,
+                                       &added_mergeinfo_catalog,
+                                       fs, rev, scratch_pool, scratch_pool);
   if (err)
     {
       if (err->apr_err == SVN_ERR_MERGEINFO_PARSE_ERROR)
@@ -843,6 +1317,14 @@ get_combined_mergeinfo_changes(svn_mergeinfo_t *added_mergeinfo,
       if (apr_hash_get(deleted_mergeinfo_catalog, path, APR_HASH_KEY_STRING))
         continue;
 
+      /* The mergeinfo that PATH inherits can only have changed if the
+         mergeinfo of one of its parents did or if it or one of its
+         parents has been added or replaced. */
+      if (added_nodes
+          && ! is_at_or_below(path, added_nodes, deleted_mergeinfo_catalog,
+                              iterpool))
+        continue;
+
       /* Figure out what path/rev to compare against.  Ignore
          not-found errors returned by the filesystem.  */
       err = svn_repos__prev_location(&appeared_rev, &prev_path, &prev_rev,
@@ -984,7 +1466,9 @@ get_combined_mergeinfo_changes(svn_mergeinfo_t *added_mergeinfo,
 }
 
 
-/* Fill LOG_ENTRY with history information in FS at REV. */
+/* Fill LOG_ENTRY with history information in FS at REV.  If REV is
+   the next revision queued in PREFETCHER, take its changed paths from
+   there.  PREFETCHER may be NULL. */
 static svn_error_t *
 fill_log_entry(svn_log_entry_t *log_entry,
                svn_revnum_t rev,
@@ -993,24 +1477,35 @@ fill_log_entry(svn_log_entry_t *log_entry,
                const apr_array_header_t *revprops,
                svn_repos_authz_func_t authz_read_func,
                void *authz_read_baton,
+               log_prefetcher_t *prefetcher,
                apr_pool_t *pool)
 {
   apr_hash_t *r_props, *changed_paths = NULL;
   svn_boolean_t get_revprops = TRUE, censor_revprops = FALSE;
+  svn_boolean_t prefetched = (prefetcher
+                              && log_prefetcher_next_rev(prefetcher) == rev);
 
   /* Discover changed paths if the user requested them
      or if we need to check that they are readable. */
   if ((rev > 0)
       && (authz_read_func || discover_changed_paths))
     {
-      svn_fs_root_t *newroot;
       svn_error_t *patherr;
 
-      SVN_ERR(svn_fs_revision_root(&newroot, fs, rev, pool));
-      patherr = detect_changed(&changed_paths,
-                               newroot, fs,
-                               authz_read_func, authz_read_baton,
-                               pool);
+      if (prefetched)
+        {
+          patherr = log_prefetcher_take(&changed_paths, prefetcher);
+        }
+      else
+        {
+          svn_fs_root_t *newroot;
+
+          SVN_ERR(svn_fs_revision_root(&newroot, fs, rev, pool));
+          patherr = detect_changed(&changed_paths,
+                                   newroot, fs,
+                                   authz_read_func, authz_read_baton,
+                                   pool);
+        }
 
       if (patherr
           && patherr->apr_err == SVN_ERR_AUTHZ_UNREADABLE)
@@ -1037,6 +1532,12 @@ fill_log_entry(svn_log_entry_t *log_entry,
       if (! discover_changed_paths)
         changed_paths = NULL;
     }
+  else if (prefetched)
+    {
+      /* Nothing to look at, but REV has to leave the queue anyway. */
+      SVN_ERR(log_prefetcher_take(&changed_paths, prefetcher));
+      changed_paths = NULL;
+    }
 
   if (get_revprops)
     {
@@ -1115,7 +1616,10 @@ fill_log_entry(svn_log_entry_t *log_entry,
    If HANDLING_MERGED_REVISIONS is FALSE then ignore NESTED_MERGES.  Otherwise
    if NESTED_MERGES is not NULL and REV is contained in it, then don't send
    the log for REV, otherwise send it normally and add REV to
-   NESTED_MERGES. */
+   NESTED_MERGES.
+
+   If REV is the next revision queued in PREFETCHER, use the changed paths
+   prefetched for it.  PREFETCHER may be NULL. */
 static svn_error_t *
 send_log(svn_revnum_t rev,
          svn_fs_t *fs,
@@ -1130,6 +1634,7 @@ send_log(svn_revnum_t rev,
          void *receiver_baton,
          svn_repos_authz_func_t authz_read_func,
          void *authz_read_baton,
+         log_prefetcher_t *prefetcher,
          apr_pool_t *pool)
 {
   svn_log_entry_t *log_entry;
@@ -1140,7 +1645,7 @@ send_log(svn_revnum_t rev,
   SVN_ERR(fill_log_entry(log_entry, rev, fs,
                          discover_changed_paths || handling_merged_revision,
                          revprops, authz_read_func, authz_read_baton,
-                         pool));
+                         prefetcher, pool));
   log_entry->has_children = has_children;
   log_entry->subtractive_merge = subtractive_merge;
 
@@ -1263,13 +1768,15 @@ send_log(svn_revnum_t rev,
    memory. */
 #define MAX_OPEN_HISTORIES 32
 
-/* Get the histories for PATHS, and store them in *HISTORIES.
+/* Get the histories for PATHS, and store them in *HISTORIES.  If
+   LOG_INDEX is not NULL, the histories will be walked with its help.
 
    If IGNORE_MISSING_LOCATIONS is set, don't treat requests for bogus
    repository locations as fatal -- just ignore them.  */
 static svn_error_t *
 get_path_histories(apr_array_header_t **histories,
                    svn_fs_t *fs,
+                   svn_repos__log_index_t *log_index,
                    const apr_array_header_t *paths,
                    svn_revnum_t hist_start,
                    svn_revnum_t hist_end,
@@ -1320,8 +1827,22 @@ get_path_histories(apr_array_header_t **histories,
       info->done = FALSE;
       info->history_rev = hist_end;
       info->first_time = TRUE;
+      info->log_index = log_index;
+      info->segment_start = SVN_INVALID_REVNUM;
+      info->copyfrom_path = NULL;
+      info->copyfrom_rev = SVN_INVALID_REVNUM;
 
-      if (i < MAX_OPEN_HISTORIES)
+      if (log_index)
+        {
+          /* The index makes history objects unnecessary.  Revisions
+             younger than the index are few and get walked by opening
+             a new history object for every step. */
+          info->hist = NULL;
+          info->oldpool = NULL;
+          info->newpool = NULL;
+          info->copyfrom_path = svn_stringbuf_create_empty(pool);
+        }
+      else if (i < MAX_OPEN_HISTORIES)
         {
           err = svn_fs_node_history(&info->hist, root, this_path, pool);
           if (err
@@ -1593,6 +2114,9 @@ combine_mergeinfo_path_lists(apr_array_header_t **combined_list,
 /* Pity that C is so ... linear. */
 static svn_error_t *
 do_logs(svn_fs_t *fs,
+        svn_repos__log_index_t *log_index,
+        svn_repos__mergeinfo_index_t *mergeinfo_index,
+        log_prefetcher_t *prefetcher,
         const apr_array_header_t *paths,
         svn_mergeinfo_t log_target_history_as_mergeinfo,
         svn_mergeinfo_t processed,
@@ -1648,6 +2172,8 @@ compare_path_list_range(const void *a, const void *b)
 static svn_error_t *
 handle_merged_revisions(svn_revnum_t rev,
                         svn_fs_t *fs,
+                        svn_repos__log_index_t *log_index,
+                        svn_repos__mergeinfo_index_t *mergeinfo_index,
                         svn_mergeinfo_t log_target_history_as_mergeinfo,
                         apr_hash_t *nested_merges,
                         svn_mergeinfo_t processed,
@@ -1692,7 +2218,8 @@ handle_merged_revisions(svn_revnum_t rev,
         = APR_ARRAY_IDX(combined_list, i, struct path_list_range *);
 
       svn_pool_clear(iterpool);
-      SVN_ERR(do_logs(fs, pl_range->paths, log_target_history_as_mergeinfo,
+      SVN_ERR(do_logs(fs, log_index, mergeinfo_index, NULL, pl_range->paths,
+                      log_target_history_as_mergeinfo,
                       processed, nested_merges,
                       pl_range->range.start, pl_range->range.end, 0,
                       discover_changed_paths, strict_node_history,
@@ -1825,6 +2352,39 @@ store_search(svn_mergeinfo_t processed,
   return SVN_NO_ERROR;
 }
 
+/* Send the log messages for the revisions queued in PREFETCHER, oldest
+   first, until no more than KEEP of them remain in the queue.  Add the
+   number of messages sent to *SEND_COUNT.  The other parameters are as
+   for send_log().  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+send_prefetched_logs(int *send_count,
+                     log_prefetcher_t *prefetcher,
+                     int keep,
+                     svn_fs_t *fs,
+                     svn_boolean_t discover_changed_paths,
+                     const apr_array_header_t *revprops,
+                     svn_log_entry_receiver_t receiver,
+                     void *receiver_baton,
+                     svn_repos_authz_func_t authz_read_func,
+                     void *authz_read_baton,
+                     apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+
+  while (prefetcher->queued > keep)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(send_log(log_prefetcher_next_rev(prefetcher), fs, NULL, NULL,
+                       discover_changed_paths, FALSE, FALSE, revprops,
+                       FALSE, receiver, receiver_baton, authz_read_func,
+                       authz_read_baton, prefetcher, iterpool));
+      ++*send_count;
+    }
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
 /* Find logs for PATHS from HIST_START to HIST_END in FS, and invoke
    RECEIVER with RECEIVER_BATON on them.  If DESCENDING_ORDER is TRUE, send
    the logs back as we find them, else buffer the logs and send them back
@@ -1833,6 +2393,14 @@ store_search(svn_mergeinfo_t processed,
    If IGNORE_MISSING_LOCATIONS is set, don't treat requests for bogus
    repository locations as fatal -- just ignore them.
 
+   If LOG_INDEX is not NULL, use it to walk the histories of PATHS.
+   Likewise, take the mergeinfo changes from MERGEINFO_INDEX unless that
+   is NULL.
+
+   If PREFETCHER is not NULL, have it determine the changed paths of the
+   revisions to send ahead of time.  This requires INCLUDE_MERGED_REVISIONS
+   to be FALSE.
+
    If LOG_TARGET_HISTORY_AS_MERGEINFO is not NULL then it contains mergeinfo
    representing the history of PATHS between HIST_START and HIST_END.
 
@@ -1857,6 +2425,9 @@ store_search(svn_mergeinfo_t processed,
  */
 static svn_error_t *
 do_logs(svn_fs_t *fs,
+        svn_repos__log_index_t *log_index,
+        svn_repos__mergeinfo_index_t *mergeinfo_index,
+        log_prefetcher_t *prefetcher,
         const apr_array_header_t *paths,
         svn_mergeinfo_t log_target_history_as_mergeinfo,
         svn_mergeinfo_t processed,
@@ -1906,7 +2477,8 @@ do_logs(svn_fs_t *fs,
      about all the revisions in the range -- only the ones in which
      one of our paths was changed.  So let's go figure out which
      revisions contain real changes to at least one of our paths.  */
-  SVN_ERR(get_path_histories(&histories, fs, paths, hist_start, hist_end,
+  SVN_ERR(get_path_histories(&histories, fs, log_index, paths,
+                             hist_start, hist_end,
                              strict_node_history, ignore_missing_locations,
                              authz_read_func, authz_read_baton, pool));
 
@@ -1961,7 +2533,8 @@ do_logs(svn_fs_t *fs,
                 }
               SVN_ERR(get_combined_mergeinfo_changes(&added_mergeinfo,
                                                      &deleted_mergeinfo,
-                                                     fs, cur_paths,
+                                                     fs, mergeinfo_index,
+                                                     cur_paths,
                                                      current, iterpool,
                                                      iterpool));
               has_children = (apr_hash_count(added_mergeinfo) > 0
@@ -1970,8 +2543,22 @@ do_logs(svn_fs_t *fs,
 
           /* If our caller wants logs in descending order, we can send
              'em now (because that's the order we're crawling history
-             in anyway). */
-          if (descending_order)
+             in anyway).  When prefetching, hold them back a little so
+             that the changed paths of the following revisions can be
+             determined in the meantime. */
+          if (descending_order && prefetcher)
+            {
+              SVN_ERR(log_prefetcher_push(prefetcher, current));
+              SVN_ERR(send_prefetched_logs(&send_count, prefetcher,
+                                           prefetcher->depth - 1, fs,
+                                           discover_changed_paths, revprops,
+                                           receiver, receiver_baton,
+                                           authz_read_func, authz_read_baton,
+                                           iterpool));
+              if (limit && send_count + prefetcher->queued >= limit)
+                break;
+            }
+          else if (descending_order)
             {
               SVN_ERR(send_log(current, fs,
                                log_target_history_as_mergeinfo, nested_merges,
@@ -1979,7 +2566,8 @@ do_logs(svn_fs_t *fs,
                                subtractive_merge, handling_merged_revisions,
                                revprops, has_children,
                                receiver, receiver_baton,
-                               authz_read_func, authz_read_baton, iterpool));
+                               authz_read_func, authz_read_baton, NULL,
+                               iterpool));
 
               if (has_children) /* Implies include_merged_revisions == TRUE */
                 {
@@ -1994,7 +2582,7 @@ do_logs(svn_fs_t *fs,
                     }
 
                   SVN_ERR(handle_merged_revisions(
-                    current, fs,
+                    current, fs, log_index, mergeinfo_index,
                     log_target_history_as_mergeinfo, nested_merges,
                     processed,
                     added_mergeinfo, deleted_mergeinfo,
@@ -2042,6 +2630,13 @@ do_logs(svn_fs_t *fs,
             }
         }
     }
+
+  if (prefetcher)
+    SVN_ERR(send_prefetched_logs(&send_count, prefetcher, 0, fs,
+                                 discover_changed_paths, revprops,
+                                 receiver, receiver_baton,
+                                 authz_read_func, authz_read_baton,
+                                 iterpool));
   svn_pool_destroy(iterpool);
 
   if (subpool)
@@ -2052,6 +2647,9 @@ do_logs(svn_fs_t *fs,
 
   if (revs)
     {
+      int send_total = (limit && limit < revs->nelts) ? limit : revs->nelts;
+      int prefetched = 0;
+
       /* Work loop for processing the revisions we found since they wanted
          history in forward order. */
       iterpool = svn_pool_create(pool);
@@ -2064,6 +2662,15 @@ do_logs(svn_fs_t *fs,
           svn_pool_clear(iterpool);
           current = APR_ARRAY_IDX(revs, revs->nelts - i - 1, svn_revnum_t);
 
+          /* Keep the prefetcher busy with the revisions to send next. */
+          if (prefetcher)
+            for (; prefetched < send_total && !log_prefetcher_full(prefetcher);
+                 prefetched++)
+              SVN_ERR(log_prefetcher_push(
+                        prefetcher,
+                        APR_ARRAY_IDX(revs, revs->nelts - prefetched - 1,
+                                      svn_revnum_t)));
+
           /* If we've got a hash of revision mergeinfo (which can only
              happen if INCLUDE_MERGED_REVISIONS was set), we check to
              see if this revision is one which merged in other
@@ -2083,7 +2690,7 @@ do_logs(svn_fs_t *fs,
                            discover_changed_paths, subtractive_merge,
                            handling_merged_revisions, revprops, has_children,
                            receiver, receiver_baton, authz_read_func,
-                           authz_read_baton, iterpool));
+                           authz_read_baton, prefetcher, iterpool));
           if (has_children)
             {
               if (!nested_merges)
@@ -2092,7 +2699,8 @@ do_logs(svn_fs_t *fs,
                   nested_merges = apr_hash_make(subpool);
                 }
 
-              SVN_ERR(handle_merged_revisions(current, fs,
+              SVN_ERR(handle_merged_revisions(current, fs, log_index,
+                                              mergeinfo_index,
                                               log_target_history_as_mergeinfo,
                                               nested_merges,
                                               processed,
@@ -2200,26 +2808,33 @@ get_paths_history_as_mergeinfo(svn_mergeinfo_t *paths_history_mergeinfo,
   return SVN_NO_ERROR;
 }
 
-svn_error_t *
-svn_repos_get_logs4(svn_repos_t *repos,
-                    const apr_array_header_t *paths,
-                    svn_revnum_t start,
-                    svn_revnum_t end,
-                    int limit,
-                    svn_boolean_t discover_changed_paths,
-                    svn_boolean_t strict_node_history,
-                    svn_boolean_t include_merged_revisions,
-                    const apr_array_header_t *revprops,
-                    svn_repos_authz_func_t authz_read_func,
-                    void *authz_read_baton,
-                    svn_log_entry_receiver_t receiver,
-                    void *receiver_baton,
-                    apr_pool_t *pool)
+/* Implement svn_repos__get_logs_pipelined() for an already created
+   PREFETCHER, which may be NULL.  The other parameters are the same as
+   for svn_repos_get_logs4(). */
+static svn_error_t *
+get_logs(svn_repos_t *repos,
+         const apr_array_header_t *paths,
+         svn_revnum_t start,
+         svn_revnum_t end,
+         int limit,
+         svn_boolean_t discover_changed_paths,
+         svn_boolean_t strict_node_history,
+         svn_boolean_t include_merged_revisions,
+         const apr_array_header_t *revprops,
+         svn_repos_authz_func_t authz_read_func,
+         void *authz_read_baton,
+         log_prefetcher_t *prefetcher,
+         svn_log_entry_receiver_t receiver,
+         void *receiver_baton,
+         apr_pool_t *pool)
 {
   svn_revnum_t head = SVN_INVALID_REVNUM;
   svn_fs_t *fs = repos->fs;
   svn_boolean_t descending_order;
   svn_mergeinfo_t paths_history_mergeinfo = NULL;
+  svn_repos__log_index_t *log_index;
+  svn_repos__mergeinfo_index_t *mergeinfo_index = NULL;
+  svn_error_t *err;
 
   /* Setup log range. */
   SVN_ERR(svn_fs_youngest_rev(&head, fs, pool));
@@ -2265,6 +2880,7 @@ svn_repos_get_logs4(svn_repos_t *repos,
                              "/") == 0)))))
     {
       apr_uint64_t send_count = 0;
+      apr_uint64_t prefetched = 0;
       int i;
       apr_pool_t *iterpool = svn_pool_create(pool);
 
@@ -2298,6 +2914,17 @@ svn_repos_get_logs4(svn_repos_t *repos,
 
           svn_pool_clear(iterpool);
 
+          /* Keep the prefetcher busy with the revisions to send next. */
+          if (prefetcher)
+            for (; prefetched < send_count
+                   && !log_prefetcher_full(prefetcher);
+                 prefetched++)
+              SVN_ERR(log_prefetcher_push(prefetcher,
+                                          descending_order
+                                            ? end - (svn_revnum_t)prefetched
+                                            : start
+                                              + (svn_revnum_t)prefetched));
+
           if (descending_order)
             rev = end - i;
           else
@@ -2305,7 +2932,7 @@ svn_repos_get_logs4(svn_repos_t *repos,
           SVN_ERR(send_log(rev, fs, NULL, NULL, discover_changed_paths, FALSE,
                            FALSE, revprops, FALSE, receiver,
                            receiver_baton, authz_read_func,
-                           authz_read_baton, iterpool));
+                           authz_read_baton, prefetcher, iterpool));
         }
       svn_pool_destroy(iterpool);
 
@@ -2329,9 +2956,115 @@ svn_repos_get_logs4(svn_repos_t *repos,
       svn_pool_destroy(subpool);
     }
 
-  return do_logs(repos->fs, paths, paths_history_mergeinfo, NULL, NULL, start, end,
+  /* Use the log index if there is one.  It's only an optimization, so
+     should it turn out to be unusable, walk the histories without it. */
+  err = svn_repos__log_index_open(&log_index, repos, pool, pool);
+  if (err)
+    {
+      svn_error_clear(err);
+      log_index = NULL;
+    }
+
+  if (include_merged_revisions)
+    {
+      err = svn_repos__mergeinfo_index_open(&mergeinfo_index, repos,
+                                            pool, pool);
+      if (err)
+        {
+          svn_error_clear(err);
+          mergeinfo_index = NULL;
+        }
+    }
+
+  return do_logs(repos->fs, log_index, mergeinfo_index, prefetcher, paths,
+                 paths_history_mergeinfo,
+                 NULL, NULL, start, end,
                  limit, discover_changed_paths, strict_node_history,
                  include_merged_revisions, FALSE, FALSE, FALSE, revprops,
                  descending_order, receiver, receiver_baton,
                  authz_read_func, authz_read_baton, pool);
 }
+
+svn_error_t *
+svn_repos__get_logs_pipelined(svn_repos_t *repos,
+                              const apr_array_header_t *paths,
+                              svn_revnum_t start,
+                              svn_revnum_t end,
+                              int limit,
+                              svn_boolean_t discover_changed_paths,
+                              svn_boolean_t strict_node_history,
+                              svn_boolean_t include_merged_revisions,
+                              const apr_array_header_t *revprops,
+                              svn_repos_authz_func_t authz_read_func,
+                              void *authz_read_baton,
+                              svn_boolean_t authz_thread_safe,
+                              int max_threads,
+                              apr_hash_t *fs_config,
+                              svn_log_entry_receiver_t receiver,
+                              void *receiver_baton,
+                              apr_pool_t *pool)
+{
+  log_prefetcher_t *prefetcher = NULL;
+  apr_pool_t *prefetcher_pool = NULL;
+  svn_error_t *err;
+
+  /* Only the changed paths of revisions sent directly can be prefetched
+     and the FS layer must be prepared for concurrent access. */
+  if (max_threads > 1
+      && (discover_changed_paths || authz_read_func)
+      && ! include_merged_revisions
+      && ! svn_cache_config_get()->single_threaded)
+    {
+      if (authz_read_func && ! authz_thread_safe)
+        {
+          serialized_authz_baton_t *sab = apr_pcalloc(pool, sizeof(*sab));
+
+          sab->authz_read_func = authz_read_func;
+          sab->authz_read_baton = authz_read_baton;
+          SVN_ERR(svn_mutex__init(&sab->mutex, TRUE, pool));
+
+          authz_read_func = serialized_authz_read_func;
+          authz_read_baton = sab;
+        }
+
+      prefetcher_pool = svn_pool_create(pool);
+      SVN_ERR(log_prefetcher_create(&prefetcher, repos->fs, fs_config,
+                                    max_threads, authz_read_func,
+                                    authz_read_baton, prefetcher_pool));
+    }
+
+  err = get_logs(repos, paths, start, end, limit, discover_changed_paths,
+                 strict_node_history, include_merged_revisions, revprops,
+                 authz_read_func, authz_read_baton, prefetcher,
+                 receiver, receiver_baton, pool);
+
+  /* Wait for any remaining jobs and release the worker FS instances. */
+  if (prefetcher_pool)
+    svn_pool_destroy(prefetcher_pool);
+
+  return svn_error_trace(err);
+}
+
+svn_error_t *
+svn_repos_get_logs4(svn_repos_t *repos,
+                    const apr_array_header_t *paths,
+                    svn_revnum_t start,
+                    svn_revnum_t end,
+                    int limit,
+                    svn_boolean_t discover_changed_paths,
+                    svn_boolean_t strict_node_history,
+                    svn_boolean_t include_merged_revisions,
+                    const apr_array_header_t *revprops,
+                    svn_repos_authz_func_t authz_read_func,
+                    void *authz_read_baton,
+                    svn_log_entry_receiver_t receiver,
+                    void *receiver_baton,
+                    apr_pool_t *pool)
+{
+  return svn_error_trace(svn_repos__get_logs_pipelined(
+                           repos, paths, start, end, limit,
+                           discover_changed_paths, strict_node_history,
+                           include_merged_revisions, revprops,
+                           authz_read_func, authz_read_baton, FALSE,
+                           1, NULL, receiver, receiver_baton, pool));
+}
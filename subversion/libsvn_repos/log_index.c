@@ -0,0 +1,385 @@
+/* log_index.c --- index of the revisions in which paths changed
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+
+/* The log index lists for every path the revisions in which the path
+ * itself or anything below it has been changed.  That is exactly the
+ * set of revisions that the node history of the path reports as long
+ * as no copy is involved, so svn_repos_get_logs4() can use it to jump
+ * straight from one interesting revision to the next.
+ *
+ * The index is optional.  It is used and maintained only if its
+ * database exists, which "svnadmin build-log-index" creates.  Commits
+ * add their revision, together with any others that are missing, but
+ * readers never write to the index.  They use it for the revisions it
+ * covers and walk the node history for anything younger.
+ */
+
+#include "svn_pools.h"
+#include "svn_error.h"
+#include "svn_dirent_uri.h"
+#include "svn_io.h"
+#include "svn_fs.h"
+#include "svn_repos.h"
+#include "repos.h"
+#include "svn_private_config.h"
+#include "private/svn_fspath.h"
+#include "private/svn_repos_private.h"
+#include "private/svn_sqlite.h"
+
+#include "log-index-db.h"
+
+/* A few magic values */
+#define LOG_INDEX_SCHEMA_FORMAT   1
+
+/* Add at most this many revisions to the index per SQLite transaction,
+   so that building the index for a large repository may be interrupted
+   without losing all progress. */
+#define LOG_INDEX_BATCH_SIZE      1000
+
+LOG_INDEX_DB_SQL_DECLARE_STATEMENTS(statements);
+
+
+struct svn_repos__log_index_t
+{
+  svn_sqlite__db_t *sdb;
+
+  /* The youngest revision in the index when it was opened. */
+  svn_revnum_t indexed;
+};
+
+
+/** Helper functions. **/
+
+/* Return the path of the log index database of REPOS. */
+static const char *
+path_log_index_db(svn_repos_t *repos,
+                  apr_pool_t *result_pool)
+{
+  return svn_dirent_join(repos->db_path, SVN_REPOS__LOG_INDEX_DB,
+                         result_pool);
+}
+
+/* Open the log index database of REPOS in *SDB using MODE, creating its
+   schema if necessary.  If MODE is svn_sqlite__mode_readonly and there is
+   no schema yet, set *SDB to NULL. */
+static svn_error_t *
+open_log_index_db(svn_sqlite__db_t **sdb,
+                  svn_repos_t *repos,
+                  svn_sqlite__mode_t mode,
+                  apr_pool_t *result_pool,
+                  apr_pool_t *scratch_pool)
+{
+  int version;
+
+  SVN_ERR(svn_sqlite__open(sdb, path_log_index_db(repos, scratch_pool),
+                           mode, statements, 0, NULL,
+                           result_pool, scratch_pool));
+
+  SVN_ERR(svn_sqlite__read_schema_version(&version, *sdb, scratch_pool));
+  if (version < LOG_INDEX_SCHEMA_FORMAT
+      && mode == svn_sqlite__mode_readonly)
+    {
+      SVN_ERR(svn_sqlite__close(*sdb));
+      *sdb = NULL;
+    }
+  else if (version < LOG_INDEX_SCHEMA_FORMAT)
+    {
+      /* Must be 0 -- an uninitialized (no schema) database. Create
+         the schema. Results in schema version of 1.  */
+      SVN_ERR(svn_sqlite__exec_statements(*sdb, STMT_CREATE_SCHEMA));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *REV to the youngest revision that has been added to SDB. */
+static svn_error_t *
+get_indexed_revision(svn_revnum_t *rev,
+                     svn_sqlite__db_t *sdb)
+{
+  svn_sqlite__stmt_t *stmt;
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb, STMT_GET_INDEXED_REVISION));
+  SVN_ERR(svn_sqlite__step_row(stmt));
+  *rev = svn_sqlite__column_revnum(stmt, 0);
+
+  return svn_error_trace(svn_sqlite__reset(stmt));
+}
+
+/* Add the paths changed in revision REV of FS and all their parent
+   directories to SDB. */
+static svn_error_t *
+index_revision(svn_sqlite__db_t *sdb,
+               svn_fs_t *fs,
+               svn_revnum_t rev,
+               apr_pool_t *scratch_pool)
+{
+  svn_fs_root_t *root;
+  apr_hash_t *changes;
+  apr_hash_t *added = apr_hash_make(scratch_pool);
+  apr_hash_index_t *hi;
+  svn_sqlite__stmt_t *stmt;
+
+  SVN_ERR(svn_fs_revision_root(&root, fs, rev, scratch_pool));
+  SVN_ERR(svn_fs_paths_changed2(&changes, root, scratch_pool));
+  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb, STMT_ADD_CHANGE));
+
+  for (hi = apr_hash_first(scratch_pool, changes); hi; hi = apr_hash_next(hi))
+    {
+      const char *path = svn__apr_hash_index_key(hi);
+
+      /* Walk up until we reach a parent that has been added already. */
+      while (! apr_hash_get(added, path, APR_HASH_KEY_STRING))
+        {
+          apr_hash_set(added, path, APR_HASH_KEY_STRING, path);
+          SVN_ERR(svn_sqlite__bindf(stmt, "sr", path, rev));
+          SVN_ERR(svn_sqlite__insert(NULL, stmt));
+
+          if (svn_fspath__is_root(path, strlen(path)))
+            break;
+          path = svn_fspath__dirname(path, scratch_pool);
+        }
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Baton for index_batch(). */
+typedef struct index_batch_baton_t
+{
+  svn_fs_t *fs;
+
+  /* Index no revisions younger than this one. */
+  svn_revnum_t youngest;
+
+  /* Set to the youngest revision in the index after the batch. */
+  svn_revnum_t indexed;
+} index_batch_baton_t;
+
+/* Implements svn_sqlite__transaction_callback_t.  Add the next batch of
+   revisions to the index.  As this runs inside a write transaction,
+   concurrent writers never add the same revisions. */
+static svn_error_t *
+index_batch(void *baton,
+            svn_sqlite__db_t *sdb,
+            apr_pool_t *scratch_pool)
+{
+  index_batch_baton_t *b = baton;
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  svn_revnum_t rev, last;
+  svn_sqlite__stmt_t *stmt;
+
+  SVN_ERR(get_indexed_revision(&b->indexed, sdb));
+
+  last = b->indexed + LOG_INDEX_BATCH_SIZE;
+  if (last > b->youngest)
+    last = b->youngest;
+
+  for (rev = b->indexed + 1; rev <= last; rev++)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(index_revision(sdb, b->fs, rev, iterpool));
+    }
+  svn_pool_destroy(iterpool);
+
+  if (last > b->indexed)
+    {
+      SVN_ERR(svn_sqlite__get_statement(&stmt, sdb,
+                                        STMT_SET_INDEXED_REVISION));
+      SVN_ERR(svn_sqlite__bindf(stmt, "r", last));
+      SVN_ERR(svn_sqlite__update(NULL, stmt));
+      b->indexed = last;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Add all revisions of REPOS that are missing from SDB to it.  Set
+   *INDEXED to the youngest revision in the index afterwards, which may
+   exceed YOUNGEST if the index does not belong to REPOS. */
+static svn_error_t *
+catch_up(svn_revnum_t *indexed,
+         svn_sqlite__db_t *sdb,
+         svn_repos_t *repos,
+         svn_revnum_t youngest,
+         svn_cancel_func_t cancel_func,
+         void *cancel_baton,
+         apr_pool_t *scratch_pool)
+{
+  index_batch_baton_t b;
+
+  b.fs = repos->fs;
+  b.youngest = youngest;
+
+  SVN_ERR(get_indexed_revision(&b.indexed, sdb));
+  while (b.indexed < youngest)
+    {
+      if (cancel_func)
+        SVN_ERR(cancel_func(cancel_baton));
+
+      SVN_ERR(svn_sqlite__with_immediate_transaction(sdb, index_batch, &b,
+                                                     scratch_pool));
+    }
+
+  *indexed = b.indexed;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_sqlite__transaction_callback_t.  Empty the index. */
+static svn_error_t *
+clear_index(void *baton,
+            svn_sqlite__db_t *sdb,
+            apr_pool_t *scratch_pool)
+{
+  return svn_error_trace(svn_sqlite__exec_statements(sdb, STMT_CLEAR));
+}
+
+/* Set *EXISTS to whether REPOS has a log index. */
+static svn_error_t *
+log_index_exists(svn_boolean_t *exists,
+                 svn_repos_t *repos,
+                 apr_pool_t *scratch_pool)
+{
+  svn_node_kind_t kind;
+
+  SVN_ERR(svn_io_check_path(path_log_index_db(repos, scratch_pool),
+                            &kind, scratch_pool));
+  *exists = (kind != svn_node_none);
+
+  return SVN_NO_ERROR;
+}
+
+
+/** Library-private API's. **/
+
+svn_error_t *
+svn_repos__log_index_open(svn_repos__log_index_t **index_p,
+                          svn_repos_t *repos,
+                          apr_pool_t *result_pool,
+                          apr_pool_t *scratch_pool)
+{
+  svn_boolean_t exists;
+  svn_sqlite__db_t *sdb;
+  svn_revnum_t youngest, indexed;
+
+  *index_p = NULL;
+
+  SVN_ERR(log_index_exists(&exists, repos, scratch_pool));
+  if (! exists)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(open_log_index_db(&sdb, repos, svn_sqlite__mode_readonly,
+                            result_pool, scratch_pool));
+  if (! sdb)
+    return SVN_NO_ERROR;
+
+  /* Read the youngest revision after the index state, so that the index
+     can never claim revisions that REPOS does not have yet. */
+  SVN_ERR(get_indexed_revision(&indexed, sdb));
+  SVN_ERR(svn_fs_youngest_rev(&youngest, repos->fs, scratch_pool));
+
+  /* An index of revisions that don't exist in REPOS must not be used. */
+  if (indexed > youngest)
+    return svn_error_trace(svn_sqlite__close(sdb));
+
+  *index_p = apr_palloc(result_pool, sizeof(**index_p));
+  (*index_p)->sdb = sdb;
+  (*index_p)->indexed = indexed;
+
+  return SVN_NO_ERROR;
+}
+
+svn_revnum_t
+svn_repos__log_index_indexed_rev(svn_repos__log_index_t *index)
+{
+  return index->indexed;
+}
+
+svn_error_t *
+svn_repos__log_index_youngest_change(svn_revnum_t *rev,
+                                     svn_repos__log_index_t *index,
+                                     const char *path,
+                                     svn_revnum_t start,
+                                     svn_revnum_t end,
+                                     apr_pool_t *scratch_pool)
+{
+  svn_sqlite__stmt_t *stmt;
+  svn_boolean_t have_row;
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, index->sdb,
+                                    STMT_GET_YOUNGEST_CHANGE));
+  SVN_ERR(svn_sqlite__bindf(stmt, "srr", path, start, end));
+  SVN_ERR(svn_sqlite__step(&have_row, stmt));
+
+  *rev = have_row ? svn_sqlite__column_revnum(stmt, 0) : SVN_INVALID_REVNUM;
+
+  return svn_error_trace(svn_sqlite__reset(stmt));
+}
+
+svn_error_t *
+svn_repos__log_index_update(svn_repos_t *repos,
+                            apr_pool_t *scratch_pool)
+{
+  svn_revnum_t youngest, indexed;
+
+  /* Keep the database open for further commits through REPOS. */
+  if (! repos->log_index_sdb)
+    {
+      svn_boolean_t exists;
+
+      SVN_ERR(log_index_exists(&exists, repos, scratch_pool));
+      if (! exists)
+        return SVN_NO_ERROR;
+
+      SVN_ERR(open_log_index_db(&repos->log_index_sdb, repos,
+                                svn_sqlite__mode_readwrite, repos->pool,
+                                scratch_pool));
+    }
+
+  SVN_ERR(svn_fs_youngest_rev(&youngest, repos->fs, scratch_pool));
+  return svn_error_trace(catch_up(&indexed, repos->log_index_sdb, repos,
+                                  youngest, NULL, NULL, scratch_pool));
+}
+
+svn_error_t *
+svn_repos__build_log_index(svn_revnum_t *youngest,
+                           svn_repos_t *repos,
+                           svn_cancel_func_t cancel_func,
+                           void *cancel_baton,
+                           apr_pool_t *scratch_pool)
+{
+  svn_sqlite__db_t *sdb;
+  svn_revnum_t indexed;
+
+  SVN_ERR(open_log_index_db(&sdb, repos, svn_sqlite__mode_rwcreate,
+                            scratch_pool, scratch_pool));
+  SVN_ERR(svn_sqlite__with_immediate_transaction(sdb, clear_index, NULL,
+                                                 scratch_pool));
+
+  SVN_ERR(svn_fs_youngest_rev(youngest, repos->fs, scratch_pool));
+  SVN_ERR(catch_up(&indexed, sdb, repos, *youngest, cancel_func,
+                   cancel_baton, scratch_pool));
+
+  return svn_error_trace(svn_sqlite__close(sdb));
+}
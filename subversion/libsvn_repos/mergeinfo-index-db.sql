@@ -0,0 +1,149 @@
+/* mergeinfo-index-db.sql -- schema of the mergeinfo index
+ *   This is intended for use with SQLite 3
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+-- STMT_CREATE_SCHEMA
+PRAGMA AUTO_VACUUM = 1;
+
+/* The mergeinfo changes of every revision as determined for
+   "svn log -g":  For every path whose svn:mergeinfo property changed in
+   meaning, the mergeinfo removed from and added to it in unparsed form.
+   Either may be the empty string. */
+CREATE TABLE mergeinfo_changes (
+  revision INTEGER NOT NULL,
+  path TEXT NOT NULL,
+  deleted TEXT NOT NULL,
+  added TEXT NOT NULL,
+  PRIMARY KEY (revision, path)
+  );
+
+/* Revisions whose mergeinfo changes could not be determined because
+   of syntactically invalid mergeinfo. */
+CREATE TABLE invalid_revisions (
+  revision INTEGER NOT NULL PRIMARY KEY
+  );
+
+/* The paths added or replaced in every revision, with or without
+   history.  Their mergeinfo and the mergeinfo inherited by everything
+   below them may have changed without a change of svn:mergeinfo. */
+CREATE TABLE added_nodes (
+  revision INTEGER NOT NULL,
+  path TEXT NOT NULL,
+  PRIMARY KEY (revision, path)
+  );
+
+/* The revision ranges START_REV <= REVISION < END_REV in which the
+   node at RELPATH (without leading slash) has an svn:mergeinfo property.
+   END_REV is NULL as long as it still has one. */
+CREATE TABLE mergeinfo_nodes (
+  relpath TEXT NOT NULL,
+  start_rev INTEGER NOT NULL,
+  end_rev INTEGER,
+  PRIMARY KEY (relpath, start_rev)
+  );
+
+/* The youngest revision that has been added to the index.  There is
+   only ever one row. */
+CREATE TABLE indexed_revision (
+  revision INTEGER NOT NULL
+  );
+
+INSERT INTO indexed_revision (revision) VALUES (0);
+
+PRAGMA USER_VERSION = 1;
+
+
+-- STMT_ADD_MERGEINFO_CHANGE
+INSERT OR REPLACE INTO mergeinfo_changes (revision, path, deleted, added)
+VALUES (?1, ?2, ?3, ?4)
+
+-- STMT_ADD_INVALID_REVISION
+INSERT OR IGNORE INTO invalid_revisions (revision)
+VALUES (?1)
+
+-- STMT_ADD_ADDED_NODE
+INSERT OR IGNORE INTO added_nodes (revision, path)
+VALUES (?1, ?2)
+
+-- STMT_SELECT_MERGEINFO_CHANGES
+SELECT path, deleted, added
+FROM mergeinfo_changes
+WHERE revision = ?1
+
+-- STMT_SELECT_INVALID_REVISION
+SELECT 1
+FROM invalid_revisions
+WHERE revision = ?1
+
+-- STMT_SELECT_ADDED_NODES
+SELECT path
+FROM added_nodes
+WHERE revision = ?1
+
+-- STMT_SELECT_MERGEINFO_NODES
+SELECT relpath
+FROM mergeinfo_nodes
+WHERE (relpath = ?1 OR IS_STRICT_DESCENDANT_OF(relpath, ?1))
+  AND start_rev <= ?2 AND (end_rev IS NULL OR end_rev > ?2)
+
+-- STMT_SELECT_MERGEINFO_DESCENDANTS
+SELECT relpath
+FROM mergeinfo_nodes
+WHERE IS_STRICT_DESCENDANT_OF(relpath, ?1)
+  AND start_rev <= ?2 AND (end_rev IS NULL OR end_rev > ?2)
+
+-- STMT_SELECT_OPEN_MERGEINFO_NODE
+SELECT 1
+FROM mergeinfo_nodes
+WHERE relpath = ?1 AND end_rev IS NULL
+
+-- STMT_OPEN_MERGEINFO_NODE
+INSERT OR REPLACE INTO mergeinfo_nodes (relpath, start_rev, end_rev)
+VALUES (?1, ?2, NULL)
+
+/* Ranges opened in revision ?3 itself would become empty when closed,
+   so remove them instead. */
+-- STMT_DELETE_NEW_MERGEINFO_NODES
+DELETE FROM mergeinfo_nodes
+WHERE (relpath = ?1 OR (?2 AND IS_STRICT_DESCENDANT_OF(relpath, ?1)))
+  AND end_rev IS NULL AND start_rev = ?3
+
+-- STMT_CLOSE_MERGEINFO_NODES
+UPDATE mergeinfo_nodes
+SET end_rev = ?3
+WHERE (relpath = ?1 OR (?2 AND IS_STRICT_DESCENDANT_OF(relpath, ?1)))
+  AND end_rev IS NULL
+
+-- STMT_GET_INDEXED_REVISION
+SELECT revision
+FROM indexed_revision
+
+-- STMT_SET_INDEXED_REVISION
+UPDATE indexed_revision
+SET revision = ?1
+
+-- STMT_CLEAR
+DELETE FROM mergeinfo_changes;
+DELETE FROM invalid_revisions;
+DELETE FROM added_nodes;
+DELETE FROM mergeinfo_nodes;
+UPDATE indexed_revision SET revision = 0;
@@ -0,0 +1,657 @@
+/* mergeinfo_index.c --- index of mergeinfo changes and mergeinfo nodes
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+
+/* The mergeinfo index records two things for every revision:
+ *
+ * - The mergeinfo deltas that svn_repos__mergeinfo_changed() reports
+ *   for it, together with the paths added or replaced in it.  This lets
+ *   "svn log -g" tell which revisions merged something without fetching
+ *   and parsing svn:mergeinfo properties, and without looking at the
+ *   inherited mergeinfo of its paths in revisions that cannot have
+ *   changed it.
+ *
+ * - The revision ranges in which each node carries an svn:mergeinfo
+ *   property.  This lets svn_repos_fs_get_mergeinfo() find the
+ *   descendants of a path that have explicit mergeinfo without crawling
+ *   the directory tree.
+ *
+ * Like the log index, it is optional.  It is used and maintained only if
+ * its database exists, which "svnadmin build-mergeinfo-index" creates.
+ * Commits add their revision, together with any others that are missing,
+ * but readers never write to the index.  For revisions it does not cover
+ * yet, they fall back to reading the repository.
+ */
+
+#include "svn_pools.h"
+#include "svn_error.h"
+#include "svn_dirent_uri.h"
+#include "svn_io.h"
+#include "svn_fs.h"
+#include "svn_repos.h"
+#include "svn_props.h"
+#include "svn_sorts.h"
+#include "svn_mergeinfo.h"
+#include "repos.h"
+#include "svn_private_config.h"
+#include "private/svn_fspath.h"
+#include "private/svn_repos_private.h"
+#include "private/svn_sqlite.h"
+
+#include "mergeinfo-index-db.h"
+
+/* A few magic values */
+#define MERGEINFO_INDEX_SCHEMA_FORMAT   1
+
+/* Add at most this many revisions to the index per SQLite transaction,
+   so that building the index for a large repository may be interrupted
+   without losing all progress. */
+#define MERGEINFO_INDEX_BATCH_SIZE      1000
+
+MERGEINFO_INDEX_DB_SQL_DECLARE_STATEMENTS(statements);
+
+
+struct svn_repos__mergeinfo_index_t
+{
+  svn_sqlite__db_t *sdb;
+
+  /* The youngest revision in the index when it was opened. */
+  svn_revnum_t indexed;
+};
+
+
+/** Helper functions. **/
+
+/* Return the path of the mergeinfo index database of REPOS. */
+static const char *
+path_mergeinfo_index_db(svn_repos_t *repos,
+                        apr_pool_t *result_pool)
+{
+  return svn_dirent_join(repos->db_path, SVN_REPOS__MERGEINFO_INDEX_DB,
+                         result_pool);
+}
+
+/* Open the mergeinfo index database of REPOS in *SDB using MODE,
+   creating its schema if necessary.  If MODE is svn_sqlite__mode_readonly
+   and there is no schema yet, set *SDB to NULL. */
+static svn_error_t *
+open_mergeinfo_index_db(svn_sqlite__db_t **sdb,
+                        svn_repos_t *repos,
+                        svn_sqlite__mode_t mode,
+                        apr_pool_t *result_pool,
+                        apr_pool_t *scratch_pool)
+{
+  int version;
+
+  SVN_ERR(svn_sqlite__open(sdb, path_mergeinfo_index_db(repos, scratch_pool),
+                           mode, statements, 0, NULL,
+                           result_pool, scratch_pool));
+
+  SVN_ERR(svn_sqlite__read_schema_version(&version, *sdb, scratch_pool));
+  if (version < MERGEINFO_INDEX_SCHEMA_FORMAT
+      && mode == svn_sqlite__mode_readonly)
+    {
+      SVN_ERR(svn_sqlite__close(*sdb));
+      *sdb = NULL;
+    }
+  else if (version < MERGEINFO_INDEX_SCHEMA_FORMAT)
+    {
+      /* Must be 0 -- an uninitialized (no schema) database. Create
+         the schema. Results in schema version of 1.  */
+      SVN_ERR(svn_sqlite__exec_statements(*sdb, STMT_CREATE_SCHEMA));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *REV to the youngest revision that has been added to SDB. */
+static svn_error_t *
+get_indexed_revision(svn_revnum_t *rev,
+                     svn_sqlite__db_t *sdb)
+{
+  svn_sqlite__stmt_t *stmt;
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb, STMT_GET_INDEXED_REVISION));
+  SVN_ERR(svn_sqlite__step_row(stmt));
+  *rev = svn_sqlite__column_revnum(stmt, 0);
+
+  return svn_error_trace(svn_sqlite__reset(stmt));
+}
+
+/* Return the path FSPATH in the form used by the mergeinfo_nodes table. */
+static const char *
+node_relpath(const char *fspath)
+{
+  return fspath + 1;
+}
+
+/* Set *RELPATHS to the relpaths (const char *) of all nodes at or, if
+   INCLUDE_SELF is FALSE, strictly below RELPATH that have mergeinfo in
+   revision REV according to SDB. */
+static svn_error_t *
+get_mergeinfo_nodes(apr_array_header_t **relpaths,
+                    svn_sqlite__db_t *sdb,
+                    const char *relpath,
+                    svn_boolean_t include_self,
+                    svn_revnum_t rev,
+                    apr_pool_t *result_pool)
+{
+  svn_sqlite__stmt_t *stmt;
+  svn_boolean_t have_row;
+
+  *relpaths = apr_array_make(result_pool, 0, sizeof(const char *));
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb,
+                                    include_self
+                                      ? STMT_SELECT_MERGEINFO_NODES
+                                      : STMT_SELECT_MERGEINFO_DESCENDANTS));
+  SVN_ERR(svn_sqlite__bindf(stmt, "sr", relpath, rev));
+  SVN_ERR(svn_sqlite__step(&have_row, stmt));
+  while (have_row)
+    {
+      APR_ARRAY_PUSH(*relpaths, const char *)
+        = svn_sqlite__column_text(stmt, 0, result_pool);
+      SVN_ERR(svn_sqlite__step(&have_row, stmt));
+    }
+
+  return svn_error_trace(svn_sqlite__reset(stmt));
+}
+
+/* Record in SDB that RELPATH and, if RECURSIVE is set, all nodes below
+   it lose their mergeinfo in revision REV. */
+static svn_error_t *
+close_mergeinfo_nodes(svn_sqlite__db_t *sdb,
+                      const char *relpath,
+                      svn_boolean_t recursive,
+                      svn_revnum_t rev)
+{
+  svn_sqlite__stmt_t *stmt;
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb,
+                                    STMT_DELETE_NEW_MERGEINFO_NODES));
+  SVN_ERR(svn_sqlite__bindf(stmt, "sdr", relpath, recursive, rev));
+  SVN_ERR(svn_sqlite__update(NULL, stmt));
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb, STMT_CLOSE_MERGEINFO_NODES));
+  SVN_ERR(svn_sqlite__bindf(stmt, "sdr", relpath, recursive, rev));
+  SVN_ERR(svn_sqlite__update(NULL, stmt));
+
+  return SVN_NO_ERROR;
+}
+
+/* Record in SDB that RELPATH gains mergeinfo in revision REV. */
+static svn_error_t *
+open_mergeinfo_node(svn_sqlite__db_t *sdb,
+                    const char *relpath,
+                    svn_revnum_t rev)
+{
+  svn_sqlite__stmt_t *stmt;
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb, STMT_OPEN_MERGEINFO_NODE));
+  SVN_ERR(svn_sqlite__bindf(stmt, "sr", relpath, rev));
+
+  return svn_error_trace(svn_sqlite__insert(NULL, stmt));
+}
+
+/* Add the mergeinfo changes of revision REV in FS to SDB. */
+static svn_error_t *
+index_mergeinfo_changes(svn_sqlite__db_t *sdb,
+                        svn_fs_t *fs,
+                        svn_revnum_t rev,
+                        apr_pool_t *scratch_pool)
+{
+  svn_mergeinfo_catalog_t deleted_catalog, added_catalog;
+  apr_hash_index_t *hi;
+  svn_sqlite__stmt_t *stmt;
+  svn_error_t *err;
+
+  err = svn_repos__mergeinfo_changed(&deleted_catalog, &added_catalog,
+                                     fs, rev, scratch_pool, scratch_pool);
+  if (err && err->apr_err == SVN_ERR_MERGEINFO_PARSE_ERROR)
+    {
+      /* Remember that this revision must be treated as if it didn't
+         change any mergeinfo (issue #3896). */
+      svn_error_clear(err);
+      SVN_ERR(svn_sqlite__get_statement(&stmt, sdb,
+                                        STMT_ADD_INVALID_REVISION));
+      SVN_ERR(svn_sqlite__bindf(stmt, "r", rev));
+      return svn_error_trace(svn_sqlite__insert(NULL, stmt));
+    }
+  SVN_ERR(err);
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb, STMT_ADD_MERGEINFO_CHANGE));
+  for (hi = apr_hash_first(scratch_pool, deleted_catalog);
+       hi;
+       hi = apr_hash_next(hi))
+    {
+      const char *path = svn__apr_hash_index_key(hi);
+      svn_mergeinfo_t deleted = svn__apr_hash_index_val(hi);
+      svn_mergeinfo_t added = apr_hash_get(added_catalog, path,
+                                           APR_HASH_KEY_STRING);
+      svn_string_t *deleted_str, *added_str;
+
+      SVN_ERR(svn_mergeinfo_to_string(&deleted_str, deleted, scratch_pool));
+      SVN_ERR(svn_mergeinfo_to_string(&added_str, added, scratch_pool));
+      SVN_ERR(svn_sqlite__bindf(stmt, "rsss", rev, path,
+                                deleted_str->data, added_str->data));
+      SVN_ERR(svn_sqlite__insert(NULL, stmt));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Add the added nodes of revision REV in FS to SDB and update the
+   lifetimes of the nodes with mergeinfo. */
+static svn_error_t *
+index_mergeinfo_nodes(svn_sqlite__db_t *sdb,
+                      svn_fs_t *fs,
+                      svn_revnum_t rev,
+                      apr_pool_t *scratch_pool)
+{
+  svn_fs_root_t *root;
+  apr_hash_t *changes;
+  apr_array_header_t *sorted;
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  svn_sqlite__stmt_t *stmt;
+  int i;
+
+  SVN_ERR(svn_fs_revision_root(&root, fs, rev, scratch_pool));
+  SVN_ERR(svn_fs_paths_changed2(&changes, root, scratch_pool));
+
+  /* Parents before children, so that a copy is in place before any
+     changes made below it in the same revision get applied. */
+  sorted = svn_sort__hash(changes, svn_sort_compare_items_as_paths,
+                          scratch_pool);
+
+  for (i = 0; i < sorted->nelts; i++)
+    {
+      svn_sort__item_t *item = &APR_ARRAY_IDX(sorted, i, svn_sort__item_t);
+      const char *path = item->key;
+      svn_fs_path_change2_t *change = item->value;
+      const char *relpath = node_relpath(path);
+
+      svn_pool_clear(iterpool);
+
+      if (change->change_kind == svn_fs_path_change_reset)
+        continue;
+
+      /* Anything that was there before is gone now. */
+      if (change->change_kind == svn_fs_path_change_delete
+          || change->change_kind == svn_fs_path_change_replace)
+        SVN_ERR(close_mergeinfo_nodes(sdb, relpath, TRUE, rev));
+
+      if (change->change_kind == svn_fs_path_change_delete)
+        continue;
+
+      if (change->change_kind == svn_fs_path_change_add
+          || change->change_kind == svn_fs_path_change_replace)
+        {
+          const char *copyfrom_path;
+          svn_revnum_t copyfrom_rev;
+
+          SVN_ERR(svn_sqlite__get_statement(&stmt, sdb,
+                                            STMT_ADD_ADDED_NODE));
+          SVN_ERR(svn_sqlite__bindf(stmt, "rs", rev, path));
+          SVN_ERR(svn_sqlite__insert(NULL, stmt));
+
+          /* A copy brings along all mergeinfo of its source. */
+          SVN_ERR(svn_fs_copied_from(&copyfrom_rev, &copyfrom_path,
+                                     root, path, iterpool));
+          if (copyfrom_path && SVN_IS_VALID_REVNUM(copyfrom_rev))
+            {
+              const char *copyfrom_relpath = node_relpath(copyfrom_path);
+              apr_array_header_t *relpaths;
+              int j;
+
+              SVN_ERR(get_mergeinfo_nodes(&relpaths, sdb, copyfrom_relpath,
+                                          TRUE, copyfrom_rev, iterpool));
+              for (j = 0; j < relpaths->nelts; j++)
+                {
+                  const char *source = APR_ARRAY_IDX(relpaths, j,
+                                                     const char *);
+                  const char *target
+                    = svn_relpath_join(relpath,
+                                       svn_relpath_skip_ancestor(
+                                         copyfrom_relpath, source),
+                                       iterpool);
+
+                  SVN_ERR(open_mergeinfo_node(sdb, target, rev));
+                }
+            }
+        }
+
+      /* An explicit property change may add or remove mergeinfo. */
+      if (change->prop_mod)
+        {
+          svn_string_t *mergeinfo;
+          svn_boolean_t have_row;
+
+          SVN_ERR(svn_fs_node_prop(&mergeinfo, root, path,
+                                   SVN_PROP_MERGEINFO, iterpool));
+
+          SVN_ERR(svn_sqlite__get_statement(&stmt, sdb,
+                                            STMT_SELECT_OPEN_MERGEINFO_NODE));
+          SVN_ERR(svn_sqlite__bindf(stmt, "s", relpath));
+          SVN_ERR(svn_sqlite__step(&have_row, stmt));
+          SVN_ERR(svn_sqlite__reset(stmt));
+
+          if (mergeinfo && ! have_row)
+            SVN_ERR(open_mergeinfo_node(sdb, relpath, rev));
+          else if (! mergeinfo && have_row)
+            SVN_ERR(close_mergeinfo_nodes(sdb, relpath, FALSE, rev));
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+/* Baton for index_batch(). */
+typedef struct index_batch_baton_t
+{
+  svn_fs_t *fs;
+
+  /* Index no revisions younger than this one. */
+  svn_revnum_t youngest;
+
+  /* Set to the youngest revision in the index after the batch. */
+  svn_revnum_t indexed;
+} index_batch_baton_t;
+
+/* Implements svn_sqlite__transaction_callback_t.  Add the next batch of
+   revisions to the index.  As this runs inside a write transaction,
+   concurrent writers never add the same revisions. */
+static svn_error_t *
+index_batch(void *baton,
+            svn_sqlite__db_t *sdb,
+            apr_pool_t *scratch_pool)
+{
+  index_batch_baton_t *b = baton;
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  svn_revnum_t rev, last;
+  svn_sqlite__stmt_t *stmt;
+
+  SVN_ERR(get_indexed_revision(&b->indexed, sdb));
+
+  last = b->indexed + MERGEINFO_INDEX_BATCH_SIZE;
+  if (last > b->youngest)
+    last = b->youngest;
+
+  for (rev = b->indexed + 1; rev <= last; rev++)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(index_mergeinfo_changes(sdb, b->fs, rev, iterpool));
+      SVN_ERR(index_mergeinfo_nodes(sdb, b->fs, rev, iterpool));
+    }
+  svn_pool_destroy(iterpool);
+
+  if (last > b->indexed)
+    {
+      SVN_ERR(svn_sqlite__get_statement(&stmt, sdb,
+                                        STMT_SET_INDEXED_REVISION));
+      SVN_ERR(svn_sqlite__bindf(stmt, "r", last));
+      SVN_ERR(svn_sqlite__update(NULL, stmt));
+      b->indexed = last;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Add all revisions of REPOS that are missing from SDB to it.  Set
+   *INDEXED to the youngest revision in the index afterwards, which may
+   exceed YOUNGEST if the index does not belong to REPOS. */
+static svn_error_t *
+catch_up(svn_revnum_t *indexed,
+         svn_sqlite__db_t *sdb,
+         svn_repos_t *repos,
+         svn_revnum_t youngest,
+         svn_cancel_func_t cancel_func,
+         void *cancel_baton,
+         apr_pool_t *scratch_pool)
+{
+  index_batch_baton_t b;
+
+  b.fs = repos->fs;
+  b.youngest = youngest;
+
+  SVN_ERR(get_indexed_revision(&b.indexed, sdb));
+  while (b.indexed < youngest)
+    {
+      if (cancel_func)
+        SVN_ERR(cancel_func(cancel_baton));
+
+      SVN_ERR(svn_sqlite__with_immediate_transaction(sdb, index_batch, &b,
+                                                     scratch_pool));
+    }
+
+  *indexed = b.indexed;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_sqlite__transaction_callback_t.  Empty the index. */
+static svn_error_t *
+clear_index(void *baton,
+            svn_sqlite__db_t *sdb,
+            apr_pool_t *scratch_pool)
+{
+  return svn_error_trace(svn_sqlite__exec_statements(sdb, STMT_CLEAR));
+}
+
+/* Set *EXISTS to whether REPOS has a mergeinfo index. */
+static svn_error_t *
+mergeinfo_index_exists(svn_boolean_t *exists,
+                       svn_repos_t *repos,
+                       apr_pool_t *scratch_pool)
+{
+  svn_node_kind_t kind;
+
+  SVN_ERR(svn_io_check_path(path_mergeinfo_index_db(repos, scratch_pool),
+                            &kind, scratch_pool));
+  *exists = (kind != svn_node_none);
+
+  return SVN_NO_ERROR;
+}
+
+
+/** Library-private API's. **/
+
+svn_error_t *
+svn_repos__mergeinfo_index_open(svn_repos__mergeinfo_index_t **index_p,
+                                svn_repos_t *repos,
+                                apr_pool_t *result_pool,
+                                apr_pool_t *scratch_pool)
+{
+  svn_boolean_t exists;
+  svn_sqlite__db_t *sdb;
+  svn_revnum_t youngest, indexed;
+
+  *index_p = NULL;
+
+  SVN_ERR(mergeinfo_index_exists(&exists, repos, scratch_pool));
+  if (! exists)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(open_mergeinfo_index_db(&sdb, repos, svn_sqlite__mode_readonly,
+                                  result_pool, scratch_pool));
+  if (! sdb)
+    return SVN_NO_ERROR;
+
+  /* Read the youngest revision after the index state, so that the index
+     can never claim revisions that REPOS does not have yet. */
+  SVN_ERR(get_indexed_revision(&indexed, sdb));
+  SVN_ERR(svn_fs_youngest_rev(&youngest, repos->fs, scratch_pool));
+
+  /* An index of revisions that don't exist in REPOS must not be used. */
+  if (indexed > youngest)
+    return svn_error_trace(svn_sqlite__close(sdb));
+
+  *index_p = apr_palloc(result_pool, sizeof(**index_p));
+  (*index_p)->sdb = sdb;
+  (*index_p)->indexed = indexed;
+
+  return SVN_NO_ERROR;
+}
+
+svn_revnum_t
+svn_repos__mergeinfo_index_indexed_rev(svn_repos__mergeinfo_index_t *index)
+{
+  return index->indexed;
+}
+
+svn_error_t *
+svn_repos__mergeinfo_index_changes(svn_mergeinfo_catalog_t *deleted_catalog,
+                                   svn_mergeinfo_catalog_t *added_catalog,
+                                   apr_array_header_t **added_nodes,
+                                   svn_repos__mergeinfo_index_t *index,
+                                   svn_revnum_t rev,
+                                   apr_pool_t *result_pool,
+                                   apr_pool_t *scratch_pool)
+{
+  svn_sqlite__stmt_t *stmt;
+  svn_boolean_t have_row;
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, index->sdb,
+                                    STMT_SELECT_INVALID_REVISION));
+  SVN_ERR(svn_sqlite__bindf(stmt, "r", rev));
+  SVN_ERR(svn_sqlite__step(&have_row, stmt));
+  SVN_ERR(svn_sqlite__reset(stmt));
+  if (have_row)
+    return svn_error_createf(SVN_ERR_MERGEINFO_PARSE_ERROR, NULL,
+                             _("Revision %ld contains invalid mergeinfo"),
+                             rev);
+
+  *deleted_catalog = apr_hash_make(result_pool);
+  *added_catalog = apr_hash_make(result_pool);
+  *added_nodes = apr_array_make(result_pool, 0, sizeof(const char *));
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, index->sdb,
+                                    STMT_SELECT_MERGEINFO_CHANGES));
+  SVN_ERR(svn_sqlite__bindf(stmt, "r", rev));
+  SVN_ERR(svn_sqlite__step(&have_row, stmt));
+  while (have_row)
+    {
+      const char *path = svn_sqlite__column_text(stmt, 0, result_pool);
+      svn_mergeinfo_t deleted, added;
+      svn_error_t *err;
+
+      err = svn_mergeinfo_parse(&deleted,
+                                svn_sqlite__column_text(stmt, 1, NULL),
+                                result_pool);
+      if (! err)
+        err = svn_mergeinfo_parse(&added,
+                                  svn_sqlite__column_text(stmt, 2, NULL),
+                                  result_pool);
+      if (err)
+        return svn_error_compose_create(err, svn_sqlite__reset(stmt));
+
+      apr_hash_set(*deleted_catalog, path, APR_HASH_KEY_STRING, deleted);
+      apr_hash_set(*added_catalog, path, APR_HASH_KEY_STRING, added);
+
+      SVN_ERR(svn_sqlite__step(&have_row, stmt));
+    }
+  SVN_ERR(svn_sqlite__reset(stmt));
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, index->sdb,
+                                    STMT_SELECT_ADDED_NODES));
+  SVN_ERR(svn_sqlite__bindf(stmt, "r", rev));
+  SVN_ERR(svn_sqlite__step(&have_row, stmt));
+  while (have_row)
+    {
+      APR_ARRAY_PUSH(*added_nodes, const char *)
+        = svn_sqlite__column_text(stmt, 0, result_pool);
+      SVN_ERR(svn_sqlite__step(&have_row, stmt));
+    }
+
+  return svn_error_trace(svn_sqlite__reset(stmt));
+}
+
+svn_error_t *
+svn_repos__mergeinfo_index_descendants(apr_array_header_t **paths,
+                                       svn_repos__mergeinfo_index_t *index,
+                                       const char *path,
+                                       svn_revnum_t rev,
+                                       apr_pool_t *result_pool,
+                                       apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *relpaths;
+  int i;
+
+  SVN_ERR(get_mergeinfo_nodes(&relpaths, index->sdb, node_relpath(path),
+                              FALSE, rev, scratch_pool));
+
+  *paths = apr_array_make(result_pool, relpaths->nelts, sizeof(const char *));
+  for (i = 0; i < relpaths->nelts; i++)
+    APR_ARRAY_PUSH(*paths, const char *)
+      = apr_pstrcat(result_pool, "/", APR_ARRAY_IDX(relpaths, i, const char *),
+                    (char *)NULL);
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_repos__mergeinfo_index_update(svn_repos_t *repos,
+                                  apr_pool_t *scratch_pool)
+{
+  svn_revnum_t youngest, indexed;
+
+  /* Keep the database open for further commits through REPOS. */
+  if (! repos->mergeinfo_index_sdb)
+    {
+      svn_boolean_t exists;
+
+      SVN_ERR(mergeinfo_index_exists(&exists, repos, scratch_pool));
+      if (! exists)
+        return SVN_NO_ERROR;
+
+      SVN_ERR(open_mergeinfo_index_db(&repos->mergeinfo_index_sdb, repos,
+                                      svn_sqlite__mode_readwrite,
+                                      repos->pool, scratch_pool));
+    }
+
+  SVN_ERR(svn_fs_youngest_rev(&youngest, repos->fs, scratch_pool));
+  return svn_error_trace(catch_up(&indexed, repos->mergeinfo_index_sdb,
+                                  repos, youngest, NULL, NULL,
+                                  scratch_pool));
+}
+
+svn_error_t *
+svn_repos__build_mergeinfo_index(svn_revnum_t *youngest,
+                                 svn_repos_t *repos,
+                                 svn_cancel_func_t cancel_func,
+                                 void *cancel_baton,
+                                 apr_pool_t *scratch_pool)
+{
+  svn_sqlite__db_t *sdb;
+  svn_revnum_t indexed;
+
+  SVN_ERR(open_mergeinfo_index_db(&sdb, repos, svn_sqlite__mode_rwcreate,
+                                  scratch_pool, scratch_pool));
+  SVN_ERR(svn_sqlite__with_immediate_transaction(sdb, clear_index, NULL,
+                                                 scratch_pool));
+
+  SVN_ERR(svn_fs_youngest_rev(youngest, repos->fs, scratch_pool));
+  SVN_ERR(catch_up(&indexed, sdb, repos, *youngest, cancel_func,
+                   cancel_baton, scratch_pool));
+
+  return svn_error_trace(svn_sqlite__close(sdb));
+}
@@ -30,15 +30,26 @@
 #include "svn_repos.h"
 #include "svn_pools.h"
 #include "svn_props.h"
+#include "svn_cache_config.h"
 #include "repos.h"
 #include "svn_private_config.h"
 
 #include "private/svn_dep_compat.h"
+#include "private/svn_fs_private.h"
 #include "private/svn_fspath.h"
+#include "private/svn_mutex.h"
+#include "private/svn_repos_private.h"
 #include "private/svn_subr_private.h"
+#include "private/svn_thread_pool.h"
 
 #define NUM_CACHED_SOURCE_ROOTS 4
 
+/* Number of file deltas to reconstruct ahead of the editor drive per
+   worker thread, and the amount of svndiff data to keep in memory for
+   each of them before spilling to disk. */
+#define TEXT_PREFETCH_PER_THREAD 4
+#define TEXT_PREFETCH_SPILL_SIZE (256 * 1024)
+
 /* Theory of operation: we write report operations out to a spill-buffer
    as we receive them.  When the report is finished, we read the
    operations back out again, using them to guide the progression of
@@ -137,6 +148,14 @@ typedef struct report_baton_t
      revprop fetching. */
   apr_hash_t* revision_infos;
 
+  /* Parameters for the text delta read-ahead, the read-ahead itself
+     (NULL if file contents are sent synchronously) and the read-ahead
+     queue of the directory currently being iterated, if any. */
+  int max_threads;
+  apr_hash_t *fs_config;
+  struct text_prefetcher_t *prefetcher;
+  struct text_prefetch_queue_t *prefetch_queue;
+
   apr_pool_t *pool;
 } report_baton_t;
 
@@ -592,6 +611,385 @@ delta_proplists(report_baton_t *b, svn_revnum_t s_rev, const char *s_path,
   return SVN_NO_ERROR;
 }
 
+/* --- TEXT DELTA READ-AHEAD --- */
+
+/* The text delta for a file that is expected to be sent soon, being
+   reconstructed by a text_prefetcher_t. */
+typedef struct text_prefetch_t
+{
+  /* The source (S_PATH may be NULL) and the target of the delta. */
+  svn_revnum_t s_rev;
+  const char *s_path;
+  const char *t_path;
+
+  /* The background job and, once it has finished, the delta in svndiff
+     format.  SVNDIFF is NULL if the contents turned out to be unchanged.
+     It is allocated in the result pool of JOB. */
+  svn_thread_pool__job_t *job;
+  svn_stream_t *svndiff;
+
+  /* The prefetcher and the next delta in the queue. */
+  struct text_prefetcher_t *prefetcher;
+  struct text_prefetch_t *next;
+
+  /* Everything above as well as JOB live in this pool. */
+  apr_pool_t *pool;
+} text_prefetch_t;
+
+/* The file deltas queued for one directory, in the order in which
+   delta_dirs() is going to visit the files. */
+typedef struct text_prefetch_queue_t
+{
+  text_prefetch_t *first;
+  text_prefetch_t *last;
+  int queued;
+} text_prefetch_queue_t;
+
+/* Reconstructs the text deltas of upcoming files on worker threads while
+   the editor is busy with the current one.
+
+   svn_fs_t objects must not be shared between threads, so the workers
+   use private FS instances of the same repository that are borrowed
+   from svn_repos__worker_fs_acquire() for the duration of the report.
+   The results are only ever consumed in the order in which the editor
+   is being driven, so the sequence of editor calls does not depend on
+   whether or how far we read ahead. */
+typedef struct text_prefetcher_t
+{
+  svn_thread_pool__t *thread_pool;
+
+  /* Idle worker FS instances (svn_fs_t *), guarded by FS_MUTEX. */
+  apr_array_header_t *idle_fs;
+  svn_mutex__t *fs_mutex;
+
+  /* Handles of all worker FS instances (svn_repos__worker_fs_t *). */
+  apr_array_header_t *worker_fs;
+
+  /* Parameters of the report that the deltas depend on. */
+  svn_revnum_t t_rev;
+  svn_boolean_t ignore_ancestry;
+
+  /* Number of deltas queued in all directories and the number that we
+     try not to exceed. */
+  int queued;
+  int depth;
+
+  apr_pool_t *pool;
+} text_prefetcher_t;
+
+/* Pool cleanup function for text_prefetcher_t.  Release the worker FS
+   instances.  All jobs are gone by now because their pools are sub-pools
+   of the prefetcher pool. */
+static apr_status_t
+return_worker_fs(void *baton)
+{
+  text_prefetcher_t *prefetcher = baton;
+  int i;
+
+  for (i = 0; i < prefetcher->worker_fs->nelts; i++)
+    svn_error_clear(svn_repos__worker_fs_release(
+                      APR_ARRAY_IDX(prefetcher->worker_fs, i,
+                                    svn_repos__worker_fs_t *)));
+
+  return APR_SUCCESS;
+}
+
+/* Create a prefetcher for the target revision T_REV of FS in
+   *PREFETCHER that uses up to MAX_THREADS worker threads.  FS_CONFIG is
+   passed to svn_repos__worker_fs_acquire() for the worker FS instances.
+   IGNORE_ANCESTRY is the same as for the report.  Set *PREFETCHER to
+   NULL if the deltas cannot be reconstructed in parallel after all.
+
+   Allocate the prefetcher in RESULT_POOL.  All background jobs will be
+   finished when RESULT_POOL gets cleaned up. */
+static svn_error_t *
+text_prefetcher_create(text_prefetcher_t **prefetcher,
+                       svn_fs_t *fs,
+                       apr_hash_t *fs_config,
+                       svn_revnum_t t_rev,
+                       svn_boolean_t ignore_ancestry,
+                       int max_threads,
+                       apr_pool_t *result_pool)
+{
+  text_prefetcher_t *p = apr_pcalloc(result_pool, sizeof(*p));
+  const char *fs_path = svn_fs_path(fs, result_pool);
+  const char *uuid;
+  int i;
+
+  SVN_ERR(svn_thread_pool__create(&p->thread_pool, max_threads,
+                                  result_pool));
+  if (! svn_thread_pool__is_parallel(p->thread_pool))
+    {
+      *prefetcher = NULL;
+      return SVN_NO_ERROR;
+    }
+
+  SVN_ERR(svn_mutex__init(&p->fs_mutex, TRUE, result_pool));
+  p->idle_fs = apr_array_make(result_pool, max_threads, sizeof(svn_fs_t *));
+  p->worker_fs = apr_array_make(result_pool, max_threads,
+                                sizeof(svn_repos__worker_fs_t *));
+  p->t_rev = t_rev;
+  p->ignore_ancestry = ignore_ancestry;
+  p->depth = max_threads * TEXT_PREFETCH_PER_THREAD;
+  p->pool = result_pool;
+  apr_pool_cleanup_register(result_pool, p, return_worker_fs,
+                            apr_pool_cleanup_null);
+
+  SVN_ERR(svn_fs_get_uuid(fs, &uuid, result_pool));
+  for (i = 0; i < max_threads; i++)
+    {
+      svn_repos__worker_fs_t *worker_fs;
+      svn_fs_t *worker;
+
+      SVN_ERR(svn_repos__worker_fs_acquire(&worker_fs, &worker, fs_path, uuid,
+                                           fs_config, result_pool));
+      APR_ARRAY_PUSH(p->worker_fs, svn_repos__worker_fs_t *) = worker_fs;
+      APR_ARRAY_PUSH(p->idle_fs, svn_fs_t *) = worker;
+    }
+
+  *prefetcher = p;
+  return SVN_NO_ERROR;
+}
+
+/* Remove an idle worker FS from PREFETCHER and return it in *FS.
+   To be called with the FS mutex held. */
+static svn_error_t *
+acquire_worker_fs(svn_fs_t **fs,
+                  text_prefetcher_t *prefetcher)
+{
+  /* There are as many FS instances as threads. */
+  SVN_ERR_ASSERT(prefetcher->idle_fs->nelts > 0);
+  *fs = *(svn_fs_t **)apr_array_pop(prefetcher->idle_fs);
+
+  return SVN_NO_ERROR;
+}
+
+/* Return FS to the idle worker FS instances of PREFETCHER.
+   To be called with the FS mutex held. */
+static svn_error_t *
+release_worker_fs(text_prefetcher_t *prefetcher,
+                  svn_fs_t *fs)
+{
+  APR_ARRAY_PUSH(prefetcher->idle_fs, svn_fs_t *) = fs;
+
+  return SVN_NO_ERROR;
+}
+
+/* Write the delta from S_PATH in S_ROOT, which may be NULL, to T_PATH
+   in T_ROOT to PREFETCH->SVNDIFF, unless the contents are the same as
+   far as delta_files() is concerned.  IGNORE_ANCESTRY is the same as
+   for the report.  Allocate the result in RESULT_POOL. */
+static svn_error_t *
+write_prefetched_delta(text_prefetch_t *prefetch,
+                       svn_fs_root_t *s_root,
+                       svn_fs_root_t *t_root,
+                       svn_boolean_t ignore_ancestry,
+                       apr_pool_t *result_pool,
+                       apr_pool_t *scratch_pool)
+{
+  svn_txdelta_stream_t *dstream;
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+  svn_stream_t *svndiff;
+
+  if (s_root)
+    {
+      svn_boolean_t changed;
+
+      if (ignore_ancestry)
+        SVN_ERR(svn_repos__compare_files(&changed, t_root, prefetch->t_path,
+                                         s_root, prefetch->s_path,
+                                         scratch_pool));
+      else
+        SVN_ERR(svn_fs_contents_changed(&changed, t_root, prefetch->t_path,
+                                        s_root, prefetch->s_path,
+                                        scratch_pool));
+      if (! changed)
+        return SVN_NO_ERROR;
+    }
+
+  /* The data does not leave this process, so don't waste time on
+     compressing it. */
+  svndiff = svn_stream__from_spillbuf(SVN__STREAM_CHUNK_SIZE,
+                                      TEXT_PREFETCH_SPILL_SIZE,
+                                      result_pool);
+  svn_txdelta_to_svndiff3(&handler, &handler_baton,
+                          svn_stream_disown(svndiff, scratch_pool), 0,
+                          SVN_DELTA_COMPRESSION_LEVEL_NONE, scratch_pool);
+  SVN_ERR(svn_fs_get_file_delta_stream(&dstream, s_root, prefetch->s_path,
+                                       t_root, prefetch->t_path,
+                                       scratch_pool));
+  SVN_ERR(svn_txdelta_send_txstream(dstream, handler, handler_baton,
+                                    scratch_pool));
+
+  prefetch->svndiff = svndiff;
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_thread_pool__task_t.  Reconstruct the delta for the
+   text_prefetch_t in BATON using one of the worker FS instances. */
+static svn_error_t *
+prefetch_text_delta(void *baton,
+                    apr_pool_t *result_pool,
+                    apr_pool_t *scratch_pool)
+{
+  text_prefetch_t *prefetch = baton;
+  text_prefetcher_t *prefetcher = prefetch->prefetcher;
+  apr_pool_t *root_pool = svn_pool_create(scratch_pool);
+  svn_fs_root_t *s_root = NULL, *t_root;
+  svn_fs_t *fs;
+  svn_error_t *err;
+
+  SVN_MUTEX__WITH_LOCK(prefetcher->fs_mutex,
+                       acquire_worker_fs(&fs, prefetcher));
+
+  err = svn_fs_revision_root(&t_root, fs, prefetcher->t_rev, root_pool);
+  if (! err && prefetch->s_path)
+    err = svn_fs_revision_root(&s_root, fs, prefetch->s_rev, root_pool);
+  if (! err)
+    err = write_prefetched_delta(prefetch, s_root, t_root,
+                                 prefetcher->ignore_ancestry,
+                                 result_pool, root_pool);
+
+  /* Don't keep anything referring to FS once it may be used by others. */
+  svn_pool_destroy(root_pool);
+
+  SVN_MUTEX__WITH_LOCK(prefetcher->fs_mutex,
+                       release_worker_fs(prefetcher, fs));
+
+  return svn_error_trace(err);
+}
+
+/* Return TRUE if QUEUE should not take any further deltas from
+   PREFETCHER.  Every directory may have at least one delta in flight
+   such that the files deep down the tree get their share, too. */
+static svn_boolean_t
+text_prefetch_queue_full(const text_prefetch_queue_t *queue,
+                         const text_prefetcher_t *prefetcher)
+{
+  return queue->queued > 0 && prefetcher->queued >= prefetcher->depth;
+}
+
+/* Queue the delta from S_PATH@S_REV, which may be NULL, to T_PATH in
+   the target revision for reconstruction by PREFETCHER in QUEUE. */
+static svn_error_t *
+text_prefetch_queue_push(text_prefetch_queue_t *queue,
+                         text_prefetcher_t *prefetcher,
+                         svn_revnum_t s_rev,
+                         const char *s_path,
+                         const char *t_path)
+{
+  apr_pool_t *pool = svn_pool_create(prefetcher->pool);
+  text_prefetch_t *prefetch = apr_pcalloc(pool, sizeof(*prefetch));
+
+  prefetch->s_rev = s_rev;
+  prefetch->s_path = s_path ? apr_pstrdup(pool, s_path) : NULL;
+  prefetch->t_path = apr_pstrdup(pool, t_path);
+  prefetch->prefetcher = prefetcher;
+  prefetch->pool = pool;
+
+  SVN_ERR(svn_thread_pool__submit(&prefetch->job, prefetcher->thread_pool,
+                                  prefetch_text_delta, prefetch, pool));
+
+  if (queue->last)
+    queue->last->next = prefetch;
+  else
+    queue->first = prefetch;
+  queue->last = prefetch;
+  queue->queued++;
+  prefetcher->queued++;
+
+  return SVN_NO_ERROR;
+}
+
+/* Remove the oldest delta from QUEUE, which must not be empty, and
+   release everything associated with it.  Wait for its job to finish
+   if necessary. */
+static void
+text_prefetch_queue_pop(text_prefetch_queue_t *queue)
+{
+  text_prefetch_t *prefetch = queue->first;
+
+  queue->first = prefetch->next;
+  if (queue->first == NULL)
+    queue->last = NULL;
+  queue->queued--;
+  prefetch->prefetcher->queued--;
+
+  svn_pool_destroy(prefetch->pool);
+}
+
+/* If the next delta in B's current read-ahead queue is the one from
+   S_PATH@S_REV to T_PATH, wait for it, send it to HANDLER and
+   HANDLER_BATON, set *SENT and remove it from the queue.  Otherwise,
+   set *SENT to FALSE and leave the queue untouched.  Use POOL for
+   temporary allocations. */
+static svn_error_t *
+send_prefetched_delta(svn_boolean_t *sent,
+                      report_baton_t *b,
+                      svn_revnum_t s_rev,
+                      const char *s_path,
+                      const char *t_path,
+                      svn_txdelta_window_handler_t handler,
+                      void *handler_baton,
+                      apr_pool_t *pool)
+{
+  text_prefetch_queue_t *queue = b->prefetch_queue;
+  text_prefetch_t *prefetch = queue ? queue->first : NULL;
+  svn_error_t *err;
+
+  *sent = FALSE;
+  if (! prefetch
+      || strcmp(prefetch->t_path, t_path) != 0
+      || (s_path == NULL) != (prefetch->s_path == NULL)
+      || (s_path && (s_rev != prefetch->s_rev
+                     || strcmp(s_path, prefetch->s_path) != 0)))
+    return SVN_NO_ERROR;
+
+  /* A failure in the background is no reason to fail the report;
+     the caller will simply redo the work itself. */
+  err = svn_thread_pool__wait(prefetch->job);
+  if (! err && prefetch->svndiff)
+    {
+      err = svn_stream_copy3(prefetch->svndiff,
+                             svn_txdelta_parse_svndiff(handler,
+                                                       handler_baton,
+                                                       TRUE, pool),
+                             NULL, NULL, pool);
+      *sent = TRUE;
+    }
+  else
+    svn_error_clear(err);
+
+  text_prefetch_queue_pop(queue);
+
+  return *sent ? svn_error_trace(err) : SVN_NO_ERROR;
+}
+
+/* Queue the text deltas of the file entries in CANDIDATES (const
+   text_prefetch_t *, only used as keys) starting at index *NEXT until
+   QUEUE is full.  Advance *NEXT accordingly. */
+static svn_error_t *
+fill_text_prefetch_queue(text_prefetch_queue_t *queue,
+                         text_prefetcher_t *prefetcher,
+                         const apr_array_header_t *candidates,
+                         int *next)
+{
+  while (*next < candidates->nelts
+         && ! text_prefetch_queue_full(queue, prefetcher))
+    {
+      const text_prefetch_t *candidate
+        = APR_ARRAY_IDX(candidates, *next, const text_prefetch_t *);
+
+      SVN_ERR(text_prefetch_queue_push(queue, prefetcher, candidate->s_rev,
+                                       candidate->s_path,
+                                       candidate->t_path));
+      ++*next;
+    }
+
+  return SVN_NO_ERROR;
+}
+
 /* Make the appropriate edits on FILE_BATON to change its contents and
    properties from those in S_REV/S_PATH to those in B->t_root/T_PATH,
    possibly using LOCK_TOKEN to determine if the client's lock on the file
@@ -645,9 +1043,18 @@ delta_files(report_baton_t *b, void *file_baton, svn_revnum_t s_rev,
     {
       if (b->text_deltas)
         {
-          SVN_ERR(svn_fs_get_file_delta_stream(&dstream, s_root, s_path,
-                                               b->t_root, t_path, pool));
-          SVN_ERR(svn_txdelta_send_txstream(dstream, dhandler, dbaton, pool));
+          svn_boolean_t sent;
+
+          /* Maybe, the delta has already been reconstructed for us. */
+          SVN_ERR(send_prefetched_delta(&sent, b, s_rev, s_path, t_path,
+                                        dhandler, dbaton, pool));
+          if (! sent)
+            {
+              SVN_ERR(svn_fs_get_file_delta_stream(&dstream, s_root, s_path,
+                                                   b->t_root, t_path, pool));
+              SVN_ERR(svn_txdelta_send_txstream(dstream, dhandler, dbaton,
+                                                pool));
+            }
         }
       else
         SVN_ERR(dhandler(NULL, dbaton));
@@ -992,6 +1399,121 @@ update_entry(report_baton_t *b, svn_revnum_t s_rev, const char *s_path,
 #define DEPTH_BELOW_HERE(depth) ((depth) == svn_depth_immediates) ? \
                                  svn_depth_empty : (depth)
 
+/* Set *CANDIDATES to the text deltas (text_prefetch_t *, with only the
+   source and target paths set) that delta_dirs() is likely to send when
+   iterating over T_ENTRIES of directory T_PATH.  The other parameters are
+   the same as for delta_dirs(); the order of the candidates is the order
+   in which the target entries will be visited.  Allocate the result in
+   POOL.
+
+   This is merely a guess; e.g. authz restrictions or copyfrom sources
+   are not taken into account here.  A wrong guess only costs some of the
+   work done in the background. */
+static svn_error_t *
+collect_text_prefetch_candidates(apr_array_header_t **candidates,
+                                 report_baton_t *b,
+                                 svn_revnum_t s_rev,
+                                 const char *s_path,
+                                 const char *t_path,
+                                 apr_hash_t *s_entries,
+                                 apr_hash_t *t_entries,
+                                 svn_depth_t wc_depth,
+                                 svn_depth_t requested_depth,
+                                 apr_pool_t *pool)
+{
+  apr_hash_index_t *hi;
+
+  *candidates = apr_array_make(pool, apr_hash_count(t_entries),
+                               sizeof(text_prefetch_t *));
+  for (hi = apr_hash_first(pool, t_entries); hi; hi = apr_hash_next(hi))
+    {
+      const svn_fs_dirent_t *s_entry = NULL, *t_entry;
+      text_prefetch_t *candidate;
+
+      t_entry = svn__apr_hash_index_val(hi);
+      if (t_entry->kind != svn_node_file)
+        continue;
+
+      if (! is_depth_upgrade(wc_depth, requested_depth, t_entry->kind))
+        {
+          if (requested_depth == svn_depth_unknown
+              && wc_depth < svn_depth_files)
+            continue;
+
+          s_entry = s_entries
+                  ? apr_hash_get(s_entries, t_entry->name, APR_HASH_KEY_STRING)
+                  : NULL;
+        }
+
+      candidate = apr_pcalloc(pool, sizeof(*candidate));
+      candidate->t_path = svn_fspath__join(t_path, t_entry->name, pool);
+
+      /* Mirror the decisions made by update_entry(). */
+      if (s_entry && s_entry->kind == svn_node_file)
+        {
+          int distance = svn_fs_compare_ids(s_entry->id, t_entry->id);
+
+          if (distance == 0)
+            continue;
+
+          if (distance != -1 || b->ignore_ancestry)
+            {
+              candidate->s_rev = s_rev;
+              candidate->s_path = svn_fspath__join(s_path, t_entry->name,
+                                                   pool);
+            }
+        }
+
+      APR_ARRAY_PUSH(*candidates, text_prefetch_t *) = candidate;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Hint the filesystem to read ahead the node-revisions and properties of
+   those entries of the directories S_PATH in S_ROOT and T_PATH in
+   B->t_root that the walk over S_ENTRIES and T_ENTRIES is going to look
+   at.  If there is no source (S_ENTRIES is NULL), that is every target
+   entry.  Otherwise, it is only those entries that are not the same node
+   in both; unchanged entries get skipped by update_entry() without ever
+   reading them.  Use POOL for temporary allocations. */
+static svn_error_t *
+prefetch_changed_entries(report_baton_t *b,
+                         svn_fs_root_t *s_root,
+                         const char *s_path,
+                         apr_hash_t *s_entries,
+                         const char *t_path,
+                         apr_hash_t *t_entries,
+                         apr_pool_t *pool)
+{
+  apr_array_header_t *names;
+  apr_hash_index_t *hi;
+
+  if (! s_entries)
+    return svn_error_trace(svn_fs__prefetch_dir(b->t_root, t_path, NULL,
+                                                pool));
+
+  names = apr_array_make(pool, 16, sizeof(const char *));
+  for (hi = apr_hash_first(pool, t_entries); hi; hi = apr_hash_next(hi))
+    {
+      const svn_fs_dirent_t *t_entry = svn__apr_hash_index_val(hi);
+      const svn_fs_dirent_t *s_entry
+        = apr_hash_get(s_entries, t_entry->name, APR_HASH_KEY_STRING);
+
+      if (! s_entry || svn_fs_compare_ids(s_entry->id, t_entry->id) != 0)
+        APR_ARRAY_PUSH(names, const char *) = t_entry->name;
+    }
+
+  /* A single read gains nothing from being sorted. */
+  if (names->nelts < 2)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_fs__prefetch_dir(s_root, s_path, names, pool));
+  SVN_ERR(svn_fs__prefetch_dir(b->t_root, t_path, names, pool));
+
+  return SVN_NO_ERROR;
+}
+
 /* Emit edits within directory DIR_BATON (with corresponding path
    E_PATH) with the changes from the directory S_REV/S_PATH to the
    directory B->t_rev/T_PATH.  S_PATH may be NULL if the entry does
@@ -1059,6 +1581,9 @@ delta_dirs(report_baton_t *b, svn_revnum_t s_rev, const char *s_path,
   apr_pool_t *subpool;
   const char *name, *s_fullpath, *t_fullpath, *e_fullpath;
   path_info_t *info;
+  text_prefetch_queue_t *queue = NULL, *parent_queue = NULL;
+  apr_array_header_t *candidates = NULL;
+  int next_candidate = 0;
 
   /* Compare the property lists.  If we're starting empty, pass a NULL
      source path so that we add all the properties.
@@ -1078,6 +1603,12 @@ delta_dirs(report_baton_t *b, svn_revnum_t s_rev, const char *s_path,
         }
       SVN_ERR(svn_fs_dir_entries(&t_entries, b->t_root, t_path, pool));
 
+      /* Read the node-revisions and properties of the entries that we
+         will visit below in storage order up front instead of seeking
+         back and forth for each one. */
+      SVN_ERR(prefetch_changed_entries(b, s_entries ? s_root : NULL, s_path,
+                                       s_entries, t_path, t_entries, pool));
+
       /* Iterate over the report information for this directory. */
       subpool = svn_pool_create(pool);
 
@@ -1188,6 +1719,21 @@ delta_dirs(report_baton_t *b, svn_revnum_t s_rev, const char *s_path,
             }
         }
 
+      /* Start reconstructing the text deltas of the files that we are
+         about to send.  QUEUE replaces the queue of our parent directory
+         until we are done here. */
+      if (b->prefetcher)
+        {
+          queue = apr_pcalloc(pool, sizeof(*queue));
+          SVN_ERR(collect_text_prefetch_candidates(&candidates, b, s_rev,
+                                                   s_path, t_path,
+                                                   s_entries, t_entries,
+                                                   wc_depth,
+                                                   requested_depth, pool));
+          parent_queue = b->prefetch_queue;
+          b->prefetch_queue = queue;
+        }
+
       /* Loop over the dirents in the target. */
       for (hi = apr_hash_first(pool, t_entries); hi; hi = apr_hash_next(hi))
         {
@@ -1196,6 +1742,10 @@ delta_dirs(report_baton_t *b, svn_revnum_t s_rev, const char *s_path,
           svn_pool_clear(subpool);
           t_entry = svn__apr_hash_index_val(hi);
 
+          if (queue)
+            SVN_ERR(fill_text_prefetch_queue(queue, b->prefetcher,
+                                             candidates, &next_candidate));
+
           if (is_depth_upgrade(wc_depth, requested_depth, t_entry->kind))
             {
               /* We're making the working copy deeper, pretend the source
@@ -1233,8 +1783,19 @@ delta_dirs(report_baton_t *b, svn_revnum_t s_rev, const char *s_path,
                                DEPTH_BELOW_HERE(wc_depth),
                                DEPTH_BELOW_HERE(requested_depth),
                                subpool));
+
+          /* Drop the delta for this entry if it has not been used. */
+          if (queue && queue->first
+              && strcmp(queue->first->t_path, t_fullpath) == 0)
+            text_prefetch_queue_pop(queue);
         }
 
+      if (queue)
+        {
+          while (queue->first)
+            text_prefetch_queue_pop(queue);
+          b->prefetch_queue = parent_queue;
+        }
 
       /* Destroy iteration subpool. */
       svn_pool_destroy(subpool);
@@ -1311,6 +1872,7 @@ finish_report(report_baton_t *b, apr_pool_t *pool)
 {
   path_info_t *info;
   apr_pool_t *subpool;
+  apr_pool_t *prefetcher_pool = NULL;
   svn_revnum_t s_rev;
   int i;
 
@@ -1357,8 +1919,31 @@ finish_report(report_baton_t *b, apr_pool_t *pool)
   for (i = 0; i < NUM_CACHED_SOURCE_ROOTS; i++)
     b->s_roots[i] = NULL;
 
+  /* Reconstruct upcoming file deltas in the background, if possible. */
+  b->prefetcher = NULL;
+  b->prefetch_queue = NULL;
+  if (b->text_deltas
+      && b->max_threads > 1
+      && ! svn_cache_config_get()->single_threaded)
+    {
+      prefetcher_pool = svn_pool_create(pool);
+      SVN_ERR(text_prefetcher_create(&b->prefetcher, b->repos->fs,
+                                     b->fs_config, b->t_rev,
+                                     b->ignore_ancestry, b->max_threads,
+                                     prefetcher_pool));
+    }
+
   {
     svn_error_t *err = drive(b, s_rev, info, pool);
+
+    /* Wait for any remaining jobs and release the worker FS instances. */
+    if (prefetcher_pool)
+      {
+        svn_pool_destroy(prefetcher_pool);
+        b->prefetcher = NULL;
+        b->prefetch_queue = NULL;
+      }
+
     if (err == SVN_NO_ERROR)
       return svn_error_trace(b->editor->close_edit(b->edit_baton, pool));
 
@@ -1463,21 +2048,23 @@ svn_repos_abort_report(void *baton, apr_pool_t *pool)
 
 
 svn_error_t *
-svn_repos_begin_report2(void **report_baton,
-                        svn_revnum_t revnum,
-                        svn_repos_t *repos,
-                        const char *fs_base,
-                        const char *s_operand,
-                        const char *switch_path,
-                        svn_boolean_t text_deltas,
-                        svn_depth_t depth,
-                        svn_boolean_t ignore_ancestry,
-                        svn_boolean_t send_copyfrom_args,
-                        const svn_delta_editor_t *editor,
-                        void *edit_baton,
-                        svn_repos_authz_func_t authz_read_func,
-                        void *authz_read_baton,
-                        apr_pool_t *pool)
+svn_repos__begin_report_pipelined(void **report_baton,
+                                  svn_revnum_t revnum,
+                                  svn_repos_t *repos,
+                                  const char *fs_base,
+                                  const char *s_operand,
+                                  const char *switch_path,
+                                  svn_boolean_t text_deltas,
+                                  svn_depth_t depth,
+                                  svn_boolean_t ignore_ancestry,
+                                  svn_boolean_t send_copyfrom_args,
+                                  const svn_delta_editor_t *editor,
+                                  void *edit_baton,
+                                  svn_repos_authz_func_t authz_read_func,
+                                  void *authz_read_baton,
+                                  int max_threads,
+                                  apr_hash_t *fs_config,
+                                  apr_pool_t *pool)
 {
   report_baton_t *b;
 
@@ -1504,6 +2091,10 @@ svn_repos_begin_report2(void **report_baton,
   b->authz_read_func = authz_read_func;
   b->authz_read_baton = authz_read_baton;
   b->revision_infos = apr_hash_make(pool);
+  b->max_threads = max_threads;
+  b->fs_config = fs_config;
+  b->prefetcher = NULL;
+  b->prefetch_queue = NULL;
   b->pool = pool;
   b->reader = svn_spillbuf__reader_create(1000 /* blocksize */,
                                           1000000 /* maxsize */,
@@ -1513,3 +2104,28 @@ svn_repos_begin_report2(void **report_baton,
   *report_baton = b;
   return SVN_NO_ERROR;
 }
+
+svn_error_t *
+svn_repos_begin_report2(void **report_baton,
+                        svn_revnum_t revnum,
+                        svn_repos_t *repos,
+                        const char *fs_base,
+                        const char *s_operand,
+                        const char *switch_path,
+                        svn_boolean_t text_deltas,
+                        svn_depth_t depth,
+                        svn_boolean_t ignore_ancestry,
+                        svn_boolean_t send_copyfrom_args,
+                        const svn_delta_editor_t *editor,
+                        void *edit_baton,
+                        svn_repos_authz_func_t authz_read_func,
+                        void *authz_read_baton,
+                        apr_pool_t *pool)
+{
+  return svn_error_trace(svn_repos__begin_report_pipelined(
+                           report_baton, revnum, repos, fs_base, s_operand,
+                           switch_path, text_deltas, depth, ignore_ancestry,
+                           send_copyfrom_args, editor, edit_baton,
+                           authz_read_func, authz_read_baton, 1, NULL,
+                           pool));
+}
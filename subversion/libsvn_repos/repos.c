@@ -1042,6 +1042,16 @@ create_conf(svn_repos_t *repos, apr_pool_t *pool)
 "### Unless you specify an absolute path, the file's location is relative"   NL
 "### to the directory containing this file."                                 NL
 "# hooks-env = " SVN_REPOS__CONF_HOOKS_ENV                                   NL
+"### The log-threads option specifies how many threads may be used to"       NL
+"### determine the changed paths of upcoming revisions, including the"       NL
+"### path-based access checks, while answering a log request.  This is"      NL
+"### only effective if svnserve runs in threaded mode.  Default is 1."       NL
+"# log-threads = 4"                                                          NL
+"### The update-threads option specifies how many threads may be used to"    NL
+"### read ahead the contents of the next files while answering checkout,"    NL
+"### update, switch and diff requests.  This is only effective if svnserve"  NL
+"### runs in threaded mode.  Default is 1."                                  NL
+"# update-threads = 4"                                                       NL
 ""                                                                           NL
 "[sasl]"                                                                     NL
 "### This option specifies whether you want to use the Cyrus SASL"           NL
@@ -1266,6 +1276,7 @@ create_svn_repos_t(const char *path, apr_pool_t *pool)
   repos->lock_path = svn_dirent_join(path, SVN_REPOS__LOCK_DIR, pool);
   repos->repository_capabilities = apr_hash_make(pool);
   repos->hooks_env = NULL;
+  repos->pool = pool;
 
   return repos;
 }
@@ -27,6 +27,7 @@
 #include <apr_hash.h>
 
 #include "svn_fs.h"
+#include "svn_mergeinfo.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -157,6 +158,14 @@ struct svn_repos_t
    * E.g. an entry with the name SVN_REPOS__HOOK_PRE_COMMIT provides the
    * environment specific to the pre-commit hook. */
   apr_hash_t *hooks_env;
+
+  /* The pool this object has been allocated in. */
+  apr_pool_t *pool;
+
+  /* The log index and mergeinfo index databases, once opened for writing
+     by a commit through this object, or NULL. */
+  struct svn_sqlite__db_t *log_index_sdb;
+  struct svn_sqlite__db_t *mergeinfo_index_sdb;
 };
 
 
@@ -339,6 +348,156 @@ svn_repos__prev_location(svn_revnum_t *appeared_rev,
                          const char *path,
                          apr_pool_t *pool);
 
+
+/*** Log Index ***/
+
+/* The optional database in the repository's db directory that lists
+   for every path the revisions in which it or anything below it has
+   been changed. */
+#define SVN_REPOS__LOG_INDEX_DB "log-index.db"
+
+/* An open log index. */
+typedef struct svn_repos__log_index_t svn_repos__log_index_t;
+
+/* Set *INDEX_P to the log index of REPOS, opened read-only and allocated
+   in RESULT_POOL.  The index may lag behind the youngest revision of
+   REPOS; see svn_repos__log_index_indexed_rev().  If REPOS does not have
+   a log index, or the index is not usable, set *INDEX_P to NULL.  Use
+   SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_repos__log_index_open(svn_repos__log_index_t **index_p,
+                          svn_repos_t *repos,
+                          apr_pool_t *result_pool,
+                          apr_pool_t *scratch_pool);
+
+/* Return the youngest revision covered by INDEX.  Younger revisions must
+   not be looked up in it. */
+svn_revnum_t
+svn_repos__log_index_indexed_rev(svn_repos__log_index_t *index);
+
+/* Set *REV to the youngest revision from START to END, inclusive, in
+   which PATH or any path below it has been changed according to INDEX.
+   Set *REV to SVN_INVALID_REVNUM if there is no such revision. */
+svn_error_t *
+svn_repos__log_index_youngest_change(svn_revnum_t *rev,
+                                     svn_repos__log_index_t *index,
+                                     const char *path,
+                                     svn_revnum_t start,
+                                     svn_revnum_t end,
+                                     apr_pool_t *scratch_pool);
+
+/* Add all revisions that are missing from the log index of REPOS to it,
+   keeping the index database open in REPOS for later calls.  Do nothing
+   if REPOS does not have a log index. */
+svn_error_t *
+svn_repos__log_index_update(svn_repos_t *repos,
+                            apr_pool_t *scratch_pool);
+
+
+/*** Mergeinfo Index ***/
+
+/* The optional database in the repository's db directory that records
+   the mergeinfo changes of every revision and which nodes carry explicit
+   mergeinfo in which revisions. */
+#define SVN_REPOS__MERGEINFO_INDEX_DB "mergeinfo-index.db"
+
+/* An open mergeinfo index. */
+typedef struct svn_repos__mergeinfo_index_t svn_repos__mergeinfo_index_t;
+
+/* Set *INDEX_P to the mergeinfo index of REPOS, opened read-only and
+   allocated in RESULT_POOL.  The index may lag behind the youngest
+   revision of REPOS; see svn_repos__mergeinfo_index_indexed_rev().  If
+   REPOS does not have a mergeinfo index, or the index is not usable, set
+   *INDEX_P to NULL.  Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_repos__mergeinfo_index_open(svn_repos__mergeinfo_index_t **index_p,
+                                svn_repos_t *repos,
+                                apr_pool_t *result_pool,
+                                apr_pool_t *scratch_pool);
+
+/* Return the youngest revision covered by INDEX.  Younger revisions must
+   not be looked up in it. */
+svn_revnum_t
+svn_repos__mergeinfo_index_indexed_rev(svn_repos__mergeinfo_index_t *index);
+
+/* Set *DELETED_CATALOG and *ADDED_CATALOG to the mergeinfo changes of REV
+   as svn_repos__mergeinfo_changed() would return them, and *ADDED_NODES
+   to an array of the const char * paths added or replaced in REV, all
+   according to INDEX and allocated in RESULT_POOL.  Return an error with
+   SVN_ERR_MERGEINFO_PARSE_ERROR if the mergeinfo of REV could not be
+   parsed when it was indexed. */
+svn_error_t *
+svn_repos__mergeinfo_index_changes(svn_mergeinfo_catalog_t *deleted_catalog,
+                                   svn_mergeinfo_catalog_t *added_catalog,
+                                   apr_array_header_t **added_nodes,
+                                   svn_repos__mergeinfo_index_t *index,
+                                   svn_revnum_t rev,
+                                   apr_pool_t *result_pool,
+                                   apr_pool_t *scratch_pool);
+
+/* Set *PATHS to an array of the const char * paths below PATH that have
+   an svn:mergeinfo property in REV according to INDEX, allocated in
+   RESULT_POOL. */
+svn_error_t *
+svn_repos__mergeinfo_index_descendants(apr_array_header_t **paths,
+                                       svn_repos__mergeinfo_index_t *index,
+                                       const char *path,
+                                       svn_revnum_t rev,
+                                       apr_pool_t *result_pool,
+                                       apr_pool_t *scratch_pool);
+
+/* Add all revisions that are missing from the mergeinfo index of REPOS
+   to it, keeping the index database open in REPOS for later calls.  Do
+   nothing if REPOS does not have a mergeinfo index. */
+svn_error_t *
+svn_repos__mergeinfo_index_update(svn_repos_t *repos,
+                                  apr_pool_t *scratch_pool);
+
+/*** Worker Filesystems ***/
+
+/* An svn_fs_t that belongs to one worker thread at a time and goes back
+   to a process-wide pool when it is no longer needed. */
+typedef struct svn_repos__worker_fs_t svn_repos__worker_fs_t;
+
+/* Set *FS to a filesystem instance of the repository with UUID at
+   FS_PATH that nobody else uses, and *WORKER_FS to the handle that must
+   be passed to svn_repos__worker_fs_release() once done with it.  Take
+   an idle instance if there is one, otherwise open a new one, passing
+   FS_CONFIG to svn_fs_open().  FS_CONFIG does not affect reused
+   instances.
+
+   *FS has its own allocator and is not tied to any pool of the caller,
+   so it may be used from any one thread at a time.  Use SCRATCH_POOL
+   for temporary allocations. */
+svn_error_t *
+svn_repos__worker_fs_acquire(svn_repos__worker_fs_t **worker_fs,
+                             svn_fs_t **fs,
+                             const char *fs_path,
+                             const char *uuid,
+                             apr_hash_t *fs_config,
+                             apr_pool_t *scratch_pool);
+
+/* Make the filesystem instance of WORKER_FS available to later calls of
+   svn_repos__worker_fs_acquire().  Nothing allocated from it may be used
+   afterwards. */
+svn_error_t *
+svn_repos__worker_fs_release(svn_repos__worker_fs_t *worker_fs);
+
+/* Set *DELETED_MERGEINFO_CATALOG and *ADDED_MERGEINFO_CATALOG to
+   catalogs describing how mergeinfo values on paths (which are the
+   keys of those catalogs) were changed in REV of FS.  Return an error
+   with SVN_ERR_MERGEINFO_PARSE_ERROR if any of the mergeinfo involved
+   cannot be parsed.  Allocate the catalogs in RESULT_POOL and use
+   SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_repos__mergeinfo_changed(
+  svn_mergeinfo_catalog_t *deleted_mergeinfo_catalog,
+  svn_mergeinfo_catalog_t *added_mergeinfo_catalog,
+  svn_fs_t *fs,
+  svn_revnum_t rev,
+  apr_pool_t *result_pool,
+  apr_pool_t *scratch_pool);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -0,0 +1,178 @@
+/* worker_fs.c --- filesystem instances shared by worker threads
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+
+/* The log and update prefetchers need one svn_fs_t per worker thread.
+ * Opening those for every request would cost more than many requests
+ * gain from running in parallel, so finished requests hand their
+ * instances back to a process-wide pool from which later requests for
+ * the same repository take them again.
+ */
+
+#include <apr_strings.h>
+
+#include "svn_pools.h"
+#include "svn_error.h"
+#include "svn_dirent_uri.h"
+#include "svn_fs.h"
+#include "svn_repos.h"
+#include "repos.h"
+#include "private/svn_atomic.h"
+#include "private/svn_mutex.h"
+
+/* Keep at most this many idle instances per repository. */
+#define MAX_IDLE_WORKER_FS 16
+
+/* The idle instances of one repository. */
+typedef struct worker_fs_list_t
+{
+  /* svn_repos__worker_fs_t * that are not in use. */
+  apr_array_header_t *idle;
+} worker_fs_list_t;
+
+struct svn_repos__worker_fs_t
+{
+  /* The filesystem and the root pool that it lives in. */
+  svn_fs_t *fs;
+  apr_pool_t *pool;
+
+  /* The list that this instance returns to. */
+  worker_fs_list_t *list;
+};
+
+/* Maps "<absolute FS path>:<UUID>" to worker_fs_list_t.  The UUID
+   keeps instances of a repository that has been replaced by another one
+   at the same location from being used for the new one.  It lives in
+   REGISTRY_POOL and all access to it and its lists is serialized by
+   REGISTRY_MUTEX. */
+static volatile svn_atomic_t registry_init_state = 0;
+static apr_pool_t *registry_pool = NULL;
+static svn_mutex__t *registry_mutex = NULL;
+static apr_hash_t *registry = NULL;
+
+/* Create the registry.  Implements the init_func interface of
+   svn_atomic__init_once(). */
+static svn_error_t *
+init_registry(void *baton, apr_pool_t *pool)
+{
+  registry_pool = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+  SVN_ERR(svn_mutex__init(&registry_mutex, TRUE, registry_pool));
+  registry = apr_hash_make(registry_pool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *LIST to the list for KEY, creating it if necessary, and take an
+   idle instance from it into *WORKER_FS, or set that to NULL if there is
+   none.  The caller must hold REGISTRY_MUTEX. */
+static svn_error_t *
+take_idle(svn_repos__worker_fs_t **worker_fs,
+          worker_fs_list_t **list,
+          const char *key)
+{
+  worker_fs_list_t *l = apr_hash_get(registry, key, APR_HASH_KEY_STRING);
+
+  if (! l)
+    {
+      l = apr_pcalloc(registry_pool, sizeof(*l));
+      l->idle = apr_array_make(registry_pool, MAX_IDLE_WORKER_FS,
+                               sizeof(svn_repos__worker_fs_t *));
+      apr_hash_set(registry, apr_pstrdup(registry_pool, key),
+                   APR_HASH_KEY_STRING, l);
+    }
+
+  *list = l;
+  *worker_fs = l->idle->nelts
+             ? *(svn_repos__worker_fs_t **)apr_array_pop(l->idle)
+             : NULL;
+
+  return SVN_NO_ERROR;
+}
+
+/* Return WORKER_FS to its list unless that is full already, in which
+   case set *SURPLUS to TRUE.  The caller must hold REGISTRY_MUTEX. */
+static svn_error_t *
+put_idle(svn_boolean_t *surplus,
+         svn_repos__worker_fs_t *worker_fs)
+{
+  worker_fs_list_t *list = worker_fs->list;
+
+  *surplus = (list->idle->nelts >= MAX_IDLE_WORKER_FS);
+  if (! *surplus)
+    APR_ARRAY_PUSH(list->idle, svn_repos__worker_fs_t *) = worker_fs;
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_repos__worker_fs_acquire(svn_repos__worker_fs_t **worker_fs,
+                             svn_fs_t **fs,
+                             const char *fs_path,
+                             const char *uuid,
+                             apr_hash_t *fs_config,
+                             apr_pool_t *scratch_pool)
+{
+  svn_repos__worker_fs_t *wfs;
+  worker_fs_list_t *list;
+  const char *key;
+  apr_pool_t *pool;
+  svn_error_t *err;
+
+  SVN_ERR(svn_atomic__init_once(&registry_init_state, init_registry,
+                                NULL, scratch_pool));
+
+  SVN_ERR(svn_dirent_get_absolute(&fs_path, fs_path, scratch_pool));
+  key = apr_pstrcat(scratch_pool, fs_path, ":", uuid, (char *)NULL);
+  SVN_MUTEX__WITH_LOCK(registry_mutex, take_idle(&wfs, &list, key));
+
+  /* Open a new instance outside the lock. */
+  if (! wfs)
+    {
+      pool = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+      wfs = apr_pcalloc(pool, sizeof(*wfs));
+      wfs->pool = pool;
+      wfs->list = list;
+
+      err = svn_fs_open(&wfs->fs, fs_path, fs_config, pool);
+      if (err)
+        {
+          svn_pool_destroy(pool);
+          return svn_error_trace(err);
+        }
+    }
+
+  *worker_fs = wfs;
+  *fs = wfs->fs;
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_repos__worker_fs_release(svn_repos__worker_fs_t *worker_fs)
+{
+  svn_boolean_t surplus;
+
+  SVN_MUTEX__WITH_LOCK(registry_mutex, put_idle(&surplus, worker_fs));
+  if (surplus)
+    svn_pool_destroy(worker_fs->pool);
+
+  return SVN_NO_ERROR;
+}
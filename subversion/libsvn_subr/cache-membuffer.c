@@ -1902,6 +1902,40 @@ svn_membuffer_get_segment_info(svn_membuffer_t *segment,
   return SVN_NO_ERROR;
 }
 
+/* Add the access counters of SEGMENT to *READS and *HITS.
+ */
+static svn_error_t *
+svn_membuffer_get_segment_access_counts(svn_membuffer_t *segment,
+                                        apr_uint64_t *reads,
+                                        apr_uint64_t *hits)
+{
+  *reads += segment->total_reads;
+  *hits += segment->total_hits;
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_cache__membuffer_get_access_counts(apr_uint64_t *reads,
+                                       apr_uint64_t *hits,
+                                       svn_membuffer_t *membuffer)
+{
+  apr_uint32_t i;
+
+  *reads = 0;
+  *hits = 0;
+
+  for (i = 0; i < membuffer->segment_count; ++i)
+    {
+      svn_membuffer_t *segment = membuffer + i;
+      WITH_READ_LOCK(segment,
+                     svn_membuffer_get_segment_access_counts(segment,
+                                                             reads, hits));
+    }
+
+  return SVN_NO_ERROR;
+}
+
 /* Implement svn_cache__vtable_t.get_info
  * (thread-safe even without mutex)
  */
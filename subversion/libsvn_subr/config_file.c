@@ -807,6 +807,10 @@ svn_config_ensure(const char *config_dir, apr_pool_t *pool)
         "###   http-library               Which library to use for http/https"
                                                                              NL
         "###                              connections."                      NL
+        "###   svn-max-connections        Number of connections to use for"  NL
+        "###                              updates over svn://"               NL
+        "###   svn-read-ahead             Number of log and blame items to"  NL
+        "###                              read ahead over svn://"            NL
         "###   store-passwords            Specifies whether passwords used"  NL
         "###                              to authenticate against a"         NL
         "###                              Subversion server may be cached"   NL
@@ -884,6 +888,18 @@ svn_config_ensure(const char *config_dir, apr_pool_t *pool)
         "### HTTP timeouts, if given, are specified in seconds.  A timeout"  NL
         "### of 0, i.e. zero, causes a builtin default to be used."          NL
         "###"                                                                NL
+        "### svn-max-connections lets updates and checkouts from an svn://"  NL
+        "### server fetch file contents over additional connections while"   NL
+        "### the main connection carries the tree changes.  The value is the" NL
+        "### total number of connections per update and defaults to 1,"      NL
+        "### which disables the feature.  Servers must support this (1.8+)." NL
+        "###"                                                                NL
+        "### svn-read-ahead lets log and blame over svn:// read and parse"   NL
+        "### the server's response on a separate thread while the results"   NL
+        "### are being processed.  The value is the maximum number of"       NL
+        "### response items to read ahead and defaults to 0, which disables" NL
+        "### the feature."                                                   NL
+        "###"                                                                NL
         "### Most users will not need to explicitly set the http-library"    NL
         "### option, but valid values for the option include:"               NL
         "###    'serf': Serf-based module (Subversion 1.5 - present)"        NL
@@ -1140,6 +1156,11 @@ svn_config_ensure(const char *config_dir, apr_pool_t *pool)
         "### ra_local (the file:// scheme). The value represents the number" NL
         "### of MB used by the cache."                                       NL
         "# memory-cache-size = 16"                                           NL
+        "### Set merge-threads to the maximum number of files whose texts"   NL
+        "### 'svn merge' may merge concurrently while it keeps receiving"    NL
+        "### changes from the repository.  It defaults to 1, i.e. files"     NL
+        "### are merged one after another."                                  NL
+        "# merge-threads = 4"                                                NL
         ""                                                                   NL
         "### Section for configuring automatic properties."                  NL
         "[auto-props]"                                                       NL
@@ -0,0 +1,343 @@
+/*
+ * thread_pool.c: a bounded pool of worker threads for background tasks
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <apr_thread_proc.h>
+#include <apr_thread_mutex.h>
+#include <apr_thread_cond.h>
+
+#include "svn_pools.h"
+#include "svn_error.h"
+
+#include "private/svn_thread_pool.h"
+
+#include "svn_private_config.h"
+
+struct svn_thread_pool__job_t
+{
+  /* The thread pool that executes this job. */
+  svn_thread_pool__t *thread_pool;
+
+  /* The task to run and its parameter. */
+  svn_thread_pool__task_t task;
+  void *baton;
+
+  /* Root pool with its own allocator.  Only the thread executing TASK
+     may use it until DONE has been set.  NULL after destruction. */
+  apr_pool_t *pool;
+
+  /* The pool that our cleanup has been registered with. */
+  apr_pool_t *result_pool;
+
+  /* The return value of TASK. */
+  svn_error_t *err;
+
+  /* Set once TASK has returned. */
+  svn_boolean_t done;
+
+  /* Next job in the queue of pending jobs. */
+  svn_thread_pool__job_t *next;
+};
+
+struct svn_thread_pool__t
+{
+  /* Upper limit to the number of worker threads. */
+  int max_threads;
+
+#if APR_HAS_THREADS
+  /* Serializes access to all members below. */
+  apr_thread_mutex_t *mutex;
+
+  /* Signaled whenever a job has been queued or we are shutting down. */
+  apr_thread_cond_t *job_queued;
+
+  /* Signaled whenever a job has been completed. */
+  apr_thread_cond_t *job_done;
+
+  /* FIFO of jobs that have not been picked up by any thread, yet. */
+  svn_thread_pool__job_t *first;
+  svn_thread_pool__job_t *last;
+
+  /* Running worker threads (apr_thread_t *) and the number of them
+     that are currently waiting for work. */
+  apr_array_header_t *threads;
+  int idle_threads;
+
+  /* Pool with a thread-safe allocator used to create the threads. */
+  apr_pool_t *threads_pool;
+
+  /* Set when the worker threads shall terminate. */
+  svn_boolean_t shutdown;
+#endif
+};
+
+/* Execute the task of JOB and store its result in JOB. */
+static void
+run_job(svn_thread_pool__job_t *job)
+{
+  apr_pool_t *scratch_pool = svn_pool_create(job->pool);
+
+  job->err = job->task(job->baton, job->pool, scratch_pool);
+  svn_pool_destroy(scratch_pool);
+}
+
+#if APR_HAS_THREADS
+
+/* Thread function executing jobs from the svn_thread_pool__t in DATA
+   until we get told to shut down and no jobs are left. */
+static void * APR_THREAD_FUNC
+worker_thread(apr_thread_t *thread, void *data)
+{
+  svn_thread_pool__t *thread_pool = data;
+
+  apr_thread_mutex_lock(thread_pool->mutex);
+  while (TRUE)
+    {
+      svn_thread_pool__job_t *job = thread_pool->first;
+
+      if (job)
+        {
+          thread_pool->first = job->next;
+          if (thread_pool->first == NULL)
+            thread_pool->last = NULL;
+
+          apr_thread_mutex_unlock(thread_pool->mutex);
+          run_job(job);
+          apr_thread_mutex_lock(thread_pool->mutex);
+
+          job->done = TRUE;
+          apr_thread_cond_broadcast(thread_pool->job_done);
+        }
+      else if (thread_pool->shutdown)
+        {
+          break;
+        }
+      else
+        {
+          thread_pool->idle_threads++;
+          apr_thread_cond_wait(thread_pool->job_queued, thread_pool->mutex);
+          thread_pool->idle_threads--;
+        }
+    }
+  apr_thread_mutex_unlock(thread_pool->mutex);
+
+  return NULL;
+}
+
+/* Pool cleanup function terminating and joining all worker threads of
+   the svn_thread_pool__t in DATA. */
+static apr_status_t
+thread_pool_cleanup(void *data)
+{
+  svn_thread_pool__t *thread_pool = data;
+  int i;
+
+  apr_thread_mutex_lock(thread_pool->mutex);
+  thread_pool->shutdown = TRUE;
+  apr_thread_cond_broadcast(thread_pool->job_queued);
+  apr_thread_mutex_unlock(thread_pool->mutex);
+
+  for (i = 0; i < thread_pool->threads->nelts; i++)
+    {
+      apr_status_t retval;
+      apr_thread_join(&retval,
+                      APR_ARRAY_IDX(thread_pool->threads, i, apr_thread_t *));
+    }
+
+  apr_pool_destroy(thread_pool->threads_pool);
+
+  return APR_SUCCESS;
+}
+
+#endif
+
+svn_error_t *
+svn_thread_pool__create(svn_thread_pool__t **thread_pool,
+                        int max_threads,
+                        apr_pool_t *result_pool)
+{
+  svn_thread_pool__t *new_pool = apr_pcalloc(result_pool, sizeof(*new_pool));
+
+  new_pool->max_threads = max_threads;
+
+#if APR_HAS_THREADS
+  if (max_threads > 1)
+    {
+      apr_status_t status;
+
+      status = apr_thread_mutex_create(&new_pool->mutex,
+                                       APR_THREAD_MUTEX_DEFAULT,
+                                       result_pool);
+      if (status)
+        return svn_error_wrap_apr(status, _("Can't create mutex"));
+
+      status = apr_thread_cond_create(&new_pool->job_queued, result_pool);
+      if (!status)
+        status = apr_thread_cond_create(&new_pool->job_done, result_pool);
+      if (status)
+        return svn_error_wrap_apr(status, _("Can't create condition variable"));
+
+      new_pool->threads = apr_array_make(result_pool, max_threads,
+                                         sizeof(apr_thread_t *));
+      new_pool->threads_pool
+        = apr_allocator_owner_get(svn_pool_create_allocator(TRUE));
+
+      /* Register this last, so it runs before the mutex and conditions
+         get destroyed. */
+      apr_pool_cleanup_register(result_pool, new_pool, thread_pool_cleanup,
+                                apr_pool_cleanup_null);
+    }
+#endif
+
+  *thread_pool = new_pool;
+
+  return SVN_NO_ERROR;
+}
+
+svn_boolean_t
+svn_thread_pool__is_parallel(svn_thread_pool__t *thread_pool)
+{
+#if APR_HAS_THREADS
+  return thread_pool->max_threads > 1;
+#else
+  return FALSE;
+#endif
+}
+
+/* Pool cleanup function destroying the svn_thread_pool__job_t in DATA. */
+static apr_status_t
+job_cleanup(void *data)
+{
+  svn_thread_pool__job_t *job = data;
+
+  svn_error_clear(svn_thread_pool__wait(job));
+  if (job->pool)
+    {
+      svn_pool_destroy(job->pool);
+      job->pool = NULL;
+    }
+
+  return APR_SUCCESS;
+}
+
+svn_error_t *
+svn_thread_pool__submit(svn_thread_pool__job_t **job,
+                        svn_thread_pool__t *thread_pool,
+                        svn_thread_pool__task_t task,
+                        void *baton,
+                        apr_pool_t *result_pool)
+{
+  svn_thread_pool__job_t *new_job = apr_pcalloc(result_pool,
+                                                sizeof(*new_job));
+
+  new_job->thread_pool = thread_pool;
+  new_job->task = task;
+  new_job->baton = baton;
+  new_job->result_pool = result_pool;
+  new_job->pool = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+
+  apr_pool_cleanup_register(result_pool, new_job, job_cleanup,
+                            apr_pool_cleanup_null);
+  *job = new_job;
+
+  if (! svn_thread_pool__is_parallel(thread_pool))
+    {
+      run_job(new_job);
+      new_job->done = TRUE;
+
+      return SVN_NO_ERROR;
+    }
+
+#if APR_HAS_THREADS
+  {
+    apr_status_t status = APR_SUCCESS;
+
+    apr_thread_mutex_lock(thread_pool->mutex);
+
+    if (thread_pool->last)
+      thread_pool->last->next = new_job;
+    else
+      thread_pool->first = new_job;
+    thread_pool->last = new_job;
+
+    if (thread_pool->idle_threads == 0
+        && thread_pool->threads->nelts < thread_pool->max_threads)
+      {
+        apr_thread_t *thread;
+
+        status = apr_thread_create(&thread, NULL, worker_thread, thread_pool,
+                                   thread_pool->threads_pool);
+        if (!status)
+          APR_ARRAY_PUSH(thread_pool->threads, apr_thread_t *) = thread;
+      }
+    else
+      {
+        apr_thread_cond_signal(thread_pool->job_queued);
+      }
+
+    /* Without any worker thread, nobody would ever pick up the job.
+       This is the only job in the queue then. */
+    if (status && thread_pool->threads->nelts == 0)
+      {
+        thread_pool->first = NULL;
+        thread_pool->last = NULL;
+        new_job->done = TRUE;
+      }
+
+    apr_thread_mutex_unlock(thread_pool->mutex);
+
+    if (new_job->done)
+      return svn_error_wrap_apr(status, _("Can't create thread"));
+  }
+#endif
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_thread_pool__wait(svn_thread_pool__job_t *job)
+{
+  svn_error_t *err;
+
+#if APR_HAS_THREADS
+  if (svn_thread_pool__is_parallel(job->thread_pool))
+    {
+      svn_thread_pool__t *thread_pool = job->thread_pool;
+
+      apr_thread_mutex_lock(thread_pool->mutex);
+      while (! job->done)
+        apr_thread_cond_wait(thread_pool->job_done, thread_pool->mutex);
+      apr_thread_mutex_unlock(thread_pool->mutex);
+    }
+#endif
+
+  err = job->err;
+  job->err = SVN_NO_ERROR;
+
+  return svn_error_trace(err);
+}
+
+void
+svn_thread_pool__job_destroy(svn_thread_pool__job_t *job)
+{
+  apr_pool_cleanup_run(job->result_pool, job, job_cleanup);
+}
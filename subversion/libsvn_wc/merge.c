@@ -52,8 +52,37 @@ typedef struct merge_target_t
   const char *diff3_cmd;                    /* The diff3 command and options */
   const apr_array_header_t *merge_options;
 
+  svn_wc__premerge_t *premerge;             /* Precomputed text merge result
+                                               or NULL */
 } merge_target_t;
 
+/* The state of a text merge that is performed outside the working copy
+   database, see svn_wc__premerge_prepare(). */
+struct svn_wc__premerge_t
+{
+  /* The merge target and the labels for the conflict markers. */
+  const char *target_abspath;
+  const char *left_label;
+  const char *right_label;
+  const char *target_label;
+
+  /* Options to pass to the internal diff3 implementation. */
+  const apr_array_header_t *merge_options;
+
+  /* Where to put RESULT_ABSPATH. */
+  const char *temp_dir_abspath;
+
+  /* Set by svn_wc__premerge_run(). */
+  const char *left_abspath;
+  const char *right_abspath;
+  const char *result_abspath;
+  svn_boolean_t contains_conflicts;
+
+  /* Set once the work queue took over the responsibility to remove
+     RESULT_ABSPATH. */
+  svn_boolean_t consumed;
+};
+
 
 /* Return a pointer to the svn_prop_t structure from PROP_DIFF
    belonging to PROP_NAME, if any.  NULL otherwise.*/
@@ -781,6 +810,18 @@ merge_text_file(svn_skel_t **work_items,
 
   base_name = svn_dirent_basename(mt->local_abspath, scratch_pool);
 
+  /* If the merge has already been done for us, just pick up its result. */
+  if (mt->premerge && ! mt->diff3_cmd)
+    {
+      SVN_ERR_ASSERT(mt->premerge->result_abspath != NULL);
+
+      result_target = mt->premerge->result_abspath;
+      contains_conflicts = mt->premerge->contains_conflicts;
+      /* In dry-run mode, the work items will never be run. */
+      mt->premerge->consumed = ! dry_run;
+      goto merged;
+    }
+
   /* Open a second temporary file for writing; this is where diff3
      will write the merged results.  We want to use a tempfile
      with a name that reflects the original, in case this
@@ -817,6 +858,7 @@ merge_text_file(svn_skel_t **work_items,
 
   SVN_ERR(svn_io_file_close(result_f, pool));
 
+merged:
   if (contains_conflicts && ! dry_run)
     {
       *merge_outcome = svn_wc_merge_conflict;
@@ -1012,6 +1054,7 @@ svn_wc__internal_merge(svn_skel_t **work_items,
                        const char *diff3_cmd,
                        const apr_array_header_t *merge_options,
                        const apr_array_header_t *prop_diff,
+                       svn_wc__premerge_t *premerge,
                        svn_cancel_func_t cancel_func,
                        void *cancel_baton,
                        apr_pool_t *result_pool,
@@ -1037,6 +1080,7 @@ svn_wc__internal_merge(svn_skel_t **work_items,
   mt.prop_diff = prop_diff;
   mt.diff3_cmd = diff3_cmd;
   mt.merge_options = merge_options;
+  mt.premerge = premerge;
 
   /* Decide if the merge target is a text or binary file. */
   if ((mimeprop = get_prop(&mt, SVN_PROP_MIME_TYPE))
@@ -1118,28 +1162,31 @@ svn_wc__internal_merge(svn_skel_t **work_items,
 }
 
 
-svn_error_t *
-svn_wc_merge5(enum svn_wc_merge_outcome_t *merge_content_outcome,
-              enum svn_wc_notify_state_t *merge_props_outcome,
-              svn_wc_context_t *wc_ctx,
-              const char *left_abspath,
-              const char *right_abspath,
-              const char *target_abspath,
-              const char *left_label,
-              const char *right_label,
-              const char *target_label,
-              const svn_wc_conflict_version_t *left_version,
-              const svn_wc_conflict_version_t *right_version,
-              svn_boolean_t dry_run,
-              const char *diff3_cmd,
-              const apr_array_header_t *merge_options,
-              apr_hash_t *original_props,
-              const apr_array_header_t *prop_diff,
-              svn_wc_conflict_resolver_func2_t conflict_func,
-              void *conflict_baton,
-              svn_cancel_func_t cancel_func,
-              void *cancel_baton,
-              apr_pool_t *scratch_pool)
+/* The implementation of svn_wc__merge_premerged(), except that an unused
+   PREMERGE result does not get cleaned up. */
+static svn_error_t *
+merge_file(enum svn_wc_merge_outcome_t *merge_content_outcome,
+           enum svn_wc_notify_state_t *merge_props_outcome,
+           svn_wc_context_t *wc_ctx,
+           svn_wc__premerge_t *premerge,
+           const char *left_abspath,
+           const char *right_abspath,
+           const char *target_abspath,
+           const char *left_label,
+           const char *right_label,
+           const char *target_label,
+           const svn_wc_conflict_version_t *left_version,
+           const svn_wc_conflict_version_t *right_version,
+           svn_boolean_t dry_run,
+           const char *diff3_cmd,
+           const apr_array_header_t *merge_options,
+           apr_hash_t *original_props,
+           const apr_array_header_t *prop_diff,
+           svn_wc_conflict_resolver_func2_t conflict_func,
+           void *conflict_baton,
+           svn_cancel_func_t cancel_func,
+           void *cancel_baton,
+           apr_pool_t *scratch_pool)
 {
   const char *dir_abspath = svn_dirent_dirname(target_abspath, scratch_pool);
   svn_skel_t *work_items;
@@ -1273,6 +1320,7 @@ svn_wc_merge5(enum svn_wc_merge_outcome_t *merge_content_outcome,
                                  diff3_cmd,
                                  merge_options,
                                  prop_diff,
+                                 premerge,
                                  cancel_func, cancel_baton,
                                  scratch_pool, scratch_pool));
 
@@ -1326,6 +1374,224 @@ svn_wc_merge5(enum svn_wc_merge_outcome_t *merge_content_outcome,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_wc_merge5(enum svn_wc_merge_outcome_t *merge_content_outcome,
+              enum svn_wc_notify_state_t *merge_props_outcome,
+              svn_wc_context_t *wc_ctx,
+              const char *left_abspath,
+              const char *right_abspath,
+              const char *target_abspath,
+              const char *left_label,
+              const char *right_label,
+              const char *target_label,
+              const svn_wc_conflict_version_t *left_version,
+              const svn_wc_conflict_version_t *right_version,
+              svn_boolean_t dry_run,
+              const char *diff3_cmd,
+              const apr_array_header_t *merge_options,
+              apr_hash_t *original_props,
+              const apr_array_header_t *prop_diff,
+              svn_wc_conflict_resolver_func2_t conflict_func,
+              void *conflict_baton,
+              svn_cancel_func_t cancel_func,
+              void *cancel_baton,
+              apr_pool_t *scratch_pool)
+{
+  return svn_error_trace(merge_file(merge_content_outcome,
+                                    merge_props_outcome,
+                                    wc_ctx, NULL /* premerge */,
+                                    left_abspath, right_abspath,
+                                    target_abspath,
+                                    left_label, right_label, target_label,
+                                    left_version, right_version,
+                                    dry_run, diff3_cmd, merge_options,
+                                    original_props, prop_diff,
+                                    conflict_func, conflict_baton,
+                                    cancel_func, cancel_baton,
+                                    scratch_pool));
+}
+
+svn_error_t *
+svn_wc__premerge_prepare(svn_wc__premerge_t **premerge,
+                         svn_wc_context_t *wc_ctx,
+                         const char *target_abspath,
+                         const char *left_label,
+                         const char *right_label,
+                         const char *target_label,
+                         const apr_array_header_t *merge_options,
+                         const apr_array_header_t *prop_diff,
+                         apr_pool_t *result_pool,
+                         apr_pool_t *scratch_pool)
+{
+  svn_wc__premerge_t *pm;
+  apr_hash_t *actual_props;
+  const char *mime_type;
+  svn_subst_eol_style_t style;
+  const char *eol;
+  apr_hash_t *keywords;
+  svn_boolean_t special;
+  svn_error_t *err;
+  int i;
+
+  SVN_ERR_ASSERT(svn_dirent_is_absolute(target_abspath));
+
+  *premerge = NULL;
+
+  /* Changes to any of the translation properties require the working
+     file to be (de)translated first, see detranslate_wc_file(). */
+  if (prop_diff && svn_wc__has_magic_property(prop_diff))
+    return SVN_NO_ERROR;
+
+  for (i = 0; prop_diff && i < prop_diff->nelts; i++)
+    {
+      const svn_prop_t *elt = &APR_ARRAY_IDX(prop_diff, i, svn_prop_t);
+
+      if (strcmp(elt->name, SVN_PROP_MIME_TYPE) == 0)
+        return SVN_NO_ERROR;
+    }
+
+  err = svn_wc__db_read_props(&actual_props, wc_ctx->db, target_abspath,
+                              scratch_pool, scratch_pool);
+  if (err && err->apr_err == SVN_ERR_WC_PATH_NOT_FOUND)
+    {
+      /* svn_wc_merge5() will take care of this case. */
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+  else
+    SVN_ERR(err);
+
+  mime_type = svn_prop_get_value(actual_props, SVN_PROP_MIME_TYPE);
+  if (mime_type && svn_mime_type_is_binary(mime_type))
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_wc__get_translate_info(&style, &eol, &keywords, &special,
+                                     wc_ctx->db, target_abspath,
+                                     actual_props, TRUE,
+                                     scratch_pool, scratch_pool));
+  if (style != svn_subst_eol_style_none || eol || keywords || special)
+    return SVN_NO_ERROR;
+
+  pm = apr_pcalloc(result_pool, sizeof(*pm));
+  pm->target_abspath = apr_pstrdup(result_pool, target_abspath);
+  pm->left_label = left_label ? apr_pstrdup(result_pool, left_label) : NULL;
+  pm->right_label = right_label ? apr_pstrdup(result_pool, right_label)
+                                : NULL;
+  pm->target_label = target_label ? apr_pstrdup(result_pool, target_label)
+                                  : NULL;
+  pm->merge_options = merge_options;
+
+  SVN_ERR(svn_wc__db_temp_wcroot_tempdir(&pm->temp_dir_abspath, wc_ctx->db,
+                                         target_abspath,
+                                         result_pool, scratch_pool));
+
+  *premerge = pm;
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_wc__premerge_run(svn_wc__premerge_t *premerge,
+                     const char *left_abspath,
+                     const char *right_abspath,
+                     svn_cancel_func_t cancel_func,
+                     void *cancel_baton,
+                     apr_pool_t *result_pool,
+                     apr_pool_t *scratch_pool)
+{
+  merge_target_t mt = { 0 };
+  apr_file_t *result_f;
+
+  SVN_ERR_ASSERT(svn_dirent_is_absolute(left_abspath));
+  SVN_ERR_ASSERT(svn_dirent_is_absolute(right_abspath));
+
+  if (cancel_func)
+    SVN_ERR(cancel_func(cancel_baton));
+
+  premerge->left_abspath = apr_pstrdup(result_pool, left_abspath);
+  premerge->right_abspath = apr_pstrdup(result_pool, right_abspath);
+
+  /* do_text_merge() only needs to know the options. */
+  mt.local_abspath = premerge->target_abspath;
+  mt.merge_options = premerge->merge_options;
+
+  /* Same naming scheme as in merge_text_file(). */
+  SVN_ERR(svn_io_open_uniquely_named(&result_f, &premerge->result_abspath,
+                                     premerge->temp_dir_abspath,
+                                     svn_dirent_basename(
+                                       premerge->target_abspath,
+                                       scratch_pool),
+                                     ".tmp", svn_io_file_del_none,
+                                     result_pool, scratch_pool));
+
+  /* No translation is required, so the working file itself serves as
+     the detranslated target. */
+  SVN_ERR(do_text_merge(&premerge->contains_conflicts, result_f, &mt,
+                        premerge->target_abspath,
+                        premerge->left_abspath, premerge->right_abspath,
+                        premerge->target_label,
+                        premerge->left_label, premerge->right_label,
+                        scratch_pool));
+
+  return svn_error_trace(svn_io_file_close(result_f, scratch_pool));
+}
+
+svn_error_t *
+svn_wc__merge_premerged(enum svn_wc_merge_outcome_t *merge_content_outcome,
+                        enum svn_wc_notify_state_t *merge_props_outcome,
+                        svn_wc_context_t *wc_ctx,
+                        svn_wc__premerge_t *premerge,
+                        const char *left_abspath,
+                        const char *right_abspath,
+                        const char *target_abspath,
+                        const char *left_label,
+                        const char *right_label,
+                        const char *target_label,
+                        const svn_wc_conflict_version_t *left_version,
+                        const svn_wc_conflict_version_t *right_version,
+                        svn_boolean_t dry_run,
+                        const char *diff3_cmd,
+                        const apr_array_header_t *merge_options,
+                        apr_hash_t *original_props,
+                        const apr_array_header_t *prop_diff,
+                        svn_wc_conflict_resolver_func2_t conflict_func,
+                        void *conflict_baton,
+                        svn_cancel_func_t cancel_func,
+                        void *cancel_baton,
+                        apr_pool_t *scratch_pool)
+{
+  svn_error_t *err;
+
+  if (premerge)
+    {
+      SVN_ERR_ASSERT(premerge->result_abspath != NULL);
+      SVN_ERR_ASSERT(strcmp(premerge->left_abspath, left_abspath) == 0);
+      SVN_ERR_ASSERT(strcmp(premerge->right_abspath, right_abspath) == 0);
+      SVN_ERR_ASSERT(strcmp(premerge->target_abspath, target_abspath) == 0);
+    }
+
+  err = merge_file(merge_content_outcome, merge_props_outcome,
+                   wc_ctx, premerge,
+                   left_abspath, right_abspath, target_abspath,
+                   left_label, right_label, target_label,
+                   left_version, right_version,
+                   dry_run, diff3_cmd, merge_options,
+                   original_props, prop_diff,
+                   conflict_func, conflict_baton,
+                   cancel_func, cancel_baton,
+                   scratch_pool);
+
+  /* The merge might have been resolved trivially or not at all, leaving
+     the premerged text unused. */
+  if (premerge && ! premerge->consumed)
+    err = svn_error_compose_create(
+            err,
+            svn_io_remove_file2(premerge->result_abspath, TRUE,
+                                scratch_pool));
+
+  return svn_error_trace(err);
+}
+
 
 /* Constructor for the result-structure returned by conflict callbacks. */
 svn_wc_conflict_result_t *
@@ -3583,6 +3583,7 @@ svn_wc__perform_file_merge(svn_skel_t **work_items,
                                  actual_props,
                                  FALSE /* dry_run */,
                                  diff3_cmd, NULL, propchanges,
+                                 NULL /* premerge */,
                                  cancel_func, cancel_baton,
                                  result_pool, scratch_pool));
 
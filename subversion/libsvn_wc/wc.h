@@ -406,6 +406,10 @@ svn_wc__internal_file_modified_p(svn_boolean_t *modified_p,
 
    Property changes sent by the update are provided in PROP_DIFF.
 
+   If PREMERGE is not NULL, it must describe the same text merge and must
+   have been run with svn_wc__premerge_run().  Its result will then be
+   used instead of merging the texts again.
+
    For a complete description, see svn_wc_merge3() for which this is
    the (loggy) implementation.
 
@@ -429,6 +433,7 @@ svn_wc__internal_merge(svn_skel_t **work_items,
                        const char *diff3_cmd,
                        const apr_array_header_t *merge_options,
                        const apr_array_header_t *prop_diff,
+                       svn_wc__premerge_t *premerge,
                        svn_cancel_func_t cancel_func,
                        void *cancel_baton,
                        apr_pool_t *result_pool,
@@ -47,6 +47,7 @@
 #include "svn_pools.h"
 #include "svn_dirent_uri.h"
 #include "private/svn_fspath.h"
+#include "private/svn_repos_private.h"
 
 
 #ifdef APLOG_USE_MODULE
@@ -161,6 +162,28 @@ static const command_rec authz_svn_cmds[] =
   { NULL }
 };
 
+/*
+ * Return the counters of the authz checks done on behalf of the main
+ * request of R, creating them if necessary.
+ */
+static svn_repos__authz_counters_t *
+get_authz_counters(request_rec *r)
+{
+  svn_repos__authz_counters_t *counters;
+
+  while (r->main)
+    r = r->main;
+
+  counters = ap_get_module_config(r->request_config, &authz_svn_module);
+  if (counters == NULL)
+    {
+      counters = apr_pcalloc(r->pool, sizeof(*counters));
+      ap_set_module_config(r->request_config, &authz_svn_module, counters);
+    }
+
+  return counters;
+}
+
 /*
  * Get the, possibly cached, svn_authz_t for this request.
  */
@@ -202,8 +225,11 @@ get_access_conf(request_rec *r, authz_svn_config_rec *conf,
   access_conf = user_data;
   if (access_conf == NULL)
     {
-      svn_err = svn_repos_authz_read(&access_conf, access_file,
-                                     TRUE, r->connection->pool);
+      /* The compiled authz file is shared with all other connections
+         that use it, until it gets modified. */
+      svn_err = svn_repos__authz_read_shared(&access_conf, access_file,
+                                             TRUE, r->connection->pool,
+                                             scratch_pool);
       if (svn_err)
         {
           ap_log_rerror(APLOG_MARK, APLOG_ERR,
@@ -450,12 +476,13 @@ req_check_access(request_rec *r,
   if (repos_path
       || (!repos_path && (authz_svn_type & svn_authz_write)))
     {
-      svn_err = svn_repos_authz_check_access(access_conf, repos_name,
-                                             repos_path,
-                                             username_to_authorize,
-                                             authz_svn_type,
-                                             &authz_access_granted,
-                                             r->pool);
+      svn_err = svn_repos__authz_check_access(access_conf, repos_name,
+                                              repos_path,
+                                              username_to_authorize,
+                                              authz_svn_type,
+                                              &authz_access_granted,
+                                              get_authz_counters(r),
+                                              r->pool);
       if (svn_err)
         {
           ap_log_rerror(APLOG_MARK, APLOG_ERR,
@@ -495,14 +522,15 @@ req_check_access(request_rec *r,
      repos_path == NULL (see above for explanations) */
   if (repos_path)
     {
-      svn_err = svn_repos_authz_check_access(access_conf,
-                                             dest_repos_name,
-                                             dest_repos_path,
-                                             username_to_authorize,
-                                             svn_authz_write
-                                             |svn_authz_recursive,
-                                             &authz_access_granted,
-                                             r->pool);
+      svn_err = svn_repos__authz_check_access(access_conf,
+                                              dest_repos_name,
+                                              dest_repos_path,
+                                              username_to_authorize,
+                                              svn_authz_write
+                                              |svn_authz_recursive,
+                                              &authz_access_granted,
+                                              get_authz_counters(r),
+                                              r->pool);
       if (svn_err)
         {
           ap_log_rerror(APLOG_MARK, APLOG_ERR,
@@ -618,12 +646,13 @@ subreq_bypass2(request_rec *r,
    */
   if (repos_path)
     {
-      svn_err = svn_repos_authz_check_access(access_conf, repos_name,
-                                             repos_path,
-                                             username_to_authorize,
-                                             svn_authz_none|svn_authz_read,
-                                             &authz_access_granted,
-                                             scratch_pool);
+      svn_err = svn_repos__authz_check_access(access_conf, repos_name,
+                                              repos_path,
+                                              username_to_authorize,
+                                              svn_authz_none|svn_authz_read,
+                                              &authz_access_granted,
+                                              get_authz_counters(r),
+                                              scratch_pool);
       if (svn_err)
         {
           ap_log_rerror(APLOG_MARK, APLOG_ERR,
@@ -801,6 +830,34 @@ auth_checker(request_rec *r)
   return OK;
 }
 
+/*
+ * Report the number of authz checks and rule evaluations of the request
+ * R in its notes "authz-svn-checks" and "authz-svn-evaluations", for use
+ * in custom log formats, and in the debug log.
+ */
+static int
+log_authz_counters(request_rec *r)
+{
+  svn_repos__authz_counters_t *counters
+    = ap_get_module_config(r->request_config, &authz_svn_module);
+
+  if (counters == NULL || r->main)
+    return DECLINED;
+
+  apr_table_setn(r->notes, "authz-svn-checks",
+                 apr_psprintf(r->pool, "%" APR_UINT64_T_FMT,
+                              counters->checks));
+  apr_table_setn(r->notes, "authz-svn-evaluations",
+                 apr_psprintf(r->pool, "%" APR_UINT64_T_FMT,
+                              counters->evaluations));
+  ap_log_rerror(APLOG_MARK, APLOG_DEBUG, 0, r,
+                "%" APR_UINT64_T_FMT " authz checks, %" APR_UINT64_T_FMT
+                " rule evaluations", counters->checks,
+                counters->evaluations);
+
+  return DECLINED;
+}
+
 /*
  * Module flesh
  */
@@ -817,6 +874,9 @@ register_hooks(apr_pool_t *p)
    * give SSLOptions +FakeBasicAuth a chance to work. */
   ap_hook_check_user_id(check_user_id, mod_ssl, NULL, APR_HOOK_FIRST);
   ap_hook_auth_checker(auth_checker, NULL, NULL, APR_HOOK_FIRST);
+  /* Set our notes before mod_log_config writes the access log. */
+  ap_hook_log_transaction(log_authz_counters, NULL, NULL,
+                          APR_HOOK_REALLY_FIRST);
   ap_register_provider(p,
                        AUTHZ_SVN__SUBREQ_BYPASS_PROV_GRP,
                        AUTHZ_SVN__SUBREQ_BYPASS_PROV_NAME,
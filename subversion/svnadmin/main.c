@@ -43,6 +43,7 @@
 #include "svn_xml.h"
 
 #include "private/svn_opt_private.h"
+#include "private/svn_repos_private.h"
 
 #include "svn_private_config.h"
 
@@ -101,14 +102,12 @@ warning_func(void *baton,
 }
 
 
-/* Helper to open a repository and set a warning func (so we don't
- * SEGFAULT when libsvn_fs's default handler gets run).  */
-static svn_error_t *
-open_repos(svn_repos_t **repos,
-           const char *path,
-           apr_pool_t *pool)
+/* Return the FS configuration parameters to open repositories with,
+ * allocated in POOL.  */
+static apr_hash_t *
+get_fs_config(apr_pool_t *pool)
 {
-  /* construct FS configuration parameters: enable caches for r/o data */
+  /* enable caches for r/o data */
   apr_hash_t *fs_config = apr_hash_make(pool);
   apr_hash_set(fs_config, SVN_FS_CONFIG_FSFS_CACHE_DELTAS,
                APR_HASH_KEY_STRING, "1");
@@ -117,8 +116,18 @@ open_repos(svn_repos_t **repos,
   apr_hash_set(fs_config, SVN_FS_CONFIG_FSFS_CACHE_REVPROPS,
                APR_HASH_KEY_STRING, "1");
 
+  return fs_config;
+}
+
+/* Helper to open a repository and set a warning func (so we don't
+ * SEGFAULT when libsvn_fs's default handler gets run).  */
+static svn_error_t *
+open_repos(svn_repos_t **repos,
+           const char *path,
+           apr_pool_t *pool)
+{
   /* now, open the requested repository */
-  SVN_ERR(svn_repos_open2(repos, path, fs_config, pool));
+  SVN_ERR(svn_repos_open2(repos, path, get_fs_config(pool), pool));
   svn_fs_set_warning_func(svn_repos_fs(*repos), warning_func, NULL);
   return SVN_NO_ERROR;
 }
@@ -146,6 +155,8 @@ check_lib_versions(void)
 /** Subcommands. **/
 
 static svn_opt_subcommand_t
+  subcommand_build_log_index,
+  subcommand_build_mergeinfo_index,
   subcommand_crashtest,
   subcommand_create,
   subcommand_deltify,
@@ -193,7 +204,9 @@ enum svnadmin__cmdline_options_t
     svnadmin__pre_1_4_compatible,
     svnadmin__pre_1_5_compatible,
     svnadmin__pre_1_6_compatible,
-    svnadmin__pre_1_8_compatible
+    svnadmin__pre_1_8_compatible,
+    svnadmin__threads,
+    svnadmin__chunked_deltas
   };
 
 /* Option codes and descriptions.
@@ -291,6 +304,14 @@ static const apr_getopt_option_t options_table[] =
         "                             minimize redundant operations. Default: 16.\n"
         "                             [used for FSFS repositories only]")},
 
+    {"threads",       svnadmin__threads, 1,
+     N_("use up to ARG threads to process the data\n"
+        "                             (default: 1)")},
+
+    {"chunked-deltas", svnadmin__chunked_deltas, 0,
+     N_("with --deltas, stream the deltas of large files\n"
+        "                             in chunks (dumpfile format version 4)")},
+
     {NULL}
   };
 
@@ -300,6 +321,23 @@ static const apr_getopt_option_t options_table[] =
  */
 static const svn_opt_subcommand_desc2_t cmd_table[] =
 {
+  {"build-log-index", subcommand_build_log_index, {0}, N_
+   ("usage: svnadmin build-log-index REPOS_PATH\n\n"
+    "Create or rebuild the index of the revisions in which each path was\n"
+    "changed.  Once created, it gets updated by every commit and speeds up\n"
+    "log requests for paths other than the repository root.  The index can\n"
+    "be disabled by deleting the db/log-index.db file of the repository.\n"),
+   {'q'} },
+
+  {"build-mergeinfo-index", subcommand_build_mergeinfo_index, {0}, N_
+   ("usage: svnadmin build-mergeinfo-index REPOS_PATH\n\n"
+    "Create or rebuild the index of the mergeinfo changes of each revision\n"
+    "and of the paths that carry mergeinfo.  Once created, it gets updated\n"
+    "by every commit and speeds up 'log -g' as well as mergeinfo requests\n"
+    "that include descendants.  The index can be disabled by deleting the\n"
+    "db/mergeinfo-index.db file of the repository.\n"),
+   {'q'} },
+
   {"crashtest", subcommand_crashtest, {0}, N_
    ("usage: svnadmin crashtest REPOS_PATH\n\n"
     "Open the repository at REPOS_PATH, then abort, thus simulating\n"
@@ -334,8 +372,12 @@ static const svn_opt_subcommand_desc2_t cmd_table[] =
     "only the paths changed in that revision; otherwise it will describe\n"
     "every path present in the repository as of that revision.  (In either\n"
     "case, the second and subsequent revisions, if any, describe only paths\n"
-    "changed in those revisions.)\n"),
-  {'r', svnadmin__incremental, svnadmin__deltas, 'q', 'M'} },
+    "changed in those revisions.)\n"
+    "With --threads, ranges of revisions get dumped concurrently and the\n"
+    "output consists of several concatenated incremental dumps, each with\n"
+    "its own dumpfile header.\n"),
+  {'r', svnadmin__incremental, svnadmin__deltas, 'q', 'M',
+   svnadmin__threads, svnadmin__chunked_deltas} },
 
   {"freeze", subcommand_freeze, {0}, N_
    ("usage: svnadmin freeze REPOS_PATH PROGRAM [ARG...]\n\n"
@@ -373,10 +415,13 @@ static const svn_opt_subcommand_desc2_t cmd_table[] =
     "was previously empty, its UUID will, by default, be changed to the\n"
     "one specified in the stream.  Progress feedback is sent to stdout.\n"
     "If --revision is specified, limit the loaded revisions to only those\n"
-    "in the dump stream whose revision numbers match the specified range.\n"),
+    "in the dump stream whose revision numbers match the specified range.\n"
+    "With --threads, the stream gets parsed and texts stored as deltas get\n"
+    "reconstructed in background threads while revisions are committed.\n"),
    {'q', 'r', svnadmin__ignore_uuid, svnadmin__force_uuid,
     svnadmin__use_pre_commit_hook, svnadmin__use_post_commit_hook,
-    svnadmin__parent_dir, svnadmin__bypass_prop_validation, 'M'} },
+    svnadmin__parent_dir, svnadmin__bypass_prop_validation, 'M',
+    svnadmin__threads} },
 
   {"lock", subcommand_lock, {0}, N_
    ("usage: svnadmin lock REPOS_PATH PATH USERNAME COMMENT-FILE [TOKEN]\n\n"
@@ -493,6 +538,7 @@ struct svnadmin_opt_state
   svn_boolean_t version;                            /* --version */
   svn_boolean_t incremental;                        /* --incremental */
   svn_boolean_t use_deltas;                         /* --deltas */
+  svn_boolean_t chunked_deltas;                     /* --chunked-deltas */
   svn_boolean_t use_pre_commit_hook;                /* --use-pre-commit-hook */
   svn_boolean_t use_post_commit_hook;               /* --use-post-commit-hook */
   svn_boolean_t use_pre_revprop_change_hook;        /* --use-pre-revprop-change-hook */
@@ -507,6 +553,7 @@ struct svnadmin_opt_state
   enum svn_repos_load_uuid uuid_action;             /* --ignore-uuid,
                                                        --force-uuid */
   apr_uint64_t memory_cache_size;                   /* --memory-cache-size M */
+  int threads;                                      /* --threads */
   const char *parent_dir;
 
   const char *config_dir;    /* Overriding Configuration Directory */
@@ -600,6 +647,53 @@ parse_args(apr_array_header_t **args,
 }
 
 
+/* This implements `svn_opt_subcommand_t'. */
+static svn_error_t *
+subcommand_build_log_index(apr_getopt_t *os, void *baton, apr_pool_t *pool)
+{
+  struct svnadmin_opt_state *opt_state = baton;
+  svn_repos_t *repos;
+  svn_revnum_t youngest;
+
+  /* Expect no more arguments. */
+  SVN_ERR(parse_args(NULL, os, 0, 0, pool));
+
+  SVN_ERR(open_repos(&repos, opt_state->repository_path, pool));
+  SVN_ERR(svn_repos__build_log_index(&youngest, repos, check_cancel, NULL,
+                                     pool));
+
+  if (! opt_state->quiet)
+    SVN_ERR(svn_cmdline_printf(pool,
+                               _("Log index built up to revision %ld.\n"),
+                               youngest));
+
+  return SVN_NO_ERROR;
+}
+
+/* This implements `svn_opt_subcommand_t'. */
+static svn_error_t *
+subcommand_build_mergeinfo_index(apr_getopt_t *os, void *baton,
+                                 apr_pool_t *pool)
+{
+  struct svnadmin_opt_state *opt_state = baton;
+  svn_repos_t *repos;
+  svn_revnum_t youngest;
+
+  /* Expect no more arguments. */
+  SVN_ERR(parse_args(NULL, os, 0, 0, pool));
+
+  SVN_ERR(open_repos(&repos, opt_state->repository_path, pool));
+  SVN_ERR(svn_repos__build_mergeinfo_index(&youngest, repos, check_cancel,
+                                           NULL, pool));
+
+  if (! opt_state->quiet)
+    SVN_ERR(svn_cmdline_printf(
+              pool, _("Mergeinfo index built up to revision %ld.\n"),
+              youngest));
+
+  return SVN_NO_ERROR;
+}
+
 /* This implements `svn_opt_subcommand_t'. */
 static svn_error_t *
 subcommand_crashtest(apr_getopt_t *os, void *baton, apr_pool_t *pool)
@@ -921,6 +1015,9 @@ recode_stream_create(FILE *std_stream, apr_pool_t *pool)
 }
 
 
+/* The number of revision ranges per thread that dump --threads uses. */
+#define DUMP_CHUNKS_PER_THREAD 4
+
 /* This implements `svn_opt_subcommand_t'. */
 static svn_error_t *
 subcommand_dump(apr_getopt_t *os, void *baton, apr_pool_t *pool)
@@ -967,10 +1064,38 @@ subcommand_dump(apr_getopt_t *os, void *baton, apr_pool_t *pool)
   if (! opt_state->quiet)
     progress_stream = recode_stream_create(stderr, pool);
 
-  SVN_ERR(svn_repos_dump_fs3(repos, stdout_stream, lower, upper,
-                             opt_state->incremental, opt_state->use_deltas,
-                             !opt_state->quiet ? repos_notify_handler : NULL,
-                             progress_stream, check_cancel, NULL, pool));
+  if (opt_state->threads > 1 || opt_state->chunked_deltas)
+    {
+      /* Use several ranges per thread, so the output can be written
+         while later ranges are still being dumped. */
+      apr_array_header_t *streams;
+      svn_revnum_t chunks = opt_state->threads > 1
+                          ? opt_state->threads * DUMP_CHUNKS_PER_THREAD
+                          : 1;
+
+      if (chunks > upper - lower + 1)
+        chunks = upper - lower + 1;
+
+      streams = apr_array_make(pool, (int)chunks, sizeof(svn_stream_t *));
+      while (streams->nelts < chunks)
+        APR_ARRAY_PUSH(streams, svn_stream_t *) = stdout_stream;
+
+      SVN_ERR(svn_repos__dump_fs_parallel(repos, streams, lower, upper,
+                                          opt_state->incremental,
+                                          opt_state->use_deltas,
+                                          opt_state->chunked_deltas,
+                                          opt_state->threads,
+                                          get_fs_config(pool),
+                                          !opt_state->quiet
+                                            ? repos_notify_handler : NULL,
+                                          progress_stream,
+                                          check_cancel, NULL, pool));
+    }
+  else
+    SVN_ERR(svn_repos_dump_fs3(repos, stdout_stream, lower, upper,
+                               opt_state->incremental, opt_state->use_deltas,
+                               !opt_state->quiet ? repos_notify_handler : NULL,
+                               progress_stream, check_cancel, NULL, pool));
 
   return SVN_NO_ERROR;
 }
@@ -1138,13 +1263,18 @@ subcommand_load(apr_getopt_t *os, void *baton, apr_pool_t *pool)
   if (! opt_state->quiet)
     stdout_stream = recode_stream_create(stdout, pool);
 
-  err = svn_repos_load_fs4(repos, stdin_stream, lower, upper,
-                           opt_state->uuid_action, opt_state->parent_dir,
-                           opt_state->use_pre_commit_hook,
-                           opt_state->use_post_commit_hook,
-                           opt_state->bypass_prop_validation ? FALSE : TRUE,
-                           opt_state->quiet ? NULL : repos_notify_handler,
-                           stdout_stream, check_cancel, NULL, pool);
+  err = svn_repos__load_fs_pipelined(repos, stdin_stream, lower, upper,
+                                     opt_state->uuid_action,
+                                     opt_state->parent_dir,
+                                     opt_state->use_pre_commit_hook,
+                                     opt_state->use_post_commit_hook,
+                                     !opt_state->bypass_prop_validation,
+                                     opt_state->threads,
+                                     get_fs_config(pool),
+                                     opt_state->quiet
+                                       ? NULL : repos_notify_handler,
+                                     stdout_stream, check_cancel, NULL,
+                                     pool);
   if (err && err->apr_err == SVN_ERR_BAD_PROPERTY_VALUE)
     return svn_error_quick_wrap(err,
                                 _("Invalid property value found in "
@@ -1903,6 +2033,7 @@ sub_main(int argc, const char *argv[], apr_pool_t *pool)
   opt_state.start_revision.kind = svn_opt_revision_unspecified;
   opt_state.end_revision.kind = svn_opt_revision_unspecified;
   opt_state.memory_cache_size = svn_cache_config_get()->cache_size;
+  opt_state.threads = 1;
 
   /* Parse options. */
   SVN_INT_ERR(svn_cmdline__getopt_init(&os, argc, argv, pool));
@@ -1972,6 +2103,9 @@ sub_main(int argc, const char *argv[], apr_pool_t *pool)
       case svnadmin__deltas:
         opt_state.use_deltas = TRUE;
         break;
+      case svnadmin__chunked_deltas:
+        opt_state.chunked_deltas = TRUE;
+        break;
       case svnadmin__ignore_uuid:
         opt_state.uuid_action = svn_repos_load_uuid_ignore;
         break;
@@ -2034,6 +2168,14 @@ sub_main(int argc, const char *argv[], apr_pool_t *pool)
       case svnadmin__wait:
         opt_state.wait = TRUE;
         break;
+      case svnadmin__threads:
+        {
+          apr_int64_t threads;
+
+          SVN_INT_ERR(svn_cstring_strtoi64(&threads, opt_arg, 1, 64, 10));
+          opt_state.threads = (int)threads;
+        }
+        break;
       default:
         {
           SVN_INT_ERR(subcommand_help(NULL, NULL, pool));
@@ -2173,7 +2315,7 @@ sub_main(int argc, const char *argv[], apr_pool_t *pool)
     svn_cache_config_t settings = *svn_cache_config_get();
 
     settings.cache_size = opt_state.memory_cache_size;
-    settings.single_threaded = TRUE;
+    settings.single_threaded = opt_state.threads < 2;
 
     svn_cache_config_set(&settings);
   }
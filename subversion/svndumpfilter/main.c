@@ -44,6 +44,7 @@
 #include "svn_version.h"
 
 #include "private/svn_mergeinfo_private.h"
+#include "private/svn_repos_private.h"
 
 
 /*** Code. ***/
@@ -292,6 +293,13 @@ magic_header_record(int version, void *parse_baton, apr_pool_t *pool)
 {
   struct parse_baton_t *pb = parse_baton;
 
+  /* We rewrite the content lengths of the nodes we output, which we
+     cannot do for chunked texts. */
+  if (version >= SVN_REPOS__DUMPFILE_FORMAT_VERSION_CHUNKED)
+    return svn_error_createf(SVN_ERR_STREAM_MALFORMED_DATA, NULL,
+                             _("Unsupported dumpfile version: %d"),
+                             version);
+
   if (version >= SVN_REPOS_DUMPFILE_FORMAT_VERSION_DELTAS)
     pb->allow_deltas = TRUE;
 
@@ -0,0 +1,183 @@
+/*
+ * config_cache.c :  Sharing parsed configuration files in svnserve
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+
+
+#include <apr_strings.h>
+
+#include "svn_types.h"
+#include "svn_pools.h"
+#include "svn_error.h"
+#include "svn_dirent_uri.h"
+#include "svn_io.h"
+#include "svn_config.h"
+
+#include "private/svn_atomic.h"
+#include "private/svn_mutex.h"
+
+#include "server.h"
+
+/* A parsed configuration file in the cache. */
+typedef struct cached_config_t
+{
+  /* The parsed file and the root pool that it lives in. */
+  svn_config_t *cfg;
+  apr_pool_t *pool;
+
+  /* Modification time and size of the file when it was read. */
+  apr_time_t mtime;
+  apr_off_t size;
+
+  /* Whether the file had been modified less than MTIME_GRANULARITY
+     before it was read.  Further modifications may then leave MTIME and
+     SIZE unchanged, so such entries don't get used. */
+  svn_boolean_t racy;
+} cached_config_t;
+
+/* The coarsest resolution of file modification times that we expect
+   from the filesystems that repositories live on. */
+#define MTIME_GRANULARITY apr_time_from_sec(2)
+
+/* The cache of parsed configuration files, mapping absolute file names
+   to cached_config_t.  Only svnserve.conf and the password databases
+   that it references go through here; the authz files are shared by
+   svn_repos__authz_read_shared() and each connection still opens its own
+   svn_repos_t and svn_fs_t, reading fsfs.conf again.  It lives in
+   CACHE_POOL and all access to it and its entries is serialized by
+   CACHE_MUTEX.
+
+   svn_config_t objects modify themselves while being read, so callers
+   never get to see the cached objects, only copies of them. */
+static volatile svn_atomic_t cache_init_state = 0;
+static apr_pool_t *cache_pool = NULL;
+static svn_mutex__t *cache_mutex = NULL;
+static apr_hash_t *cache = NULL;
+
+/* Create the configuration cache.  Implements the init_func interface
+   of svn_atomic__init_once(). */
+static svn_error_t *
+init_cache(void *baton, apr_pool_t *pool)
+{
+  cache_pool = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+  SVN_ERR(svn_mutex__init(&cache_mutex, TRUE, cache_pool));
+  cache = apr_hash_make(cache_pool);
+
+  return SVN_NO_ERROR;
+}
+
+/* If the cache entry for FILE is still up to date according to FINFO,
+   set *CFG to a copy of it allocated in RESULT_POOL.  Otherwise, set
+   *CFG to NULL.  The caller must hold CACHE_MUTEX. */
+static svn_error_t *
+copy_cached_config(svn_config_t **cfg,
+                   const char *file,
+                   const apr_finfo_t *finfo,
+                   apr_pool_t *result_pool)
+{
+  cached_config_t *entry = apr_hash_get(cache, file, APR_HASH_KEY_STRING);
+
+  *cfg = NULL;
+  if (   entry && !entry->racy
+      && entry->mtime == finfo->mtime && entry->size == finfo->size)
+    SVN_ERR(svn_config_dup(cfg, entry->cfg, result_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Make ENTRY the cache entry for FILE, dropping any previous one.
+   The caller must hold CACHE_MUTEX. */
+static svn_error_t *
+add_cached_config(const char *file,
+                  cached_config_t *entry)
+{
+  cached_config_t *old_entry = apr_hash_get(cache, file,
+                                            APR_HASH_KEY_STRING);
+
+  if (old_entry)
+    svn_pool_destroy(old_entry->pool);
+  else
+    file = apr_pstrdup(cache_pool, file);
+
+  apr_hash_set(cache, file, APR_HASH_KEY_STRING, entry);
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+config_read_shared(svn_config_t **cfg,
+                   const char *file,
+                   svn_boolean_t must_exist,
+                   apr_pool_t *result_pool,
+                   apr_pool_t *scratch_pool)
+{
+  apr_finfo_t finfo;
+  apr_time_t now = apr_time_now();
+  cached_config_t *entry;
+  apr_pool_t *pool;
+  svn_error_t *err;
+
+  SVN_ERR(svn_atomic__init_once(&cache_init_state, init_cache,
+                                NULL, scratch_pool));
+
+  /* Leave missing files to svn_config_read2(). */
+  err = svn_io_stat(&finfo, file, APR_FINFO_MTIME | APR_FINFO_SIZE,
+                    scratch_pool);
+  if (err)
+    {
+      svn_error_clear(err);
+      return svn_error_trace(svn_config_read2(cfg, file, must_exist, FALSE,
+                                              result_pool));
+    }
+
+  SVN_ERR(svn_dirent_get_absolute(&file, file, scratch_pool));
+  SVN_MUTEX__WITH_LOCK(cache_mutex,
+                       copy_cached_config(cfg, file, &finfo, result_pool));
+  if (*cfg)
+    return SVN_NO_ERROR;
+
+  /* Parse the file outside the lock.  Should another thread do the same
+     concurrently, the entry added last wins. */
+  pool = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+  entry = apr_pcalloc(pool, sizeof(*entry));
+  entry->pool = pool;
+  entry->mtime = finfo.mtime;
+  entry->size = finfo.size;
+
+  /* A file modified shortly before we read it may be modified again
+     without getting a different timestamp.  Don't trust such entries but
+     replace them the next time the file gets read. */
+  entry->racy = (now - finfo.mtime < MTIME_GRANULARITY);
+
+  err = svn_config_read2(&entry->cfg, file, must_exist, FALSE, pool);
+  if (!err)
+    err = svn_config_dup(cfg, entry->cfg, result_pool);
+  if (err)
+    {
+      svn_pool_destroy(pool);
+      return svn_error_trace(err);
+    }
+
+  SVN_MUTEX__WITH_LOCK(cache_mutex, add_cached_config(file, entry));
+
+  return SVN_NO_ERROR;
+}
@@ -31,6 +31,8 @@
 #include <apr_signal.h>
 #include <apr_thread_proc.h>
 #include <apr_portable.h>
+#include <apr_poll.h>
+#include <apr_thread_pool.h>
 
 #include <locale.h>
 
@@ -64,6 +66,7 @@
 enum connection_handling_mode {
   connection_mode_fork,   /* Create a process per connection */
   connection_mode_thread, /* Create a thread per connection */
+  connection_mode_pool,   /* Hand requests to a pool of worker threads */
   connection_mode_single  /* One connection at a time in this process */
 };
 
@@ -98,6 +101,20 @@ enum run_mode {
 
 #endif
 
+#if APR_HAS_THREADS
+#define CONNECTION_HAVE_POOL_OPTION
+
+/* Defaults for the worker pool of connection_mode_pool. */
+#define POOL_MIN_THREADS_DEFAULT 4
+#define POOL_MAX_THREADS_DEFAULT 64
+#define POOL_MAX_QUEUED_DEFAULT 256
+
+/* Expected number of connections and the interval in which the acceptor
+   re-evaluates whether to accept new connections, in microseconds. */
+#define POOL_POLLSET_SIZE 1024
+#define POOL_POLL_INTERVAL (apr_time_from_sec(1))
+#endif
+
 
 #ifdef WIN32
 static apr_os_sock_t winservice_svnserve_accept_socket = INVALID_SOCKET;
@@ -149,6 +166,13 @@ void winservice_notify_stop(void)
 #define SVNSERVE_OPT_CACHE_FULLTEXTS 266
 #define SVNSERVE_OPT_CACHE_REVPROPS  267
 #define SVNSERVE_OPT_SINGLE_CONN     268
+#define SVNSERVE_OPT_THREAD_POOL     269
+#define SVNSERVE_OPT_MIN_THREADS     270
+#define SVNSERVE_OPT_MAX_THREADS     271
+#define SVNSERVE_OPT_MAX_QUEUED      272
+#define SVNSERVE_OPT_STATS_FILE      273
+#define SVNSERVE_OPT_SLOW_REQUESTS   274
+#define SVNSERVE_OPT_STREAM_COMPRESSION 275
 
 static const apr_getopt_option_t svnserve__options[] =
   {
@@ -203,6 +227,12 @@ static const apr_getopt_option_t svnserve__options[] =
         "[0 .. no compression, 5 .. default, \n"
         "                             "
         " 9 .. maximum compression]")},
+    {"stream-compression", SVNSERVE_OPT_STREAM_COMPRESSION, 0,
+     N_("compress all network traffic with clients that\n"
+        "                             "
+        "support it, not just file contents\n"
+        "                             "
+        "[faster with low compression levels]")},
     {"memory-cache-size", 'M', 1,
      N_("size of the extra in-memory cache in MB used to\n"
         "                             "
@@ -240,6 +270,34 @@ static const apr_getopt_option_t svnserve__options[] =
      * ### this option never exists when --service exists. */
     {"threads",          'T', 0, N_("use threads instead of fork "
                                     "[mode: daemon]")},
+#endif
+#ifdef CONNECTION_HAVE_POOL_OPTION
+    {"thread-pool",      SVNSERVE_OPT_THREAD_POOL, 0,
+     N_("serve requests from a pool of worker threads;\n"
+        "                             "
+        "idle connections don't occupy a thread\n"
+        "                             "
+        "[mode: daemon]")},
+    {"min-threads",      SVNSERVE_OPT_MIN_THREADS, 1,
+     N_("number of worker threads to keep running.\n"
+        "                             "
+        "Default is " APR_STRINGIFY(POOL_MIN_THREADS_DEFAULT) ".\n"
+        "                             "
+        "[used with --thread-pool only]")},
+    {"max-threads",      SVNSERVE_OPT_MAX_THREADS, 1,
+     N_("maximum number of worker threads.\n"
+        "                             "
+        "Default is " APR_STRINGIFY(POOL_MAX_THREADS_DEFAULT) ".\n"
+        "                             "
+        "[used with --thread-pool only]")},
+    {"max-queued",       SVNSERVE_OPT_MAX_QUEUED, 1,
+     N_("number of requests waiting for a worker thread\n"
+        "                             "
+        "above which no new connections get accepted.\n"
+        "                             "
+        "Default is " APR_STRINGIFY(POOL_MAX_QUEUED_DEFAULT) ".\n"
+        "                             "
+        "[used with --thread-pool only]")},
 #endif
     {"foreground",        SVNSERVE_OPT_FOREGROUND, 0,
      N_("run in foreground (useful for debugging)\n"
@@ -251,6 +309,18 @@ static const apr_getopt_option_t svnserve__options[] =
         "(useful for debugging)")},
     {"log-file",         SVNSERVE_OPT_LOG_FILE, 1,
      N_("svnserve log file")},
+    {"slow-request-threshold", SVNSERVE_OPT_SLOW_REQUESTS, 1,
+     N_("log commands that take ARG milliseconds or longer\n"
+        "                             "
+        "to the log file")},
+    {"stats-file",       SVNSERVE_OPT_STATS_FILE, 1,
+     N_("periodically write per-command and per-client\n"
+        "                             "
+        "request statistics to file ARG\n"
+        "                             "
+        "[mode: daemon with -T, --thread-pool or\n"
+        "                             "
+        " --single-thread; listen-once, service]")},
     {"pid-file",         SVNSERVE_OPT_PID_FILE, 1,
 #ifdef WIN32
      N_("write server process ID to file ARG\n"
@@ -380,6 +450,272 @@ static void * APR_THREAD_FUNC serve_thread(apr_thread_t *tid, void *data)
 }
 #endif
 
+#if APR_HAS_THREADS
+/* The shared state of the worker pool in connection_mode_pool. */
+typedef struct dispatcher_t
+{
+  /* Worker threads that execute the requests. */
+  apr_thread_pool_t *threads;
+
+  /* Idle connections, waiting for their next request.  This set may be
+     modified by the workers while the acceptor is polling it. */
+  apr_pollset_t *pollset;
+
+  serve_params_t *params;
+} dispatcher_t;
+
+/* A connection served in connection_mode_pool.  At any time, it is
+   either parked in the pollset of the dispatcher or being worked on by
+   exactly one worker thread. */
+typedef struct pooled_connection_t
+{
+  svn_ra_svn_conn_t *conn;
+  apr_socket_t *sock;
+
+  /* NULL until the worker thread has completed the handshake. */
+  serve_session_t *session;
+
+  /* The descriptor to park the connection with. */
+  apr_pollfd_t pfd;
+
+  dispatcher_t *dispatcher;
+
+  /* Root pool of the connection, with its own allocator. */
+  apr_pool_t *pool;
+} pooled_connection_t;
+
+/* Implements apr_thread_start_t.  Serve the pooled_connection_t in DATA
+   until it runs out of buffered input, then park it again.  A new
+   connection gets its handshake done instead. */
+static void * APR_THREAD_FUNC serve_pooled(apr_thread_t *tid, void *data)
+{
+  pooled_connection_t *c = data;
+  apr_pool_t *iterpool = svn_pool_create(c->pool);
+  svn_boolean_t done = FALSE;
+  svn_error_t *err;
+
+  if (! c->session)
+    {
+      err = serve_session_open(&c->session, c->conn, c->dispatcher->params,
+                               c->pool);
+      done = (! err && ! c->session);
+    }
+  else
+    err = serve_session_command(&done, c->session, iterpool);
+
+  /* Pipelined commands are processed right away.  Only wait for the
+     socket when the client has nothing more to say for now. */
+  while (! err && ! done && ! serve_session_idle(c->session))
+    {
+      svn_pool_clear(iterpool);
+      err = serve_session_command(&done, c->session, iterpool);
+    }
+
+  /* The client won't send anything before getting our response. */
+  if (! err && ! done)
+    err = svn_ra_svn_flush(c->conn, iterpool);
+  svn_pool_destroy(iterpool);
+
+  if (! err && ! done)
+    {
+      apr_status_t status = apr_pollset_add(c->dispatcher->pollset, &c->pfd);
+      if (! status)
+        return NULL;
+
+      err = svn_error_wrap_apr(status, _("Can't wait for client request"));
+    }
+
+  log_error(err, c->dispatcher->params->log_file,
+            svn_ra_svn_conn_remote_host(c->conn),
+            NULL, NULL, /* user, repos */
+            c->pool);
+  svn_error_clear(err);
+
+  if (c->session)
+    serve_session_close(c->session, c->pool);
+  apr_socket_close(c->sock);
+  svn_pool_destroy(c->pool);
+
+  return NULL;
+}
+
+/* Accept a new connection on SOCK and queue its handshake in
+   DISPATCHER. */
+static svn_error_t *
+accept_pooled(dispatcher_t *dispatcher,
+              apr_socket_t *sock)
+{
+  apr_pool_t *connection_pool
+    = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+  pooled_connection_t *c = apr_pcalloc(connection_pool, sizeof(*c));
+  apr_status_t status;
+
+  status = apr_socket_accept(&c->sock, sock, connection_pool);
+  if (status)
+    {
+      svn_pool_destroy(connection_pool);
+      if (APR_STATUS_IS_EINTR(status))
+        return SVN_NO_ERROR;
+
+      return svn_error_wrap_apr(status, _("Can't accept client connection"));
+    }
+
+  /* See the main accept loop. */
+  apr_socket_opt_set(c->sock, APR_SO_KEEPALIVE, 1);
+
+  c->conn = svn_ra_svn_create_conn2(c->sock, NULL, NULL,
+                                    dispatcher->params->compression_level,
+                                    connection_pool);
+  c->dispatcher = dispatcher;
+  c->pool = connection_pool;
+  c->pfd.p = connection_pool;
+  c->pfd.desc_type = APR_POLL_SOCKET;
+  c->pfd.reqevents = APR_POLLIN;
+  c->pfd.desc.s = c->sock;
+  c->pfd.client_data = c;
+
+  status = apr_thread_pool_push(dispatcher->threads, serve_pooled, c,
+                                APR_THREAD_TASK_PRIORITY_NORMAL, NULL);
+  if (status)
+    {
+      apr_socket_close(c->sock);
+      svn_pool_destroy(connection_pool);
+      return svn_error_wrap_apr(status, _("Can't queue client connection"));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Serve the connections arriving at SOCK according to PARAMS with
+   between MIN_THREADS and MAX_THREADS worker threads.  Stop accepting
+   new connections while more than MAX_QUEUED requests are waiting for
+   a worker.  Idle connections are kept in a pollset (epoll, kqueue etc.
+   where available) and handed to a worker only when a request arrives.
+   Only return in case of a fatal error. */
+static svn_error_t *
+serve_thread_pool(apr_socket_t *sock,
+                  serve_params_t *params,
+                  int min_threads,
+                  int max_threads,
+                  int max_queued,
+                  apr_pool_t *pool)
+{
+  dispatcher_t *dispatcher = apr_pcalloc(pool, sizeof(*dispatcher));
+  apr_pollfd_t listener;
+  svn_boolean_t accepting = FALSE;
+  apr_status_t status;
+
+  dispatcher->params = params;
+  status = apr_thread_pool_create(&dispatcher->threads, min_threads,
+                                  max_threads, pool);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't create thread pool"));
+
+  status = apr_pollset_create_ex(&dispatcher->pollset, POOL_POLLSET_SIZE,
+                                 pool, APR_POLLSET_THREADSAFE,
+                                 APR_POLLSET_DEFAULT);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't create pollset"));
+
+  memset(&listener, 0, sizeof(listener));
+  listener.p = pool;
+  listener.desc_type = APR_POLL_SOCKET;
+  listener.reqevents = APR_POLLIN;
+  listener.desc.s = sock;
+  listener.client_data = NULL;
+
+  while (1)
+    {
+      const apr_pollfd_t *results;
+      apr_int32_t count, i;
+      svn_boolean_t overloaded;
+
+#ifdef WIN32
+      if (winservice_is_stopping())
+        return SVN_NO_ERROR;
+#endif
+
+      /* Leave new connections in the listen queue while the workers
+         are busy with the ones we have. */
+      overloaded = apr_thread_pool_tasks_count(dispatcher->threads)
+                 >= (apr_size_t)max_queued;
+      if (accepting && overloaded)
+        status = apr_pollset_remove(dispatcher->pollset, &listener);
+      else if (! accepting && ! overloaded)
+        status = apr_pollset_add(dispatcher->pollset, &listener);
+      else
+        status = APR_SUCCESS;
+
+      if (status)
+        return svn_error_wrap_apr(status, _("Can't poll server socket"));
+      accepting = ! overloaded;
+
+      status = apr_pollset_poll(dispatcher->pollset, POOL_POLL_INTERVAL,
+                                &count, &results);
+      if (APR_STATUS_IS_EINTR(status) || APR_STATUS_IS_TIMEUP(status))
+        continue;
+      if (status)
+        return svn_error_wrap_apr(status, _("Can't poll client connections"));
+
+      for (i = 0; i < count; i++)
+        {
+          pooled_connection_t *c = results[i].client_data;
+          svn_error_t *err;
+
+          if (c == NULL)
+            {
+              err = accept_pooled(dispatcher, sock);
+              log_error(err, params->log_file, NULL, NULL, NULL, pool);
+              svn_error_clear(err);
+              continue;
+            }
+
+          /* Make sure that only one worker at a time gets the connection;
+             it will be parked again once the request has been served. */
+          status = apr_pollset_remove(dispatcher->pollset, &c->pfd);
+          if (! status)
+            status = apr_thread_pool_push(dispatcher->threads, serve_pooled,
+                                          c, APR_THREAD_TASK_PRIORITY_NORMAL,
+                                          NULL);
+          if (status)
+            {
+              err = svn_error_wrap_apr(status,
+                                       _("Can't dispatch client request"));
+              log_error(err, params->log_file,
+                        svn_ra_svn_conn_remote_host(c->conn),
+                        NULL, NULL, pool);
+              svn_error_clear(err);
+              apr_socket_close(c->sock);
+              svn_pool_destroy(c->pool);
+            }
+        }
+    }
+
+  /* NOTREACHED */
+}
+
+/* Parse the thread count ARG for the command line option OPTION into
+   *RESULT, which must be between MIN and MAX. */
+static svn_error_t *
+parse_thread_count(int *result,
+                   const char *arg,
+                   const char *option,
+                   int min,
+                   int max)
+{
+  apr_int64_t val;
+  svn_error_t *err = svn_cstring_strtoi64(&val, arg, min, max, 10);
+
+  if (err)
+    return svn_error_createf(SVN_ERR_CL_ARG_PARSING_ERROR, err,
+                             _("Invalid value '%s' for option '%s'"),
+                             arg, option);
+
+  *result = (int)val;
+  return SVN_NO_ERROR;
+}
+#endif
+
 /* Write the PID of the current process as a decimal number, followed by a
    newline to the file FILENAME, using POOL for temporary allocations. */
 static svn_error_t *write_pid_file(const char *filename, apr_pool_t *pool)
@@ -453,9 +789,15 @@ int main(int argc, const char *argv[])
   svn_boolean_t is_version = FALSE;
   int mode_opt_count = 0;
   int handling_opt_count = 0;
+#if APR_HAS_THREADS
+  int min_threads = POOL_MIN_THREADS_DEFAULT;
+  int max_threads = POOL_MAX_THREADS_DEFAULT;
+  int max_queued = POOL_MAX_QUEUED_DEFAULT;
+#endif
   const char *config_filename = NULL;
   const char *pid_filename = NULL;
   const char *log_filename = NULL;
+  const char *stats_filename = NULL;
   svn_node_kind_t kind;
 
   /* Initialize the app. */
@@ -491,12 +833,15 @@ int main(int argc, const char *argv[])
   params.pwdb = NULL;
   params.authzdb = NULL;
   params.compression_level = SVN_DELTA_COMPRESSION_LEVEL_DEFAULT;
+  params.compress_stream = FALSE;
   params.log_file = NULL;
   params.username_case = CASE_ASIS;
   params.memory_cache_size = (apr_uint64_t)-1;
   params.cache_fulltexts = TRUE;
   params.cache_txdeltas = FALSE;
   params.cache_revprops = FALSE;
+  params.stats = NULL;
+  params.slow_request_threshold = -1;
 
   while (1)
     {
@@ -618,6 +963,28 @@ int main(int argc, const char *argv[])
           handling_opt_count++;
           break;
 
+#ifdef CONNECTION_HAVE_POOL_OPTION
+        case SVNSERVE_OPT_THREAD_POOL:
+          handling_mode = connection_mode_pool;
+          handling_opt_count++;
+          break;
+
+        case SVNSERVE_OPT_MIN_THREADS:
+          SVN_INT_ERR(parse_thread_count(&min_threads, arg, "--min-threads",
+                                         1, 1024));
+          break;
+
+        case SVNSERVE_OPT_MAX_THREADS:
+          SVN_INT_ERR(parse_thread_count(&max_threads, arg, "--max-threads",
+                                         1, 1024));
+          break;
+
+        case SVNSERVE_OPT_MAX_QUEUED:
+          SVN_INT_ERR(parse_thread_count(&max_queued, arg, "--max-queued",
+                                         1, 65536));
+          break;
+#endif
+
         case 'c':
           params.compression_level = atoi(arg);
           if (params.compression_level < SVN_DELTA_COMPRESSION_LEVEL_NONE)
@@ -676,6 +1043,32 @@ int main(int argc, const char *argv[])
                                               pool));
           break;
 
+        case SVNSERVE_OPT_STREAM_COMPRESSION:
+          params.compress_stream = TRUE;
+          break;
+
+        case SVNSERVE_OPT_STATS_FILE:
+          SVN_INT_ERR(svn_utf_cstring_to_utf8(&stats_filename, arg, pool));
+          stats_filename = svn_dirent_internal_style(stats_filename, pool);
+          SVN_INT_ERR(svn_dirent_get_absolute(&stats_filename, stats_filename,
+                                              pool));
+          break;
+
+        case SVNSERVE_OPT_SLOW_REQUESTS:
+          {
+            apr_uint64_t val;
+
+            err = svn_cstring_strtoui64(&val, arg, 0, APR_INT32_MAX, 10);
+            if (err)
+              return svn_cmdline_handle_exit_error(
+                       svn_error_createf(SVN_ERR_CL_ARG_PARSING_ERROR, err,
+                                         _("Invalid slow request threshold "
+                                           "'%s'"), arg),
+                       pool, "svnserve: ");
+            params.slow_request_threshold = apr_time_from_msec(val);
+          }
+          break;
+
         }
     }
 
@@ -704,7 +1097,8 @@ int main(int argc, const char *argv[])
   if (handling_opt_count > 1)
     {
       svn_error_clear(svn_cmdline_fputs(
-                      _("You may only specify one of -T or --single-thread\n"),
+                      _("You may only specify one of -T, --thread-pool "
+                        "or --single-thread\n"),
                       stderr, pool));
       usage(argv[0], pool);
     }
@@ -732,6 +1126,25 @@ int main(int argc, const char *argv[])
       exit(1);
     }
 
+  /* The statistics are collected in memory; every process would
+     overwrite the file with its own numbers. */
+  if (stats_filename
+      && (run_mode == run_mode_inetd || run_mode == run_mode_tunnel
+          || (run_mode == run_mode_daemon
+              && handling_mode == connection_mode_fork)))
+    {
+      svn_error_clear
+        (svn_cmdline_fprintf
+           (stderr, pool,
+            _("Option --stats-file requires all connections to be served "
+              "by the same process;\nuse -T, --thread-pool or "
+              "--single-thread.\n")));
+      exit(1);
+    }
+
+  if (stats_filename)
+    SVN_INT_ERR(server_stats_create(&params.stats, stats_filename, pool));
+
   if (run_mode == run_mode_inetd || run_mode == run_mode_tunnel)
     {
       params.tunnel = (run_mode == run_mode_tunnel);
@@ -923,7 +1336,8 @@ int main(int argc, const char *argv[])
       settings.cache_size = params.memory_cache_size;
 
     settings.single_threaded = TRUE;
-    if (handling_mode == connection_mode_thread)
+    if (handling_mode == connection_mode_thread
+        || handling_mode == connection_mode_pool)
       {
 #ifdef APR_HAS_THREADS
         settings.single_threaded = FALSE;
@@ -940,6 +1354,22 @@ int main(int argc, const char *argv[])
     svn_cache_config_set(&settings);
   }
 
+#if APR_HAS_THREADS
+  if (handling_mode == connection_mode_pool
+      && run_mode != run_mode_listen_once)
+    {
+      if (max_threads < min_threads)
+        max_threads = min_threads;
+
+      err = serve_thread_pool(sock, &params, min_threads, max_threads,
+                              max_queued, pool);
+      if (err)
+        return svn_cmdline_handle_exit_error(err, pool, "svnserve: ");
+
+      return EXIT_SUCCESS;
+    }
+#endif
+
   while (1)
     {
 #ifdef WIN32
@@ -1077,6 +1507,9 @@ int main(int argc, const char *argv[])
 #endif
           break;
 
+        case connection_mode_pool:
+          /* Only used in listen-once mode; all other cases have been
+             handed over to serve_thread_pool(). */
         case connection_mode_single:
           /* Serve one connection at a time. */
           svn_error_clear(serve(conn, &params, connection_pool));
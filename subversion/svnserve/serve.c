@@ -52,6 +52,7 @@
 
 #include "private/svn_log.h"
 #include "private/svn_mergeinfo_private.h"
+#include "private/svn_repos_private.h"
 #include "private/svn_fspath.h"
 
 #ifdef HAVE_UNISTD_H
@@ -235,7 +236,7 @@ svn_error_t *load_configs(svn_config_t **cfg,
   const char *pwdb_path, *authzdb_path;
   svn_error_t *err;
 
-  SVN_ERR(svn_config_read2(cfg, filename, must_exist, FALSE, pool));
+  SVN_ERR(config_read_shared(cfg, filename, must_exist, pool, pool));
 
   svn_config_get(*cfg, &pwdb_path, SVN_CONFIG_SECTION_GENERAL,
                  SVN_CONFIG_OPTION_PASSWORD_DB, NULL);
@@ -246,7 +247,7 @@ svn_error_t *load_configs(svn_config_t **cfg,
       pwdb_path = svn_dirent_canonicalize(pwdb_path, pool);
       pwdb_path = svn_dirent_join(base, pwdb_path, pool);
 
-      err = svn_config_read2(pwdb, pwdb_path, TRUE, FALSE, pool);
+      err = config_read_shared(pwdb, pwdb_path, TRUE, pool, pool);
       if (err)
         {
           if (server)
@@ -293,7 +294,8 @@ svn_error_t *load_configs(svn_config_t **cfg,
 
       authzdb_path = svn_dirent_canonicalize(authzdb_path, pool);
       authzdb_path = svn_dirent_join(base, authzdb_path, pool);
-      err = svn_repos_authz_read(authzdb, authzdb_path, TRUE, pool);
+      err = svn_repos__authz_read_shared(authzdb, authzdb_path, TRUE,
+                                         pool, pool);
       if (err)
         {
           if (server)
@@ -415,9 +417,9 @@ static svn_error_t *authz_check_access(svn_boolean_t *allowed,
       b->authz_user = authz_user;
     }
 
-  return svn_repos_authz_check_access(b->authzdb, b->authz_repos_name,
-                                      path, b->authz_user, required,
-                                      allowed, pool);
+  return svn_repos__authz_check_access(b->authzdb, b->authz_repos_name,
+                                       path, b->authz_user, required,
+                                       allowed, &b->authz_counters, pool);
 }
 
 /* Set *ALLOWED to TRUE if PATH is readable by the user described in
@@ -886,13 +888,16 @@ static svn_error_t *accept_report(svn_boolean_t *only_empty_entry,
   /* Make an svn_repos report baton.  Tell it to drive the network editor
    * when the report is complete. */
   svn_ra_svn_get_editor(&editor, &edit_baton, conn, pool, NULL, NULL);
-  SVN_CMD_ERR(svn_repos_begin_report2(&report_baton, rev, b->repos,
-                                      b->fs_path->data, target, tgt_path,
-                                      text_deltas, depth, ignore_ancestry,
-                                      send_copyfrom_args,
-                                      editor, edit_baton,
-                                      authz_check_access_cb_func(b),
-                                      b, pool));
+  SVN_CMD_ERR(svn_repos__begin_report_pipelined(&report_baton, rev,
+                                                b->repos, b->fs_path->data,
+                                                target, tgt_path,
+                                                text_deltas, depth,
+                                                ignore_ancestry,
+                                                send_copyfrom_args,
+                                                editor, edit_baton,
+                                                authz_check_access_cb_func(b),
+                                                b, b->update_threads,
+                                                b->fs_config, pool));
 
   rb.sb = b;
   rb.repos_url = svn_path_uri_decode(b->repos_url, pool);
@@ -1381,6 +1386,47 @@ static svn_error_t *commit(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
   return SVN_NO_ERROR;
 }
 
+/* Send CONTENTS over CONN as a series of strings, terminated by an empty
+   string.  An error reading CONTENTS is returned as a command error once
+   the terminator has been sent. */
+static svn_error_t *write_file_contents(svn_ra_svn_conn_t *conn,
+                                        svn_stream_t *contents,
+                                        apr_pool_t *pool)
+{
+  svn_string_t write_str;
+  char buf[4096];
+  apr_size_t len;
+  svn_error_t *err, *write_err;
+
+  while (1)
+    {
+      len = sizeof(buf);
+      err = svn_stream_read(contents, buf, &len);
+      if (err)
+        break;
+      if (len > 0)
+        {
+          write_str.data = buf;
+          write_str.len = len;
+          SVN_ERR(svn_ra_svn_write_string(conn, pool, &write_str));
+        }
+      if (len < sizeof(buf))
+        {
+          err = svn_stream_close(contents);
+          break;
+        }
+    }
+  write_err = svn_ra_svn_write_cstring(conn, pool, "");
+  if (write_err)
+    {
+      svn_error_clear(err);
+      return write_err;
+    }
+  SVN_CMD_ERR(err);
+
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *get_file(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
                              apr_array_header_t *params, void *baton)
 {
@@ -1390,12 +1436,8 @@ static svn_error_t *get_file(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
   svn_fs_root_t *root;
   svn_stream_t *contents;
   apr_hash_t *props = NULL;
-  svn_string_t write_str;
-  char buf[4096];
-  apr_size_t len;
   svn_boolean_t want_props, want_contents;
   svn_checksum_t *checksum;
-  svn_error_t *err, *write_err;
 
   /* Parse arguments. */
   SVN_ERR(svn_ra_svn_parse_tuple(params, pool, "c(?r)bb", &path, &rev,
@@ -1434,38 +1476,129 @@ static svn_error_t *get_file(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
   /* Now send the file's contents. */
   if (want_contents)
     {
-      err = SVN_NO_ERROR;
-      while (1)
-        {
-          len = sizeof(buf);
-          err = svn_stream_read(contents, buf, &len);
-          if (err)
-            break;
-          if (len > 0)
-            {
-              write_str.data = buf;
-              write_str.len = len;
-              SVN_ERR(svn_ra_svn_write_string(conn, pool, &write_str));
-            }
-          if (len < sizeof(buf))
-            {
-              err = svn_stream_close(contents);
-              break;
-            }
-        }
-      write_err = svn_ra_svn_write_cstring(conn, pool, "");
-      if (write_err)
-        {
-          svn_error_clear(err);
-          return write_err;
-        }
-      SVN_CMD_ERR(err);
+      SVN_ERR(write_file_contents(conn, contents, pool));
       SVN_ERR(svn_ra_svn_write_cmd_response(conn, pool, ""));
     }
 
   return SVN_NO_ERROR;
 }
 
+/* Send the file requested by ITEM, an element of the list sent with the
+   get-files command, along with its properties and contents if WANT_PROPS
+   and WANT_CONTENTS are set, respectively.  *ROOT is the revision root
+   used for the previous file, or NULL; update it if this file is in
+   another revision, allocating it in ROOT_POOL.  Use POOL for temporary
+   allocations.
+
+   Return problems with the file as command errors. */
+static svn_error_t *send_requested_file(svn_ra_svn_conn_t *conn,
+                                        server_baton_t *b,
+                                        svn_fs_root_t **root,
+                                        apr_pool_t *root_pool,
+                                        const svn_ra_svn_item_t *item,
+                                        svn_boolean_t want_props,
+                                        svn_boolean_t want_contents,
+                                        apr_pool_t *pool)
+{
+  const char *path, *full_path, *hex_digest;
+  svn_revnum_t rev;
+  svn_stream_t *contents;
+  apr_hash_t *props = NULL;
+  svn_checksum_t *checksum;
+
+  if (item->kind != SVN_RA_SVN_LIST)
+    return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                            "File requests should be list of lists");
+  SVN_ERR(svn_ra_svn_parse_tuple(item->u.list, pool, "c(?r)", &path, &rev));
+
+  full_path = svn_fspath__join(b->fs_path->data,
+                               svn_relpath_canonicalize(path, pool), pool);
+  if (! lookup_access(pool, b, conn, svn_authz_read, full_path, FALSE))
+    return svn_error_create(SVN_ERR_RA_SVN_CMD_ERR,
+                            error_create_and_log(SVN_ERR_RA_NOT_AUTHORIZED,
+                                                 NULL, NULL, b, conn, pool),
+                            NULL);
+
+  if (!SVN_IS_VALID_REVNUM(rev))
+    SVN_CMD_ERR(svn_fs_youngest_rev(&rev, b->fs, pool));
+
+  SVN_ERR(log_command(b, conn, pool, "%s",
+                      svn_log__get_file(full_path, rev,
+                                        want_contents, want_props, pool)));
+
+  /* Requests tend to come in batches from the same revision. */
+  if (*root == NULL || svn_fs_revision_root_revision(*root) != rev)
+    {
+      svn_pool_clear(root_pool);
+      *root = NULL;
+      SVN_CMD_ERR(svn_fs_revision_root(root, b->fs, rev, root_pool));
+    }
+
+  SVN_CMD_ERR(svn_fs_file_checksum(&checksum, svn_checksum_md5, *root,
+                                   full_path, TRUE, pool));
+  hex_digest = svn_checksum_to_cstring_display(checksum, pool);
+  if (want_props)
+    SVN_CMD_ERR(get_props(&props, *root, full_path, pool));
+  if (want_contents)
+    SVN_CMD_ERR(svn_fs_file_contents(&contents, *root, full_path, pool));
+
+  SVN_ERR(svn_ra_svn_write_tuple(conn, pool, "(?c)r(!", hex_digest, rev));
+  SVN_ERR(svn_ra_svn_write_proplist(conn, pool, props));
+  SVN_ERR(svn_ra_svn_write_tuple(conn, pool, "!)"));
+
+  if (want_contents)
+    SVN_ERR(write_file_contents(conn, contents, pool));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *get_files(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
+                              apr_array_header_t *params, void *baton)
+{
+  server_baton_t *b = baton;
+  apr_array_header_t *requests;
+  svn_boolean_t want_props, want_contents;
+  svn_fs_root_t *root = NULL;
+  apr_pool_t *root_pool, *iterpool;
+  svn_error_t *err = SVN_NO_ERROR, *write_err;
+  int i;
+
+  SVN_ERR(svn_ra_svn_parse_tuple(params, pool, "lbb", &requests,
+                                 &want_props, &want_contents));
+
+  /* As with lock-many, we can only send a single auth reply.  A file
+     that the user may not read aborts the command. */
+  SVN_ERR(must_have_access(conn, pool, b, svn_authz_read, NULL, FALSE));
+
+  root_pool = svn_pool_create(pool);
+  iterpool = svn_pool_create(pool);
+  for (i = 0; i < requests->nelts; i++)
+    {
+      svn_pool_clear(iterpool);
+      err = send_requested_file(conn, b, &root, root_pool,
+                                &APR_ARRAY_IDX(requests, i,
+                                               svn_ra_svn_item_t),
+                                want_props, want_contents, iterpool);
+      if (err && err->apr_err != SVN_ERR_RA_SVN_CMD_ERR)
+        return err;
+      if (err)
+        break;
+    }
+  svn_pool_destroy(iterpool);
+  svn_pool_destroy(root_pool);
+
+  /* NOTE: err might contain a command error from the loop above. */
+  write_err = svn_ra_svn_write_word(conn, pool, "done");
+  if (write_err)
+    {
+      svn_error_clear(err);
+      return write_err;
+    }
+  SVN_ERR(err);
+
+  return svn_ra_svn_write_cmd_response(conn, pool, "");
+}
+
 static svn_error_t *get_dir(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
                             apr_array_header_t *params, void *baton)
 {
@@ -1643,14 +1776,17 @@ static svn_error_t *update(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
   svn_boolean_t recurse;
   svn_boolean_t send_copyfrom_args;
   apr_uint64_t send_copyfrom_param;
+  svn_boolean_t send_texts;
+  apr_uint64_t send_texts_param;
   /* Default to unknown.  Old clients won't send depth, but we'll
      handle that by converting recurse if necessary. */
   svn_depth_t depth = svn_depth_unknown;
   svn_boolean_t is_checkout;
 
   /* Parse the arguments. */
-  SVN_ERR(svn_ra_svn_parse_tuple(params, pool, "(?r)cb?wB", &rev, &target,
-                                 &recurse, &depth_word, &send_copyfrom_param));
+  SVN_ERR(svn_ra_svn_parse_tuple(params, pool, "(?r)cb?wBB", &rev, &target,
+                                 &recurse, &depth_word, &send_copyfrom_param,
+                                 &send_texts_param));
   target = svn_relpath_canonicalize(target, pool);
 
   if (depth_word)
@@ -1660,6 +1796,8 @@ static svn_error_t *update(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
 
   send_copyfrom_args = (send_copyfrom_param == SVN_RA_SVN_UNSPECIFIED_NUMBER) ?
       FALSE : (svn_boolean_t) send_copyfrom_param;
+  send_texts = (send_texts_param == SVN_RA_SVN_UNSPECIFIED_NUMBER) ?
+      TRUE : (svn_boolean_t) send_texts_param;
 
   full_path = svn_fspath__join(b->fs_path->data, target, pool);
   /* Check authorization and authenticate the user if necessary. */
@@ -1669,8 +1807,8 @@ static svn_error_t *update(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
     SVN_CMD_ERR(svn_fs_youngest_rev(&rev, b->fs, pool));
 
   SVN_ERR(accept_report(&is_checkout, NULL,
-                        conn, pool, b, rev, target, NULL, TRUE,
-                        depth, send_copyfrom_args, FALSE));
+                        conn, pool, b, rev, target, NULL,
+                        send_texts, depth, send_copyfrom_args, FALSE));
   if (is_checkout)
     {
       SVN_ERR(log_command(b, conn, pool, "%s",
@@ -2050,11 +2188,13 @@ static svn_error_t *log_cmd(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
   lb.fs_path = b->fs_path->data;
   lb.conn = conn;
   lb.stack_depth = 0;
-  err = svn_repos_get_logs4(b->repos, full_paths, start_rev, end_rev,
-                            (int) limit, send_changed_paths, strict_node,
-                            include_merged_revisions, revprops,
-                            authz_check_access_cb_func(b), b, log_receiver,
-                            &lb, pool);
+  err = svn_repos__get_logs_pipelined(b->repos, full_paths, start_rev,
+                                      end_rev, (int) limit,
+                                      send_changed_paths, strict_node,
+                                      include_merged_revisions, revprops,
+                                      authz_check_access_cb_func(b), b,
+                                      FALSE, b->log_threads, b->fs_config,
+                                      log_receiver, &lb, pool);
 
   write_err = svn_ra_svn_write_word(conn, pool, "done");
   if (write_err)
@@ -2358,9 +2498,11 @@ static svn_error_t *file_rev_handler(void *baton, const char *path,
       svn_stream_set_close(stream, svndiff_close_handler);
 
       /* If the connection does not support SVNDIFF1 or if we don't want to use
-       * compression, use the non-compressing "version 0" implementation */
+       * compression, use the non-compressing "version 0" implementation.
+       * The same applies if the whole stream gets compressed anyway. */
       if (   svn_ra_svn_compression_level(frb->conn) > 0
-          && svn_ra_svn_has_capability(frb->conn, SVN_RA_SVN_CAP_SVNDIFF1))
+          && svn_ra_svn_has_capability(frb->conn, SVN_RA_SVN_CAP_SVNDIFF1)
+          && ! svn_ra_svn__stream_compression_enabled(frb->conn))
         svn_txdelta_to_svndiff3(d_handler, d_baton, stream, 1,
                                 svn_ra_svn_compression_level(frb->conn), pool);
       else
@@ -2422,6 +2564,100 @@ static svn_error_t *get_file_revs(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
   return SVN_NO_ERROR;
 }
 
+/* Baton for blame_receiver(). */
+typedef struct blame_baton_t
+{
+  svn_ra_svn_conn_t *conn;
+
+  /* The revisions (svn_revnum_t) whose properties have already been sent
+     to the client. */
+  apr_hash_t *sent_revs;
+  apr_pool_t *pool;
+} blame_baton_t;
+
+/* This implements svn_repos__blame_receiver_t.  Send the chunk to the
+   client, along with the revision properties the first time REVISION
+   gets reported. */
+static svn_error_t *blame_receiver(void *baton, apr_int64_t start_line,
+                                   svn_revnum_t revision,
+                                   apr_hash_t *rev_props, apr_pool_t *pool)
+{
+  blame_baton_t *bb = baton;
+
+  if (SVN_IS_VALID_REVNUM(revision)
+      && ! apr_hash_get(bb->sent_revs, &revision, sizeof(revision)))
+    {
+      svn_revnum_t *key = apr_palloc(bb->pool, sizeof(*key));
+
+      *key = revision;
+      apr_hash_set(bb->sent_revs, key, sizeof(*key), key);
+
+      SVN_ERR(svn_ra_svn_write_tuple(bb->conn, pool, "n(?r)(!",
+                                     (apr_uint64_t) start_line, revision));
+      SVN_ERR(svn_ra_svn_write_proplist(bb->conn, pool, rev_props));
+      return svn_ra_svn_write_tuple(bb->conn, pool, "!)");
+    }
+
+  return svn_ra_svn_write_tuple(bb->conn, pool, "n(?r)",
+                                (apr_uint64_t) start_line, revision);
+}
+
+static svn_error_t *get_file_blame(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
+                                   apr_array_header_t *params, void *baton)
+{
+  server_baton_t *b = baton;
+  svn_error_t *err, *write_err;
+  blame_baton_t bb;
+  svn_revnum_t start_rev, end_rev;
+  const char *path;
+  const char *full_path;
+  const char *ignore_space;
+  svn_boolean_t ignore_eol_style;
+  svn_boolean_t ignore_mime_type;
+  svn_diff_file_options_t *diff_options;
+
+  /* Parse arguments. */
+  SVN_ERR(svn_ra_svn_parse_tuple(params, pool, "c(?r)(?r)wbb",
+                                 &path, &start_rev, &end_rev,
+                                 &ignore_space, &ignore_eol_style,
+                                 &ignore_mime_type));
+  path = svn_relpath_canonicalize(path, pool);
+  SVN_ERR(trivial_auth_request(conn, pool, b));
+  full_path = svn_fspath__join(b->fs_path->data, path, pool);
+
+  diff_options = svn_diff_file_options_create(pool);
+  if (strcmp(ignore_space, "change") == 0)
+    diff_options->ignore_space = svn_diff_file_ignore_space_change;
+  else if (strcmp(ignore_space, "all") == 0)
+    diff_options->ignore_space = svn_diff_file_ignore_space_all;
+  else
+    diff_options->ignore_space = svn_diff_file_ignore_space_none;
+  diff_options->ignore_eol_style = ignore_eol_style;
+
+  SVN_ERR(log_command(b, conn, pool, "%s",
+                      svn_log__get_file_blame(full_path, start_rev, end_rev,
+                                              pool)));
+
+  bb.conn = conn;
+  bb.sent_revs = apr_hash_make(pool);
+  bb.pool = pool;
+
+  err = svn_repos__get_file_blame(b->repos, full_path, start_rev, end_rev,
+                                  diff_options, ignore_mime_type,
+                                  authz_check_access_cb_func(b), b,
+                                  blame_receiver, &bb, pool);
+  write_err = svn_ra_svn_write_word(conn, pool, "done");
+  if (write_err)
+    {
+      svn_error_clear(err);
+      return write_err;
+    }
+  SVN_CMD_ERR(err);
+  SVN_ERR(svn_ra_svn_write_cmd_response(conn, pool, ""));
+
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *lock(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
                          apr_array_header_t *params, void *baton)
 {
@@ -2868,6 +3104,7 @@ static const svn_ra_svn_cmd_entry_t main_commands[] = {
   { "rev-prop",        rev_prop },
   { "commit",          commit },
   { "get-file",        get_file },
+  { "get-files",       get_files },
   { "get-dir",         get_dir },
   { "update",          update },
   { "switch",          switch_cmd },
@@ -2880,6 +3117,7 @@ static const svn_ra_svn_cmd_entry_t main_commands[] = {
   { "get-locations",   get_locations },
   { "get-location-segments",   get_location_segments },
   { "get-file-revs",   get_file_revs },
+  { "get-file-blame",  get_file_blame },
   { "lock",            lock },
   { "lock-many",       lock_many },
   { "unlock",          unlock },
@@ -2957,6 +3195,7 @@ static svn_error_t *find_repos(const char *url, const char *root,
                                apr_pool_t *pool)
 {
   const char *path, *full_path, *repos_root, *fs_path, *hooks_env;
+  apr_int64_t log_threads, update_threads;
   svn_stringbuf_t *url_buf;
 
   /* Skip past the scheme and authority part. */
@@ -3041,6 +3280,22 @@ static svn_error_t *find_repos(const char *url, const char *root,
     hooks_env = svn_dirent_internal_style(hooks_env, pool);
   svn_repos_hooks_setenv(b->repos, hooks_env, pool, pool);
 
+  /* How many threads may help answering a single log request? */
+  SVN_ERR(svn_config_get_int64(b->cfg, &log_threads,
+                               SVN_CONFIG_SECTION_GENERAL,
+                               SVN_CONFIG_OPTION_LOG_THREADS, 1));
+  b->log_threads = (log_threads > 1 && log_threads <= 64)
+                 ? (int)log_threads
+                 : 1;
+
+  /* And how many may read ahead file contents for an update? */
+  SVN_ERR(svn_config_get_int64(b->cfg, &update_threads,
+                               SVN_CONFIG_SECTION_GENERAL,
+                               SVN_CONFIG_OPTION_UPDATE_THREADS, 1));
+  b->update_threads = (update_threads > 1 && update_threads <= 64)
+                    ? (int)update_threads
+                    : 1;
+
   return SVN_NO_ERROR;
 }
 
@@ -3201,44 +3456,89 @@ fetch_base_func(const char **filename,
   return SVN_NO_ERROR;
 }
 
-svn_error_t *serve(svn_ra_svn_conn_t *conn, serve_params_t *params,
-                   apr_pool_t *pool)
+/* A connection that is ready to process commands. */
+struct serve_session_t
+{
+  server_baton_t server;
+  fs_warning_baton_t warn_baton;
+  svn_ra_svn_conn_t *conn;
+
+  /* Maps command names to entries of main_commands. */
+  apr_hash_t *commands;
+
+  /* See serve_params_t. */
+  server_stats_t *stats;
+  apr_interval_time_t slow_request_threshold;
+};
+
+/* The state of a command at the time its handler got invoked. */
+typedef struct command_probe_t
+{
+  apr_time_t start;
+  apr_uint64_t cache_reads;
+  apr_uint64_t cache_hits;
+} command_probe_t;
+
+/* Implements svn_ra_svn__command_info_t.start_func, recording the current
+   state in the command_probe_t BATON. */
+static svn_error_t *
+start_command_probe(void *baton, const char *cmdname)
+{
+  command_probe_t *probe = baton;
+
+  probe->start = apr_time_now();
+  return svn_error_trace(server_stats_get_cache_counts(&probe->cache_reads,
+                                                       &probe->cache_hits));
+}
+
+svn_error_t *serve_session_open(serve_session_t **session,
+                                svn_ra_svn_conn_t *conn,
+                                serve_params_t *params,
+                                apr_pool_t *pool)
 {
   svn_error_t *err, *io_err;
   apr_uint64_t ver;
   const char *uuid, *client_url, *ra_client_string, *client_string;
   apr_array_header_t *caplist, *cap_words;
-  server_baton_t b;
-  fs_warning_baton_t warn_baton;
+  serve_session_t *s = apr_pcalloc(pool, sizeof(*s));
+  server_baton_t *b = &s->server;
   svn_stringbuf_t *cap_log = svn_stringbuf_create_empty(pool);
-
-  b.tunnel = params->tunnel;
-  b.tunnel_user = get_tunnel_user(params, pool);
-  b.read_only = params->read_only;
-  b.user = NULL;
-  b.username_case = params->username_case;
-  b.authz_user = NULL;
-  b.cfg = params->cfg;
-  b.pwdb = params->pwdb;
-  b.authzdb = params->authzdb;
-  b.realm = NULL;
-  b.log_file = params->log_file;
-  b.pool = pool;
-  b.use_sasl = FALSE;
+  const svn_ra_svn_cmd_entry_t *command;
+
+  /* The handshake may end the session at various points. */
+  *session = NULL;
+
+  b->tunnel = params->tunnel;
+  b->tunnel_user = get_tunnel_user(params, pool);
+  b->read_only = params->read_only;
+  b->user = NULL;
+  b->username_case = params->username_case;
+  b->authz_user = NULL;
+  b->authz_counters.checks = 0;
+  b->authz_counters.evaluations = 0;
+  b->cfg = params->cfg;
+  b->pwdb = params->pwdb;
+  b->authzdb = params->authzdb;
+  b->realm = NULL;
+  b->log_threads = 1;
+  b->update_threads = 1;
+  b->log_file = params->log_file;
+  b->pool = pool;
+  b->use_sasl = FALSE;
 
   /* construct FS configuration parameters */
-  b.fs_config = apr_hash_make(pool);
-  apr_hash_set(b.fs_config, SVN_FS_CONFIG_FSFS_CACHE_DELTAS,
+  b->fs_config = apr_hash_make(pool);
+  apr_hash_set(b->fs_config, SVN_FS_CONFIG_FSFS_CACHE_DELTAS,
                APR_HASH_KEY_STRING, params->cache_txdeltas ? "1" : "0");
-  apr_hash_set(b.fs_config, SVN_FS_CONFIG_FSFS_CACHE_FULLTEXTS,
+  apr_hash_set(b->fs_config, SVN_FS_CONFIG_FSFS_CACHE_FULLTEXTS,
                APR_HASH_KEY_STRING, params->cache_fulltexts ? "1" : "0");
-  apr_hash_set(b.fs_config, SVN_FS_CONFIG_FSFS_CACHE_REVPROPS,
+  apr_hash_set(b->fs_config, SVN_FS_CONFIG_FSFS_CACHE_REVPROPS,
                APR_HASH_KEY_STRING, params->cache_revprops ? "1" : "0");
 
   /* Send greeting.  We don't support version 1 any more, so we can
    * send an empty mechlist. */
   if (params->compression_level > 0)
-    SVN_ERR(svn_ra_svn_write_cmd_response(conn, pool, "nn()(wwwwwwww)",
+    SVN_ERR(svn_ra_svn_write_cmd_response(conn, pool, "nn()(wwwwwwwwwww?w)",
                                           (apr_uint64_t) 2, (apr_uint64_t) 2,
                                           SVN_RA_SVN_CAP_EDIT_PIPELINE,
                                           SVN_RA_SVN_CAP_SVNDIFF1,
@@ -3247,9 +3547,15 @@ svn_error_t *serve(svn_ra_svn_conn_t *conn, serve_params_t *params,
                                           SVN_RA_SVN_CAP_DEPTH,
                                           SVN_RA_SVN_CAP_LOG_REVPROPS,
                                           SVN_RA_SVN_CAP_ATOMIC_REVPROPS,
-                                          SVN_RA_SVN_CAP_PARTIAL_REPLAY));
+                                          SVN_RA_SVN_CAP_PARTIAL_REPLAY,
+                                          SVN_RA_SVN_CAP_FILE_BLAME,
+                                          SVN_RA_SVN_CAP_TEXTLESS_UPDATE,
+                                          SVN_RA_SVN_CAP_GET_FILES,
+                                          params->compress_stream
+                                            ? SVN_RA_SVN_CAP_ZLIB_STREAM
+                                            : NULL));
   else
-    SVN_ERR(svn_ra_svn_write_cmd_response(conn, pool, "nn()(wwwwwww)",
+    SVN_ERR(svn_ra_svn_write_cmd_response(conn, pool, "nn()(wwwwwwwwww)",
                                           (apr_uint64_t) 2, (apr_uint64_t) 2,
                                           SVN_RA_SVN_CAP_EDIT_PIPELINE,
                                           SVN_RA_SVN_CAP_ABSENT_ENTRIES,
@@ -3257,7 +3563,10 @@ svn_error_t *serve(svn_ra_svn_conn_t *conn, serve_params_t *params,
                                           SVN_RA_SVN_CAP_DEPTH,
                                           SVN_RA_SVN_CAP_LOG_REVPROPS,
                                           SVN_RA_SVN_CAP_ATOMIC_REVPROPS,
-                                          SVN_RA_SVN_CAP_PARTIAL_REPLAY));
+                                          SVN_RA_SVN_CAP_PARTIAL_REPLAY,
+                                          SVN_RA_SVN_CAP_FILE_BLAME,
+                                          SVN_RA_SVN_CAP_TEXTLESS_UPDATE,
+                                          SVN_RA_SVN_CAP_GET_FILES));
 
   /* Read client response, which we assume to be in version 2 format:
    * version, capability list, and client URL; then we do an auth
@@ -3307,19 +3616,28 @@ svn_error_t *serve(svn_ra_svn_conn_t *conn, serve_params_t *params,
       }
   }
 
-  err = find_repos(client_url, params->root, &b, conn, cap_words, pool);
+  err = find_repos(client_url, params->root, b, conn, cap_words, pool);
   if (!err)
     {
-      SVN_ERR(auth_request(conn, pool, &b, READ_ACCESS, FALSE));
-      if (current_access(&b) == NO_ACCESS)
+      SVN_ERR(auth_request(conn, pool, b, READ_ACCESS, FALSE));
+
+      /* The client switches to a compressed stream once authentication
+         is done, if we offered to and no SASL security layer is in place.
+         Encrypted data would not compress anyway. */
+      if (   params->compression_level > 0 && params->compress_stream
+          && svn_ra_svn_has_capability(conn, SVN_RA_SVN_CAP_ZLIB_STREAM)
+          && ! svn_ra_svn__is_encrypted(conn))
+        SVN_ERR(svn_ra_svn__enable_stream_compression(conn, pool));
+
+      if (current_access(b) == NO_ACCESS)
         err = error_create_and_log(SVN_ERR_RA_NOT_AUTHORIZED, NULL,
                                    "Not authorized for access",
-                                   &b, conn, pool);
+                                   b, conn, pool);
     }
   if (err)
     {
-      log_error(err, b.log_file, svn_ra_svn_conn_remote_host(conn),
-                b.user, NULL, pool);
+      log_error(err, b->log_file, svn_ra_svn_conn_remote_host(conn),
+                b->user, NULL, pool);
       io_err = svn_ra_svn_write_cmd_failure(conn, pool, err);
       svn_error_clear(err);
       SVN_ERR(io_err);
@@ -3335,18 +3653,18 @@ svn_error_t *serve(svn_ra_svn_conn_t *conn, serve_params_t *params,
     client_string = "-";
   else
     client_string = svn_path_uri_encode(client_string, pool);
-  SVN_ERR(log_command(&b, conn, pool,
+  SVN_ERR(log_command(b, conn, pool,
                       "open %" APR_UINT64_T_FMT " cap=(%s) %s %s %s",
                       ver, cap_log->data,
-                      svn_path_uri_encode(b.fs_path->data, pool),
+                      svn_path_uri_encode(b->fs_path->data, pool),
                       ra_client_string, client_string));
 
-  warn_baton.server = &b;
-  warn_baton.conn = conn;
-  warn_baton.pool = svn_pool_create(pool);
-  svn_fs_set_warning_func(b.fs, fs_warning_func, &warn_baton);
+  s->warn_baton.server = b;
+  s->warn_baton.conn = conn;
+  s->warn_baton.pool = svn_pool_create(pool);
+  svn_fs_set_warning_func(b->fs, fs_warning_func, &s->warn_baton);
 
-  SVN_ERR(svn_fs_get_uuid(b.fs, &uuid, pool));
+  SVN_ERR(svn_fs_get_uuid(b->fs, &uuid, pool));
 
   /* We can't claim mergeinfo capability until we know whether the
      repository supports mergeinfo (i.e., is not a 1.4 repository),
@@ -3356,11 +3674,11 @@ svn_error_t *serve(svn_ra_svn_conn_t *conn, serve_params_t *params,
      the client has sent the url. */
   {
     svn_boolean_t supports_mergeinfo;
-    SVN_ERR(svn_repos_has_capability(b.repos, &supports_mergeinfo,
+    SVN_ERR(svn_repos_has_capability(b->repos, &supports_mergeinfo,
                                      SVN_REPOS_CAPABILITY_MERGEINFO, pool));
 
     SVN_ERR(svn_ra_svn_write_tuple(conn, pool, "w(cc(!",
-                                   "success", uuid, b.repos_url));
+                                   "success", uuid, b->repos_url));
     if (supports_mergeinfo)
       SVN_ERR(svn_ra_svn_write_word(conn, pool, SVN_RA_SVN_CAP_MERGEINFO));
     SVN_ERR(svn_ra_svn_write_tuple(conn, pool, "!))"));
@@ -3374,10 +3692,141 @@ svn_error_t *serve(svn_ra_svn_conn_t *conn, serve_params_t *params,
     callbacks->fetch_base_func = fetch_base_func;
     callbacks->fetch_props_func = fetch_props_func;
     callbacks->fetch_kind_func = fetch_kind_func;
-    callbacks->fetch_baton = &b;
+    callbacks->fetch_baton = b;
 
     SVN_ERR(svn_ra_svn__set_shim_callbacks(conn, callbacks));
   }
 
-  return svn_ra_svn_handle_commands2(conn, pool, main_commands, &b, FALSE);
+  s->conn = conn;
+  s->commands = apr_hash_make(pool);
+  for (command = main_commands; command->cmdname; command++)
+    apr_hash_set(s->commands, command->cmdname, APR_HASH_KEY_STRING,
+                 command);
+
+  s->stats = params->stats;
+  s->slow_request_threshold = params->slow_request_threshold;
+  if (s->stats)
+    SVN_ERR(server_stats_add_session(s->stats));
+
+  *session = s;
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *serve_session_command(svn_boolean_t *done,
+                                   serve_session_t *session,
+                                   apr_pool_t *scratch_pool)
+{
+  server_baton_t *b = &session->server;
+  svn_ra_svn__command_info_t info = { 0 };
+  command_probe_t probe;
+  request_metrics_t metrics;
+  apr_uint64_t bytes_in, bytes_out;
+
+  /* Don't spend any effort on metrics that nobody asked for. */
+  if (! session->stats && session->slow_request_threshold < 0)
+    return svn_error_trace(svn_ra_svn__handle_command(done, NULL,
+                                                      session->commands,
+                                                      b, session->conn,
+                                                      FALSE, scratch_pool));
+
+  /* Start the clock only after the command has arrived, so that we don't
+     count the time the client keeps us waiting. */
+  info.start_func = start_command_probe;
+  info.start_baton = &probe;
+  svn_ra_svn__get_transfer_counts(&bytes_in, &bytes_out, session->conn);
+  SVN_ERR(svn_ra_svn__handle_command(done, &info, session->commands, b,
+                                     session->conn, FALSE, scratch_pool));
+
+  /* The connection ended without another command. */
+  if (info.cmdname == NULL)
+    return SVN_NO_ERROR;
+
+  metrics.duration = apr_time_now() - probe.start;
+  metrics.failed = info.failed;
+  svn_ra_svn__get_transfer_counts(&metrics.bytes_in, &metrics.bytes_out,
+                                  session->conn);
+  metrics.bytes_in -= bytes_in;
+  metrics.bytes_out -= bytes_out;
+  SVN_ERR(server_stats_get_cache_counts(&metrics.cache_reads,
+                                        &metrics.cache_hits));
+  metrics.cache_reads -= probe.cache_reads;
+  metrics.cache_hits -= probe.cache_hits;
+
+  /* Don't let clients add arbitrary names to the statistics. */
+  if (apr_hash_get(session->commands, info.cmdname, APR_HASH_KEY_STRING))
+    metrics.cmdname = info.cmdname;
+  else
+    metrics.cmdname = "unknown-command";
+
+  if (session->slow_request_threshold >= 0
+      && metrics.duration >= session->slow_request_threshold)
+    SVN_ERR(log_command(b, session->conn, scratch_pool,
+                        "slow-request %s %" APR_TIME_T_FMT "ms%s"
+                        " bytes-in %" APR_UINT64_T_FMT
+                        " bytes-out %" APR_UINT64_T_FMT
+                        " cache-hits %" APR_UINT64_T_FMT
+                        "/%" APR_UINT64_T_FMT,
+                        metrics.cmdname, apr_time_as_msec(metrics.duration),
+                        metrics.failed ? " failed" : "",
+                        metrics.bytes_in, metrics.bytes_out,
+                        metrics.cache_hits, metrics.cache_reads));
+
+  if (session->stats)
+    {
+      svn_error_t *err
+        = server_stats_record(session->stats,
+                              svn_ra_svn_conn_remote_host(session->conn),
+                              &metrics, scratch_pool);
+
+      /* Failing to publish the statistics must not affect the client. */
+      log_error(err, b->log_file, svn_ra_svn_conn_remote_host(session->conn),
+                b->user, b->repos_name, scratch_pool);
+      svn_error_clear(err);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+svn_boolean_t serve_session_idle(serve_session_t *session)
+{
+  return ! svn_ra_svn__data_available(session->conn);
+}
+
+void serve_session_close(serve_session_t *session,
+                         apr_pool_t *scratch_pool)
+{
+  server_baton_t *b = &session->server;
+
+  /* Report how much authz work the session caused. */
+  if (b->authz_counters.checks)
+    svn_error_clear(log_command(b, session->conn, scratch_pool,
+                                "authz-checks %" APR_UINT64_T_FMT
+                                " evaluated %" APR_UINT64_T_FMT,
+                                b->authz_counters.checks,
+                                b->authz_counters.evaluations));
+}
+
+svn_error_t *serve(svn_ra_svn_conn_t *conn, serve_params_t *params,
+                   apr_pool_t *pool)
+{
+  serve_session_t *session;
+  apr_pool_t *iterpool;
+  svn_boolean_t done = FALSE;
+  svn_error_t *err = SVN_NO_ERROR;
+
+  SVN_ERR(serve_session_open(&session, conn, params, pool));
+  if (! session)
+    return SVN_NO_ERROR;
+
+  iterpool = svn_pool_create(pool);
+  while (! done && ! err)
+    {
+      svn_pool_clear(iterpool);
+      err = serve_session_command(&done, session, iterpool);
+    }
+  svn_pool_destroy(iterpool);
+
+  serve_session_close(session, pool);
+
+  return err;
 }
@@ -36,6 +36,8 @@ extern "C" {
 #include "svn_repos.h"
 #include "svn_ra_svn.h"
 
+#include "private/svn_repos_private.h"
+
 enum username_case_type { CASE_FORCE_UPPER, CASE_FORCE_LOWER, CASE_ASIS };
 
 typedef struct server_baton_t {
@@ -50,9 +52,12 @@ typedef struct server_baton_t {
   const char *repos_url;   /* URL to base of repository */
   svn_stringbuf_t *fs_path;/* Decoded base in-repos path (w/ leading slash) */
   apr_hash_t *fs_config;   /* Additional FS configuration parameters */
+  int log_threads;         /* Max. worker threads per log request */
+  int update_threads;      /* Max. worker threads per update request */
   const char *user;        /* Authenticated username of the user */
   enum username_case_type username_case; /* Case-normalize the username? */
   const char *authz_user;  /* Username for authz ('user' + 'username_case') */
+  svn_repos__authz_counters_t authz_counters; /* Authz checks done so far */
   svn_boolean_t tunnel;    /* Tunneled through login agent */
   const char *tunnel_user; /* Allow EXTERNAL to authenticate as this */
   svn_boolean_t read_only; /* Disallow write access (global flag) */
@@ -67,6 +72,9 @@ enum access_type { NO_ACCESS, READ_ACCESS, WRITE_ACCESS };
 
 enum access_type get_access(server_baton_t *b, enum authn_type auth);
 
+/* Request statistics shared by all sessions served by this process. */
+typedef struct server_stats_t server_stats_t;
+
 typedef struct serve_params_t {
   /* The virtual root of the repositories to serve.  The client URL
      path is interpreted relative to this root and is not allowed to
@@ -128,12 +136,55 @@ typedef struct serve_params_t {
      Defaults to SVN_DELTA_COMPRESSION_LEVEL_DEFAULT. */
   int compression_level;
 
+  /* Offer clients to compress all data on the connection with zlib,
+     at COMPRESSION_LEVEL, rather than only the text deltas. */
+  svn_boolean_t compress_stream;
+
+  /* Request statistics to update; possibly NULL. */
+  server_stats_t *stats;
+
+  /* Log commands that take at least this long to LOG_FILE.  A negative
+     value disables the slow-request log. */
+  apr_interval_time_t slow_request_threshold;
+
 } serve_params_t;
 
 /* Serve the connection CONN according to the parameters PARAMS. */
 svn_error_t *serve(svn_ra_svn_conn_t *conn, serve_params_t *params,
                    apr_pool_t *pool);
 
+/* The state of a connection between individual commands.  serve() is
+   equivalent to opening a session, running its commands until it is done
+   and closing it.  Splitting it up allows for handing a connection from
+   one thread to another while it is idle. */
+typedef struct serve_session_t serve_session_t;
+
+/* Perform the handshake, authentication and repository lookup for CONN
+   according to PARAMS and return the new session in *SESSION.  Set
+   *SESSION to NULL if the connection has already ended.  POOL must
+   remain valid for the lifetime of the session. */
+svn_error_t *serve_session_open(serve_session_t **session,
+                                svn_ra_svn_conn_t *conn,
+                                serve_params_t *params,
+                                apr_pool_t *pool);
+
+/* Read and execute the next command of SESSION, blocking until it
+   arrives.  Set *DONE if the client ended the session.  Use
+   SCRATCH_POOL for temporary allocations. */
+svn_error_t *serve_session_command(svn_boolean_t *done,
+                                   serve_session_t *session,
+                                   apr_pool_t *scratch_pool);
+
+/* Return TRUE if SESSION has no input buffered, i.e. if it is safe to
+   wait for its socket to become readable before reading the next
+   command. */
+svn_boolean_t serve_session_idle(serve_session_t *session);
+
+/* Log the statistics of SESSION.  Use SCRATCH_POOL for temporary
+   allocations. */
+void serve_session_close(serve_session_t *session,
+                         apr_pool_t *scratch_pool);
+
 /* Load a svnserve configuration file located at FILENAME into CFG,
    and if such as found, then:
 
@@ -160,6 +211,21 @@ svn_error_t *load_configs(svn_config_t **cfg,
                           svn_ra_svn_conn_t *conn,
                           apr_pool_t *pool);
 
+/* Like svn_config_read2() with CASE_SENSITIVE set to FALSE, but share
+   the parsed FILE with all other callers in this process and only parse
+   it again once its modification time or size changed.  Files modified
+   within the last few seconds get parsed every time, as their
+   modification time may not change with the next edit.  Set *CFG to a
+   private copy allocated in RESULT_POOL.
+
+   Files that cannot be stat()ed are read without being shared.  Use
+   SCRATCH_POOL for temporary allocations. */
+svn_error_t *config_read_shared(svn_config_t **cfg,
+                                const char *file,
+                                svn_boolean_t must_exist,
+                                apr_pool_t *result_pool,
+                                apr_pool_t *scratch_pool);
+
 /* Initialize the Cyrus SASL library. POOL is used for allocations. */
 svn_error_t *cyrus_init(apr_pool_t *pool);
 
@@ -183,6 +249,42 @@ void
 log_error(svn_error_t *err, apr_file_t *log_file, const char *remote_host,
           const char *user, const char *repos, apr_pool_t *pool);
 
+/* Resources used by a single client command. */
+typedef struct request_metrics_t {
+  const char *cmdname;          /* Name of the command */
+  svn_boolean_t failed;         /* Command failure sent to the client */
+  apr_interval_time_t duration; /* Time spent handling the command */
+  apr_uint64_t bytes_in;        /* Protocol bytes received */
+  apr_uint64_t bytes_out;       /* Protocol bytes sent */
+  apr_uint64_t cache_reads;     /* FS cache lookups; this and CACHE_HITS
+                                   include concurrent requests, if any */
+  apr_uint64_t cache_hits;      /* FS cache lookups that found the data */
+} request_metrics_t;
+
+/* Create an empty statistics collection in *STATS that gets published
+   in the file PATH.  Allocate it in POOL.  Changes that have not been
+   published when the server becomes idle get written by a background
+   thread; the last ones get written when POOL gets cleaned up. */
+svn_error_t *server_stats_create(server_stats_t **stats,
+                                 const char *path,
+                                 apr_pool_t *pool);
+
+/* Count a new session in STATS. */
+svn_error_t *server_stats_add_session(server_stats_t *stats);
+
+/* Set *READS and *HITS to the current totals of the process-wide FS
+   cache. */
+svn_error_t *server_stats_get_cache_counts(apr_uint64_t *reads,
+                                           apr_uint64_t *hits);
+
+/* Add METRICS of a request from CLIENT, which may be NULL, to STATS and
+   rewrite the stats file if it has not been updated recently.  Use
+   SCRATCH_POOL for temporary allocations. */
+svn_error_t *server_stats_record(server_stats_t *stats,
+                                 const char *client,
+                                 const request_metrics_t *metrics,
+                                 apr_pool_t *scratch_pool);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -0,0 +1,511 @@
+/*
+ * stats.c :  Request statistics for svnserve
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+
+
+#include <apr_strings.h>
+#include <apr_thread_proc.h>
+#include <apr_thread_cond.h>
+
+#include "svn_types.h"
+#include "svn_pools.h"
+#include "svn_error.h"
+#include "svn_string.h"
+#include "svn_dirent_uri.h"
+#include "svn_io.h"
+#include "svn_time.h"
+
+#include "private/svn_cache.h"
+#include "private/svn_mutex.h"
+
+#include "svn_private_config.h"
+
+#include "server.h"
+
+/* Number of buckets in the latency histograms.  Bucket 0 counts the
+   requests that took less than 1 ms, bucket I those that took at least
+   2^(I-1) but less than 2^I ms.  The last bucket takes everything that
+   took 2^(LATENCY_BUCKETS-2) ms or longer. */
+#define LATENCY_BUCKETS 18
+
+/* Clients are tracked individually up to this number of addresses.
+   Requests from further addresses get accounted for as "other". */
+#define MAX_CLIENTS 1000
+
+/* Minimum time between two updates of the stats file.  Changes that
+   did not make it into the file right away get written by a background
+   thread less than twice this long after they have been recorded. */
+#define WRITE_INTERVAL (apr_time_from_sec(5))
+
+/* Accumulated metrics of a command type or of a client. */
+typedef struct request_totals_t
+{
+  apr_uint64_t count;
+  apr_uint64_t failed;
+  apr_uint64_t total_usec;
+  apr_uint64_t max_usec;
+  apr_uint64_t bytes_in;
+  apr_uint64_t bytes_out;
+  apr_uint64_t cache_reads;
+  apr_uint64_t cache_hits;
+  apr_uint64_t latency[LATENCY_BUCKETS];
+} request_totals_t;
+
+struct server_stats_t
+{
+  /* The file to publish the statistics in. */
+  const char *path;
+
+  /* Serializes access to all members below. */
+  svn_mutex__t *mutex;
+
+  /* Map command names and client addresses, respectively, to
+     request_totals_t *. */
+  apr_hash_t *commands;
+  apr_hash_t *clients;
+
+  /* Requests from clients beyond MAX_CLIENTS. */
+  request_totals_t other_clients;
+
+  /* Number of sessions that got past the handshake. */
+  apr_uint64_t sessions;
+
+  apr_time_t start_time;
+  apr_time_t last_write;
+
+  /* Set while some thread is updating the stats file. */
+  svn_boolean_t writing;
+
+  /* Set if there are changes that have not been written yet. */
+  svn_boolean_t dirty;
+
+#if APR_HAS_THREADS
+  /* The thread that writes changes once the server has become idle,
+     started with the first request, and the pool that it has been
+     created in. */
+  apr_thread_t *flusher;
+  apr_pool_t *flusher_pool;
+
+  /* Signaled when the flusher shall terminate. */
+  apr_thread_cond_t *shutdown_cond;
+  svn_boolean_t shutdown;
+#endif
+
+  /* Holds the hash contents. */
+  apr_pool_t *pool;
+};
+
+svn_error_t *
+server_stats_get_cache_counts(apr_uint64_t *reads,
+                              apr_uint64_t *hits)
+{
+  svn_membuffer_t *membuffer = svn_cache__get_global_membuffer_cache();
+
+  if (membuffer)
+    return svn_error_trace(svn_cache__membuffer_get_access_counts(reads,
+                                                                  hits,
+                                                                  membuffer));
+
+  *reads = 0;
+  *hits = 0;
+  return SVN_NO_ERROR;
+}
+
+/* Add METRICS to TOTALS. */
+static void
+add_request(request_totals_t *totals,
+            const request_metrics_t *metrics)
+{
+  apr_uint64_t usec = metrics->duration > 0 ? metrics->duration : 0;
+  apr_uint64_t msec = usec / 1000;
+  int bucket = 0;
+
+  while (bucket < LATENCY_BUCKETS - 1 && msec >= ((apr_uint64_t)1 << bucket))
+    ++bucket;
+
+  totals->count++;
+  if (metrics->failed)
+    totals->failed++;
+  totals->total_usec += usec;
+  if (totals->max_usec < usec)
+    totals->max_usec = usec;
+  totals->bytes_in += metrics->bytes_in;
+  totals->bytes_out += metrics->bytes_out;
+  totals->cache_reads += metrics->cache_reads;
+  totals->cache_hits += metrics->cache_hits;
+  totals->latency[bucket]++;
+}
+
+/* Return the entry for KEY in HASH, creating it in STATS if necessary. */
+static request_totals_t *
+get_totals(server_stats_t *stats,
+           apr_hash_t *hash,
+           const char *key)
+{
+  request_totals_t *totals = apr_hash_get(hash, key, APR_HASH_KEY_STRING);
+
+  if (totals == NULL)
+    {
+      totals = apr_pcalloc(stats->pool, sizeof(*totals));
+      apr_hash_set(hash, apr_pstrdup(stats->pool, key), APR_HASH_KEY_STRING,
+                   totals);
+    }
+
+  return totals;
+}
+
+/* Append a line describing TOTALS of the entry NAME of type KIND
+   to BUF. */
+static void
+format_totals(svn_stringbuf_t *buf,
+              const char *kind,
+              const char *name,
+              const request_totals_t *totals)
+{
+  apr_pool_t *pool = buf->pool;
+  int i;
+
+  svn_stringbuf_appendcstr(buf,
+    apr_psprintf(pool, "%s %s count %" APR_UINT64_T_FMT
+                       " failed %" APR_UINT64_T_FMT
+                       " total-usec %" APR_UINT64_T_FMT
+                       " max-usec %" APR_UINT64_T_FMT
+                       " bytes-in %" APR_UINT64_T_FMT
+                       " bytes-out %" APR_UINT64_T_FMT
+                       " cache-reads %" APR_UINT64_T_FMT
+                       " cache-hits %" APR_UINT64_T_FMT
+                       " latency-ms",
+                 kind, name, totals->count, totals->failed,
+                 totals->total_usec, totals->max_usec,
+                 totals->bytes_in, totals->bytes_out,
+                 totals->cache_reads, totals->cache_hits));
+
+  for (i = 0; i < LATENCY_BUCKETS - 1; ++i)
+    svn_stringbuf_appendcstr(buf,
+      apr_psprintf(pool, " <%" APR_UINT64_T_FMT ":%" APR_UINT64_T_FMT,
+                   (apr_uint64_t)1 << i, totals->latency[i]));
+
+  svn_stringbuf_appendcstr(buf,
+    apr_psprintf(pool, " >=%" APR_UINT64_T_FMT ":%" APR_UINT64_T_FMT "\n",
+                 (apr_uint64_t)1 << (LATENCY_BUCKETS - 2),
+                 totals->latency[LATENCY_BUCKETS - 1]));
+}
+
+/* Return the current contents of STATS as text allocated in
+   RESULT_POOL.  The caller must hold the STATS mutex. */
+static svn_stringbuf_t *
+format_stats(server_stats_t *stats,
+             apr_time_t now,
+             apr_pool_t *result_pool)
+{
+  svn_stringbuf_t *buf = svn_stringbuf_create_empty(result_pool);
+  apr_hash_index_t *hi;
+
+  svn_stringbuf_appendcstr(buf,
+    apr_psprintf(result_pool,
+                 "# svnserve request statistics as of %s\n"
+                 "uptime-sec %" APR_TIME_T_FMT "\n"
+                 "sessions %" APR_UINT64_T_FMT "\n",
+                 svn_time_to_cstring(now, result_pool),
+                 apr_time_sec(now - stats->start_time),
+                 stats->sessions));
+
+  for (hi = apr_hash_first(result_pool, stats->commands); hi;
+       hi = apr_hash_next(hi))
+    format_totals(buf, "command", svn__apr_hash_index_key(hi),
+                  svn__apr_hash_index_val(hi));
+
+  for (hi = apr_hash_first(result_pool, stats->clients); hi;
+       hi = apr_hash_next(hi))
+    format_totals(buf, "client", svn__apr_hash_index_key(hi),
+                  svn__apr_hash_index_val(hi));
+
+  if (stats->other_clients.count)
+    format_totals(buf, "client", "other", &stats->other_clients);
+
+  return buf;
+}
+
+/* Replace the stats file of STATS with CONTENTS.  Readers will either
+   see the old or the new file but never a partially written one. */
+static svn_error_t *
+write_stats_file(server_stats_t *stats,
+                 const svn_stringbuf_t *contents,
+                 apr_pool_t *scratch_pool)
+{
+  const char *tmp_path;
+
+  SVN_ERR(svn_io_write_unique(&tmp_path,
+                              svn_dirent_dirname(stats->path, scratch_pool),
+                              contents->data, contents->len,
+                              svn_io_file_del_none, scratch_pool));
+  return svn_error_trace(svn_io_file_rename(tmp_path, stats->path,
+                                            scratch_pool));
+}
+
+/* If STATS has changes that have not been written and no other thread
+   is updating the stats file, return the new contents of the file as of
+   NOW allocated in RESULT_POOL and mark STATS as being written.
+   Otherwise, return NULL.  The caller must hold the STATS mutex. */
+static svn_stringbuf_t *
+take_contents(server_stats_t *stats,
+              apr_time_t now,
+              apr_pool_t *result_pool)
+{
+  if (stats->writing || ! stats->dirty)
+    return NULL;
+
+  stats->last_write = now;
+  stats->writing = TRUE;
+  stats->dirty = FALSE;
+
+  return format_stats(stats, now, result_pool);
+}
+
+#if APR_HAS_THREADS
+
+/* Thread function writing the changes to the server_stats_t in DATA that
+   server_stats_record() left behind, once WRITE_INTERVAL has passed
+   since the last update of the file, until we get told to shut down.
+
+   svn_mutex__t is an apr_thread_mutex_t here, which lets us wait for the
+   STATS condition variable. */
+static void * APR_THREAD_FUNC
+flush_thread(apr_thread_t *thread, void *data)
+{
+  server_stats_t *stats = data;
+  apr_pool_t *scratch_pool
+    = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+
+  apr_thread_mutex_lock(stats->mutex);
+  while (! stats->shutdown)
+    {
+      apr_time_t now = apr_time_now();
+      svn_stringbuf_t *contents = NULL;
+
+      if (now - stats->last_write >= WRITE_INTERVAL)
+        contents = take_contents(stats, now, scratch_pool);
+
+      if (contents)
+        {
+          apr_thread_mutex_unlock(stats->mutex);
+          svn_error_clear(write_stats_file(stats, contents, scratch_pool));
+          svn_pool_clear(scratch_pool);
+          apr_thread_mutex_lock(stats->mutex);
+
+          stats->writing = FALSE;
+        }
+      else if (stats->dirty && now - stats->last_write < WRITE_INTERVAL)
+        apr_thread_cond_timedwait(stats->shutdown_cond, stats->mutex,
+                                  stats->last_write + WRITE_INTERVAL - now);
+      else
+        apr_thread_cond_timedwait(stats->shutdown_cond, stats->mutex,
+                                  WRITE_INTERVAL);
+    }
+  apr_thread_mutex_unlock(stats->mutex);
+
+  svn_pool_destroy(scratch_pool);
+  return NULL;
+}
+
+/* Start the flusher thread of STATS unless it is running already.
+   The caller must hold the STATS mutex. */
+static svn_error_t *
+start_flusher(server_stats_t *stats)
+{
+  apr_status_t status;
+
+  if (stats->flusher)
+    return SVN_NO_ERROR;
+
+  status = apr_thread_create(&stats->flusher, NULL, flush_thread, stats,
+                             stats->flusher_pool);
+  if (status)
+    {
+      stats->flusher = NULL;
+      return svn_error_wrap_apr(status, _("Can't create thread"));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+#endif
+
+/* Pool cleanup function for the server_stats_t in DATA.  Stop the
+   flusher thread and write any changes that have not made it into the
+   stats file yet. */
+static apr_status_t
+stats_cleanup(void *data)
+{
+  server_stats_t *stats = data;
+  apr_pool_t *scratch_pool
+    = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+  svn_stringbuf_t *contents = NULL;
+  svn_error_t *err;
+
+#if APR_HAS_THREADS
+  if (stats->flusher)
+    {
+      apr_status_t retval;
+
+      apr_thread_mutex_lock(stats->mutex);
+      stats->shutdown = TRUE;
+      apr_thread_cond_signal(stats->shutdown_cond);
+      apr_thread_mutex_unlock(stats->mutex);
+
+      apr_thread_join(&retval, stats->flusher);
+    }
+
+  apr_pool_destroy(stats->flusher_pool);
+#endif
+
+  err = svn_mutex__lock(stats->mutex);
+  if (! err)
+    {
+      contents = take_contents(stats, apr_time_now(), scratch_pool);
+      err = svn_mutex__unlock(stats->mutex, SVN_NO_ERROR);
+    }
+  if (! err && contents)
+    err = write_stats_file(stats, contents, scratch_pool);
+
+  svn_error_clear(err);
+  svn_pool_destroy(scratch_pool);
+
+  return APR_SUCCESS;
+}
+
+svn_error_t *
+server_stats_create(server_stats_t **stats,
+                    const char *path,
+                    apr_pool_t *pool)
+{
+  server_stats_t *s = apr_pcalloc(pool, sizeof(*s));
+
+  SVN_ERR(svn_mutex__init(&s->mutex, TRUE, pool));
+  s->path = apr_pstrdup(pool, path);
+  s->commands = apr_hash_make(pool);
+  s->clients = apr_hash_make(pool);
+  s->start_time = apr_time_now();
+  s->last_write = 0;
+  s->pool = pool;
+
+#if APR_HAS_THREADS
+  {
+    apr_status_t status = apr_thread_cond_create(&s->shutdown_cond, pool);
+    if (status)
+      return svn_error_wrap_apr(status,
+                                _("Can't create condition variable"));
+  }
+
+  /* The flusher gets started only once we serve requests, i.e. after
+     svnserve may have forked to become a daemon. */
+  s->flusher_pool = apr_allocator_owner_get(svn_pool_create_allocator(TRUE));
+#endif
+
+  /* Registered after creating the mutex, so it runs before the mutex
+     gets destroyed. */
+  apr_pool_cleanup_register(pool, s, stats_cleanup, apr_pool_cleanup_null);
+
+  *stats = s;
+  return SVN_NO_ERROR;
+}
+
+/* Count one more session in STATS. */
+static svn_error_t *
+add_session(server_stats_t *stats)
+{
+  stats->sessions++;
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+server_stats_add_session(server_stats_t *stats)
+{
+  SVN_MUTEX__WITH_LOCK(stats->mutex, add_session(stats));
+  return SVN_NO_ERROR;
+}
+
+/* Implement server_stats_record() while holding the STATS mutex.  If the
+   stats file is due for an update, return its new contents in *CONTENTS
+   and mark STATS as being written.  Otherwise, set *CONTENTS to NULL. */
+static svn_error_t *
+record_request(svn_stringbuf_t **contents,
+               server_stats_t *stats,
+               const char *client,
+               const request_metrics_t *metrics,
+               apr_pool_t *result_pool)
+{
+  apr_time_t now = apr_time_now();
+  request_totals_t *client_totals;
+
+  add_request(get_totals(stats, stats->commands, metrics->cmdname), metrics);
+
+  client_totals = apr_hash_get(stats->clients, client, APR_HASH_KEY_STRING);
+  if (client_totals == NULL && apr_hash_count(stats->clients) >= MAX_CLIENTS)
+    client_totals = &stats->other_clients;
+  else if (client_totals == NULL)
+    client_totals = get_totals(stats, stats->clients, client);
+  add_request(client_totals, metrics);
+  stats->dirty = TRUE;
+
+  *contents = NULL;
+#if APR_HAS_THREADS
+  SVN_ERR(start_flusher(stats));
+#endif
+
+  if (now - stats->last_write >= WRITE_INTERVAL)
+    *contents = take_contents(stats, now, result_pool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Mark STATS as no longer being written. */
+static svn_error_t *
+end_writing(server_stats_t *stats)
+{
+  SVN_ERR(svn_mutex__lock(stats->mutex));
+  stats->writing = FALSE;
+  return svn_mutex__unlock(stats->mutex, SVN_NO_ERROR);
+}
+
+svn_error_t *
+server_stats_record(server_stats_t *stats,
+                    const char *client,
+                    const request_metrics_t *metrics,
+                    apr_pool_t *scratch_pool)
+{
+  svn_stringbuf_t *contents;
+  svn_error_t *err;
+
+  SVN_MUTEX__WITH_LOCK(stats->mutex,
+                       record_request(&contents, stats,
+                                      client ? client : "-", metrics,
+                                      scratch_pool));
+  if (contents == NULL)
+    return SVN_NO_ERROR;
+
+  /* Don't block other requests while doing I/O. */
+  err = write_stats_file(stats, contents, scratch_pool);
+
+  return svn_error_trace(svn_error_compose_create(err, end_writing(stats)));
+}
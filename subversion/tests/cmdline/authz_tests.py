@@ -1451,6 +1451,34 @@ def remove_subdir_with_authz_and_tc(sbox):
                                         None, None, False,
                                         wc_dir)
 
+# svnserve shares parsed configuration files between connections, but
+# must not miss edits that leave their size and timestamp unchanged.
+@SkipUnless(svntest.main.is_ra_type_svn)
+def svnserve_conf_quick_edits(sbox):
+  "svnserve sees quick edits of svnserve.conf"
+
+  sbox.build(create_wc = False)
+
+  def write_svnserve_conf(auth_access):
+    conf = "[general]\nanon-access = none\nauth-access = %s\n" % auth_access
+    if svntest.main.options.enable_sasl:
+      conf += "realm = svntest\n[sasl]\nuse-sasl = true\n"
+    else:
+      conf += "password-db = passwd\n"
+    svntest.main.file_write(
+      svntest.main.get_svnserve_conf_file_path(sbox.repo_dir), conf)
+
+  # The access levels have the same length, and the edits follow each
+  # other quickly enough to get the same timestamp on most filesystems.
+  for auth_access in ['read', 'none', 'read', 'none']:
+    write_svnserve_conf(auth_access)
+    if auth_access == 'read':
+      expected_err = []
+    else:
+      expected_err = '.*[Aa]uthori[sz].*'
+    svntest.actions.run_and_verify_svn(None, None, expected_err,
+                                       'ls', sbox.repo_url)
+
 ########################################################################
 # Run the tests
 
@@ -1480,7 +1508,8 @@ test_list = [ None,
               wc_delete,
               wc_commit_error_handling,
               upgrade_absent,
-              remove_subdir_with_authz_and_tc
+              remove_subdir_with_authz_and_tc,
+              svnserve_conf_quick_edits,
              ]
 serial_only = True
 
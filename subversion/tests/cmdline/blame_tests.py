@@ -859,6 +859,27 @@ def blame_multiple_targets(sbox):
   multiple_wc_targets()
   multiple_url_targets()
 
+@SkipUnless(svntest.main.is_ra_type_svn)
+def blame_and_log_with_read_ahead(sbox):
+  "blame and log reading the response ahead"
+
+  sbox.build()
+  iota = os.path.join(sbox.wc_dir, 'iota')
+  read_ahead = '--config-option=servers:global:svn-read-ahead=2'
+
+  for i in range(10):
+    svntest.main.file_append(iota, "Line %d of iota\n" % i)
+    svntest.main.run_svn(None, 'ci', '-m', 'log msg %d' % i, iota)
+
+  # Both must give the same results as without reading ahead, even with
+  # more items in the response than fit into the queue.
+  for args in [('blame', iota),
+               ('log', '-v', sbox.repo_url),
+               ('log', '-v', '--limit', '3', iota)]:
+    exit_code, expected_output, err = svntest.main.run_svn(None, *args)
+    svntest.actions.run_and_verify_svn(None, expected_output, [],
+                                       read_ahead, *args)
+
 ########################################################################
 # Run the tests
 
@@ -881,6 +902,7 @@ test_list = [ None,
               blame_output_after_merge,
               merge_sensitive_blame_and_empty_mergeinfo,
               blame_multiple_targets,
+              blame_and_log_with_read_ahead,
              ]
 
 if __name__ == '__main__':
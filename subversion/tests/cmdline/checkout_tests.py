@@ -1098,6 +1098,55 @@ def checkout_wc_from_drive(sbox):
 
 #----------------------------------------------------------------------
 
+@SkipUnless(svntest.main.is_ra_type_svn)
+def checkout_with_parallel_connections(sbox):
+  "checkout and update over several connections"
+
+  sbox.build()
+  wc_dir = sbox.wc_dir
+  parallel = '--config-option=servers:global:svn-max-connections=4'
+
+  checkout_target = sbox.add_wc_path('checkout')
+  expected_output = svntest.main.greek_state.copy()
+  expected_output.wc_dir = checkout_target
+  expected_output.tweak(status='A ', contents=None)
+  expected_wc = svntest.main.greek_state.copy()
+  svntest.actions.run_and_verify_checkout(sbox.repo_url, checkout_target,
+                                          expected_output, expected_wc,
+                                          None, None, None, None,
+                                          parallel)
+
+  # Change a file and add one in the original working copy, then make
+  # the file texts arrive over the extra connections during an update.
+  svntest.main.file_append(os.path.join(wc_dir, 'A', 'mu'), 'more mu\n')
+  svntest.main.file_write(os.path.join(wc_dir, 'A', 'D', 'zeta'),
+                          'This is the file \'zeta\'.\n')
+  svntest.actions.run_and_verify_svn(None, None, [], 'add',
+                                     os.path.join(wc_dir, 'A', 'D', 'zeta'))
+  svntest.actions.run_and_verify_svn(None, None, [],
+                                     'ci', '-m', 'log msg', wc_dir)
+
+  expected_output = wc.State(checkout_target, {
+    'A/mu'     : Item(status='U '),
+    'A/D/zeta' : Item(status='A '),
+    })
+  expected_disk = svntest.main.greek_state.copy()
+  expected_disk.tweak('A/mu',
+                      contents="This is the file 'mu'.\nmore mu\n")
+  expected_disk.add({
+    'A/D/zeta' : Item("This is the file 'zeta'.\n"),
+    })
+  expected_status = svntest.actions.get_virginal_state(checkout_target, 2)
+  expected_status.add({
+    'A/D/zeta' : Item(status='  ', wc_rev=2),
+    })
+  svntest.actions.run_and_verify_update(checkout_target, expected_output,
+                                        expected_disk, expected_status,
+                                        None, None, None, None, None, False,
+                                        parallel)
+
+#----------------------------------------------------------------------
+
 # list all tests here, starting with None:
 test_list = [ None,
               checkout_with_obstructions,
@@ -1113,7 +1162,8 @@ test_list = [ None,
               checkout_peg_rev,
               checkout_peg_rev_date,
               co_with_obstructing_local_adds,
-              checkout_wc_from_drive
+              checkout_wc_from_drive,
+              checkout_with_parallel_connections,
             ]
 
 if __name__ == "__main__":
@@ -17826,6 +17826,90 @@ def merge_with_added_subtrees_with_mergeinfo(sbox):
                                        None, None, None, None,
                                        None, 1, 0)
 
+#----------------------------------------------------------------------
+@SkipUnless(server_has_mergeinfo)
+def merge_with_worker_threads(sbox):
+  "merge file texts on several threads"
+
+  sbox.build()
+  wc_dir = sbox.wc_dir
+  A_COPY_path = sbox.ospath('A_COPY')
+  files = ['mu', 'B/lambda', 'B/E/alpha', 'B/E/beta', 'D/gamma',
+           'D/G/pi', 'D/G/rho', 'D/G/tau', 'D/H/chi', 'D/H/omega',
+           'D/H/psi']
+
+  # r2: Make A/D/gamma a translated file, which always gets merged
+  # synchronously, in between the others.
+  sbox.simple_propset('svn:eol-style', 'native', 'A/D/gamma')
+  sbox.simple_commit()
+
+  # r3: Branch A to A_COPY.
+  sbox.simple_repo_copy('A', 'A_COPY')
+  sbox.simple_update()
+
+  # r4: Change all files on A.  Add a file and change a directory
+  # property, whose notifications must not overtake the ones for the
+  # file texts being merged in the background.
+  for f in files:
+    sbox.simple_append('A/' + f, "trunk change to '%s'.\n" % f)
+  sbox.simple_append('A/D/G/zeta', "This is the file 'zeta'.\n")
+  sbox.simple_add('A/D/G/zeta')
+  sbox.simple_propset('prop', 'value', 'A/D')
+  sbox.simple_commit()
+
+  # r5: Change A_COPY/mu such that it merges cleanly with r4.
+  sbox.simple_append('A_COPY/mu', "branch change\nThis is the file 'mu'.\n",
+                     truncate=True)
+  sbox.simple_commit()
+  sbox.simple_update()
+
+  def merge_A_to_A_COPY(threads):
+    """Merge A to A_COPY with local changes that conflict with r4 in
+       THREADS threads.  Return the merge output, the status of the
+       working copy and the contents of the files below A_COPY."""
+
+    for f in ['D/G/rho', 'D/H/psi']:
+      sbox.simple_append('A_COPY/' + f, "local change to '%s'.\n" % f)
+
+    exit_code, output, err = svntest.main.run_svn(
+      None, 'merge', '--accept', 'postpone',
+      '--config-option=config:miscellany:merge-threads=%d' % threads,
+      sbox.repo_url + '/A', A_COPY_path)
+    exit_code, status, err = svntest.main.run_svn(None, 'status', '-v',
+                                                  wc_dir)
+    disk = {}
+    for dirpath, dirs, filenames in os.walk(A_COPY_path):
+      if svntest.main.get_admin_name() in dirs:
+        dirs.remove(svntest.main.get_admin_name())
+      for name in filenames:
+        path = os.path.join(dirpath, name)
+        disk[path] = open(path, 'rb').read()
+
+    return output, status, disk
+
+  expected_output, expected_status, expected_disk = merge_A_to_A_COPY(1)
+
+  # Sanity check the single-threaded merge.
+  merged = [line for line in expected_output if line[:1] in 'UGC']
+  conflicted = [line for line in merged if line.startswith('C')]
+  if len(merged) != len(files) or len(conflicted) != 2:
+    raise svntest.Failure("Unexpected merge output: %s" % expected_output)
+
+  svntest.actions.run_and_verify_svn(None, None, [], 'revert', '-R', wc_dir)
+  os.remove(sbox.ospath('A_COPY/D/G/zeta'))
+
+  # With worker threads, notifications still arrive in the order of the
+  # editor drive, and the result is the same.
+  output, status, disk = merge_A_to_A_COPY(4)
+  svntest.verify.compare_and_display_lines(
+    "Merge output with worker threads differs", 'STDOUT',
+    expected_output, output)
+  svntest.verify.compare_and_display_lines(
+    "Status after merging with worker threads differs", 'STDOUT',
+    expected_status, status)
+  if disk != expected_disk:
+    raise svntest.Failure("Files differ after merging with worker threads")
+
 ########################################################################
 # Run the tests
 
@@ -17961,6 +18045,7 @@ test_list = [ None,
               reverse_merge_with_rename,
               merge_adds_then_deletes_subtree,
               merge_with_added_subtrees_with_mergeinfo,
+              merge_with_worker_threads,
              ]
 
 if __name__ == '__main__':
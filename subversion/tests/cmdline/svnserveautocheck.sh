@@ -31,6 +31,7 @@
 # distribution; it's easiest to just run it as "make
 # svnserveautocheck".  Like "make check", you can specify further options
 # like "make svnserveautocheck FS_TYPE=bdb TESTS=subversion/tests/cmdline/basic.py".
+# Set THREADED or THREAD_POOL to run svnserve with -T or --thread-pool.
 
 PYTHON=${PYTHON:-python}
 
@@ -103,6 +104,12 @@ if [ "$THREADED" != "" ]; then
   SVNSERVE_ARGS="-T"
 fi
 
+# Use fewer worker threads than the tests open concurrent sessions, so
+# that a connection which keeps its worker while idle stalls the run.
+if [ "$THREAD_POOL" != "" ]; then
+  SVNSERVE_ARGS="--thread-pool --min-threads 1 --max-threads 2"
+fi
+
 if [ ${CACHE_REVPROPS:+set} ]; then
   SVNSERVE_ARGS="$SVNSERVE_ARGS --cache-revprops on"
 fi
@@ -0,0 +1,305 @@
+/*
+ * blame-test.c :  test the blame chain updates in libsvn_client
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+/* The blame cursor is private to blame.c. */
+#include "../../libsvn_client/blame.c"
+
+#include "../svn_test.h"
+
+
+/* A change reported by svn_diff_output() in the coordinates that
+   output_diff_modified() uses. */
+typedef struct hunk_t
+{
+  apr_off_t original_length;
+  apr_off_t modified_start;
+  apr_off_t modified_length;
+} hunk_t;
+
+/* Return the chunk of the chain starting at BLAME that contains token
+   OFF, walking it from the beginning. */
+static struct blame *
+linear_find(struct blame *blame, apr_off_t off)
+{
+  struct blame *prev = NULL;
+  while (blame)
+    {
+      if (blame->start > off) break;
+      prev = blame;
+      blame = blame->next;
+    }
+  return prev;
+}
+
+/* Shift the start of BLAME and all chunks behind it by ADJUST tokens. */
+static void
+linear_adjust(struct blame *blame, apr_off_t adjust)
+{
+  while (blame)
+    {
+      blame->start += adjust;
+      blame = blame->next;
+    }
+}
+
+/* Like blame_delete_range() but without a cursor, i.e. the way blame
+   chains were updated before the cursor had been introduced. */
+static void
+linear_delete_range(struct blame_chain *chain,
+                    apr_off_t start,
+                    apr_off_t length)
+{
+  struct blame *first = linear_find(chain->blame, start);
+  struct blame *last = linear_find(chain->blame, start + length);
+  struct blame *tail = last->next;
+
+  if (first != last)
+    {
+      struct blame *walk = first->next;
+      while (walk != last)
+        {
+          struct blame *next = walk->next;
+          blame_destroy(chain, walk);
+          walk = next;
+        }
+      first->next = last;
+      last->start = start;
+      if (first->start == start)
+        {
+          *first = *last;
+          blame_destroy(chain, last);
+          last = first;
+        }
+    }
+
+  if (tail && tail->start == last->start + length)
+    {
+      *last = *tail;
+      blame_destroy(chain, tail);
+      tail = last->next;
+    }
+
+  linear_adjust(tail, -length);
+}
+
+/* Like blame_insert_range() but without a cursor. */
+static void
+linear_insert_range(struct blame_chain *chain,
+                    struct rev *rev,
+                    apr_off_t start,
+                    apr_off_t length)
+{
+  struct blame *point = linear_find(chain->blame, start);
+  struct blame *insert;
+
+  if (point->start == start)
+    {
+      insert = blame_create(chain, point->rev, point->start + length);
+      point->rev = rev;
+      insert->next = point->next;
+      point->next = insert;
+    }
+  else
+    {
+      struct blame *middle;
+      middle = blame_create(chain, rev, start);
+      insert = blame_create(chain, point->rev, start + length);
+      middle->next = insert;
+      insert->next = point->next;
+      point->next = middle;
+    }
+  linear_adjust(insert->next, length);
+}
+
+/* Return a new chain, allocated in POOL, that blames everything on REV. */
+static struct blame_chain *
+create_chain(struct rev *rev, apr_pool_t *pool)
+{
+  struct blame_chain *chain = apr_pcalloc(pool, sizeof(*chain));
+
+  chain->pool = pool;
+  chain->blame = blame_create(chain, rev, 0);
+  return chain;
+}
+
+/* Apply the NUM_HUNKS HUNKS of a diff to a file with *LEN tokens, blaming
+   the changes on REV.  Update CURSOR_CHAIN the way add_file_blame() does
+   and LINEAR_CHAIN the way it used to, then verify that both chains are
+   the same.  Update *LEN to the length of the modified file. */
+static svn_error_t *
+apply_hunks(struct blame_chain *cursor_chain,
+            struct blame_chain *linear_chain,
+            apr_off_t *len,
+            struct rev *rev,
+            const hunk_t *hunks,
+            int num_hunks)
+{
+  struct blame_cursor cursor;
+  struct diff_baton diff_baton;
+  struct blame *b1, *b2;
+  int i;
+
+  blame_cursor_init(&cursor, cursor_chain);
+  diff_baton.cursor = &cursor;
+  diff_baton.rev = rev;
+
+  for (i = 0; i < num_hunks; i++)
+    {
+      const hunk_t *hunk = &hunks[i];
+
+      /* Tokens before MODIFIED_START are in modified coordinates
+         already, the ones behind it still are in original ones. */
+      SVN_TEST_ASSERT(hunk->modified_start + hunk->original_length <= *len);
+      *len += hunk->modified_length - hunk->original_length;
+
+      SVN_ERR(output_diff_modified(&diff_baton, 0, hunk->original_length,
+                                   hunk->modified_start,
+                                   hunk->modified_length, 0, 0));
+
+      if (hunk->original_length)
+        linear_delete_range(linear_chain, hunk->modified_start,
+                            hunk->original_length);
+      if (hunk->modified_length)
+        linear_insert_range(linear_chain, rev, hunk->modified_start,
+                            hunk->modified_length);
+    }
+
+  blame_cursor_finish(&cursor);
+
+  for (b1 = cursor_chain->blame, b2 = linear_chain->blame;
+       b1 && b2;
+       b1 = b1->next, b2 = b2->next)
+    {
+      SVN_TEST_ASSERT(b1->start == b2->start);
+      SVN_TEST_ASSERT(b1->rev->revision == b2->rev->revision);
+    }
+  SVN_TEST_ASSERT(b1 == NULL && b2 == NULL);
+
+  return SVN_NO_ERROR;
+}
+
+/* Return a pseudo-random number in [0, LIMIT), advancing *SEED. */
+static apr_off_t
+next_random(apr_uint32_t *seed, apr_off_t limit)
+{
+  *seed = *seed * 1103515245 + 12345;
+  return (apr_off_t)((*seed >> 16) % (apr_uint32_t)limit);
+}
+
+static svn_error_t *
+blame_cursor_vs_linear(apr_pool_t *pool)
+{
+  /* Diffs applied one after another to a file of 20 lines.  Each diff
+     has up to three hunks. */
+  static const struct
+  {
+    int num_hunks;
+    hunk_t hunks[3];
+  } diffs[] =
+    {
+      /* Insert, delete and replace at the start. */
+      { 1, { { 0,  0, 2 } } },
+      { 1, { { 2,  0, 0 } } },
+      { 1, { { 1,  0, 1 } } },
+      /* ... in the middle. */
+      { 1, { { 0, 10, 3 } } },
+      { 1, { { 4, 10, 0 } } },
+      { 1, { { 2,  8, 2 } } },
+      /* ... at the end. */
+      { 1, { { 0, 19, 4 } } },
+      { 1, { { 3, 20, 0 } } },
+      { 1, { { 2, 18, 3 } } },
+      /* Several hunks in one diff. */
+      { 3, { { 1,  0, 2 }, { 2, 10, 1 }, { 1, 20, 3 } } },
+      { 3, { { 0,  0, 1 }, { 3,  5, 0 }, { 0, 20, 2 } } },
+      { 3, { { 2,  0, 0 }, { 0,  4, 5 }, { 4, 15, 0 } } },
+      { 2, { { 0,  3, 1 }, { 0,  5, 1 } } }
+    };
+  struct blame_chain *cursor_chain, *linear_chain;
+  struct rev *revs;
+  apr_uint32_t seed = 42;
+  apr_off_t len = 20;
+  int num_diffs = sizeof(diffs) / sizeof(diffs[0]);
+  int num_revs = num_diffs + 500;
+  int i;
+
+  revs = apr_pcalloc(pool, (num_revs + 1) * sizeof(*revs));
+  for (i = 0; i <= num_revs; i++)
+    revs[i].revision = i;
+
+  cursor_chain = create_chain(&revs[0], pool);
+  linear_chain = create_chain(&revs[0], pool);
+
+  for (i = 0; i < num_diffs; i++)
+    SVN_ERR(apply_hunks(cursor_chain, linear_chain, &len, &revs[i + 1],
+                        diffs[i].hunks, diffs[i].num_hunks));
+
+  /* Random diffs with up to 8 hunks each, including ones that remove all
+     lines or touch the first and last line. */
+  for (i = num_diffs + 1; i <= num_revs; i++)
+    {
+      hunk_t hunks[8];
+      int num_hunks = 0;
+      apr_off_t original_pos = 0, modified_pos = 0;
+      apr_off_t original_len = len;
+
+      while (num_hunks < 8)
+        {
+          hunk_t *hunk = &hunks[num_hunks];
+          apr_off_t remaining = original_len - original_pos;
+          apr_off_t gap = next_random(&seed, remaining / 2 + 2);
+
+          /* svn_diff_output() merges adjacent hunks. */
+          if (num_hunks && gap == 0)
+            gap = 1;
+          if (gap > remaining)
+            break;
+
+          hunk->original_length = next_random(&seed, remaining - gap + 1);
+          hunk->modified_length = next_random(&seed, 6);
+          if (!hunk->original_length && !hunk->modified_length)
+            hunk->modified_length = 1;
+
+          hunk->modified_start = modified_pos + gap;
+          original_pos += gap + hunk->original_length;
+          modified_pos = hunk->modified_start + hunk->modified_length;
+          num_hunks++;
+        }
+
+      SVN_ERR(apply_hunks(cursor_chain, linear_chain, &len, &revs[i],
+                          hunks, num_hunks));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+
+/* The test table.  */
+
+struct svn_test_descriptor_t test_funcs[] =
+  {
+    SVN_TEST_NULL,
+    SVN_TEST_PASS2(blame_cursor_vs_linear,
+                   "test blame cursor against a linear walk"),
+    SVN_TEST_NULL
+  };
@@ -34,6 +34,7 @@
 #include "svn_repos.h"
 #include "svn_subst.h"
 #include "private/svn_wc_private.h"
+#include "private/svn_cache.h"
 
 #include "../svn_test.h"
 #include "../svn_test_fs.h"
@@ -803,6 +804,198 @@ test_externals_parse(const svn_test_opts_t *opts, apr_pool_t *pool)
 
 
 
+/* Baton for blame_line_receiver() and blame_rev_notify(). */
+struct blame_baton_t
+{
+  /* The revisions in which the lines of the file were last changed. */
+  apr_array_header_t *line_revs;
+
+  /* Number of revisions that blame has processed. */
+  int nbr_revs_processed;
+};
+
+/* Implements svn_client_blame_receiver3_t. */
+static svn_error_t *
+blame_line_receiver(void *baton,
+                    svn_revnum_t start_revnum,
+                    svn_revnum_t end_revnum,
+                    apr_int64_t line_no,
+                    svn_revnum_t revision,
+                    apr_hash_t *rev_props,
+                    svn_revnum_t merged_revision,
+                    apr_hash_t *merged_rev_props,
+                    const char *merged_path,
+                    const char *line,
+                    svn_boolean_t local_change,
+                    apr_pool_t *pool)
+{
+  struct blame_baton_t *b = baton;
+
+  SVN_TEST_ASSERT(line_no == b->line_revs->nelts);
+  APR_ARRAY_PUSH(b->line_revs, svn_revnum_t) = revision;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_wc_notify_func2_t. */
+static void
+blame_rev_notify(void *baton,
+                 const svn_wc_notify_t *notify,
+                 apr_pool_t *pool)
+{
+  struct blame_baton_t *b = baton;
+
+  if (notify->action == svn_wc_notify_blame_revision)
+    b->nbr_revs_processed++;
+}
+
+/* Blame URL at HEAD starting at revision 1 and check that the lines of
+   the file have been last changed in EXPECTED_REVS (terminated by
+   SVN_INVALID_REVNUM).  Set *NBR_REVS_PROCESSED to the number of
+   revisions that blame had to process. */
+static svn_error_t *
+check_blame(int *nbr_revs_processed,
+            const char *url,
+            const svn_revnum_t *expected_revs,
+            svn_client_ctx_t *ctx,
+            apr_pool_t *pool)
+{
+  struct blame_baton_t b;
+  svn_opt_revision_t head_rev = { svn_opt_revision_head, { 0 } };
+  svn_opt_revision_t start_rev = { svn_opt_revision_number, { 1 } };
+  svn_diff_file_options_t *diff_options = svn_diff_file_options_create(pool);
+  int i;
+
+  b.line_revs = apr_array_make(pool, 4, sizeof(svn_revnum_t));
+  b.nbr_revs_processed = 0;
+  ctx->notify_func2 = blame_rev_notify;
+  ctx->notify_baton2 = &b;
+
+  SVN_ERR(svn_client_blame5(url, &head_rev, &start_rev, &head_rev,
+                            diff_options, FALSE, FALSE,
+                            blame_line_receiver, &b, ctx, pool));
+
+  for (i = 0; SVN_IS_VALID_REVNUM(expected_revs[i]); i++)
+    {
+      SVN_TEST_ASSERT(i < b.line_revs->nelts);
+      SVN_TEST_ASSERT(APR_ARRAY_IDX(b.line_revs, i, svn_revnum_t)
+                      == expected_revs[i]);
+    }
+  SVN_TEST_ASSERT(i == b.line_revs->nelts);
+
+  *nbr_revs_processed = b.nbr_revs_processed;
+  return SVN_NO_ERROR;
+}
+
+/* Commit CONTENTS as the new text of iota in REPOS. */
+static svn_error_t *
+commit_iota(svn_repos_t *repos,
+            const char *contents,
+            apr_pool_t *pool)
+{
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+  svn_revnum_t youngest_rev;
+
+  SVN_ERR(svn_fs_youngest_rev(&youngest_rev, svn_repos_fs(repos), pool));
+  SVN_ERR(svn_fs_begin_txn2(&txn, svn_repos_fs(repos), youngest_rev,
+                            0 /* flags */, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "iota", contents, pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+  SVN_TEST_ASSERT(SVN_IS_VALID_REVNUM(youngest_rev));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_blame_cache(const svn_test_opts_t *opts,
+                 apr_pool_t *pool)
+{
+  const char *repos_url;
+  const char *url;
+  svn_repos_t *repos;
+  svn_client_ctx_t *ctx;
+  int nbr_revs_processed;
+  svn_boolean_t cached = svn_cache__get_global_membuffer_cache() != NULL;
+  const svn_revnum_t r2_revs[] = { 1, 2, SVN_INVALID_REVNUM };
+  const svn_revnum_t r3_revs[] = { 1, 3, 2, SVN_INVALID_REVNUM };
+
+  /* Create a filesytem and repository containing the Greek tree. */
+  SVN_ERR(create_greek_repos(&repos_url, "test-blame-cache", opts, pool));
+  SVN_ERR(svn_repos_open2(&repos, "test-blame-cache", NULL, pool));
+  url = svn_path_url_add_component2(repos_url, "iota", pool);
+
+  SVN_ERR(svn_client_create_context(&ctx, pool));
+
+  /* ra_local lets the repository compute the initial blame.  That
+     reports each revision that lines get attributed to, i.e. r1 and r2. */
+  SVN_ERR(commit_iota(repos, "This is the file 'iota'.\nline 2\n", pool));
+  SVN_ERR(check_blame(&nbr_revs_processed, url, r2_revs, ctx, pool));
+  SVN_TEST_ASSERT(nbr_revs_processed == 2);
+
+  /* Blaming again must give the same result.  With the blame of r2
+     cached, only the cache base revision needs to be processed. */
+  SVN_ERR(check_blame(&nbr_revs_processed, url, r2_revs, ctx, pool));
+  SVN_TEST_ASSERT(nbr_revs_processed == (cached ? 1 : 2));
+
+  /* After a new commit, only r2 and r3 need to be looked at.  Without
+     the cache, the server blames r1, r2 and r3 again. */
+  SVN_ERR(commit_iota(repos,
+                      "This is the file 'iota'.\nline 1.5\nline 2\n", pool));
+  SVN_ERR(check_blame(&nbr_revs_processed, url, r3_revs, ctx, pool));
+  SVN_TEST_ASSERT(nbr_revs_processed == (cached ? 2 : 3));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_blame_cache_replaced(const svn_test_opts_t *opts,
+                          apr_pool_t *pool)
+{
+  const char *repos_url;
+  const char *url;
+  svn_repos_t *repos;
+  svn_client_ctx_t *ctx;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root, *rev_root;
+  svn_revnum_t youngest_rev;
+  int nbr_revs_processed;
+  const svn_revnum_t r3_revs[] = { 1, 3, 2, SVN_INVALID_REVNUM };
+  const svn_revnum_t r4_revs[] = { 4, 3, 2, SVN_INVALID_REVNUM };
+
+  SVN_ERR(create_greek_repos(&repos_url, "test-blame-cache-replaced", opts,
+                             pool));
+  SVN_ERR(svn_repos_open2(&repos, "test-blame-cache-replaced", NULL, pool));
+  url = svn_path_url_add_component2(repos_url, "iota", pool);
+
+  SVN_ERR(svn_client_create_context(&ctx, pool));
+
+  SVN_ERR(commit_iota(repos, "This is the file 'iota'.\nline 2\n", pool));
+  SVN_ERR(commit_iota(repos,
+                      "This is the file 'iota'.\nline 1.5\nline 2\n", pool));
+  SVN_ERR(commit_iota(repos, "line 1\nline 1.5\nline 2\n", pool));
+  SVN_ERR(check_blame(&nbr_revs_processed, url, r4_revs, ctx, pool));
+
+  /* Replace iota with a copy of itself from r3, i.e. before the change
+     that the blame of r4 attributes its first line to. */
+  SVN_ERR(svn_fs_youngest_rev(&youngest_rev, svn_repos_fs(repos), pool));
+  SVN_ERR(svn_fs_begin_txn2(&txn, svn_repos_fs(repos), youngest_rev,
+                            0 /* flags */, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_fs_revision_root(&rev_root, svn_repos_fs(repos), 3, pool));
+  SVN_ERR(svn_fs_delete(txn_root, "iota", pool));
+  SVN_ERR(svn_fs_copy(rev_root, "iota", txn_root, "iota", pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+  SVN_TEST_ASSERT(youngest_rev == 5);
+
+  /* The blame of r4 must not be reused for the new line of history. */
+  SVN_ERR(check_blame(&nbr_revs_processed, url, r3_revs, ctx, pool));
+
+  return SVN_NO_ERROR;
+}
+
+
 
 /* ========================================================================== */
 
@@ -821,5 +1014,8 @@ struct svn_test_descriptor_t test_funcs[] =
 #endif
     SVN_TEST_OPTS_PASS(test_youngest_common_ancestor, "test youngest_common_ancestor"),
     SVN_TEST_OPTS_PASS(test_externals_parse, "test svn_wc_parse_externals_description3"),
+    SVN_TEST_OPTS_PASS(test_blame_cache, "test incremental blame"),
+    SVN_TEST_OPTS_PASS(test_blame_cache_replaced,
+                       "test incremental blame of a replaced file"),
     SVN_TEST_NULL
   };
@@ -28,6 +28,7 @@
 #include "svn_types.h"
 #include "svn_error.h"
 #include "svn_delta.h"
+#include "svn_io.h"
 
 #include "private/svn_subr_private.h"
 
@@ -96,6 +97,139 @@ stream_window_test(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* Reconstruct the target of WINDOW from SBUF into TBUF one byte at a
+   time, as a reference for svn_txdelta_apply_instructions(). */
+static void
+naive_apply(const svn_txdelta_window_t *window,
+            const char *sbuf,
+            char *tbuf)
+{
+  apr_size_t tpos = 0;
+  int i;
+
+  for (i = 0; i < window->num_ops; i++)
+    {
+      const svn_txdelta_op_t *op = &window->ops[i];
+      apr_size_t k;
+
+      for (k = 0; k < op->length; k++, tpos++)
+        switch (op->action_code)
+          {
+          case svn_txdelta_source:
+            tbuf[tpos] = sbuf[op->offset + k];
+            break;
+          case svn_txdelta_target:
+            tbuf[tpos] = tbuf[op->offset + k];
+            break;
+          case svn_txdelta_new:
+            tbuf[tpos] = window->new_data->data[op->offset + k];
+            break;
+          }
+    }
+}
+
+static svn_error_t *
+svndiff_window_test(apr_pool_t *pool)
+{
+  static char source[300];
+  static const svn_txdelta_op_t ops[] =
+    {
+      { svn_txdelta_new,      0,   3 },   /* "xyz" */
+      { svn_txdelta_target,   2,  70 },   /* run of 'z' */
+      { svn_txdelta_source, 200,  90 },   /* multi-byte offset and length */
+      { svn_txdelta_target, 158,  40 },   /* overlapping, 5 bytes apart */
+      { svn_txdelta_target, 199,  11 },   /* overlapping, 4 bytes apart */
+      { svn_txdelta_target, 211,   9 },   /* overlapping, 3 bytes apart */
+      { svn_txdelta_new,      3,   2 },   /* "uv" */
+      { svn_txdelta_target,   0, 100 },   /* no overlap */
+      { svn_txdelta_source,   7,   1 }
+    };
+  svn_txdelta_window_t window;
+  svn_string_t new_data;
+  char expected[326], actual[326];
+  int version;
+  int i;
+
+  for (i = 0; i < (int)sizeof(source); i++)
+    source[i] = (char)('A' + i % 53);
+
+  new_data.data = "xyzuv";
+  new_data.len = 5;
+
+  window.sview_offset = 0;
+  window.sview_len = sizeof(source);
+  window.tview_len = 0;
+  window.num_ops = sizeof(ops) / sizeof(ops[0]);
+  window.src_ops = 2;
+  window.ops = ops;
+  window.new_data = &new_data;
+  for (i = 0; i < window.num_ops; i++)
+    window.tview_len += ops[i].length;
+
+  naive_apply(&window, source, expected);
+
+  /* Apply into buffers that are too short as well as into one that
+     takes the whole window. */
+  for (i = 0; i < (int)window.tview_len; i += 37)
+    {
+      apr_size_t len = (apr_size_t)i;
+
+      svn_txdelta_apply_instructions(&window, source, actual, &len);
+      SVN_TEST_ASSERT(len == (apr_size_t)i);
+      SVN_TEST_ASSERT(memcmp(actual, expected, len) == 0);
+    }
+
+  {
+    apr_size_t len = sizeof(actual);
+
+    svn_txdelta_apply_instructions(&window, source, actual, &len);
+    SVN_TEST_ASSERT(len == window.tview_len);
+    SVN_TEST_ASSERT(memcmp(actual, expected, len) == 0);
+  }
+
+  /* The window must survive a round trip through svndiff. */
+  for (version = 0; version <= 1; version++)
+    {
+      svn_stringbuf_t *svndiff = svn_stringbuf_create_empty(pool);
+      svn_txdelta_window_handler_t handler;
+      void *handler_baton;
+      svn_txdelta_window_t *parsed;
+      svn_stream_t *stream;
+      char header[4];
+      apr_size_t len = sizeof(header);
+
+      svn_txdelta_to_svndiff3(&handler, &handler_baton,
+                              svn_stream_from_stringbuf(svndiff, pool),
+                              version, SVN_DELTA_COMPRESSION_LEVEL_DEFAULT,
+                              pool);
+      SVN_ERR(handler(&window, handler_baton));
+      SVN_ERR(handler(NULL, handler_baton));
+
+      stream = svn_stream_from_stringbuf(svndiff, pool);
+      SVN_ERR(svn_stream_read(stream, header, &len));
+      SVN_TEST_ASSERT(len == sizeof(header) && header[3] == version);
+      SVN_ERR(svn_txdelta_read_svndiff_window(&parsed, stream, version,
+                                              pool));
+
+      SVN_TEST_ASSERT(parsed->tview_len == window.tview_len);
+      SVN_TEST_ASSERT(parsed->num_ops == window.num_ops);
+      SVN_TEST_ASSERT(parsed->src_ops == window.src_ops);
+      for (i = 0; i < window.num_ops; i++)
+        {
+          SVN_TEST_ASSERT(parsed->ops[i].action_code == ops[i].action_code);
+          SVN_TEST_ASSERT(parsed->ops[i].offset == ops[i].offset);
+          SVN_TEST_ASSERT(parsed->ops[i].length == ops[i].length);
+        }
+
+      len = sizeof(actual);
+      svn_txdelta_apply_instructions(parsed, source, actual, &len);
+      SVN_TEST_ASSERT(len == window.tview_len);
+      SVN_TEST_ASSERT(memcmp(actual, expected, len) == 0);
+    }
+
+  return SVN_NO_ERROR;
+}
+
 
 
 /* The test table.  */
@@ -105,5 +239,7 @@ struct svn_test_descriptor_t test_funcs[] =
     SVN_TEST_NULL,
     SVN_TEST_PASS2(stream_window_test,
                    "txdelta stream and windows test"),
+    SVN_TEST_PASS2(svndiff_window_test,
+                   "svndiff decoding and window application"),
     SVN_TEST_NULL
   };
@@ -26,10 +26,12 @@
 
 #include "../svn_test.h"
 #include "../../libsvn_fs_fs/fs.h"
+#include "../../libsvn_fs_fs/fs_fs.h"
 
 #include "svn_pools.h"
 #include "svn_props.h"
 #include "svn_fs.h"
+#include "private/svn_fs_private.h"
 #include "private/svn_string_private.h"
 
 #include "../svn_test_fs.h"
@@ -732,6 +734,153 @@ recover_fully_packed(const svn_test_opts_t *opts,
 #undef MAX_REV
 #undef SHARD_SIZE
 
+/* ------------------------------------------------------------------------ */
+/* Check that the node property list of PATH in ROOT has "p" set to
+   EXPECTED or, if EXPECTED is NULL, no properties at all. */
+static svn_error_t *
+check_node_prop(svn_fs_root_t *root,
+                const char *path,
+                const char *expected,
+                apr_pool_t *pool)
+{
+  apr_hash_t *proplist;
+  svn_string_t *value;
+
+  SVN_ERR(svn_fs_node_proplist(&proplist, root, path, pool));
+  if (expected == NULL)
+    {
+      SVN_TEST_ASSERT(apr_hash_count(proplist) == 0);
+      return SVN_NO_ERROR;
+    }
+
+  SVN_TEST_ASSERT(apr_hash_count(proplist) == 1);
+  value = apr_hash_get(proplist, "p", APR_HASH_KEY_STRING);
+  SVN_TEST_ASSERT(value != NULL);
+  SVN_TEST_STRING_ASSERT(value->data, expected);
+
+  return SVN_NO_ERROR;
+}
+
+#define REPO_NAME "test-repo-prefetch-dir"
+#define SHARD_SIZE 4
+#define MAX_REV 6
+static svn_error_t *
+prefetch_dir_entries(const svn_test_opts_t *opts,
+                     apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root, *root1, *root7, *root8;
+  const char *conflict;
+  svn_revnum_t after_rev;
+  apr_array_header_t *names, *ids;
+  int i;
+
+  /* Bail (with success) on known-untestable scenarios */
+  if ((strcmp(opts->fs_type, "fsfs") != 0)
+      || (opts->server_minor_version && (opts->server_minor_version < 6)))
+    return SVN_NO_ERROR;
+
+  /* r1 - r3 are packed.  Add props in r7 and change some of them in r8. */
+  SVN_ERR(create_packed_filesystem(REPO_NAME, opts, MAX_REV, SHARD_SIZE,
+                                   pool));
+  SVN_ERR(svn_fs_open(&fs, REPO_NAME, NULL, pool));
+
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, MAX_REV, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_fs_change_node_prop(txn_root, "iota", "p",
+                                  svn_string_create("iota7", pool), pool));
+  SVN_ERR(svn_fs_change_node_prop(txn_root, "A/mu", "p",
+                                  svn_string_create("mu7", pool), pool));
+  SVN_ERR(svn_fs_change_node_prop(txn_root, "A/B", "p",
+                                  svn_string_create("B7", pool), pool));
+  SVN_ERR(svn_fs_commit_txn(&conflict, &after_rev, txn, pool));
+  SVN_TEST_ASSERT(after_rev == MAX_REV + 1);
+
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, after_rev, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_fs_change_node_prop(txn_root, "A/mu", "p",
+                                  svn_string_create("mu8", pool), pool));
+  SVN_ERR(svn_fs_change_node_prop(txn_root, "A/C", "p",
+                                  svn_string_create("C8", pool), pool));
+
+  /* Prefetching within transactions is a no-op but must not fail. */
+  SVN_ERR(svn_fs__prefetch_dir(txn_root, "A", NULL, pool));
+  SVN_ERR(svn_fs_commit_txn(&conflict, &after_rev, txn, pool));
+  SVN_TEST_ASSERT(after_rev == MAX_REV + 2);
+
+  /* Read everything through a fresh FS object. */
+  SVN_ERR(svn_fs_open(&fs, REPO_NAME, NULL, pool));
+  SVN_ERR(svn_fs_revision_root(&root1, fs, 1, pool));
+  SVN_ERR(svn_fs_revision_root(&root7, fs, MAX_REV + 1, pool));
+  SVN_ERR(svn_fs_revision_root(&root8, fs, MAX_REV + 2, pool));
+
+  /* Only some entries, including unknown ones. */
+  names = apr_array_make(pool, 3, sizeof(const char *));
+  APR_ARRAY_PUSH(names, const char *) = "iota";
+  APR_ARRAY_PUSH(names, const char *) = "A";
+  APR_ARRAY_PUSH(names, const char *) = "no-such-entry";
+  SVN_ERR(svn_fs__prefetch_dir(root7, "/", names, pool));
+  SVN_ERR(svn_fs__prefetch_dir(root1, "/", names, pool));
+
+  /* All entries, twice to hit the cached case. */
+  for (i = 0; i < 2; i++)
+    {
+      SVN_ERR(svn_fs__prefetch_dir(root1, "A", NULL, pool));
+      SVN_ERR(svn_fs__prefetch_dir(root7, "A", NULL, pool));
+      SVN_ERR(svn_fs__prefetch_dir(root8, "A", NULL, pool));
+    }
+
+  /* The property lists must be those of the respective revision, no
+     matter whether they were read ahead, cached or read on demand. */
+  for (i = 0; i < 2; i++)
+    {
+      SVN_ERR(check_node_prop(root1, "iota", NULL, pool));
+      SVN_ERR(check_node_prop(root1, "A/mu", NULL, pool));
+      SVN_ERR(check_node_prop(root7, "iota", "iota7", pool));
+      SVN_ERR(check_node_prop(root7, "A/mu", "mu7", pool));
+      SVN_ERR(check_node_prop(root7, "A/B", "B7", pool));
+      SVN_ERR(check_node_prop(root7, "A/C", NULL, pool));
+      SVN_ERR(check_node_prop(root8, "iota", "iota7", pool));
+      SVN_ERR(check_node_prop(root8, "A/mu", "mu8", pool));
+      SVN_ERR(check_node_prop(root8, "A/B", "B7", pool));
+      SVN_ERR(check_node_prop(root8, "A/C", "C8", pool));
+    }
+
+  /* Node-revisions from packed and non-packed revisions in random order,
+     including duplicates, read through the FSFS function directly. */
+  SVN_ERR(svn_fs_open(&fs, REPO_NAME, NULL, pool));
+  SVN_ERR(svn_fs_revision_root(&root1, fs, 1, pool));
+  SVN_ERR(svn_fs_revision_root(&root8, fs, MAX_REV + 2, pool));
+
+  ids = apr_array_make(pool, 6, sizeof(const svn_fs_id_t *));
+  for (i = 0; i < 2; i++)
+    {
+      const svn_fs_id_t *id;
+
+      SVN_ERR(svn_fs_node_id(&id, root8, "A/C", pool));
+      APR_ARRAY_PUSH(ids, const svn_fs_id_t *) = id;
+      SVN_ERR(svn_fs_node_id(&id, root1, "A/D/G/rho", pool));
+      APR_ARRAY_PUSH(ids, const svn_fs_id_t *) = id;
+      SVN_ERR(svn_fs_node_id(&id, root8, "iota", pool));
+      APR_ARRAY_PUSH(ids, const svn_fs_id_t *) = id;
+    }
+  SVN_ERR(svn_fs_fs__prefetch_node_revisions(fs, ids, TRUE, pool));
+
+  SVN_ERR(check_node_prop(root8, "A/C", "C8", pool));
+  SVN_ERR(check_node_prop(root8, "iota", "iota7", pool));
+  SVN_ERR(check_node_prop(root1, "A/D/G/rho", NULL, pool));
+  SVN_ERR(svn_fs_node_created_rev(&after_rev, root8, "A/C", pool));
+  SVN_TEST_ASSERT(after_rev == MAX_REV + 2);
+  SVN_ERR(svn_fs_node_created_rev(&after_rev, root1, "A/D/G/rho", pool));
+  SVN_TEST_ASSERT(after_rev == 1);
+
+  return SVN_NO_ERROR;
+}
+#undef REPO_NAME
+#undef MAX_REV
+#undef SHARD_SIZE
+
 /* ------------------------------------------------------------------------ */
 
 /* The test table.  */
@@ -755,5 +904,7 @@ struct svn_test_descriptor_t test_funcs[] =
                        "get/set huge packed revprops in FSFS"),
     SVN_TEST_OPTS_PASS(recover_fully_packed,
                        "recover a fully packed filesystem"),
+    SVN_TEST_OPTS_PASS(prefetch_dir_entries,
+                       "prefetch node-revisions and properties"),
     SVN_TEST_NULL
   };
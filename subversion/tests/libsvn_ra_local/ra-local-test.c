@@ -270,6 +270,99 @@ split_url_test(const svn_test_opts_t *opts,
 }
 
 
+/* Baton for get_files_handler(). */
+typedef struct get_files_baton_t
+{
+  /* Contents of the files handled so far (svn_stringbuf_t *). */
+  apr_array_header_t *contents;
+
+  /* Revisions they were fetched from (svn_revnum_t). */
+  apr_array_header_t *revisions;
+} get_files_baton_t;
+
+/* Implements svn_ra_file_handler_t. */
+static svn_error_t *
+get_files_handler(void *baton,
+                  svn_stream_t **stream,
+                  const svn_ra_file_request_t *request,
+                  svn_revnum_t fetched_rev,
+                  apr_hash_t *props,
+                  apr_pool_t *pool)
+{
+  get_files_baton_t *b = baton;
+  svn_stringbuf_t *buf = svn_stringbuf_create_empty(b->contents->pool);
+
+  SVN_TEST_ASSERT(props != NULL);
+
+  APR_ARRAY_PUSH(b->contents, svn_stringbuf_t *) = buf;
+  APR_ARRAY_PUSH(b->revisions, svn_revnum_t) = fetched_rev;
+  *stream = svn_stream_from_stringbuf(buf, pool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Fetch several files from different revisions at once. */
+static svn_error_t *
+get_files(const svn_test_opts_t *opts,
+          apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+  svn_revnum_t youngest_rev;
+  svn_ra_session_t *session;
+  svn_ra_callbacks2_t *cbtable;
+  const char *url;
+  apr_array_header_t *requests;
+  svn_ra_file_request_t iota = { "iota", 1 };
+  svn_ra_file_request_t mu = { "A/mu", SVN_INVALID_REVNUM };
+  svn_ra_file_request_t old_mu = { "A/mu", 1 };
+  get_files_baton_t b;
+
+  /* r1: the greek tree, r2: a change to A/mu. */
+  SVN_ERR(svn_test__create_repos(&repos, "test-repo-get-files", opts,
+                                 pool));
+  SVN_ERR(svn_fs_begin_txn(&txn, svn_repos_fs(repos), 0, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+
+  SVN_ERR(svn_fs_begin_txn(&txn, svn_repos_fs(repos), youngest_rev, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "A/mu", "new mu\n", pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+
+  SVN_ERR(svn_ra_create_callbacks(&cbtable, pool));
+  SVN_ERR(svn_ra_initialize(pool));
+  SVN_ERR(svn_uri_get_file_url_from_dirent(&url, "test-repo-get-files",
+                                           pool));
+  SVN_ERR(svn_ra_open3(&session, url, NULL, cbtable, NULL, NULL, pool));
+
+  requests = apr_array_make(pool, 3, sizeof(const svn_ra_file_request_t *));
+  APR_ARRAY_PUSH(requests, const svn_ra_file_request_t *) = &iota;
+  APR_ARRAY_PUSH(requests, const svn_ra_file_request_t *) = &mu;
+  APR_ARRAY_PUSH(requests, const svn_ra_file_request_t *) = &old_mu;
+
+  b.contents = apr_array_make(pool, 3, sizeof(svn_stringbuf_t *));
+  b.revisions = apr_array_make(pool, 3, sizeof(svn_revnum_t));
+  SVN_ERR(svn_ra_get_files(session, requests, TRUE, TRUE, get_files_handler,
+                           &b, pool));
+
+  SVN_TEST_ASSERT(b.contents->nelts == 3);
+  SVN_TEST_STRING_ASSERT(APR_ARRAY_IDX(b.contents, 0, svn_stringbuf_t *)->data,
+                         "This is the file 'iota'.\n");
+  SVN_TEST_STRING_ASSERT(APR_ARRAY_IDX(b.contents, 1, svn_stringbuf_t *)->data,
+                         "new mu\n");
+  SVN_TEST_STRING_ASSERT(APR_ARRAY_IDX(b.contents, 2, svn_stringbuf_t *)->data,
+                         "This is the file 'mu'.\n");
+  SVN_TEST_ASSERT(APR_ARRAY_IDX(b.revisions, 0, svn_revnum_t) == 1);
+  SVN_TEST_ASSERT(APR_ARRAY_IDX(b.revisions, 1, svn_revnum_t) == 2);
+  SVN_TEST_ASSERT(APR_ARRAY_IDX(b.revisions, 2, svn_revnum_t) == 1);
+
+  return SVN_NO_ERROR;
+}
+
+
 
 /* The test table.  */
 
@@ -294,5 +387,7 @@ struct svn_test_descriptor_t test_funcs[] =
                    "svn_ra_local__split_URL: valid host names"),
     SVN_TEST_OPTS_PASS(split_url_test,
                        "test svn_ra_local__split_URL correctness"),
+    SVN_TEST_OPTS_PASS(get_files,
+                       "fetch several files at once"),
     SVN_TEST_NULL
   };
@@ -0,0 +1,906 @@
+/*
+ * ra-svn-test.c :  tests for the ra_svn protocol marshaling layer
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+
+
+#include <apr_general.h>
+#include <apr_pools.h>
+#include <apr_file_io.h>
+
+#include "svn_pools.h"
+#include "svn_error.h"
+#include "svn_io.h"
+#include "svn_string.h"
+#include "svn_dirent_uri.h"
+#include "svn_config.h"
+#include "svn_auth.h"
+#include "svn_ra.h"
+#include "svn_repos.h"
+#include "svn_ra_svn.h"
+#include "svn_diff.h"
+#include "svn_props.h"
+
+#include "private/svn_ra_private.h"
+
+#include "../../libsvn_ra_svn/ra_svn.h"
+#include "../svn_test.h"
+#include "../svn_test_fs.h"
+
+/*-------------------------------------------------------------------*/
+
+/** Helper routines. **/
+
+/* Return a string of LEN bytes whose contents depend on SEED. */
+static svn_string_t *
+make_string(apr_size_t len, apr_uint32_t seed, apr_pool_t *pool)
+{
+  char *data = apr_palloc(pool, len + 1);
+  apr_size_t i;
+
+  for (i = 0; i < len; ++i)
+    {
+      seed = seed * 1103515245 + 12345;
+      data[i] = (char)(seed >> 16);
+    }
+  data[len] = '\0';
+
+  return svn_string_ncreate(data, len, pool);
+}
+
+/* Return a NUL-free string of LEN bytes whose contents depend on SEED. */
+static const char *
+make_cstring(apr_size_t len, apr_uint32_t seed, apr_pool_t *pool)
+{
+  svn_string_t *str = make_string(len, seed, pool);
+  char *data = (char *)str->data;
+  apr_size_t i;
+
+  for (i = 0; i < len; ++i)
+    data[i] = 'a' + (unsigned char)data[i] % 26;
+
+  return data;
+}
+
+/* Return an error if A and B differ. */
+static svn_error_t *
+check_string(const svn_string_t *a, const svn_string_t *b)
+{
+  if (! svn_string_compare(a, b))
+    return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                             "strings of %" APR_SIZE_T_FMT " and %"
+                             APR_SIZE_T_FMT " bytes differ",
+                             a->len, b->len);
+
+  return SVN_NO_ERROR;
+}
+
+/* Open a connection that writes to a new temporary file in *CONN and
+   return that file's name in *PATH. */
+static svn_error_t *
+open_writer(svn_ra_svn_conn_t **conn,
+            const char **path,
+            apr_pool_t *pool)
+{
+  apr_file_t *file;
+
+  SVN_ERR(svn_io_open_unique_file3(&file, path, NULL,
+                                   svn_io_file_del_on_pool_cleanup,
+                                   pool, pool));
+
+  /* The connection needs an input file as well but won't use it. */
+  *conn = svn_ra_svn_create_conn2(NULL, file, file, 0, pool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Open a connection that reads DATA in *CONN. */
+static svn_error_t *
+open_data_reader(svn_ra_svn_conn_t **conn,
+                 const char *data,
+                 apr_pool_t *pool)
+{
+  apr_file_t *file;
+  const char *path;
+  apr_off_t offset = 0;
+
+  SVN_ERR(svn_io_open_unique_file3(&file, &path, NULL,
+                                   svn_io_file_del_on_pool_cleanup,
+                                   pool, pool));
+  SVN_ERR(svn_io_file_write_full(file, data, strlen(data), NULL, pool));
+  SVN_ERR(svn_io_file_seek(file, APR_SET, &offset, pool));
+  *conn = svn_ra_svn_create_conn2(NULL, file, file, 0, pool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Open a connection that reads from the file at PATH in *CONN. */
+static svn_error_t *
+open_reader(svn_ra_svn_conn_t **conn,
+            const char *path,
+            apr_pool_t *pool)
+{
+  apr_file_t *file;
+
+  SVN_ERR(svn_io_file_open(&file, path, APR_READ, APR_OS_DEFAULT, pool));
+  *conn = svn_ra_svn_create_conn2(NULL, file, file, 0, pool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Baton for the counting stream of open_counting_writer(). */
+typedef struct counting_baton_t
+{
+  int writes;
+  apr_uint64_t bytes;
+} counting_baton_t;
+
+/* Implements svn_read_fn_t.  There is nothing to read. */
+static svn_error_t *
+counting_read_cb(void *baton, char *buffer, apr_size_t *len)
+{
+  *len = 0;
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_write_fn_t.  Swallow all of the data. */
+static svn_error_t *
+counting_write_cb(void *baton, const char *data, apr_size_t *len)
+{
+  counting_baton_t *b = baton;
+
+  b->writes++;
+  b->bytes += *len;
+  return SVN_NO_ERROR;
+}
+
+/* Implements ra_svn_writev_fn_t.  Swallow all of the data. */
+static svn_error_t *
+counting_writev_cb(void *baton, const struct iovec *vec, int nvec,
+                   apr_size_t *len)
+{
+  counting_baton_t *b = baton;
+  int i;
+
+  *len = 0;
+  for (i = 0; i < nvec; ++i)
+    *len += vec[i].iov_len;
+
+  b->writes++;
+  b->bytes += *len;
+  return SVN_NO_ERROR;
+}
+
+/* Implements ra_svn_timeout_fn_t. */
+static void
+counting_timeout_cb(void *baton, apr_interval_time_t interval)
+{
+}
+
+/* Implements ra_svn_pending_fn_t. */
+static svn_boolean_t
+counting_pending_cb(void *baton)
+{
+  return FALSE;
+}
+
+/* Open a connection in *CONN that counts the writes to its stream in
+   BATON but discards the data. */
+static svn_error_t *
+open_counting_writer(svn_ra_svn_conn_t **conn,
+                     counting_baton_t *baton,
+                     apr_pool_t *pool)
+{
+  const char *path;
+
+  SVN_ERR(open_writer(conn, &path, pool));
+
+  baton->writes = 0;
+  baton->bytes = 0;
+  (*conn)->stream = svn_ra_svn__stream_create(baton, counting_read_cb,
+                                              counting_write_cb,
+                                              counting_timeout_cb,
+                                              counting_pending_cb, pool);
+  svn_ra_svn__stream_set_writev((*conn)->stream, counting_writev_cb);
+
+  return SVN_NO_ERROR;
+}
+
+
+/*-------------------------------------------------------------------*/
+
+/** The tests **/
+
+/* Write strings of various sizes, some of them big enough to be sent
+   without copying them into the write buffer, mixed with small items and
+   read everything back. */
+static svn_error_t *
+marshal_large_strings(apr_pool_t *pool)
+{
+  svn_ra_svn_conn_t *writer, *reader;
+  const char *path;
+  apr_size_t sizes[] = { 0, 9, 100, 4095, 4096, 5000, 16383, 16384, 16385,
+                         20000, 100000 };
+  svn_string_t *big[10];
+  svn_string_t *str, *read_str;
+  svn_string_t *read_big[10];
+  const char *cstr, *read_cstr;
+  apr_uint64_t number, bytes_read, bytes_written;
+  apr_finfo_t finfo;
+  apr_size_t i;
+  int k;
+
+  SVN_ERR(open_writer(&writer, &path, pool));
+
+  /* Individual strings, each followed by a small tuple. */
+  for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i)
+    {
+      str = make_string(sizes[i], (apr_uint32_t)i, pool);
+      SVN_ERR(svn_ra_svn_write_string(writer, pool, str));
+      SVN_ERR(svn_ra_svn_write_tuple(writer, pool, "n", (apr_uint64_t)i));
+    }
+
+  /* A command with large strings inside nested lists. */
+  SVN_ERR(svn_ra_svn_write_cmd(writer, pool, "test-cmd", "s(c)s",
+                               make_string(30000, 100, pool),
+                               make_cstring(7000, 101, pool),
+                               make_string(3, 102, pool)));
+
+  /* More large strings in a single tuple than can be referenced at once. */
+  for (k = 0; k < 10; ++k)
+    big[k] = make_string(4096 + 1000 * k, 200 + k, pool);
+  SVN_ERR(svn_ra_svn_write_cmd_response(writer, pool, "ssssssssss",
+                                        big[0], big[1], big[2], big[3],
+                                        big[4], big[5], big[6], big[7],
+                                        big[8], big[9]));
+  SVN_ERR(svn_ra_svn_flush(writer, pool));
+
+  /* The protocol layer must have accounted for every byte. */
+  svn_ra_svn__get_transfer_counts(&bytes_read, &bytes_written, writer);
+  SVN_ERR(svn_io_stat(&finfo, path, APR_FINFO_SIZE, pool));
+  SVN_TEST_ASSERT(bytes_written == (apr_uint64_t)finfo.size);
+
+  /* Now read it all back. */
+  SVN_ERR(open_reader(&reader, path, pool));
+
+  for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i)
+    {
+      svn_ra_svn_item_t *item;
+
+      SVN_ERR(svn_ra_svn_read_item(reader, pool, &item));
+      SVN_TEST_ASSERT(item->kind == SVN_RA_SVN_STRING);
+      SVN_ERR(check_string(item->u.string,
+                           make_string(sizes[i], (apr_uint32_t)i, pool)));
+
+      SVN_ERR(svn_ra_svn_read_tuple(reader, pool, "n", &number));
+      SVN_TEST_ASSERT(number == i);
+    }
+
+  SVN_ERR(svn_ra_svn_read_tuple(reader, pool, "w(s(c)s)", &cstr, &str,
+                                &read_cstr, &read_str));
+  SVN_TEST_STRING_ASSERT(cstr, "test-cmd");
+  SVN_ERR(check_string(str, make_string(30000, 100, pool)));
+  SVN_TEST_STRING_ASSERT(read_cstr, make_cstring(7000, 101, pool));
+  SVN_ERR(check_string(read_str, make_string(3, 102, pool)));
+
+  SVN_ERR(svn_ra_svn_read_cmd_response(reader, pool, "ssssssssss",
+                                       &read_big[0], &read_big[1],
+                                       &read_big[2], &read_big[3],
+                                       &read_big[4], &read_big[5],
+                                       &read_big[6], &read_big[7],
+                                       &read_big[8], &read_big[9]));
+  for (k = 0; k < 10; ++k)
+    SVN_ERR(check_string(read_big[k], big[k]));
+
+  return SVN_NO_ERROR;
+}
+
+/* Write a run of strings of the size that get-file sends its contents
+   in.  They must get combined in the write buffer rather than each going
+   out in a write of its own. */
+static svn_error_t *
+batch_file_chunks(apr_pool_t *pool)
+{
+  svn_ra_svn_conn_t *writer;
+  counting_baton_t counts;
+  svn_string_t *chunk = make_string(4096, 42, pool);
+  apr_uint64_t bytes_read, bytes_written;
+  int i;
+
+  SVN_ERR(open_counting_writer(&writer, &counts, pool));
+
+  for (i = 0; i < 64; ++i)
+    SVN_ERR(svn_ra_svn_write_string(writer, pool, chunk));
+  SVN_ERR(svn_ra_svn_flush(writer, pool));
+
+  svn_ra_svn__get_transfer_counts(&bytes_read, &bytes_written, writer);
+  SVN_TEST_ASSERT(counts.bytes == bytes_written);
+
+  /* Every write but the last one fills at least most of the buffer. */
+  SVN_TEST_ASSERT(counts.writes
+                  <= (int)(counts.bytes / (SVN_RA_SVN__WRITEBUF_SIZE
+                                           - SVN_RA_SVN__WRITE_REF_THRESHOLD))
+                     + 1);
+
+  return SVN_NO_ERROR;
+}
+
+/* Switch to a compressed stream in the middle of the data, the way the
+   handshake does, and read everything back. */
+static svn_error_t *
+compressed_stream(apr_pool_t *pool)
+{
+  svn_ra_svn_conn_t *writer, *reader;
+  const char *path;
+  svn_stringbuf_t *repetitive = svn_stringbuf_create_empty(pool);
+  svn_string_t *text;
+  svn_ra_svn_item_t *item;
+  const char *word;
+  apr_uint64_t number, bytes_read, bytes_written;
+  apr_finfo_t finfo;
+  int i;
+
+  for (i = 0; i < 10000; ++i)
+    svn_stringbuf_appendcstr(repetitive, "svn:mergeinfo /trunk:1-42\n");
+  text = svn_string_ncreate(repetitive->data, repetitive->len, pool);
+
+  SVN_ERR(open_writer(&writer, &path, pool));
+  SVN_TEST_ASSERT(! svn_ra_svn__stream_compression_enabled(writer));
+
+  SVN_ERR(svn_ra_svn_write_tuple(writer, pool, "nw", (apr_uint64_t)2,
+                                 "plain"));
+  SVN_ERR(svn_ra_svn__enable_stream_compression(writer, pool));
+  SVN_TEST_ASSERT(svn_ra_svn__stream_compression_enabled(writer));
+
+  for (i = 0; i < 20; ++i)
+    {
+      SVN_ERR(svn_ra_svn_write_tuple(writer, pool, "nw", (apr_uint64_t)i,
+                                     "compressed"));
+      SVN_ERR(svn_ra_svn_write_string(writer, pool,
+                                      make_string(i * 1000, i, pool)));
+    }
+  SVN_ERR(svn_ra_svn_write_string(writer, pool, text));
+  SVN_ERR(svn_ra_svn_flush(writer, pool));
+
+  /* Byte counts refer to the uncompressed protocol data. */
+  svn_ra_svn__get_transfer_counts(&bytes_read, &bytes_written, writer);
+  SVN_ERR(svn_io_stat(&finfo, path, APR_FINFO_SIZE, pool));
+  SVN_TEST_ASSERT((apr_uint64_t)finfo.size + text->len / 2 < bytes_written);
+
+  /* Reading the plain part fills the read buffer with compressed data
+     that must not get lost. */
+  SVN_ERR(open_reader(&reader, path, pool));
+  SVN_ERR(svn_ra_svn_read_tuple(reader, pool, "nw", &number, &word));
+  SVN_TEST_ASSERT(number == 2);
+  SVN_TEST_STRING_ASSERT(word, "plain");
+  SVN_ERR(svn_ra_svn__enable_stream_compression(reader, pool));
+
+  for (i = 0; i < 20; ++i)
+    {
+      SVN_ERR(svn_ra_svn_read_tuple(reader, pool, "nw", &number, &word));
+      SVN_TEST_ASSERT(number == i);
+      SVN_TEST_STRING_ASSERT(word, "compressed");
+
+      SVN_ERR(svn_ra_svn_read_item(reader, pool, &item));
+      SVN_TEST_ASSERT(item->kind == SVN_RA_SVN_STRING);
+      SVN_ERR(check_string(item->u.string, make_string(i * 1000, i, pool)));
+    }
+
+  SVN_ERR(svn_ra_svn_read_item(reader, pool, &item));
+  SVN_TEST_ASSERT(item->kind == SVN_RA_SVN_STRING);
+  SVN_ERR(check_string(item->u.string, text));
+
+  return SVN_NO_ERROR;
+}
+
+/* Read strings of various sizes through streams, and lists item by item
+   with trailing items being skipped. */
+static svn_error_t *
+read_strings_to_stream(apr_pool_t *pool)
+{
+  svn_ra_svn_conn_t *writer, *reader;
+  const char *path;
+  apr_size_t sizes[] = { 0, 1, 100, 16383, 16384, 16385, 50000, 200000 };
+  svn_stringbuf_t *buf;
+  svn_stream_t *stream;
+  svn_ra_svn_item_t *item;
+  apr_uint64_t len;
+  apr_size_t i;
+
+  SVN_ERR(open_writer(&writer, &path, pool));
+  for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i)
+    SVN_ERR(svn_ra_svn_write_tuple(writer, pool, "w(sn)", "chunk",
+                                   make_string(sizes[i], (apr_uint32_t)i,
+                                               pool),
+                                   (apr_uint64_t)i));
+  SVN_ERR(svn_ra_svn_write_tuple(writer, pool, "s", make_string(7, 7, pool)));
+  SVN_ERR(svn_ra_svn_write_tuple(writer, pool, "w", "done"));
+  SVN_ERR(svn_ra_svn_flush(writer, pool));
+
+  SVN_ERR(open_reader(&reader, path, pool));
+  for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i)
+    {
+      SVN_ERR(svn_ra_svn__read_list_start(reader, pool));
+      SVN_ERR(svn_ra_svn_read_item(reader, pool, &item));
+      SVN_TEST_ASSERT(item->kind == SVN_RA_SVN_WORD);
+      SVN_TEST_STRING_ASSERT(item->u.word, "chunk");
+
+      /* The string data. */
+      SVN_ERR(svn_ra_svn__read_list_start(reader, pool));
+      buf = svn_stringbuf_create_empty(pool);
+      stream = svn_stream_from_stringbuf(buf, pool);
+      SVN_ERR(svn_ra_svn__read_string_to_stream(reader, pool, stream, &len));
+      SVN_TEST_ASSERT(len == sizes[i]);
+      SVN_ERR(check_string(svn_string_ncreate(buf->data, buf->len, pool),
+                           make_string(sizes[i], (apr_uint32_t)i, pool)));
+
+      /* The number gets skipped, then the command ends. */
+      SVN_ERR(svn_ra_svn__read_list_end(reader, pool));
+      SVN_ERR(svn_ra_svn__read_list_end(reader, pool));
+    }
+
+  /* Strings can be discarded, too. */
+  SVN_ERR(svn_ra_svn__read_list_start(reader, pool));
+  SVN_ERR(svn_ra_svn__read_string_to_stream(reader, pool, NULL, &len));
+  SVN_TEST_ASSERT(len == 7);
+  SVN_ERR(svn_ra_svn__read_list_end(reader, pool));
+
+  /* A word where a string is expected is an error. */
+  SVN_ERR(svn_ra_svn__read_list_start(reader, pool));
+  SVN_TEST_ASSERT_ERROR(svn_ra_svn__read_string_to_stream(reader, pool,
+                                                          NULL, &len),
+                        SVN_ERR_RA_SVN_MALFORMED_DATA);
+
+  return SVN_NO_ERROR;
+}
+
+/* Feed well-formed and malformed data to the item parser. */
+static svn_error_t *
+parse_items(apr_pool_t *pool)
+{
+  struct
+  {
+    const char *data;
+    apr_status_t expected;
+  } inputs[] = {
+    { "( word 3:abc 42 ( ) ) ", APR_SUCCESS },
+    { "0: ", APR_SUCCESS },
+    { "18446744073709551615 ", APR_SUCCESS },
+    { "18446744073709551616 ", SVN_ERR_RA_SVN_MALFORMED_DATA },
+    { "( a) ", SVN_ERR_RA_SVN_MALFORMED_DATA },
+    { "#x ", SVN_ERR_RA_SVN_MALFORMED_DATA },
+    { "3:abc) ", SVN_ERR_RA_SVN_MALFORMED_DATA },
+    { "5:abc", SVN_ERR_RA_SVN_CONNECTION_CLOSED },
+    { "( 1 2 ", SVN_ERR_RA_SVN_CONNECTION_CLOSED },
+    { "", SVN_ERR_RA_SVN_CONNECTION_CLOSED }
+  };
+  svn_stringbuf_t *nested = svn_stringbuf_create_empty(pool);
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_ra_svn_conn_t *conn;
+  svn_ra_svn_item_t *item;
+  apr_size_t i;
+
+  for (i = 0; i < sizeof(inputs) / sizeof(inputs[0]); ++i)
+    {
+      svn_error_t *err;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(open_data_reader(&conn, inputs[i].data, iterpool));
+      err = svn_ra_svn_read_item(conn, iterpool, &item);
+      if ((err ? err->apr_err : APR_SUCCESS) != inputs[i].expected)
+        return svn_error_createf(SVN_ERR_TEST_FAILED, err,
+                                 "unexpected result for input '%s'",
+                                 inputs[i].data);
+      svn_error_clear(err);
+    }
+
+  /* Nesting is limited. */
+  for (i = 0; i < 100; ++i)
+    svn_stringbuf_appendcstr(nested, "( ");
+  for (i = 0; i < 100; ++i)
+    svn_stringbuf_appendcstr(nested, ") ");
+  SVN_ERR(open_data_reader(&conn, nested->data, iterpool));
+  SVN_TEST_ASSERT_ERROR(svn_ra_svn_read_item(conn, iterpool, &item),
+                        SVN_ERR_RA_SVN_MALFORMED_DATA);
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Parse tuples with matching, optional and mismatching formats. */
+static svn_error_t *
+parse_tuples(apr_pool_t *pool)
+{
+  svn_ra_svn_conn_t *conn;
+  svn_ra_svn_item_t *item;
+  apr_uint64_t number, optional;
+  svn_revnum_t rev;
+  const char *cstr, *word;
+  svn_string_t *str;
+  svn_boolean_t flag;
+
+  SVN_ERR(open_data_reader(&conn, "( 7 2:ab word ( 3 ) true ) ", pool));
+  SVN_ERR(svn_ra_svn_read_item(conn, pool, &item));
+  SVN_TEST_ASSERT(item->kind == SVN_RA_SVN_LIST);
+
+  SVN_ERR(svn_ra_svn_parse_tuple(item->u.list, pool, "ncw(r)b", &number,
+                                 &cstr, &word, &rev, &flag));
+  SVN_TEST_ASSERT(number == 7);
+  SVN_TEST_STRING_ASSERT(cstr, "ab");
+  SVN_TEST_STRING_ASSERT(word, "word");
+  SVN_TEST_ASSERT(rev == 3);
+  SVN_TEST_ASSERT(flag);
+
+  /* Missing optional items get default values, extra items are ignored. */
+  SVN_ERR(svn_ra_svn_parse_tuple(item->u.list, pool, "ns?w(n)b?n",
+                                 &number, &str, &word, &number, &flag,
+                                 &optional));
+  SVN_TEST_ASSERT(optional == SVN_RA_SVN_UNSPECIFIED_NUMBER);
+  SVN_ERR(svn_ra_svn_parse_tuple(item->u.list, pool, "ncw(n)b?r",
+                                 &number, &cstr, &word, &number, &flag,
+                                 &rev));
+  SVN_TEST_ASSERT(rev == SVN_INVALID_REVNUM);
+  SVN_ERR(svn_ra_svn_parse_tuple(item->u.list, pool, "n", &number));
+
+  /* Type mismatches and missing mandatory items are errors. */
+  SVN_TEST_ASSERT_ERROR(svn_ra_svn_parse_tuple(item->u.list, pool, "nn",
+                                               &number, &optional),
+                        SVN_ERR_RA_SVN_MALFORMED_DATA);
+  SVN_TEST_ASSERT_ERROR(svn_ra_svn_parse_tuple(item->u.list, pool,
+                                               "ncw(n)bn", &number, &cstr,
+                                               &word, &number, &flag,
+                                               &optional),
+                        SVN_ERR_RA_SVN_MALFORMED_DATA);
+
+  return SVN_NO_ERROR;
+}
+
+/* Baton for get_files_handler(). */
+typedef struct get_files_baton_t
+{
+  /* Contents of the files handled so far (svn_stringbuf_t *). */
+  apr_array_header_t *contents;
+
+  /* Revisions they were fetched from (svn_revnum_t). */
+  apr_array_header_t *revisions;
+} get_files_baton_t;
+
+/* Implements svn_ra_file_handler_t. */
+static svn_error_t *
+get_files_handler(void *baton,
+                  svn_stream_t **stream,
+                  const svn_ra_file_request_t *request,
+                  svn_revnum_t fetched_rev,
+                  apr_hash_t *props,
+                  apr_pool_t *pool)
+{
+  get_files_baton_t *b = baton;
+  svn_stringbuf_t *buf = svn_stringbuf_create_empty(b->contents->pool);
+
+  SVN_TEST_ASSERT(props != NULL);
+
+  APR_ARRAY_PUSH(b->contents, svn_stringbuf_t *) = buf;
+  APR_ARRAY_PUSH(b->revisions, svn_revnum_t) = fetched_rev;
+  *stream = svn_stream_from_stringbuf(buf, pool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Open *SESSION to the repository NAME in the current directory, served
+   by the svnserve of this build through a tunnel, and return the
+   repository in *REPOS.  Set up svnserve to deny all access to A/B.
+   Skip the test where that's not possible. */
+static svn_error_t *
+open_tunneled_session(svn_ra_session_t **session,
+                      svn_repos_t **repos,
+                      const char *name,
+                      const svn_test_opts_t *opts,
+                      apr_pool_t *pool)
+{
+  const char *svnserve, *root, *conf_dir, *url;
+  svn_node_kind_t kind;
+  svn_config_t *cfg;
+  apr_hash_t *config;
+  svn_ra_callbacks2_t *cbtable;
+
+  SVN_ERR(svn_dirent_get_absolute(&svnserve, "../../svnserve/svnserve",
+                                  pool));
+  SVN_ERR(svn_io_check_path(svnserve, &kind, pool));
+  if (kind != svn_node_file)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "svnserve has not been built");
+  SVN_ERR(svn_dirent_get_absolute(&root, "", pool));
+
+  SVN_ERR(svn_test__create_repos(repos, name, opts, pool));
+  conf_dir = svn_dirent_join(svn_repos_path(*repos, pool), "conf", pool);
+  SVN_ERR(svn_io_file_create(svn_dirent_join(conf_dir, "svnserve.conf",
+                                             pool),
+                             "[general]\n"
+                             "authz-db = authz\n",
+                             pool));
+  SVN_ERR(svn_io_file_create(svn_dirent_join(conf_dir, "authz", pool),
+                             "[/]\n"
+                             "* = rw\n"
+                             "[/A/B]\n"
+                             "* =\n",
+                             pool));
+
+  /* The client appends the host name, "svnserve" and "-t" to the tunnel
+     command, which the shell ignores. */
+  SVN_ERR(svn_config_create(&cfg, FALSE, pool));
+  svn_config_set(cfg, SVN_CONFIG_SECTION_TUNNELS, "test",
+                 apr_psprintf(pool, "sh -c 'exec $0 -t -r $1' %s %s",
+                              svnserve, root));
+  config = apr_hash_make(pool);
+  apr_hash_set(config, SVN_CONFIG_CATEGORY_CONFIG, APR_HASH_KEY_STRING, cfg);
+
+  SVN_ERR(svn_ra_initialize(pool));
+  SVN_ERR(svn_ra_create_callbacks(&cbtable, pool));
+  svn_auth_open(&cbtable->auth_baton,
+                apr_array_make(pool, 0, sizeof(svn_auth_provider_object_t *)),
+                pool);
+  url = apr_pstrcat(pool, "svn+test://localhost/", name, (char *)NULL);
+
+  return svn_error_trace(svn_ra_open4(session, NULL, url, NULL, cbtable,
+                                      NULL, config, pool));
+}
+
+/* Fetch several files at once through get-files. */
+static svn_error_t *
+get_files(const svn_test_opts_t *opts,
+          apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+  svn_revnum_t youngest_rev;
+  svn_ra_session_t *session;
+  apr_array_header_t *requests;
+  svn_ra_file_request_t iota = { "iota", 1 };
+  svn_ra_file_request_t mu = { "A/mu", SVN_INVALID_REVNUM };
+  svn_ra_file_request_t old_mu = { "A/mu", 1 };
+  svn_ra_file_request_t lambda = { "A/B/lambda", 1 };
+  svn_ra_file_request_t missing = { "A/missing", 1 };
+  get_files_baton_t b;
+
+  SVN_ERR(open_tunneled_session(&session, &repos, "test-repo-get-files",
+                                opts, pool));
+
+  /* r1: the greek tree, r2: a change to A/mu. */
+  SVN_ERR(svn_fs_begin_txn(&txn, svn_repos_fs(repos), 0, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+
+  SVN_ERR(svn_fs_begin_txn(&txn, svn_repos_fs(repos), youngest_rev, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "A/mu", "new mu\n", pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+
+  requests = apr_array_make(pool, 3, sizeof(const svn_ra_file_request_t *));
+  APR_ARRAY_PUSH(requests, const svn_ra_file_request_t *) = &iota;
+  APR_ARRAY_PUSH(requests, const svn_ra_file_request_t *) = &mu;
+  APR_ARRAY_PUSH(requests, const svn_ra_file_request_t *) = &old_mu;
+
+  b.contents = apr_array_make(pool, 3, sizeof(svn_stringbuf_t *));
+  b.revisions = apr_array_make(pool, 3, sizeof(svn_revnum_t));
+  SVN_ERR(svn_ra_get_files(session, requests, TRUE, TRUE, get_files_handler,
+                           &b, pool));
+
+  SVN_TEST_ASSERT(b.contents->nelts == 3);
+  SVN_TEST_STRING_ASSERT(APR_ARRAY_IDX(b.contents, 0, svn_stringbuf_t *)->data,
+                         "This is the file 'iota'.\n");
+  SVN_TEST_STRING_ASSERT(APR_ARRAY_IDX(b.contents, 1, svn_stringbuf_t *)->data,
+                         "new mu\n");
+  SVN_TEST_STRING_ASSERT(APR_ARRAY_IDX(b.contents, 2, svn_stringbuf_t *)->data,
+                         "This is the file 'mu'.\n");
+  SVN_TEST_ASSERT(APR_ARRAY_IDX(b.revisions, 0, svn_revnum_t) == 1);
+  SVN_TEST_ASSERT(APR_ARRAY_IDX(b.revisions, 1, svn_revnum_t) == 2);
+  SVN_TEST_ASSERT(APR_ARRAY_IDX(b.revisions, 2, svn_revnum_t) == 1);
+
+  /* A file that may not be read ends the response after the files before
+     it, and the session remains usable. */
+  apr_array_clear(requests);
+  APR_ARRAY_PUSH(requests, const svn_ra_file_request_t *) = &iota;
+  APR_ARRAY_PUSH(requests, const svn_ra_file_request_t *) = &lambda;
+  APR_ARRAY_PUSH(requests, const svn_ra_file_request_t *) = &mu;
+  apr_array_clear(b.contents);
+  apr_array_clear(b.revisions);
+  SVN_TEST_ASSERT_ERROR(svn_ra_get_files(session, requests, TRUE, TRUE,
+                                         get_files_handler, &b, pool),
+                        SVN_ERR_RA_NOT_AUTHORIZED);
+  SVN_TEST_ASSERT(b.contents->nelts == 1);
+  SVN_TEST_STRING_ASSERT(APR_ARRAY_IDX(b.contents, 0, svn_stringbuf_t *)->data,
+                         "This is the file 'iota'.\n");
+
+  /* Likewise for a file that doesn't exist. */
+  apr_array_clear(requests);
+  APR_ARRAY_PUSH(requests, const svn_ra_file_request_t *) = &missing;
+  apr_array_clear(b.contents);
+  SVN_TEST_ASSERT_ERROR(svn_ra_get_files(session, requests, TRUE, TRUE,
+                                         get_files_handler, &b, pool),
+                        SVN_ERR_FS_NOT_FOUND);
+  SVN_TEST_ASSERT(b.contents->nelts == 0);
+
+  SVN_ERR(svn_ra_get_latest_revnum(session, &youngest_rev, pool));
+  SVN_TEST_ASSERT(youngest_rev == 2);
+
+  return SVN_NO_ERROR;
+}
+
+/* Baton for blame_receiver(). */
+typedef struct blame_baton_t
+{
+  /* The start lines (apr_int64_t) and revisions (svn_revnum_t) of the
+     chunks received so far. */
+  apr_array_header_t *start_lines;
+  apr_array_header_t *revisions;
+} blame_baton_t;
+
+/* Implements svn_ra__blame_receiver_t. */
+static svn_error_t *
+blame_receiver(void *baton,
+               apr_int64_t start_line,
+               svn_revnum_t revision,
+               apr_hash_t *rev_props,
+               apr_pool_t *pool)
+{
+  blame_baton_t *b = baton;
+
+  if (SVN_IS_VALID_REVNUM(revision))
+    SVN_TEST_ASSERT(rev_props != NULL
+                    && apr_hash_get(rev_props, SVN_PROP_REVISION_DATE,
+                                    APR_HASH_KEY_STRING) != NULL);
+  else
+    SVN_TEST_ASSERT(rev_props == NULL);
+
+  APR_ARRAY_PUSH(b->start_lines, apr_int64_t) = start_line;
+  APR_ARRAY_PUSH(b->revisions, svn_revnum_t) = revision;
+
+  return SVN_NO_ERROR;
+}
+
+/* Check that BATON has received exactly the chunks starting at the lines
+   EXPECTED_LINES and changed in EXPECTED_REVS, each with NUM_CHUNKS
+   elements. */
+static svn_error_t *
+check_blame(const blame_baton_t *b,
+            const apr_int64_t *expected_lines,
+            const svn_revnum_t *expected_revs,
+            int num_chunks)
+{
+  int i;
+
+  SVN_TEST_ASSERT(b->start_lines->nelts == num_chunks);
+  for (i = 0; i < num_chunks; i++)
+    {
+      SVN_TEST_ASSERT(APR_ARRAY_IDX(b->start_lines, i, apr_int64_t)
+                      == expected_lines[i]);
+      SVN_TEST_ASSERT(APR_ARRAY_IDX(b->revisions, i, svn_revnum_t)
+                      == expected_revs[i]);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Let svnserve compute the blame of a file. */
+static svn_error_t *
+get_file_blame(const svn_test_opts_t *opts,
+               apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+  svn_revnum_t youngest_rev;
+  svn_ra_session_t *session;
+  svn_diff_file_options_t *diff_options
+    = svn_diff_file_options_create(pool);
+  static const apr_int64_t expected_lines[] = { 0, 1, 2 };
+  static const svn_revnum_t expected_revs[] = { 3, 1, 2 };
+  static const svn_revnum_t expected_revs_from_2[] = { 3, SVN_INVALID_REVNUM,
+                                                       2 };
+  blame_baton_t b;
+
+  SVN_ERR(open_tunneled_session(&session, &repos, "test-repo-get-file-blame",
+                                opts, pool));
+
+  /* r1: the greek tree, r2: append a line to iota, r3: prepend one. */
+  SVN_ERR(svn_fs_begin_txn(&txn, svn_repos_fs(repos), 0, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+
+  SVN_ERR(svn_fs_begin_txn(&txn, svn_repos_fs(repos), youngest_rev, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "iota",
+                                      "This is the file 'iota'.\n"
+                                      "second\n", pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+
+  SVN_ERR(svn_fs_begin_txn(&txn, svn_repos_fs(repos), youngest_rev, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "iota",
+                                      "first\n"
+                                      "This is the file 'iota'.\n"
+                                      "second\n", pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+
+  b.start_lines = apr_array_make(pool, 3, sizeof(apr_int64_t));
+  b.revisions = apr_array_make(pool, 3, sizeof(svn_revnum_t));
+  SVN_ERR(svn_ra__get_file_blame(session, "iota", 1, 3, diff_options, FALSE,
+                                 blame_receiver, &b, pool));
+  SVN_ERR(check_blame(&b, expected_lines, expected_revs, 3));
+
+  /* Lines older than the start of the range don't get attributed. */
+  apr_array_clear(b.start_lines);
+  apr_array_clear(b.revisions);
+  SVN_ERR(svn_ra__get_file_blame(session, "iota", 2, 3, diff_options, FALSE,
+                                 blame_receiver, &b, pool));
+  SVN_ERR(check_blame(&b, expected_lines, expected_revs_from_2, 3));
+
+  /* Errors leave the session usable. */
+  apr_array_clear(b.start_lines);
+  apr_array_clear(b.revisions);
+  SVN_TEST_ASSERT_ERROR(svn_ra__get_file_blame(session, "A", 1, 3,
+                                               diff_options, FALSE,
+                                               blame_receiver, &b, pool),
+                        SVN_ERR_FS_NOT_FILE);
+  SVN_TEST_ASSERT(b.start_lines->nelts == 0);
+
+  SVN_ERR(svn_ra_get_latest_revnum(session, &youngest_rev, pool));
+  SVN_TEST_ASSERT(youngest_rev == 3);
+
+  return SVN_NO_ERROR;
+}
+
+
+/* The test table.  */
+
+/* The tunnel to svnserve is set up with a POSIX shell. */
+#if defined(WIN32)
+#define HAS_POSIX_SHELL 0
+#else
+#define HAS_POSIX_SHELL 1
+#endif
+
+struct svn_test_descriptor_t test_funcs[] =
+  {
+    SVN_TEST_NULL,
+    SVN_TEST_PASS2(marshal_large_strings,
+                   "marshal strings of various sizes"),
+    SVN_TEST_PASS2(batch_file_chunks,
+                   "combine file chunks into buffer-sized writes"),
+    SVN_TEST_PASS2(compressed_stream,
+                   "switch to a compressed stream"),
+    SVN_TEST_PASS2(read_strings_to_stream,
+                   "read strings through streams"),
+    SVN_TEST_PASS2(parse_items,
+                   "parse well-formed and malformed items"),
+    SVN_TEST_PASS2(parse_tuples,
+                   "parse tuples with various formats"),
+    SVN_TEST_OPTS_SKIP(get_files, ! HAS_POSIX_SHELL,
+                       "fetch several files through svnserve"),
+    SVN_TEST_OPTS_SKIP(get_file_blame, ! HAS_POSIX_SHELL,
+                       "let svnserve compute the blame of a file"),
+    SVN_TEST_NULL
+  };
@@ -34,8 +34,13 @@
 #include "svn_delta.h"
 #include "svn_config.h"
 #include "svn_props.h"
+#include "svn_sorts.h"
+#include "svn_dirent_uri.h"
 
 #include "../svn_test_fs.h"
+#include "private/svn_fspath.h"
+#include "private/svn_repos_private.h"
+#include "../../libsvn_repos/repos.h"
 
 #include "dir-delta-editor.h"
 
@@ -1327,6 +1332,189 @@ authz(apr_pool_t *pool)
 }
 
 
+/* Test nested groups, aliases and inversion in authz rules as well as
+   sharing authz files between readers. */
+static svn_error_t *
+authz_groups_and_sharing(apr_pool_t *pool)
+{
+  const char *contents;
+  const char *authz_file_path;
+  svn_authz_t *authz_cfg, *shared1, *shared2;
+  svn_boolean_t access_granted;
+  apr_pool_t *pool1 = svn_pool_create(pool);
+  apr_pool_t *pool2 = svn_pool_create(pool);
+  int i;
+  struct
+  {
+    const char *path;
+    const char *user;
+    const svn_repos_authz_access_t required;
+    const svn_boolean_t expected;
+  } test_set[] = {
+    /* Members of subgroups and aliases are group members. */
+    { "/trunk", "plato", svn_authz_write, TRUE },
+    { "/trunk", "socrates", svn_authz_write, TRUE },
+    { "/trunk", "aristotle", svn_authz_write, TRUE },
+    /* Group names are case-insensitive. */
+    { "/trunk", "zeno", svn_authz_write, TRUE },
+    { "/trunk", "diogenes", svn_authz_write, FALSE },
+    { "/trunk", "diogenes", svn_authz_read, TRUE },
+    { "/trunk", NULL, svn_authz_read, FALSE },
+    /* Inverted rules. */
+    { "/trunk/secret", "plato", svn_authz_read, FALSE },
+    { "/trunk/secret", "diogenes", svn_authz_read, TRUE },
+    { "/trunk/secret/deeper", "zeno", svn_authz_read, FALSE },
+    { "/trunk", "plato", svn_authz_read | svn_authz_recursive, FALSE },
+    { "/trunk", "diogenes", svn_authz_read | svn_authz_recursive, TRUE },
+    /* Sections that share a prefix with the path don't apply. */
+    { "/trunk/secretive", "plato", svn_authz_read, TRUE },
+    /* Sentinel */
+    { NULL, NULL, svn_authz_none, FALSE }
+  };
+
+  contents =
+    "[aliases]"                                                              NL
+    "stagirite = aristotle"                                                  NL
+    ""                                                                       NL
+    "[groups]"                                                               NL
+    "academy = plato,@lyceum"                                                NL
+    "lyceum = &stagirite,@Stoa"                                              NL
+    "stoa = zeno"                                                            NL
+    "agora = socrates,@academy"                                              NL
+    ""                                                                       NL
+    "[/trunk]"                                                               NL
+    "@agora = rw"                                                            NL
+    "$authenticated = r"                                                     NL
+    ""                                                                       NL
+    "[/trunk/secret]"                                                        NL
+    "~@academy = r"                                                          NL
+    "@academy ="                                                             NL;
+
+  SVN_ERR(authz_get_handle(&authz_cfg, contents, pool1));
+
+  for (i = 0; test_set[i].path; i++)
+    {
+      SVN_ERR(svn_repos_authz_check_access(authz_cfg, "greek",
+                                           test_set[i].path,
+                                           test_set[i].user,
+                                           test_set[i].required,
+                                           &access_granted, pool1));
+      if (access_granted != test_set[i].expected)
+        return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                                 "Authz incorrectly %s access to %s "
+                                 "for user %s",
+                                 access_granted ? "grants" : "denies",
+                                 test_set[i].path,
+                                 test_set[i].user ? test_set[i].user : "-");
+    }
+
+  /* Readers of the same file share the compiled authz, once the file
+     is older than the resolution of its timestamp. */
+  SVN_ERR(svn_io_write_unique(&authz_file_path, NULL,
+                              contents, strlen(contents),
+                              svn_io_file_del_on_pool_cleanup, pool));
+  SVN_ERR(svn_io_set_file_affected_time(apr_time_now()
+                                          - apr_time_from_sec(10),
+                                        authz_file_path, pool));
+  SVN_ERR(svn_repos__authz_read_shared(&shared1, authz_file_path, TRUE,
+                                       pool1, pool));
+  SVN_ERR(svn_repos__authz_read_shared(&shared2, authz_file_path, TRUE,
+                                       pool2, pool));
+  SVN_TEST_ASSERT(shared1 == shared2);
+
+  /* Until the file gets modified. */
+  SVN_ERR(svn_io_remove_file2(authz_file_path, FALSE, pool));
+  SVN_ERR(svn_io_file_create(authz_file_path,
+                             "[/]"                                           NL
+                             "* = rw"                                        NL,
+                             pool));
+  SVN_ERR(svn_repos__authz_read_shared(&shared2, authz_file_path, TRUE,
+                                       pool2, pool));
+  SVN_TEST_ASSERT(shared1 != shared2);
+  SVN_ERR(svn_repos_authz_check_access(shared2, "greek", "/trunk", NULL,
+                                       svn_authz_write, &access_granted,
+                                       pool2));
+  SVN_TEST_ASSERT(access_granted);
+
+  /* The old version remains usable while it is referenced. */
+  SVN_ERR(svn_repos_authz_check_access(shared1, "greek", "/trunk", NULL,
+                                       svn_authz_write, &access_granted,
+                                       pool1));
+  SVN_TEST_ASSERT(!access_granted);
+
+  svn_pool_destroy(pool1);
+  svn_pool_destroy(pool2);
+  return SVN_NO_ERROR;
+}
+
+/* Test that authz check results are cached and shared between paths
+   that inherit their access from the same rules. */
+static svn_error_t *
+authz_cache(apr_pool_t *pool)
+{
+  svn_authz_t *authz_cfg;
+  svn_boolean_t access_granted;
+  svn_repos__authz_counters_t counters = { 0 };
+  const char *contents =
+    "[/]"                                                                    NL
+    "* = r"                                                                  NL
+    ""                                                                       NL
+    "[greek:/A/B]"                                                           NL
+    "plato = rw"                                                             NL
+    "* ="                                                                    NL;
+
+  SVN_ERR(authz_get_handle(&authz_cfg, contents, pool));
+
+  /* Paths below /A/B share their result. */
+  SVN_ERR(svn_repos__authz_check_access(authz_cfg, "greek", "/A/B/E/alpha",
+                                        "plato", svn_authz_write,
+                                        &access_granted, &counters, pool));
+  SVN_TEST_ASSERT(access_granted);
+  SVN_ERR(svn_repos__authz_check_access(authz_cfg, "greek", "/A/B/lambda",
+                                        "plato", svn_authz_write,
+                                        &access_granted, &counters, pool));
+  SVN_TEST_ASSERT(access_granted);
+  SVN_TEST_ASSERT(counters.checks == 2 && counters.evaluations == 1);
+
+  /* But not with other users, access types or repositories. */
+  SVN_ERR(svn_repos__authz_check_access(authz_cfg, "greek", "/A/B/lambda",
+                                        "aristotle", svn_authz_write,
+                                        &access_granted, &counters, pool));
+  SVN_TEST_ASSERT(!access_granted);
+  SVN_ERR(svn_repos__authz_check_access(authz_cfg, "greek", "/A/B/lambda",
+                                        "plato", svn_authz_read,
+                                        &access_granted, &counters, pool));
+  SVN_TEST_ASSERT(access_granted);
+  SVN_ERR(svn_repos__authz_check_access(authz_cfg, "roman", "/A/B/lambda",
+                                        "plato", svn_authz_write,
+                                        &access_granted, &counters, pool));
+  SVN_TEST_ASSERT(!access_granted);
+  SVN_TEST_ASSERT(counters.checks == 5 && counters.evaluations == 4);
+
+  /* Recursive checks of /A/B itself see the rules below it, while those
+     of paths below /A/B don't. */
+  SVN_ERR(svn_repos__authz_check_access(authz_cfg, "greek", "/A",
+                                        NULL, svn_authz_read
+                                              | svn_authz_recursive,
+                                        &access_granted, &counters, pool));
+  SVN_TEST_ASSERT(!access_granted);
+  SVN_ERR(svn_repos__authz_check_access(authz_cfg, "greek", "/A/D",
+                                        NULL, svn_authz_read
+                                              | svn_authz_recursive,
+                                        &access_granted, &counters, pool));
+  SVN_TEST_ASSERT(access_granted);
+  SVN_ERR(svn_repos__authz_check_access(authz_cfg, "greek", "/A",
+                                        NULL, svn_authz_read
+                                              | svn_authz_recursive,
+                                        &access_granted, &counters, pool));
+  SVN_TEST_ASSERT(!access_granted);
+  SVN_TEST_ASSERT(counters.checks == 8 && counters.evaluations == 6);
+
+  return SVN_NO_ERROR;
+}
+
+
+
 
 /* Callback for the commit editor tests that relays requests to
    authz. */
@@ -2404,6 +2592,708 @@ get_logs(const svn_test_opts_t *opts,
   return SVN_NO_ERROR;
 }
 
+/* Log receiver which appends the revisions to the array BATON. */
+static svn_error_t *
+log_revs_receiver(void *baton,
+                  svn_log_entry_t *log_entry,
+                  apr_pool_t *pool)
+{
+  apr_array_header_t *revs = baton;
+  APR_ARRAY_PUSH(revs, svn_revnum_t) = log_entry->revision;
+  return SVN_NO_ERROR;
+}
+
+/* Set *LOGS to the concatenated revision lists of the logs of a number
+   of paths in REPOS, for every peg revision in which they exist and both
+   with and without crossing copies. */
+static svn_error_t *
+get_all_logs(apr_array_header_t **logs,
+             svn_repos_t *repos,
+             apr_pool_t *pool)
+{
+  static const char *const test_paths[] = {
+    "/", "/A", "/A/mu", "/A/D/G/pi", "/iota", "/Z", "/Z/mu", "/Z/B",
+    "/Z/B/E/alpha", "/Z/B2", "/Z/B2/lambda", "/Z/B2/E/beta", "/Z/D/G",
+    "/Z/D/G/rho", "/Z/D/gamma", "/Z/B3", "/Z/B3/lambda", NULL
+  };
+  svn_fs_t *fs = svn_repos_fs(repos);
+  svn_revnum_t youngest_rev, rev;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i, strict;
+
+  *logs = apr_array_make(pool, 1024, sizeof(svn_revnum_t));
+  SVN_ERR(svn_fs_youngest_rev(&youngest_rev, fs, pool));
+
+  for (rev = 1; rev <= youngest_rev; rev++)
+    for (i = 0; test_paths[i]; i++)
+      for (strict = 0; strict <= 1; strict++)
+        {
+          svn_fs_root_t *root;
+          svn_node_kind_t kind;
+          apr_array_header_t *paths;
+
+          svn_pool_clear(iterpool);
+          SVN_ERR(svn_fs_revision_root(&root, fs, rev, iterpool));
+          SVN_ERR(svn_fs_check_path(&kind, root, test_paths[i], iterpool));
+          if (kind == svn_node_none)
+            continue;
+
+          /* Separate the logs so that they can't blend into each other. */
+          APR_ARRAY_PUSH(*logs, svn_revnum_t) = SVN_INVALID_REVNUM;
+
+          paths = apr_array_make(iterpool, 1, sizeof(const char *));
+          APR_ARRAY_PUSH(paths, const char *) = test_paths[i];
+          SVN_ERR(svn_repos_get_logs4(repos, paths, rev, 0, 0, FALSE,
+                                      strict, FALSE, NULL, NULL, NULL,
+                                      log_revs_receiver, *logs, iterpool));
+        }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+/* Return an error if the revision lists EXPECTED and ACTUAL differ. */
+static svn_error_t *
+compare_logs(const apr_array_header_t *expected,
+             const apr_array_header_t *actual)
+{
+  int i;
+
+  for (i = 0; i < expected->nelts && i < actual->nelts; i++)
+    if (APR_ARRAY_IDX(expected, i, svn_revnum_t)
+        != APR_ARRAY_IDX(actual, i, svn_revnum_t))
+      return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                               "Log entry %d is r%ld (expected r%ld)", i,
+                               APR_ARRAY_IDX(actual, i, svn_revnum_t),
+                               APR_ARRAY_IDX(expected, i, svn_revnum_t));
+
+  if (expected->nelts != actual->nelts)
+    return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                             "Got %d log entries (expected %d)",
+                             actual->nelts, expected->nelts);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+get_logs_with_index(const svn_test_opts_t *opts,
+                    apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root, *rev_root;
+  svn_revnum_t youngest_rev = 0, indexed_rev;
+  apr_array_header_t *expected, *actual;
+  apr_pool_t *subpool = svn_pool_create(pool);
+
+  /* Create a filesystem and repository. */
+  SVN_ERR(svn_test__create_repos(&repos, "test-repo-get-logs-with-index",
+                                 opts, pool));
+  fs = svn_repos_fs(repos);
+
+  /* Revision 1:  Add the Greek tree. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, subpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, subpool));
+
+  /* Revision 2:  Tweak A/mu and A/B/E/alpha. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "A/mu",
+                                      "Revision 2", subpool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "A/B/E/alpha",
+                                      "Revision 2", subpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, subpool));
+
+  /* Revision 3:  Copy A to Z. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_fs_revision_root(&rev_root, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_copy(rev_root, "A", txn_root, "Z", subpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, subpool));
+
+  /* Revision 4:  Tweak Z/B/E/alpha and A/D/gamma. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "Z/B/E/alpha",
+                                      "Revision 4", subpool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "A/D/gamma",
+                                      "Revision 4", subpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, subpool));
+
+  /* Revision 5:  Replace Z/mu with a new file. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_fs_delete(txn_root, "Z/mu", subpool));
+  SVN_ERR(svn_fs_make_file(txn_root, "Z/mu", subpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, subpool));
+
+  /* Revision 6:  Tweak Z/mu, copy Z/B to Z/B2 and tweak Z/B2/lambda. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_fs_revision_root(&rev_root, fs, youngest_rev, subpool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "Z/mu",
+                                      "Revision 6", subpool));
+  SVN_ERR(svn_fs_copy(rev_root, "Z/B", txn_root, "Z/B2", subpool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "Z/B2/lambda",
+                                      "Revision 6", subpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, subpool));
+
+  /* Revision 7:  Replace Z/D/G with a copy of A/D/G@1. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_fs_revision_root(&rev_root, fs, 1, subpool));
+  SVN_ERR(svn_fs_delete(txn_root, "Z/D/G", subpool));
+  SVN_ERR(svn_fs_copy(rev_root, "A/D/G", txn_root, "Z/D/G", subpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, subpool));
+
+  /* Without an index, the histories get walked in the filesystem. */
+  SVN_ERR(get_all_logs(&expected, repos, pool));
+
+  SVN_ERR(svn_repos__build_log_index(&indexed_rev, repos, NULL, NULL,
+                                     subpool));
+  SVN_TEST_ASSERT(indexed_rev == youngest_rev);
+  SVN_ERR(get_all_logs(&actual, repos, pool));
+  SVN_ERR(compare_logs(expected, actual));
+
+  /* Revision 8:  Tweak Z/B2/E/beta and Z/D/G/rho.  The commit updates
+     the index.  Commit through a separate repository object, as that
+     keeps the index open until it gets destroyed. */
+  {
+    apr_pool_t *commit_pool = svn_pool_create(subpool);
+    svn_repos_t *commit_repos;
+
+    SVN_ERR(svn_repos_open2(&commit_repos, svn_repos_path(repos, pool),
+                            NULL, commit_pool));
+    SVN_ERR(svn_fs_begin_txn(&txn, svn_repos_fs(commit_repos), youngest_rev,
+                             commit_pool));
+    SVN_ERR(svn_fs_txn_root(&txn_root, txn, commit_pool));
+    SVN_ERR(svn_test__set_file_contents(txn_root, "Z/B2/E/beta",
+                                        "Revision 8", commit_pool));
+    SVN_ERR(svn_test__set_file_contents(txn_root, "Z/D/G/rho",
+                                        "Revision 8", commit_pool));
+    SVN_ERR(svn_repos_fs_commit_txn(NULL, commit_repos, &youngest_rev, txn,
+                                    commit_pool));
+    svn_pool_destroy(commit_pool);
+  }
+
+  /* Revisions 9 and 10 bypass the repos layer, so that the index does
+     not cover them.  r9 tweaks A/D/G/pi, r10 copies Z/B2 to Z/B3 and
+     tweaks Z/B3/lambda. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "A/D/G/pi",
+                                      "Revision 9", subpool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &youngest_rev, txn, subpool));
+
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_fs_revision_root(&rev_root, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_copy(rev_root, "Z/B2", txn_root, "Z/B3", subpool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "Z/B3/lambda",
+                                      "Revision 10", subpool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &youngest_rev, txn, subpool));
+
+  /* Log requests use the index for the revisions it covers and walk the
+     younger ones, but never write to it. */
+  SVN_ERR(get_all_logs(&actual, repos, pool));
+  {
+    apr_pool_t *index_pool = svn_pool_create(subpool);
+    svn_repos__log_index_t *log_index;
+
+    SVN_ERR(svn_repos__log_index_open(&log_index, repos, index_pool,
+                                      index_pool));
+    SVN_TEST_ASSERT(log_index != NULL);
+    SVN_TEST_ASSERT(svn_repos__log_index_indexed_rev(log_index) == 8);
+    svn_pool_destroy(index_pool);
+  }
+
+  /* Compare to the logs without index. */
+  SVN_ERR(svn_io_remove_file2(svn_dirent_join_many(pool,
+                                                   svn_repos_path(repos, pool),
+                                                   "db", "log-index.db",
+                                                   NULL),
+                              FALSE, pool));
+  SVN_ERR(get_all_logs(&expected, repos, pool));
+  SVN_ERR(compare_logs(expected, actual));
+
+  svn_pool_destroy(subpool);
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_repos_authz_func_t.  Deny access to everything
+   below /A/B. */
+static svn_error_t *
+deny_a_b_authz_func(svn_boolean_t *allowed,
+                    svn_fs_root_t *root,
+                    const char *path,
+                    void *baton,
+                    apr_pool_t *pool)
+{
+  *allowed = ! svn_dirent_is_ancestor("/A/B", path);
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_log_entry_receiver_t.  Append a line describing
+   LOG_ENTRY, including its sorted changed paths, to the stringbuf in
+   BATON. */
+static svn_error_t *
+log_entry_text_receiver(void *baton,
+                        svn_log_entry_t *log_entry,
+                        apr_pool_t *pool)
+{
+  svn_stringbuf_t *text = baton;
+  svn_boolean_t has_log = log_entry->revprops
+                          && apr_hash_get(log_entry->revprops,
+                                          SVN_PROP_REVISION_LOG,
+                                          APR_HASH_KEY_STRING);
+
+  svn_stringbuf_appendcstr(text,
+                           apr_psprintf(pool, "r%ld %s:", log_entry->revision,
+                                        has_log ? "log" : "-"));
+  if (log_entry->changed_paths2)
+    {
+      apr_array_header_t *sorted
+        = svn_sort__hash(log_entry->changed_paths2,
+                         svn_sort_compare_items_as_paths, pool);
+      int i;
+
+      for (i = 0; i < sorted->nelts; i++)
+        {
+          svn_sort__item_t *item = &APR_ARRAY_IDX(sorted, i,
+                                                  svn_sort__item_t);
+          svn_log_changed_path2_t *change = item->value;
+
+          svn_stringbuf_appendcstr(text,
+                                   apr_psprintf(pool, " %c%s",
+                                                change->action,
+                                                (const char *)item->key));
+          if (change->copyfrom_path)
+            svn_stringbuf_appendcstr(text,
+                                     apr_psprintf(pool, "@%s:%ld",
+                                                  change->copyfrom_path,
+                                                  change->copyfrom_rev));
+        }
+    }
+  svn_stringbuf_appendbyte(text, '\n');
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+get_logs_pipelined(const svn_test_opts_t *opts,
+                   apr_pool_t *pool)
+{
+  static const char *const test_paths[] = { "/", "/A", "/A/mu", "/Z", NULL };
+  static const struct {
+    svn_revnum_t start;
+    svn_revnum_t end;
+    int limit;
+  } ranges[] = {
+    { SVN_INVALID_REVNUM, 0, 0 },
+    { 0, SVN_INVALID_REVNUM, 0 },
+    { 11, 2, 5 },
+    { 2, 11, 5 },
+    { 12, 12, 0 }
+  };
+  svn_repos_t *repos;
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root, *rev_root;
+  svn_revnum_t youngest_rev = 0;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i, r, variant;
+
+  /* Create a filesystem and repository. */
+  SVN_ERR(svn_test__create_repos(&repos, "test-repo-get-logs-pipelined",
+                                 opts, pool));
+  fs = svn_repos_fs(repos);
+
+  /* Revision 1:  Add the Greek tree. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, iterpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, iterpool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, iterpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, iterpool));
+
+  /* Revisions 2 - 11:  Modify readable and unreadable files, some of
+     them together, and copy A to Z in revision 6. */
+  for (i = 2; i <= 11; i++)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, iterpool));
+      SVN_ERR(svn_fs_txn_root(&txn_root, txn, iterpool));
+      if (i % 3 != 0)
+        SVN_ERR(svn_test__set_file_contents(txn_root, "A/mu",
+                                            apr_psprintf(iterpool, "r%d", i),
+                                            iterpool));
+      if (i % 2 == 0)
+        SVN_ERR(svn_test__set_file_contents(txn_root, "A/B/lambda",
+                                            apr_psprintf(iterpool, "r%d", i),
+                                            iterpool));
+      if (i == 6)
+        {
+          SVN_ERR(svn_fs_revision_root(&rev_root, fs, youngest_rev,
+                                       iterpool));
+          SVN_ERR(svn_fs_copy(rev_root, "A", txn_root, "Z", iterpool));
+        }
+      SVN_ERR(svn_fs_change_txn_prop(txn, SVN_PROP_REVISION_LOG,
+                                     svn_string_create("msg", iterpool),
+                                     iterpool));
+      SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn,
+                                      iterpool));
+    }
+
+  /* Revision 12:  Touch only unreadable paths. */
+  svn_pool_clear(iterpool);
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, iterpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, iterpool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "A/B/E/beta", "r12",
+                                      iterpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn,
+                                  iterpool));
+
+  /* The pipelined log must produce exactly the same output as the
+     sequential one, with and without authz and changed paths. */
+  for (i = 0; test_paths[i]; i++)
+    for (r = 0; r < (int)(sizeof(ranges) / sizeof(ranges[0])); r++)
+      for (variant = 0; variant < 4; variant++)
+        {
+          svn_boolean_t discover_changed_paths = (variant & 1) != 0;
+          svn_repos_authz_func_t authz_func
+            = (variant & 2) ? deny_a_b_authz_func : NULL;
+          apr_array_header_t *paths;
+          svn_stringbuf_t *expected, *actual;
+          svn_error_t *expected_err, *actual_err;
+
+          svn_pool_clear(iterpool);
+          paths = apr_array_make(iterpool, 1, sizeof(const char *));
+          APR_ARRAY_PUSH(paths, const char *) = test_paths[i];
+          expected = svn_stringbuf_create_empty(iterpool);
+          actual = svn_stringbuf_create_empty(iterpool);
+
+          expected_err = svn_repos_get_logs4(repos, paths, ranges[r].start,
+                                             ranges[r].end, ranges[r].limit,
+                                             discover_changed_paths, FALSE,
+                                             FALSE, NULL, authz_func, NULL,
+                                             log_entry_text_receiver,
+                                             expected, iterpool);
+          actual_err = svn_repos__get_logs_pipelined(
+                         repos, paths, ranges[r].start, ranges[r].end,
+                         ranges[r].limit, discover_changed_paths, FALSE,
+                         FALSE, NULL, authz_func, NULL, FALSE, 3, NULL,
+                         log_entry_text_receiver, actual, iterpool);
+
+          /* Some paths don't exist in every revision range. */
+          SVN_TEST_ASSERT((expected_err == SVN_NO_ERROR)
+                          == (actual_err == SVN_NO_ERROR));
+          if (expected_err)
+            SVN_TEST_ASSERT(expected_err->apr_err == actual_err->apr_err);
+          svn_error_clear(expected_err);
+          svn_error_clear(actual_err);
+
+          SVN_TEST_STRING_ASSERT(actual->data, expected->data);
+        }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+/* Append a description of CATALOG to TEXT. */
+static svn_error_t *
+append_catalog(svn_stringbuf_t *text,
+               svn_mergeinfo_catalog_t catalog,
+               apr_pool_t *pool)
+{
+  apr_array_header_t *sorted;
+  int i;
+
+  sorted = svn_sort__hash(catalog, svn_sort_compare_items_as_paths, pool);
+  for (i = 0; i < sorted->nelts; i++)
+    {
+      svn_sort__item_t *item = &APR_ARRAY_IDX(sorted, i, svn_sort__item_t);
+      svn_string_t *mergeinfo_string;
+
+      SVN_ERR(svn_mergeinfo_to_string(&mergeinfo_string, item->value, pool));
+      svn_stringbuf_appendcstr(text,
+                               apr_psprintf(pool, "%s: %s\n",
+                                            (const char *)item->key,
+                                            mergeinfo_string->data));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *TEXT to a description of the merge-aware logs and the mergeinfo,
+   including that of descendants, of a number of paths in REPOS for every
+   revision in which they exist. */
+static svn_error_t *
+get_all_merge_history(svn_stringbuf_t **text,
+                      svn_repos_t *repos,
+                      apr_pool_t *pool)
+{
+  static const char *const test_paths[] = {
+    "/", "/A", "/A/mu", "/A/D/gamma", "/A/B", "/Y", "/Y/D", NULL
+  };
+  svn_fs_t *fs = svn_repos_fs(repos);
+  svn_revnum_t youngest_rev, rev;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i;
+
+  *text = svn_stringbuf_create_empty(pool);
+  SVN_ERR(svn_fs_youngest_rev(&youngest_rev, fs, pool));
+
+  for (rev = 1; rev <= youngest_rev; rev++)
+    for (i = 0; test_paths[i]; i++)
+      {
+        svn_fs_root_t *root;
+        svn_node_kind_t kind;
+        apr_array_header_t *paths;
+        svn_mergeinfo_catalog_t catalog;
+
+        svn_pool_clear(iterpool);
+        SVN_ERR(svn_fs_revision_root(&root, fs, rev, iterpool));
+        SVN_ERR(svn_fs_check_path(&kind, root, test_paths[i], iterpool));
+        if (kind == svn_node_none)
+          continue;
+
+        svn_stringbuf_appendcstr(*text,
+                                 apr_psprintf(iterpool, "%s@%ld\n",
+                                              test_paths[i], rev));
+
+        paths = apr_array_make(iterpool, 1, sizeof(const char *));
+        APR_ARRAY_PUSH(paths, const char *) = test_paths[i];
+        SVN_ERR(svn_repos_get_logs4(repos, paths, rev, 0, 0, FALSE, FALSE,
+                                    TRUE, NULL, NULL, NULL,
+                                    log_entry_text_receiver, *text,
+                                    iterpool));
+
+        SVN_ERR(svn_repos_fs_get_mergeinfo(&catalog, repos, paths, rev,
+                                           svn_mergeinfo_inherited, TRUE,
+                                           NULL, NULL, iterpool));
+        SVN_ERR(append_catalog(*text, catalog, iterpool));
+      }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+get_mergeinfo_with_index(const svn_test_opts_t *opts,
+                         apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root, *rev_root;
+  svn_revnum_t youngest_rev = 0, indexed_rev;
+  svn_stringbuf_t *expected, *actual;
+  const char *index_path;
+  apr_pool_t *subpool = svn_pool_create(pool);
+
+  /* Create a filesystem and repository. */
+  SVN_ERR(svn_test__create_repos(&repos, "test-repo-get-mergeinfo-index",
+                                 opts, pool));
+  fs = svn_repos_fs(repos);
+  index_path = svn_dirent_join_many(pool, svn_repos_path(repos, pool),
+                                    "db", "mergeinfo-index.db", NULL);
+
+  /* Revision 1:  Add the Greek tree. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, subpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, subpool));
+
+  /* Revision 2:  Copy A to Z. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_fs_revision_root(&rev_root, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_copy(rev_root, "A", txn_root, "Z", subpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, subpool));
+
+  /* Revision 3:  Tweak Z/mu and Z/D/gamma. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "Z/mu",
+                                      "Revision 3", subpool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "Z/D/gamma",
+                                      "Revision 3", subpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, subpool));
+
+  /* Revision 4:  Merge r3 from Z to A. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "A/mu",
+                                      "Revision 3", subpool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "A/D/gamma",
+                                      "Revision 3", subpool));
+  SVN_ERR(svn_fs_change_node_prop(txn_root, "A", SVN_PROP_MERGEINFO,
+                                  svn_string_create("/Z:3", subpool),
+                                  subpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, subpool));
+
+  /* Revision 5:  Tweak Z/D/G/rho, give A/D subtree mergeinfo and A/B
+     invalid mergeinfo. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "Z/D/G/rho",
+                                      "Revision 5", subpool));
+  SVN_ERR(svn_fs_change_node_prop(txn_root, "A/D", SVN_PROP_MERGEINFO,
+                                  svn_string_create("/Z/D:3", subpool),
+                                  subpool));
+  SVN_ERR(svn_fs_change_node_prop(txn_root, "A/B", SVN_PROP_MERGEINFO,
+                                  svn_string_create("garbage", subpool),
+                                  subpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, subpool));
+
+  /* Revision 6:  Copy A to Y. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_fs_revision_root(&rev_root, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_copy(rev_root, "A", txn_root, "Y", subpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, subpool));
+
+  /* Without an index, the mergeinfo gets read from the filesystem. */
+  SVN_ERR(get_all_merge_history(&expected, repos, pool));
+
+  SVN_ERR(svn_repos__build_mergeinfo_index(&indexed_rev, repos, NULL, NULL,
+                                           subpool));
+  SVN_TEST_ASSERT(indexed_rev == youngest_rev);
+  SVN_ERR(get_all_merge_history(&actual, repos, pool));
+  SVN_TEST_STRING_ASSERT(actual->data, expected->data);
+
+  /* Revision 7:  Merge r5 from Z/D to A/D, delete the mergeinfo of Y/D
+     and replace Y/B.  The commit updates the index.  Commit through a
+     separate repository object, as that keeps the index open until it
+     gets destroyed. */
+  {
+    apr_pool_t *commit_pool = svn_pool_create(subpool);
+    svn_repos_t *commit_repos;
+
+    SVN_ERR(svn_repos_open2(&commit_repos, svn_repos_path(repos, pool),
+                            NULL, commit_pool));
+    SVN_ERR(svn_fs_begin_txn(&txn, svn_repos_fs(commit_repos), youngest_rev,
+                             commit_pool));
+    SVN_ERR(svn_fs_txn_root(&txn_root, txn, commit_pool));
+    SVN_ERR(svn_fs_revision_root(&rev_root, svn_repos_fs(commit_repos), 1,
+                                 commit_pool));
+    SVN_ERR(svn_test__set_file_contents(txn_root, "A/D/G/rho",
+                                        "Revision 5", commit_pool));
+    SVN_ERR(svn_fs_change_node_prop(txn_root, "A/D", SVN_PROP_MERGEINFO,
+                                    svn_string_create("/Z/D:3,5",
+                                                      commit_pool),
+                                    commit_pool));
+    SVN_ERR(svn_fs_change_node_prop(txn_root, "Y/D", SVN_PROP_MERGEINFO,
+                                    NULL, commit_pool));
+    SVN_ERR(svn_fs_delete(txn_root, "Y/B", commit_pool));
+    SVN_ERR(svn_fs_copy(rev_root, "A/B", txn_root, "Y/B", commit_pool));
+    SVN_ERR(svn_repos_fs_commit_txn(NULL, commit_repos, &youngest_rev, txn,
+                                    commit_pool));
+    svn_pool_destroy(commit_pool);
+  }
+
+  /* Revision 8:  Delete A/D and give A/B/E mergeinfo, bypassing the repos
+     layer, so that the index does not cover it. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_fs_delete(txn_root, "A/D", subpool));
+  SVN_ERR(svn_fs_change_node_prop(txn_root, "A/B/E", SVN_PROP_MERGEINFO,
+                                  svn_string_create("/Z/B/E:3", subpool),
+                                  subpool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &youngest_rev, txn, subpool));
+
+  /* Readers use the index only for the revisions it covers and never
+     write to it. */
+  SVN_ERR(get_all_merge_history(&actual, repos, pool));
+  {
+    apr_pool_t *index_pool = svn_pool_create(subpool);
+    svn_repos__mergeinfo_index_t *mergeinfo_index;
+
+    SVN_ERR(svn_repos__mergeinfo_index_open(&mergeinfo_index, repos,
+                                            index_pool, index_pool));
+    SVN_TEST_ASSERT(mergeinfo_index != NULL);
+    SVN_TEST_ASSERT(svn_repos__mergeinfo_index_indexed_rev(mergeinfo_index)
+                    == 7);
+    svn_pool_destroy(index_pool);
+  }
+
+  /* Compare to the results without index. */
+  SVN_ERR(svn_io_remove_file2(index_path, FALSE, pool));
+  SVN_ERR(get_all_merge_history(&expected, repos, pool));
+  SVN_TEST_STRING_ASSERT(actual->data, expected->data);
+
+  /* Use the index of another repository in which the only descendant of
+     A with mergeinfo doesn't exist here.  The descendants'
+     mergeinfo must still be that of a full crawl. */
+  {
+    svn_repos_t *other_repos;
+    svn_revnum_t other_rev = 0;
+    svn_mergeinfo_catalog_t catalog;
+    apr_array_header_t *paths = apr_array_make(pool, 1, sizeof(const char *));
+    svn_revnum_t rev;
+
+    SVN_ERR(svn_test__create_repos(&other_repos,
+                                   "test-repo-get-mergeinfo-index-other",
+                                   opts, subpool));
+    SVN_ERR(svn_fs_begin_txn(&txn, svn_repos_fs(other_repos), other_rev,
+                             subpool));
+    SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+    SVN_ERR(svn_test__create_greek_tree(txn_root, subpool));
+    SVN_ERR(svn_fs_make_dir(txn_root, "A/X", subpool));
+    SVN_ERR(svn_fs_make_dir(txn_root, "A/X/Y", subpool));
+    SVN_ERR(svn_fs_change_node_prop(txn_root, "A/X/Y", SVN_PROP_MERGEINFO,
+                                    svn_string_create("/Z:3", subpool),
+                                    subpool));
+    SVN_ERR(svn_fs_commit_txn(NULL, &other_rev, txn, subpool));
+    while (other_rev < 5)
+      {
+        SVN_ERR(svn_fs_begin_txn(&txn, svn_repos_fs(other_repos), other_rev,
+                                 subpool));
+        SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+        SVN_ERR(svn_test__set_file_contents(txn_root, "iota",
+                                            apr_psprintf(subpool, "r%ld",
+                                                         other_rev + 1),
+                                            subpool));
+        SVN_ERR(svn_fs_commit_txn(NULL, &other_rev, txn, subpool));
+      }
+    SVN_ERR(svn_repos__build_mergeinfo_index(&indexed_rev, other_repos,
+                                             NULL, NULL, subpool));
+    SVN_TEST_ASSERT(indexed_rev == 5);
+
+    APR_ARRAY_PUSH(paths, const char *) = "/A";
+    for (rev = 1; rev <= 5; rev++)
+      {
+        svn_stringbuf_t *crawled = svn_stringbuf_create_empty(pool);
+        svn_stringbuf_t *indexed = svn_stringbuf_create_empty(pool);
+        apr_pool_t *query_pool = svn_pool_create(subpool);
+
+        SVN_ERR(svn_repos_fs_get_mergeinfo(&catalog, repos, paths, rev,
+                                           svn_mergeinfo_inherited, TRUE,
+                                           NULL, NULL, query_pool));
+        SVN_ERR(append_catalog(crawled, catalog, pool));
+
+        SVN_ERR(svn_io_copy_file(svn_dirent_join_many(query_pool,
+                                   svn_repos_path(other_repos, query_pool),
+                                   "db", "mergeinfo-index.db", NULL),
+                                 index_path, FALSE, query_pool));
+        SVN_ERR(svn_repos_fs_get_mergeinfo(&catalog, repos, paths, rev,
+                                           svn_mergeinfo_inherited, TRUE,
+                                           NULL, NULL, query_pool));
+        SVN_ERR(append_catalog(indexed, catalog, pool));
+
+        /* Close the index before removing it. */
+        svn_pool_destroy(query_pool);
+        SVN_ERR(svn_io_remove_file2(index_path, FALSE, subpool));
+
+        SVN_TEST_STRING_ASSERT(indexed->data, crawled->data);
+      }
+  }
+
+  svn_pool_destroy(subpool);
+  return SVN_NO_ERROR;
+}
+
 
 /* Tests for svn_repos_get_file_revsN() */
 
@@ -2556,6 +3446,543 @@ issue_4060(const svn_test_opts_t *opts,
   return SVN_NO_ERROR;
 }
 
+/* Set *DUMP to the dump of all revisions of REPOS, allocated in POOL.
+   Dump the file contents as deltas if USE_DELTAS is set. */
+static svn_error_t *
+dump_repos(svn_stringbuf_t **dump,
+           svn_repos_t *repos,
+           svn_boolean_t use_deltas,
+           apr_pool_t *pool)
+{
+  *dump = svn_stringbuf_create_empty(pool);
+
+  return svn_repos_dump_fs3(repos, svn_stream_from_stringbuf(*dump, pool),
+                            SVN_INVALID_REVNUM, SVN_INVALID_REVNUM,
+                            FALSE, use_deltas, NULL, NULL, NULL, NULL,
+                            pool);
+}
+
+static svn_error_t *
+load_fs_pipelined(const svn_test_opts_t *opts,
+                  apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root, *rev_root;
+  svn_revnum_t youngest_rev = 0;
+  svn_stringbuf_t *expected;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i;
+
+  /* Create a filesystem and repository. */
+  SVN_ERR(svn_test__create_repos(&repos, "test-repo-load-pipelined",
+                                 opts, pool));
+  fs = svn_repos_fs(repos);
+
+  /* Revision 1:  Add the Greek tree. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, iterpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, iterpool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, iterpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, iterpool));
+
+  /* Revisions 2 - 6:  Change texts and properties, copy, replace and
+     delete nodes, which covers all kinds of delta bases. */
+  for (i = 2; i <= 6; i++)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, iterpool));
+      SVN_ERR(svn_fs_txn_root(&txn_root, txn, iterpool));
+      SVN_ERR(svn_fs_revision_root(&rev_root, fs, youngest_rev, iterpool));
+
+      SVN_ERR(svn_test__set_file_contents(
+                txn_root, "A/mu",
+                apr_psprintf(iterpool, "This is the file 'mu' in r%d.\n", i),
+                iterpool));
+      if (i % 2 == 0)
+        SVN_ERR(svn_fs_change_node_prop(txn_root, "A/mu", "prop",
+                                        svn_string_createf(iterpool, "r%d",
+                                                           i),
+                                        iterpool));
+      if (i == 3)
+        {
+          SVN_ERR(svn_fs_copy(rev_root, "A", txn_root, "Z", iterpool));
+          SVN_ERR(svn_test__set_file_contents(txn_root, "Z/B/lambda",
+                                              "lambda in Z\n", iterpool));
+        }
+      if (i == 4)
+        {
+          SVN_ERR(svn_fs_delete(txn_root, "A/D/gamma", iterpool));
+          SVN_ERR(svn_fs_copy(rev_root, "A/D/G/pi", txn_root, "A/D/gamma",
+                              iterpool));
+          SVN_ERR(svn_test__set_file_contents(txn_root, "A/D/gamma",
+                                              "gamma was pi\n", iterpool));
+        }
+      if (i == 5)
+        {
+          SVN_ERR(svn_fs_delete(txn_root, "Z/D/H", iterpool));
+          SVN_ERR(svn_fs_make_file(txn_root, "Z/D/new", iterpool));
+          SVN_ERR(svn_test__set_file_contents(txn_root, "Z/D/new",
+                                              "new file\n", iterpool));
+        }
+      SVN_ERR(svn_fs_change_txn_prop(txn, SVN_PROP_REVISION_LOG,
+                                     svn_string_create("msg", iterpool),
+                                     iterpool));
+      SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn,
+                                      iterpool));
+    }
+
+  /* Loading dumps with and without deltas in parallel must result in
+     the same repository. */
+  SVN_ERR(dump_repos(&expected, repos, FALSE, pool));
+  for (i = 0; i < 2; i++)
+    {
+      svn_repos_t *target;
+      svn_stringbuf_t *dump, *actual;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(dump_repos(&dump, repos, i == 1, iterpool));
+      SVN_ERR(svn_test__create_repos(&target,
+                                     apr_psprintf(iterpool,
+                                                  "test-repo-load-"
+                                                  "pipelined-%d", i),
+                                     opts, iterpool));
+      SVN_ERR(svn_repos__load_fs_pipelined(target,
+                                           svn_stream_from_stringbuf(
+                                             dump, iterpool),
+                                           SVN_INVALID_REVNUM,
+                                           SVN_INVALID_REVNUM,
+                                           svn_repos_load_uuid_force, NULL,
+                                           FALSE, FALSE, TRUE, 3, NULL,
+                                           NULL, NULL, NULL, NULL,
+                                           iterpool));
+      SVN_ERR(dump_repos(&actual, target, FALSE, iterpool));
+      SVN_TEST_STRING_ASSERT(actual->data, expected->data);
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+dump_fs_parallel(const svn_test_opts_t *opts,
+                 apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root, *rev_root;
+  svn_revnum_t youngest_rev = 0;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i;
+
+  /* Create a filesystem and repository. */
+  SVN_ERR(svn_test__create_repos(&repos, "test-repo-dump-parallel",
+                                 opts, pool));
+  fs = svn_repos_fs(repos);
+
+  /* Revision 1:  Add the Greek tree. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, iterpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, iterpool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, iterpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, iterpool));
+
+  /* Revisions 2 - 7:  Change a text and copy from earlier revisions, so
+     that the ranges refer to each other. */
+  for (i = 2; i <= 7; i++)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, iterpool));
+      SVN_ERR(svn_fs_txn_root(&txn_root, txn, iterpool));
+      SVN_ERR(svn_fs_revision_root(&rev_root, fs, i - 1, iterpool));
+
+      SVN_ERR(svn_test__set_file_contents(
+                txn_root, "A/mu",
+                apr_psprintf(iterpool, "This is the file 'mu' in r%d.\n", i),
+                iterpool));
+      SVN_ERR(svn_fs_copy(rev_root, "A/mu", txn_root,
+                          apr_psprintf(iterpool, "mu%d", i), iterpool));
+      SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn,
+                                      iterpool));
+    }
+
+  for (i = 0; i < 2; i++)
+    {
+      svn_boolean_t use_deltas = (i == 1);
+      svn_stringbuf_t *expected, *actual, *header;
+      apr_array_header_t *streams;
+      svn_stringbuf_t *chunks[3];
+      svn_repos_t *target;
+      apr_size_t header_len;
+      int k;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(dump_repos(&expected, repos, use_deltas, iterpool));
+      header_len = strstr(expected->data, SVN_REPOS_DUMPFILE_REVISION_NUMBER)
+                 - expected->data;
+      header = svn_stringbuf_ncreate(expected->data, header_len, iterpool);
+
+      /* Every chunk must carry the dumpfile header.  Without the headers
+         of the later ones, the chunks must match the sequential dump. */
+      streams = apr_array_make(iterpool, 3, sizeof(svn_stream_t *));
+      for (k = 0; k < 3; k++)
+        {
+          chunks[k] = svn_stringbuf_create_empty(iterpool);
+          APR_ARRAY_PUSH(streams, svn_stream_t *)
+            = svn_stream_from_stringbuf(chunks[k], iterpool);
+        }
+      SVN_ERR(svn_repos__dump_fs_parallel(repos, streams,
+                                          SVN_INVALID_REVNUM,
+                                          SVN_INVALID_REVNUM,
+                                          FALSE, use_deltas, FALSE, 3,
+                                          NULL,
+                                          NULL, NULL, NULL, NULL,
+                                          iterpool));
+
+      actual = svn_stringbuf_dup(chunks[0], iterpool);
+      for (k = 0; k < 3; k++)
+        {
+          SVN_TEST_ASSERT(chunks[k]->len > header_len);
+          SVN_TEST_ASSERT(memcmp(chunks[k]->data, header->data,
+                                 header_len) == 0);
+          if (k > 0)
+            svn_stringbuf_appendbytes(actual, chunks[k]->data + header_len,
+                                      chunks[k]->len - header_len);
+        }
+      SVN_TEST_STRING_ASSERT(actual->data, expected->data);
+
+      /* More streams than revisions, all of them the same.  The
+         concatenation must load like the sequential dump. */
+      actual = svn_stringbuf_create_empty(iterpool);
+      streams = apr_array_make(iterpool, 10, sizeof(svn_stream_t *));
+      for (k = 0; k < 10; k++)
+        APR_ARRAY_PUSH(streams, svn_stream_t *)
+          = svn_stream_from_stringbuf(actual, iterpool);
+      SVN_ERR(svn_repos__dump_fs_parallel(repos, streams,
+                                          SVN_INVALID_REVNUM,
+                                          SVN_INVALID_REVNUM,
+                                          FALSE, use_deltas, FALSE, 4,
+                                          NULL,
+                                          NULL, NULL, NULL, NULL,
+                                          iterpool));
+
+      SVN_ERR(svn_test__create_repos(&target,
+                                     apr_psprintf(iterpool,
+                                                  "test-repo-dump-"
+                                                  "parallel-%d", i),
+                                     opts, iterpool));
+      SVN_ERR(svn_repos_load_fs4(target,
+                                 svn_stream_from_stringbuf(actual, iterpool),
+                                 SVN_INVALID_REVNUM, SVN_INVALID_REVNUM,
+                                 svn_repos_load_uuid_force, NULL,
+                                 FALSE, FALSE, TRUE, NULL, NULL,
+                                 NULL, NULL, iterpool));
+      SVN_ERR(dump_repos(&actual, target, use_deltas, iterpool));
+      SVN_TEST_STRING_ASSERT(actual->data, expected->data);
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+dump_chunked_deltas(const svn_test_opts_t *opts,
+                    apr_pool_t *pool)
+{
+  svn_repos_t *repos, *target;
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+  svn_revnum_t youngest_rev = 0;
+  svn_stringbuf_t *contents, *expected, *chunked, *actual;
+  const char *found;
+  apr_array_header_t *streams;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i;
+
+  /* Create a filesystem and repository. */
+  SVN_ERR(svn_test__create_repos(&repos, "test-repo-dump-chunked",
+                                 opts, pool));
+  fs = svn_repos_fs(repos);
+
+  /* Revision 1:  Add the Greek tree and a file too large to have its
+     delta buffered in memory. */
+  contents = svn_stringbuf_create_empty(pool);
+  for (i = 0; contents->len < 3 * 1024 * 1024; i++)
+    svn_stringbuf_appendcstr(contents,
+                             apr_psprintf(iterpool, "line %d\n", i));
+
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, iterpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, iterpool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, iterpool));
+  SVN_ERR(svn_fs_make_file(txn_root, "large", iterpool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "large", contents->data,
+                                      iterpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, iterpool));
+
+  /* Revision 2:  Change the large file and a small one. */
+  svn_pool_clear(iterpool);
+  svn_stringbuf_appendcstr(contents, "last line\n");
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, iterpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, iterpool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "large", contents->data,
+                                      iterpool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "iota", "new iota\n",
+                                      iterpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, iterpool));
+
+  /* Only the delta of the large file gets chunked. */
+  SVN_ERR(dump_repos(&expected, repos, TRUE, pool));
+  chunked = svn_stringbuf_create_empty(pool);
+  streams = apr_array_make(pool, 1, sizeof(svn_stream_t *));
+  APR_ARRAY_PUSH(streams, svn_stream_t *)
+    = svn_stream_from_stringbuf(chunked, pool);
+  SVN_ERR(svn_repos__dump_fs_parallel(repos, streams,
+                                      SVN_INVALID_REVNUM, SVN_INVALID_REVNUM,
+                                      TRUE, TRUE, TRUE, 1, NULL,
+                                      NULL, NULL, NULL, NULL, pool));
+
+  SVN_TEST_ASSERT(strncmp(chunked->data,
+                          SVN_REPOS_DUMPFILE_MAGIC_HEADER ": 4\n",
+                          sizeof(SVN_REPOS_DUMPFILE_MAGIC_HEADER) + 3) == 0);
+  found = strstr(chunked->data,
+                 SVN_REPOS__DUMPFILE_TEXT_CONTENT_CHUNKED ": true\n");
+  SVN_TEST_ASSERT(found);
+  SVN_TEST_ASSERT(! strstr(found + 1,
+                           SVN_REPOS__DUMPFILE_TEXT_CONTENT_CHUNKED));
+
+  /* Loading the chunked dump must result in the same repository. */
+  SVN_ERR(svn_test__create_repos(&target, "test-repo-dump-chunked-2",
+                                 opts, pool));
+  SVN_ERR(svn_repos_load_fs4(target,
+                             svn_stream_from_stringbuf(chunked, pool),
+                             SVN_INVALID_REVNUM, SVN_INVALID_REVNUM,
+                             svn_repos_load_uuid_force, NULL,
+                             FALSE, FALSE, TRUE, NULL, NULL,
+                             NULL, NULL, pool));
+  SVN_ERR(dump_repos(&actual, target, TRUE, pool));
+  SVN_TEST_STRING_ASSERT(actual->data, expected->data);
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+/* Return an error unless the trees below PATH in ROOT1 and ROOT2 have the
+   same entries and file contents. */
+static svn_error_t *
+compare_trees(svn_fs_root_t *root1,
+              svn_fs_root_t *root2,
+              const char *path,
+              apr_pool_t *pool)
+{
+  apr_hash_t *entries1, *entries2;
+  apr_hash_index_t *hi;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+
+  SVN_ERR(svn_fs_dir_entries(&entries1, root1, path, pool));
+  SVN_ERR(svn_fs_dir_entries(&entries2, root2, path, pool));
+  if (apr_hash_count(entries1) != apr_hash_count(entries2))
+    return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                             "Different number of entries in '%s'", path);
+
+  for (hi = apr_hash_first(pool, entries1); hi; hi = apr_hash_next(hi))
+    {
+      const svn_fs_dirent_t *entry1 = svn__apr_hash_index_val(hi);
+      const svn_fs_dirent_t *entry2 = apr_hash_get(entries2, entry1->name,
+                                                   APR_HASH_KEY_STRING);
+      const char *child;
+
+      svn_pool_clear(iterpool);
+      child = svn_fspath__join(path, entry1->name, iterpool);
+      if (! entry2 || entry1->kind != entry2->kind)
+        return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                                 "Entry '%s' differs", child);
+
+      if (entry1->kind == svn_node_dir)
+        {
+          SVN_ERR(compare_trees(root1, root2, child, iterpool));
+        }
+      else
+        {
+          svn_checksum_t *checksum1, *checksum2;
+
+          SVN_ERR(svn_fs_file_checksum(&checksum1, svn_checksum_md5, root1,
+                                       child, TRUE, iterpool));
+          SVN_ERR(svn_fs_file_checksum(&checksum2, svn_checksum_md5, root2,
+                                       child, TRUE, iterpool));
+          if (! svn_checksum_match(checksum1, checksum2))
+            return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                                     "Contents of '%s' differ", child);
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+/* Drive a report from FROM_REV (starting empty if START_EMPTY is set) to
+   TO_REV of REPOS with MAX_THREADS read-ahead threads into a txn based
+   on FROM_REV and check that the result matches TO_REV. */
+static svn_error_t *
+check_pipelined_report(svn_repos_t *repos,
+                       svn_revnum_t from_rev,
+                       svn_boolean_t start_empty,
+                       svn_revnum_t to_rev,
+                       int max_threads,
+                       apr_pool_t *pool)
+{
+  svn_fs_t *fs = svn_repos_fs(repos);
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root, *rev_root;
+  const svn_delta_editor_t *editor;
+  void *edit_baton, *report_baton;
+
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, from_rev, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(dir_delta_get_editor(&editor, &edit_baton, fs,
+                               txn_root, "", pool));
+
+  SVN_ERR(svn_repos__begin_report_pipelined(&report_baton, to_rev, repos,
+                                            "/", "", NULL, TRUE,
+                                            svn_depth_infinity, FALSE, FALSE,
+                                            editor, edit_baton, NULL, NULL,
+                                            max_threads, NULL, pool));
+  SVN_ERR(svn_repos_set_path3(report_baton, "", from_rev,
+                              svn_depth_infinity, start_empty, NULL, pool));
+  SVN_ERR(svn_repos_finish_report(report_baton, pool));
+
+  /* The txn must now have the contents of TO_REV. */
+  SVN_ERR(svn_fs_revision_root(&rev_root, fs, to_rev, pool));
+  SVN_ERR(compare_trees(rev_root, txn_root, "/", pool));
+
+  return svn_error_trace(svn_fs_abort_txn(txn, pool));
+}
+
+static svn_error_t *
+update_pipelined(const svn_test_opts_t *opts,
+                 apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+  svn_revnum_t youngest_rev = 0;
+  svn_stringbuf_t *large;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i;
+
+  /* Create a filesystem and repository. */
+  SVN_ERR(svn_test__create_repos(&repos, "test-repo-update-pipelined",
+                                 opts, pool));
+  fs = svn_repos_fs(repos);
+
+  /* Revision 1:  Add the Greek tree and a file too large to be kept in
+     memory by the read-ahead. */
+  large = svn_stringbuf_create_ensure(600 * 1024, pool);
+  while (large->len < 600 * 1024)
+    svn_stringbuf_appendcstr(large, "A line of a large file.\n");
+
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, iterpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, iterpool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, iterpool));
+  SVN_ERR(svn_fs_make_file(txn_root, "A/large", iterpool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "A/large", large->data,
+                                      iterpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, iterpool));
+
+  /* Revision 2:  Modify, add and delete files in several directories. */
+  svn_pool_clear(iterpool);
+  svn_stringbuf_appendcstr(large, "Another line.\n");
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, iterpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, iterpool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "iota", "new iota\n",
+                                      iterpool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "A/mu", "new mu\n",
+                                      iterpool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "A/large", large->data,
+                                      iterpool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "A/D/G/rho", "new rho\n",
+                                      iterpool));
+  SVN_ERR(svn_fs_delete(txn_root, "A/D/G/pi", iterpool));
+  for (i = 0; i < 20; i++)
+    {
+      const char *path = apr_psprintf(iterpool, "A/D/H/file%d", i);
+
+      SVN_ERR(svn_fs_make_file(txn_root, path, iterpool));
+      SVN_ERR(svn_test__set_file_contents(txn_root, path,
+                                          apr_psprintf(iterpool,
+                                                       "file %d\n", i),
+                                          iterpool));
+    }
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, iterpool));
+
+  /* Checkouts and updates with and without read-ahead must yield the
+     same trees. */
+  for (i = 1; i <= 4; i *= 4)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(check_pipelined_report(repos, 0, TRUE, 2, i, iterpool));
+      SVN_ERR(check_pipelined_report(repos, 1, FALSE, 2, i, iterpool));
+      SVN_ERR(check_pipelined_report(repos, 2, FALSE, 1, i, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+worker_fs_reuse(const svn_test_opts_t *opts,
+                apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_fs_t *fs, *fs1, *fs2, *fs3;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+  svn_revnum_t youngest_rev = 0;
+  svn_revnum_t worker_youngest;
+  svn_repos__worker_fs_t *wfs1, *wfs2, *wfs3;
+  const char *fs_path, *uuid;
+
+  SVN_ERR(svn_test__create_repos(&repos, "test-repo-worker-fs-reuse",
+                                 opts, pool));
+  fs = svn_repos_fs(repos);
+  fs_path = svn_fs_path(fs, pool);
+  SVN_ERR(svn_fs_get_uuid(fs, &uuid, pool));
+
+  /* Instances in use are never handed out twice. */
+  SVN_ERR(svn_repos__worker_fs_acquire(&wfs1, &fs1, fs_path, uuid, NULL,
+                                       pool));
+  SVN_ERR(svn_repos__worker_fs_acquire(&wfs2, &fs2, fs_path, uuid, NULL,
+                                       pool));
+  SVN_TEST_ASSERT(fs1 != fs2 && fs1 != fs);
+
+  /* Released instances get reused and see revisions committed since
+     they have been opened. */
+  SVN_ERR(svn_repos__worker_fs_release(wfs1));
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+
+  SVN_ERR(svn_repos__worker_fs_acquire(&wfs3, &fs3, fs_path, uuid, NULL,
+                                       pool));
+  SVN_TEST_ASSERT(fs3 == fs1);
+  SVN_ERR(svn_fs_youngest_rev(&worker_youngest, fs3, pool));
+  SVN_TEST_ASSERT(worker_youngest == youngest_rev);
+  SVN_ERR(svn_repos__worker_fs_release(wfs3));
+
+  /* Instances of a repository with a different UUID at the same location
+     are not. */
+  SVN_ERR(svn_repos__worker_fs_acquire(&wfs3, &fs3, fs_path, "other-uuid",
+                                       NULL, pool));
+  SVN_TEST_ASSERT(fs3 != fs1 && fs3 != fs2);
+  SVN_ERR(svn_repos__worker_fs_release(wfs3));
+
+  SVN_ERR(svn_repos__worker_fs_release(wfs2));
+
+  return SVN_NO_ERROR;
+}
+
 
 /* The test table.  */
 
@@ -2576,6 +4003,10 @@ struct svn_test_descriptor_t test_funcs[] =
                        "test removal of defunct locks"),
     SVN_TEST_PASS2(authz,
                    "test authz access control"),
+    SVN_TEST_PASS2(authz_groups_and_sharing,
+                   "test authz groups and shared authz files"),
+    SVN_TEST_PASS2(authz_cache,
+                   "test caching of authz check results"),
     SVN_TEST_OPTS_PASS(commit_editor_authz,
                        "test authz in the commit editor"),
     SVN_TEST_OPTS_PASS(commit_continue_txn,
@@ -2588,9 +4019,25 @@ struct svn_test_descriptor_t test_funcs[] =
                        "test if revprops are validated by repos"),
     SVN_TEST_OPTS_PASS(get_logs,
                        "test svn_repos_get_logs ranges and limits"),
+    SVN_TEST_OPTS_PASS(get_logs_with_index,
+                       "test svn_repos_get_logs with a log index"),
+    SVN_TEST_OPTS_PASS(get_logs_pipelined,
+                       "test pipelined svn_repos_get_logs"),
+    SVN_TEST_OPTS_PASS(get_mergeinfo_with_index,
+                       "test merge tracking with a mergeinfo index"),
     SVN_TEST_OPTS_PASS(test_get_file_revs,
                        "test svn_repos_get_file_revsN"),
     SVN_TEST_OPTS_PASS(issue_4060,
                        "test issue 4060"),
+    SVN_TEST_OPTS_PASS(load_fs_pipelined,
+                       "test pipelined svn_repos_load_fs"),
+    SVN_TEST_OPTS_PASS(dump_fs_parallel,
+                       "test parallel svn_repos_dump_fs"),
+    SVN_TEST_OPTS_PASS(dump_chunked_deltas,
+                       "test dumping deltas as chunked text content"),
+    SVN_TEST_OPTS_PASS(update_pipelined,
+                       "test reporting with file content read-ahead"),
+    SVN_TEST_OPTS_PASS(worker_fs_reuse,
+                       "test sharing worker filesystems between requests"),
     SVN_TEST_NULL
   };
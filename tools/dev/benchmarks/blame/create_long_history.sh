@@ -0,0 +1,145 @@
+#!/bin/sh
+
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+
+# usage: run this script from the root of your working copy
+#        and / or adjust the path settings below as needed
+#
+# Creates a single file with LINECOUNT lines and commits REVCOUNT changes
+# to it, each of which modifies CHANGECOUNT scattered lines.  Then, blame
+# is being run on that file.  The resulting blame chain is highly
+# fragmented, so this mainly measures the cost of applying many diff
+# hunks to it.
+
+# set SVNPATH to the 'subversion' folder of your SVN source code w/c
+
+SVNPATH="$('pwd')/subversion"
+
+# if using the installed svn, you may need to adapt the following.
+# Uncomment the VALGRIND line to use that tool instead of "time".
+# Comment the SVNSERVE line to use file:// instead of svn://.
+
+SVN=${SVNPATH}/svn/svn
+SVNADMIN=${SVNPATH}/svnadmin/svnadmin
+SVNSERVE=${SVNPATH}/svnserve/svnserve
+# VALGRIND="valgrind --tool=callgrind"
+
+# set your data paths here
+
+WC=/dev/shm/wc
+REPOROOT=/dev/shm
+
+# size of the file and its history
+
+LINECOUNT=50000
+REVCOUNT=500
+CHANGECOUNT=200
+
+# from here on, we should be good
+
+TIMEFORMAT='%3R  %3U  %3S'
+REPONAME=blame
+PORT=54321
+if [ "${SVNSERVE}" != "" ] ; then
+  URL=svn://localhost:$PORT/$REPONAME
+else
+  URL=file://${REPOROOT}/$REPONAME
+fi
+
+# create repository
+
+rm -rf $WC $REPOROOT/$REPONAME
+mkdir $REPOROOT/$REPONAME
+${SVNADMIN} create $REPOROOT/$REPONAME
+echo "[general]
+anon-access = write" > $REPOROOT/$REPONAME/conf/svnserve.conf
+
+# fire up svnserve
+
+if [ "${SVNSERVE}" != "" ] ; then
+  ${SVNSERVE} -Tdr ${REPOROOT} --listen-port ${PORT} --foreground &
+  PID=$!
+  sleep 1
+fi
+
+# construct valgrind parameters
+
+if [ "${VALGRIND}" != "" ] ; then
+  VG_TOOL=$( echo ${VALGRIND} | sed 's/.*\ --tool=\([a-z]*\).*/\1/' )
+  VG_OUTFILE="--${VG_TOOL}-out-file"
+fi
+
+# print header
+
+printf "using "
+${SVN} --version | grep " version"
+echo
+
+# init working copy
+
+rm -rf $WC
+${SVN} co $URL $WC > /dev/null
+
+# build the history
+
+printf "Creating $REVCOUNT revisions of a $LINECOUNT lines file ...\n"
+awk -v n=$LINECOUNT 'BEGIN { for (i = 1; i <= n; i++) print "line " i }' \
+  > $WC/file
+${SVN} add $WC/file -q
+${SVN} ci $WC -m "" -q
+
+rev=1
+while [ $rev -lt $REVCOUNT ]; do
+  rev=`expr $rev + 1`
+  awk -v r=$rev -v n=$LINECOUNT -v c=$CHANGECOUNT '
+    BEGIN { srand(r); for (i = 0; i < c; i++) change[int(rand() * n)] = 1 }
+    { if (change[NR]) print "line " NR " changed in r" r; else print }
+  ' $WC/file > $WC/file.new
+  mv $WC/file.new $WC/file
+  ${SVN} ci $WC -m "" -q
+done
+
+# run blame
+
+run_svn_blame() {
+  if [ "${VALGRIND}" = "" ] ; then
+    time ${SVN} blame $1 $URL/file > /dev/null
+  else
+    ${VALGRIND} ${VG_OUTFILE}="${VG_TOOL}.out.blame$1" ${SVN} blame $1 $URL/file > /dev/null
+  fi
+}
+
+printf "\t\t\t\t real   user    sys\n"
+
+# Blame gets computed by the server, if supported by the RA layer.
+printf "\tBlame ...         \t"
+run_svn_blame
+
+# Including merged revisions always builds the blame chains on the
+# client side.
+printf "\tBlame -g ...      \t"
+run_svn_blame -g
+
+# tear down
+
+rm -rf $WC
+
+if [ "${SVNSERVE}" != "" ] ; then
+  echo "killing svnserve ... "
+  kill $PID
+fi
@@ -0,0 +1,568 @@
+/*
+ * ra-svn-bench.c :  replay recorded ra_svn data against the parser
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+/* This tool feeds files containing one direction of an ra_svn session
+ * to the protocol layer and reports how fast it got parsed.  No server
+ * or network is involved, so the results reflect the cost of the
+ * marshalling layer and of the editor driver only.
+ *
+ * The "items" command reads all items of the files and parses the
+ * top-level lists as commands or responses.  The "editor" command
+ * drives a no-op editor from files that contain an editor drive, e.g.
+ * the response to an update after the report has been sent.  The
+ * "generate" command writes a synthetic editor drive that adds a tree
+ * of files, with either svndiff0 or svndiff1 deltas and optionally with
+ * whole-stream compression, for comparisons without recordings.
+ *
+ * Malformed input gets reported but doesn't stop the processing of the
+ * other files, so the replay commands can also serve as fuzzing targets
+ * for the protocol parser.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <apr.h>
+#include <apr_general.h>
+#include <apr_getopt.h>
+#include <apr_strings.h>
+#include <apr_time.h>
+
+#include "svn_pools.h"
+#include "svn_error.h"
+#include "svn_string.h"
+#include "svn_io.h"
+#include "svn_delta.h"
+#include "svn_ra_svn.h"
+
+/* Totals of a replay run. */
+typedef struct replay_stats_t
+{
+  apr_uint64_t items;
+  apr_uint64_t bytes;
+  apr_uint64_t windows;
+  int failed;
+} replay_stats_t;
+
+/* Open a connection in *CONN that reads from the file at PATH.  Any
+   responses will be written to a temporary file.  If COMPRESSED is set,
+   expect the whole file to be compressed. */
+static svn_error_t *
+open_replay_conn(svn_ra_svn_conn_t **conn,
+                 const char *path,
+                 svn_boolean_t compressed,
+                 apr_pool_t *pool)
+{
+  apr_file_t *in_file, *out_file;
+
+  SVN_ERR(svn_io_file_open(&in_file, path, APR_READ | APR_BUFFERED,
+                           APR_OS_DEFAULT, pool));
+  SVN_ERR(svn_io_open_unique_file3(&out_file, NULL, NULL,
+                                   svn_io_file_del_on_pool_cleanup,
+                                   pool, pool));
+
+  *conn = svn_ra_svn_create_conn2(NULL, in_file, out_file,
+                                  SVN_DELTA_COMPRESSION_LEVEL_DEFAULT, pool);
+  if (compressed)
+    SVN_ERR(svn_ra_svn__enable_stream_compression(*conn, pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Read all items from CONN until the end of its input and count them in
+   *ITEMS.  Parse lists as commands or responses. */
+static svn_error_t *
+replay_items(apr_uint64_t *items,
+             svn_ra_svn_conn_t *conn,
+             apr_pool_t *pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(pool);
+
+  while (1)
+    {
+      svn_ra_svn_item_t *item;
+      const char *word;
+      apr_array_header_t *params;
+      svn_error_t *err;
+
+      svn_pool_clear(iterpool);
+      err = svn_ra_svn_read_item(conn, iterpool, &item);
+      if (err && err->apr_err == SVN_ERR_RA_SVN_CONNECTION_CLOSED)
+        {
+          svn_error_clear(err);
+          break;
+        }
+      SVN_ERR(err);
+
+      ++*items;
+      if (item->kind == SVN_RA_SVN_LIST)
+        {
+          /* Not every list is a command, so don't insist. */
+          svn_error_clear(svn_ra_svn_parse_tuple(item->u.list, iterpool,
+                                                 "wl", &word, &params));
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Baton for the counting editor. */
+typedef struct count_baton_t
+{
+  replay_stats_t *stats;
+} count_baton_t;
+
+/* Implements svn_txdelta_window_handler_t. */
+static svn_error_t *
+count_window(svn_txdelta_window_t *window,
+             void *baton)
+{
+  count_baton_t *cb = baton;
+
+  if (window)
+    cb->stats->windows++;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_delta_editor_t.apply_textdelta. */
+static svn_error_t *
+count_apply_textdelta(void *file_baton,
+                      const char *base_checksum,
+                      apr_pool_t *pool,
+                      svn_txdelta_window_handler_t *handler,
+                      void **handler_baton)
+{
+  *handler = count_window;
+  *handler_baton = file_baton;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_delta_editor_t.open_root. */
+static svn_error_t *
+count_open_root(void *edit_baton,
+                svn_revnum_t base_revision,
+                apr_pool_t *pool,
+                void **root_baton)
+{
+  *root_baton = edit_baton;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_delta_editor_t.add_directory. */
+static svn_error_t *
+count_add_directory(const char *path,
+                    void *parent_baton,
+                    const char *copyfrom_path,
+                    svn_revnum_t copyfrom_revision,
+                    apr_pool_t *pool,
+                    void **child_baton)
+{
+  *child_baton = parent_baton;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_delta_editor_t.open_directory. */
+static svn_error_t *
+count_open_directory(const char *path,
+                     void *parent_baton,
+                     svn_revnum_t base_revision,
+                     apr_pool_t *pool,
+                     void **child_baton)
+{
+  *child_baton = parent_baton;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_delta_editor_t.add_file. */
+static svn_error_t *
+count_add_file(const char *path,
+               void *parent_baton,
+               const char *copyfrom_path,
+               svn_revnum_t copyfrom_revision,
+               apr_pool_t *pool,
+               void **file_baton)
+{
+  *file_baton = parent_baton;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_delta_editor_t.open_file. */
+static svn_error_t *
+count_open_file(const char *path,
+                void *parent_baton,
+                svn_revnum_t base_revision,
+                apr_pool_t *pool,
+                void **file_baton)
+{
+  *file_baton = parent_baton;
+
+  return SVN_NO_ERROR;
+}
+
+/* Drive a no-op editor from CONN, counting the delta windows in STATS. */
+static svn_error_t *
+replay_editor(replay_stats_t *stats,
+              svn_ra_svn_conn_t *conn,
+              apr_pool_t *pool)
+{
+  svn_delta_editor_t *editor = svn_delta_default_editor(pool);
+  count_baton_t *cb = apr_palloc(pool, sizeof(*cb));
+  svn_boolean_t aborted = FALSE;
+
+  cb->stats = stats;
+  editor->open_root = count_open_root;
+  editor->add_directory = count_add_directory;
+  editor->open_directory = count_open_directory;
+  editor->add_file = count_add_file;
+  editor->open_file = count_open_file;
+  editor->apply_textdelta = count_apply_textdelta;
+
+  SVN_ERR(svn_ra_svn_drive_editor2(conn, pool, editor, cb, &aborted,
+                                   FALSE));
+  stats->items++;
+
+  return SVN_NO_ERROR;
+}
+
+/* Replay each of the FILES ITERATIONS times, driving an editor if
+   EDITOR is set and reading items otherwise, and print the results.
+   Set *FAILED if any of the files could not be processed. */
+static svn_error_t *
+do_replay(svn_boolean_t *failed,
+          const apr_array_header_t *files,
+          svn_boolean_t editor,
+          svn_boolean_t compressed,
+          int iterations,
+          apr_pool_t *pool)
+{
+  replay_stats_t stats = { 0 };
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  apr_time_t start = apr_time_now();
+  double seconds;
+  int i, k;
+
+  for (k = 0; k < iterations; k++)
+    for (i = 0; i < files->nelts; i++)
+      {
+        const char *path = APR_ARRAY_IDX(files, i, const char *);
+        svn_ra_svn_conn_t *conn;
+        apr_uint64_t bytes_read, bytes_written;
+        svn_error_t *err;
+
+        svn_pool_clear(iterpool);
+        SVN_ERR(open_replay_conn(&conn, path, compressed, iterpool));
+
+        err = editor ? replay_editor(&stats, conn, iterpool)
+                     : replay_items(&stats.items, conn, iterpool);
+
+        svn_ra_svn__get_transfer_counts(&bytes_read, &bytes_written, conn);
+        stats.bytes += bytes_read;
+
+        /* Report broken input once but keep going. */
+        if (err)
+          {
+            if (k == 0)
+              svn_handle_error2(err, stderr, FALSE,
+                                apr_psprintf(iterpool, "%s: ", path));
+            svn_error_clear(err);
+            stats.failed++;
+          }
+      }
+
+  svn_pool_destroy(iterpool);
+
+  seconds = (double)(apr_time_now() - start) / APR_USEC_PER_SEC;
+  if (seconds <= 0)
+    seconds = 1e-6;
+
+  printf("%-8s %10.3f s %12.0f %s/s %10.1f MB/s",
+         editor ? "editor" : "items", seconds,
+         (double)stats.items / seconds, editor ? "edits" : "items",
+         (double)stats.bytes / seconds / 1024 / 1024);
+  if (editor)
+    printf(" %12.0f windows/s", (double)stats.windows / seconds);
+  printf("\n");
+
+  *failed = stats.failed > 0;
+  return SVN_NO_ERROR;
+}
+
+/* Baton for write_chunk(). */
+typedef struct chunk_baton_t
+{
+  svn_ra_svn_conn_t *conn;
+  const char *token;
+  apr_pool_t *pool;
+} chunk_baton_t;
+
+/* Implements svn_write_fn_t.  Send DATA as a textdelta-chunk command,
+   the way the ra_svn editor does. */
+static svn_error_t *
+write_chunk(void *baton,
+            const char *data,
+            apr_size_t *len)
+{
+  chunk_baton_t *b = baton;
+  svn_string_t str;
+
+  str.data = data;
+  str.len = *len;
+
+  return svn_ra_svn_write_cmd(b->conn, b->pool, "textdelta-chunk", "cs",
+                              b->token, &str);
+}
+
+/* Return LEN bytes of text built from SEED, allocated in POOL. */
+static svn_string_t *
+make_text(apr_size_t len,
+          apr_uint32_t seed,
+          apr_pool_t *pool)
+{
+  static const char *const words[] = {
+    "svn", "delta", "window", "revision", "path", "node", "commit", "the",
+    "of", "and", "to", "a", "in", "is", "that", "for", "\n"
+  };
+  svn_stringbuf_t *buf = svn_stringbuf_create_ensure(len + 16, pool);
+
+  while (buf->len < len)
+    {
+      seed = seed * 1103515245 + 12345;
+      svn_stringbuf_appendcstr(buf, words[(seed >> 16)
+                                          % (sizeof(words) / sizeof(*words))]);
+      svn_stringbuf_appendbyte(buf, ' ');
+    }
+  svn_stringbuf_chop(buf, buf->len - len);
+
+  return svn_string_ncreate(buf->data, buf->len, pool);
+}
+
+/* Write an editor drive that adds FILE_COUNT files of FILE_SIZE bytes in
+   directories of 100 files each to the file at PATH.  Send the texts as
+   svndiff of SVNDIFF_VERSION and compress the whole stream if COMPRESSED
+   is set. */
+static svn_error_t *
+do_generate(const char *path,
+            int file_count,
+            apr_size_t file_size,
+            int svndiff_version,
+            svn_boolean_t compressed,
+            apr_pool_t *pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  apr_file_t *file;
+  svn_ra_svn_conn_t *conn;
+  apr_uint64_t bytes_read, bytes_written;
+  apr_finfo_t finfo;
+  int i;
+
+  SVN_ERR(svn_io_file_open(&file, path,
+                           APR_WRITE | APR_CREATE | APR_TRUNCATE
+                           | APR_BUFFERED,
+                           APR_OS_DEFAULT, pool));
+  conn = svn_ra_svn_create_conn2(NULL, file, file,
+                                 SVN_DELTA_COMPRESSION_LEVEL_DEFAULT, pool);
+  if (compressed)
+    SVN_ERR(svn_ra_svn__enable_stream_compression(conn, pool));
+
+  SVN_ERR(svn_ra_svn_write_cmd(conn, pool, "target-rev", "r",
+                               (svn_revnum_t)1));
+  SVN_ERR(svn_ra_svn_write_cmd(conn, pool, "open-root", "(?r)c",
+                               (svn_revnum_t)0, "d0"));
+
+  for (i = 0; i < file_count; i++)
+    {
+      const char *dir_token, *dir_path;
+      chunk_baton_t cb;
+      svn_stream_t *stream;
+      svn_txdelta_window_handler_t handler;
+      void *handler_baton;
+
+      svn_pool_clear(iterpool);
+      dir_token = apr_psprintf(iterpool, "d%d", i / 100 + 1);
+      dir_path = apr_psprintf(iterpool, "dir%d", i / 100);
+      if (i % 100 == 0)
+        {
+          if (i > 0)
+            SVN_ERR(svn_ra_svn_write_cmd(conn, iterpool, "close-dir", "c",
+                                         apr_psprintf(iterpool, "d%d",
+                                                      i / 100)));
+          SVN_ERR(svn_ra_svn_write_cmd(conn, iterpool, "add-dir",
+                                       "ccc(?cr)", dir_path, "d0",
+                                       dir_token, NULL,
+                                       SVN_INVALID_REVNUM));
+        }
+
+      cb.conn = conn;
+      cb.token = apr_psprintf(iterpool, "f%d", i);
+      cb.pool = iterpool;
+      SVN_ERR(svn_ra_svn_write_cmd(conn, iterpool, "add-file", "ccc(?cr)",
+                                   apr_psprintf(iterpool, "%s/file%d",
+                                                dir_path, i),
+                                   dir_token, cb.token, NULL,
+                                   SVN_INVALID_REVNUM));
+      SVN_ERR(svn_ra_svn_write_cmd(conn, iterpool, "apply-textdelta",
+                                   "c(?c)", cb.token, NULL));
+
+      stream = svn_stream_create(&cb, iterpool);
+      svn_stream_set_write(stream, write_chunk);
+      svn_txdelta_to_svndiff3(&handler, &handler_baton, stream,
+                              svndiff_version,
+                              SVN_DELTA_COMPRESSION_LEVEL_DEFAULT, iterpool);
+      SVN_ERR(svn_txdelta_send_string(make_text(file_size, i, iterpool),
+                                      handler, handler_baton, iterpool));
+
+      SVN_ERR(svn_ra_svn_write_cmd(conn, iterpool, "textdelta-end", "c",
+                                   cb.token));
+      SVN_ERR(svn_ra_svn_write_cmd(conn, iterpool, "close-file", "c(?c)",
+                                   cb.token, NULL));
+    }
+
+  if (file_count > 0)
+    SVN_ERR(svn_ra_svn_write_cmd(conn, pool, "close-dir", "c",
+                                 apr_psprintf(pool, "d%d",
+                                              (file_count - 1) / 100 + 1)));
+  SVN_ERR(svn_ra_svn_write_cmd(conn, pool, "close-dir", "c", "d0"));
+  SVN_ERR(svn_ra_svn_write_cmd(conn, pool, "close-edit", ""));
+  SVN_ERR(svn_ra_svn_flush(conn, pool));
+  SVN_ERR(svn_io_file_close(file, pool));
+
+  svn_ra_svn__get_transfer_counts(&bytes_read, &bytes_written, conn);
+  SVN_ERR(svn_io_stat(&finfo, path, APR_FINFO_SIZE, pool));
+  printf("%d files, svndiff%d%s: %" APR_UINT64_T_FMT " bytes of protocol"
+         " data, %" APR_OFF_T_FMT " bytes written\n",
+         file_count, svndiff_version, compressed ? ", compressed" : "",
+         bytes_written, finfo.size);
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+static void
+usage(const char *progname)
+{
+  fprintf(stderr,
+          "Usage: %s items [-z] [-n ITERATIONS] FILE...\n"
+          "       %s editor [-z] [-n ITERATIONS] FILE...\n"
+          "       %s generate [-z] [-v SVNDIFF_VERSION] [-f FILES]"
+          " [-s FILE_SIZE] FILE\n"
+          "\n"
+          "  -z  the data is compressed as with the zlib-stream"
+          " capability\n",
+          progname, progname, progname);
+}
+
+int main(int argc, const char *argv[])
+{
+  apr_pool_t *pool;
+  apr_getopt_t *os;
+  apr_array_header_t *files;
+  const char *cmd, *arg;
+  svn_boolean_t compressed = FALSE, failed = FALSE;
+  int iterations = 1, file_count = 1000, svndiff_version = 1;
+  apr_size_t file_size = 4096;
+  char opt_id;
+  apr_status_t status;
+  svn_error_t *svn_err = SVN_NO_ERROR;
+  int rc = 0;
+
+  apr_initialize();
+
+  pool = svn_pool_create(NULL);
+
+  if (argc < 3)
+    {
+      usage(argv[0]);
+      apr_terminate();
+      return 2;
+    }
+
+  cmd = argv[1];
+  apr_getopt_init(&os, pool, argc - 1, argv + 1);
+  while ((status = apr_getopt(os, "zn:v:f:s:", &opt_id, &arg))
+         == APR_SUCCESS)
+    {
+      switch (opt_id)
+        {
+          case 'z':
+            compressed = TRUE;
+            break;
+          case 'n':
+            iterations = atoi(arg);
+            break;
+          case 'v':
+            svndiff_version = atoi(arg);
+            break;
+          case 'f':
+            file_count = atoi(arg);
+            break;
+          case 's':
+            file_size = (apr_size_t)atol(arg);
+            break;
+        }
+    }
+
+  files = apr_array_make(pool, argc, sizeof(const char *));
+  while (os->ind < os->argc)
+    APR_ARRAY_PUSH(files, const char *) = os->argv[os->ind++];
+
+  if (status != APR_EOF || files->nelts == 0
+      || (svndiff_version != 0 && svndiff_version != 1))
+    {
+      usage(argv[0]);
+      rc = 2;
+    }
+  else if (strcmp(cmd, "items") == 0 || strcmp(cmd, "editor") == 0)
+    svn_err = do_replay(&failed, files, strcmp(cmd, "editor") == 0,
+                        compressed, iterations > 0 ? iterations : 1, pool);
+  else if (strcmp(cmd, "generate") == 0 && files->nelts == 1)
+    svn_err = do_generate(APR_ARRAY_IDX(files, 0, const char *),
+                          file_count > 0 ? file_count : 0, file_size,
+                          svndiff_version, compressed, pool);
+  else
+    {
+      usage(argv[0]);
+      rc = 2;
+    }
+
+  if (svn_err)
+    {
+      svn_handle_error2(svn_err, stderr, FALSE, "ra-svn-bench: ");
+      rc = 2;
+    }
+  else if (failed)
+    rc = 1;
+
+  apr_terminate();
+
+  return rc;
+}
@@ -0,0 +1,328 @@
+/*
+ * svndiff-bench.c :  measure svndiff decoding and window application
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+/* This tool collects the deltas between consecutive versions of all
+ * files changed in a range of revisions of a repository, encodes them
+ * as svndiff in memory and then repeatedly decodes and applies them.
+ * Repository access is not part of the measurement, so the results
+ * reflect the CPU cost of window processing on realistic data only.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <apr.h>
+#include <apr_general.h>
+#include <apr_time.h>
+
+#include "svn_pools.h"
+#include "svn_delta.h"
+#include "svn_fs.h"
+#include "svn_repos.h"
+#include "svn_io.h"
+
+/* Upper limit to the amount of data that we keep in memory. */
+#define MAX_SAMPLE_SIZE (256 * 1024 * 1024)
+
+/* One delta to replay. */
+typedef struct sample_t
+{
+  /* The source fulltext. */
+  svn_string_t *source;
+
+  /* The svndiff stream, including its 4 byte header. */
+  svn_stringbuf_t *svndiff;
+} sample_t;
+
+/* Add the delta between the contents of PATH in REV - 1, if it has been
+   a file there, and in REV to SAMPLES.  Add the total size of the data
+   kept to *TOTAL_SIZE. */
+static svn_error_t *
+add_sample(apr_array_header_t *samples,
+           apr_size_t *total_size,
+           svn_fs_t *fs,
+           svn_revnum_t rev,
+           const char *path,
+           apr_pool_t *result_pool,
+           apr_pool_t *scratch_pool)
+{
+  svn_fs_root_t *root, *prev_root = NULL;
+  svn_node_kind_t kind = svn_node_none;
+  svn_txdelta_stream_t *delta;
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+  sample_t *sample = apr_palloc(result_pool, sizeof(*sample));
+
+  SVN_ERR(svn_fs_revision_root(&root, fs, rev, scratch_pool));
+  if (rev > 0)
+    {
+      SVN_ERR(svn_fs_revision_root(&prev_root, fs, rev - 1, scratch_pool));
+      SVN_ERR(svn_fs_check_path(&kind, prev_root, path, scratch_pool));
+    }
+
+  sample->source = svn_string_create_empty(result_pool);
+  if (kind == svn_node_file)
+    {
+      svn_stream_t *contents;
+
+      SVN_ERR(svn_fs_file_contents(&contents, prev_root, path,
+                                   scratch_pool));
+      SVN_ERR(svn_string_from_stream(&sample->source, contents,
+                                     result_pool, scratch_pool));
+    }
+
+  /* FSFS stores svndiff version 1 with default compression. */
+  sample->svndiff = svn_stringbuf_create_empty(result_pool);
+  SVN_ERR(svn_fs_get_file_delta_stream(&delta,
+                                       kind == svn_node_file ? prev_root
+                                                             : NULL,
+                                       kind == svn_node_file ? path : NULL,
+                                       root, path, scratch_pool));
+  svn_txdelta_to_svndiff3(&handler, &handler_baton,
+                          svn_stream_from_stringbuf(sample->svndiff,
+                                                    scratch_pool),
+                          1, SVN_DELTA_COMPRESSION_LEVEL_DEFAULT,
+                          scratch_pool);
+  SVN_ERR(svn_txdelta_send_txstream(delta, handler, handler_baton,
+                                    scratch_pool));
+
+  *total_size += sample->source->len + sample->svndiff->len;
+  APR_ARRAY_PUSH(samples, sample_t *) = sample;
+
+  return SVN_NO_ERROR;
+}
+
+/* Collect the samples for all files changed in REPOS_PATH up to the
+   youngest revision until their total size reaches MAX_SIZE. */
+static svn_error_t *
+collect_samples(apr_array_header_t **samples,
+                const char *repos_path,
+                apr_size_t max_size,
+                apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_fs_t *fs;
+  svn_revnum_t youngest, rev;
+  apr_size_t total_size = 0;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+
+  *samples = apr_array_make(pool, 1024, sizeof(sample_t *));
+
+  SVN_ERR(svn_repos_open2(&repos, repos_path, NULL, pool));
+  fs = svn_repos_fs(repos);
+  SVN_ERR(svn_fs_youngest_rev(&youngest, fs, pool));
+
+  for (rev = 1; rev <= youngest && total_size < max_size; rev++)
+    {
+      svn_fs_root_t *root;
+      apr_hash_t *changes;
+      apr_hash_index_t *hi;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_revision_root(&root, fs, rev, iterpool));
+      SVN_ERR(svn_fs_paths_changed2(&changes, root, iterpool));
+
+      for (hi = apr_hash_first(iterpool, changes); hi; hi = apr_hash_next(hi))
+        {
+          const char *path = svn__apr_hash_index_key(hi);
+          svn_fs_path_change2_t *change = svn__apr_hash_index_val(hi);
+
+          if (change->node_kind == svn_node_file && change->text_mod
+              && change->change_kind != svn_fs_path_change_delete)
+            SVN_ERR(add_sample(*samples, &total_size, fs, rev, path,
+                               pool, iterpool));
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Baton for replay_window(). */
+typedef struct replay_baton_t
+{
+  /* The source fulltext of the delta being replayed. */
+  const svn_string_t *source;
+
+  /* Whether to reconstruct the target views. */
+  svn_boolean_t apply;
+
+  /* Buffer to reconstruct the target views in, allocated in POOL. */
+  char *tbuf;
+  apr_size_t tbuf_size;
+  apr_pool_t *pool;
+
+  /* Statistics. */
+  apr_uint64_t windows;
+  apr_uint64_t bytes;
+} replay_baton_t;
+
+/* Implements svn_txdelta_window_handler_t. */
+static svn_error_t *
+replay_window(svn_txdelta_window_t *window,
+              void *baton)
+{
+  replay_baton_t *rb = baton;
+
+  if (window == NULL)
+    return SVN_NO_ERROR;
+
+  if (rb->apply)
+    {
+      apr_size_t tlen = window->tview_len;
+
+      if (tlen > rb->tbuf_size)
+        {
+          rb->tbuf_size = tlen;
+          rb->tbuf = apr_palloc(rb->pool, tlen);
+        }
+
+      svn_txdelta_apply_instructions(window,
+                                     rb->source->data
+                                       + (apr_size_t)window->sview_offset,
+                                     rb->tbuf, &tlen);
+    }
+
+  rb->windows++;
+  rb->bytes += window->tview_len;
+
+  return SVN_NO_ERROR;
+}
+
+/* Decode all windows of all SAMPLES and, if APPLY is set, reconstruct
+   their target views.  Add the number of windows processed to *WINDOWS
+   and the number of target bytes they describe to *BYTES. */
+static svn_error_t *
+replay_samples(apr_uint64_t *windows,
+               apr_uint64_t *bytes,
+               const apr_array_header_t *samples,
+               svn_boolean_t apply,
+               apr_pool_t *pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  replay_baton_t rb;
+  int i;
+
+  rb.apply = apply;
+  rb.tbuf = NULL;
+  rb.tbuf_size = 0;
+  rb.pool = pool;
+  rb.windows = 0;
+  rb.bytes = 0;
+
+  for (i = 0; i < samples->nelts; i++)
+    {
+      const sample_t *sample = APR_ARRAY_IDX(samples, i, const sample_t *);
+      svn_stream_t *parser;
+      apr_size_t len = sample->svndiff->len;
+
+      svn_pool_clear(iterpool);
+      rb.source = sample->source;
+      parser = svn_txdelta_parse_svndiff(replay_window, &rb, TRUE, iterpool);
+      SVN_ERR(svn_stream_write(parser, sample->svndiff->data, &len));
+      SVN_ERR(svn_stream_close(parser));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  *windows += rb.windows;
+  *bytes += rb.bytes;
+
+  return SVN_NO_ERROR;
+}
+
+/* Replay SAMPLES ITERATIONS times and print the results for the
+   benchmark NAME. */
+static svn_error_t *
+run_benchmark(const char *name,
+              const apr_array_header_t *samples,
+              svn_boolean_t apply,
+              int iterations,
+              apr_pool_t *pool)
+{
+  apr_uint64_t windows = 0, bytes = 0;
+  apr_time_t start = apr_time_now();
+  double seconds;
+  int i;
+
+  for (i = 0; i < iterations; i++)
+    SVN_ERR(replay_samples(&windows, &bytes, samples, apply, pool));
+
+  seconds = (double)(apr_time_now() - start) / APR_USEC_PER_SEC;
+  if (seconds <= 0)
+    seconds = 1e-6;
+
+  printf("%-16s %10.3f s %12.0f windows/s %10.1f MB/s\n", name, seconds,
+         (double)windows / seconds, (double)bytes / seconds / 1024 / 1024);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+do_benchmark(const char *repos_path,
+             int iterations,
+             apr_pool_t *pool)
+{
+  apr_array_header_t *samples;
+
+  SVN_ERR(collect_samples(&samples, repos_path, MAX_SAMPLE_SIZE, pool));
+  printf("%d deltas collected\n", samples->nelts);
+
+  SVN_ERR(run_benchmark("decode", samples, FALSE, iterations, pool));
+  SVN_ERR(run_benchmark("decode+apply", samples, TRUE, iterations, pool));
+
+  return SVN_NO_ERROR;
+}
+
+int main(int argc, char *argv[])
+{
+  apr_pool_t *pool;
+  int rc = 0;
+  svn_error_t *svn_err;
+
+  apr_initialize();
+
+  pool = svn_pool_create(NULL);
+
+  if (argc == 2 || argc == 3)
+    {
+      int iterations = argc == 3 ? atoi(argv[2]) : 10;
+
+      svn_err = do_benchmark(argv[1], iterations > 0 ? iterations : 1, pool);
+      if (svn_err)
+        {
+          svn_handle_error2(svn_err, stderr, FALSE, "svndiff-bench: ");
+          rc = 2;
+        }
+    }
+  else
+    {
+      fprintf(stderr, "Usage: %s REPOS_PATH [ITERATIONS]\n", argv[0]);
+      rc = 2;
+    }
+
+  apr_terminate();
+
+  return rc;
+}